@@ -0,0 +1,128 @@
+#include "commandlist_d3d11.h"
+#include "DXUT.h"
+#include <assert.h>
+
+
+CD3D11CommandBackend::CD3D11CommandBackend(ID3D11DeviceContext* pd3dImmCntxt)
+{
+	m_pd3dImmCntxt = pd3dImmCntxt;
+}
+
+// stage as in SDrawStateCache, vertex, hull, domain, geometry and pixel
+void CD3D11CommandBackend::SetShader(const int iStage, const void * pShader)
+{
+	switch(iStage)
+	{
+		case 0: m_pd3dImmCntxt->VSSetShader( (ID3D11VertexShader *) pShader, NULL, 0 ); break;
+		case 1: m_pd3dImmCntxt->HSSetShader( (ID3D11HullShader *) pShader, NULL, 0 ); break;
+		case 2: m_pd3dImmCntxt->DSSetShader( (ID3D11DomainShader *) pShader, NULL, 0 ); break;
+		case 3: m_pd3dImmCntxt->GSSetShader( (ID3D11GeometryShader *) pShader, NULL, 0 ); break;
+		default: m_pd3dImmCntxt->PSSetShader( (ID3D11PixelShader *) pShader, NULL, 0 );
+	}
+}
+
+void CD3D11CommandBackend::SetSlots(const int iStage, const DRAW_STATE_SLOT_KIND eKind, const int iFirst, const int iNr, const void * const ppList[])
+{
+	if(eKind==DRAW_STATE_CBUFFERS)
+	{
+		ID3D11Buffer * const * ppBuffers = (ID3D11Buffer * const *) ppList;
+		switch(iStage)
+		{
+			case 0: m_pd3dImmCntxt->VSSetConstantBuffers( iFirst, iNr, ppBuffers ); break;
+			case 1: m_pd3dImmCntxt->HSSetConstantBuffers( iFirst, iNr, ppBuffers ); break;
+			case 2: m_pd3dImmCntxt->DSSetConstantBuffers( iFirst, iNr, ppBuffers ); break;
+			case 3: m_pd3dImmCntxt->GSSetConstantBuffers( iFirst, iNr, ppBuffers ); break;
+			default: m_pd3dImmCntxt->PSSetConstantBuffers( iFirst, iNr, ppBuffers );
+		}
+	}
+	else if(eKind==DRAW_STATE_SAMPLERS)
+	{
+		ID3D11SamplerState * const * ppSamplers = (ID3D11SamplerState * const *) ppList;
+		switch(iStage)
+		{
+			case 0: m_pd3dImmCntxt->VSSetSamplers( iFirst, iNr, ppSamplers ); break;
+			case 1: m_pd3dImmCntxt->HSSetSamplers( iFirst, iNr, ppSamplers ); break;
+			case 2: m_pd3dImmCntxt->DSSetSamplers( iFirst, iNr, ppSamplers ); break;
+			case 3: m_pd3dImmCntxt->GSSetSamplers( iFirst, iNr, ppSamplers ); break;
+			default: m_pd3dImmCntxt->PSSetSamplers( iFirst, iNr, ppSamplers );
+		}
+	}
+	else
+	{
+		ID3D11ShaderResourceView * const * ppViews = (ID3D11ShaderResourceView * const *) ppList;
+		switch(iStage)
+		{
+			case 0: m_pd3dImmCntxt->VSSetShaderResources( iFirst, iNr, ppViews ); break;
+			case 1: m_pd3dImmCntxt->HSSetShaderResources( iFirst, iNr, ppViews ); break;
+			case 2: m_pd3dImmCntxt->DSSetShaderResources( iFirst, iNr, ppViews ); break;
+			case 3: m_pd3dImmCntxt->GSSetShaderResources( iFirst, iNr, ppViews ); break;
+			default: m_pd3dImmCntxt->PSSetShaderResources( iFirst, iNr, ppViews );
+		}
+	}
+}
+
+void CD3D11CommandBackend::SetVertexBuffer(const void * pBuffer, const unsigned int uStride, const unsigned int uOffset)
+{
+	ID3D11Buffer * pVertStream = (ID3D11Buffer *) pBuffer;
+	UINT stride = uStride, offset = uOffset;
+	m_pd3dImmCntxt->IASetVertexBuffers( 0, 1, &pVertStream, &stride, &offset );
+}
+
+void CD3D11CommandBackend::SetIndexBuffer(const void * pBuffer, const unsigned int uFormat)
+{
+	m_pd3dImmCntxt->IASetIndexBuffer( (ID3D11Buffer *) pBuffer, (DXGI_FORMAT) uFormat, 0 );
+}
+
+void CD3D11CommandBackend::SetInputLayout(const void * pLayout)
+{
+	m_pd3dImmCntxt->IASetInputLayout( (ID3D11InputLayout *) pLayout );
+}
+
+void CD3D11CommandBackend::SetTopology(const unsigned int uTopology)
+{
+	m_pd3dImmCntxt->IASetPrimitiveTopology( (D3D11_PRIMITIVE_TOPOLOGY) uTopology );
+}
+
+// the buffer must be dynamic with CPU write access
+void CD3D11CommandBackend::UpdateConstBuffer(const void * pBuffer, const void * pData, const int iSize)
+{
+	HRESULT hr;
+	ID3D11Buffer * pCBuffer = (ID3D11Buffer *) pBuffer;
+
+	D3D11_MAPPED_SUBRESOURCE MappedSubResource;
+	V( m_pd3dImmCntxt->Map( pCBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
+	if(SUCCEEDED(hr))
+	{
+		memcpy(MappedSubResource.pData, pData, iSize);
+		m_pd3dImmCntxt->Unmap( pCBuffer, 0 );
+	}
+}
+
+// the buffer must have default usage
+void CD3D11CommandBackend::UpdateBuffer(const void * pBuffer, const int iOffset, const void * pData, const int iSize)
+{
+	D3D11_BOX box;
+	box.left = iOffset; box.right = iOffset+iSize;
+	box.top = 0; box.bottom = 1; box.front = 0; box.back = 1;
+	m_pd3dImmCntxt->UpdateSubresource( (ID3D11Buffer *) pBuffer, 0, &box, pData, 0, 0 );
+}
+
+void CD3D11CommandBackend::ClearRenderTarget(const void * pView, const float fColor[4])
+{
+	m_pd3dImmCntxt->ClearRenderTargetView( (ID3D11RenderTargetView *) pView, fColor );
+}
+
+void CD3D11CommandBackend::ClearDepthStencil(const void * pView, const unsigned int uFlags, const float fDepth, const unsigned int uStencil)
+{
+	m_pd3dImmCntxt->ClearDepthStencilView( (ID3D11DepthStencilView *) pView, uFlags, fDepth, (UINT8) uStencil );
+}
+
+void CD3D11CommandBackend::Draw(const int iNrVerts, const int iFirstVert)
+{
+	m_pd3dImmCntxt->Draw( iNrVerts, iFirstVert );
+}
+
+void CD3D11CommandBackend::DrawIndexedInstanced(const int iNrIndices, const int iNrInstances, const int iFirstIndex, const int iBaseVertex, const int iFirstInstance)
+{
+	m_pd3dImmCntxt->DrawIndexedInstanced( iNrIndices, iNrInstances, iFirstIndex, iBaseVertex, iFirstInstance );
+}
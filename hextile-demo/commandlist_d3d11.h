@@ -0,0 +1,32 @@
+#ifndef __COMMANDLIST_D3D11_H__
+#define __COMMANDLIST_D3D11_H__
+
+#include <d3d11_2.h>
+#include "cputools/command_list.h"
+
+// issues the commands of cputools/command_list.h on a device context. The
+// opaque pointers are the D3D11 objects, the topology and index format
+// values D3D11_PRIMITIVE_TOPOLOGY and DXGI_FORMAT.
+class CD3D11CommandBackend : public CCommandBackend
+{
+public:
+	void SetShader(const int iStage, const void * pShader);
+	void SetSlots(const int iStage, const DRAW_STATE_SLOT_KIND eKind, const int iFirst, const int iNr, const void * const ppList[]);
+	void SetVertexBuffer(const void * pBuffer, const unsigned int uStride, const unsigned int uOffset);
+	void SetIndexBuffer(const void * pBuffer, const unsigned int uFormat);
+	void SetInputLayout(const void * pLayout);
+	void SetTopology(const unsigned int uTopology);
+	void UpdateConstBuffer(const void * pBuffer, const void * pData, const int iSize);
+	void UpdateBuffer(const void * pBuffer, const int iOffset, const void * pData, const int iSize);
+	void ClearRenderTarget(const void * pView, const float fColor[4]);
+	void ClearDepthStencil(const void * pView, const unsigned int uFlags, const float fDepth, const unsigned int uStencil);
+	void Draw(const int iNrVerts, const int iFirstVert);
+	void DrawIndexedInstanced(const int iNrIndices, const int iNrInstances, const int iFirstIndex, const int iBaseVertex, const int iFirstInstance);
+
+	CD3D11CommandBackend(ID3D11DeviceContext* pd3dImmCntxt);
+
+private:
+	ID3D11DeviceContext * m_pd3dImmCntxt;
+};
+
+#endif
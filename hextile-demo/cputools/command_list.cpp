@@ -0,0 +1,369 @@
+#include "command_list.h"
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+
+#define COMMAND_HEADER_BITS		8
+#define MAX_COMMAND_WORDS		(1<<(32-COMMAND_HEADER_BITS))
+
+void ResetCommandList(SCommandList * pList)
+{
+	pList->words.clear();
+	pList->iNrCommands = 0;
+}
+
+// appends the header and returns where the iNrArgs argument words go
+static unsigned int * BeginCommand(SCommandList * pList, const RENDER_COMMAND eCmd, const int iNrArgs)
+{
+	assert((1+iNrArgs)<MAX_COMMAND_WORDS);
+	const size_t uStart = pList->words.size();
+	pList->words.resize(uStart+1+iNrArgs);
+	pList->words[uStart] = ((unsigned int) eCmd) | (((unsigned int) (1+iNrArgs))<<COMMAND_HEADER_BITS);
+	++pList->iNrCommands;
+	return &pList->words[uStart+1];
+}
+
+// pointers take 2 words whatever their size
+static inline unsigned int * PutPointer(unsigned int * pW, const void * p)
+{
+	const unsigned long long uValue = (unsigned long long) (size_t) p;
+	pW[0] = (unsigned int) uValue; pW[1] = (unsigned int) (uValue>>32);
+	return pW+2;
+}
+
+static inline const void * GetPointer(const unsigned int * pW)
+{
+	return (const void *) (size_t) (((unsigned long long) pW[0]) | (((unsigned long long) pW[1])<<32));
+}
+
+static inline unsigned int FloatBits(const float fValue)
+{
+	unsigned int uBits;
+	memcpy(&uBits, &fValue, sizeof(uBits));
+	return uBits;
+}
+
+static inline float BitsFloat(const unsigned int uBits)
+{
+	float fValue;
+	memcpy(&fValue, &uBits, sizeof(fValue));
+	return fValue;
+}
+
+static inline int DataWords(const int iSize)
+{
+	return iSize>0 ? ((iSize+3)/4) : 0;
+}
+
+void RecordSetShader(SCommandList * pList, const int iStage, const void * pShader)
+{
+	unsigned int * pW = BeginCommand(pList, RCMD_SET_SHADER, 3);
+	pW[0] = (unsigned int) iStage;
+	PutPointer(pW+1, pShader);
+}
+
+void RecordSetSlots(SCommandList * pList, const int iStage, const DRAW_STATE_SLOT_KIND eKind, const int iFirst, const int iNr, const void * const ppList[])
+{
+	const int iNrSlots = std::max(0, iNr);
+	unsigned int * pW = BeginCommand(pList, RCMD_SET_SLOTS, 4+2*iNrSlots);
+	pW[0] = (unsigned int) iStage; pW[1] = (unsigned int) eKind; pW[2] = (unsigned int) iFirst; pW[3] = (unsigned int) iNrSlots;
+	pW += 4;
+	for(int s=0; s<iNrSlots; s++) pW = PutPointer(pW, ppList[s]);
+}
+
+void RecordSetVertexBuffer(SCommandList * pList, const void * pBuffer, const unsigned int uStride, const unsigned int uOffset)
+{
+	unsigned int * pW = BeginCommand(pList, RCMD_SET_VERTEX_BUFFER, 4);
+	pW = PutPointer(pW, pBuffer);
+	pW[0] = uStride; pW[1] = uOffset;
+}
+
+void RecordSetIndexBuffer(SCommandList * pList, const void * pBuffer, const unsigned int uFormat)
+{
+	unsigned int * pW = BeginCommand(pList, RCMD_SET_INDEX_BUFFER, 3);
+	pW = PutPointer(pW, pBuffer);
+	pW[0] = uFormat;
+}
+
+void RecordSetInputLayout(SCommandList * pList, const void * pLayout)
+{
+	PutPointer(BeginCommand(pList, RCMD_SET_INPUT_LAYOUT, 2), pLayout);
+}
+
+void RecordSetTopology(SCommandList * pList, const unsigned int uTopology)
+{
+	BeginCommand(pList, RCMD_SET_TOPOLOGY, 1)[0] = uTopology;
+}
+
+void RecordUpdateConstBuffer(SCommandList * pList, const void * pBuffer, const void * pData, const int iSize)
+{
+	const int iNrDataWords = DataWords(iSize);
+	unsigned int * pW = BeginCommand(pList, RCMD_UPDATE_CBUFFER, 3+iNrDataWords);
+	pW = PutPointer(pW, pBuffer);
+	pW[0] = (unsigned int) iSize;
+	if(iNrDataWords>0)
+	{
+		pW[iNrDataWords] = 0;		// the padding of the last word
+		memcpy(pW+1, pData, iSize);
+	}
+}
+
+void RecordUpdateBuffer(SCommandList * pList, const void * pBuffer, const int iOffset, const void * pData, const int iSize)
+{
+	const int iNrDataWords = DataWords(iSize);
+	unsigned int * pW = BeginCommand(pList, RCMD_UPDATE_BUFFER, 4+iNrDataWords);
+	pW = PutPointer(pW, pBuffer);
+	pW[0] = (unsigned int) iOffset; pW[1] = (unsigned int) iSize;
+	if(iNrDataWords>0)
+	{
+		pW[1+iNrDataWords] = 0;
+		memcpy(pW+2, pData, iSize);
+	}
+}
+
+void RecordClearRenderTarget(SCommandList * pList, const void * pView, const float fColor[4])
+{
+	unsigned int * pW = BeginCommand(pList, RCMD_CLEAR_RENDER_TARGET, 6);
+	pW = PutPointer(pW, pView);
+	for(int c=0; c<4; c++) pW[c] = FloatBits(fColor[c]);
+}
+
+void RecordClearDepthStencil(SCommandList * pList, const void * pView, const unsigned int uFlags, const float fDepth, const unsigned int uStencil)
+{
+	unsigned int * pW = BeginCommand(pList, RCMD_CLEAR_DEPTH_STENCIL, 5);
+	pW = PutPointer(pW, pView);
+	pW[0] = uFlags; pW[1] = FloatBits(fDepth); pW[2] = uStencil;
+}
+
+void RecordDraw(SCommandList * pList, const int iNrVerts, const int iFirstVert)
+{
+	unsigned int * pW = BeginCommand(pList, RCMD_DRAW, 2);
+	pW[0] = (unsigned int) iNrVerts; pW[1] = (unsigned int) iFirstVert;
+}
+
+void RecordDrawIndexedInstanced(SCommandList * pList, const int iNrIndices, const int iNrInstances, const int iFirstIndex, const int iBaseVertex, const int iFirstInstance)
+{
+	unsigned int * pW = BeginCommand(pList, RCMD_DRAW_INDEXED_INSTANCED, 5);
+	pW[0] = (unsigned int) iNrIndices; pW[1] = (unsigned int) iNrInstances; pW[2] = (unsigned int) iFirstIndex;
+	pW[3] = (unsigned int) iBaseVertex; pW[4] = (unsigned int) iFirstInstance;
+}
+
+#define MAX_CLEAR		8
+
+void RecordFlushDrawStateCache(SCommandList * pList, SDrawStateCache * pCache)
+{
+	const void * const clear[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+
+	for(int st=0; st<DRAW_STATE_NUM_STAGES; st++)
+		for(int k=0; k<NUM_DRAW_STATE_SLOT_KINDS; k++)
+		{
+			const int iNr = pCache->iNrSlotsUsed[st][k];
+			for(int i=0; i<iNr; i+= MAX_CLEAR)
+			{
+				RecordSetSlots(pList, st, (DRAW_STATE_SLOT_KIND) k, i, std::min(iNr-i, MAX_CLEAR), clear);
+				++pCache->iNrCalls;
+			}
+		}
+
+	// keep the counts of the pass for the caller
+	const int iNrCalls = pCache->iNrCalls, iNrRedundant = pCache->iNrRedundant;
+	ResetDrawStateCache(pCache);
+	pCache->iNrCalls = iNrCalls; pCache->iNrRedundant = iNrRedundant;
+}
+
+
+// the length a command must have given its fixed arguments, or -1
+static int ExpectedCommandWords(const RENDER_COMMAND eCmd, const unsigned int * pArgs, const int iNrArgs)
+{
+	switch(eCmd)
+	{
+		case RCMD_SET_SHADER: return 1+3;
+		case RCMD_SET_SLOTS:
+			return (iNrArgs<4 || pArgs[3]>DRAW_STATE_MAX_SLOTS) ? -1 : (1+4+2*((int) pArgs[3]));
+		case RCMD_SET_VERTEX_BUFFER: return 1+4;
+		case RCMD_SET_INDEX_BUFFER: return 1+3;
+		case RCMD_SET_INPUT_LAYOUT: return 1+2;
+		case RCMD_SET_TOPOLOGY: return 1+1;
+		case RCMD_UPDATE_CBUFFER:
+			return (iNrArgs<3 || pArgs[2]>=(4u*MAX_COMMAND_WORDS)) ? -1 : (1+3+DataWords((int) pArgs[2]));
+		case RCMD_UPDATE_BUFFER:
+			return (iNrArgs<4 || pArgs[3]>=(4u*MAX_COMMAND_WORDS)) ? -1 : (1+4+DataWords((int) pArgs[3]));
+		case RCMD_CLEAR_RENDER_TARGET: return 1+6;
+		case RCMD_CLEAR_DEPTH_STENCIL: return 1+5;
+		case RCMD_DRAW: return 1+2;
+		case RCMD_DRAW_INDEXED_INSTANCED: return 1+5;
+		default: return -1;
+	}
+}
+
+bool ReplayCommandLists(CCommandBackend * pBackend, const SCommandList * const pLists[], const int iNrLists)
+{
+	const void * slots[DRAW_STATE_MAX_SLOTS];
+
+	for(int l=0; l<iNrLists; l++)
+	{
+		const unsigned int * pWords = pLists[l]->words.empty() ? NULL : &pLists[l]->words[0];
+		const size_t uNrWords = pLists[l]->words.size();
+
+		size_t uPos = 0;
+		while(uPos<uNrWords)
+		{
+			const RENDER_COMMAND eCmd = (RENDER_COMMAND) (pWords[uPos]&((1u<<COMMAND_HEADER_BITS)-1));
+			const int iNrWords = (int) (pWords[uPos]>>COMMAND_HEADER_BITS);
+			const unsigned int * pW = pWords+uPos+1;
+			const int iNrArgs = (int) std::min((size_t) iNrWords, uNrWords-uPos) - 1;
+			if(iNrWords<1 || (uPos+iNrWords)>uNrWords || ExpectedCommandWords(eCmd, pW, iNrArgs)!=iNrWords) return false;
+
+			switch(eCmd)
+			{
+				case RCMD_SET_SHADER: pBackend->SetShader((int) pW[0], GetPointer(pW+1)); break;
+				case RCMD_SET_SLOTS:
+					for(int s=0; s<((int) pW[3]); s++) slots[s] = GetPointer(pW+4+2*s);
+					pBackend->SetSlots((int) pW[0], (DRAW_STATE_SLOT_KIND) pW[1], (int) pW[2], (int) pW[3], slots);
+					break;
+				case RCMD_SET_VERTEX_BUFFER: pBackend->SetVertexBuffer(GetPointer(pW), pW[2], pW[3]); break;
+				case RCMD_SET_INDEX_BUFFER: pBackend->SetIndexBuffer(GetPointer(pW), pW[2]); break;
+				case RCMD_SET_INPUT_LAYOUT: pBackend->SetInputLayout(GetPointer(pW)); break;
+				case RCMD_SET_TOPOLOGY: pBackend->SetTopology(pW[0]); break;
+				case RCMD_UPDATE_CBUFFER: pBackend->UpdateConstBuffer(GetPointer(pW), pW+3, (int) pW[2]); break;
+				case RCMD_UPDATE_BUFFER: pBackend->UpdateBuffer(GetPointer(pW), (int) pW[2], pW+4, (int) pW[3]); break;
+				case RCMD_CLEAR_RENDER_TARGET:
+				{
+					const float fColor[] = {BitsFloat(pW[2]), BitsFloat(pW[3]), BitsFloat(pW[4]), BitsFloat(pW[5])};
+					pBackend->ClearRenderTarget(GetPointer(pW), fColor);
+				}
+				break;
+				case RCMD_CLEAR_DEPTH_STENCIL: pBackend->ClearDepthStencil(GetPointer(pW), pW[2], BitsFloat(pW[3]), pW[4]); break;
+				case RCMD_DRAW: pBackend->Draw((int) pW[0], (int) pW[1]); break;
+				case RCMD_DRAW_INDEXED_INSTANCED: pBackend->DrawIndexedInstanced((int) pW[0], (int) pW[1], (int) pW[2], (int) pW[3], (int) pW[4]); break;
+				default: return false;
+			}
+
+			uPos += iNrWords;
+		}
+	}
+
+	return true;
+}
+
+
+CNullCommandBackend::CNullCommandBackend()
+{
+	Reset();
+}
+
+void CNullCommandBackend::Reset()
+{
+	memset(&m_state, 0, sizeof(m_state));
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_uVertexStride = 0; m_uVertexOffset = 0; m_uIndexFormat = 0;
+}
+
+void CNullCommandBackend::SetShader(const int iStage, const void * pShader)
+{
+	++m_stats.iNrCommands[RCMD_SET_SHADER];
+	if(iStage<0 || iStage>=DRAW_STATE_NUM_STAGES) { ++m_stats.iNrErrors; return; }
+	if(m_state.pShaders[iStage]==pShader) ++m_stats.iNrRedundant;
+	m_state.pShaders[iStage] = pShader;
+}
+
+void CNullCommandBackend::SetSlots(const int iStage, const DRAW_STATE_SLOT_KIND eKind, const int iFirst, const int iNr, const void * const ppList[])
+{
+	++m_stats.iNrCommands[RCMD_SET_SLOTS];
+	if(iStage<0 || iStage>=DRAW_STATE_NUM_STAGES || eKind<0 || eKind>=NUM_DRAW_STATE_SLOT_KINDS ||
+	   iFirst<0 || iNr<=0 || (iFirst+iNr)>DRAW_STATE_MAX_SLOTS) { ++m_stats.iNrErrors; return; }
+
+	const void ** ppBound = m_state.pSlots[iStage][eKind];
+	bool bChanged = false;
+	for(int s=0; s<iNr; s++)
+	{
+		bChanged |= ppBound[iFirst+s]!=ppList[s];
+		ppBound[iFirst+s] = ppList[s];
+	}
+	if(!bChanged) ++m_stats.iNrRedundant;
+}
+
+void CNullCommandBackend::SetVertexBuffer(const void * pBuffer, const unsigned int uStride, const unsigned int uOffset)
+{
+	++m_stats.iNrCommands[RCMD_SET_VERTEX_BUFFER];
+	if(pBuffer!=NULL && uStride==0) ++m_stats.iNrErrors;
+	if(m_state.pInputs[DRAW_STATE_VERTEX_BUFFER]==pBuffer) ++m_stats.iNrRedundant;
+	m_state.pInputs[DRAW_STATE_VERTEX_BUFFER] = pBuffer;
+	m_uVertexStride = pBuffer!=NULL ? uStride : 0;
+	m_uVertexOffset = pBuffer!=NULL ? uOffset : 0;
+}
+
+void CNullCommandBackend::SetIndexBuffer(const void * pBuffer, const unsigned int uFormat)
+{
+	++m_stats.iNrCommands[RCMD_SET_INDEX_BUFFER];
+	if(m_state.pInputs[DRAW_STATE_INDEX_BUFFER]==pBuffer) ++m_stats.iNrRedundant;
+	m_state.pInputs[DRAW_STATE_INDEX_BUFFER] = pBuffer;
+	m_uIndexFormat = pBuffer!=NULL ? uFormat : 0;
+}
+
+void CNullCommandBackend::SetInputLayout(const void * pLayout)
+{
+	++m_stats.iNrCommands[RCMD_SET_INPUT_LAYOUT];
+	if(m_state.pInputs[DRAW_STATE_INPUT_LAYOUT]==pLayout) ++m_stats.iNrRedundant;
+	m_state.pInputs[DRAW_STATE_INPUT_LAYOUT] = pLayout;
+}
+
+void CNullCommandBackend::SetTopology(const unsigned int uTopology)
+{
+	++m_stats.iNrCommands[RCMD_SET_TOPOLOGY];
+	const void * pTopology = (const void *) (size_t) uTopology;
+	if(m_state.pInputs[DRAW_STATE_TOPOLOGY]==pTopology) ++m_stats.iNrRedundant;
+	m_state.pInputs[DRAW_STATE_TOPOLOGY] = pTopology;
+}
+
+void CNullCommandBackend::UpdateConstBuffer(const void * pBuffer, const void * pData, const int iSize)
+{
+	++m_stats.iNrCommands[RCMD_UPDATE_CBUFFER];
+	if(pBuffer==NULL || pData==NULL || iSize<=0) ++m_stats.iNrErrors;
+	else m_stats.iNrBytesUpdated += iSize;
+}
+
+void CNullCommandBackend::UpdateBuffer(const void * pBuffer, const int iOffset, const void * pData, const int iSize)
+{
+	++m_stats.iNrCommands[RCMD_UPDATE_BUFFER];
+	if(pBuffer==NULL || pData==NULL || iOffset<0 || iSize<=0) ++m_stats.iNrErrors;
+	else m_stats.iNrBytesUpdated += iSize;
+}
+
+void CNullCommandBackend::ClearRenderTarget(const void * pView, const float fColor[4])
+{
+	++m_stats.iNrCommands[RCMD_CLEAR_RENDER_TARGET];
+	bool bFinite = true;
+	for(int c=0; c<4; c++) bFinite &= fabsf(fColor[c])<=FLT_MAX;
+	if(pView==NULL || !bFinite) ++m_stats.iNrErrors;
+}
+
+void CNullCommandBackend::ClearDepthStencil(const void * pView, const unsigned int uFlags, const float fDepth, const unsigned int uStencil)
+{
+	++m_stats.iNrCommands[RCMD_CLEAR_DEPTH_STENCIL];
+	if(pView==NULL || uFlags==0 || !(fDepth>=0.0f && fDepth<=1.0f) || uStencil>0xff) ++m_stats.iNrErrors;
+}
+
+bool CNullCommandBackend::ValidateDraw(const bool bIndexed) const
+{
+	return m_state.pShaders[0]!=NULL && m_state.pInputs[DRAW_STATE_INPUT_LAYOUT]!=NULL && m_state.pInputs[DRAW_STATE_TOPOLOGY]!=NULL &&
+		   m_state.pInputs[DRAW_STATE_VERTEX_BUFFER]!=NULL && (!bIndexed || (m_state.pInputs[DRAW_STATE_INDEX_BUFFER]!=NULL && m_uIndexFormat!=0));
+}
+
+void CNullCommandBackend::Draw(const int iNrVerts, const int iFirstVert)
+{
+	++m_stats.iNrCommands[RCMD_DRAW];
+	if(!ValidateDraw(false) || iNrVerts<0 || iFirstVert<0) ++m_stats.iNrErrors;
+	else m_stats.iNrVertsDrawn += iNrVerts;
+}
+
+void CNullCommandBackend::DrawIndexedInstanced(const int iNrIndices, const int iNrInstances, const int iFirstIndex, const int /*iBaseVertex*/, const int iFirstInstance)
+{
+	++m_stats.iNrCommands[RCMD_DRAW_INDEXED_INSTANCED];
+	if(!ValidateDraw(true) || iNrIndices<0 || iNrInstances<0 || iFirstIndex<0 || iFirstInstance<0) ++m_stats.iNrErrors;
+	else m_stats.iNrVertsDrawn += ((long long) iNrIndices)*iNrInstances;
+}
+
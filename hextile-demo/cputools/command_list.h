@@ -0,0 +1,140 @@
+#ifndef __COMMANDLIST_H__
+#define __COMMANDLIST_H__
+
+#include "draw_list.h"
+#include <vector>
+#include <stddef.h>
+
+// Rendering recorded as a list of commands instead of calls on the device
+// context, binds, draws, clears and buffer updates. A list belongs to one
+// thread while it is recorded so several threads can each record their own
+// list, see ParallelFor() in parallel_for.h, and the lists are replayed in
+// order on one thread through a backend. CD3D11CommandBackend of
+// commandlist_d3d11.h issues them on the device, CNullCommandBackend below
+// only counts and validates them which runs anywhere. Device objects are
+// opaque pointers here and the stages and slot kinds those of
+// SDrawStateCache. Buffer contents are copied into the list.
+
+enum RENDER_COMMAND
+{
+	RCMD_SET_SHADER=0,
+	RCMD_SET_SLOTS,
+	RCMD_SET_VERTEX_BUFFER,
+	RCMD_SET_INDEX_BUFFER,
+	RCMD_SET_INPUT_LAYOUT,
+	RCMD_SET_TOPOLOGY,
+	RCMD_UPDATE_CBUFFER,						// the whole buffer, discarding the old contents
+	RCMD_UPDATE_BUFFER,							// a byte range
+	RCMD_CLEAR_RENDER_TARGET,
+	RCMD_CLEAR_DEPTH_STENCIL,
+	RCMD_DRAW,
+	RCMD_DRAW_INDEXED_INSTANCED,
+
+	NUM_RENDER_COMMANDS
+};
+
+// 32 bit words, each command a header word with the command in the low 8
+// bits and its length in words above followed by its arguments
+struct SCommandList
+{
+	std::vector<unsigned int> words;
+	int iNrCommands;
+};
+
+void ResetCommandList(SCommandList * pList);
+
+void RecordSetShader(SCommandList * pList, const int iStage, const void * pShader);
+void RecordSetSlots(SCommandList * pList, const int iStage, const DRAW_STATE_SLOT_KIND eKind, const int iFirst, const int iNr, const void * const ppList[]);
+void RecordSetVertexBuffer(SCommandList * pList, const void * pBuffer, const unsigned int uStride, const unsigned int uOffset);
+void RecordSetIndexBuffer(SCommandList * pList, const void * pBuffer, const unsigned int uFormat);
+void RecordSetInputLayout(SCommandList * pList, const void * pLayout);
+void RecordSetTopology(SCommandList * pList, const unsigned int uTopology);
+void RecordUpdateConstBuffer(SCommandList * pList, const void * pBuffer, const void * pData, const int iSize);
+void RecordUpdateBuffer(SCommandList * pList, const void * pBuffer, const int iOffset, const void * pData, const int iSize);
+void RecordClearRenderTarget(SCommandList * pList, const void * pView, const float fColor[4]);
+void RecordClearDepthStencil(SCommandList * pList, const void * pView, const unsigned int uFlags, const float fDepth, const unsigned int uStencil);
+void RecordDraw(SCommandList * pList, const int iNrVerts, const int iFirstVert);
+void RecordDrawIndexedInstanced(SCommandList * pList, const int iNrIndices, const int iNrInstances, const int iFirstIndex, const int iBaseVertex, const int iFirstInstance);
+
+// unbinds every slot bound through pCache and resets it, keeping its counts
+void RecordFlushDrawStateCache(SCommandList * pList, SDrawStateCache * pCache);
+
+
+class CCommandBackend
+{
+public:
+	virtual void SetShader(const int iStage, const void * pShader) = 0;
+	virtual void SetSlots(const int iStage, const DRAW_STATE_SLOT_KIND eKind, const int iFirst, const int iNr, const void * const ppList[]) = 0;
+	virtual void SetVertexBuffer(const void * pBuffer, const unsigned int uStride, const unsigned int uOffset) = 0;
+	virtual void SetIndexBuffer(const void * pBuffer, const unsigned int uFormat) = 0;
+	virtual void SetInputLayout(const void * pLayout) = 0;
+	virtual void SetTopology(const unsigned int uTopology) = 0;
+	virtual void UpdateConstBuffer(const void * pBuffer, const void * pData, const int iSize) = 0;
+	virtual void UpdateBuffer(const void * pBuffer, const int iOffset, const void * pData, const int iSize) = 0;
+	virtual void ClearRenderTarget(const void * pView, const float fColor[4]) = 0;
+	virtual void ClearDepthStencil(const void * pView, const unsigned int uFlags, const float fDepth, const unsigned int uStencil) = 0;
+	virtual void Draw(const int iNrVerts, const int iFirstVert) = 0;
+	virtual void DrawIndexedInstanced(const int iNrIndices, const int iNrInstances, const int iFirstIndex, const int iBaseVertex, const int iFirstInstance) = 0;
+
+	virtual ~CCommandBackend() {}
+};
+
+// replays pLists[0] to pLists[iNrLists-1] in that order. Fails when a list
+// is malformed, the commands before it in that list have been issued.
+bool ReplayCommandLists(CCommandBackend * pBackend, const SCommandList * const pLists[], const int iNrLists);
+
+
+// counts the commands and tracks the bound state to validate them. A draw
+// is invalid without a vertex shader, input layout, topology and vertex
+// buffer, an indexed draw also without an index buffer and index format.
+// Binding past DRAW_STATE_MAX_SLOTS, a vertex buffer without a stride,
+// updating or clearing NULL, empty updates, a clear color that is not finite
+// and a stencil value past 8 bits are invalid too. The buffer sizes are not
+// known here so offsets, first index and base vertex are not range checked.
+struct SNullBackendStats
+{
+	int iNrCommands[NUM_RENDER_COMMANDS];
+	int iNrErrors;
+	int iNrRedundant;							// binding what is bound
+	long long iNrVertsDrawn;					// indices or vertices times instances
+	long long iNrBytesUpdated;
+};
+
+class CNullCommandBackend : public CCommandBackend
+{
+public:
+	void SetShader(const int iStage, const void * pShader);
+	void SetSlots(const int iStage, const DRAW_STATE_SLOT_KIND eKind, const int iFirst, const int iNr, const void * const ppList[]);
+	void SetVertexBuffer(const void * pBuffer, const unsigned int uStride, const unsigned int uOffset);
+	void SetIndexBuffer(const void * pBuffer, const unsigned int uFormat);
+	void SetInputLayout(const void * pLayout);
+	void SetTopology(const unsigned int uTopology);
+	void UpdateConstBuffer(const void * pBuffer, const void * pData, const int iSize);
+	void UpdateBuffer(const void * pBuffer, const int iOffset, const void * pData, const int iSize);
+	void ClearRenderTarget(const void * pView, const float fColor[4]);
+	void ClearDepthStencil(const void * pView, const unsigned int uFlags, const float fDepth, const unsigned int uStencil);
+	void Draw(const int iNrVerts, const int iFirstVert);
+	void DrawIndexedInstanced(const int iNrIndices, const int iNrInstances, const int iFirstIndex, const int iBaseVertex, const int iFirstInstance);
+
+	// the state bound by the commands so far, shaders and inputs are NULL
+	// until set
+	const SDrawStateCache * GetBoundState() const { return &m_state; }
+	// of the bound vertex and index buffer, 0 until set
+	unsigned int GetVertexStride() const { return m_uVertexStride; }
+	unsigned int GetVertexOffset() const { return m_uVertexOffset; }
+	unsigned int GetIndexFormat() const { return m_uIndexFormat; }
+	const SNullBackendStats * GetStats() const { return &m_stats; }
+	void Reset();
+
+	CNullCommandBackend();
+
+private:
+	bool ValidateDraw(const bool bIndexed) const;
+
+	SDrawStateCache m_state;
+	SNullBackendStats m_stats;
+	unsigned int m_uVertexStride, m_uVertexOffset, m_uIndexFormat;
+};
+
+
+#endif
@@ -0,0 +1,334 @@
+#include "cpu_image.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <wctype.h>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wincodec.h>
+#endif
+
+
+bool AllocCpuImage(SCpuImage * pImg, const int width, const int height, const int depth)
+{
+	pImg->iWidth = width; pImg->iHeight = height; pImg->iDepth = depth;
+	pImg->pfPixels = new (std::nothrow) float[4*width*height*depth];
+	if(pImg->pfPixels!=NULL) memset(pImg->pfPixels, 0, 4*width*height*depth*sizeof(float));
+
+	return pImg->pfPixels!=NULL;
+}
+
+void FreeCpuImage(SCpuImage * pImg)
+{
+	delete [] pImg->pfPixels;
+	pImg->pfPixels = NULL;
+	pImg->iWidth = 0; pImg->iHeight = 0; pImg->iDepth = 0;
+}
+
+int GetNrMipLevels(const int width, const int height)
+{
+	int nrMips = 1;
+	int size = width>height ? width : height;
+	while(size>1) { size >>= 1; ++nrMips; }
+
+	return nrMips;
+}
+
+static inline int Wrap(const int i, const int size)
+{
+	const int r = i % size;
+	return r<0 ? (r+size) : r;
+}
+
+bool BuildMipChainWrap(SCpuImage pDstMips[], const SCpuImage &src, const int iNrMips)
+{
+	bool res = AllocCpuImage(&pDstMips[0], src.iWidth, src.iHeight);
+	if(res) memcpy(pDstMips[0].pfPixels, src.pfPixels, 4*src.iWidth*src.iHeight*sizeof(float));
+
+	for(int m=1; m<iNrMips && res; m++)
+	{
+		const SCpuImage &prev = pDstMips[m-1];
+		const int w = prev.iWidth>1 ? (prev.iWidth>>1) : 1;
+		const int h = prev.iHeight>1 ? (prev.iHeight>>1) : 1;
+
+		res = AllocCpuImage(&pDstMips[m], w, h);
+		for(int y=0; y<h && res; y++)
+			for(int x=0; x<w; x++)
+			{
+				float * pDst = GetCpuImagePixel(pDstMips[m], x, y);
+				for(int dy=0; dy<2; dy++)
+					for(int dx=0; dx<2; dx++)
+					{
+						const float * pSrc = GetCpuImagePixel(prev, Wrap(2*x+dx, prev.iWidth), Wrap(2*y+dy, prev.iHeight));
+						for(int c=0; c<4; c++) pDst[c] += 0.25f*pSrc[c];
+					}
+			}
+	}
+
+	return res;
+}
+
+void SampleBilinearWrap(float res[], const SCpuImage &img, const float s, const float t)
+{
+	const float u = s*img.iWidth - 0.5f, v = t*img.iHeight - 0.5f;
+	const float fu = floorf(u), fv = floorf(v);
+	const float wu = u - fu, wv = v - fv;
+	const int x0 = Wrap((int) fu, img.iWidth), y0 = Wrap((int) fv, img.iHeight);
+	const int x1 = Wrap(x0+1, img.iWidth), y1 = Wrap(y0+1, img.iHeight);
+
+	const float * p00 = GetCpuImagePixel(img, x0, y0);
+	const float * p10 = GetCpuImagePixel(img, x1, y0);
+	const float * p01 = GetCpuImagePixel(img, x0, y1);
+	const float * p11 = GetCpuImagePixel(img, x1, y1);
+
+	for(int c=0; c<4; c++)
+	{
+		const float top = p00[c] + wu*(p10[c]-p00[c]);
+		const float bot = p01[c] + wu*(p11[c]-p01[c]);
+		res[c] = top + wv*(bot-top);
+	}
+}
+
+void SampleGradWrap(float res[], const SCpuImage pMips[], const int iNrMips, const float st[], const float dSTdx[], const float dSTdy[])
+{
+	const float w = (float) pMips[0].iWidth, h = (float) pMips[0].iHeight;
+	const float lenX2 = dSTdx[0]*dSTdx[0]*w*w + dSTdx[1]*dSTdx[1]*h*h;
+	const float lenY2 = dSTdy[0]*dSTdy[0]*w*w + dSTdy[1]*dSTdy[1]*h*h;
+	const float rho2 = lenX2>lenY2 ? lenX2 : lenY2;
+
+	float lod = rho2>0.0f ? (0.5f*log2f(rho2)) : 0.0f;
+	if(lod<0.0f) lod = 0.0f;
+	if(lod>(float) (iNrMips-1)) lod = (float) (iNrMips-1);
+
+	const int m0 = (int) lod;
+	const int m1 = m0<(iNrMips-1) ? (m0+1) : m0;
+	const float t = lod - (float) m0;
+
+	float c0[4], c1[4];
+	SampleBilinearWrap(c0, pMips[m0], st[0], st[1]);
+	if(m1!=m0 && t>0.0f)
+	{
+		SampleBilinearWrap(c1, pMips[m1], st[0], st[1]);
+		for(int c=0; c<4; c++) res[c] = c0[c] + t*(c1[c]-c0[c]);
+	}
+	else
+	{
+		for(int c=0; c<4; c++) res[c] = c0[c];
+	}
+}
+
+
+bool SaveCpuImageDDS(const char name[], const SCpuImage pMips[], const int iNrMips)
+{
+	const unsigned int DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PITCH = 0x8;
+	const unsigned int DDSD_PIXELFORMAT = 0x1000, DDSD_MIPMAPCOUNT = 0x20000, DDSD_DEPTH = 0x800000;
+	const unsigned int DDPF_FOURCC = 0x4, DDPF_RGB = 0x40;
+	const unsigned int DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+	const unsigned int DDSCAPS2_VOLUME = 0x200000;
+	const unsigned int FOURCC_DX10 = 0x30315844;			// 'DX10'
+	const unsigned int DXGI_FORMAT_R32G32B32A32_FLOAT = 2;
+	const unsigned int D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3, D3D10_RESOURCE_DIMENSION_TEXTURE3D = 4;
+
+	const bool bIsVolume = pMips[0].iDepth>1;
+	if(bIsVolume && iNrMips>1) return false;
+
+	// same header as the dds files shipped in textures/
+	unsigned int header[31];
+	memset(header, 0, sizeof(header));
+	header[0] = 124;										// dwSize
+	header[1] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PITCH | DDSD_PIXELFORMAT |
+				(iNrMips>1 ? DDSD_MIPMAPCOUNT : 0) | (bIsVolume ? DDSD_DEPTH : 0);
+	header[2] = pMips[0].iHeight;
+	header[3] = pMips[0].iWidth;
+	header[4] = pMips[0].iWidth*4*sizeof(float);			// pitch
+	header[5] = bIsVolume ? pMips[0].iDepth : 0;
+	header[6] = iNrMips>1 ? iNrMips : 0;
+	header[18] = 32;										// ddspf.dwSize
+	header[19] = DDPF_FOURCC | DDPF_RGB;
+	header[20] = FOURCC_DX10;
+	header[21] = 128;										// dwRGBBitCount
+	header[22] = 0xff; header[23] = 0xff00; header[24] = 0xff0000;
+	header[26] = DDSCAPS_TEXTURE | (iNrMips>1 ? (DDSCAPS_COMPLEX | DDSCAPS_MIPMAP) : 0) | (bIsVolume ? DDSCAPS_COMPLEX : 0);
+	header[27] = bIsVolume ? DDSCAPS2_VOLUME : 0;
+
+	// DDS_HEADER_DXT10: format, dimension, misc flag, array size, misc flags2
+	const unsigned int header10[5] = { DXGI_FORMAT_R32G32B32A32_FLOAT,
+									   bIsVolume ? D3D10_RESOURCE_DIMENSION_TEXTURE3D : D3D10_RESOURCE_DIMENSION_TEXTURE2D, 0, 1, 0 };
+
+	FILE * fptr = fopen(name, "wb");
+	if(fptr==NULL) return false;
+
+	bool res = fwrite("DDS ", 1, 4, fptr)==4;
+	res &= fwrite(header, sizeof(header), 1, fptr)==1;
+	res &= fwrite(header10, sizeof(header10), 1, fptr)==1;
+	for(int m=0; m<iNrMips && res; m++)
+	{
+		const size_t nrFloats = 4*((size_t) pMips[m].iWidth)*pMips[m].iHeight*pMips[m].iDepth;
+		res &= fwrite(pMips[m].pfPixels, sizeof(float), nrFloats, fptr)==nrFloats;
+	}
+	fclose(fptr);
+
+	return res;
+}
+
+
+bool LoadCpuImageDDS(SCpuImage * pImg, const char name[])
+{
+	const unsigned int DDSD_DEPTH = 0x800000;
+	const unsigned int DDPF_FOURCC = 0x4;
+	const unsigned int D3DFMT_A32B32G32R32F = 116;
+	const unsigned int FOURCC_DX10 = 0x30315844;			// 'DX10'
+	const unsigned int DXGI_FORMAT_R32G32B32A32_FLOAT = 2;
+
+	FILE * fptr = fopen(name, "rb");
+	if(fptr==NULL) return false;
+
+	char magic[4];
+	unsigned int header[31], header10[5];
+	bool res = fread(magic, 1, 4, fptr)==4 && memcmp(magic, "DDS ", 4)==0;
+	if(res) res = fread(header, sizeof(header), 1, fptr)==1 && header[0]==124 && (header[19]&DDPF_FOURCC)!=0;
+	if(res) res = header[20]==FOURCC_DX10 ? (fread(header10, sizeof(header10), 1, fptr)==1 && header10[0]==DXGI_FORMAT_R32G32B32A32_FLOAT) :
+										  (header[20]==D3DFMT_A32B32G32R32F);
+
+	const int width = res ? (int) header[3] : 0, height = res ? (int) header[2] : 0;
+	const int depth = res && (header[1]&DDSD_DEPTH)!=0 && header[5]>1 ? (int) header[5] : 1;
+	if(res) res = width>0 && height>0;
+	if(res) res = AllocCpuImage(pImg, width, height, depth);
+	if(res)
+	{
+		const size_t nrFloats = 4*((size_t) width)*height*depth;
+		res = fread(pImg->pfPixels, sizeof(float), nrFloats, fptr)==nrFloats;
+		if(!res) FreeCpuImage(pImg);
+	}
+	fclose(fptr);
+
+	return res;
+}
+
+// the extension is .dds, not case sensitive
+static bool IsNameDDS(const wchar_t name[])
+{
+	const size_t len = wcslen(name);
+	return len>=4 && name[len-4]==L'.' && towlower(name[len-3])==L'd' && towlower(name[len-2])==L'd' && towlower(name[len-1])==L's';
+}
+
+#ifndef _WIN32
+bool LoadCpuImage(SCpuImage * pImg, const wchar_t name[], const bool sRGB)
+{
+	(void) sRGB;
+	char nameDDS[512];
+	return IsNameDDS(name) && wcstombs(nameDDS, name, sizeof(nameDDS))<sizeof(nameDDS) && LoadCpuImageDDS(pImg, nameDDS);
+}
+#endif
+
+#ifdef _WIN32
+static float SRGBToLinear(const float c)
+{
+	return c<=0.04045f ? (c/12.92f) : powf((c+0.055f)/1.055f, 2.4f);
+}
+
+bool LoadCpuImage(SCpuImage * pImg, const wchar_t name[], const bool sRGB)
+{
+	if(IsNameDDS(name))
+	{
+		char nameDDS[512];
+		return wcstombs(nameDDS, name, sizeof(nameDDS))<sizeof(nameDDS) && LoadCpuImageDDS(pImg, nameDDS);
+	}
+
+	IWICImagingFactory * pFactory = NULL;
+	IWICBitmapDecoder * pDecoder = NULL;
+	IWICBitmapFrameDecode * pFrame = NULL;
+	IWICFormatConverter * pConverter = NULL;
+	UINT width = 0, height = 0;
+
+	bool res = SUCCEEDED( CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pFactory)) );
+	if(res) res = SUCCEEDED( pFactory->CreateDecoderFromFilename(name, NULL, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &pDecoder) );
+	if(res) res = SUCCEEDED( pDecoder->GetFrame(0, &pFrame) );
+	if(res) res = SUCCEEDED( pFrame->GetSize(&width, &height) );
+	if(res) res = SUCCEEDED( pFactory->CreateFormatConverter(&pConverter) );
+
+	// 16 bits per channel integer avoids the implicit gamma conversion
+	// WIC applies when converting to a float format.
+	if(res) res = SUCCEEDED( pConverter->Initialize(pFrame, GUID_WICPixelFormat64bppRGBA, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom) );
+
+	unsigned short * pData = NULL;
+	if(res)
+	{
+		pData = new unsigned short[4*width*height];
+		res = pData!=NULL;
+	}
+	if(res) res = SUCCEEDED( pConverter->CopyPixels(NULL, width*4*sizeof(unsigned short), width*height*4*sizeof(unsigned short), (BYTE *) pData) );
+	if(res) res = AllocCpuImage(pImg, (int) width, (int) height);
+
+	if(res)
+	{
+		for(UINT i=0; i<(4*width*height); i++)
+		{
+			const float c = pData[i] / 65535.0f;
+			pImg->pfPixels[i] = (sRGB && (i&3)!=3) ? SRGBToLinear(c) : c;
+		}
+	}
+
+	delete [] pData;
+	if(pConverter!=NULL) pConverter->Release();
+	if(pFrame!=NULL) pFrame->Release();
+	if(pDecoder!=NULL) pDecoder->Release();
+	if(pFactory!=NULL) pFactory->Release();
+
+	return res;
+}
+
+bool SaveCpuImagePNG(const wchar_t name[], const SCpuImage &img)
+{
+	IWICImagingFactory * pFactory = NULL;
+	IWICStream * pStream = NULL;
+	IWICBitmapEncoder * pEncoder = NULL;
+	IWICBitmapFrameEncode * pFrame = NULL;
+	const UINT width = (UINT) img.iWidth, height = (UINT) img.iHeight;
+
+	bool res = SUCCEEDED( CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pFactory)) );
+	if(res) res = SUCCEEDED( pFactory->CreateStream(&pStream) );
+	if(res) res = SUCCEEDED( pStream->InitializeFromFilename(name, GENERIC_WRITE) );
+	if(res) res = SUCCEEDED( pFactory->CreateEncoder(GUID_ContainerFormatPng, NULL, &pEncoder) );
+	if(res) res = SUCCEEDED( pEncoder->Initialize(pStream, WICBitmapEncoderNoCache) );
+	if(res) res = SUCCEEDED( pEncoder->CreateNewFrame(&pFrame, NULL) );
+	if(res) res = SUCCEEDED( pFrame->Initialize(NULL) );
+	if(res) res = SUCCEEDED( pFrame->SetSize(width, height) );
+
+	WICPixelFormatGUID format = GUID_WICPixelFormat24bppBGR;
+	if(res) res = SUCCEEDED( pFrame->SetPixelFormat(&format) ) && IsEqualGUID(format, GUID_WICPixelFormat24bppBGR);
+
+	unsigned char * pData = NULL;
+	if(res)
+	{
+		pData = new unsigned char[3*width*height];
+		res = pData!=NULL;
+	}
+
+	if(res)
+	{
+		for(UINT i=0; i<(width*height); i++)
+			for(int c=0; c<3; c++)
+			{
+				const float v = img.pfPixels[4*i+c];
+				pData[3*i+2-c] = (unsigned char) (255.0f*(v<0.0f ? 0.0f : (v>1.0f ? 1.0f : v)) + 0.5f);
+			}
+
+		res = SUCCEEDED( pFrame->WritePixels(height, 3*width, 3*width*height, pData) );
+	}
+	if(res) res = SUCCEEDED( pFrame->Commit() );
+	if(res) res = SUCCEEDED( pEncoder->Commit() );
+
+	delete [] pData;
+	if(pFrame!=NULL) pFrame->Release();
+	if(pEncoder!=NULL) pEncoder->Release();
+	if(pStream!=NULL) pStream->Release();
+	if(pFactory!=NULL) pFactory->Release();
+
+	return res;
+}
+#endif
@@ -0,0 +1,53 @@
+#ifndef __CPUIMAGE_H__
+#define __CPUIMAGE_H__
+
+#include <wchar.h>
+
+// Simple float RGBA image used by the offline tools. Pixels are stored
+// row major, slice after slice, 4 floats per pixel.
+struct SCpuImage
+{
+	int iWidth, iHeight, iDepth;
+	float * pfPixels;
+};
+
+bool AllocCpuImage(SCpuImage * pImg, const int width, const int height, const int depth=1);
+void FreeCpuImage(SCpuImage * pImg);
+
+static inline float * GetCpuImagePixel(const SCpuImage &img, const int x, const int y, const int z=0)
+{
+	return img.pfPixels + 4*(x + img.iWidth*(y + img.iHeight*z));
+}
+
+// mip chains of 2D images. Mips are box filtered with wrap
+// addressing since the inputs of interest are tileable.
+int GetNrMipLevels(const int width, const int height);
+bool BuildMipChainWrap(SCpuImage pDstMips[], const SCpuImage &src, const int iNrMips);
+
+// emulates Texture2D.SampleGrad() with a trilinear wrap sampler. The lod is
+// the one of an isotropic filter so anisotropic sampling is not reproduced.
+void SampleGradWrap(float res[], const SCpuImage pMips[], const int iNrMips, const float st[], const float dSTdx[], const float dSTdy[]);
+void SampleBilinearWrap(float res[], const SCpuImage &img, const float s, const float t);
+
+// Saves an RGBA float (DXGI_FORMAT_R32G32B32A32_FLOAT) dds with the DX10
+// header of the files in textures/ which can be loaded back in by the DDS
+// texture loader. Volumes are supported when iNrMips is 1.
+bool SaveCpuImageDDS(const char name[], const SCpuImage pMips[], const int iNrMips);
+
+// level 0 of an RGBA float dds, such as those of SaveCpuImageDDS().
+bool LoadCpuImageDDS(SCpuImage * pImg, const char name[]);
+
+// any format WIC can decode. 8 and 16 bit channels are read without gamma
+// conversion and sRGB then selects conversion to linear, matching how the
+// demo creates the shader resource views. Names ending in .dds go to
+// LoadCpuImageDDS() and are linear already, without WIC only those load.
+bool LoadCpuImage(SCpuImage * pImg, const wchar_t name[], const bool sRGB);
+
+#ifdef _WIN32
+
+// rgb of the image clamped to [0;1] as an 8 bit per channel png, no gamma conversion.
+bool SaveCpuImagePNG(const wchar_t name[], const SCpuImage &img);
+#endif
+
+
+#endif
@@ -0,0 +1,194 @@
+#include "deriv_map.h"
+#include "parallel_for.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+
+void TspaceNormalToDerivative(float deriv[], const float vM[])
+{
+	const float scale = 1.0f/128.0f;
+
+	// Ensure vM delivers a positive third component using abs() and
+	// constrain vM.z so the range of the derivative is [-128; 128].
+	const float vMa[] = { fabsf(vM[0]), fabsf(vM[1]), fabsf(vM[2]) };
+	const float fMaxXY = vMa[0]>vMa[1] ? vMa[0] : vMa[1];
+	const float z_ma = vMa[2]>(scale*fMaxXY) ? vMa[2] : (scale*fMaxXY);
+
+	// Set to match positive vertical texture coordinate axis.
+	const float s = -1.0f;
+	deriv[0] = -vM[0]/z_ma;
+	deriv[1] = -(s*vM[1])/z_ma;
+}
+
+static void DerivFromNormalTexel(float deriv[], const float pfTexel[])
+{
+	const float vM[] = { 2.0f*pfTexel[0]-1.0f, 2.0f*pfTexel[1]-1.0f, 2.0f*pfTexel[2]-1.0f };
+	TspaceNormalToDerivative(deriv, vM);
+}
+
+static float Encode(const float fDeriv, const float fScale)
+{
+	const float v = 0.5f + 0.5f*(fDeriv/fScale);
+	return v<0.0f ? 0.0f : (v>1.0f ? 1.0f : v);
+}
+
+// angle between the normals (-d0.x, -d0.y, 1) and (-d1.x, -d1.y, 1)
+static float AngleBetweenDeg(const float d0[], const float d1[])
+{
+	const float fDot = d0[0]*d1[0] + d0[1]*d1[1] + 1.0f;
+	const float fLen2 = (d0[0]*d0[0] + d0[1]*d0[1] + 1.0f) * (d1[0]*d1[0] + d1[1]*d1[1] + 1.0f);
+	const float fCos = fDot / sqrtf(fLen2);
+
+	return (180.0f/3.14159265f) * acosf(fCos<1.0f ? fCos : 1.0f);
+}
+
+// sums gathered per row and reduced once all rows are done
+struct SRowSums
+{
+	double fSqErr, fSqAngle;
+	float fMaxErr, fMaxAngle;
+	int iNrClamped;
+};
+
+bool NormalMapToDerivMap(SCpuImage pDstMips[], const int iNrMips, SDerivMapStats * pStats, const SCpuImage &src,
+						 const float fScale, const float fKeepFraction, const int iNrBits, const int iNrThreads)
+{
+	memset(pStats, 0, sizeof(SDerivMapStats));
+	const int width = src.iWidth, height = src.iHeight;
+	if(width<=0 || height<=0 || iNrMips<=0 || iNrMips>GetNrMipLevels(width, height) || iNrBits<=0) return false;
+
+	// level 0 as derivatives
+	SCpuImage deriv;
+	if(!AllocCpuImage(&deriv, width, height)) return false;
+
+	std::vector<float> mags(width*height);
+	ParallelFor(height, iNrThreads, [&](const int y, const int threadIdx)
+	{
+		(void) threadIdx;
+		for(int x=0; x<width; x++)
+		{
+			float * pfDst = GetCpuImagePixel(deriv, x, y);
+			DerivFromNormalTexel(pfDst, GetCpuImagePixel(src, x, y));
+			pfDst[3] = 1.0f;
+			mags[y*width+x] = fmaxf(fabsf(pfDst[0]), fabsf(pfDst[1]));
+		}
+	});
+
+	float fScaleUsed = fScale;
+	if(fScaleUsed<=0.0f)
+	{
+		const float fKeep = fKeepFraction<0.0f ? 0.0f : (fKeepFraction>1.0f ? 1.0f : fKeepFraction);
+		const int n = (int) (fKeep*(mags.size()-1));
+		std::nth_element(mags.begin(), mags.begin()+n, mags.end());
+		fScaleUsed = mags[n]>1e-3f ? mags[n] : 1e-3f;
+	}
+	pStats->fScale = fScaleUsed;
+
+	// filtering derivatives is linear, unlike filtering normals
+	std::vector<SCpuImage> derivMips(iNrMips), nrmMips(iNrMips);
+	bool res = BuildMipChainWrap(&derivMips[0], deriv, iNrMips);
+	if(res) res = BuildMipChainWrap(&nrmMips[0], src, iNrMips);
+	FreeCpuImage(&deriv);
+
+	const float fMaxQ = (float) ((1<<(iNrBits<24 ? iNrBits : 24))-1);
+	double fSqMipDiff = 0.0;
+	int iNrMipTexels = 0;
+	for(int m=0; m<iNrMips && res; m++)
+	{
+		const SCpuImage &level = derivMips[m];
+		res = AllocCpuImage(&pDstMips[m], level.iWidth, level.iHeight);
+		if(!res) break;
+
+		std::vector<SRowSums> rows(level.iHeight);
+		std::vector<double> rowMipDiff(level.iHeight, 0.0);
+		ParallelFor(level.iHeight, iNrThreads, [&](const int y, const int threadIdx)
+		{
+			(void) threadIdx;
+			SRowSums &sums = rows[y];
+			memset(&sums, 0, sizeof(sums));
+			for(int x=0; x<level.iWidth; x++)
+			{
+				const float * pfDeriv = GetCpuImagePixel(level, x, y);
+				float * pfDst = GetCpuImagePixel(pDstMips[m], x, y);
+				pfDst[0] = Encode(pfDeriv[0], fScaleUsed);
+				pfDst[1] = Encode(pfDeriv[1], fScaleUsed);
+				pfDst[2] = 0.0f; pfDst[3] = 1.0f;
+
+				if(m==0)
+				{
+					// decode as the shader would after quantization
+					float dec[2];
+					for(int c=0; c<2; c++)
+						dec[c] = fScaleUsed*(2.0f*(floorf(pfDst[c]*fMaxQ+0.5f)/fMaxQ)-1.0f);
+
+					const float fErr = fmaxf(fabsf(dec[0]-pfDeriv[0]), fabsf(dec[1]-pfDeriv[1]));
+					const float fAngle = AngleBetweenDeg(dec, pfDeriv);
+					sums.fSqErr += fErr*fErr;
+					sums.fSqAngle += fAngle*fAngle;
+					if(fErr>sums.fMaxErr) sums.fMaxErr = fErr;
+					if(fAngle>sums.fMaxAngle) sums.fMaxAngle = fAngle;
+					if(fmaxf(fabsf(pfDeriv[0]), fabsf(pfDeriv[1]))>fScaleUsed) ++sums.iNrClamped;
+				}
+				else
+				{
+					float d[2];
+					DerivFromNormalTexel(d, GetCpuImagePixel(nrmMips[m], x, y));
+					rowMipDiff[y] += (d[0]-pfDeriv[0])*(d[0]-pfDeriv[0]) + (d[1]-pfDeriv[1])*(d[1]-pfDeriv[1]);
+				}
+			}
+		});
+
+		if(m==0)
+		{
+			double fSqErr = 0.0, fSqAngle = 0.0;
+			int iNrClamped = 0;
+			for(int y=0; y<level.iHeight; y++)
+			{
+				fSqErr += rows[y].fSqErr; fSqAngle += rows[y].fSqAngle;
+				iNrClamped += rows[y].iNrClamped;
+				pStats->fMaxErr = fmaxf(pStats->fMaxErr, rows[y].fMaxErr);
+				pStats->fMaxAngleErrDeg = fmaxf(pStats->fMaxAngleErrDeg, rows[y].fMaxAngle);
+			}
+
+			const int nrTexels = width*height;
+			pStats->fRmsErr = (float) sqrt(fSqErr / nrTexels);
+			pStats->fRmsAngleErrDeg = (float) sqrt(fSqAngle / nrTexels);
+			pStats->fClampedFraction = ((float) iNrClamped) / nrTexels;
+		}
+		else
+		{
+			for(int y=0; y<level.iHeight; y++) fSqMipDiff += rowMipDiff[y];
+			iNrMipTexels += level.iWidth*level.iHeight;
+		}
+	}
+
+	if(iNrMipTexels>0) pStats->fMipRmsDiff = (float) sqrt(fSqMipDiff / iNrMipTexels);
+
+	for(int m=0; m<iNrMips; m++)
+	{
+		FreeCpuImage(&derivMips[m]);
+		FreeCpuImage(&nrmMips[m]);
+	}
+
+	return res;
+}
+
+bool DerivMapTextureFile(const char dstName[], const wchar_t srcName[], SDerivMapStats * pStats,
+						 const float fScale, const int iNrThreads)
+{
+	SCpuImage src;
+	bool res = LoadCpuImage(&src, srcName, false);
+
+	const int iNrMips = res ? GetNrMipLevels(src.iWidth, src.iHeight) : 0;
+	std::vector<SCpuImage> dstMips(iNrMips);
+
+	if(res) res = NormalMapToDerivMap(&dstMips[0], iNrMips, pStats, src, fScale, 0.999f, 8, iNrThreads);
+	if(res) res = SaveCpuImageDDS(dstName, &dstMips[0], iNrMips);
+
+	for(int m=0; m<iNrMips; m++) FreeCpuImage(&dstMips[m]);
+	if(iNrMips>0) FreeCpuImage(&src);
+
+	return res;
+}
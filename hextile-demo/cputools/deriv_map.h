@@ -0,0 +1,45 @@
+#ifndef __DERIVMAP_H__
+#define __DERIVMAP_H__
+
+#include "cpu_image.h"
+
+// Offline conversion of tangent space normal maps into two channel
+// derivative maps such that the shader gets dHduv from a single fetch
+// without the divide of TspaceNormalToDerivative() per tap.
+
+// port of TspaceNormalToDerivative() in surfgrad_framework.h, vM in [-1;1]
+void TspaceNormalToDerivative(float deriv[], const float vM[]);
+
+struct SDerivMapStats
+{
+	float fScale;				// derivative of the texel value 1.0 (0.0 is -fScale)
+	float fClampedFraction;		// fraction of texels at level 0 beyond fScale
+
+	// difference between the decoded derivative and the exact one at level 0,
+	// including clamping and quantization to iNrBits per channel. BC5 adds
+	// block compression error on top of this.
+	float fMaxErr, fRmsErr;
+	float fMaxAngleErrDeg, fRmsAngleErrDeg;		// same, as angle between the resulting normals
+
+	// rms difference over levels 1 and up between mips filtered in derivative
+	// space and those of the normal map converted after filtering, which is
+	// what the regular normal map path does.
+	float fMipRmsDiff;
+};
+
+// src is a normal map as read (rgb in [0;1]). pDstMips[] receives iNrMips levels,
+// at most GetNrMipLevels() of src, box filtered in derivative space.
+// Texels store 0.5+0.5*deriv/fScale in rg such that the map can be stored
+// as R8G8_UNORM or BC5_UNORM and is decoded using fScale*(2*rg-1). fScale<=0
+// picks the smallest scale which keeps fKeepFraction of the texels at level
+// 0 unclamped, trading a few outliers for precision everywhere else.
+bool NormalMapToDerivMap(SCpuImage pDstMips[], const int iNrMips, SDerivMapStats * pStats, const SCpuImage &src,
+						 const float fScale=0.0f, const float fKeepFraction=0.999f, const int iNrBits=8, const int iNrThreads=0);
+
+// loads the normal map, converts it with a full mip chain and saves it as a
+// dds. See hextile-tool in tools/ for the command line.
+bool DerivMapTextureFile(const char dstName[], const wchar_t srcName[], SDerivMapStats * pStats,
+						 const float fScale=0.0f, const int iNrThreads=0);
+
+
+#endif
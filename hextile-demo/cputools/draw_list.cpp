@@ -0,0 +1,107 @@
+#include "draw_list.h"
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+
+
+unsigned long long MakeDrawKey(const int iPipeline, const int iMaterial, const int iMesh, const float fDepth)
+{
+	// positive floats order as their bits
+	unsigned int uDepthBits = 0;
+	if(fDepth>0.0f) memcpy(&uDepthBits, &fDepth, sizeof(uDepthBits));
+	const unsigned long long uDepth = uDepthBits >> (31-DRAW_KEY_DEPTH_BITS);
+
+	const unsigned long long uPipeline = ((unsigned long long) iPipeline) & ((1ull<<DRAW_KEY_PIPELINE_BITS)-1);
+	const unsigned long long uMaterial = ((unsigned long long) iMaterial) & ((1ull<<DRAW_KEY_MATERIAL_BITS)-1);
+	const unsigned long long uMesh = ((unsigned long long) iMesh) & ((1ull<<DRAW_KEY_MESH_BITS)-1);
+
+	return (uPipeline<<(DRAW_KEY_MATERIAL_BITS+DRAW_KEY_MESH_BITS+DRAW_KEY_DEPTH_BITS)) |
+		   (uMaterial<<(DRAW_KEY_MESH_BITS+DRAW_KEY_DEPTH_BITS)) | (uMesh<<DRAW_KEY_DEPTH_BITS) | uDepth;
+}
+
+void SortDrawItems(std::vector<SDrawItem> &items, std::vector<SDrawItem> &scratch)
+{
+	const int iNrItems = (int) items.size();
+	if(iNrItems<2) return;
+	scratch.resize(iNrItems);
+
+	// least significant byte first, every histogram in one pass
+	static const int iNrPasses = 8;
+	int iCounts[iNrPasses][256];
+	memset(iCounts, 0, sizeof(iCounts));
+	for(int i=0; i<iNrItems; i++)
+		for(int p=0; p<iNrPasses; p++)
+			++iCounts[p][(items[i].uKey>>(8*p))&0xff];
+
+	SDrawItem * pSrc = &items[0], * pDst = &scratch[0];
+	for(int p=0; p<iNrPasses; p++)
+	{
+		// skip the bytes every key shares
+		const int iFirstDigit = (int) ((pSrc[0].uKey>>(8*p))&0xff);
+		if(iCounts[p][iFirstDigit]==iNrItems) continue;
+
+		int iOffs[256], iSum = 0;
+		for(int d=0; d<256; d++) { iOffs[d] = iSum; iSum += iCounts[p][d]; }
+		for(int i=0; i<iNrItems; i++)
+			pDst[iOffs[(pSrc[i].uKey>>(8*p))&0xff]++] = pSrc[i];
+
+		std::swap(pSrc, pDst);
+	}
+
+	if(pSrc!=&items[0]) items.swap(scratch);
+}
+
+
+static const char g_cUnknownState = 0;
+
+void ResetDrawStateCache(SDrawStateCache * pCache)
+{
+	memset(pCache, 0, sizeof(SDrawStateCache));
+	for(int s=0; s<DRAW_STATE_NUM_STAGES; s++) pCache->pShaders[s] = &g_cUnknownState;
+	for(int i=0; i<NUM_DRAW_STATE_INPUTS; i++) pCache->pInputs[i] = &g_cUnknownState;
+}
+
+bool UpdateDrawStateShader(SDrawStateCache * pCache, const int iStage, const void * pShader)
+{
+	if(pCache->pShaders[iStage]==pShader) { ++pCache->iNrRedundant; return false; }
+
+	pCache->pShaders[iStage] = pShader;
+	++pCache->iNrCalls;
+	return true;
+}
+
+bool UpdateDrawStateInput(SDrawStateCache * pCache, const DRAW_STATE_INPUT eInput, const void * pValue)
+{
+	if(pCache->pInputs[eInput]==pValue) { ++pCache->iNrRedundant; return false; }
+
+	pCache->pInputs[eInput] = pValue;
+	++pCache->iNrCalls;
+	return true;
+}
+
+int UpdateDrawStateSlots(int * piFirst, SDrawStateCache * pCache, const int iStage, const DRAW_STATE_SLOT_KIND eKind, const void * const ppList[], const int iNr)
+{
+	assert(iNr<=DRAW_STATE_MAX_SLOTS);
+	const void ** ppBound = pCache->pSlots[iStage][eKind];
+
+	int iFirst = -1, iLast = -1;
+	for(int s=0; s<iNr && s<DRAW_STATE_MAX_SLOTS; s++)
+		if(ppBound[s]!=ppList[s])
+		{
+			if(iFirst<0) iFirst = s;
+			iLast = s;
+			ppBound[s] = ppList[s];
+		}
+
+	*piFirst = iFirst<0 ? 0 : iFirst;
+	if(iFirst<0)
+	{
+		if(iNr>0) ++pCache->iNrRedundant;
+		return 0;
+	}
+
+	int &iNrUsed = pCache->iNrSlotsUsed[iStage][eKind];
+	iNrUsed = std::max(iNrUsed, iLast+1);
+	++pCache->iNrCalls;
+	return iLast-iFirst+1;
+}
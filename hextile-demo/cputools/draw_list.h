@@ -0,0 +1,94 @@
+#ifndef __DRAWLIST_H__
+#define __DRAWLIST_H__
+
+#include <vector>
+#include <stddef.h>
+
+// Ordering of the draws of a pass and a record of the state bound on the
+// device such that only bindings which differ from the previous draw are
+// issued. Draws are sorted by a packed 64 bit key, the pipeline in the top
+// bits followed by the material, the mesh and the depth along the pass's
+// view, the camera's or the light's, so draws sharing shaders and resources
+// are adjacent and opaque draws of the same state go front to back. Nothing
+// here touches the device, see CShaderPipeline::RecordPipelineForRendering()
+// for the pipeline side.
+
+#define DRAW_KEY_PIPELINE_BITS		10
+#define DRAW_KEY_MATERIAL_BITS		14
+#define DRAW_KEY_MESH_BITS			16
+#define DRAW_KEY_DEPTH_BITS			24
+
+struct SDrawItem
+{
+	unsigned long long uKey;
+	int iIndex;									// of the draw in the caller's list
+	int iPad;
+};
+
+// the depth is clamped to 0 and keeps its order as the upper bits of
+// the float
+unsigned long long MakeDrawKey(const int iPipeline, const int iMaterial, const int iMesh, const float fDepth);
+
+// ascending keys, equal keys keep their order. scratch is resized as needed.
+void SortDrawItems(std::vector<SDrawItem> &items, std::vector<SDrawItem> &scratch);
+
+
+// bound state, per shader stage the shader and the slots of each kind
+#define DRAW_STATE_NUM_STAGES		5			// vertex, hull, domain, geometry and pixel
+#define DRAW_STATE_MAX_SLOTS		64
+
+enum DRAW_STATE_SLOT_KIND
+{
+	DRAW_STATE_CBUFFERS=0,
+	DRAW_STATE_SAMPLERS,
+	DRAW_STATE_SRVS,
+
+	NUM_DRAW_STATE_SLOT_KINDS
+};
+
+enum DRAW_STATE_INPUT
+{
+	DRAW_STATE_VERTEX_BUFFER=0,
+	DRAW_STATE_INDEX_BUFFER,
+	DRAW_STATE_INPUT_LAYOUT,
+	DRAW_STATE_TOPOLOGY,
+
+	NUM_DRAW_STATE_INPUTS
+};
+
+struct SDrawStateCache
+{
+	const void * pShaders[DRAW_STATE_NUM_STAGES];
+	const void * pSlots[DRAW_STATE_NUM_STAGES][NUM_DRAW_STATE_SLOT_KINDS][DRAW_STATE_MAX_SLOTS];
+	int iNrSlotsUsed[DRAW_STATE_NUM_STAGES][NUM_DRAW_STATE_SLOT_KINDS];		// since the reset
+	const void * pInputs[NUM_DRAW_STATE_INPUTS];
+
+	int iNrCalls;								// issued since the reset
+	int iNrRedundant;							// skipped since the reset
+};
+
+// the shaders and the input state are unknown after a reset and are set
+// by the first update, the slots are taken to be empty
+void ResetDrawStateCache(SDrawStateCache * pCache);
+
+// record the binding and return true when the call must be issued
+bool UpdateDrawStateShader(SDrawStateCache * pCache, const int iStage, const void * pShader);
+bool UpdateDrawStateInput(SDrawStateCache * pCache, const DRAW_STATE_INPUT eInput, const void * pValue);
+
+// binds ppList[] at slots 0 to iNr-1. Returns the number of slots to set
+// from *piFirst on, the smallest range which covers every change, or 0.
+int UpdateDrawStateSlots(int * piFirst, SDrawStateCache * pCache, const int iStage, const DRAW_STATE_SLOT_KIND eKind, const void * const ppList[], const int iNr);
+
+
+// per frame, the calls include binding, updating the per draw constants
+// and the draws themselves
+struct SDrawSubmitStats
+{
+	int iNrDraws;
+	int iNrCalls;
+	int iNrCallsWithoutDiffing;					// binding everything per draw and unbinding after
+	int iNrCommandLists;						// recorded in parallel, see command_list.h
+};
+
+
+#endif
@@ -0,0 +1,375 @@
+#include "hextile_baker.h"
+#include "hextiling_cpu.h"
+#include "deriv_map.h"
+#include "parallel_for.h"
+#include <meshimport/objreader.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#define BAKE_TILE_SIZE		64
+#define BAKE_MAX_BATCH		(BAKE_TILE_SIZE*BAKE_TILE_SIZE)
+
+
+void InitHexBakeParams(SHexBakeParams * pParams, const EHexBakeMode eMode)
+{
+	pParams->eMode = eMode;
+	pParams->fTileRate = 8.0f;
+	pParams->fRotStrength = 1.0f;
+	pParams->fFallOffContrast = 0.6f;
+	pParams->fExp = 7.0f;
+	pParams->fFakeContrast = 0.5f;
+	pParams->iNrThreads = 0;
+	pParams->iGutter = 4;
+}
+
+// per thread scratch memory for a batch of up to BAKE_MAX_BATCH texels
+struct SBakeScratch
+{
+	SHexTileCoordsSoA coords;
+	float pfS[BAKE_MAX_BATCH], pfT[BAKE_MAX_BATCH];
+	float pfGrad[4][BAKE_MAX_BATCH];		// dSTdx.xy, dSTdy.xy
+	float pfCol[3][4*BAKE_MAX_BATCH];
+	float pfDw[3][BAKE_MAX_BATCH], pfW[3][BAKE_MAX_BATCH];
+	int piDstIdx[BAKE_MAX_BATCH];
+};
+
+// evaluates hex2colTex() or bumphex2derivNMap() for the N entries in the
+// scratch and writes the results as RGBA to pDst at piDstIdx[].
+static void EvaluateHexBatch(SCpuImage * pDst, SBakeScratch * pScratch, const int N,
+							 const SCpuImage pSrcMips[], const int iNrSrcMips, const SHexBakeParams &params)
+{
+	const bool bIsDeriv = params.eMode==HEXBAKE_DERIV_FROM_NMAP;
+	const SHexTileCoordsSoA &coords = pScratch->coords;
+
+	HexTileCoordsBatch(&pScratch->coords, pScratch->pfS, pScratch->pfT, N, params.fRotStrength);
+
+	for(int k=0; k<3; k++)
+	{
+		for(int i=0; i<N; i++)
+		{
+			const float cs = coords.pfRotCs[k][i], si = coords.pfRotSi[k][i];
+			const float dx[] = { pScratch->pfGrad[0][i], pScratch->pfGrad[1][i] };
+			const float dy[] = { pScratch->pfGrad[2][i], pScratch->pfGrad[3][i] };
+
+			// mul(dSTdx, rot) and mul(dSTdy, rot)
+			const float st[] = { coords.pfS[k][i], coords.pfT[k][i] };
+			const float dSTdx[] = { dx[0]*cs + dx[1]*si, dx[0]*(-si) + dx[1]*cs };
+			const float dSTdy[] = { dy[0]*cs + dy[1]*si, dy[0]*(-si) + dy[1]*cs };
+
+			float * col = &pScratch->pfCol[k][4*i];
+			SampleGradWrap(col, pSrcMips, iNrSrcMips, st, dSTdx, dSTdy);
+
+			if(bIsDeriv)
+			{
+				const float vM[] = { 2.0f*col[0]-1.0f, 2.0f*col[1]-1.0f, 2.0f*col[2]-1.0f };
+				float d[2];
+				TspaceNormalToDerivative(d, vM);
+
+				// mul(rot, d)
+				col[0] = cs*d[0] + (-si)*d[1];
+				col[1] = si*d[0] + cs*d[1];
+				col[2] = 0.0f; col[3] = 1.0f;
+
+				pScratch->pfDw[k][i] = HexTileDwFromDeriv(col);
+			}
+			else
+			{
+				pScratch->pfDw[k][i] = HexTileDwFromColor(col);
+			}
+		}
+	}
+
+	float * pfW[] = { pScratch->pfW[0], pScratch->pfW[1], pScratch->pfW[2] };
+	const float * const pfDw[] = { pScratch->pfDw[0], pScratch->pfDw[1], pScratch->pfDw[2] };
+	HexTileWeightsBatch(pfW, NULL, coords, pfDw, N, params.fFallOffContrast, params.fExp, params.fFakeContrast);
+
+	for(int i=0; i<N; i++)
+	{
+		float * pOut = pDst->pfPixels + 4*pScratch->piDstIdx[i];
+		for(int c=0; c<4; c++)
+			pOut[c] = pfW[0][i]*pScratch->pfCol[0][4*i+c] + pfW[1][i]*pScratch->pfCol[1][4*i+c] + pfW[2][i]*pScratch->pfCol[2][4*i+c];
+	}
+}
+
+static bool AllocScratch(std::vector<SBakeScratch *> * pScratch, const int nrThreads)
+{
+	bool res = true;
+	for(int t=0; t<nrThreads && res; t++)
+	{
+		SBakeScratch * pS = new SBakeScratch;
+		res = pS!=NULL && AllocHexTileCoords(&pS->coords, BAKE_MAX_BATCH);
+		pScratch->push_back(pS);
+	}
+
+	return res;
+}
+
+static void FreeScratch(std::vector<SBakeScratch *> * pScratch)
+{
+	for(size_t t=0; t<pScratch->size(); t++)
+	{
+		if((*pScratch)[t]!=NULL)
+		{
+			FreeHexTileCoords(&(*pScratch)[t]->coords);
+			delete (*pScratch)[t];
+		}
+	}
+	pScratch->clear();
+}
+
+
+bool HexBakePlane(SCpuImage pDstMips[], const int iNrMips, const int width, const int height,
+				  const SCpuImage pSrcMips[], const int iNrSrcMips, const SHexBakeParams &params)
+{
+	const int nrThreads = params.iNrThreads>0 ? params.iNrThreads : GetDefaultNrThreads();
+	std::vector<SBakeScratch *> scratch;
+	bool res = AllocScratch(&scratch, nrThreads);
+
+	for(int m=0; m<iNrMips && res; m++)
+	{
+		const int w = (width>>m)>0 ? (width>>m) : 1;
+		const int h = (height>>m)>0 ? (height>>m) : 1;
+		res = AllocCpuImage(&pDstMips[m], w, h);
+
+		// the footprint of one texel of this mip level
+		const float fStepS = params.fTileRate / w, fStepT = params.fTileRate / h;
+		const int nrTilesX = (w+BAKE_TILE_SIZE-1)/BAKE_TILE_SIZE;
+		const int nrTilesY = (h+BAKE_TILE_SIZE-1)/BAKE_TILE_SIZE;
+
+		if(res) ParallelFor(nrTilesX*nrTilesY, nrThreads, [&](const int tile, const int threadIdx)
+		{
+			SBakeScratch * pS = scratch[threadIdx];
+			const int x0 = (tile%nrTilesX)*BAKE_TILE_SIZE, y0 = (tile/nrTilesX)*BAKE_TILE_SIZE;
+			const int x1 = (x0+BAKE_TILE_SIZE)<w ? (x0+BAKE_TILE_SIZE) : w;
+			const int y1 = (y0+BAKE_TILE_SIZE)<h ? (y0+BAKE_TILE_SIZE) : h;
+
+			int N = 0;
+			for(int y=y0; y<y1; y++)
+				for(int x=x0; x<x1; x++)
+				{
+					pS->pfS[N] = (x+0.5f)*fStepS; pS->pfT[N] = (y+0.5f)*fStepT;
+					pS->pfGrad[0][N] = fStepS; pS->pfGrad[1][N] = 0.0f;
+					pS->pfGrad[2][N] = 0.0f; pS->pfGrad[3][N] = fStepT;
+					pS->piDstIdx[N] = y*w + x;
+					++N;
+				}
+
+			EvaluateHexBatch(&pDstMips[m], pS, N, pSrcMips, iNrSrcMips, params);
+		});
+	}
+
+	FreeScratch(&scratch);
+
+	return res;
+}
+
+
+struct SAtlasTriangle
+{
+	float vP[3][2];		// position in atlas texels
+	float vST[3][2];	// st at the vertices
+	float fBBox[4];		// min x, min y, max x, max y
+};
+
+static void DilateAtlas(SCpuImage * pDst, unsigned char * pbCovered, const int iNrPasses)
+{
+	const int w = pDst->iWidth, h = pDst->iHeight;
+	std::vector<unsigned char> coveredNext(pbCovered, pbCovered + w*h);
+
+	for(int pass=0; pass<iNrPasses; pass++)
+	{
+		for(int y=0; y<h; y++)
+			for(int x=0; x<w; x++)
+			{
+				if(pbCovered[y*w+x]!=0) continue;
+
+				float sum[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				int nrNeighbors = 0;
+				for(int dy=-1; dy<=1; dy++)
+					for(int dx=-1; dx<=1; dx++)
+					{
+						const int nx = x+dx, ny = y+dy;
+						if(nx>=0 && nx<w && ny>=0 && ny<h && pbCovered[ny*w+nx]!=0)
+						{
+							const float * pSrc = GetCpuImagePixel(*pDst, nx, ny);
+							for(int c=0; c<4; c++) sum[c] += pSrc[c];
+							++nrNeighbors;
+						}
+					}
+
+				if(nrNeighbors>0)
+				{
+					float * pOut = GetCpuImagePixel(*pDst, x, y);
+					for(int c=0; c<4; c++) pOut[c] = sum[c] / nrNeighbors;
+					coveredNext[y*w+x] = 1;
+				}
+			}
+
+		memcpy(pbCovered, &coveredNext[0], w*h);
+	}
+}
+
+bool HexBakeMeshAtlas(SCpuImage * pDst, const int width, const int height, const CObjReader &mesh,
+					  const SCpuImage pSrcMips[], const int iNrSrcMips, const SHexBakeParams &params)
+{
+	if(!mesh.HaveSecondaryUVs()) return false;
+
+	// fan triangulate faces and set up the map from atlas texels to st
+	std::vector<SAtlasTriangle> triangles;
+	for(int f=0; f<mesh.GetNumFaces(); f++)
+	{
+		const int nrVerts = mesh.GetNrFaceVertices(f);
+		for(int t=0; t<(nrVerts-2); t++)
+		{
+			const int idx[] = { 0, t+1, t+2 };
+
+			SAtlasTriangle tri;
+			for(int i=0; i<3; i++)
+			{
+				const Vec3 vAtlas = mesh.GetFaceTexCoord2(f, idx[i]);
+				const Vec3 vUV = mesh.GetFaceTexCoord(f, idx[i]);
+				tri.vP[i][0] = vAtlas.x*width; tri.vP[i][1] = vAtlas.y*height;
+				tri.vST[i][0] = vUV.x*params.fTileRate; tri.vST[i][1] = vUV.y*params.fTileRate;
+			}
+
+			tri.fBBox[0] = fminf(tri.vP[0][0], fminf(tri.vP[1][0], tri.vP[2][0]));
+			tri.fBBox[1] = fminf(tri.vP[0][1], fminf(tri.vP[1][1], tri.vP[2][1]));
+			tri.fBBox[2] = fmaxf(tri.vP[0][0], fmaxf(tri.vP[1][0], tri.vP[2][0]));
+			tri.fBBox[3] = fmaxf(tri.vP[0][1], fmaxf(tri.vP[1][1], tri.vP[2][1]));
+			triangles.push_back(tri);
+		}
+	}
+
+	const int nrThreads = params.iNrThreads>0 ? params.iNrThreads : GetDefaultNrThreads();
+	std::vector<SBakeScratch *> scratch;
+	bool res = AllocScratch(&scratch, nrThreads) && AllocCpuImage(pDst, width, height);
+	std::vector<unsigned char> covered(width*height, 0);
+
+	const int nrTilesX = (width+BAKE_TILE_SIZE-1)/BAKE_TILE_SIZE;
+	const int nrTilesY = (height+BAKE_TILE_SIZE-1)/BAKE_TILE_SIZE;
+	const int nrTriangles = (int) triangles.size();
+
+	if(res) ParallelFor(nrTilesX*nrTilesY, nrThreads, [&](const int tile, const int threadIdx)
+	{
+		SBakeScratch * pS = scratch[threadIdx];
+		const int x0 = (tile%nrTilesX)*BAKE_TILE_SIZE, y0 = (tile/nrTilesX)*BAKE_TILE_SIZE;
+		const int x1 = (x0+BAKE_TILE_SIZE)<width ? (x0+BAKE_TILE_SIZE) : width;
+		const int y1 = (y0+BAKE_TILE_SIZE)<height ? (y0+BAKE_TILE_SIZE) : height;
+
+		// texels are owned by this tile so the coverage mask
+		// is written without synchronization.
+		int N = 0;
+		for(int t=0; t<nrTriangles; t++)
+		{
+			const SAtlasTriangle &tri = triangles[t];
+			if(tri.fBBox[2]<x0 || tri.fBBox[0]>x1 || tri.fBBox[3]<y0 || tri.fBBox[1]>y1) continue;
+
+			const float e1[] = { tri.vP[1][0]-tri.vP[0][0], tri.vP[1][1]-tri.vP[0][1] };
+			const float e2[] = { tri.vP[2][0]-tri.vP[0][0], tri.vP[2][1]-tri.vP[0][1] };
+			const float fDet = e1[0]*e2[1] - e1[1]*e2[0];
+			if(fabsf(fDet)<1e-12f) continue;
+			const float fInvDet = 1.0f / fDet;
+
+			// gradient of st per atlas texel, constant across the triangle
+			const float dST1[] = { tri.vST[1][0]-tri.vST[0][0], tri.vST[1][1]-tri.vST[0][1] };
+			const float dST2[] = { tri.vST[2][0]-tri.vST[0][0], tri.vST[2][1]-tri.vST[0][1] };
+			const float dSTdx[] = { (dST1[0]*e2[1] - dST2[0]*e1[1])*fInvDet, (dST1[1]*e2[1] - dST2[1]*e1[1])*fInvDet };
+			const float dSTdy[] = { (dST2[0]*e1[0] - dST1[0]*e2[0])*fInvDet, (dST2[1]*e1[0] - dST1[1]*e2[0])*fInvDet };
+
+			const int iMinX = (int) fmaxf((float) x0, floorf(tri.fBBox[0]));
+			const int iMinY = (int) fmaxf((float) y0, floorf(tri.fBBox[1]));
+			const int iMaxX = (int) fminf((float) (x1-1), ceilf(tri.fBBox[2]));
+			const int iMaxY = (int) fminf((float) (y1-1), ceilf(tri.fBBox[3]));
+
+			for(int y=iMinY; y<=iMaxY; y++)
+				for(int x=iMinX; x<=iMaxX; x++)
+				{
+					if(covered[y*width+x]!=0) continue;
+
+					// barycentric coordinates of the texel center
+					const float px = (x+0.5f)-tri.vP[0][0], py = (y+0.5f)-tri.vP[0][1];
+					const float b1 = (px*e2[1] - py*e2[0])*fInvDet;
+					const float b2 = (e1[0]*py - e1[1]*px)*fInvDet;
+					if(b1<0.0f || b2<0.0f || (b1+b2)>1.0f) continue;
+
+					covered[y*width+x] = 1;
+					pS->pfS[N] = tri.vST[0][0] + b1*dST1[0] + b2*dST2[0];
+					pS->pfT[N] = tri.vST[0][1] + b1*dST1[1] + b2*dST2[1];
+					pS->pfGrad[0][N] = dSTdx[0]; pS->pfGrad[1][N] = dSTdx[1];
+					pS->pfGrad[2][N] = dSTdy[0]; pS->pfGrad[3][N] = dSTdy[1];
+					pS->piDstIdx[N] = y*width + x;
+					++N;
+				}
+		}
+
+		EvaluateHexBatch(pDst, pS, N, pSrcMips, iNrSrcMips, params);
+	});
+
+	if(res) DilateAtlas(pDst, &covered[0], params.iGutter);
+
+	FreeScratch(&scratch);
+
+	return res;
+}
+
+
+// the source and its mip chain, see BuildMipChainWrap()
+static bool LoadBakeSourceMips(std::vector<SCpuImage> &srcMips, const wchar_t srcName[], const bool sRGB)
+{
+	SCpuImage src;
+	bool res = LoadCpuImage(&src, srcName, sRGB);
+	if(res)
+	{
+		srcMips.resize(GetNrMipLevels(src.iWidth, src.iHeight));
+		res = BuildMipChainWrap(&srcMips[0], src, (int) srcMips.size());
+		FreeCpuImage(&src);
+	}
+
+	return res;
+}
+
+static void FreeBakeMips(std::vector<SCpuImage> &mips)
+{
+	for(size_t m=0; m<mips.size(); m++)
+		if(mips[m].pfPixels!=NULL) FreeCpuImage(&mips[m]);
+	mips.clear();
+}
+
+bool HexBakeTextureFile(const char dstName[], const wchar_t srcName[], const bool sRGB,
+						const int width, const int height, const SHexBakeParams &params)
+{
+	std::vector<SCpuImage> srcMips;
+	bool res = LoadBakeSourceMips(srcMips, srcName, sRGB && params.eMode==HEXBAKE_COLOR);
+
+	const int iNrMips = GetNrMipLevels(width, height);
+	std::vector<SCpuImage> dstMips(iNrMips);
+
+	if(res) res = HexBakePlane(&dstMips[0], iNrMips, width, height, &srcMips[0], (int) srcMips.size(), params);
+	if(res) res = SaveCpuImageDDS(dstName, &dstMips[0], iNrMips);
+
+	FreeBakeMips(dstMips);
+	FreeBakeMips(srcMips);
+
+	return res;
+}
+
+bool HexBakeMeshAtlasFile(const char dstName[], const wchar_t srcName[], const bool sRGB, const char meshName[],
+						  const int width, const int height, const SHexBakeParams &params)
+{
+	CObjReader mesh;
+	bool res = mesh.ReadFile(meshName) && mesh.HaveSecondaryUVs();
+
+	std::vector<SCpuImage> srcMips;
+	if(res) res = LoadBakeSourceMips(srcMips, srcName, sRGB && params.eMode==HEXBAKE_COLOR);
+
+	SCpuImage dst;
+	dst.pfPixels = NULL;
+	if(res) res = HexBakeMeshAtlas(&dst, width, height, mesh, &srcMips[0], (int) srcMips.size(), params);
+	if(res) res = SaveCpuImageDDS(dstName, &dst, 1);
+
+	if(dst.pfPixels!=NULL) FreeCpuImage(&dst);
+	FreeBakeMips(srcMips);
+
+	return res;
+}
@@ -0,0 +1,57 @@
+#ifndef __HEXTILEBAKER_H__
+#define __HEXTILEBAKER_H__
+
+#include "cpu_image.h"
+
+class CObjReader;
+
+// Offline version of hex2colTex() and bumphex2derivNMap() for targets that
+// cannot afford three SampleGrad() per pixel. The result is a single non
+// repeating texture, or a uv mapped atlas for a mesh, which reproduces what
+// the shader would output for the same tile rate and parameters.
+
+enum EHexBakeMode
+{
+	HEXBAKE_COLOR=0,			// hex2colTex(), outputs the blended color
+	HEXBAKE_DERIV_FROM_NMAP		// bumphex2derivNMap(), outputs the derivative in xy
+};
+
+struct SHexBakeParams
+{
+	EHexBakeMode eMode;
+	float fTileRate;			// number of source repetitions across the baked texture (or per uv unit for atlas)
+	float fRotStrength;			// g_rotStrength
+	float fFallOffContrast;		// g_fallOffContrast
+	float fExp;					// g_exp
+	float fFakeContrast;		// r passed to hex2colTex() or bumphex2derivNMap()
+	int iNrThreads;				// <=0 uses all hardware threads
+	int iGutter;				// atlas only, nr of texels to dilate charts by
+};
+
+void InitHexBakeParams(SHexBakeParams * pParams, const EHexBakeMode eMode);
+
+// The source is a tileable texture as a mip chain (see BuildMipChainWrap).
+// pDstMips[] receives iNrMips levels starting at width x height. Each level
+// is baked with its own pixel footprint rather than by downsampling level 0
+// since the hex blend is not a linear function of the source.
+bool HexBakePlane(SCpuImage pDstMips[], const int iNrMips, const int width, const int height,
+				  const SCpuImage pSrcMips[], const int iNrSrcMips, const SHexBakeParams &params);
+
+// Bakes into the layout given by the secondary uv set of the mesh (the
+// atlas) while the primary uv set, scaled by fTileRate, is the st of the
+// shader. Texels not covered by any chart remain zero after dilation.
+bool HexBakeMeshAtlas(SCpuImage * pDst, const int width, const int height, const CObjReader &mesh,
+					  const SCpuImage pSrcMips[], const int iNrSrcMips, const SHexBakeParams &params);
+
+// loads the source, bakes the plane with a full mip chain and saves it as a
+// dds. See hextile-tool in tools/ for the command line.
+bool HexBakeTextureFile(const char dstName[], const wchar_t srcName[], const bool sRGB,
+						const int width, const int height, const SHexBakeParams &params);
+
+// loads the source and the obj mesh, which must have #vt2 secondary uvs, and
+// saves the atlas as a dds. No mips since a box filter would bleed across charts.
+bool HexBakeMeshAtlasFile(const char dstName[], const wchar_t srcName[], const bool sRGB, const char meshName[],
+						  const int width, const int height, const SHexBakeParams &params);
+
+
+#endif
@@ -0,0 +1,196 @@
+#include "hextile_lod.h"
+#include "hextiling_cpu.h"
+#include "parallel_for.h"
+#include <geommath/geommath.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+// shader lod as returned by HexLodFallbackWeight(), isotropic like SampleGradWrap()
+static float FootprintLod(const float dSTdx[], const float dSTdy[], const float texSize)
+{
+	const float lenX2 = (dSTdx[0]*dSTdx[0] + dSTdx[1]*dSTdx[1])*texSize*texSize;
+	const float lenY2 = (dSTdy[0]*dSTdy[0] + dSTdy[1]*dSTdy[1])*texSize*texSize;
+
+	return 0.5f*log2f(lenX2>lenY2 ? lenX2 : lenY2);
+}
+
+static float FallbackWeight(const float lod, const int iNrLevels, const float fallbackStart, const float fallbackRange)
+{
+	const float t = (lod - ((iNrLevels-1) - fallbackStart)) / fallbackRange;
+	return t<0.0f ? 0.0f : (t>1.0f ? 1.0f : t);
+}
+
+// row vector times float2x2(cs, -si, si, cs) as mul(dSTdx, rot) in the shader
+static inline void MulRowRot(float res[], const float v[], const float cs, const float si)
+{
+	res[0] = v[0]*cs + v[1]*si;
+	res[1] = -v[0]*si + v[1]*cs;
+}
+
+static bool ErrorAtLevel(SHexLodError * pErr, const SCpuImage pMips[], const int iNrMips, const int iLevel, const float rotStrength,
+						 const int N, const float fallOffContrast, const float fExp)
+{
+	SHexTileCoordsSoA coords;
+	if(!AllocHexTileCoords(&coords, N)) return false;
+
+	std::vector<float> S(N), T(N), W(3*N), Dw(3*N), C(3*4*N);
+
+	// st spread over many cells, fixed seed such that results are repeatable
+	unsigned int uSeed = 0x9e3779b9u ^ (unsigned int) iLevel;
+	for(int i=0; i<N; i++)
+	{
+		uSeed = uSeed*1664525u + 1013904223u; S[i] = 16.0f*((uSeed>>8) / 16777216.0f);
+		uSeed = uSeed*1664525u + 1013904223u; T[i] = 16.0f*((uSeed>>8) / 16777216.0f);
+	}
+
+	const float fFootprint = (float) (1<<iLevel);
+	const float dSTdx[] = {fFootprint/pMips[0].iWidth, 0.0f};
+	const float dSTdy[] = {0.0f, fFootprint/pMips[0].iHeight};
+
+	HexTileCoordsBatch(&coords, &S[0], &T[0], N, rotStrength);
+
+	for(int j=0; j<3; j++)
+		for(int i=0; i<N; i++)
+		{
+			const float cs = coords.pfRotCs[j][i], si = coords.pfRotSi[j][i];
+			float dSTdxRot[2], dSTdyRot[2];
+			MulRowRot(dSTdxRot, dSTdx, cs, si);
+			MulRowRot(dSTdyRot, dSTdy, cs, si);
+
+			const float st[] = {coords.pfS[j][i], coords.pfT[j][i]};
+			float * pfCol = &C[4*(j*N+i)];
+			SampleGradWrap(pfCol, pMips, iNrMips, st, dSTdxRot, dSTdyRot);
+			Dw[j*N+i] = HexTileDwFromColor(pfCol);
+		}
+
+	float * pfW[] = {&W[0], &W[N], &W[2*N]};
+	const float * const pfDw[] = {&Dw[0], &Dw[N], &Dw[2*N]};
+	HexTileWeightsBatch(pfW, NULL, coords, pfDw, N, fallOffContrast, fExp);
+
+	double fSumSq = 0.0;
+	float fMaxErr = 0.0f;
+	for(int i=0; i<N; i++)
+	{
+		const float st[] = {S[i], T[i]};
+		float single[4];
+		SampleGradWrap(single, pMips, iNrMips, st, dSTdx, dSTdy);
+
+		float fErr = 0.0f;
+		for(int c=0; c<3; c++)
+		{
+			const float blend = pfW[0][i]*C[4*i+c] + pfW[1][i]*C[4*(N+i)+c] + pfW[2][i]*C[4*(2*N+i)+c];
+			const float diff = fabsf(blend - single[c]);
+			if(diff>fErr) fErr = diff;
+		}
+
+		fSumSq += fErr*fErr;
+		if(fErr>fMaxErr) fMaxErr = fErr;
+	}
+
+	pErr->fMaxErr = fMaxErr;
+	pErr->fRmsErr = (float) sqrt(fSumSq/N);
+
+	FreeHexTileCoords(&coords);
+
+	return true;
+}
+
+bool HexLodErrorPerLevel(SHexLodError pErr[], const SCpuImage pMips[], const int iNrMips, const float rotStrength,
+						 const int iNrSamples, const float fallOffContrast, const float fExp)
+{
+	if(iNrMips<=0 || iNrSamples<=0) return false;
+
+	std::vector<char> levelOk(iNrMips, 0);
+	ParallelFor(iNrMips, 0, [&](const int level, const int threadIdx)
+	{
+		(void) threadIdx;
+		levelOk[level] = ErrorAtLevel(&pErr[level], pMips, iNrMips, level, rotStrength, iNrSamples, fallOffContrast, fExp) ? 1 : 0;
+	});
+
+	bool res = true;
+	for(int m=0; m<iNrMips; m++) res &= levelOk[m]!=0;
+
+	return res;
+}
+
+int HexLodFindFallbackStart(const SHexLodError pErr[], const int iNrMips, const float fErrBound)
+{
+	// levels top-start to top are blended with a non zero fallback weight
+	int nrPassing = 0;
+	while(nrPassing<iNrMips && pErr[iNrMips-1-nrPassing].fMaxErr<=fErrBound)
+		++nrPassing;
+
+	return nrPassing-1;
+}
+
+
+static bool IntersectGroundPlane(Vec3 * pvPos, const Vec3 &vOrg, const Vec3 &vDir, const Vec3 &vPlaneCenter)
+{
+	if(vDir.y>=0.0f) return false;
+
+	const float t = (vPlaneCenter.y - vOrg.y) / vDir.y;
+	*pvPos = vOrg + t*vDir;
+
+	return t>0.0f;
+}
+
+bool HexLodCoverageGroundPlane(SHexLodCoverage * pRes, const Mat44 &mViewToWorld, const float fFovY, const int width, const int height,
+							   const Vec3 &vPlaneCenter, const float fPlaneHalfExtent, const float fTileRate, const int iTexSize,
+							   const float fallbackStart, const float fallbackRange, const int iPixelStep)
+{
+	memset(pRes, 0, sizeof(SHexLodCoverage));
+	if(width<=0 || height<=0 || iPixelStep<=0 || iTexSize<=0 || fallbackRange<=0.0f) return false;
+
+	const int iNrLevels = GetNrMipLevels(iTexSize, iTexSize);
+	const float fTanHalf = tanf(0.5f*fFovY);
+	const float fAspect = ((float) width) / height;
+
+	const Vec4 vOrg4 = mViewToWorld * Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	const Vec3 vOrg(vOrg4.x, vOrg4.y, vOrg4.z);
+
+	int nrHex = 0, nrFade = 0, nrFallback = 0;
+	for(int y=0; y<height; y+=iPixelStep)
+		for(int x=0; x<width; x+=iPixelStep)
+		{
+			// pixel and its right and lower neighbors, as ddx and ddy
+			Vec3 vPos[3] = {vOrg, vOrg, vOrg};
+			bool bHit[3];
+			for(int k=0; k<3; k++)
+			{
+				const float px = (float) (x + (k==1 ? 1 : 0)) + 0.5f;
+				const float py = (float) (y + (k==2 ? 1 : 0)) + 0.5f;
+				const Vec4 vDir4 = mViewToWorld * Vec4((2*px/width - 1)*fTanHalf*fAspect, (1 - 2*py/height)*fTanHalf, -1.0f, 0.0f);
+				bHit[k] = IntersectGroundPlane(&vPos[k], vOrg, Vec3(vDir4.x, vDir4.y, vDir4.z), vPlaneCenter);
+			}
+
+			if(!bHit[0] || fabsf(vPos[0].x-vPlaneCenter.x)>fPlaneHalfExtent || fabsf(vPos[0].z-vPlaneCenter.z)>fPlaneHalfExtent)
+				continue;
+
+			// a neighbor beyond the horizon means an unbounded footprint
+			float fWeight = 1.0f;
+			if(bHit[1] && bHit[2])
+			{
+				const float dSTdx[] = {fTileRate*(vPos[1].x-vPos[0].x), -fTileRate*(vPos[1].z-vPos[0].z)};
+				const float dSTdy[] = {fTileRate*(vPos[2].x-vPos[0].x), -fTileRate*(vPos[2].z-vPos[0].z)};
+				fWeight = FallbackWeight(FootprintLod(dSTdx, dSTdy, (float) iTexSize), iNrLevels, fallbackStart, fallbackRange);
+			}
+
+			if(fWeight<=0.0f) ++nrHex;
+			else if(fWeight>=1.0f) ++nrFallback;
+			else ++nrFade;
+		}
+
+	const int nrPixels = nrHex + nrFade + nrFallback;
+	pRes->iNrPixels = nrPixels;
+	if(nrPixels>0)
+	{
+		pRes->fHexFraction = ((float) nrHex) / nrPixels;
+		pRes->fFadeFraction = ((float) nrFade) / nrPixels;
+		pRes->fFallbackFraction = ((float) nrFallback) / nrPixels;
+		pRes->fFetchesPerPixel = (3.0f*nrHex + 4.0f*nrFade + 1.0f*nrFallback) / nrPixels;
+	}
+
+	return true;
+}
@@ -0,0 +1,46 @@
+#ifndef __HEXTILELOD_H__
+#define __HEXTILELOD_H__
+
+#include "cpu_image.h"
+#include <geommath/geommath_fwd.h>
+
+// Analysis of the footprint driven fallback of the shader where hex-tiling
+// fades to a single regular tiling fetch once the lod gets within
+// fallbackStart mip levels of the 1x1 level (see HexLodFallbackWeight()
+// in hextiling.h). The fade ends fallbackRange levels later.
+
+struct SHexLodError
+{
+	float fMaxErr, fRmsErr;		// max over rgb of |hex blend - single fetch|
+};
+
+// error per mip level of the source when sampled with a footprint of exactly
+// that level. The hex blend uses luminance weights as hex2colTex() does.
+bool HexLodErrorPerLevel(SHexLodError pErr[], const SCpuImage pMips[], const int iNrMips, const float rotStrength,
+						 const int iNrSamples=16384, const float fallOffContrast=0.6f, const float fExp=7.0f);
+
+// largest fallbackStart for which every lod that receives a non zero fallback
+// weight has a max error below fErrBound. Returns -1 if not even the 1x1 level
+// passes in which case the fallback should be disabled for this texture.
+int HexLodFindFallbackStart(const SHexLodError pErr[], const int iNrMips, const float fErrBound);
+
+
+// Fraction of pixels taking each path when looking at a horizontal square
+// ground plane with st = fTileRate*(x, -z) as in GroundExamplePS().
+struct SHexLodCoverage
+{
+	int iNrPixels;				// pixels covered by the plane
+	float fHexFraction;			// three taps only
+	float fFadeFraction;		// three taps plus the single fetch
+	float fFallbackFraction;	// single fetch only
+	float fFetchesPerPixel;		// average nr of texture fetches on the plane
+};
+
+// mViewToWorld is a right hand view space looking down -Z and fFovY the
+// vertical field of view in radians. Every iPixelStep'th pixel is evaluated.
+bool HexLodCoverageGroundPlane(SHexLodCoverage * pRes, const Mat44 &mViewToWorld, const float fFovY, const int width, const int height,
+							   const Vec3 &vPlaneCenter, const float fPlaneHalfExtent, const float fTileRate, const int iTexSize,
+							   const float fallbackStart, const float fallbackRange, const int iPixelStep=1);
+
+
+#endif
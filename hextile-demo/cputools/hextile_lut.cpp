@@ -0,0 +1,193 @@
+#include "hextile_lut.h"
+#include "hextiling_cpu.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+
+static inline bool IsPow2(const int N) { return N>0 && (N&(N-1))==0; }
+
+bool GenerateHexCellLUT(float pfLUT[], const int N, const float rotStrength)
+{
+	if(!IsPow2(N)) return false;
+
+	for(int y=0; y<N; y++)
+		for(int x=0; x<N; x++)
+		{
+			const int vertex[] = {x, y};
+			float * pfEntry = pfLUT + 4*(y*N + x);
+
+			LoadRot2x2(&pfEntry[0], &pfEntry[1], vertex, rotStrength);
+			hash(&pfEntry[2], vertex);
+		}
+
+	return true;
+}
+
+void LoadCellFromLUT(float * cs, float * si, float offs[], const float pfLUT[], const int N, const int vertex[])
+{
+	// two's complement & gives a positive modulo for negative cell ids too
+	const int x = vertex[0] & (N-1), y = vertex[1] & (N-1);
+	const float * pfEntry = pfLUT + 4*(y*N + x);
+
+	*cs = pfEntry[0]; *si = pfEntry[1];
+	offs[0] = pfEntry[2]; offs[1] = pfEntry[3];
+}
+
+
+// per cell sample as seen by the analytic or the LUT path
+struct SCellSample
+{
+	float fAngle, fOffsX, fOffsY;
+};
+
+static void GetCellSample(SCellSample * pSample, const int vertex[], const float * pfLUT, const int N)
+{
+	float cs, si, offs[2];
+	if(pfLUT!=NULL)
+		LoadCellFromLUT(&cs, &si, offs, pfLUT, N, vertex);
+	else
+	{
+		LoadRot2x2(&cs, &si, vertex, 1.0f);
+		hash(offs, vertex);
+	}
+
+	pSample->fAngle = atan2f(si, cs);
+	pSample->fOffsX = offs[0]; pSample->fOffsY = offs[1];
+}
+
+static inline int ToBin(const float fVal, const float fMin, const float fMax, const int iNrBins)
+{
+	const int bin = (int) (iNrBins*((fVal-fMin)/(fMax-fMin)));
+	return bin<0 ? 0 : (bin>=iNrBins ? (iNrBins-1) : bin);
+}
+
+static float ChiSqUniform(const std::vector<int> &histo, const int iNrSamples)
+{
+	const double fExpected = ((double) iNrSamples) / histo.size();
+
+	double fChiSq = 0.0;
+	for(size_t b=0; b<histo.size(); b++)
+		fChiSq += (histo[b]-fExpected)*(histo[b]-fExpected) / fExpected;
+
+	return (float) fChiSq;
+}
+
+// both histograms hold the same number of samples
+static float KSDistance(const std::vector<int> &histo0, const std::vector<int> &histo1, const int iNrSamples)
+{
+	int cdf0 = 0, cdf1 = 0;
+	float fMaxDist = 0.0f;
+	for(size_t b=0; b<histo0.size(); b++)
+	{
+		cdf0 += histo0[b]; cdf1 += histo1[b];
+		fMaxDist = std::max(fMaxDist, fabsf((float) (cdf0-cdf1)) / iNrSamples);
+	}
+
+	return fMaxDist;
+}
+
+static float NeighborCorrelation(const float * pfLUT, const int N, const int iRange)
+{
+	double fSumA=0.0, fSumB=0.0, fSumAA=0.0, fSumBB=0.0, fSumAB=0.0;
+	int iNrPairs = 0;
+
+	for(int y=-iRange; y<(iRange-1); y++)
+		for(int x=-iRange; x<(iRange-1); x++)
+		{
+			const int vertex[] = {x, y};
+			SCellSample sample;
+			GetCellSample(&sample, vertex, pfLUT, N);
+
+			for(int n=0; n<2; n++)
+			{
+				const int neighbor[] = {x + (n==0 ? 1 : 0), y + (n==1 ? 1 : 0)};
+				SCellSample sampleNeighbor;
+				GetCellSample(&sampleNeighbor, neighbor, pfLUT, N);
+
+				const double a = sample.fOffsX, b = sampleNeighbor.fOffsX;
+				fSumA += a; fSumB += b; fSumAA += a*a; fSumBB += b*b; fSumAB += a*b;
+				++iNrPairs;
+			}
+		}
+
+	const double fCov = fSumAB/iNrPairs - (fSumA/iNrPairs)*(fSumB/iNrPairs);
+	const double fVarA = fSumAA/iNrPairs - (fSumA/iNrPairs)*(fSumA/iNrPairs);
+	const double fVarB = fSumBB/iNrPairs - (fSumB/iNrPairs)*(fSumB/iNrPairs);
+
+	return (fVarA>0.0 && fVarB>0.0) ? ((float) (fCov / sqrt(fVarA*fVarB))) : 1.0f;
+}
+
+static float DistinctFraction(const float * pfLUT, const int N)
+{
+	std::vector<unsigned int> keys;
+	keys.reserve(4*N*N);
+
+	for(int y=-N; y<N; y++)
+		for(int x=-N; x<N; x++)
+		{
+			const int vertex[] = {x, y};
+			SCellSample sample;
+			GetCellSample(&sample, vertex, pfLUT, N);
+
+			const unsigned int a = (unsigned int) ToBin(sample.fAngle, -3.14159265f, 3.14159265f, 256);
+			const unsigned int ox = (unsigned int) ToBin(sample.fOffsX, 0.0f, 1.0f, 256);
+			const unsigned int oy = (unsigned int) ToBin(sample.fOffsY, 0.0f, 1.0f, 256);
+			keys.push_back((a<<16) | (ox<<8) | oy);
+		}
+
+	std::sort(keys.begin(), keys.end());
+	const size_t nrDistinct = std::unique(keys.begin(), keys.end()) - keys.begin();
+
+	return ((float) nrDistinct) / (4*N*N);
+}
+
+bool CompareHexCellLUT(SHexCellLUTStats * pStats, const int N, const int iRange, const int iNrBins)
+{
+	memset(pStats, 0, sizeof(SHexCellLUTStats));
+	if(!IsPow2(N) || iRange<=0 || iNrBins<=1) return false;
+
+	std::vector<float> lut(4*N*N);
+	GenerateHexCellLUT(&lut[0], N, 1.0f);
+
+	const float fPi = 3.14159265f;
+	std::vector<int> angleHisto[2], offsHisto[2];
+	for(int i=0; i<2; i++)
+	{
+		angleHisto[i].assign(iNrBins, 0);
+		offsHisto[i].assign(iNrBins, 0);
+	}
+
+	for(int y=-iRange; y<iRange; y++)
+		for(int x=-iRange; x<iRange; x++)
+		{
+			const int vertex[] = {x, y};
+			for(int i=0; i<2; i++)
+			{
+				SCellSample sample;
+				GetCellSample(&sample, vertex, i==0 ? NULL : &lut[0], N);
+
+				++angleHisto[i][ToBin(sample.fAngle, -fPi, fPi, iNrBins)];
+				++offsHisto[i][ToBin(sample.fOffsX, 0.0f, 1.0f, iNrBins)];
+				++offsHisto[i][ToBin(sample.fOffsY, 0.0f, 1.0f, iNrBins)];
+			}
+		}
+
+	const int iNrCells = 4*iRange*iRange;
+	pStats->iNrCells = iNrCells;
+	pStats->fAngleChiSqAnalytic = ChiSqUniform(angleHisto[0], iNrCells);
+	pStats->fAngleChiSqLUT = ChiSqUniform(angleHisto[1], iNrCells);
+	pStats->fOffsChiSqAnalytic = ChiSqUniform(offsHisto[0], 2*iNrCells);
+	pStats->fOffsChiSqLUT = ChiSqUniform(offsHisto[1], 2*iNrCells);
+	pStats->fAngleKS = KSDistance(angleHisto[0], angleHisto[1], iNrCells);
+	pStats->fOffsKS = KSDistance(offsHisto[0], offsHisto[1], 2*iNrCells);
+
+	pStats->fNeighborCorrAnalytic = NeighborCorrelation(NULL, N, iRange);
+	pStats->fNeighborCorrLUT = NeighborCorrelation(&lut[0], N, iRange);
+
+	pStats->fDistinctAnalytic = DistinctFraction(NULL, N);
+	pStats->fDistinctLUT = DistinctFraction(&lut[0], N);
+
+	return true;
+}
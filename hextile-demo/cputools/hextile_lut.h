@@ -0,0 +1,46 @@
+#ifndef __HEXTILELUT_H__
+#define __HEXTILELUT_H__
+
+// Per cell table which replaces the sin, cos and fmod of LoadRot2x2() and
+// the sin of hash() in hextiling.h by a single Buffer<float4> load. Entry
+// (x, y) holds cos, sin, hash.x and hash.y of cell (x, y) and the shader
+// looks up cell id & (N-1) so the pattern of rotations and offsets repeats
+// every N cells in both directions. Inside [0; N) the values are those of
+// the analytic functions. N must be a power of two.
+
+#define HEXCELL_LUT_DEFAULT_SIZE	64
+
+// pfLUT[] receives 4*N*N floats, row by row. The rotation is scaled by
+// rotStrength so the table must be regenerated when it changes.
+bool GenerateHexCellLUT(float pfLUT[], const int N, const float rotStrength);
+
+// the lookup done by the shader, returns float2x2(cs, -si, si, cs) and hash(vertex)
+void LoadCellFromLUT(float * cs, float * si, float offs[], const float pfLUT[], const int N, const int vertex[]);
+
+
+// Compares the per cell variety of the LUT against the analytic functions
+// over all cells in [-iRange; iRange)^2 with rotStrength=1. Histograms use
+// iNrBins bins over [-pi; pi] for the angle and [0; 1) for the offsets.
+struct SHexCellLUTStats
+{
+	int iNrCells;
+
+	// chi-square against a uniform distribution (expected value is iNrBins-1)
+	float fAngleChiSqAnalytic, fAngleChiSqLUT;
+	float fOffsChiSqAnalytic, fOffsChiSqLUT;
+
+	// Kolmogorov-Smirnov distance between the analytic and the LUT distribution
+	float fAngleKS, fOffsKS;
+
+	// correlation of hash().x between horizontal and vertical neighbors
+	float fNeighborCorrAnalytic, fNeighborCorrLUT;
+
+	// number of distinct quantized (8 bits each) angle and offset triplets in
+	// a 2N x 2N window relative to the number of cells. The LUT is at most 1/4.
+	float fDistinctAnalytic, fDistinctLUT;
+};
+
+bool CompareHexCellLUT(SHexCellLUTStats * pStats, const int N, const int iRange, const int iNrBins=64);
+
+
+#endif
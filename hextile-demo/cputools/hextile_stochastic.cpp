@@ -0,0 +1,142 @@
+#include "hextile_stochastic.h"
+#include "hextiling_cpu.h"
+#include "parallel_for.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+int HexStochasticSelect(const float W[], const float xi)
+{
+	return xi<W[0] ? 0 : (xi<(W[0]+W[1]) ? 1 : 2);
+}
+
+// sums gathered per row and reduced once all rows are done
+struct SRowSums
+{
+	double fBias[3], fAbsBias, fVariance, fSqErr;
+	float fMaxAbsBias, fMaxVariance;
+	int iNrDominant;
+};
+
+static bool AnalyzeRow(SRowSums * pSums, const SCpuImage pMips[], const int iNrMips, const int y, const int width, const int height,
+					   const float fTileRate, const float rotStrength, const float r, const float fallOffContrast, const float fExp)
+{
+	SHexTileCoordsSoA coords;
+	if(!AllocHexTileCoords(&coords, width)) return false;
+
+	const float fStepS = fTileRate / width, fStepT = fTileRate / height;
+	std::vector<float> S(width), T(width), Wf(3*width), Ws(3*width), Dw(3*width), C(3*4*width);
+	for(int x=0; x<width; x++)
+	{
+		S[x] = (x+0.5f)*fStepS; T[x] = (y+0.5f)*fStepT;
+	}
+
+	HexTileCoordsBatch(&coords, &S[0], &T[0], width, rotStrength);
+
+	const float dx[] = {fStepS, 0.0f}, dy[] = {0.0f, fStepT};
+	for(int k=0; k<3; k++)
+		for(int x=0; x<width; x++)
+		{
+			const float cs = coords.pfRotCs[k][x], si = coords.pfRotSi[k][x];
+			const float st[] = { coords.pfS[k][x], coords.pfT[k][x] };
+			const float dSTdx[] = { dx[0]*cs + dx[1]*si, dx[0]*(-si) + dx[1]*cs };
+			const float dSTdy[] = { dy[0]*cs + dy[1]*si, dy[0]*(-si) + dy[1]*cs };
+
+			float * pfCol = &C[4*(k*width+x)];
+			SampleGradWrap(pfCol, pMips, iNrMips, st, dSTdx, dSTdy);
+			Dw[k*width+x] = HexTileDwFromColor(pfCol);
+		}
+
+	// weights of the 3-tap blend and the selection probabilities of the
+	// stochastic variant which has no luminance term (Dw=1)
+	float * pfWf[] = {&Wf[0], &Wf[width], &Wf[2*width]};
+	float * pfWs[] = {&Ws[0], &Ws[width], &Ws[2*width]};
+	const float * const pfDw[] = {&Dw[0], &Dw[width], &Dw[2*width]};
+	HexTileWeightsBatch(pfWf, NULL, coords, pfDw, width, fallOffContrast, fExp, r);
+	HexTileWeightsBatch(pfWs, NULL, coords, NULL, width, fallOffContrast, fExp, r);
+
+	memset(pSums, 0, sizeof(SRowSums));
+	for(int x=0; x<width; x++)
+	{
+		float fMaxAbsBias = 0.0f, fVariance = 0.0f;
+		for(int c=0; c<3; c++)
+		{
+			float full = 0.0f, mean = 0.0f;
+			for(int k=0; k<3; k++)
+			{
+				full += pfWf[k][x]*C[4*(k*width+x)+c];
+				mean += pfWs[k][x]*C[4*(k*width+x)+c];
+			}
+
+			float var = 0.0f;
+			for(int k=0; k<3; k++)
+			{
+				const float diff = C[4*(k*width+x)+c] - mean;
+				var += pfWs[k][x]*diff*diff;
+			}
+
+			const float bias = mean - full;
+			pSums->fBias[c] += bias;
+			pSums->fSqErr += (bias*bias + var) / 3;
+			fVariance += var / 3;
+			if(fabsf(bias)>fMaxAbsBias) fMaxAbsBias = fabsf(bias);
+		}
+
+		pSums->fAbsBias += fMaxAbsBias;
+		pSums->fVariance += fVariance;
+		if(fMaxAbsBias>pSums->fMaxAbsBias) pSums->fMaxAbsBias = fMaxAbsBias;
+		if(fVariance>pSums->fMaxVariance) pSums->fMaxVariance = fVariance;
+
+		const float fMaxW = fmaxf(pfWf[0][x], fmaxf(pfWf[1][x], pfWf[2][x]));
+		if(fMaxW>0.95f) ++pSums->iNrDominant;
+	}
+
+	FreeHexTileCoords(&coords);
+
+	return true;
+}
+
+bool HexStochasticAnalyze(SHexStochasticStats * pStats, const SCpuImage pMips[], const int iNrMips,
+						  const int width, const int height, const float fTileRate, const float rotStrength,
+						  const float r, const float fallOffContrast, const float fExp, const int iNrThreads)
+{
+	memset(pStats, 0, sizeof(SHexStochasticStats));
+	if(width<=0 || height<=0 || iNrMips<=0) return false;
+
+	std::vector<SRowSums> rows(height);
+	std::vector<char> rowOk(height, 0);
+	ParallelFor(height, iNrThreads, [&](const int y, const int threadIdx)
+	{
+		(void) threadIdx;
+		rowOk[y] = AnalyzeRow(&rows[y], pMips, iNrMips, y, width, height, fTileRate, rotStrength, r, fallOffContrast, fExp) ? 1 : 0;
+	});
+
+	SRowSums total;
+	memset(&total, 0, sizeof(total));
+	bool res = true;
+	for(int y=0; y<height; y++)
+	{
+		res &= rowOk[y]!=0;
+		for(int c=0; c<3; c++) total.fBias[c] += rows[y].fBias[c];
+		total.fAbsBias += rows[y].fAbsBias;
+		total.fVariance += rows[y].fVariance;
+		total.fSqErr += rows[y].fSqErr;
+		total.iNrDominant += rows[y].iNrDominant;
+		if(rows[y].fMaxAbsBias>total.fMaxAbsBias) total.fMaxAbsBias = rows[y].fMaxAbsBias;
+		if(rows[y].fMaxVariance>total.fMaxVariance) total.fMaxVariance = rows[y].fMaxVariance;
+	}
+
+	const int nrPixels = width*height;
+	pStats->iNrPixels = nrPixels;
+	for(int c=0; c<3; c++) pStats->fMeanBias[c] = (float) (total.fBias[c] / nrPixels);
+	pStats->fMeanAbsBias = (float) (total.fAbsBias / nrPixels);
+	pStats->fMaxAbsBias = total.fMaxAbsBias;
+	pStats->fMeanVariance = (float) (total.fVariance / nrPixels);
+	pStats->fMaxVariance = total.fMaxVariance;
+	pStats->fRmsErrSingleFrame = (float) sqrt(total.fSqErr / nrPixels);
+	pStats->fDominantFraction = ((float) total.iNrDominant) / nrPixels;
+	pStats->fFetchesPerPixelHybrid = 1.0f*pStats->fDominantFraction + 3.0f*(1.0f - pStats->fDominantFraction);
+
+	return res;
+}
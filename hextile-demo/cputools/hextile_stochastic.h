@@ -0,0 +1,42 @@
+#ifndef __HEXTILESTOCHASTIC_H__
+#define __HEXTILESTOCHASTIC_H__
+
+#include "cpu_image.h"
+
+// Analysis of hex2colTexStochastic() which fetches one of the three tiles
+// with probability given by the blend weight, against the full 3-tap blend
+// of hex2colTex(). The single tap estimator is evaluated analytically per
+// pixel, its expectation and variance, rather than by drawing thresholds.
+
+// tile chosen by the shader for threshold xi in [0;1), returns 0, 1 or 2
+int HexStochasticSelect(const float W[], const float xi);
+
+struct SHexStochasticStats
+{
+	int iNrPixels;
+
+	// bias of the converged result, E[single tap] - 3-tap, per rgb channel
+	float fMeanBias[3];
+	float fMeanAbsBias;				// mean over pixels of max over rgb of |bias|
+	float fMaxAbsBias;
+
+	// variance of a single frame, mean over rgb. Accumulating n frames
+	// divides it by n.
+	float fMeanVariance, fMaxVariance;
+	float fRmsErrSingleFrame;		// sqrt(mean(bias^2 + variance))
+
+	// fraction of pixels where the largest weight of the 3-tap blend exceeds
+	// 0.95, and the average fetches per pixel if those took a single tap
+	float fDominantFraction;
+	float fFetchesPerPixelHybrid;
+};
+
+// Renders a width x height plane with fTileRate repetitions of the source
+// across it, as HexBakePlane() does, and gathers the stats over all pixels.
+// r, fallOffContrast and fExp are those of hex2colTex().
+bool HexStochasticAnalyze(SHexStochasticStats * pStats, const SCpuImage pMips[], const int iNrMips,
+						  const int width, const int height, const float fTileRate, const float rotStrength,
+						  const float r=0.5f, const float fallOffContrast=0.6f, const float fExp=7.0f, const int iNrThreads=0);
+
+
+#endif
@@ -0,0 +1,355 @@
+#include "hextiling_cpu.h"
+#include "simd_common.h"
+#include <math.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <new>
+
+#ifndef M_PI
+	#define M_PI 3.1415926535897932384626433832795
+#endif
+
+
+// constants as they appear in hextiling.h
+static const float g_fGridScale = 2*sqrtf(3.0f);
+static const float g_fSkewXY = -0.57735027f;
+static const float g_fSkewYY = 1.15470054f;
+static const float g_fInvSkewYY = 1.0f/1.15470054f;
+static const float g_fPi = (float) M_PI;
+static const float g_fTwoPi = (float) (2*M_PI);
+
+
+static inline float frac(const float x) { return x - floorf(x); }
+
+
+void TriangleGrid(float * w1, float * w2, float * w3,
+				  int vertex1[], int vertex2[], int vertex3[],
+				  const float st_in[])
+{
+	// Scaling of the input
+	const float st[] = { st_in[0]*g_fGridScale, st_in[1]*g_fGridScale };
+
+	// Skew input space into simplex triangle grid
+	const float skewedCoord[] = { 1.0f*st[0] + g_fSkewXY*st[1], g_fSkewYY*st[1] };
+
+	const int baseId[] = { (int) floorf(skewedCoord[0]), (int) floorf(skewedCoord[1]) };
+	float temp[] = { frac(skewedCoord[0]), frac(skewedCoord[1]), 0.0f };
+	temp[2] = 1.0f - temp[0] - temp[1];
+
+	const float s = (-temp[2])>=0.0f ? 1.0f : 0.0f;
+	const float s2 = 2*s-1;
+
+	*w1 = -temp[2]*s2;
+	*w2 = s - temp[1]*s2;
+	*w3 = s - temp[0]*s2;
+
+	const int is = (int) s;
+	vertex1[0] = baseId[0] + is; vertex1[1] = baseId[1] + is;
+	vertex2[0] = baseId[0] + is; vertex2[1] = baseId[1] + (1-is);
+	vertex3[0] = baseId[0] + (1-is); vertex3[1] = baseId[1] + is;
+}
+
+void hash(float res[], const int p[])
+{
+	const float px = (float) p[0], py = (float) p[1];
+	const float r[] = { 127.1f*px + 311.7f*py, 269.5f*px + 183.3f*py };
+
+	res[0] = frac( sinf(r[0])*43758.5453f );
+	res[1] = frac( sinf(r[1])*43758.5453f );
+}
+
+void MakeCenST(float res[], const int Vertex[])
+{
+	const float vx = (float) Vertex[0], vy = (float) Vertex[1];
+
+	res[0] = (1.0f*vx + 0.5f*vy) / g_fGridScale;
+	res[1] = (0.0f*vx + g_fInvSkewYY*vy) / g_fGridScale;
+}
+
+static inline float RotAngle(const int idx[], const float rotStrength)
+{
+	float angle = ((float) (abs(idx[0]*idx[1]) + abs(idx[0]+idx[1]))) + g_fPi;
+
+	// remap to +/-pi
+	angle = fmodf(angle, g_fTwoPi);
+	if(angle<0) angle += g_fTwoPi;
+	if(angle>g_fPi) angle -= g_fTwoPi;
+
+	return angle * rotStrength;
+}
+
+void LoadRot2x2(float * cs, float * si, const int idx[], const float rotStrength)
+{
+	const float angle = RotAngle(idx, rotStrength);
+
+	*cs = cosf(angle); *si = sinf(angle);
+}
+
+void ProduceHexWeights(float res[], const float W[], const int vertex1[], const int vertex2[], const int vertex3[])
+{
+	(void) vertex2;		// unused, kept to match the shader signature
+
+	int v1 = (vertex1[0]-vertex1[1])%3;
+	if(v1<0) v1+=3;
+
+	const int vh = v1<2 ? (v1+1) : 0;
+	const int vl = v1>0 ? (v1-1) : 2;
+	const int v2 = vertex1[0]<vertex3[0] ? vl : vh;
+	const int v3 = vertex1[0]<vertex3[0] ? vh : vl;
+
+	res[0] = v3==0 ? W[2] : (v2==0 ? W[1] : W[0]);
+	res[1] = v3==1 ? W[2] : (v2==1 ? W[1] : W[0]);
+	res[2] = v3==2 ? W[2] : (v2==2 ? W[1] : W[0]);
+}
+
+void Gain3(float res[], const float x[], const float r)
+{
+	// increase contrast when r>0.5 and
+	// reduce contrast if less
+	const float k = logf(1-r) / logf(0.5f);
+
+	for(int i=0; i<3; i++)
+	{
+		const float s = 2*(x[i]>=0.5f ? 1.0f : 0.0f);
+		const float m = 2*(1 - s);
+		const float b = s + x[i]*m;
+
+		res[i] = 0.5f*s + 0.25f*m * powf(b>0.0f ? b : 0.0f, k);
+	}
+
+	const float fSum = res[0]+res[1]+res[2];
+	res[0] /= fSum; res[1] /= fSum; res[2] /= fSum;
+}
+
+float HexTileDwFromColor(const float col[])
+{
+	return col[0]*0.299f + col[1]*0.587f + col[2]*0.114f;
+}
+
+float HexTileDwFromDeriv(const float deriv[])
+{
+	const float D = deriv[0]*deriv[0] + deriv[1]*deriv[1];
+	return sqrtf(D/(1.0f+D));
+}
+
+
+bool AllocHexTileCoords(SHexTileCoordsSoA * pCoords, const int N)
+{
+	if(N<=0) return false;
+
+	int * piData = new (std::nothrow) int[6*N];
+	float * pfData = new (std::nothrow) float[15*N];
+	if(piData==NULL || pfData==NULL)
+	{
+		delete [] piData; delete [] pfData;
+		return false;
+	}
+
+	for(int k=0; k<3; k++)
+	{
+		pCoords->piVertX[k] = piData + (2*k+0)*N;
+		pCoords->piVertY[k] = piData + (2*k+1)*N;
+		pCoords->pfBary[k] = pfData + (5*k+0)*N;
+		pCoords->pfRotCs[k] = pfData + (5*k+1)*N;
+		pCoords->pfRotSi[k] = pfData + (5*k+2)*N;
+		pCoords->pfS[k] = pfData + (5*k+3)*N;
+		pCoords->pfT[k] = pfData + (5*k+4)*N;
+	}
+
+	return true;
+}
+
+void FreeHexTileCoords(SHexTileCoordsSoA * pCoords)
+{
+	delete [] pCoords->piVertX[0];
+	delete [] pCoords->pfBary[0];
+
+	for(int k=0; k<3; k++)
+	{
+		pCoords->piVertX[k] = NULL; pCoords->piVertY[k] = NULL;
+		pCoords->pfBary[k] = NULL; pCoords->pfRotCs[k] = NULL; pCoords->pfRotSi[k] = NULL;
+		pCoords->pfS[k] = NULL; pCoords->pfT[k] = NULL;
+	}
+}
+
+
+static void HexTileCoordsScalar(SHexTileCoordsSoA * pCoords, const float pfS[], const float pfT[], const int iStart, const int iEnd, const float rotStrength)
+{
+	for(int i=iStart; i<iEnd; i++)
+	{
+		const float st[] = { pfS[i], pfT[i] };
+
+		float w[3];
+		int vertex[3][2];
+		TriangleGrid(&w[0], &w[1], &w[2], vertex[0], vertex[1], vertex[2], st);
+
+		for(int k=0; k<3; k++)
+		{
+			float cs, si, cen[2], ofs[2];
+			LoadRot2x2(&cs, &si, vertex[k], rotStrength);
+			MakeCenST(cen, vertex[k]);
+			hash(ofs, vertex[k]);
+
+			// mul(st - cen, rot) + cen + hash(vertex)
+			const float dx = st[0] - cen[0], dy = st[1] - cen[1];
+
+			pCoords->piVertX[k][i] = vertex[k][0];
+			pCoords->piVertY[k][i] = vertex[k][1];
+			pCoords->pfBary[k][i] = w[k];
+			pCoords->pfRotCs[k][i] = cs;
+			pCoords->pfRotSi[k][i] = si;
+			pCoords->pfS[k][i] = ((dx*cs + dy*si) + cen[0]) + ofs[0];
+			pCoords->pfT[k][i] = ((dx*(-si) + dy*cs) + cen[1]) + ofs[1];
+		}
+	}
+}
+
+#ifdef SIMD_HAS_AVX2_PATH
+// 8 lanes at a time. The arithmetic is vectorized in the same order as
+// the scalar path. sin, cos and fmod are evaluated per lane using the same
+// libm calls to keep the two paths bit identical.
+SIMD_AVX2_FUNC static int HexTileCoordsAVX2(SHexTileCoordsSoA * pCoords, const float pfS[], const float pfT[], const int N, const float rotStrength)
+{
+	const __m256 vOne = _mm256_set1_ps(1.0f);
+	const __m256 vZero = _mm256_setzero_ps();
+	const __m256 vSignBit = _mm256_set1_ps(-0.0f);
+	const __m256 vScale = _mm256_set1_ps(g_fGridScale);
+	const __m256i viOne = _mm256_set1_epi32(1);
+
+	int i=0;
+	for(; (i+8)<=N; i+=8)
+	{
+		const __m256 vS = _mm256_loadu_ps(pfS+i), vT = _mm256_loadu_ps(pfT+i);
+		const __m256 vScaledS = _mm256_mul_ps(vS, vScale), vScaledT = _mm256_mul_ps(vT, vScale);
+
+		const __m256 vSkewX = _mm256_add_ps(_mm256_mul_ps(vOne, vScaledS), _mm256_mul_ps(_mm256_set1_ps(g_fSkewXY), vScaledT));
+		const __m256 vSkewY = _mm256_mul_ps(_mm256_set1_ps(g_fSkewYY), vScaledT);
+
+		const __m256 vFloorX = _mm256_floor_ps(vSkewX), vFloorY = _mm256_floor_ps(vSkewY);
+		const __m256i viBaseX = _mm256_cvttps_epi32(vFloorX), viBaseY = _mm256_cvttps_epi32(vFloorY);
+		const __m256 vTempX = _mm256_sub_ps(vSkewX, vFloorX), vTempY = _mm256_sub_ps(vSkewY, vFloorY);
+		const __m256 vTempZ = _mm256_sub_ps(_mm256_sub_ps(vOne, vTempX), vTempY);
+		const __m256 vNegTempZ = _mm256_xor_ps(vTempZ, vSignBit);
+
+		const __m256 vStep = _mm256_and_ps(_mm256_cmp_ps(vNegTempZ, vZero, _CMP_GE_OQ), vOne);
+		const __m256 vStep2 = _mm256_sub_ps(_mm256_add_ps(vStep, vStep), vOne);
+
+		const __m256 vW[] = { _mm256_mul_ps(vNegTempZ, vStep2),
+							  _mm256_sub_ps(vStep, _mm256_mul_ps(vTempY, vStep2)),
+							  _mm256_sub_ps(vStep, _mm256_mul_ps(vTempX, vStep2)) };
+
+		const __m256i viS = _mm256_cvttps_epi32(vStep);
+		const __m256i viOneMinusS = _mm256_sub_epi32(viOne, viS);
+		const __m256i viVX[] = { _mm256_add_epi32(viBaseX, viS), _mm256_add_epi32(viBaseX, viS), _mm256_add_epi32(viBaseX, viOneMinusS) };
+		const __m256i viVY[] = { _mm256_add_epi32(viBaseY, viS), _mm256_add_epi32(viBaseY, viOneMinusS), _mm256_add_epi32(viBaseY, viS) };
+
+		for(int k=0; k<3; k++)
+		{
+			const __m256 vVX = _mm256_cvtepi32_ps(viVX[k]), vVY = _mm256_cvtepi32_ps(viVY[k]);
+
+			// MakeCenST()
+			const __m256 vCenX = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(vOne, vVX), _mm256_mul_ps(_mm256_set1_ps(0.5f), vVY)), vScale);
+			const __m256 vCenY = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(vZero, vVX), _mm256_mul_ps(_mm256_set1_ps(g_fInvSkewYY), vVY)), vScale);
+
+			// hash() argument and LoadRot2x2() angle before the transcendentals
+			const __m256 vHashX = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(127.1f), vVX), _mm256_mul_ps(_mm256_set1_ps(311.7f), vVY));
+			const __m256 vHashY = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(269.5f), vVX), _mm256_mul_ps(_mm256_set1_ps(183.3f), vVY));
+			const __m256i viAng = _mm256_add_epi32(_mm256_abs_epi32(_mm256_mullo_epi32(viVX[k], viVY[k])), _mm256_abs_epi32(_mm256_add_epi32(viVX[k], viVY[k])));
+			const __m256 vAng = _mm256_add_ps(_mm256_cvtepi32_ps(viAng), _mm256_set1_ps(g_fPi));
+
+			float fHX[8], fHY[8], fAng[8], fCs[8], fSi[8];
+			_mm256_storeu_ps(fHX, vHashX); _mm256_storeu_ps(fHY, vHashY); _mm256_storeu_ps(fAng, vAng);
+			for(int l=0; l<8; l++)
+			{
+				fHX[l] = sinf(fHX[l]); fHY[l] = sinf(fHY[l]);
+
+				float angle = fmodf(fAng[l], g_fTwoPi);
+				if(angle<0) angle += g_fTwoPi;
+				if(angle>g_fPi) angle -= g_fTwoPi;
+				angle *= rotStrength;
+				fCs[l] = cosf(angle); fSi[l] = sinf(angle);
+			}
+
+			const __m256 vScramble = _mm256_set1_ps(43758.5453f);
+			__m256 vOfsX = _mm256_mul_ps(_mm256_loadu_ps(fHX), vScramble);
+			__m256 vOfsY = _mm256_mul_ps(_mm256_loadu_ps(fHY), vScramble);
+			vOfsX = _mm256_sub_ps(vOfsX, _mm256_floor_ps(vOfsX));
+			vOfsY = _mm256_sub_ps(vOfsY, _mm256_floor_ps(vOfsY));
+
+			const __m256 vCs = _mm256_loadu_ps(fCs), vSi = _mm256_loadu_ps(fSi);
+			const __m256 vDx = _mm256_sub_ps(vS, vCenX), vDy = _mm256_sub_ps(vT, vCenY);
+
+			const __m256 vResS = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vDx, vCs), _mm256_mul_ps(vDy, vSi)), vCenX), vOfsX);
+			const __m256 vResT = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vDx, _mm256_xor_ps(vSi, vSignBit)), _mm256_mul_ps(vDy, vCs)), vCenY), vOfsY);
+
+			_mm256_storeu_si256((__m256i *) (pCoords->piVertX[k]+i), viVX[k]);
+			_mm256_storeu_si256((__m256i *) (pCoords->piVertY[k]+i), viVY[k]);
+			_mm256_storeu_ps(pCoords->pfBary[k]+i, vW[k]);
+			_mm256_storeu_ps(pCoords->pfRotCs[k]+i, vCs);
+			_mm256_storeu_ps(pCoords->pfRotSi[k]+i, vSi);
+			_mm256_storeu_ps(pCoords->pfS[k]+i, vResS);
+			_mm256_storeu_ps(pCoords->pfT[k]+i, vResT);
+		}
+	}
+
+	return i;
+}
+#endif
+
+
+static bool g_bAVX2Enabled = CpuSupportsAVX2();
+
+bool IsHexTilingAVX2Enabled()
+{
+	return g_bAVX2Enabled;
+}
+
+void HexTileCoordsBatch(SHexTileCoordsSoA * pCoords, const float pfS[], const float pfT[], const int N, const float rotStrength)
+{
+	int iDone = 0;
+#ifdef SIMD_HAS_AVX2_PATH
+	if(g_bAVX2Enabled) iDone = HexTileCoordsAVX2(pCoords, pfS, pfT, N, rotStrength);
+#endif
+	HexTileCoordsScalar(pCoords, pfS, pfT, iDone, N, rotStrength);
+}
+
+// the cost is dominated by pow() so this one remains scalar
+void HexTileWeightsBatch(float * pfW[], float * pfHexW[], const SHexTileCoordsSoA &coords, const float * const pfDw[], const int N,
+						 const float fallOffContrast, const float fExp, const float r)
+{
+	for(int i=0; i<N; i++)
+	{
+		float W[3];
+		for(int k=0; k<3; k++)
+		{
+			const float Dw = pfDw!=NULL ? pfDw[k][i] : 1.0f;
+			const float lerpDw = 1.0f + fallOffContrast*(Dw - 1.0f);		// lerp(1.0, Dw, g_fallOffContrast)
+			W[k] = lerpDw*powf(coords.pfBary[k][i], fExp);
+		}
+
+		const float fSum = W[0]+W[1]+W[2];
+		W[0] /= fSum; W[1] /= fSum; W[2] /= fSum;
+		if(r!=0.5f)
+		{
+			float Wg[3];
+			Gain3(Wg, W, r);
+			W[0] = Wg[0]; W[1] = Wg[1]; W[2] = Wg[2];
+		}
+
+		if(pfW!=NULL)
+		{
+			pfW[0][i] = W[0]; pfW[1][i] = W[1]; pfW[2][i] = W[2];
+		}
+
+		if(pfHexW!=NULL)
+		{
+			const int vertex1[] = { coords.piVertX[0][i], coords.piVertY[0][i] };
+			const int vertex2[] = { coords.piVertX[1][i], coords.piVertY[1][i] };
+			const int vertex3[] = { coords.piVertX[2][i], coords.piVertY[2][i] };
+
+			float hexW[3];
+			ProduceHexWeights(hexW, W, vertex1, vertex2, vertex3);
+			pfHexW[0][i] = hexW[0]; pfHexW[1][i] = hexW[1]; pfHexW[2][i] = hexW[2];
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef __HEXTILINGCPU_H__
+#define __HEXTILINGCPU_H__
+
+// C++ reference of the hex-tiling math in hextiling.h. The scalar
+// functions mirror the HLSL functions of the same name, statement by
+// statement, such that arithmetic is bit exact with the shader and only
+// the transcendentals (sin, cos, pow, log, fmod) differ by the ULP error
+// of the GPU implementation. The batch functions evaluate N coordinates
+// given as SoA arrays with AVX2 when the CPU supports it and otherwise
+// fall back to the scalar path. Both paths produce identical bits.
+
+
+// scalar reference
+void TriangleGrid(float * w1, float * w2, float * w3,
+				  int vertex1[], int vertex2[], int vertex3[],
+				  const float st[]);
+void hash(float res[], const int p[]);
+void LoadRot2x2(float * cs, float * si, const int idx[], const float rotStrength);		// float2x2(cs, -si, si, cs)
+void MakeCenST(float res[], const int Vertex[]);
+void Gain3(float res[], const float x[], const float r);
+void ProduceHexWeights(float res[], const float W[], const int vertex1[], const int vertex2[], const int vertex3[]);
+
+
+// SoA layout for a batch of N coordinates. Every array holds N entries.
+struct SHexTileCoordsSoA
+{
+	int * piVertX[3], * piVertY[3];		// hex cell ids (vertex1, vertex2, vertex3)
+	float * pfBary[3];					// w1, w2, w3 from TriangleGrid()
+	float * pfRotCs[3], * pfRotSi[3];	// LoadRot2x2() per cell
+	float * pfS[3], * pfT[3];			// rotated and offset sample coordinates st1, st2, st3
+};
+
+bool AllocHexTileCoords(SHexTileCoordsSoA * pCoords, const int N);
+void FreeHexTileCoords(SHexTileCoordsSoA * pCoords);
+
+// cell ids, barycentrics, rotations and the sample coordinates
+// st_i = mul(st - cen_i, rot_i) + cen_i + hash(vertex_i).
+void HexTileCoordsBatch(SHexTileCoordsSoA * pCoords, const float pfS[], const float pfT[], const int N, const float rotStrength);
+
+// blend weights as in hex2colTex() and bumphex2derivNMap(). pfDw[] holds the
+// per sample contrast terms (see HexTileDwFromColor/HexTileDwFromDeriv) and may
+// be NULL in which case Dw=1. pfW[] receives the weights of st1, st2 and st3 and
+// pfHexW[] the output of ProduceHexWeights(). Either of these may be NULL.
+void HexTileWeightsBatch(float * pfW[], float * pfHexW[], const SHexTileCoordsSoA &coords, const float * const pfDw[], const int N,
+						 const float fallOffContrast=0.6f, const float fExp=7.0f, const float r=0.5f);
+
+float HexTileDwFromColor(const float col[]);		// luminance
+float HexTileDwFromDeriv(const float deriv[]);		// sine of the angle to the Z-axis
+
+bool IsHexTilingAVX2Enabled();
+
+
+#endif
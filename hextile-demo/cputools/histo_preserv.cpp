@@ -0,0 +1,1095 @@
+#include "histo_preserv.h"
+#include "parallel_for.h"
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wincodec.h>
+#endif
+
+#define HISTO_MAX_VARI		64.0
+#define HISTO_GAUSS_SIGMAS	4.0			// standard deviations from 0.5 to either end of the lookup
+
+
+// Acklam's rational approximation of the inverse of the standard normal CDF
+static double InvNormalCDF(const double p)
+{
+	static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+								 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+	static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+								 6.680131188771972e+01, -1.328068155288572e+01 };
+	static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+								-2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+	static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+								3.754408661907416e+00 };
+
+	const double plow = 0.02425;
+	if(p<plow || p>(1-plow))
+	{
+		const double q = sqrt(-2*log(p<plow ? p : (1-p)));
+		const double x = (((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) / ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1);
+		return p<plow ? x : -x;
+	}
+	else
+	{
+		const double q = p-0.5, r = q*q;
+		return (((((a[0]*r+a[1])*r+a[2])*r+a[3])*r+a[4])*r+a[5])*q / (((((b[0]*r+b[1])*r+b[2])*r+b[3])*r+b[4])*r+1);
+	}
+}
+
+static float QuantizeTransfer(const double t)
+{
+	const double tc = t<0.0 ? 0.0 : (t>1.0 ? 1.0 : t);
+	return floorf((float) (255.0*tc) + 0.5f) / 255.0f;
+}
+
+// transfer of the standard normal quantile z. The lookup coordinate is
+// clamped to [0;1], which the shader gets back by scaling with vari. At 3
+// standard deviations 0.27% of the texels would share the ends of
+// invTransfer, at 4 it is 0.006%.
+static double GaussianTransfer(const double z, const double fVari)
+{
+	const double u = 0.5 + z/(2*HISTO_GAUSS_SIGMAS);
+	return 0.5 + ((u<0.0 ? 0.0 : (u>1.0 ? 1.0 : u)) - 0.5)/fVari;
+}
+
+// eigen decomposition of the symmetric matrix A by cyclic Jacobi rotations.
+// Column k of V is the eigenvector of eigenvalue fEig[k].
+static void EigenSymmetric3x3(double fEig[3], double V[3][3], const double A_in[3][3])
+{
+	double A[3][3];
+	memcpy(A, A_in, sizeof(A));
+	for(int r=0; r<3; r++)
+		for(int c=0; c<3; c++) V[r][c] = r==c ? 1.0 : 0.0;
+
+	for(int sweep=0; sweep<32; sweep++)
+	{
+		const double off = A[0][1]*A[0][1] + A[0][2]*A[0][2] + A[1][2]*A[1][2];
+		if(off<1e-30) break;
+
+		for(int p=0; p<2; p++)
+			for(int q=p+1; q<3; q++)
+			{
+				if(fabs(A[p][q])<1e-300) continue;
+
+				const double theta = (A[q][q]-A[p][p]) / (2*A[p][q]);
+				const double t = (theta>=0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta*theta+1));
+				const double cs = 1/sqrt(t*t+1), sn = t*cs;
+
+				for(int k=0; k<3; k++)
+				{
+					const double akp = A[k][p], akq = A[k][q];
+					A[k][p] = cs*akp - sn*akq; A[k][q] = sn*akp + cs*akq;
+				}
+				for(int k=0; k<3; k++)
+				{
+					const double apk = A[p][k], aqk = A[q][k];
+					A[p][k] = cs*apk - sn*aqk; A[q][k] = sn*apk + cs*aqk;
+				}
+				for(int k=0; k<3; k++)
+				{
+					const double vkp = V[k][p], vkq = V[k][q];
+					V[k][p] = cs*vkp - sn*vkq; V[k][q] = sn*vkp + cs*vkq;
+				}
+			}
+	}
+
+	for(int k=0; k<3; k++) fEig[k] = A[k][k];
+}
+
+// principal axes of the covariance. The shader scales .x and .z by vari so
+// .y must be the axis of largest variance, .x the second and .z the smallest.
+static void PrincipalAxes(double fAxis[3][3], const double fCov[3][3])
+{
+	double fEig[3], V[3][3];
+	EigenSymmetric3x3(fEig, V, fCov);
+
+	int order[] = { 0, 1, 2 };
+	std::sort(order, order+3, [&](const int a, const int b) { return fEig[a]>fEig[b]; });
+	const int axisOfChannel[] = { order[1], order[0], order[2] };
+
+	for(int k=0; k<3; k++)
+		for(int c=0; c<3; c++) fAxis[k][c] = V[c][axisOfChannel[k]];
+}
+
+// vari is the extent of the projections along .y over the extent along .x
+// and .z, as in the _basis.dds files in textures/.
+static void ExtentVari(double fVari[3], const double fLo[3], const double fHi[3])
+{
+	const double fExtY = fHi[1]-fLo[1];
+	fVari[0] = fVari[1] = fVari[2] = 1.0;
+	for(int k=0; k<3; k+=2)
+	{
+		const double fExt = fHi[k]-fLo[k];
+		fVari[k] = fExt>(fExtY/HISTO_MAX_VARI) ? (fExtY/fExt) : HISTO_MAX_VARI;
+		if(fVari[k]<1.0) fVari[k] = 1.0;
+	}
+}
+
+// rgb = sum_k fAxis[k]*proj[k] + mean
+static bool BuildBasis(SCpuImage * pBasis, const double fAxis[3][3], const double fMean[3], const double fVari[3])
+{
+	if(!AllocCpuImage(pBasis, 8, 2)) return false;
+
+	float fTexels[2][8];
+	memset(fTexels, 0, sizeof(fTexels));
+	for(int r=0; r<3; r++)
+	{
+		fTexels[1][2*r+0] = (float) fAxis[0][r];
+		fTexels[1][2*r+1] = (float) fAxis[1][r];
+		fTexels[0][2*r+1] = (float) fAxis[2][r];
+		fTexels[0][2*r+0] = (float) fMean[r];
+	}
+	fTexels[1][6] = (float) fVari[0];
+	fTexels[1][7] = (float) fVari[2];
+
+	for(int y=0; y<2; y++)
+		for(int x=0; x<8; x++)
+		{
+			float * pfDst = GetCpuImagePixel(*pBasis, x, y);
+			pfDst[0] = pfDst[1] = pfDst[2] = fTexels[y][x];
+			pfDst[3] = 1.0f;
+		}
+
+	return true;
+}
+
+// average over the footprint [x; x+fw) x [y; y+fh) with wrap for every
+// step'th x and y. pfRowSums is scratch of width*height floats.
+static void BoxFilterSampled(std::vector<float> &res, const float pfSrc[], const int width, const int height,
+							 const int fw, const int fh, const int step, float pfRowSums[], const int iNrThreads)
+{
+	const int nx = (width+step-1)/step, ny = (height+step-1)/step;
+	res.resize(nx*ny);
+
+	ParallelFor(height, iNrThreads, [&](const int y, const int threadIdx)
+	{
+		(void) threadIdx;
+		const float * pfRow = pfSrc + y*width;
+		double sum = 0.0;
+		for(int x=0; x<fw; x++) sum += pfRow[x%width];
+		for(int x=0; x<width; x++)
+		{
+			pfRowSums[y*width+x] = (float) sum;
+			sum += pfRow[(x+fw)%width] - pfRow[x];
+		}
+	});
+
+	const double fNorm = 1.0 / (((double) fw)*fh);
+	ParallelFor(nx, iNrThreads, [&](const int xi, const int threadIdx)
+	{
+		(void) threadIdx;
+		const int x = xi*step;
+		double sum = 0.0;
+		for(int y=0; y<fh; y++) sum += pfRowSums[(y%height)*width+x];
+		for(int y=0; y<height; y++)
+		{
+			if((y%step)==0) res[(y/step)*nx+xi] = (float) (fNorm*sum);
+			sum += pfRowSums[((y+fh)%height)*width+x] - pfRowSums[y*width+x];
+		}
+	});
+}
+
+// midpoint of the ranks of the entries equal to v in the sorted pfVals[]
+static double MidRank(const std::vector<float> &vals, const float v)
+{
+	const size_t lo = std::lower_bound(vals.begin(), vals.end(), v) - vals.begin();
+	const size_t hi = std::upper_bound(vals.begin(), vals.end(), v) - vals.begin();
+	return 0.5*((double) lo + (double) hi - 1.0);
+}
+
+// rank of u in sorted vals[], interpolated between the ranks of the
+// neighboring distinct values such that quantized inputs give a smooth CDF.
+static double InterpolatedRank(const std::vector<float> &vals, const float u)
+{
+	const size_t n = vals.size();
+	if(u<=vals[0]) return u==vals[0] ? MidRank(vals, u) : 0.0;
+	if(u>=vals[n-1]) return u==vals[n-1] ? MidRank(vals, u) : (double) (n-1);
+
+	const size_t a = std::lower_bound(vals.begin(), vals.end(), u) - vals.begin();
+	if(vals[a]==u) return MidRank(vals, u);
+
+	const float v0 = vals[a-1], v1 = vals[a];
+	const double t = ((double) u - v0) / ((double) v1 - v0);
+	const double r0 = MidRank(vals, v0), r1 = MidRank(vals, v1);
+	return r0 + t*(r1-r0);
+}
+
+static float InterpolateSorted(const std::vector<float> &vals, const double rank)
+{
+	const double r = rank<0.0 ? 0.0 : (rank>(vals.size()-1) ? (double) (vals.size()-1) : rank);
+	const size_t i0 = (size_t) r;
+	const size_t i1 = i0+1<vals.size() ? (i0+1) : i0;
+	const double t = r - (double) i0;
+	return (float) (vals[i0] + t*(vals[i1]-vals[i0]));
+}
+
+// the fetch done by hex2colTex_histo() with the clamp sampler
+static float SampleLUTRow(const SCpuImage &lut, const int row, const int c, const float u)
+{
+	float x = u*HISTO_LUT_WIDTH - 0.5f;
+	x = x<0.0f ? 0.0f : (x>(HISTO_LUT_WIDTH-1) ? (float) (HISTO_LUT_WIDTH-1) : x);
+	const int x0 = (int) x;
+	const int x1 = x0<(HISTO_LUT_WIDTH-1) ? (x0+1) : x0;
+	const float t = x - (float) x0;
+
+	const float v0 = GetCpuImagePixel(lut, x0, row)[c], v1 = GetCpuImagePixel(lut, x1, row)[c];
+	return v0 + t*(v1-v0);
+}
+
+bool BuildHistoPreservAssets(SHistoPreservAssets * pAssets, const SCpuImage &src,
+							 const int iMaxSamplesPerLevel, const int iNrThreads)
+{
+	memset(pAssets, 0, sizeof(SHistoPreservAssets));
+	const int width = src.iWidth, height = src.iHeight;
+	const int nrTexels = width*height;
+	if(width<=0 || height<=0 || iMaxSamplesPerLevel<=0) return false;
+
+	// mean and covariance
+	double fMean[3] = { 0.0, 0.0, 0.0 }, fCov[3][3];
+	memset(fCov, 0, sizeof(fCov));
+	for(int i=0; i<nrTexels; i++)
+		for(int c=0; c<3; c++) fMean[c] += src.pfPixels[4*i+c];
+	for(int c=0; c<3; c++) fMean[c] /= nrTexels;
+
+	for(int i=0; i<nrTexels; i++)
+	{
+		const float * pfCol = src.pfPixels + 4*i;
+		const double d[] = { pfCol[0]-fMean[0], pfCol[1]-fMean[1], pfCol[2]-fMean[2] };
+		for(int r=0; r<3; r++)
+			for(int c=0; c<3; c++) fCov[r][c] += d[r]*d[c];
+	}
+	for(int r=0; r<3; r++)
+		for(int c=0; c<3; c++) fCov[r][c] /= nrTexels;
+
+	double fAxis[3][3];
+	PrincipalAxes(fAxis, fCov);
+
+	// project onto the axes
+	std::vector<float> proj[3];
+	for(int k=0; k<3; k++) proj[k].resize(nrTexels);
+	ParallelFor(height, iNrThreads, [&](const int y, const int threadIdx)
+	{
+		(void) threadIdx;
+		for(int x=0; x<width; x++)
+		{
+			const int i = y*width+x;
+			const float * pfCol = src.pfPixels + 4*i;
+			const double d[] = { pfCol[0]-fMean[0], pfCol[1]-fMean[1], pfCol[2]-fMean[2] };
+			for(int k=0; k<3; k++) proj[k][i] = (float) (fAxis[k][0]*d[0] + fAxis[k][1]*d[1] + fAxis[k][2]*d[2]);
+		}
+	});
+
+	double fVari[3], fProjLo[3], fProjHi[3];
+	for(int k=0; k<3; k++)
+	{
+		fProjLo[k] = *std::min_element(proj[k].begin(), proj[k].end());
+		fProjHi[k] = *std::max_element(proj[k].begin(), proj[k].end());
+	}
+	ExtentVari(fVari, fProjLo, fProjHi);
+	pAssets->fVari[0] = (float) fVari[0]; pAssets->fVari[1] = (float) fVari[2];
+
+	// Gaussianize each channel by sorting. The 8 bit values stored in the png
+	// are kept, pre-scaled by vari, as the lookup coordinate the shader uses.
+	bool res = AllocCpuImage(&pAssets->transfer, width, height);
+	std::vector<float> lookup[3];
+	for(int k=0; k<3 && res; k++) lookup[k].resize(nrTexels);
+
+	if(res)
+	{
+		ParallelFor(3, iNrThreads, [&](const int k, const int threadIdx)
+		{
+			(void) threadIdx;
+			std::vector<int> idx(nrTexels);
+			for(int i=0; i<nrTexels; i++) idx[i] = i;
+			std::sort(idx.begin(), idx.end(), [&](const int a, const int b)
+				{ return proj[k][a]<proj[k][b] || (proj[k][a]==proj[k][b] && a<b); });
+
+			for(int r=0; r<nrTexels; r++)
+			{
+				const float q = QuantizeTransfer(GaussianTransfer(InvNormalCDF((r+0.5)/nrTexels), fVari[k]));
+
+				const int i = idx[r];
+				pAssets->transfer.pfPixels[4*i+k] = q;
+				lookup[k][i] = (float) (0.5 + (q-0.5)*fVari[k]);
+			}
+		});
+
+		for(int i=0; i<nrTexels; i++) pAssets->transfer.pfPixels[4*i+3] = 1.0f;
+	}
+
+	// one row per mip level of the transfer texture. Both the lookup
+	// coordinate and the projected color are box filtered over the footprint
+	// of the level and the row maps the quantiles of the first onto those of
+	// the second such that the histogram of each level is preserved.
+	const int iNrMips = GetNrMipLevels(width, height);
+	if(res) res = AllocCpuImage(&pAssets->invTransfer, HISTO_LUT_WIDTH, iNrMips);
+
+	std::vector<float> rowSums(res ? nrTexels : 0);
+	for(int m=0; m<iNrMips && res; m++)
+	{
+		const int fw = (1<<m)<width ? (1<<m) : width;
+		const int fh = (1<<m)<height ? (1<<m) : height;
+		int step = 1;
+		while(((double) ((width+step-1)/step))*((height+step-1)/step) > iMaxSamplesPerLevel) ++step;
+
+		for(int k=0; k<3; k++)
+		{
+			std::vector<float> u, d;
+			BoxFilterSampled(u, &lookup[k][0], width, height, fw, fh, step, &rowSums[0], iNrThreads);
+			BoxFilterSampled(d, &proj[k][0], width, height, fw, fh, step, &rowSums[0], iNrThreads);
+
+			ParallelFor(2, iNrThreads, [&](const int j, const int threadIdx)
+			{
+				(void) threadIdx;
+				std::vector<float> &vals = j==0 ? u : d;
+				std::sort(vals.begin(), vals.end());
+			});
+
+			for(int x=0; x<HISTO_LUT_WIDTH; x++)
+			{
+				const float uc = (x+0.5f)/HISTO_LUT_WIDTH;
+				GetCpuImagePixel(pAssets->invTransfer, x, m)[k] = InterpolateSorted(d, InterpolatedRank(u, uc));
+			}
+		}
+
+		for(int x=0; x<HISTO_LUT_WIDTH; x++) GetCpuImagePixel(pAssets->invTransfer, x, m)[3] = 1.0f;
+	}
+
+	if(res) res = BuildBasis(&pAssets->basis, fAxis, fMean, fVari);
+
+	// reconstruct level 0 as the shader would for a single tile
+	if(res)
+	{
+		std::vector<double> rowSqErr(height, 0.0);
+		std::vector<float> rowMaxErr(height, 0.0f);
+		ParallelFor(height, iNrThreads, [&](const int y, const int threadIdx)
+		{
+			(void) threadIdx;
+			for(int x=0; x<width; x++)
+			{
+				const int i = y*width+x;
+				float colH[3];
+				for(int k=0; k<3; k++) colH[k] = SampleLUTRow(pAssets->invTransfer, 0, k, lookup[k][i]);
+
+				for(int c=0; c<3; c++)
+				{
+					const float rec = (float) (fAxis[0][c]*colH[0] + fAxis[1][c]*colH[1] + fAxis[2][c]*colH[2] + fMean[c]);
+					const float err = fabsf(rec - src.pfPixels[4*i+c]);
+					rowSqErr[y] += err*err;
+					if(err>rowMaxErr[y]) rowMaxErr[y] = err;
+				}
+			}
+		});
+
+		double fSqErr = 0.0;
+		for(int y=0; y<height; y++)
+		{
+			fSqErr += rowSqErr[y];
+			if(rowMaxErr[y]>pAssets->fRoundTripMaxErr) pAssets->fRoundTripMaxErr = rowMaxErr[y];
+		}
+		pAssets->fRoundTripRmsErr = (float) sqrt(fSqErr / (3.0*nrTexels));
+	}
+
+	if(!res) FreeHistoPreservAssets(pAssets);
+
+	return res;
+}
+
+void FreeHistoPreservAssets(SHistoPreservAssets * pAssets)
+{
+	if(pAssets->transfer.pfPixels!=NULL) FreeCpuImage(&pAssets->transfer);
+	if(pAssets->invTransfer.pfPixels!=NULL) FreeCpuImage(&pAssets->invTransfer);
+	if(pAssets->basis.pfPixels!=NULL) FreeCpuImage(&pAssets->basis);
+}
+
+// fAxis and fMean as BuildBasis() stores them, fVari[1] is 1
+static void ReadBasis(double fAxis[3][3], double fMean[3], double fVari[3], const SCpuImage &basis)
+{
+	for(int r=0; r<3; r++)
+	{
+		fAxis[0][r] = GetCpuImagePixel(basis, 2*r+0, 1)[0];
+		fAxis[1][r] = GetCpuImagePixel(basis, 2*r+1, 1)[0];
+		fAxis[2][r] = GetCpuImagePixel(basis, 2*r+1, 0)[0];
+		fMean[r] = GetCpuImagePixel(basis, 2*r+0, 0)[0];
+	}
+	fVari[0] = GetCpuImagePixel(basis, 6, 1)[0];
+	fVari[1] = 1.0;
+	fVari[2] = GetCpuImagePixel(basis, 7, 1)[0];
+}
+
+// lookup coordinate u at which SampleLUTRow() of the non decreasing pfRow[]
+// gives v, the middle of a run of equal entries.
+static double InvertLUTRow(const float pfRow[], const float v)
+{
+	const int lo = (int) (std::lower_bound(pfRow, pfRow+HISTO_LUT_WIDTH, v) - pfRow);
+	const int hi = (int) (std::upper_bound(pfRow, pfRow+HISTO_LUT_WIDTH, v) - pfRow);
+
+	double x;
+	if(lo<hi) x = 0.5*(lo+hi-1);
+	else if(lo==0) return 0.0;
+	else if(lo==HISTO_LUT_WIDTH) return 1.0;
+	else x = (lo-1) + ((double) v-pfRow[lo-1])/((double) pfRow[lo]-pfRow[lo-1]);
+
+	return (x+0.5)/HISTO_LUT_WIDTH;
+}
+
+bool HistoTransferFromAssets(float pfDst[], const float pfSrc[], const size_t uNrTexels,
+							 const SCpuImage &invTransfer, const SCpuImage &basis, const int iNrThreads)
+{
+	if(invTransfer.iWidth!=HISTO_LUT_WIDTH || basis.iWidth!=8 || basis.iHeight!=2) return false;
+
+	double fAxis[3][3], fMean[3], fVari[3];
+	ReadBasis(fAxis, fMean, fVari, basis);
+	if(fVari[0]<=0.0 || fVari[2]<=0.0) return false;
+
+	// rgb - mean = A*proj where column k of A is fAxis[k]
+	const double fDet = fAxis[0][0]*(fAxis[1][1]*fAxis[2][2]-fAxis[2][1]*fAxis[1][2]) -
+						fAxis[1][0]*(fAxis[0][1]*fAxis[2][2]-fAxis[2][1]*fAxis[0][2]) +
+						fAxis[2][0]*(fAxis[0][1]*fAxis[1][2]-fAxis[1][1]*fAxis[0][2]);
+	if(fabs(fDet)<1e-12) return false;
+
+	double fInv[3][3];
+	for(int k=0; k<3; k++)
+	{
+		const int k1 = (k+1)%3, k2 = (k+2)%3;
+		for(int c=0; c<3; c++)
+		{
+			const int c1 = (c+1)%3, c2 = (c+2)%3;
+			fInv[k][c] = (fAxis[k1][c1]*fAxis[k2][c2] - fAxis[k1][c2]*fAxis[k2][c1]) / fDet;
+		}
+	}
+
+	// row 0 per channel, made non decreasing
+	std::vector<float> row[3];
+	for(int k=0; k<3; k++)
+	{
+		row[k].resize(HISTO_LUT_WIDTH);
+		for(int x=0; x<HISTO_LUT_WIDTH; x++)
+		{
+			const float v = GetCpuImagePixel(invTransfer, x, 0)[k];
+			row[k][x] = x>0 && v<row[k][x-1] ? row[k][x-1] : v;
+		}
+	}
+
+	const int iBlockSize = 4096;
+	const int iNrBlocks = (int) ((uNrTexels+iBlockSize-1)/iBlockSize);
+	ParallelFor(iNrBlocks, iNrThreads, [&](const int b, const int threadIdx)
+	{
+		(void) threadIdx;
+		const size_t i1 = ((size_t) b+1)*iBlockSize<uNrTexels ? (((size_t) b+1)*iBlockSize) : uNrTexels;
+		for(size_t i=((size_t) b)*iBlockSize; i<i1; i++)
+		{
+			const float * pfCol = pfSrc + 4*i;
+			const double d[] = { pfCol[0]-fMean[0], pfCol[1]-fMean[1], pfCol[2]-fMean[2] };
+			for(int k=0; k<3; k++)
+			{
+				const float proj = (float) (fInv[k][0]*d[0] + fInv[k][1]*d[1] + fInv[k][2]*d[2]);
+				pfDst[4*i+k] = QuantizeTransfer(0.5 + (InvertLUTRow(&row[k][0], proj)-0.5)/fVari[k]);
+			}
+			pfDst[4*i+3] = 1.0f;
+		}
+	});
+
+	return true;
+}
+
+#define HISTO_GAUSS_BINS	(1<<16)
+#define HISTO_LEVEL_BINS	4096
+
+// bins of equal width over [fMin; fMax] keeping the count and the sum of
+// the values per bin such that each bin is represented by its mean.
+struct SStreamHisto
+{
+	double fMin, fMax;
+	double fLo, fHi;			// smallest and largest value added
+	std::vector<double> count, sum;
+};
+
+static void InitStreamHisto(SStreamHisto * pHisto, const double fMin, const double fMax, const int iNrBins)
+{
+	pHisto->fMin = fMin; pHisto->fMax = fMax>fMin ? fMax : (fMin+1e-6);
+	pHisto->fLo = pHisto->fMax; pHisto->fHi = pHisto->fMin;
+	pHisto->count.assign(iNrBins, 0.0);
+	pHisto->sum.assign(iNrBins, 0.0);
+}
+
+static inline int GetStreamHistoBin(const SStreamHisto &histo, const double v)
+{
+	const int iNrBins = (int) histo.count.size();
+	const int b = (int) ((v-histo.fMin)*(iNrBins/(histo.fMax-histo.fMin)));
+	return b<0 ? 0 : (b>(iNrBins-1) ? (iNrBins-1) : b);
+}
+
+static inline void AddToStreamHisto(SStreamHisto * pHisto, const float v)
+{
+	const int b = GetStreamHistoBin(*pHisto, v);
+	pHisto->count[b] += 1.0; pHisto->sum[b] += v;
+	if(v<pHisto->fLo) pHisto->fLo = v;
+	if(v>pHisto->fHi) pHisto->fHi = v;
+}
+
+static void MergeStreamHisto(SStreamHisto * pHisto, const SStreamHisto &other)
+{
+	for(size_t b=0; b<pHisto->count.size(); b++)
+	{
+		pHisto->count[b] += other.count[b]; pHisto->sum[b] += other.sum[b];
+	}
+	if(other.fLo<pHisto->fLo) pHisto->fLo = other.fLo;
+	if(other.fHi>pHisto->fHi) pHisto->fHi = other.fHi;
+}
+
+// The CDF as a piecewise linear function through the mean of each non empty
+// bin at the midpoint of its ranks, plus the extremes at rank 0 and N-1.
+// This is InterpolatedRank() and InterpolateSorted() of the sorting version
+// with the values of a bin merged.
+struct SHistoCDF
+{
+	std::vector<double> vals, ranks;
+	double fNrValues;
+};
+
+static void BuildHistoCDF(SHistoCDF * pCDF, const SStreamHisto &histo)
+{
+	pCDF->vals.clear(); pCDF->ranks.clear();
+	double cum = 0.0;
+	for(size_t b=0; b<histo.count.size(); b++) cum += histo.count[b];
+	pCDF->fNrValues = cum;
+	if(cum==0.0) return;
+
+	pCDF->vals.push_back(histo.fLo); pCDF->ranks.push_back(0.0);
+	cum = 0.0;
+	for(size_t b=0; b<histo.count.size(); b++)
+	{
+		if(histo.count[b]==0.0) continue;
+		pCDF->vals.push_back(histo.sum[b]/histo.count[b]);
+		pCDF->ranks.push_back(cum + 0.5*(histo.count[b]-1.0));
+		cum += histo.count[b];
+	}
+	pCDF->vals.push_back(histo.fHi); pCDF->ranks.push_back(cum-1.0);
+}
+
+static double PiecewiseLinear(const std::vector<double> &xs, const std::vector<double> &ys, const double x)
+{
+	if(x<=xs.front()) return ys.front();
+	if(x>=xs.back()) return ys.back();
+
+	const size_t a = std::upper_bound(xs.begin(), xs.end(), x) - xs.begin();
+	const double x0 = xs[a-1], x1 = xs[a];
+	const double t = x1>x0 ? ((x-x0)/(x1-x0)) : 1.0;
+	return ys[a-1] + t*(ys[a]-ys[a-1]);
+}
+
+static double HistoRankAt(const SHistoCDF &cdf, const double v)
+{
+	if(v<cdf.vals.front()) return 0.0;
+	if(v>cdf.vals.back()) return cdf.fNrValues-1.0;
+	return PiecewiseLinear(cdf.vals, cdf.ranks, v);
+}
+
+static double HistoValueAtRank(const SHistoCDF &cdf, const double rank)
+{
+	return PiecewiseLinear(cdf.ranks, cdf.vals, rank);
+}
+
+// Mip pyramid of a single quantity which keeps two rows per level. Every
+// texel of level 0 and every 2x2 window, with wrap, of level m-1 is added to
+// the histogram of level m.
+struct SPyramidLevel
+{
+	int iWidth, iHeight, iRowsSeen;
+	std::vector<float> prevRow, firstRow, reduced;
+};
+
+struct SStreamPyramid
+{
+	std::vector<SPyramidLevel> levels;
+	std::vector<SStreamHisto> histos;
+};
+
+static void InitStreamPyramid(SStreamPyramid * pPyr, const int width, const int height, const double fMin, const double fMax)
+{
+	const int iNrLevels = GetNrMipLevels(width, height);
+	pPyr->levels.resize(iNrLevels);
+	pPyr->histos.resize(iNrLevels);
+
+	int w = width, h = height;
+	for(int l=0; l<iNrLevels; l++)
+	{
+		SPyramidLevel &level = pPyr->levels[l];
+		level.iWidth = w; level.iHeight = h; level.iRowsSeen = 0;
+		level.prevRow.resize(w); level.firstRow.resize(w);
+		w = w>1 ? (w>>1) : 1; h = h>1 ? (h>>1) : 1;
+		level.reduced.resize(w);
+
+		InitStreamHisto(&pPyr->histos[l], fMin, fMax, HISTO_LEVEL_BINS);
+	}
+}
+
+static void AddWindowsToHisto(SStreamHisto * pHisto, const float pfRow0[], const float pfRow1[], const int width)
+{
+	for(int x=0; x<width; x++)
+	{
+		const int x1 = (x+1)<width ? (x+1) : 0;
+		AddToStreamHisto(pHisto, 0.25f*(pfRow0[x]+pfRow0[x1]+pfRow1[x]+pfRow1[x1]));
+	}
+}
+
+static void PushPyramidRow(SStreamPyramid * pPyr, const int l, const float pfRow[])
+{
+	SPyramidLevel &level = pPyr->levels[l];
+	const int w = level.iWidth, r = level.iRowsSeen++;
+
+	if(l==0)
+	{
+		for(int x=0; x<w; x++) AddToStreamHisto(&pPyr->histos[0], pfRow[x]);
+	}
+
+	if((l+1)<(int) pPyr->levels.size())
+	{
+		SStreamHisto * pNext = &pPyr->histos[l+1];
+		if(r==0) memcpy(&level.firstRow[0], pfRow, w*sizeof(float));
+		else AddWindowsToHisto(pNext, &level.prevRow[0], pfRow, w);
+		if(r==(level.iHeight-1)) AddWindowsToHisto(pNext, pfRow, &level.firstRow[0], w);
+
+		// same reduction as BuildMipChainWrap()
+		if(level.iHeight==1 || (r&1)!=0)
+		{
+			const float * pfRow0 = level.iHeight==1 ? pfRow : &level.prevRow[0];
+			const int wr = (int) level.reduced.size();
+			for(int x=0; x<wr; x++)
+			{
+				const int x0 = (2*x)%w, x1 = (2*x+1)%w;
+				level.reduced[x] = 0.25f*(pfRow0[x0]+pfRow0[x1]+pfRow[x0]+pfRow[x1]);
+			}
+			PushPyramidRow(pPyr, l+1, &level.reduced[0]);
+		}
+	}
+
+	memcpy(&level.prevRow[0], pfRow, w*sizeof(float));
+}
+
+bool BuildHistoPreservAssetsStreaming(SHistoPreservAssets * pAssets, const SHistoStreamParams &params)
+{
+	memset(pAssets, 0, sizeof(SHistoPreservAssets));
+	const int width = params.iWidth, height = params.iHeight;
+	if(width<=0 || height<=0 || params.pReadRows==NULL) return false;
+
+	const int iNrThreads = params.iNrThreads>0 ? params.iNrThreads : GetDefaultNrThreads();
+	const int iNrLevels = GetNrMipLevels(width, height);
+
+	// what does not depend on the strip height: histograms of pass two per
+	// thread and the six pyramids of pass three.
+	const size_t uFixed = ((size_t) iNrThreads)*3*HISTO_GAUSS_BINS*2*sizeof(double) +
+						  ((size_t) 6)*iNrLevels*HISTO_LEVEL_BINS*2*sizeof(double) + ((size_t) 6)*6*width*sizeof(float);
+	const size_t uPerRow = ((size_t) width)*(4+4+6)*sizeof(float);
+	const size_t uStrip = params.uMemoryBudget>uFixed ? ((params.uMemoryBudget-uFixed)/uPerRow) : 1;
+	const int iStripHeight = uStrip<1 ? 1 : (uStrip>(size_t) height ? height : (int) uStrip);
+
+	std::vector<float> strip(((size_t) 4)*width*iStripHeight);
+
+	// pass one, mean, covariance and the bounds of each channel
+	struct SMoments { double fSum[3], fSumSq[3][3], fLo[3], fHi[3]; };
+	std::vector<SMoments> moments(iNrThreads);
+	for(int t=0; t<iNrThreads; t++)
+	{
+		memset(&moments[t], 0, sizeof(SMoments));
+		for(int c=0; c<3; c++) { moments[t].fLo[c] = 1e30; moments[t].fHi[c] = -1e30; }
+	}
+
+	bool res = true;
+	for(int y0=0; y0<height && res; y0+=iStripHeight)
+	{
+		const int nrRows = (y0+iStripHeight)<=height ? iStripHeight : (height-y0);
+		res = params.pReadRows(&strip[0], y0, nrRows, params.pUserData);
+		if(res) ParallelFor(nrRows, iNrThreads, [&](const int y, const int threadIdx)
+		{
+			SMoments &m = moments[threadIdx];
+			const float * pfRow = &strip[((size_t) 4)*width*y];
+			for(int x=0; x<width; x++)
+			{
+				const float * pfCol = pfRow + 4*x;
+				for(int r=0; r<3; r++)
+				{
+					m.fSum[r] += pfCol[r];
+					for(int c=0; c<3; c++) m.fSumSq[r][c] += ((double) pfCol[r])*pfCol[c];
+					if(pfCol[r]<m.fLo[r]) m.fLo[r] = pfCol[r];
+					if(pfCol[r]>m.fHi[r]) m.fHi[r] = pfCol[r];
+				}
+			}
+		});
+	}
+	if(!res) return false;
+
+	const double fNrTexels = ((double) width)*height;
+	double fMean[3] = { 0.0, 0.0, 0.0 }, fCov[3][3], fLo[3] = { 1e30, 1e30, 1e30 }, fHi[3] = { -1e30, -1e30, -1e30 };
+	memset(fCov, 0, sizeof(fCov));
+	for(int t=0; t<iNrThreads; t++)
+		for(int r=0; r<3; r++)
+		{
+			fMean[r] += moments[t].fSum[r];
+			for(int c=0; c<3; c++) fCov[r][c] += moments[t].fSumSq[r][c];
+			if(moments[t].fLo[r]<fLo[r]) fLo[r] = moments[t].fLo[r];
+			if(moments[t].fHi[r]>fHi[r]) fHi[r] = moments[t].fHi[r];
+		}
+	for(int r=0; r<3; r++) fMean[r] /= fNrTexels;
+	for(int r=0; r<3; r++)
+		for(int c=0; c<3; c++) fCov[r][c] = fCov[r][c]/fNrTexels - fMean[r]*fMean[c];
+
+	double fAxis[3][3];
+	PrincipalAxes(fAxis, fCov);
+
+	// bounds of the projections from the corners of the color bounds
+	double fProjLo[3], fProjHi[3];
+	for(int k=0; k<3; k++)
+	{
+		fProjLo[k] = 0.0; fProjHi[k] = 0.0;
+		for(int c=0; c<3; c++)
+		{
+			const double a = fAxis[k][c]*(fLo[c]-fMean[c]), b = fAxis[k][c]*(fHi[c]-fMean[c]);
+			fProjLo[k] += a<b ? a : b; fProjHi[k] += a<b ? b : a;
+		}
+	}
+
+	// pass two, histograms of the projections in place of the sort
+	std::vector<SStreamHisto> gauss(3*iNrThreads);
+	for(int t=0; t<iNrThreads; t++)
+		for(int k=0; k<3; k++) InitStreamHisto(&gauss[3*t+k], fProjLo[k], fProjHi[k], HISTO_GAUSS_BINS);
+
+	for(int y0=0; y0<height && res; y0+=iStripHeight)
+	{
+		const int nrRows = (y0+iStripHeight)<=height ? iStripHeight : (height-y0);
+		res = params.pReadRows(&strip[0], y0, nrRows, params.pUserData);
+		if(res) ParallelFor(nrRows, iNrThreads, [&](const int y, const int threadIdx)
+		{
+			const float * pfRow = &strip[((size_t) 4)*width*y];
+			for(int x=0; x<width; x++)
+			{
+				const float * pfCol = pfRow + 4*x;
+				const double d[] = { pfCol[0]-fMean[0], pfCol[1]-fMean[1], pfCol[2]-fMean[2] };
+				for(int k=0; k<3; k++)
+					AddToStreamHisto(&gauss[3*threadIdx+k], (float) (fAxis[k][0]*d[0] + fAxis[k][1]*d[1] + fAxis[k][2]*d[2]));
+			}
+		});
+	}
+	if(!res) return false;
+
+	for(int k=0; k<3; k++)
+		for(int t=1; t<iNrThreads; t++) MergeStreamHisto(&gauss[k], gauss[3*t+k]);
+
+	double fVari[3];
+	const double fGaussLo[] = { gauss[0].fLo, gauss[1].fLo, gauss[2].fLo }, fGaussHi[] = { gauss[0].fHi, gauss[1].fHi, gauss[2].fHi };
+	ExtentVari(fVari, fGaussLo, fGaussHi);
+	pAssets->fVari[0] = (float) fVari[0]; pAssets->fVari[1] = (float) fVari[2];
+
+	// transfer at the bin edges, interpolated per texel in pass three
+	std::vector<float> edgeTransfer[3];
+	for(int k=0; k<3; k++)
+	{
+		SHistoCDF cdf;
+		BuildHistoCDF(&cdf, gauss[k]);
+		edgeTransfer[k].resize(HISTO_GAUSS_BINS+1);
+		for(int b=0; b<=HISTO_GAUSS_BINS; b++)
+		{
+			const double v = fProjLo[k] + (b*(gauss[k].fMax-gauss[k].fMin))/HISTO_GAUSS_BINS;
+			const double p = (HistoRankAt(cdf, v)+0.5)/fNrTexels;
+			edgeTransfer[k][b] = (float) GaussianTransfer(InvNormalCDF(p), fVari[k]);
+		}
+	}
+	gauss.clear();
+
+	// pass three, transfer and the pyramids of the lookup coordinate and the
+	// projected color per channel.
+	SStreamPyramid pyramids[6];
+	for(int k=0; k<3; k++)
+	{
+		InitStreamPyramid(&pyramids[k], width, height, 0.5-0.5*fVari[k], 0.5+0.5*fVari[k]);
+		InitStreamPyramid(&pyramids[3+k], width, height, fProjLo[k], fProjHi[k]);
+	}
+
+	std::vector<float> transfer(((size_t) 4)*width*iStripHeight);
+	std::vector<float> quantities(((size_t) 6)*width*iStripHeight);
+	for(int y0=0; y0<height && res; y0+=iStripHeight)
+	{
+		const int nrRows = (y0+iStripHeight)<=height ? iStripHeight : (height-y0);
+		res = params.pReadRows(&strip[0], y0, nrRows, params.pUserData);
+		if(res) ParallelFor(nrRows, iNrThreads, [&](const int y, const int threadIdx)
+		{
+			(void) threadIdx;
+			for(int x=0; x<width; x++)
+			{
+				const size_t i = ((size_t) width)*y + x;
+				const float * pfCol = &strip[4*i];
+				const double d[] = { pfCol[0]-fMean[0], pfCol[1]-fMean[1], pfCol[2]-fMean[2] };
+				for(int k=0; k<3; k++)
+				{
+					const float proj = (float) (fAxis[k][0]*d[0] + fAxis[k][1]*d[1] + fAxis[k][2]*d[2]);
+					const double fBin = (proj-fProjLo[k])*(HISTO_GAUSS_BINS/(fProjHi[k]-fProjLo[k]>0.0 ? (fProjHi[k]-fProjLo[k]) : 1e-6));
+					const int b = fBin<0.0 ? 0 : (fBin>=HISTO_GAUSS_BINS ? (HISTO_GAUSS_BINS-1) : (int) fBin);
+					const double t = fBin - b;
+					const float q = QuantizeTransfer(edgeTransfer[k][b] + t*(edgeTransfer[k][b+1]-edgeTransfer[k][b]));
+
+					transfer[4*i+k] = q;
+					quantities[((size_t) k)*width*iStripHeight + i] = (float) (0.5 + (q-0.5)*fVari[k]);
+					quantities[((size_t) (3+k))*width*iStripHeight + i] = proj;
+				}
+				transfer[4*i+3] = 1.0f;
+			}
+		});
+
+		if(res && params.pWriteRows!=NULL) res = params.pWriteRows(&transfer[0], y0, nrRows, params.pUserData);
+		if(res) ParallelFor(6, iNrThreads, [&](const int j, const int threadIdx)
+		{
+			(void) threadIdx;
+			for(int y=0; y<nrRows; y++)
+				PushPyramidRow(&pyramids[j], 0, &quantities[((size_t) j)*width*iStripHeight + ((size_t) width)*y]);
+		});
+	}
+
+	if(res) res = AllocCpuImage(&pAssets->invTransfer, HISTO_LUT_WIDTH, iNrLevels);
+	for(int m=0; m<iNrLevels && res; m++)
+	{
+		for(int k=0; k<3; k++)
+		{
+			SHistoCDF cdfU, cdfD;
+			BuildHistoCDF(&cdfU, pyramids[k].histos[m]);
+			BuildHistoCDF(&cdfD, pyramids[3+k].histos[m]);
+			for(int x=0; x<HISTO_LUT_WIDTH; x++)
+			{
+				const float uc = (x+0.5f)/HISTO_LUT_WIDTH;
+				GetCpuImagePixel(pAssets->invTransfer, x, m)[k] = (float) HistoValueAtRank(cdfD, HistoRankAt(cdfU, uc));
+			}
+		}
+		for(int x=0; x<HISTO_LUT_WIDTH; x++) GetCpuImagePixel(pAssets->invTransfer, x, m)[3] = 1.0f;
+	}
+
+	if(res) res = BuildBasis(&pAssets->basis, fAxis, fMean, fVari);
+	if(!res) FreeHistoPreservAssets(pAssets);
+
+	return res;
+}
+
+#ifdef _WIN32
+static bool SaveHistoPreservDDS(const wchar_t dstBaseName[], const SHistoPreservAssets &assets)
+{
+	wchar_t dstName[512];
+	char dstNameDDS[512];
+
+	wcscpy(dstName, dstBaseName); wcscat(dstName, L"_invtransfer.dds");
+	bool res = wcstombs(dstNameDDS, dstName, sizeof(dstNameDDS))<sizeof(dstNameDDS);
+	if(res) res = SaveCpuImageDDS(dstNameDDS, &assets.invTransfer, 1);
+
+	wcscpy(dstName, dstBaseName); wcscat(dstName, L"_basis.dds");
+	if(res) res = wcstombs(dstNameDDS, dstName, sizeof(dstNameDDS))<sizeof(dstNameDDS);
+	if(res) res = SaveCpuImageDDS(dstNameDDS, &assets.basis, 1);
+
+	return res;
+}
+
+bool HistoPreservTextureFiles(const wchar_t dstBaseName[], const wchar_t srcName[], const bool sRGB,
+							  SHistoPreservAssets * pAssets, const int iNrThreads)
+{
+	SCpuImage src;
+	const bool bLoaded = LoadCpuImage(&src, srcName, sRGB);
+
+	SHistoPreservAssets assets;
+	bool res = bLoaded && BuildHistoPreservAssets(&assets, src, (1<<20), iNrThreads);
+	if(bLoaded) FreeCpuImage(&src);
+
+	if(res)
+	{
+		wchar_t dstName[512];
+		wcscpy(dstName, dstBaseName); wcscat(dstName, L"_transfer.png");
+		res = SaveCpuImagePNG(dstName, assets.transfer);
+		if(res) res = SaveHistoPreservDDS(dstBaseName, assets);
+
+		if(pAssets!=NULL) *pAssets = assets;
+		else FreeHistoPreservAssets(&assets);
+	}
+
+	return res;
+}
+
+// strips are decoded by WIC directly, see LoadCpuImage(), and the transfer is
+// either encoded by WIC as in SaveCpuImagePNG() or kept as 8 bit rgba in pRGBA.
+struct SWICStreams
+{
+	IWICImagingFactory * pFactory;
+	IWICBitmapDecoder * pDecoder;
+	IWICBitmapFrameDecode * pSrcFrame;
+	IWICFormatConverter * pConverter;
+	IWICBitmapFrameEncode * pFrame;
+	std::vector<unsigned char> * pRGBA;
+	bool bSRGB;
+	int iWidth, iHeight;
+	std::vector<unsigned short> srcRows;
+	std::vector<unsigned char> dstRows;
+};
+
+static bool OpenSourceWIC(SWICStreams * pStreams, const wchar_t srcName[], const bool sRGB)
+{
+	pStreams->pFactory = NULL; pStreams->pDecoder = NULL; pStreams->pSrcFrame = NULL;
+	pStreams->pConverter = NULL; pStreams->pFrame = NULL; pStreams->pRGBA = NULL;
+	pStreams->bSRGB = sRGB;
+
+	UINT width = 0, height = 0;
+	bool res = SUCCEEDED( CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pStreams->pFactory)) );
+	if(res) res = SUCCEEDED( pStreams->pFactory->CreateDecoderFromFilename(srcName, NULL, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &pStreams->pDecoder) );
+	if(res) res = SUCCEEDED( pStreams->pDecoder->GetFrame(0, &pStreams->pSrcFrame) );
+	if(res) res = SUCCEEDED( pStreams->pSrcFrame->GetSize(&width, &height) );
+	if(res) res = SUCCEEDED( pStreams->pFactory->CreateFormatConverter(&pStreams->pConverter) );
+	if(res) res = SUCCEEDED( pStreams->pConverter->Initialize(pStreams->pSrcFrame, GUID_WICPixelFormat64bppRGBA, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom) );
+	pStreams->iWidth = (int) width; pStreams->iHeight = (int) height;
+
+	return res;
+}
+
+static void CloseStreamsWIC(SWICStreams * pStreams)
+{
+	if(pStreams->pFrame!=NULL) pStreams->pFrame->Release();
+	if(pStreams->pConverter!=NULL) pStreams->pConverter->Release();
+	if(pStreams->pSrcFrame!=NULL) pStreams->pSrcFrame->Release();
+	if(pStreams->pDecoder!=NULL) pStreams->pDecoder->Release();
+	if(pStreams->pFactory!=NULL) pStreams->pFactory->Release();
+}
+
+static bool ReadRowsWIC(float pfDst[], const int y0, const int nrRows, void * pUserData)
+{
+	SWICStreams * pStreams = (SWICStreams *) pUserData;
+	const int w = pStreams->iWidth;
+	pStreams->srcRows.resize(((size_t) 4)*w*nrRows);
+
+	const WICRect rect = { 0, y0, w, nrRows };
+	if(FAILED( pStreams->pConverter->CopyPixels(&rect, w*4*sizeof(unsigned short), (UINT) (pStreams->srcRows.size()*sizeof(unsigned short)),
+												(BYTE *) &pStreams->srcRows[0]) )) return false;
+
+	for(size_t i=0; i<pStreams->srcRows.size(); i++)
+	{
+		const float c = pStreams->srcRows[i] / 65535.0f;
+		pfDst[i] = (pStreams->bSRGB && (i&3)!=3) ? (c<=0.04045f ? (c/12.92f) : powf((c+0.055f)/1.055f, 2.4f)) : c;
+	}
+
+	return true;
+}
+
+static bool WriteRowsWIC(const float pfSrc[], const int y0, const int nrRows, void * pUserData)
+{
+	SWICStreams * pStreams = (SWICStreams *) pUserData;
+	const int w = pStreams->iWidth;
+
+	if(pStreams->pRGBA!=NULL)
+	{
+		unsigned char * pDst = &(*pStreams->pRGBA)[((size_t) 4)*w*y0];
+		for(size_t i=0; i<((size_t) 4)*w*nrRows; i++)
+			pDst[i] = (unsigned char) (255.0f*pfSrc[i] + 0.5f);
+		return true;
+	}
+
+	pStreams->dstRows.resize(((size_t) 3)*w*nrRows);
+	for(size_t i=0; i<((size_t) w)*nrRows; i++)
+		for(int c=0; c<3; c++)
+			pStreams->dstRows[3*i+2-c] = (unsigned char) (255.0f*pfSrc[4*i+c] + 0.5f);
+
+	return SUCCEEDED( pStreams->pFrame->WritePixels(nrRows, 3*w, (UINT) pStreams->dstRows.size(), &pStreams->dstRows[0]) );
+}
+
+static bool BuildAssetsWIC(SHistoPreservAssets * pAssets, SWICStreams * pStreams, const size_t uMemoryBudget, const int iNrThreads)
+{
+	SHistoStreamParams params;
+	params.iWidth = pStreams->iWidth; params.iHeight = pStreams->iHeight;
+	params.pReadRows = ReadRowsWIC; params.pWriteRows = WriteRowsWIC;
+	params.pUserData = pStreams;
+	params.uMemoryBudget = uMemoryBudget;
+	params.iNrThreads = iNrThreads;
+
+	return BuildHistoPreservAssetsStreaming(pAssets, params);
+}
+
+bool HistoPreservTextureFilesStreaming(const wchar_t dstBaseName[], const wchar_t srcName[], const bool sRGB,
+									   const size_t uMemoryBudget, const int iNrThreads)
+{
+	IWICStream * pStream = NULL;
+	IWICBitmapEncoder * pEncoder = NULL;
+
+	SWICStreams streams;
+	bool res = OpenSourceWIC(&streams, srcName, sRGB);
+
+	wchar_t dstName[512];
+	wcscpy(dstName, dstBaseName); wcscat(dstName, L"_transfer.png");
+	if(res) res = SUCCEEDED( streams.pFactory->CreateStream(&pStream) );
+	if(res) res = SUCCEEDED( pStream->InitializeFromFilename(dstName, GENERIC_WRITE) );
+	if(res) res = SUCCEEDED( streams.pFactory->CreateEncoder(GUID_ContainerFormatPng, NULL, &pEncoder) );
+	if(res) res = SUCCEEDED( pEncoder->Initialize(pStream, WICBitmapEncoderNoCache) );
+	if(res) res = SUCCEEDED( pEncoder->CreateNewFrame(&streams.pFrame, NULL) );
+	if(res) res = SUCCEEDED( streams.pFrame->Initialize(NULL) );
+	if(res) res = SUCCEEDED( streams.pFrame->SetSize(streams.iWidth, streams.iHeight) );
+
+	WICPixelFormatGUID format = GUID_WICPixelFormat24bppBGR;
+	if(res) res = SUCCEEDED( streams.pFrame->SetPixelFormat(&format) ) && IsEqualGUID(format, GUID_WICPixelFormat24bppBGR);
+
+	SHistoPreservAssets assets;
+	memset(&assets, 0, sizeof(assets));
+	if(res) res = BuildAssetsWIC(&assets, &streams, uMemoryBudget, iNrThreads);
+	if(res) res = SUCCEEDED( streams.pFrame->Commit() );
+	if(res) res = SUCCEEDED( pEncoder->Commit() );
+	if(res) res = SaveHistoPreservDDS(dstBaseName, assets);
+	FreeHistoPreservAssets(&assets);
+
+	CloseStreamsWIC(&streams);
+	if(pEncoder!=NULL) pEncoder->Release();
+	if(pStream!=NULL) pStream->Release();
+
+	return res;
+}
+
+bool HistoPreservAssetsFromFile(SHistoPreservAssets * pAssets, std::vector<unsigned char> &rgba, int * piWidth, int * piHeight,
+								const wchar_t srcName[], const bool sRGB, const size_t uMemoryBudget, const int iNrThreads)
+{
+	memset(pAssets, 0, sizeof(SHistoPreservAssets));
+
+	SWICStreams streams;
+	bool res = OpenSourceWIC(&streams, srcName, sRGB);
+	if(res)
+	{
+		rgba.resize(((size_t) 4)*streams.iWidth*streams.iHeight);
+		streams.pRGBA = &rgba;
+		res = BuildAssetsWIC(pAssets, &streams, uMemoryBudget, iNrThreads);
+	}
+	*piWidth = streams.iWidth; *piHeight = streams.iHeight;
+	CloseStreamsWIC(&streams);
+
+	return res;
+}
+
+bool HistoTransferFromFile(std::vector<unsigned char> &rgba, int * piWidth, int * piHeight, const wchar_t srcName[], const bool sRGB,
+						   const SCpuImage &invTransfer, const SCpuImage &basis, const size_t uMemoryBudget, const int iNrThreads)
+{
+	SWICStreams streams;
+	bool res = OpenSourceWIC(&streams, srcName, sRGB);
+	const int width = streams.iWidth, height = streams.iHeight;
+	if(res)
+	{
+		rgba.resize(((size_t) 4)*width*height);
+		streams.pRGBA = &rgba;
+
+		const size_t uStrip = uMemoryBudget / (((size_t) width)*(4+4)*sizeof(float));
+		const int iStripHeight = uStrip<1 ? 1 : (uStrip>(size_t) height ? height : (int) uStrip);
+		std::vector<float> src(((size_t) 4)*width*iStripHeight), transfer(((size_t) 4)*width*iStripHeight);
+		for(int y0=0; y0<height && res; y0+=iStripHeight)
+		{
+			const int nrRows = (y0+iStripHeight)<=height ? iStripHeight : (height-y0);
+			res = ReadRowsWIC(&src[0], y0, nrRows, &streams);
+			if(res) res = HistoTransferFromAssets(&transfer[0], &src[0], ((size_t) width)*nrRows, invTransfer, basis, iNrThreads);
+			if(res) res = WriteRowsWIC(&transfer[0], y0, nrRows, &streams);
+		}
+	}
+	*piWidth = width; *piHeight = height;
+	CloseStreamsWIC(&streams);
+
+	return res;
+}
+#endif
@@ -0,0 +1,100 @@
+#ifndef __HISTOPRESERV_H__
+#define __HISTOPRESERV_H__
+
+#include "cpu_image.h"
+#include <stddef.h>
+#include <vector>
+
+// Offline generator of the three textures ImportTextureTRX() loads next to
+// a detail texture for hex2colTex_histo() in shader_lighting.hlsl:
+//
+// _transfer.png	the colors projected onto the principal axes and made
+//					Gaussian per channel, 0.5 + N(0,1)/8 clamped to [0;1] for
+//					the axis of largest variance (.y) and scaled down by 1/vari
+//					for .x and .z.
+// _invtransfer.dds	HISTO_LUT_WIDTH x nr mips of _transfer, row m maps the
+//					blended Gaussian back to the projected color at mip m.
+// _basis.dds		8 x 2 texels read by Gather(). Texels (2r,1), (2r+1,1),
+//					(2r+1,0) and (2r,0) hold row r of the 3x4 matrix from the
+//					projected color back to rgb, (6,1) and (7,1) hold vari.
+
+#define HISTO_LUT_WIDTH		256
+
+struct SHistoPreservAssets
+{
+	SCpuImage transfer;			// rgb holds the 8 bit values as they will be stored
+	SCpuImage invTransfer;
+	SCpuImage basis;
+
+	float fVari[2];				// extent of the projections along .y over the one along .x and .z
+
+	// source at level 0 against invTransfer row 0 applied to transfer
+	float fRoundTripRmsErr, fRoundTripMaxErr;
+};
+
+// src is linear rgb. The rows of invTransfer are prefiltered such that each
+// mip level keeps the histogram of the box filtered source at that level.
+// Level m is measured from the box filtered transfer and source at up to
+// iMaxSamplesPerLevel footprints, any offset, with wrap addressing.
+bool BuildHistoPreservAssets(SHistoPreservAssets * pAssets, const SCpuImage &src,
+							 const int iMaxSamplesPerLevel=(1<<20), const int iNrThreads=0);
+void FreeHistoPreservAssets(SHistoPreservAssets * pAssets);
+
+// Transfer of uNrTexels rgba texels of the source for an existing invTransfer
+// and basis, such as the _invtransfer.dds and _basis.dds in textures/ which
+// ship without their _transfer.png. Each color is projected with the inverse
+// of the basis and mapped through the inverse of row 0 of invTransfer. pfDst
+// receives the 8 bit values as BuildHistoPreservAssets() stores them.
+bool HistoTransferFromAssets(float pfDst[], const float pfSrc[], const size_t uNrTexels,
+							 const SCpuImage &invTransfer, const SCpuImage &basis, const int iNrThreads=0);
+
+
+// Bounded memory version for textures too large to sort in memory. The
+// source is read three times in strips of rows: moments, histograms of the
+// projected colors (replacing the sort) and finally the transfer, which is
+// handed out strip by strip, while the box filtered lookup coordinate and
+// projected color stream through a mip pyramid of a few rows per level into
+// per level histograms. Level m is measured at every 2x2 window of level
+// m-1 rather than every footprint. The strip height is chosen to keep the
+// buffers within uMemoryBudget bytes. pAssets->transfer is left empty and
+// the round trip error is not measured.
+typedef bool (*PFN_HISTO_READ_ROWS)(float pfDst[], const int y0, const int nrRows, void * pUserData);		// rgba, linear
+typedef bool (*PFN_HISTO_WRITE_ROWS)(const float pfSrc[], const int y0, const int nrRows, void * pUserData);	// rgba, 8 bit values
+
+struct SHistoStreamParams
+{
+	int iWidth, iHeight;
+	PFN_HISTO_READ_ROWS pReadRows;
+	PFN_HISTO_WRITE_ROWS pWriteRows;		// rows arrive in order
+	void * pUserData;
+	size_t uMemoryBudget;
+	int iNrThreads;
+};
+
+bool BuildHistoPreservAssetsStreaming(SHistoPreservAssets * pAssets, const SHistoStreamParams &params);
+
+#ifdef _WIN32
+// loads srcName (with conversion to linear when sRGB) and writes the three
+// files as dstBaseName followed by _transfer.png, _invtransfer.dds and _basis.dds.
+// When pAssets is not NULL it receives the assets which the caller then frees.
+bool HistoPreservTextureFiles(const wchar_t dstBaseName[], const wchar_t srcName[], const bool sRGB,
+							  SHistoPreservAssets * pAssets=NULL, const int iNrThreads=0);
+
+// same using BuildHistoPreservAssetsStreaming(). The source is decoded and
+// the png encoded in strips so the image is never held in memory as a whole.
+bool HistoPreservTextureFilesStreaming(const wchar_t dstBaseName[], const wchar_t srcName[], const bool sRGB,
+									   const size_t uMemoryBudget=(((size_t) 256)<<20), const int iNrThreads=0);
+
+// For ImportTextureTRX(), which writes nothing to disk. rgba receives the
+// transfer of srcName as 8 bit rgba, *piWidth by *piHeight texels. The first
+// builds all three with BuildHistoPreservAssetsStreaming(), the second only
+// the transfer for the invTransfer and basis shipped with the source, see
+// HistoTransferFromAssets().
+bool HistoPreservAssetsFromFile(SHistoPreservAssets * pAssets, std::vector<unsigned char> &rgba, int * piWidth, int * piHeight,
+								const wchar_t srcName[], const bool sRGB, const size_t uMemoryBudget=(((size_t) 256)<<20), const int iNrThreads=0);
+bool HistoTransferFromFile(std::vector<unsigned char> &rgba, int * piWidth, int * piHeight, const wchar_t srcName[], const bool sRGB,
+						   const SCpuImage &invTransfer, const SCpuImage &basis, const size_t uMemoryBudget=(((size_t) 256)<<20), const int iNrThreads=0);
+#endif
+
+
+#endif
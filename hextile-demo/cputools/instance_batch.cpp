@@ -0,0 +1,47 @@
+#include "instance_batch.h"
+
+
+int BuildInstanceBatches(std::vector<SInstanceBatch> &batches, std::vector<int> &order, const int piInstances[], const int iNrInstances,
+						 const int piMesh[], const int piMaterial[], const int iNrMeshes, const int iNrMaterials, SInstanceBatchStats * pStats)
+{
+	batches.clear();
+	order.resize(iNrInstances);
+
+	// counting sort on the key, stable so instances keep their order
+	const int iNrKeys = iNrMeshes*iNrMaterials;
+	std::vector<int> offsets(iNrKeys+1, 0);
+	for(int i=0; i<iNrInstances; i++)
+	{
+		const int idx = piInstances[i];
+		++offsets[piMaterial[idx]*iNrMeshes + piMesh[idx] + 1];
+	}
+
+	for(int k=0; k<iNrKeys; k++)
+	{
+		const int iCount = offsets[k+1];
+		offsets[k+1] = offsets[k] + iCount;
+		if(iCount>0)
+		{
+			SInstanceBatch batch;
+			batch.iMaterial = k/iNrMeshes; batch.iMesh = k - batch.iMaterial*iNrMeshes;
+			batch.iFirstInstance = offsets[k]; batch.iNrInstances = iCount;
+			batches.push_back(batch);
+		}
+	}
+
+	for(int i=0; i<iNrInstances; i++)
+	{
+		const int idx = piInstances[i];
+		order[offsets[piMaterial[idx]*iNrMeshes + piMesh[idx]]++] = idx;
+	}
+
+	const int iNrBatches = (int) batches.size();
+	if(pStats!=NULL)
+	{
+		pStats->iNrInstances = iNrInstances;
+		pStats->iNrBatches = iNrBatches;
+		pStats->fDrawReduction = iNrBatches>0 ? (((float) iNrInstances) / iNrBatches) : 1.0f;
+	}
+
+	return iNrBatches;
+}
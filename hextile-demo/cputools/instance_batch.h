@@ -0,0 +1,34 @@
+#ifndef __INSTANCEBATCH_H__
+#define __INSTANCEBATCH_H__
+
+#include <vector>
+#include <stddef.h>
+
+// Groups the instances to draw by mesh and material such that each group is
+// one DrawIndexedInstanced(). The instances of a batch are consecutive in the
+// returned order, which is the order their transforms are written to the
+// instance buffer, and SV_InstanceID plus the batch's first instance finds
+// them there. Batches are sorted by material and then mesh and the instances
+// within a batch keep their relative order. Nothing here touches the device.
+
+struct SInstanceBatch
+{
+	int iMesh, iMaterial;
+	int iFirstInstance, iNrInstances;		// into the order
+};
+
+struct SInstanceBatchStats
+{
+	int iNrInstances;						// drawn, one draw each without instancing
+	int iNrBatches;							// draws with instancing
+	float fDrawReduction;					// instances over batches
+};
+
+// piInstances[] holds the iNrInstances instances to draw, piMesh[] and
+// piMaterial[] are indexed by instance. pStats may be NULL. Returns the
+// number of batches.
+int BuildInstanceBatches(std::vector<SInstanceBatch> &batches, std::vector<int> &order, const int piInstances[], const int iNrInstances,
+						 const int piMesh[], const int piMaterial[], const int iNrMeshes, const int iNrMaterials, SInstanceBatchStats * pStats=NULL);
+
+
+#endif
@@ -0,0 +1,402 @@
+#include "instance_bvh.h"
+#include "simd_common.h"
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+
+void GetFrustumPlanes(SFrustumPlanes * pFrustum, const Mat44 &mWorldToClip)
+{
+	const Vec4 vR0 = GetRow(mWorldToClip, 0), vR1 = GetRow(mWorldToClip, 1);
+	const Vec4 vR2 = GetRow(mWorldToClip, 2), vR3 = GetRow(mWorldToClip, 3);
+
+	// -w<=x<=w, -w<=y<=w and 0<=z<=w
+	const Vec4 vPlanes[6] = { vR3+vR0, vR3-vR0, vR3+vR1, vR3-vR1, vR2, vR3-vR2 };
+	for(int p=0; p<6; p++)
+	{
+		const float fLen = sqrtf(vPlanes[p].x*vPlanes[p].x + vPlanes[p].y*vPlanes[p].y + vPlanes[p].z*vPlanes[p].z);
+		const float fRecip = fLen>0.0f ? (1.0f/fLen) : 0.0f;
+		pFrustum->fPlanes[p][0] = fRecip*vPlanes[p].x; pFrustum->fPlanes[p][1] = fRecip*vPlanes[p].y;
+		pFrustum->fPlanes[p][2] = fRecip*vPlanes[p].z; pFrustum->fPlanes[p][3] = fRecip*vPlanes[p].w;
+	}
+}
+
+
+/*********************************************************************************************
+******************************************* Build ********************************************
+*********************************************************************************************/
+
+static inline float SurfaceArea(const float fMin[3], const float fMax[3])
+{
+	const float fX = fMax[0]-fMin[0], fY = fMax[1]-fMin[1], fZ = fMax[2]-fMin[2];
+	return 2*(fX*fY + fY*fZ + fZ*fX);
+}
+
+static void GetSlotBox(float fMin[3], float fMax[3], const SInstanceBVHNode &node, const int s)
+{
+	for(int k=0; k<3; k++) { fMin[k] = node.fMin[k][s]; fMax[k] = node.fMax[k][s]; }
+}
+
+static void SetSlotBox(SInstanceBVHNode * pNode, const int s, const float fMin[3], const float fMax[3])
+{
+	for(int k=0; k<3; k++) { pNode->fMin[k][s] = fMin[k]; pNode->fMax[k][s] = fMax[k]; }
+}
+
+static void GetInstanceBox(float fMin[3], float fMax[3], const float * const pfCen[3], const float * const pfExt[3], const int i)
+{
+	for(int k=0; k<3; k++) { fMin[k] = pfCen[k][i]-pfExt[k][i]; fMax[k] = pfCen[k][i]+pfExt[k][i]; }
+}
+
+static void GetNodeBox(float fMin[3], float fMax[3], const SInstanceBVHNode &node)
+{
+	for(int k=0; k<3; k++)
+	{
+		fMin[k] = FLT_MAX; fMax[k] = -FLT_MAX;
+		for(int s=0; s<INSTANCE_BVH_WIDTH; s++)
+			if(node.iChild[s]!=INSTANCE_BVH_EMPTY_SLOT)
+			{
+				fMin[k] = std::min(fMin[k], node.fMin[k][s]);
+				fMax[k] = std::max(fMax[k], node.fMax[k][s]);
+			}
+	}
+}
+
+// splits the range into iNrGroups groups of iGroupSize instances, the
+// last one takes the rest, by splitting along the longest axis of the
+// centers. Filling the groups keeps the nodes of the tree full.
+static void SplitRange(int piGroupFirst[], int piGroupCount[], int * piNrGroups, int piOrder[], const int iFirst, const int iCount,
+					   const float * const pfCen[3], const int iNrGroups, const int iGroupSize)
+{
+	if(iNrGroups<=1)
+	{
+		piGroupFirst[*piNrGroups] = iFirst; piGroupCount[*piNrGroups] = iCount;
+		++(*piNrGroups);
+		return;
+	}
+
+	float fMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, fMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for(int i=iFirst; i<(iFirst+iCount); i++)
+		for(int k=0; k<3; k++)
+		{
+			fMin[k] = std::min(fMin[k], pfCen[k][piOrder[i]]);
+			fMax[k] = std::max(fMax[k], pfCen[k][piOrder[i]]);
+		}
+
+	int iAxis = 0;
+	for(int k=1; k<3; k++)
+		if((fMax[k]-fMin[k])>(fMax[iAxis]-fMin[iAxis])) iAxis = k;
+
+	const float * pfAxis = pfCen[iAxis];
+	const int iNrLeft = (iNrGroups+1)/2;
+	const int iLeftCount = iNrLeft*iGroupSize;
+	std::nth_element(piOrder+iFirst, piOrder+iFirst+iLeftCount, piOrder+iFirst+iCount, [pfAxis](const int a, const int b) { return pfAxis[a]<pfAxis[b]; });
+
+	SplitRange(piGroupFirst, piGroupCount, piNrGroups, piOrder, iFirst, iLeftCount, pfCen, iNrLeft, iGroupSize);
+	SplitRange(piGroupFirst, piGroupCount, piNrGroups, piOrder, iFirst+iLeftCount, iCount-iLeftCount, pfCen, iNrGroups-iNrLeft, iGroupSize);
+}
+
+static void BuildNode(SInstanceBVH * pBVH, const int iNode, const float * const pfCen[3], const float * const pfExt[3])
+{
+	const int iFirst = pBVH->nodes[iNode].iFirst, iCount = pBVH->nodes[iNode].iNrInstances;
+
+	int iGroupFirst[INSTANCE_BVH_WIDTH], iGroupCount[INSTANCE_BVH_WIDTH], iNrGroups = 0;
+	if(iCount<=INSTANCE_BVH_WIDTH)
+	{
+		for(int i=0; i<iCount; i++) { iGroupFirst[i] = iFirst+i; iGroupCount[i] = 1; }
+		iNrGroups = iCount;
+	}
+	else
+	{
+		// the smallest power of 8 such that 8 of them hold the instances
+		int iGroupSize = INSTANCE_BVH_WIDTH;
+		while((INSTANCE_BVH_WIDTH*iGroupSize)<iCount) iGroupSize *= INSTANCE_BVH_WIDTH;
+		SplitRange(iGroupFirst, iGroupCount, &iNrGroups, &pBVH->order[0], iFirst, iCount, pfCen, (iCount+iGroupSize-1)/iGroupSize, iGroupSize);
+	}
+
+	for(int s=0; s<INSTANCE_BVH_WIDTH; s++)
+	{
+		float fMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, fMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		int iChild = INSTANCE_BVH_EMPTY_SLOT;
+
+		if(s<iNrGroups && iGroupCount[s]==1)
+		{
+			const int inst = pBVH->order[iGroupFirst[s]];
+			GetInstanceBox(fMin, fMax, pfCen, pfExt, inst);
+			pBVH->leafSlot[inst] = iNode*INSTANCE_BVH_WIDTH + s;
+			iChild = ~inst;
+		}
+		else if(s<iNrGroups)
+		{
+			// the nodes were reserved up front so none of this moves
+			iChild = (int) pBVH->nodes.size();
+			pBVH->nodes.resize(iChild+1);
+			SInstanceBVHNode &child = pBVH->nodes[iChild];
+			child.iParent = iNode; child.iSlotInParent = s;
+			child.iFirst = iGroupFirst[s]; child.iNrInstances = iGroupCount[s];
+			BuildNode(pBVH, iChild, pfCen, pfExt);
+			GetNodeBox(fMin, fMax, pBVH->nodes[iChild]);
+		}
+
+		pBVH->nodes[iNode].iChild[s] = iChild;
+		SetSlotBox(&pBVH->nodes[iNode], s, fMin, fMax);
+	}
+}
+
+static double ComputeCost(const SInstanceBVH &bvh)
+{
+	double fCost = 0.0;
+	for(int n=1; n<(int) bvh.nodes.size(); n++)
+	{
+		float fMin[3], fMax[3];
+		GetSlotBox(fMin, fMax, bvh.nodes[bvh.nodes[n].iParent], bvh.nodes[n].iSlotInParent);
+		fCost += SurfaceArea(fMin, fMax);
+	}
+	return fCost;
+}
+
+bool BuildInstanceBVH(SInstanceBVH * pBVH, const float * const pfCen[3], const float * const pfExt[3], const int iNrInstances)
+{
+	pBVH->iNrInstances = 0;
+	pBVH->nodes.clear();
+	pBVH->fBuildCost = 0.0; pBVH->fCost = 0.0;
+	if(iNrInstances<0) return false;
+
+	pBVH->iNrInstances = iNrInstances;
+	pBVH->order.resize(iNrInstances);
+	for(int i=0; i<iNrInstances; i++) pBVH->order[i] = i;
+	pBVH->leafSlot.resize(iNrInstances);
+	if(iNrInstances==0) return true;
+
+	// every inner node has at least two children
+	pBVH->nodes.reserve(iNrInstances);
+	pBVH->nodes.resize(1);
+	pBVH->nodes[0].iParent = -1; pBVH->nodes[0].iSlotInParent = -1;
+	pBVH->nodes[0].iFirst = 0; pBVH->nodes[0].iNrInstances = iNrInstances;
+	BuildNode(pBVH, 0, pfCen, pfExt);
+
+	pBVH->marked.assign(pBVH->nodes.size(), 0);
+	pBVH->fBuildCost = ComputeCost(*pBVH);
+	pBVH->fCost = pBVH->fBuildCost;
+
+	return true;
+}
+
+
+/*********************************************************************************************
+******************************************* Refit ********************************************
+*********************************************************************************************/
+
+// the box of the node into the slot of its parent
+static void RefitNode(SInstanceBVH * pBVH, const int iNode)
+{
+	const SInstanceBVHNode &node = pBVH->nodes[iNode];
+	if(node.iParent<0) return;
+
+	float fMin[3], fMax[3], fOldMin[3], fOldMax[3];
+	GetNodeBox(fMin, fMax, node);
+	SInstanceBVHNode &parent = pBVH->nodes[node.iParent];
+	GetSlotBox(fOldMin, fOldMax, parent, node.iSlotInParent);
+	SetSlotBox(&parent, node.iSlotInParent, fMin, fMax);
+	pBVH->fCost += SurfaceArea(fMin, fMax) - SurfaceArea(fOldMin, fOldMax);
+}
+
+bool RefitInstanceBVH(SInstanceBVH * pBVH, const float * const pfCen[3], const float * const pfExt[3], const int piChanged[], const int iNrChanged,
+					  const float fRebuildRatio)
+{
+	if(pBVH->nodes.empty() || iNrChanged<=0) return false;
+
+	const int iNrNodes = (int) pBVH->nodes.size();
+	if((4*iNrChanged)>=pBVH->iNrInstances)
+	{
+		// most of the tree moves, children come after their parent
+		for(int n=iNrNodes-1; n>=0; n--)
+		{
+			SInstanceBVHNode &node = pBVH->nodes[n];
+			for(int s=0; s<INSTANCE_BVH_WIDTH; s++)
+				if(node.iChild[s]<0 && node.iChild[s]!=INSTANCE_BVH_EMPTY_SLOT)
+				{
+					float fMin[3], fMax[3];
+					GetInstanceBox(fMin, fMax, pfCen, pfExt, ~node.iChild[s]);
+					SetSlotBox(&node, s, fMin, fMax);
+				}
+			RefitNode(pBVH, n);
+		}
+		pBVH->fCost = ComputeCost(*pBVH);
+	}
+	else
+	{
+		// the changed leaves and their ancestors, each once
+		std::vector<int> &work = pBVH->work;
+		work.clear();
+		for(int c=0; c<iNrChanged; c++)
+		{
+			const int inst = piChanged[c];
+			const int iSlot = pBVH->leafSlot[inst];
+			float fMin[3], fMax[3];
+			GetInstanceBox(fMin, fMax, pfCen, pfExt, inst);
+			SetSlotBox(&pBVH->nodes[iSlot/INSTANCE_BVH_WIDTH], iSlot%INSTANCE_BVH_WIDTH, fMin, fMax);
+
+			for(int n=iSlot/INSTANCE_BVH_WIDTH; n>0 && pBVH->marked[n]==0; n=pBVH->nodes[n].iParent)
+			{
+				pBVH->marked[n] = 1;
+				work.push_back(n);
+			}
+		}
+
+		std::sort(work.begin(), work.end());
+		for(int i=((int) work.size())-1; i>=0; i--)
+		{
+			RefitNode(pBVH, work[i]);
+			pBVH->marked[work[i]] = 0;
+		}
+	}
+
+	if(pBVH->fCost>(fRebuildRatio*pBVH->fBuildCost))
+	{
+		BuildInstanceBVH(pBVH, pfCen, pfExt, pBVH->iNrInstances);
+		return true;
+	}
+
+	return false;
+}
+
+
+/*********************************************************************************************
+******************************************* Query ********************************************
+*********************************************************************************************/
+
+// per plane the corner of a box furthest along the normal and the one
+// furthest against it, as which of min and max to use on each axis
+struct SFrustumTest
+{
+	float fN[6][3], fD[6];
+	int bPosMax[6][3];
+};
+
+static void SetupFrustumTest(SFrustumTest * pTest, const SFrustumPlanes &frustum)
+{
+	for(int p=0; p<6; p++)
+	{
+		for(int k=0; k<3; k++)
+		{
+			pTest->fN[p][k] = frustum.fPlanes[p][k];
+			pTest->bPosMax[p][k] = frustum.fPlanes[p][k]>=0.0f ? 1 : 0;
+		}
+		pTest->fD[p] = frustum.fPlanes[p][3];
+	}
+}
+
+// bits of the slots not entirely outside and of those entirely inside
+static void TestNodeScalar(unsigned int * puVisible, unsigned int * puInside, const SInstanceBVHNode &node, const SFrustumTest &test)
+{
+	unsigned int uVisible = 0, uInside = 0;
+	for(int s=0; s<INSTANCE_BVH_WIDTH; s++)
+	{
+		bool bVisible = true, bInside = true;
+		for(int p=0; p<6; p++)
+		{
+			float fPos[3], fNeg[3];
+			for(int k=0; k<3; k++)
+			{
+				fPos[k] = test.bPosMax[p][k]!=0 ? node.fMax[k][s] : node.fMin[k][s];
+				fNeg[k] = test.bPosMax[p][k]!=0 ? node.fMin[k][s] : node.fMax[k][s];
+			}
+			const float fDistPos = ((test.fN[p][0]*fPos[0] + test.fN[p][1]*fPos[1]) + test.fN[p][2]*fPos[2]) + test.fD[p];
+			const float fDistNeg = ((test.fN[p][0]*fNeg[0] + test.fN[p][1]*fNeg[1]) + test.fN[p][2]*fNeg[2]) + test.fD[p];
+			if(fDistPos<0.0f) bVisible = false;
+			if(fDistNeg<0.0f) bInside = false;
+		}
+		if(bVisible) uVisible |= 1u<<s;
+		if(bInside) uInside |= 1u<<s;
+	}
+	*puVisible = uVisible; *puInside = uInside;
+}
+
+#ifdef SIMD_HAS_AVX2_PATH
+// same operations in the same order as the scalar path
+SIMD_AVX2_FUNC static void TestNodeAVX2(unsigned int * puVisible, unsigned int * puInside, const SInstanceBVHNode &node, const SFrustumTest &test)
+{
+	__m256 vMin[3], vMax[3];
+	for(int k=0; k<3; k++)
+	{
+		vMin[k] = _mm256_loadu_ps(node.fMin[k]);
+		vMax[k] = _mm256_loadu_ps(node.fMax[k]);
+	}
+
+	const __m256 vZero = _mm256_setzero_ps();
+	__m256 vOutside = vZero, vNotInside = vZero;
+	for(int p=0; p<6; p++)
+	{
+		__m256 vPos[3], vNeg[3];
+		for(int k=0; k<3; k++)
+		{
+			vPos[k] = test.bPosMax[p][k]!=0 ? vMax[k] : vMin[k];
+			vNeg[k] = test.bPosMax[p][k]!=0 ? vMin[k] : vMax[k];
+		}
+		const __m256 vN0 = _mm256_set1_ps(test.fN[p][0]), vN1 = _mm256_set1_ps(test.fN[p][1]), vN2 = _mm256_set1_ps(test.fN[p][2]);
+		const __m256 vD = _mm256_set1_ps(test.fD[p]);
+		const __m256 vDistPos = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vN0, vPos[0]), _mm256_mul_ps(vN1, vPos[1])), _mm256_mul_ps(vN2, vPos[2])), vD);
+		const __m256 vDistNeg = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vN0, vNeg[0]), _mm256_mul_ps(vN1, vNeg[1])), _mm256_mul_ps(vN2, vNeg[2])), vD);
+		vOutside = _mm256_or_ps(vOutside, _mm256_cmp_ps(vDistPos, vZero, _CMP_LT_OQ));
+		vNotInside = _mm256_or_ps(vNotInside, _mm256_cmp_ps(vDistNeg, vZero, _CMP_LT_OQ));
+	}
+
+	*puVisible = (~((unsigned int) _mm256_movemask_ps(vOutside))) & 0xff;
+	*puInside = (~((unsigned int) _mm256_movemask_ps(vNotInside))) & 0xff;
+}
+#endif
+
+
+static bool g_bAVX2Enabled = CpuSupportsAVX2();
+
+bool IsInstanceBVHAVX2Enabled()
+{
+	return g_bAVX2Enabled;
+}
+
+int QueryInstanceBVH(std::vector<int> &visible, const SInstanceBVH &bvh, const SFrustumPlanes &frustum, const bool bAllowAVX2, int * piNrNodesTested)
+{
+	visible.clear();
+	if(piNrNodesTested!=NULL) *piNrNodesTested = 0;
+	if(bvh.nodes.empty()) return 0;
+
+	SFrustumTest test;
+	SetupFrustumTest(&test, frustum);
+#ifdef SIMD_HAS_AVX2_PATH
+	const bool bUseAVX2 = g_bAVX2Enabled && bAllowAVX2;
+#endif
+
+	// the tree is balanced so the stack stays shallow
+	int iStack[64*INSTANCE_BVH_WIDTH];
+	int iStackSize = 0, iNrTested = 0;
+	iStack[iStackSize++] = 0;
+	while(iStackSize>0)
+	{
+		const SInstanceBVHNode &node = bvh.nodes[iStack[--iStackSize]];
+		++iNrTested;
+
+		unsigned int uVisible = 0, uInside = 0;
+#ifdef SIMD_HAS_AVX2_PATH
+		if(bUseAVX2) TestNodeAVX2(&uVisible, &uInside, node, test);
+		else
+#endif
+		TestNodeScalar(&uVisible, &uInside, node, test);
+
+		for(int s=0; s<INSTANCE_BVH_WIDTH; s++)
+		{
+			const int iChild = node.iChild[s];
+			if(((uVisible>>s)&0x1)==0 || iChild==INSTANCE_BVH_EMPTY_SLOT) continue;
+
+			if(iChild<0) visible.push_back(~iChild);
+			else if(((uInside>>s)&0x1)!=0)
+			{
+				const SInstanceBVHNode &child = bvh.nodes[iChild];
+				visible.insert(visible.end(), bvh.order.begin()+child.iFirst, bvh.order.begin()+child.iFirst+child.iNrInstances);
+			}
+			else if(iStackSize<(int) (sizeof(iStack)/sizeof(iStack[0]))) iStack[iStackSize++] = iChild;
+		}
+	}
+
+	if(piNrNodesTested!=NULL) *piNrNodesTested = iNrTested;
+	return (int) visible.size();
+}
@@ -0,0 +1,83 @@
+#ifndef __INSTANCEBVH_H__
+#define __INSTANCEBVH_H__
+
+#include <geommath/geommath.h>
+#include <vector>
+#include <stddef.h>
+
+// Bounding volume hierarchy over the world space boxes of the scene
+// instances for view frustum culling. A node holds the boxes of up to 8
+// children, each another node or a single instance, and is tested against
+// the planes of the frustum in one go with AVX2 when the CPU supports it.
+// Both paths find the same instances. A child entirely inside the frustum
+// is taken with all of its instances without testing further, which is
+// cheap since the instances below a node are contiguous in the order.
+// When instances move the boxes are refit bottom up from the changed
+// instances only and the tree is rebuilt once refitting has grown the
+// boxes too much. Nothing here touches the device.
+//
+// Boxes are given as center and half extent in SoA, pfCen[k][i] and
+// pfExt[k][i] for axis k of instance i, as in shadow_culling.h.
+
+#define INSTANCE_BVH_WIDTH			8
+#define INSTANCE_BVH_EMPTY_SLOT		(-0x7fffffff-1)
+
+// the planes point inward, a point p is inside when dot(n,p)+d>=0 for all
+struct SFrustumPlanes
+{
+	float fPlanes[6][4];
+};
+
+// mWorldToClip is projection times world to view, D3D clip space where
+// 0<=z<=w
+void GetFrustumPlanes(SFrustumPlanes * pFrustum, const Mat44 &mWorldToClip);
+
+struct SInstanceBVHNode
+{
+	float fMin[3][INSTANCE_BVH_WIDTH], fMax[3][INSTANCE_BVH_WIDTH];
+	int iChild[INSTANCE_BVH_WIDTH];				// node, ~instance for a leaf or INSTANCE_BVH_EMPTY_SLOT
+	int iParent, iSlotInParent;					// -1 for the root
+	int iFirst, iNrInstances;					// into the order
+};
+
+struct SInstanceBVH
+{
+	int iNrInstances;
+	std::vector<SInstanceBVHNode> nodes;		// parents before children, the root first
+	std::vector<int> order;						// instances, those below a node are contiguous
+	std::vector<int> leafSlot;					// by instance, node*INSTANCE_BVH_WIDTH + slot
+
+	// summed surface area of the boxes of the inner children, at the
+	// last build and now
+	double fBuildCost, fCost;
+
+	std::vector<unsigned char> marked;			// by node, scratch for the refit
+	std::vector<int> work;
+};
+
+struct SInstanceCullStats
+{
+	int iNrInstances;
+	int iNrVisible;
+	int iNrNodesTested;
+	int iNrRebuilds;							// since the start
+};
+
+bool BuildInstanceBVH(SInstanceBVH * pBVH, const float * const pfCen[3], const float * const pfExt[3], const int iNrInstances);
+
+// refits the boxes holding the iNrChanged instances of piChanged[] and
+// rebuilds the tree when its cost has grown beyond fRebuildRatio times
+// the cost at the last build. Returns true when it rebuilt.
+bool RefitInstanceBVH(SInstanceBVH * pBVH, const float * const pfCen[3], const float * const pfExt[3], const int piChanged[], const int iNrChanged,
+					  const float fRebuildRatio=1.5f);
+
+// the instances whose box isn't entirely outside a plane of the frustum,
+// in no particular order. piNrNodesTested may be NULL. Returns the number
+// of instances found.
+int QueryInstanceBVH(std::vector<int> &visible, const SInstanceBVH &bvh, const SFrustumPlanes &frustum, const bool bAllowAVX2=true,
+					 int * piNrNodesTested=NULL);
+
+bool IsInstanceBVHAVX2Enabled();
+
+
+#endif
@@ -0,0 +1,260 @@
+#include "large_world.h"
+#include "hextiling_cpu.h"
+#include "hextile_lut.h"
+#include <geommath/geommath.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+static const double g_dGridScale = 2*sqrt(3.0);
+static const double g_dSkewXY = -0.57735027;
+static const double g_dSkewYY = 1.15470054;
+
+
+void HexRWSSplitOffset(SHexRWSOffset * pRes, const double stOffs[2])
+{
+	// whole cells of the skewed grid as in TriangleGrid()
+	const double skewX = g_dGridScale*(stOffs[0] + g_dSkewXY*stOffs[1]);
+	const double skewY = g_dGridScale*(g_dSkewYY*stOffs[1]);
+	const double cellX = floor(skewX), cellY = floor(skewY);
+
+	// st of the removed cells as in MakeCenST()
+	const double cenX = (cellX + 0.5*cellY) / g_dGridScale;
+	const double cenY = (cellY / g_dSkewYY) / g_dGridScale;
+
+	pRes->iCellOffs[0] = (int) cellX;
+	pRes->iCellOffs[1] = (int) cellY;
+	pRes->fStOffs[0] = (float) (stOffs[0] - cenX);
+	pRes->fStOffs[1] = (float) (stOffs[1] - cenY);
+	pRes->fCenOffs[0] = (float) (cenX - floor(cenX));
+	pRes->fCenOffs[1] = (float) (cenY - floor(cenY));
+}
+
+void HexRWSPlanarOffsets(SHexRWSOffset pRes[3], const Vec3d &vOrigin, const double fTileRate)
+{
+	// st = (sp.x, 1-sp.y) for sp = (-z,y), (x,-z) and (x,y), see GetPlanarST()
+	const Vec3d vP = fTileRate*vOrigin;
+	const double stOffs[3][2] = { {-vP.z, -vP.y}, {vP.x, vP.z}, {vP.x, -vP.y} };
+
+	for(int k=0; k<3; k++) HexRWSSplitOffset(&pRes[k], stOffs[k]);
+}
+
+void RebaseLocToWorld(Mat44 * pmLocToRWS, const Mat44 &mLocToWorld, const Vec3d &vPos, const Vec3d &vOrigin)
+{
+	const Vec3 vRel(vPos - vOrigin);
+
+	*pmLocToRWS = mLocToWorld;
+	SetColumn(pmLocToRWS, 3, Vec4(vRel.x, vRel.y, vRel.z, 1.0f));
+}
+
+
+// row vector times float2x2(cs, -si, si, cs) as mul(v, rot) in the shader
+template<class T> static inline void MulRowRot(T res[], const T v[], const T cs, const T si)
+{
+	const T x = v[0]*cs + v[1]*si, y = -v[0]*si + v[1]*cs;
+	res[0] = x; res[1] = y;
+}
+
+static float WrappedDiff(const double a, const double b)
+{
+	const double d = a - b;
+	return (float) fabs(d - floor(d + 0.5));
+}
+
+struct SHexSample
+{
+	int vertex[3][2];
+	double bary[3];
+	double st[3][2];		// sample coordinates of the three taps, not wrapped
+};
+
+// TriangleGrid() and the sample coordinates of hex2colTex() in double
+static void HexReference(SHexSample * pRes, const double st[2], const float pfLUT[], const int N)
+{
+	const double skew[] = { g_dGridScale*(st[0] + g_dSkewXY*st[1]), g_dGridScale*(g_dSkewYY*st[1]) };
+	const double base[] = { floor(skew[0]), floor(skew[1]) };
+	const double tx = skew[0]-base[0], ty = skew[1]-base[1], tz = 1.0-tx-ty;
+
+	const double s = tz<=0.0 ? 1.0 : 0.0, s2 = 2*s-1;
+	pRes->bary[0] = -tz*s2; pRes->bary[1] = s - ty*s2; pRes->bary[2] = s - tx*s2;
+
+	const int b[] = { (int) base[0], (int) base[1] }, is = (int) s;
+	const int verts[3][2] = { {b[0]+is, b[1]+is}, {b[0]+is, b[1]+1-is}, {b[0]+1-is, b[1]+is} };
+	for(int k=0; k<3; k++)
+	{
+		pRes->vertex[k][0] = verts[k][0]; pRes->vertex[k][1] = verts[k][1];
+
+		float cs, si, offs[2];
+		LoadCellFromLUT(&cs, &si, offs, pfLUT, N, verts[k]);
+
+		const double cen[] = { (verts[k][0] + 0.5*verts[k][1]) / g_dGridScale, (verts[k][1] / g_dSkewYY) / g_dGridScale };
+		const double d[] = { st[0]-cen[0], st[1]-cen[1] };
+		double r[2];
+		MulRowRot(r, d, (double) cs, (double) si);
+		pRes->st[k][0] = r[0] + cen[0] + offs[0];
+		pRes->st[k][1] = r[1] + cen[1] + offs[1];
+	}
+}
+
+// statement by statement port of TriangleGridRWS() and the sample
+// coordinates of hex2colTexRWS() in hextiling_rws.h
+static void HexRWS(SHexSample * pRes, const float st_in[2], const SHexRWSOffset &offs, const float pfLUT[], const int N)
+{
+	const float fGridScale = (float) g_dGridScale, fSkewXY = (float) g_dSkewXY, fSkewYY = (float) g_dSkewYY;
+	const float st[] = { fGridScale*st_in[0], fGridScale*st_in[1] };
+	const float st_offs[] = { fGridScale*offs.fStOffs[0], fGridScale*offs.fStOffs[1] };
+
+	const float comb_skew[] = { (st[0] + fSkewXY*st[1]) + (st_offs[0] + fSkewXY*st_offs[1]), (fSkewYY*st[1]) + (fSkewYY*st_offs[1]) };
+	const float base[] = { floorf(comb_skew[0]), floorf(comb_skew[1]) };
+	const float tx = comb_skew[0]-base[0], ty = comb_skew[1]-base[1], tz = 1.0f-tx-ty;
+
+	const float s = tz<=0.0f ? 1.0f : 0.0f, s2 = 2*s-1;
+	pRes->bary[0] = -tz*s2; pRes->bary[1] = s - ty*s2; pRes->bary[2] = s - tx*s2;
+
+	const int b[] = { (int) base[0], (int) base[1] }, is = (int) s;
+	const int local[3][2] = { {b[0]+is, b[1]+is}, {b[0]+is, b[1]+1-is}, {b[0]+1-is, b[1]+is} };
+	for(int k=0; k<3; k++)
+	{
+		const int vertex[] = { local[k][0] + offs.iCellOffs[0], local[k][1] + offs.iCellOffs[1] };
+		pRes->vertex[k][0] = vertex[0]; pRes->vertex[k][1] = vertex[1];
+
+		float cs, si, hashOffs[2];
+		LoadCellFromLUT(&cs, &si, hashOffs, pfLUT, N, vertex);
+
+		float cen[2];
+		MakeCenST(cen, local[k]);
+
+		const float d[] = { offs.fStOffs[0]-cen[0], offs.fStOffs[1]-cen[1] };
+		float r[2], rs[2];
+		MulRowRot(r, d, cs, si);
+		MulRowRot(rs, st_in, cs, si);
+		for(int c=0; c<2; c++)
+		{
+			const float v = r[c] + cen[c] + offs.fCenOffs[c];
+			pRes->st[k][c] = rs[c] + (v - floorf(v)) + hashOffs[c];
+		}
+	}
+}
+
+// TriangleGrid() and the sample coordinates of hex2colTex() in float
+static void HexAbs(SHexSample * pRes, const float st[2], const float pfLUT[], const int N)
+{
+	float w[3];
+	int verts[3][2];
+	TriangleGrid(&w[0], &w[1], &w[2], verts[0], verts[1], verts[2], st);
+	for(int k=0; k<3; k++)
+	{
+		pRes->bary[k] = w[k];
+		pRes->vertex[k][0] = verts[k][0]; pRes->vertex[k][1] = verts[k][1];
+
+		float cs, si, offs[2], cen[2];
+		LoadCellFromLUT(&cs, &si, offs, pfLUT, N, verts[k]);
+		MakeCenST(cen, verts[k]);
+
+		const float d[] = { st[0]-cen[0], st[1]-cen[1] };
+		float r[2];
+		MulRowRot(r, d, cs, si);
+		pRes->st[k][0] = r[0] + cen[0] + offs[0];
+		pRes->st[k][1] = r[1] + cen[1] + offs[1];
+	}
+}
+
+// accumulates the error of a sample against the reference. On an edge of
+// the triangle grid the two sides may pick the triangles on either side of
+// it, which share two vertices and give the third a weight of about zero,
+// so vertices are matched by cell id and only a missing vertex of nonzero
+// weight is a mismatch.
+static void CompareHexSample(int * piNrMismatch, float * pfMaxBaryErr, float * pfMaxTexelErr,
+							 const SHexSample &ref, const SHexSample &test, const int iTexSize)
+{
+	const double fEdgeWeight = 1e-4;
+	int match[3];
+	bool bMatch = true;
+	for(int k=0; k<3; k++)
+	{
+		match[k] = -1;
+		for(int j=0; j<3; j++)
+			if(ref.vertex[k][0]==test.vertex[j][0] && ref.vertex[k][1]==test.vertex[j][1]) match[k] = j;
+		bMatch &= match[k]>=0 || fabs(ref.bary[k])<fEdgeWeight;
+	}
+	for(int j=0; j<3; j++)
+	{
+		const bool bFound = match[0]==j || match[1]==j || match[2]==j;
+		bMatch &= bFound || fabs(test.bary[j])<fEdgeWeight;
+	}
+
+	if(!bMatch) ++(*piNrMismatch);
+	else
+	{
+		for(int k=0; k<3; k++)
+		{
+			if(match[k]<0) continue;
+			const int j = match[k];
+
+			const float fBaryErr = (float) fabs(ref.bary[k]-test.bary[j]);
+			if(fBaryErr>*pfMaxBaryErr) *pfMaxBaryErr = fBaryErr;
+
+			for(int c=0; c<2; c++)
+			{
+				const float fTexelErr = iTexSize*WrappedDiff(ref.st[k][c], test.st[j][c]);
+				if(fTexelErr>*pfMaxTexelErr) *pfMaxTexelErr = fTexelErr;
+			}
+		}
+	}
+}
+
+bool LargeWorldPrecisionReport(SLargeWorldReport * pReport, const double fDistance, const double fTileRate,
+							   const int iTexSize, const float fRadius, const int iNrSamples)
+{
+	memset(pReport, 0, sizeof(SLargeWorldReport));
+	if(iNrSamples<=0 || iTexSize<=0) return false;
+
+	const int N = HEXCELL_LUT_DEFAULT_SIZE;
+	std::vector<float> lut(4*N*N);
+	if(!GenerateHexCellLUT(&lut[0], N, 1.0f)) return false;
+
+	// camera at eye height with a fractional part such that nothing lines up
+	const Vec3d vCamPos(fDistance + 0.3711, 1.7, fDistance + 0.6173);
+	SHexRWSOffset offs[3];
+	HexRWSPlanarOffsets(offs, vCamPos, fTileRate);
+
+	unsigned int uSeed = 0x6b43a9b5u;
+	for(int i=0; i<iNrSamples; i++)
+	{
+		uSeed = uSeed*1664525u + 1013904223u; const double u = (uSeed>>8) / 16777216.0;
+		uSeed = uSeed*1664525u + 1013904223u; const double v = (uSeed>>8) / 16777216.0;
+
+		// point on the ground plane (y=0) in absolute world space
+		const Vec3d vPos(vCamPos.x + fRadius*(2*u-1), 0.0, vCamPos.z + fRadius*(2*v-1));
+		const Vec3d vRel = vPos - vCamPos;
+
+		// RWS path, the vertex shader outputs the position relative to the camera
+		const Vec3 vRelRWS(vRel);
+
+		// regular path, float world space position minus float camera position
+		const Vec3 vPosAbs(vPos), vCamAbs(vCamPos);
+		const Vec3 vRelAbs = vPosAbs - vCamAbs;
+
+		const float fPosErrRWS = (float) Length(Vec3d(vRelRWS) - vRel);
+		const float fPosErrAbs = (float) Length(Vec3d(vRelAbs) - vRel);
+		if(fPosErrRWS>pReport->fMaxPosErrRWS) pReport->fMaxPosErrRWS = fPosErrRWS;
+		if(fPosErrAbs>pReport->fMaxPosErrAbs) pReport->fMaxPosErrAbs = fPosErrAbs;
+
+		// st of plane 1, (x, 1+z) scaled by the tile rate, as in GroundExamplePS()
+		const double stRef[] = { fTileRate*vPos.x, 1.0 + fTileRate*vPos.z };
+		const float stRWS[] = { ((float) fTileRate)*vRelRWS.x, 1.0f + ((float) fTileRate)*vRelRWS.z };
+		const float stAbs[] = { ((float) fTileRate)*vPosAbs.x, 1.0f + ((float) fTileRate)*vPosAbs.z };
+
+		SHexSample ref, rws, absf;
+		HexReference(&ref, stRef, &lut[0], N);
+		HexRWS(&rws, stRWS, offs[1], &lut[0], N);
+		HexAbs(&absf, stAbs, &lut[0], N);
+
+		CompareHexSample(&pReport->iNrCellMismatchRWS, &pReport->fMaxBaryErrRWS, &pReport->fMaxTexelErrRWS, ref, rws, iTexSize);
+		CompareHexSample(&pReport->iNrCellMismatchAbs, &pReport->fMaxBaryErrAbs, &pReport->fMaxTexelErrAbs, ref, absf, iTexSize);
+	}
+
+	pReport->iNrSamples = iNrSamples;
+
+	return true;
+}
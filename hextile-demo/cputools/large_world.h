@@ -0,0 +1,57 @@
+#ifndef __LARGEWORLD_H__
+#define __LARGEWORLD_H__
+
+#include <geommath/geommath_fwd.h>
+
+// Camera relative rendering for large worlds. Instance positions and the
+// camera are kept in double and rebased to the camera every frame such that
+// the GPU only sees relative world space (RWS). The st offset of the RWS
+// origin is split in double into whole hex cells and a small remainder
+// for the RWS variants in hextiling_rws.h.
+
+struct SHexRWSOffset
+{
+	float fStOffs[2];		// st_offs, what remains once iCellOffs whole cells are removed
+	float fCenOffs[2];		// cen_offs, frac() of the st of the removed cells
+	int iCellOffs[2];		// cell_offs, in units of the skewed triangle grid
+};
+
+// stOffs is the absolute st of the RWS origin, st_abs = st_rws + stOffs
+void HexRWSSplitOffset(SHexRWSOffset * pRes, const double stOffs[2]);
+
+// offsets of the three planes of GetPlanarST() in shader_lighting.hlsl
+// for the RWS origin at vOrigin. The ground plane is plane 1.
+void HexRWSPlanarOffsets(SHexRWSOffset pRes[3], const Vec3d &vOrigin, const double fTileRate);
+
+// mLocToWorld with its translation replaced by vPos-vOrigin evaluated in double
+void RebaseLocToWorld(Mat44 * pmLocToRWS, const Mat44 &mLocToWorld, const Vec3d &vPos, const Vec3d &vOrigin);
+
+
+// Compares the hex-tiling of the ground plane against a double precision
+// reference for points within fRadius of a camera fDistance units from the
+// origin along x and z. RWS is the camera relative path, Abs is the regular
+// path fed with float world space positions. Rotations and offsets per cell
+// come from the table of cputools/hextile_lut.h which is exact for any cell id.
+struct SLargeWorldReport
+{
+	int iNrSamples;
+
+	// surface position relative to the camera
+	float fMaxPosErrRWS, fMaxPosErrAbs;
+
+	// samples where a cell of weight above 1e-4 is missing from either side,
+	// the cell left out of a triangle on a grid edge has a weight of about 0
+	int iNrCellMismatchRWS, iNrCellMismatchAbs;
+
+	// of the blend weights w1, w2, w3 and of the sample coordinates st1, st2,
+	// st3 in texels of an iTexSize texture. Only samples with matching cells
+	// contribute.
+	float fMaxBaryErrRWS, fMaxBaryErrAbs;
+	float fMaxTexelErrRWS, fMaxTexelErrAbs;
+};
+
+bool LargeWorldPrecisionReport(SLargeWorldReport * pReport, const double fDistance, const double fTileRate,
+							   const int iTexSize=1024, const float fRadius=64.0f, const int iNrSamples=100000);
+
+
+#endif
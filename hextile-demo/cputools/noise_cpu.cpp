@@ -0,0 +1,1251 @@
+#include "noise_cpu.h"
+#include "simd_common.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+
+const unsigned char g_uNoisePermTable[256] =
+{
+	151,160,137,91,90,15,
+	131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
+	190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
+	88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
+	77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
+	102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,187,208, 89,18,169,200,196,
+	135,130,116,188,159,86,164,100,109,198,173,186, 3,64,52,217,226,250,124,123,
+	5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,
+	223,183,170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167, 43,172,9,
+	129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,104,218,246,97,228,
+	251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,107,
+	49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
+	138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
+};
+
+const float g_fNoiseGradArray[16][3] =
+{
+	{1,1,0}, {-1,1,0}, {1,-1,0}, {-1,-1,0},
+	{1,0,1}, {-1,0,1}, {1,0,-1}, {-1,0,-1},
+	{0,1,1}, {0,-1,1}, {0,1,-1}, {0,-1,-1},
+	{1,1,0}, {0,-1,1}, {-1,1,0}, {0,-1,-1}
+};
+
+// 32 bit copy of the permutation table for the gathers
+struct SPermTable32
+{
+	int iPerm[256];
+
+	SPermTable32() { for(int i=0; i<256; i++) iPerm[i] = g_uNoisePermTable[i]; }
+};
+
+static const SPermTable32 g_permTable32;
+
+static const float g_fMinPixSize = 1.0f/(1<<24);
+static const float g_fSimplexScale = 52.9f;		// SIMPLEX_SCALE
+static const float g_fSimplexFreq = 0.58f;		// SIMPLEX_FREQ
+
+// SIMPLEX_DERIVS as in noise.h is set by the build, on by default
+
+
+/*********************************************************************************************
+************************************* Utility functions **************************************
+*********************************************************************************************/
+
+static inline float fade(const float t) { return t*t*t*(t*(t*6-15)+10); }
+static inline float dfade(const float t) { return 30*t*t*(t*(t-2)+1); }
+static inline int perm(const int x) { return g_permTable32.iPerm[x&255]; }
+static inline const float * get_grad(const int x) { return g_fNoiseGradArray[x&15]; }
+
+static inline float grad(const int x, const float p[])
+{
+	const float * vGrad = get_grad(x);
+	return vGrad[0]*p[0] + vGrad[1]*p[1] + vGrad[2]*p[2];
+}
+
+static inline float lerp(const float a, const float b, const float t) { return a + t*(b-a); }
+
+static inline float saturate(const float x)
+{
+	const float t = x>0.0f ? x : 0.0f;
+	return t<1.0f ? t : 1.0f;
+}
+
+static inline float smoothstep(const float a, const float b, const float x)
+{
+	const float t = saturate((x-a)/(b-a));
+	return t*t*(3-2*t);
+}
+
+static inline float sign(const float x) { return x>0.0f ? 1.0f : (x<0.0f ? -1.0f : 0.0f); }
+
+// floor(log2(x)) for a positive normal float
+static inline int FloorLog2(const float x)
+{
+	unsigned int uBits;
+	memcpy(&uBits, &x, sizeof(uBits));
+	return ((int) ((uBits>>23)&0xff)) - 127;
+}
+
+// hashes of the 8 cube corners, corner c at offset (c&1, (c>>1)&1, c>>2),
+// and the position within the cube
+static void NoiseCell(int iHash[], float p[], const float p_in[])
+{
+	int P[3];
+	for(int k=0; k<3; k++)
+	{
+		P[k] = (int) floorf(p_in[k]);
+		p[k] = p_in[k] - (float) P[k];
+		P[k] &= 255;
+	}
+
+	// HASH COORDINATES FOR 6 OF THE 8 CUBE CORNERS
+	const int A = perm(P[0]) + P[1];
+	const int AA = perm(A) + P[2];
+	const int AB = perm(A + 1) + P[2];
+	const int B =  perm(P[0] + 1) + P[1];
+	const int BA = perm(B) + P[2];
+	const int BB = perm(B + 1) + P[2];
+
+	iHash[0] = perm(AA); iHash[1] = perm(BA); iHash[2] = perm(AB); iHash[3] = perm(BB);
+	iHash[4] = perm(AA+1); iHash[5] = perm(BA+1); iHash[6] = perm(AB+1); iHash[7] = perm(BB+1);
+}
+
+// same hashes with the lattice coordinates wrapped by iPeriod. For a period
+// of 256 they equal the ones of NoiseCell().
+static void NoiseCellPeriodic(int iHash[], float p[], const float p_in[], const int iPeriod)
+{
+	int P0[3], P1[3];
+	for(int k=0; k<3; k++)
+	{
+		const int iFloor = (int) floorf(p_in[k]);
+		p[k] = p_in[k] - (float) iFloor;
+		P0[k] = iFloor % iPeriod;
+		if(P0[k]<0) P0[k] += iPeriod;
+		P1[k] = (P0[k]+1)<iPeriod ? (P0[k]+1) : 0;
+	}
+
+	for(int c=0; c<8; c++)
+	{
+		const int X = (c&1)!=0 ? P1[0] : P0[0];
+		const int Y = (c&2)!=0 ? P1[1] : P0[1];
+		const int Z = (c&4)!=0 ? P1[2] : P0[2];
+		iHash[c] = perm(perm(perm(X) + Y) + Z);
+	}
+}
+
+// p + float3(-1, 0, 0) and so on for corner c
+static inline void CornerOffset(float q[], const float p[], const int c)
+{
+	for(int k=0; k<3; k++) q[k] = ((c>>k)&1)!=0 ? (p[k] + (-1.0f)) : p[k];
+}
+
+
+/*********************************************************************************************
+**************************************** API functions ***************************************
+*********************************************************************************************/
+
+float mysnoise(const float p_in[])
+{
+	int iHash[8]; float p[3];
+	NoiseCell(iHash, p, p_in);
+
+	const float f[] = { fade(p[0]), fade(p[1]), fade(p[2]) };
+
+	float c[8];
+	for(int i=0; i<8; i++)
+	{
+		float q[3];
+		CornerOffset(q, p, i);
+		c[i] = grad(iHash[i], q);
+	}
+
+	// AND ADD BLENDED RESULTS FROM 8 CORNERS OF CUBE
+	return lerp(
+		lerp(lerp(c[0], c[1], f[0]), lerp(c[2], c[3], f[0]), f[1]),
+		lerp(lerp(c[4], c[5], f[0]), lerp(c[6], c[7], f[0]), f[1]),
+		f[2]);
+}
+
+static void DSNoiseFromCell(float res[], const int iHash[], const float p[])
+{
+	const float F[] = { fade(p[0]), fade(p[1]), fade(p[2]) };
+	const float dF[] = { dfade(p[0]), dfade(p[1]), dfade(p[2]) };
+
+	// vA to vH, gradient in xyz and its dot product with the corner offset in w
+	float vC[8][4];
+	for(int i=0; i<8; i++)
+	{
+		float q[3];
+		CornerOffset(q, p, i);
+		const float * vGrad = get_grad(iHash[i]);
+		vC[i][0] = vGrad[0]; vC[i][1] = vGrad[1]; vC[i][2] = vGrad[2];
+		vC[i][3] = vGrad[0]*q[0] + vGrad[1]*q[1] + vGrad[2]*q[2];
+	}
+
+	const float * vA = vC[0], * vB = vC[1], * vCc = vC[2], * vD = vC[3];
+	const float * vE = vC[4], * vF = vC[5], * vG = vC[6], * vH = vC[7];
+
+	float vK[8][4];
+	for(int j=0; j<4; j++)
+	{
+		vK[0][j] = vA[j];
+		vK[1][j] = vB[j]-vA[j];
+		vK[2][j] = vCc[j]-vA[j];
+		vK[3][j] = vE[j]-vA[j];
+		vK[4][j] = vD[j]-vK[1][j]-vCc[j];
+		vK[5][j] = vG[j]-vK[2][j]-vE[j];
+		vK[6][j] = vF[j]-vK[1][j]-vE[j];
+		vK[7][j] = vE[j]-vF[j]-vG[j]+vH[j]-vK[4][j];
+	}
+
+	vK[0][0] += dF[0]*vK[1][3]; vK[0][1] += dF[1]*vK[2][3]; vK[0][2] += dF[2]*vK[3][3];
+	vK[1][1] += dF[1]*vK[4][3]; vK[1][2] += dF[2]*vK[6][3];
+	vK[2][0] += dF[0]*vK[4][3]; vK[2][2] += dF[2]*vK[5][3];
+	vK[3][0] += dF[0]*vK[6][3]; vK[3][1] += dF[1]*vK[5][3];
+	vK[4][2] += dF[2]*vK[7][3];
+	vK[5][0] += dF[0]*vK[7][3];
+	vK[6][1] += dF[1]*vK[7][3];
+
+	const float u = F[0], v = F[1], w = F[2];
+	float dNoise[4];
+	for(int j=0; j<4; j++)
+		dNoise[j] = vK[0][j] + u*vK[1][j] + v*(vK[2][j] + u*vK[4][j]) + w*(vK[3][j] + u*vK[6][j] + v*(vK[5][j] + u*vK[7][j]));
+
+	// (height, gradient)
+	res[0] = dNoise[3]; res[1] = dNoise[0]; res[2] = dNoise[1]; res[3] = dNoise[2];
+}
+
+void mydsnoise(float res[], const float p_in[])
+{
+	int iHash[8]; float p[3];
+	NoiseCell(iHash, p, p_in);
+	DSNoiseFromCell(res, iHash, p);
+}
+
+void mydsnoiseperiodic(float res[], const float p_in[], const int iPeriod)
+{
+	int iHash[8]; float p[3];
+	NoiseCellPeriodic(iHash, p, p_in, iPeriod);
+	DSNoiseFromCell(res, iHash, p);
+}
+
+// SIMPLEX noise, 4 corners on the skewed lattice with the hashes of mysnoise()
+static void SimplexCorners(int iHash[], float vX[][3], const float p_in[])
+{
+	const float p[] = { g_fSimplexFreq*p_in[0], g_fSimplexFreq*p_in[1], g_fSimplexFreq*p_in[2] };
+
+	const float F3 = 1.0f/3.0f;
+	const float G3 = 1.0f/6.0f;
+
+	// skew to the cubic lattice and back
+	const float fSkew = p[0]*F3 + p[1]*F3 + p[2]*F3;
+	float i0[3];
+	for(int k=0; k<3; k++) i0[k] = floorf(p[k] + fSkew);
+	const float fUnskew = i0[0]*G3 + i0[1]*G3 + i0[2]*G3;
+	float x0[3];
+	for(int k=0; k<3; k++) x0[k] = (p[k] - i0[k]) + fUnskew;
+
+	// rank order of the components picks one of the 6 simplices of the cube
+	const float g[] = { x0[0]>=x0[1] ? 1.0f : 0.0f, x0[1]>=x0[2] ? 1.0f : 0.0f, x0[2]>=x0[0] ? 1.0f : 0.0f };
+	const float l[] = { 1-g[0], 1-g[1], 1-g[2] };
+	const float i1[] = { g[0]<l[2] ? g[0] : l[2], g[1]<l[0] ? g[1] : l[0], g[2]<l[1] ? g[2] : l[1] };
+	const float i2[] = { g[0]>l[2] ? g[0] : l[2], g[1]>l[0] ? g[1] : l[0], g[2]>l[1] ? g[2] : l[1] };
+
+	int P[3], I1[3], I2[3];
+	for(int k=0; k<3; k++)
+	{
+		vX[0][k] = x0[k];
+		vX[1][k] = (x0[k] - i1[k]) + G3;
+		vX[2][k] = (x0[k] - i2[k]) + 2*G3;
+		vX[3][k] = (x0[k] - 1.0f) + 3*G3;
+
+		P[k] = ((int) i0[k]) & 255;
+		I1[k] = (int) i1[k]; I2[k] = (int) i2[k];
+	}
+
+	iHash[0] = perm(perm(perm(P[0]) + P[1]) + P[2]);
+	iHash[1] = perm(perm(perm(P[0] + I1[0]) + P[1] + I1[1]) + P[2] + I1[2]);
+	iHash[2] = perm(perm(perm(P[0] + I2[0]) + P[1] + I2[1]) + P[2] + I2[2]);
+	iHash[3] = perm(perm(perm(P[0] + 1) + P[1] + 1) + P[2] + 1);
+}
+
+static inline float SimplexFalloff(const float x[])
+{
+	const float t = 0.5f - (x[0]*x[0] + x[1]*x[1] + x[2]*x[2]);
+	return t>0.0f ? t : 0.0f;
+}
+
+float mysimplex(const float p[])
+{
+	int iHash[4]; float vX[4][3];
+	SimplexCorners(iHash, vX, p);
+
+	float noise = 0;
+	for(int c=0; c<4; c++)
+	{
+		const float t = SimplexFalloff(vX[c]);
+		const float t2 = t*t;
+		noise += (t2*t2) * grad(iHash[c], vX[c]);
+	}
+
+	return g_fSimplexScale*noise;
+}
+
+void mydssimplex(float res[], const float p[])
+{
+	int iHash[4]; float vX[4][3];
+	SimplexCorners(iHash, vX, p);
+
+	float dNoise[] = { 0, 0, 0, 0 };
+	for(int c=0; c<4; c++)
+	{
+		const float * vGrad = get_grad(iHash[c]);
+		const float t = SimplexFalloff(vX[c]);
+		const float t2 = t*t;
+		const float t4 = t2*t2;
+		const float d = vGrad[0]*vX[c][0] + vGrad[1]*vX[c][1] + vGrad[2]*vX[c][2];
+		const float fRadial = 8*t2*t*d;
+		dNoise[0] += t4*d;
+		for(int k=0; k<3; k++) dNoise[k+1] += t4*vGrad[k] - fRadial*vX[c][k];
+	}
+
+	// (height, gradient)
+	res[0] = g_fSimplexScale*dNoise[0];
+	for(int k=1; k<4; k++) res[k] = (g_fSimplexScale*g_fSimplexFreq)*dNoise[k];
+}
+
+float mynoise(const float p[])
+{
+	return 0.5f*mysnoise(p)+0.5f;
+}
+
+void mydnoise(float res[], const float p[])
+{
+	mydsnoise(res, p);
+	for(int k=0; k<4; k++) res[k] *= 0.5f;
+	res[0] += 0.5f;
+}
+
+
+static inline float VerifyPixSize(const float fPixSize)
+{
+	return fPixSize>g_fMinPixSize ? fPixSize : g_fMinPixSize;
+}
+
+static inline float filterweight(const float width)
+{
+	return 1 - smoothstep(0.25f, 0.75f, width);
+}
+
+static inline float filteredsnoise(const float p[], const float width)
+{
+	return mysnoise(p) * filterweight(width);
+}
+
+static inline void filtereddsnoise(float res[], const float p[], const float width)
+{
+	mydsnoise(res, p);
+	const float fW = filterweight(width);
+	for(int k=0; k<4; k++) res[k] *= fW;
+}
+
+static inline float filteredabs(const float x, const float dx)
+{
+	const float x0 = x-0.5f*dx;
+	const float x1 = x+0.5f*dx;
+	return (sign(x1)*x1*x1 - sign(x0)*x0*x0) / (2*dx);
+}
+
+static inline void filtereddssimplex(float res[], const float p[], const float width)
+{
+	mydssimplex(res, p);
+	const float fW = filterweight(width);
+	for(int k=0; k<4; k++) res[k] *= fW;
+}
+
+// filteredabs() of res[0] and its gradient given the gradient in res[1..3]
+static inline void dfilteredabs(float res[], const float dx)
+{
+	const float x0 = res[0]-0.5f*dx;
+	const float x1 = res[0]+0.5f*dx;
+	const float dabs = (fabsf(x1) - fabsf(x0)) / dx;
+	res[0] = (sign(x1)*x1*x1 - sign(x0)*x0*x0) / (2*dx);
+	for(int k=1; k<4; k++) res[k] *= dabs;
+}
+
+
+// FRACTAL SUM, the NEW_METHOD branch of noise.h
+float fractalsum(const float P[], const float fPixSize_in)
+{
+	float fracsum = 0;
+	const float fPixSize = VerifyPixSize(fPixSize_in);
+
+	float freq = 1;
+	float fw = fPixSize;
+	while(fw < 1.0f)
+	{
+		const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+		fracsum += (1/freq) * filteredsnoise(Q, fw);
+		freq*=2; fw *= 2;
+	}
+
+	return fracsum;
+}
+
+void dfractalsum(float res[], const float P[], const float fPixSize_in)
+{
+	res[0] = 0; res[1] = 0; res[2] = 0; res[3] = 0;
+	const float fPixSize = VerifyPixSize(fPixSize_in);
+
+	float freq = 1;
+	float fw = fPixSize;
+	while(fw < 1.0f)
+	{
+		const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+		float dN[4];
+#ifdef SIMPLEX_DERIVS
+		filtereddssimplex(dN, Q, fw);
+#else
+		filtereddsnoise(dN, Q, fw);
+#endif
+		res[0] += (1/freq) * dN[0];
+		res[1] += dN[1]; res[2] += dN[2]; res[3] += dN[3];
+		freq*=2; fw *= 2;
+	}
+}
+
+float turbulence(const float P[], const float fPixSize_in)
+{
+	float turb = 0;
+	const float fPixSize = VerifyPixSize(fPixSize_in);
+
+	float freq = 1;
+	float fw = fPixSize;
+	while(fw < 1.0f)
+	{
+		const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+		turb += (1/freq) * filteredabs( filteredsnoise(Q, fw), 2*fw);
+		freq*=2; fw *= 2;
+	}
+
+	return turb;
+}
+
+// dturbulence() with SIMPLEX_DERIVS, timed by CompareSimplexToPerlin() either way
+static void dturbulencesimplex(float res[], const float P[], const float fPixSize_in)
+{
+	res[0] = 0; res[1] = 0; res[2] = 0; res[3] = 0;
+	const float fPixSize = VerifyPixSize(fPixSize_in);
+
+	float freq = 1;
+	float fw = fPixSize;
+	while(fw < 1.0f)
+	{
+		const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+		float dN[4];
+		filtereddssimplex(dN, Q, fw);
+		dfilteredabs(dN, 2*fw);
+		res[0] += (1/freq) * dN[0];
+		res[1] += dN[1]; res[2] += dN[2]; res[3] += dN[3];
+		freq*=2; fw *= 2;
+	}
+}
+
+void dturbulence(float res[], const float P[], const float fPixSize_in)
+{
+#ifdef SIMPLEX_DERIVS
+	dturbulencesimplex(res, P, fPixSize_in);
+#else
+	const float pixSize = VerifyPixSize(fPixSize_in);
+
+	const float Prgt[] = { P[0]+pixSize, P[1], P[2] };
+	const float Pup[] = { P[0], P[1]+pixSize, P[2] };
+	const float Pdpth[] = { P[0], P[1], P[2]+pixSize };
+
+	const float Ncen = turbulence(P, pixSize);
+	const float Nrgt = turbulence(Prgt, pixSize);
+	const float Nup = turbulence(Pup, pixSize);
+	const float Ndpth = turbulence(Pdpth, pixSize);
+
+	res[0] = Ncen;
+	res[1] = (1.0f/pixSize)*(Nrgt-Ncen);
+	res[2] = (1.0f/pixSize)*(Nup-Ncen);
+	res[3] = (1.0f/pixSize)*(Ndpth-Ncen);
+#endif
+}
+
+
+// MAX versions, only the highest frequencies are accumulated
+float fractalsummax(const float P[], const float fPixSize_in, const int iMaxOctaves)
+{
+	float fracsum = 0;
+	const float fPixSize = VerifyPixSize(fPixSize_in);
+
+	const int iPermOctaves = -FloorLog2(fPixSize);
+	if(iPermOctaves>0)
+	{
+		float freq = ldexpf(1.0f, iPermOctaves-1);		// pow(2.0,fK-1)
+		const float weight = saturate((1 / (freq*fPixSize)) - 1);
+		float fw = fPixSize*freq;
+		const int iIterations = iPermOctaves<(iMaxOctaves-1) ? iPermOctaves : (iMaxOctaves-1);
+		for(int k=0; k<iIterations; k++)
+		{
+			const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+			fracsum += (1/freq) * filteredsnoise(Q, fw);
+			freq/=2; fw /= 2;
+		}
+		if(iPermOctaves>=iMaxOctaves)
+		{
+			const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+			fracsum += ((1-weight) / freq) * filteredsnoise(Q, fw);
+		}
+	}
+
+	return fracsum;
+}
+
+void dfractalsummax(float res[], const float P[], const float fPixSize_in, const int iMaxOctaves)
+{
+	res[0] = 0; res[1] = 0; res[2] = 0; res[3] = 0;
+	const float fPixSize = VerifyPixSize(fPixSize_in);
+
+	const int iPermOctaves = -FloorLog2(fPixSize);
+	if(iPermOctaves>0)
+	{
+		float freq = ldexpf(1.0f, iPermOctaves-1);
+		const float weight = saturate((1 / (freq*fPixSize)) - 1);
+		float fw = fPixSize*freq;
+		const int iIterations = iPermOctaves<(iMaxOctaves-1) ? iPermOctaves : (iMaxOctaves-1);
+		for(int k=0; k<iIterations; k++)
+		{
+			const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+			float dN[4];
+			filtereddsnoise(dN, Q, fw);
+			res[0] += (1.0f/freq) * dN[0];
+			res[1] += dN[1]; res[2] += dN[2]; res[3] += dN[3];
+			freq/=2; fw /= 2;
+		}
+		if(iPermOctaves>=iMaxOctaves)
+		{
+			const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+			float dN[4];
+			filtereddsnoise(dN, Q, fw);
+			res[0] += ((1-weight) * (1.0f/freq)) * dN[0];
+			res[1] += (1-weight) * dN[1]; res[2] += (1-weight) * dN[2]; res[3] += (1-weight) * dN[3];
+		}
+	}
+}
+
+float turbulencemax(const float P[], const float fPixSize_in, const int iMaxOctaves)
+{
+	float turb = 0;
+	const float fPixSize = VerifyPixSize(fPixSize_in);
+
+	const int iPermOctaves = -FloorLog2(fPixSize);
+	if(iPermOctaves>0)
+	{
+		float freq = ldexpf(1.0f, iPermOctaves-1);
+		const float weight = saturate((1 / (freq*fPixSize)) - 1);
+		float fw = fPixSize*freq;
+		const int iIterations = iPermOctaves<(iMaxOctaves-1) ? iPermOctaves : (iMaxOctaves-1);
+		for(int k=0; k<iIterations; k++)
+		{
+			const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+			turb += (1/freq) * filteredabs( filteredsnoise(Q, fw), 2*fw);
+			freq/=2; fw /= 2;
+		}
+		if(iPermOctaves>=iMaxOctaves)
+		{
+			const float Q[] = { P[0]*freq, P[1]*freq, P[2]*freq };
+			turb += ((1-weight) / freq) * filteredabs( filteredsnoise(Q, fw), 2*fw);
+		}
+	}
+
+	return turb;
+}
+
+void dturbulencemax(float res[], const float P[], const float fPixSize_in, const int iMaxOctaves)
+{
+	const float pixSize = VerifyPixSize(fPixSize_in);
+
+	const float Prgt[] = { P[0]+pixSize, P[1], P[2] };
+	const float Pup[] = { P[0], P[1]+pixSize, P[2] };
+	const float Pdpth[] = { P[0], P[1], P[2]+pixSize };
+
+	const float Ncen = turbulencemax(P, pixSize, iMaxOctaves);
+	const float Nrgt = turbulencemax(Prgt, pixSize, iMaxOctaves);
+	const float Nup = turbulencemax(Pup, pixSize, iMaxOctaves);
+	const float Ndpth = turbulencemax(Pdpth, pixSize, iMaxOctaves);
+
+	res[0] = Ncen;
+	res[1] = (1.0f/pixSize)*(Nrgt-Ncen);
+	res[2] = (1.0f/pixSize)*(Nup-Ncen);
+	res[3] = (1.0f/pixSize)*(Ndpth-Ncen);
+}
+
+
+/*********************************************************************************************
+***************************************** Batch paths ****************************************
+*********************************************************************************************/
+
+static void EvalNoiseScalar(float res[], const bool bDeriv, const eNoiseFunc func, const float P[], const float fPixSize, const int iMaxOctaves)
+{
+	if(bDeriv)
+	{
+		switch(func)
+		{
+			case NOISE_SNOISE: mydsnoise(res, P); break;
+			case NOISE_SIMPLEX: mydssimplex(res, P); break;
+			case NOISE_FRACTALSUM: dfractalsum(res, P, fPixSize); break;
+			case NOISE_TURBULENCE: dturbulence(res, P, fPixSize); break;
+			case NOISE_FRACTALSUM_MAX: dfractalsummax(res, P, fPixSize, iMaxOctaves); break;
+			case NOISE_TURBULENCE_MAX: dturbulencemax(res, P, fPixSize, iMaxOctaves); break;
+			default: res[0] = 0; res[1] = 0; res[2] = 0; res[3] = 0;
+		}
+	}
+	else
+	{
+		switch(func)
+		{
+			case NOISE_SNOISE: res[0] = mysnoise(P); break;
+			case NOISE_SIMPLEX: res[0] = mysimplex(P); break;
+			case NOISE_FRACTALSUM: res[0] = fractalsum(P, fPixSize); break;
+			case NOISE_TURBULENCE: res[0] = turbulence(P, fPixSize); break;
+			case NOISE_FRACTALSUM_MAX: res[0] = fractalsummax(P, fPixSize, iMaxOctaves); break;
+			case NOISE_TURBULENCE_MAX: res[0] = turbulencemax(P, fPixSize, iMaxOctaves); break;
+			default: res[0] = 0;
+		}
+	}
+}
+
+static void NoiseBatchScalar(float * pfRes[], const bool bDeriv, const eNoiseFunc func, const float pfX[], const float pfY[], const float pfZ[],
+							 const int iStart, const int iEnd, const float * pfPixSize, const float fPixSize, const int iMaxOctaves)
+{
+	for(int i=iStart; i<iEnd; i++)
+	{
+		const float P[] = { pfX[i], pfY[i], pfZ[i] };
+		float res[4];
+		EvalNoiseScalar(res, bDeriv, func, P, pfPixSize!=NULL ? pfPixSize[i] : fPixSize, iMaxOctaves);
+
+		pfRes[0][i] = res[0];
+		if(bDeriv) { pfRes[1][i] = res[1]; pfRes[2][i] = res[2]; pfRes[3][i] = res[3]; }
+	}
+}
+
+#ifdef SIMD_HAS_AVX2_PATH
+// 8 lanes at a time. The permutation and gradient lookups are gathers and
+// the arithmetic is vectorized in the same order as the scalar path. The
+// octave loops run until the last lane is done, lanes that finished early
+// are left untouched by blending.
+
+SIMD_AVX2_FUNC static inline __m256 Fade8(const __m256 t)
+{
+	const __m256 vInner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), vInner);
+}
+
+SIMD_AVX2_FUNC static inline __m256 DFade8(const __m256 t)
+{
+	const __m256 vInner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(t, _mm256_set1_ps(2.0f))), _mm256_set1_ps(1.0f));
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(30.0f), t), t), vInner);
+}
+
+SIMD_AVX2_FUNC static inline __m256i Perm8(const __m256i viX)
+{
+	return _mm256_i32gather_epi32(g_permTable32.iPerm, _mm256_and_si256(viX, _mm256_set1_epi32(255)), 4);
+}
+
+SIMD_AVX2_FUNC static inline __m256 Lerp8(const __m256 a, const __m256 b, const __m256 t)
+{
+	return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+SIMD_AVX2_FUNC static inline __m256 Saturate8(const __m256 x)
+{
+	return _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+}
+
+SIMD_AVX2_FUNC static inline __m256 FilterWeight8(const __m256 vWidth)
+{
+	const __m256 t = Saturate8(_mm256_div_ps(_mm256_sub_ps(vWidth, _mm256_set1_ps(0.25f)), _mm256_set1_ps(0.75f-0.25f)));
+	const __m256 vSmooth = _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_set1_ps(2.0f), t)));
+	return _mm256_sub_ps(_mm256_set1_ps(1.0f), vSmooth);
+}
+
+SIMD_AVX2_FUNC static inline __m256 FilteredAbs8(const __m256 x, const __m256 dx)
+{
+	const __m256 vOne = _mm256_set1_ps(1.0f), vZero = _mm256_setzero_ps();
+	const __m256 vHalfDx = _mm256_mul_ps(_mm256_set1_ps(0.5f), dx);
+	const __m256 x0 = _mm256_sub_ps(x, vHalfDx), x1 = _mm256_add_ps(x, vHalfDx);
+
+	// sign(), either 1, -1 or 0
+	const __m256 vSign0 = _mm256_or_ps(_mm256_and_ps(_mm256_cmp_ps(x0, vZero, _CMP_GT_OQ), vOne), _mm256_and_ps(_mm256_cmp_ps(x0, vZero, _CMP_LT_OQ), _mm256_set1_ps(-1.0f)));
+	const __m256 vSign1 = _mm256_or_ps(_mm256_and_ps(_mm256_cmp_ps(x1, vZero, _CMP_GT_OQ), vOne), _mm256_and_ps(_mm256_cmp_ps(x1, vZero, _CMP_LT_OQ), _mm256_set1_ps(-1.0f)));
+
+	const __m256 vNum = _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(vSign1, x1), x1), _mm256_mul_ps(_mm256_mul_ps(vSign0, x0), x0));
+	return _mm256_div_ps(vNum, _mm256_mul_ps(_mm256_set1_ps(2.0f), dx));
+}
+
+SIMD_AVX2_FUNC static inline void NoiseCell8(__m256i viHash[], __m256 vFr[], const __m256 vP[])
+{
+	__m256i viP[3];
+	for(int k=0; k<3; k++)
+	{
+		viP[k] = _mm256_cvttps_epi32(_mm256_floor_ps(vP[k]));
+		vFr[k] = _mm256_sub_ps(vP[k], _mm256_cvtepi32_ps(viP[k]));
+		viP[k] = _mm256_and_si256(viP[k], _mm256_set1_epi32(255));
+	}
+
+	const __m256i viOne = _mm256_set1_epi32(1);
+	const __m256i viA = _mm256_add_epi32(Perm8(viP[0]), viP[1]);
+	const __m256i viAA = _mm256_add_epi32(Perm8(viA), viP[2]);
+	const __m256i viAB = _mm256_add_epi32(Perm8(_mm256_add_epi32(viA, viOne)), viP[2]);
+	const __m256i viB = _mm256_add_epi32(Perm8(_mm256_add_epi32(viP[0], viOne)), viP[1]);
+	const __m256i viBA = _mm256_add_epi32(Perm8(viB), viP[2]);
+	const __m256i viBB = _mm256_add_epi32(Perm8(_mm256_add_epi32(viB, viOne)), viP[2]);
+
+	viHash[0] = Perm8(viAA); viHash[1] = Perm8(viBA); viHash[2] = Perm8(viAB); viHash[3] = Perm8(viBB);
+	viHash[4] = Perm8(_mm256_add_epi32(viAA, viOne)); viHash[5] = Perm8(_mm256_add_epi32(viBA, viOne));
+	viHash[6] = Perm8(_mm256_add_epi32(viAB, viOne)); viHash[7] = Perm8(_mm256_add_epi32(viBB, viOne));
+}
+
+// gradient of corner c in vGrad[] and its dot product with the corner offset
+SIMD_AVX2_FUNC static inline __m256 CornerGrad8(__m256 vGrad[], const __m256i viHash, const __m256 vFr[], const int c)
+{
+	const __m256i viIdx = _mm256_mullo_epi32(_mm256_and_si256(viHash, _mm256_set1_epi32(15)), _mm256_set1_epi32(3));
+	const __m256 vMinusOne = _mm256_set1_ps(-1.0f);
+
+	__m256 vDot = _mm256_setzero_ps();
+	for(int k=0; k<3; k++)
+	{
+		vGrad[k] = _mm256_i32gather_ps(&g_fNoiseGradArray[0][k], viIdx, 4);
+		const __m256 vQ = ((c>>k)&1)!=0 ? _mm256_add_ps(vFr[k], vMinusOne) : vFr[k];
+		vDot = k==0 ? _mm256_mul_ps(vGrad[k], vQ) : _mm256_add_ps(vDot, _mm256_mul_ps(vGrad[k], vQ));
+	}
+	return vDot;
+}
+
+SIMD_AVX2_FUNC static __m256 SNoise8(const __m256 vP[])
+{
+	__m256i viHash[8]; __m256 vFr[3];
+	NoiseCell8(viHash, vFr, vP);
+
+	const __m256 vF[] = { Fade8(vFr[0]), Fade8(vFr[1]), Fade8(vFr[2]) };
+
+	__m256 vC[8];
+	for(int i=0; i<8; i++)
+	{
+		__m256 vGrad[3];
+		vC[i] = CornerGrad8(vGrad, viHash[i], vFr, i);
+	}
+
+	return Lerp8(
+		Lerp8(Lerp8(vC[0], vC[1], vF[0]), Lerp8(vC[2], vC[3], vF[0]), vF[1]),
+		Lerp8(Lerp8(vC[4], vC[5], vF[0]), Lerp8(vC[6], vC[7], vF[0]), vF[1]),
+		vF[2]);
+}
+
+SIMD_AVX2_FUNC static void DSNoise8(__m256 vRes[], const __m256 vP[])
+{
+	__m256i viHash[8]; __m256 vFr[3];
+	NoiseCell8(viHash, vFr, vP);
+
+	const __m256 F[] = { Fade8(vFr[0]), Fade8(vFr[1]), Fade8(vFr[2]) };
+	const __m256 dF[] = { DFade8(vFr[0]), DFade8(vFr[1]), DFade8(vFr[2]) };
+
+	__m256 vC[8][4];
+	for(int i=0; i<8; i++)
+		vC[i][3] = CornerGrad8(vC[i], viHash[i], vFr, i);
+
+	__m256 vK[8][4];
+	for(int j=0; j<4; j++)
+	{
+		vK[0][j] = vC[0][j];
+		vK[1][j] = _mm256_sub_ps(vC[1][j], vC[0][j]);
+		vK[2][j] = _mm256_sub_ps(vC[2][j], vC[0][j]);
+		vK[3][j] = _mm256_sub_ps(vC[4][j], vC[0][j]);
+		vK[4][j] = _mm256_sub_ps(_mm256_sub_ps(vC[3][j], vK[1][j]), vC[2][j]);
+		vK[5][j] = _mm256_sub_ps(_mm256_sub_ps(vC[6][j], vK[2][j]), vC[4][j]);
+		vK[6][j] = _mm256_sub_ps(_mm256_sub_ps(vC[5][j], vK[1][j]), vC[4][j]);
+		vK[7][j] = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(vC[4][j], vC[5][j]), vC[6][j]), vC[7][j]), vK[4][j]);
+	}
+
+	vK[0][0] = _mm256_add_ps(vK[0][0], _mm256_mul_ps(dF[0], vK[1][3]));
+	vK[0][1] = _mm256_add_ps(vK[0][1], _mm256_mul_ps(dF[1], vK[2][3]));
+	vK[0][2] = _mm256_add_ps(vK[0][2], _mm256_mul_ps(dF[2], vK[3][3]));
+	vK[1][1] = _mm256_add_ps(vK[1][1], _mm256_mul_ps(dF[1], vK[4][3]));
+	vK[1][2] = _mm256_add_ps(vK[1][2], _mm256_mul_ps(dF[2], vK[6][3]));
+	vK[2][0] = _mm256_add_ps(vK[2][0], _mm256_mul_ps(dF[0], vK[4][3]));
+	vK[2][2] = _mm256_add_ps(vK[2][2], _mm256_mul_ps(dF[2], vK[5][3]));
+	vK[3][0] = _mm256_add_ps(vK[3][0], _mm256_mul_ps(dF[0], vK[6][3]));
+	vK[3][1] = _mm256_add_ps(vK[3][1], _mm256_mul_ps(dF[1], vK[5][3]));
+	vK[4][2] = _mm256_add_ps(vK[4][2], _mm256_mul_ps(dF[2], vK[7][3]));
+	vK[5][0] = _mm256_add_ps(vK[5][0], _mm256_mul_ps(dF[0], vK[7][3]));
+	vK[6][1] = _mm256_add_ps(vK[6][1], _mm256_mul_ps(dF[1], vK[7][3]));
+
+	const __m256 u = F[0], v = F[1], w = F[2];
+	__m256 dNoise[4];
+	for(int j=0; j<4; j++)
+	{
+		const __m256 vUV = _mm256_add_ps(_mm256_add_ps(vK[0][j], _mm256_mul_ps(u, vK[1][j])), _mm256_mul_ps(v, _mm256_add_ps(vK[2][j], _mm256_mul_ps(u, vK[4][j]))));
+		const __m256 vW = _mm256_add_ps(_mm256_add_ps(vK[3][j], _mm256_mul_ps(u, vK[6][j])), _mm256_mul_ps(v, _mm256_add_ps(vK[5][j], _mm256_mul_ps(u, vK[7][j]))));
+		dNoise[j] = _mm256_add_ps(vUV, _mm256_mul_ps(w, vW));
+	}
+
+	vRes[0] = dNoise[3]; vRes[1] = dNoise[0]; vRes[2] = dNoise[1]; vRes[3] = dNoise[2];
+}
+
+// mysimplex() in vRes[0] and with bDeriv mydssimplex() in vRes[]
+SIMD_AVX2_FUNC static void Simplex8(__m256 vRes[], const __m256 vP_in[], const bool bDeriv)
+{
+	const __m256 vFreq = _mm256_set1_ps(g_fSimplexFreq);
+	const __m256 vP[] = { _mm256_mul_ps(vFreq, vP_in[0]), _mm256_mul_ps(vFreq, vP_in[1]), _mm256_mul_ps(vFreq, vP_in[2]) };
+
+	const __m256 vF3 = _mm256_set1_ps(1.0f/3.0f), vG3 = _mm256_set1_ps(1.0f/6.0f);
+	const __m256 vOne = _mm256_set1_ps(1.0f), vZero = _mm256_setzero_ps();
+
+	const __m256 vSkew = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vP[0], vF3), _mm256_mul_ps(vP[1], vF3)), _mm256_mul_ps(vP[2], vF3));
+	__m256 vI0[3];
+	for(int k=0; k<3; k++) vI0[k] = _mm256_floor_ps(_mm256_add_ps(vP[k], vSkew));
+	const __m256 vUnskew = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vI0[0], vG3), _mm256_mul_ps(vI0[1], vG3)), _mm256_mul_ps(vI0[2], vG3));
+	__m256 vX0[3];
+	for(int k=0; k<3; k++) vX0[k] = _mm256_add_ps(_mm256_sub_ps(vP[k], vI0[k]), vUnskew);
+
+	// rank order of the components
+	__m256 vG[3], vL[3];
+	for(int k=0; k<3; k++)
+	{
+		vG[k] = _mm256_and_ps(_mm256_cmp_ps(vX0[k], vX0[(k+1)%3], _CMP_GE_OQ), vOne);
+		vL[k] = _mm256_sub_ps(vOne, vG[k]);
+	}
+
+	const __m256 vTwoG3 = _mm256_set1_ps(2*(1.0f/6.0f)), vThreeG3 = _mm256_set1_ps(3*(1.0f/6.0f));
+	__m256 vX[4][3]; __m256i viOffs[4][3], viP[3];
+	for(int k=0; k<3; k++)
+	{
+		const __m256 vI1 = _mm256_min_ps(vG[k], vL[(k+2)%3]);
+		const __m256 vI2 = _mm256_max_ps(vG[k], vL[(k+2)%3]);
+		vX[0][k] = vX0[k];
+		vX[1][k] = _mm256_add_ps(_mm256_sub_ps(vX0[k], vI1), vG3);
+		vX[2][k] = _mm256_add_ps(_mm256_sub_ps(vX0[k], vI2), vTwoG3);
+		vX[3][k] = _mm256_add_ps(_mm256_sub_ps(vX0[k], vOne), vThreeG3);
+
+		viP[k] = _mm256_and_si256(_mm256_cvttps_epi32(vI0[k]), _mm256_set1_epi32(255));
+		viOffs[0][k] = _mm256_setzero_si256();
+		viOffs[1][k] = _mm256_cvttps_epi32(vI1);
+		viOffs[2][k] = _mm256_cvttps_epi32(vI2);
+		viOffs[3][k] = _mm256_set1_epi32(1);
+	}
+
+	const int iNrOut = bDeriv ? 4 : 1;
+	for(int j=0; j<iNrOut; j++) vRes[j] = vZero;
+	for(int c=0; c<4; c++)
+	{
+		const __m256i viX = _mm256_add_epi32(viP[0], viOffs[c][0]);
+		const __m256i viY = _mm256_add_epi32(viP[1], viOffs[c][1]);
+		const __m256i viZ = _mm256_add_epi32(viP[2], viOffs[c][2]);
+		const __m256i viHash = Perm8(_mm256_add_epi32(Perm8(_mm256_add_epi32(Perm8(viX), viY)), viZ));
+		const __m256i viIdx = _mm256_mullo_epi32(_mm256_and_si256(viHash, _mm256_set1_epi32(15)), _mm256_set1_epi32(3));
+
+		__m256 vGrad[3];
+		for(int k=0; k<3; k++) vGrad[k] = _mm256_i32gather_ps(&g_fNoiseGradArray[0][k], viIdx, 4);
+		const __m256 vD = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vGrad[0], vX[c][0]), _mm256_mul_ps(vGrad[1], vX[c][1])), _mm256_mul_ps(vGrad[2], vX[c][2]));
+		const __m256 vR2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vX[c][0], vX[c][0]), _mm256_mul_ps(vX[c][1], vX[c][1])), _mm256_mul_ps(vX[c][2], vX[c][2]));
+		const __m256 vT = _mm256_max_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), vR2), vZero);
+		const __m256 vT2 = _mm256_mul_ps(vT, vT);
+		const __m256 vT4 = _mm256_mul_ps(vT2, vT2);
+
+		vRes[0] = _mm256_add_ps(vRes[0], _mm256_mul_ps(vT4, vD));
+		if(bDeriv)
+		{
+			const __m256 vRadial = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(8.0f), vT2), vT), vD);
+			for(int k=0; k<3; k++)
+				vRes[k+1] = _mm256_add_ps(vRes[k+1], _mm256_sub_ps(_mm256_mul_ps(vT4, vGrad[k]), _mm256_mul_ps(vRadial, vX[c][k])));
+		}
+	}
+
+	vRes[0] = _mm256_mul_ps(_mm256_set1_ps(g_fSimplexScale), vRes[0]);
+	for(int j=1; j<iNrOut; j++) vRes[j] = _mm256_mul_ps(_mm256_set1_ps(g_fSimplexScale*g_fSimplexFreq), vRes[j]);
+}
+
+// filteredabs() of vRes[0] and its gradient given the gradient in vRes[1..3]
+SIMD_AVX2_FUNC static inline void DFilteredAbs8(__m256 vRes[], const __m256 dx)
+{
+	const __m256 vHalfDx = _mm256_mul_ps(_mm256_set1_ps(0.5f), dx);
+	const __m256 vAbsMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	const __m256 vAbs0 = _mm256_and_ps(_mm256_sub_ps(vRes[0], vHalfDx), vAbsMask);
+	const __m256 vAbs1 = _mm256_and_ps(_mm256_add_ps(vRes[0], vHalfDx), vAbsMask);
+	const __m256 vDAbs = _mm256_div_ps(_mm256_sub_ps(vAbs1, vAbs0), dx);
+
+	vRes[0] = FilteredAbs8(vRes[0], dx);
+	for(int k=1; k<4; k++) vRes[k] = _mm256_mul_ps(vRes[k], vDAbs);
+}
+
+SIMD_AVX2_FUNC static inline __m256 VerifyPixSize8(const __m256 vPixSize)
+{
+	return _mm256_max_ps(vPixSize, _mm256_set1_ps(g_fMinPixSize));
+}
+
+// one octave at frequency vFreq. bDeriv gives (value, gradient) in vRes[]
+// and otherwise the value in vRes[0], bTurbulence applies filteredabs().
+// bSimplex selects mydssimplex() over mydsnoise() for the derivative.
+SIMD_AVX2_FUNC static inline void Octave8(__m256 vRes[], const __m256 vP[], const __m256 vFreq, const __m256 vFw, const bool bDeriv, const bool bTurbulence, const bool bSimplex)
+{
+	const __m256 vQ[] = { _mm256_mul_ps(vP[0], vFreq), _mm256_mul_ps(vP[1], vFreq), _mm256_mul_ps(vP[2], vFreq) };
+	const __m256 vW = FilterWeight8(vFw);
+
+	if(bDeriv)
+	{
+		if(bSimplex) Simplex8(vRes, vQ, true);
+		else DSNoise8(vRes, vQ);
+		for(int k=0; k<4; k++) vRes[k] = _mm256_mul_ps(vRes[k], vW);
+		if(bTurbulence) DFilteredAbs8(vRes, _mm256_mul_ps(_mm256_set1_ps(2.0f), vFw));
+	}
+	else
+	{
+		vRes[0] = _mm256_mul_ps(SNoise8(vQ), vW);
+		if(bTurbulence) vRes[0] = FilteredAbs8(vRes[0], _mm256_mul_ps(_mm256_set1_ps(2.0f), vFw));
+	}
+}
+
+// fractalsum(), turbulence(), dfractalsum() and with SIMPLEX_DERIVS dturbulence()
+SIMD_AVX2_FUNC static void FractalSum8(__m256 vRes[], const __m256 vP[], const __m256 vPixSize_in, const bool bDeriv, const bool bTurbulence)
+{
+#ifdef SIMPLEX_DERIVS
+	const bool bSimplex = bDeriv;
+#else
+	const bool bSimplex = false;
+#endif
+	const __m256 vOne = _mm256_set1_ps(1.0f), vTwo = _mm256_set1_ps(2.0f);
+	const int iNrOut = bDeriv ? 4 : 1;
+	for(int k=0; k<iNrOut; k++) vRes[k] = _mm256_setzero_ps();
+
+	__m256 vFreq = vOne;
+	__m256 vFw = VerifyPixSize8(vPixSize_in);
+	while(true)
+	{
+		const __m256 vActive = _mm256_cmp_ps(vFw, vOne, _CMP_LT_OQ);
+		if(_mm256_movemask_ps(vActive)==0) break;
+
+		__m256 vOct[4];
+		Octave8(vOct, vP, vFreq, vFw, bDeriv, bTurbulence, bSimplex);
+		vOct[0] = _mm256_mul_ps(_mm256_div_ps(vOne, vFreq), vOct[0]);
+		for(int k=0; k<iNrOut; k++) vRes[k] = _mm256_blendv_ps(vRes[k], _mm256_add_ps(vRes[k], vOct[k]), vActive);
+
+		vFreq = _mm256_mul_ps(vFreq, vTwo); vFw = _mm256_mul_ps(vFw, vTwo);
+	}
+}
+
+// fractalsummax(), turbulencemax() and dfractalsummax()
+SIMD_AVX2_FUNC static void FractalSumMax8(__m256 vRes[], const __m256 vP[], const __m256 vPixSize_in, const int iMaxOctaves, const bool bDeriv, const bool bTurbulence)
+{
+	const __m256 vOne = _mm256_set1_ps(1.0f), vTwo = _mm256_set1_ps(2.0f);
+	const int iNrOut = bDeriv ? 4 : 1;
+	for(int k=0; k<iNrOut; k++) vRes[k] = _mm256_setzero_ps();
+
+	const __m256 vPixSize = VerifyPixSize8(vPixSize_in);
+
+	// -floor(log2()) from the exponent bits
+	const __m256i viExp = _mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(vPixSize), 23), _mm256_set1_epi32(0xff));
+	const __m256i viPermOctaves = _mm256_sub_epi32(_mm256_set1_epi32(127), viExp);
+	const __m256i viValid = _mm256_cmpgt_epi32(viPermOctaves, _mm256_setzero_si256());
+	if(_mm256_movemask_epi8(viValid)==0) return;
+
+	// pow(2.0,fK-1), clamped in lanes without octaves
+	const __m256i viClamped = _mm256_max_epi32(viPermOctaves, _mm256_set1_epi32(1));
+	__m256 vFreq = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(viClamped, _mm256_set1_epi32(126)), 23));
+	const __m256 vWeight = Saturate8(_mm256_sub_ps(_mm256_div_ps(vOne, _mm256_mul_ps(vFreq, vPixSize)), vOne));
+	__m256 vFw = _mm256_mul_ps(vPixSize, vFreq);
+	const __m256i viIterations = _mm256_min_epi32(viPermOctaves, _mm256_set1_epi32(iMaxOctaves-1));
+
+	for(int k=0; ; k++)
+	{
+		const __m256 vActive = _mm256_castsi256_ps(_mm256_cmpgt_epi32(viIterations, _mm256_set1_epi32(k)));
+		if(_mm256_movemask_ps(vActive)==0) break;
+
+		__m256 vOct[4];
+		Octave8(vOct, vP, vFreq, vFw, bDeriv, bTurbulence, false);
+		vOct[0] = _mm256_mul_ps(_mm256_div_ps(vOne, vFreq), vOct[0]);
+		for(int j=0; j<iNrOut; j++) vRes[j] = _mm256_blendv_ps(vRes[j], _mm256_add_ps(vRes[j], vOct[j]), vActive);
+
+		vFreq = _mm256_blendv_ps(vFreq, _mm256_div_ps(vFreq, vTwo), vActive);
+		vFw = _mm256_blendv_ps(vFw, _mm256_div_ps(vFw, vTwo), vActive);
+	}
+
+	const __m256 vLast = _mm256_castsi256_ps(_mm256_and_si256(viValid, _mm256_cmpgt_epi32(viPermOctaves, _mm256_set1_epi32(iMaxOctaves-1))));
+	if(_mm256_movemask_ps(vLast)!=0)
+	{
+		__m256 vOct[4];
+		Octave8(vOct, vP, vFreq, vFw, bDeriv, bTurbulence, false);
+		const __m256 vOneMinusWeight = _mm256_sub_ps(vOne, vWeight);
+		if(bDeriv)
+		{
+			vOct[0] = _mm256_mul_ps(_mm256_mul_ps(vOneMinusWeight, _mm256_div_ps(vOne, vFreq)), vOct[0]);
+			for(int j=1; j<4; j++) vOct[j] = _mm256_mul_ps(vOneMinusWeight, vOct[j]);
+		}
+		else
+			vOct[0] = _mm256_mul_ps(_mm256_div_ps(vOneMinusWeight, vFreq), vOct[0]);
+
+		for(int j=0; j<iNrOut; j++) vRes[j] = _mm256_blendv_ps(vRes[j], _mm256_add_ps(vRes[j], vOct[j]), vLast);
+	}
+}
+
+// dturbulencemax() and without SIMPLEX_DERIVS dturbulence()
+SIMD_AVX2_FUNC static void DTurbulence8(__m256 vRes[], const __m256 vP[], const __m256 vPixSize_in, const bool bMax, const int iMaxOctaves)
+{
+	const __m256 vPixSize = VerifyPixSize8(vPixSize_in);
+	const __m256 vInvPixSize = _mm256_div_ps(_mm256_set1_ps(1.0f), vPixSize);
+
+	__m256 vN[4];
+	for(int k=0; k<4; k++)
+	{
+		__m256 vQ[] = { vP[0], vP[1], vP[2] };
+		if(k>0) vQ[k-1] = _mm256_add_ps(vQ[k-1], vPixSize);
+		if(bMax) FractalSumMax8(&vN[k], vQ, vPixSize, iMaxOctaves, false, true);
+		else FractalSum8(&vN[k], vQ, vPixSize, false, true);
+	}
+
+	vRes[0] = vN[0];
+	for(int k=1; k<4; k++) vRes[k] = _mm256_mul_ps(vInvPixSize, _mm256_sub_ps(vN[k], vN[0]));
+}
+
+SIMD_AVX2_FUNC static int NoiseBatchAVX2(float * pfRes[], const bool bDeriv, const eNoiseFunc func, const float pfX[], const float pfY[], const float pfZ[],
+										 const int N, const float * pfPixSize, const float fPixSize, const int iMaxOctaves)
+{
+	int i=0;
+	for(; (i+8)<=N; i+=8)
+	{
+		const __m256 vP[] = { _mm256_loadu_ps(pfX+i), _mm256_loadu_ps(pfY+i), _mm256_loadu_ps(pfZ+i) };
+		const __m256 vPixSize = pfPixSize!=NULL ? _mm256_loadu_ps(pfPixSize+i) : _mm256_set1_ps(fPixSize);
+
+		__m256 vRes[4];
+		switch(func)
+		{
+			case NOISE_SNOISE:
+				if(bDeriv) DSNoise8(vRes, vP);
+				else vRes[0] = SNoise8(vP);
+				break;
+			case NOISE_SIMPLEX: Simplex8(vRes, vP, bDeriv); break;
+			case NOISE_FRACTALSUM: FractalSum8(vRes, vP, vPixSize, bDeriv, false); break;
+			case NOISE_TURBULENCE:
+#ifdef SIMPLEX_DERIVS
+				FractalSum8(vRes, vP, vPixSize, bDeriv, true);
+#else
+				if(bDeriv) DTurbulence8(vRes, vP, vPixSize, false, iMaxOctaves);
+				else FractalSum8(vRes, vP, vPixSize, false, true);
+#endif
+				break;
+			case NOISE_FRACTALSUM_MAX: FractalSumMax8(vRes, vP, vPixSize, iMaxOctaves, bDeriv, false); break;
+			case NOISE_TURBULENCE_MAX:
+				if(bDeriv) DTurbulence8(vRes, vP, vPixSize, true, iMaxOctaves);
+				else FractalSumMax8(vRes, vP, vPixSize, iMaxOctaves, false, true);
+				break;
+			default:
+				for(int k=0; k<4; k++) vRes[k] = _mm256_setzero_ps();
+		}
+
+		_mm256_storeu_ps(pfRes[0]+i, vRes[0]);
+		if(bDeriv) for(int k=1; k<4; k++) _mm256_storeu_ps(pfRes[k]+i, vRes[k]);
+	}
+
+	return i;
+}
+#endif
+
+
+static bool g_bAVX2Enabled = CpuSupportsAVX2();
+
+bool IsNoiseAVX2Enabled()
+{
+	return g_bAVX2Enabled;
+}
+
+static void NoiseBatchInternal(float * pfRes[], const bool bDeriv, const eNoiseFunc func, const float pfX[], const float pfY[], const float pfZ[],
+							   const int N, const float * pfPixSize, const float fPixSize, const int iMaxOctaves)
+{
+	int iDone = 0;
+#ifdef SIMD_HAS_AVX2_PATH
+	if(g_bAVX2Enabled) iDone = NoiseBatchAVX2(pfRes, bDeriv, func, pfX, pfY, pfZ, N, pfPixSize, fPixSize, iMaxOctaves);
+#endif
+	NoiseBatchScalar(pfRes, bDeriv, func, pfX, pfY, pfZ, iDone, N, pfPixSize, fPixSize, iMaxOctaves);
+}
+
+void NoiseBatch(float pfRes[], const eNoiseFunc func, const float pfX[], const float pfY[], const float pfZ[], const int N,
+				const float * pfPixSize, const float fPixSize, const int iMaxOctaves)
+{
+	float * pfDst[] = { pfRes };
+	NoiseBatchInternal(pfDst, false, func, pfX, pfY, pfZ, N, pfPixSize, fPixSize, iMaxOctaves);
+}
+
+void DNoiseBatch(float * pfRes[], const eNoiseFunc func, const float pfX[], const float pfY[], const float pfZ[], const int N,
+				 const float * pfPixSize, const float fPixSize, const int iMaxOctaves)
+{
+	NoiseBatchInternal(pfRes, true, func, pfX, pfY, pfZ, N, pfPixSize, fPixSize, iMaxOctaves);
+}
+
+
+/*********************************************************************************************
+************************************* Simplex vs. Perlin *************************************
+*********************************************************************************************/
+
+// in place radix 2 FFT of n complex values, interleaved
+static void FFT(double pfData[], const int n)
+{
+	for(int i=1, j=0; i<n; i++)
+	{
+		int iBit = n>>1;
+		for(; (j&iBit)!=0; iBit>>=1) j ^= iBit;
+		j ^= iBit;
+		if(i<j)
+		{
+			const double fRe = pfData[2*i], fIm = pfData[2*i+1];
+			pfData[2*i] = pfData[2*j]; pfData[2*i+1] = pfData[2*j+1];
+			pfData[2*j] = fRe; pfData[2*j+1] = fIm;
+		}
+	}
+
+	for(int iLen=2; iLen<=n; iLen<<=1)
+	{
+		const double fAng = -2*3.14159265358979323846/iLen;
+		for(int i=0; i<n; i+=iLen)
+			for(int k=0; k<(iLen/2); k++)
+			{
+				const double fWRe = cos(fAng*k), fWIm = sin(fAng*k);
+				double * a = &pfData[2*(i+k)], * b = &pfData[2*(i+k+iLen/2)];
+				const double fRe = b[0]*fWRe - b[1]*fWIm, fIm = b[0]*fWIm + b[1]*fWRe;
+				b[0] = a[0]-fRe; b[1] = a[1]-fIm;
+				a[0] += fRe; a[1] += fIm;
+			}
+	}
+}
+
+typedef void (*PFN_DNOISE)(float res[], const float p[]);
+
+static void MeasureNoise(SNoiseDistribution * pDist, std::vector<int> &histo, PFN_DNOISE pNoise, const int iNrSamples)
+{
+	const int iNrBins = (int) histo.size();
+	double fSum = 0, fSum2 = 0, fSum4 = 0, fGrad2 = 0;
+	pDist->fMin = 1e30f; pDist->fMax = -1e30f;
+
+	// same points for both, the timed loop only calls the noise
+	std::vector<float> points(3*iNrSamples), results(4*iNrSamples);
+	unsigned int uSeed = 0x9e3779b9u;
+	for(int i=0; i<(3*iNrSamples); i++) { uSeed = uSeed*1664525u + 1013904223u; points[i] = 256.0f*((uSeed>>8) / 16777216.0f); }
+
+	const auto t0 = std::chrono::high_resolution_clock::now();
+	for(int i=0; i<iNrSamples; i++) pNoise(&results[4*i], &points[3*i]);
+	const double fSecs = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count();
+
+	for(int i=0; i<iNrSamples; i++)
+	{
+		const float * res = &results[4*i];
+		const double x = res[0];
+		fSum += x; fSum2 += x*x; fSum4 += x*x*x*x;
+		fGrad2 += ((double) res[1])*res[1] + ((double) res[2])*res[2] + ((double) res[3])*res[3];
+		if(res[0]<pDist->fMin) pDist->fMin = res[0];
+		if(res[0]>pDist->fMax) pDist->fMax = res[0];
+
+		const int iBin = (int) floor((x+1)*0.5*iNrBins);
+		++histo[iBin<0 ? 0 : (iBin<iNrBins ? iBin : (iNrBins-1))];
+	}
+
+	const double fMean = fSum/iNrSamples;
+	const double fVar = fSum2/iNrSamples - fMean*fMean;
+	pDist->fMean = (float) fMean;
+	pDist->fStdDev = (float) sqrt(fVar>0 ? fVar : 0);
+	pDist->fExcessKurtosis = fVar>0 ? ((float) ((fSum4/iNrSamples) / (fVar*fVar) - 3)) : 0.0f;		// assumes a near zero mean
+	pDist->fGradRms = (float) sqrt(fGrad2/iNrSamples);
+	pDist->fNsPerCall = (float) (1e9*fSecs/iNrSamples);
+
+	// power spectrum of slices through the volume, averaged over a few
+	const int iRes = NOISE_SPECTRUM_RES;
+	const int iNrSlices = 4;
+	std::vector<double> data(2*iRes*iRes), col(2*iRes);
+	double fBand[NOISE_SPECTRUM_BANDS] = { 0 }, fTotal = 0, fFreqSum = 0;
+	for(int s=0; s<iNrSlices; s++)
+	{
+		for(int y=0; y<iRes; y++)
+		{
+			for(int x=0; x<iRes; x++)
+			{
+				const float P[] = { (x+0.5f)/8, (y+0.5f)/8, 17.3f*s + 0.37f };
+				float res[4];
+				pNoise(res, P);
+				data[2*(y*iRes+x)] = res[0]; data[2*(y*iRes+x)+1] = 0;
+			}
+			FFT(&data[2*y*iRes], iRes);
+		}
+		for(int x=0; x<iRes; x++)
+		{
+			for(int y=0; y<iRes; y++) { col[2*y] = data[2*(y*iRes+x)]; col[2*y+1] = data[2*(y*iRes+x)+1]; }
+			FFT(&col[0], iRes);
+			for(int y=0; y<iRes; y++) { data[2*(y*iRes+x)] = col[2*y]; data[2*(y*iRes+x)+1] = col[2*y+1]; }
+		}
+
+		for(int y=0; y<iRes; y++)
+			for(int x=0; x<iRes; x++)
+			{
+				const int fx = x<=(iRes/2) ? x : (x-iRes), fy = y<=(iRes/2) ? y : (y-iRes);
+				const double fR = sqrt((double) (fx*fx + fy*fy));
+				const int iBand = fR>=1 ? ((int) floor(log2(fR))) : -1;		// DC is left out
+				if(iBand<0 || iBand>=NOISE_SPECTRUM_BANDS) continue;
+
+				const double fPow = data[2*(y*iRes+x)]*data[2*(y*iRes+x)] + data[2*(y*iRes+x)+1]*data[2*(y*iRes+x)+1];
+				fBand[iBand] += fPow; fTotal += fPow;
+				fFreqSum += fPow*fR;
+			}
+	}
+
+	for(int b=0; b<NOISE_SPECTRUM_BANDS; b++) pDist->fBandPower[b] = fTotal>0 ? ((float) (fBand[b]/fTotal)) : 0.0f;
+	pDist->fMeanFreq = fTotal>0 ? ((float) ((fFreqSum/fTotal) / (iRes/8))) : 0.0f;
+}
+
+bool CompareSimplexToPerlin(SSimplexVsPerlinReport * pReport, const int iNrSamples)
+{
+	memset(pReport, 0, sizeof(SSimplexVsPerlinReport));
+	if(iNrSamples<=0) return false;
+
+	std::vector<int> histoPerlin(64, 0), histoSimplex(64, 0);
+	MeasureNoise(&pReport->perlin, histoPerlin, mydsnoise, iNrSamples);
+	MeasureNoise(&pReport->simplex, histoSimplex, mydssimplex, iNrSamples);
+
+	// 6 hash and 8 corner permutations with 8 gradients against
+	// 3 permutations and a gradient for each of 4 corners
+	pReport->perlin.iNrLookups = 6 + 8 + 8;
+	pReport->simplex.iNrLookups = 4*(3 + 1);
+
+	int iOverlap = 0;
+	for(int b=0; b<64; b++) iOverlap += histoPerlin[b]<histoSimplex[b] ? histoPerlin[b] : histoSimplex[b];
+	pReport->fHistoOverlap = ((float) iOverlap) / iNrSamples;
+
+	const int iNrTurbSamples = iNrSamples<(1<<16) ? iNrSamples : (1<<16);
+	const float fTurbPixSize = 1.0f/256;
+	volatile float fSink = 0;		// keeps the calls
+	for(int m=0; m<2; m++)
+	{
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		for(int i=0; i<iNrTurbSamples; i++)
+		{
+			const float P[] = { 0.37f*i, 0.11f*i, 0.05f*i };
+			if(m==0)
+			{
+				float res[4];
+				dturbulencesimplex(res, P, fTurbPixSize);
+				fSink = fSink + res[1];
+			}
+			else
+			{
+				const float Prgt[] = { P[0]+fTurbPixSize, P[1], P[2] };
+				const float Pup[] = { P[0], P[1]+fTurbPixSize, P[2] };
+				const float Pdpth[] = { P[0], P[1], P[2]+fTurbPixSize };
+				fSink = fSink + turbulence(P, fTurbPixSize) + turbulence(Prgt, fTurbPixSize) + turbulence(Pup, fTurbPixSize) + turbulence(Pdpth, fTurbPixSize);
+			}
+		}
+		const double fSecs = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count();
+		(m==0 ? pReport->fNsDTurbulence : pReport->fNsDTurbulenceFD) = (float) (1e9*fSecs/iNrTurbSamples);
+	}
+	pReport->iNrSamples = iNrSamples;
+
+	return true;
+}
@@ -0,0 +1,117 @@
+#ifndef __NOISECPU_H__
+#define __NOISECPU_H__
+
+#include <stddef.h>
+
+// C++ version of noise.h for baking, procedural placement on the CPU and
+// headless checks. The tables are the ones CreateNoiseData() uploads as
+// g_uPermTable and g_v3GradArray. The scalar functions mirror the HLSL
+// functions of the same name, statement by statement, so the results only
+// differ from the shader by the rounding of the GPU (mad contraction and
+// the like). The batch functions evaluate N points given as SoA arrays with
+// AVX2 when the CPU supports it and otherwise fall back to the scalar path.
+// Both paths produce identical bits. Points are assumed to lie within
+// +/- 2^31 and pixel sizes to be finite.
+
+extern const unsigned char g_uNoisePermTable[256];
+extern const float g_fNoiseGradArray[16][3];
+
+
+// scalar reference. The d* variants return (value, gradient).
+float mysnoise(const float p[]);
+void mydsnoise(float res[], const float p[]);
+float mynoise(const float p[]);
+void mydnoise(float res[], const float p[]);
+
+// simplex noise on the same tables, scaled to the standard deviation and
+// mean frequency of mysnoise()
+float mysimplex(const float p[]);
+void mydssimplex(float res[], const float p[]);
+
+// mydsnoise() repeating every iPeriod lattice cells, 1 to 256. Not part of
+// noise.h, this is what the volumes of cputools/noise_volume.h hold.
+void mydsnoiseperiodic(float res[], const float p[], const int iPeriod);
+
+// with SIMPLEX_DERIVS, on by default as in noise.h, dfractalsum() and dturbulence()
+// sum mydssimplex() octaves so their values differ from fractalsum() and turbulence()
+float fractalsum(const float P[], const float fPixSize=1.0f);
+void dfractalsum(float res[], const float P[], const float fPixSize=1.0f);
+float turbulence(const float P[], const float fPixSize=1.0f);
+void dturbulence(float res[], const float P[], const float fPixSize=1.0f);
+
+// floor(log2(fPixSize)) is taken from the exponent bits. The shader's log2()
+// may land on the other side of a power of two for sizes within an ULP of one.
+float fractalsummax(const float P[], const float fPixSize=1.0f, const int iMaxOctaves=8);
+void dfractalsummax(float res[], const float P[], const float fPixSize=1.0f, const int iMaxOctaves=8);
+float turbulencemax(const float P[], const float fPixSize=1.0f, const int iMaxOctaves=8);
+void dturbulencemax(float res[], const float P[], const float fPixSize=1.0f, const int iMaxOctaves=8);
+
+
+enum eNoiseFunc
+{
+	NOISE_SNOISE=0,				// mysnoise(), mydsnoise()
+	NOISE_FRACTALSUM,			// fractalsum(), dfractalsum()
+	NOISE_TURBULENCE,			// turbulence(), dturbulence()
+	NOISE_FRACTALSUM_MAX,		// fractalsummax(), dfractalsummax()
+	NOISE_TURBULENCE_MAX,		// turbulencemax(), dturbulencemax()
+	NOISE_SIMPLEX,				// mysimplex(), mydssimplex()
+
+	NUM_NOISE_FUNCS
+};
+
+// pfPixSize[] holds a pixel size per point and may be NULL in which case
+// fPixSize is used for all of them. It is ignored by NOISE_SNOISE and
+// NOISE_SIMPLEX. The functions keep no state so callers may split a batch
+// across threads.
+void NoiseBatch(float pfRes[], const eNoiseFunc func, const float pfX[], const float pfY[], const float pfZ[], const int N,
+				const float * pfPixSize=NULL, const float fPixSize=1.0f, const int iMaxOctaves=8);
+
+// pfRes[0][] receives the value and pfRes[1..3][] the gradient
+void DNoiseBatch(float * pfRes[], const eNoiseFunc func, const float pfX[], const float pfY[], const float pfZ[], const int N,
+				 const float * pfPixSize=NULL, const float fPixSize=1.0f, const int iMaxOctaves=8);
+
+bool IsNoiseAVX2Enabled();
+
+
+// Statistics of mydssimplex() against mydsnoise(). The amplitude distribution
+// is taken at iNrSamples random points, the spectrum from 2D slices of
+// NOISE_SPECTRUM_RES^2 samples at 8 per lattice unit with the power summed
+// over octave bands of radial frequency, band b holding frequencies in
+// [2^b, 2^(b+1)) / 32 cycles per lattice unit. The cost is the time per
+// scalar call and the number of table lookups. SIMPLEX_SCALE and
+// SIMPLEX_FREQ in noise.h are set such that the standard deviation and
+// the mean frequency match.
+#define NOISE_SPECTRUM_RES		256
+#define NOISE_SPECTRUM_BANDS	7
+
+struct SNoiseDistribution
+{
+	float fMean, fStdDev, fMin, fMax;
+	float fExcessKurtosis;
+	float fGradRms;							// root mean square of the gradient length
+
+	float fBandPower[NOISE_SPECTRUM_BANDS];	// fraction of the total power
+	float fMeanFreq;						// power weighted, cycles per lattice unit
+
+	float fNsPerCall;
+	int iNrLookups;
+};
+
+struct SSimplexVsPerlinReport
+{
+	int iNrSamples;
+	SNoiseDistribution perlin, simplex;
+
+	// sum over a 64 bin histogram on [-1;1] of the smaller of the two
+	// probabilities, 1 for identical distributions
+	float fHistoOverlap;
+
+	// scalar dturbulence() with SIMPLEX_DERIVS at a pixel size of 1/256, built
+	// either way, against the four turbulence() calls of the finite difference version
+	float fNsDTurbulence, fNsDTurbulenceFD;
+};
+
+bool CompareSimplexToPerlin(SSimplexVsPerlinReport * pReport, const int iNrSamples=1000000);
+
+
+#endif
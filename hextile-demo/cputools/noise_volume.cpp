@@ -0,0 +1,45 @@
+#include "noise_volume.h"
+#include "noise_cpu.h"
+#include "parallel_for.h"
+#include <string.h>
+#include <chrono>
+
+
+bool BakeNoiseVolume(SCpuImage * pVol, const int iRes, const int iPeriod, const int iNrThreads_in, SNoiseVolumeStats * pStats)
+{
+	if(pStats!=NULL) memset(pStats, 0, sizeof(SNoiseVolumeStats));
+	if(iRes<=0 || iPeriod<1 || iPeriod>256) return false;
+	if(!AllocCpuImage(pVol, iRes, iRes, iRes)) return false;
+
+	int iNrThreads = iNrThreads_in<=0 ? GetDefaultNrThreads() : iNrThreads_in;
+	if(iNrThreads>(iRes*iRes)) iNrThreads = iRes*iRes;
+
+	const float fTexelSize = ((float) iPeriod) / iRes;
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+
+	// one row of texels per item
+	ParallelFor(iRes*iRes, iNrThreads, [&](const int item, const int)
+	{
+		const int y = item % iRes, z = item / iRes;
+		for(int x=0; x<iRes; x++)
+		{
+			const float p[] = { (x+0.5f)*fTexelSize, (y+0.5f)*fTexelSize, (z+0.5f)*fTexelSize };
+			mydsnoiseperiodic(GetCpuImagePixel(*pVol, x, y, z), p, iPeriod);
+		}
+	});
+
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	if(pStats!=NULL)
+	{
+		const double fSeconds = std::chrono::duration<double>(t1-t0).count();
+		pStats->iRes = iRes;
+		pStats->iPeriod = iPeriod;
+		pStats->iNrThreads = iNrThreads;
+		pStats->fSeconds = (float) fSeconds;
+		pStats->fMVoxelsPerSec = fSeconds>0.0 ? ((float) ((((double) iRes)*iRes*iRes) / (1e6*fSeconds))) : 0.0f;
+	}
+
+	return true;
+}
@@ -0,0 +1,26 @@
+#ifndef __NOISEVOLUME_H__
+#define __NOISEVOLUME_H__
+
+#include "cpu_image.h"
+#include <stddef.h>
+
+// Bakes mydsnoiseperiodic() of cputools/noise_cpu.h into a tileable volume
+// with (value, gradient) per texel. The volume spans iPeriod lattice cells
+// per side at iRes texels per side and texel (i,j,k) holds the noise at
+// ((i,j,k)+0.5)*iPeriod/iRes, so a trilinear wrap sampler at p/iPeriod
+// reproduces the noise at p. dfractalsumvol() in noise.h samples it for
+// the low octaves, at which a pixel is smaller than a texel.
+
+struct SNoiseVolumeStats
+{
+	int iRes, iPeriod;
+	int iNrThreads;
+	float fSeconds;
+	float fMVoxelsPerSec;
+};
+
+// iPeriod in [1;256]. pStats may be NULL.
+bool BakeNoiseVolume(SCpuImage * pVol, const int iRes, const int iPeriod, const int iNrThreads=0, SNoiseVolumeStats * pStats=NULL);
+
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef __PARALLELFOR_H__
+#define __PARALLELFOR_H__
+
+#include <thread>
+#include <atomic>
+#include <vector>
+
+static inline int GetDefaultNrThreads()
+{
+	const int nrThreads = (int) std::thread::hardware_concurrency();
+	return nrThreads>0 ? nrThreads : 1;
+}
+
+// Calls func(item, threadIdx) for every item in [0; nrItems). Items are
+// handed out from a shared counter so uneven work balances itself.
+// threadIdx is in [0; nrThreads) and can be used to index per thread
+// scratch memory. nrThreads<=0 picks the number of hardware threads.
+template<class F> void ParallelFor(const int nrItems, int nrThreads, F func)
+{
+	if(nrThreads<=0) nrThreads = GetDefaultNrThreads();
+	if(nrThreads>nrItems) nrThreads = nrItems;
+
+	std::atomic<int> nextItem(0);
+	auto worker = [&](const int threadIdx)
+	{
+		int item;
+		while((item = nextItem.fetch_add(1))<nrItems)
+			func(item, threadIdx);
+	};
+
+	std::vector<std::thread> threads;
+	for(int t=1; t<nrThreads; t++)
+		threads.push_back(std::thread(worker, t));
+
+	if(nrThreads>0) worker(0);
+
+	for(size_t t=0; t<threads.size(); t++)
+		threads[t].join();
+}
+
+
+#endif
@@ -0,0 +1,474 @@
+#include "scene_desc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+#ifndef M_PI
+	#define M_PI	3.1415926535897932384626433832795f
+#endif
+
+
+void ClearSceneDesc(SSceneDesc * pDesc)
+{
+	pDesc->textures.clear();
+	pDesc->meshes.clear();
+	pDesc->materials.clear();
+	pDesc->bindings.clear();
+	pDesc->globalBindings.clear();
+	pDesc->instances.clear();
+}
+
+bool IsSceneDescValid(const SSceneDesc &desc)
+{
+	const int iNrTextures = (int) desc.textures.size();
+	const int iNrBindings = (int) desc.bindings.size();
+
+	bool res = true;
+	for(int t=0; t<iNrTextures && res; t++)
+		res = desc.textures[t].iKind>=0 && desc.textures[t].iKind<NUM_SCENE_TEXTURE_KINDS;
+
+	for(int b=0; b<iNrBindings && res; b++)
+		res = desc.bindings[b].iTexture>=0 && desc.bindings[b].iTexture<iNrTextures;
+	for(int b=0; b<(int) desc.globalBindings.size() && res; b++)
+		res = desc.globalBindings[b].iTexture>=0 && desc.globalBindings[b].iTexture<iNrTextures;
+
+	for(int m=0; m<(int) desc.materials.size() && res; m++)
+	{
+		const SSceneMaterial &mat = desc.materials[m];
+		res = mat.iFirstBinding>=0 && mat.iNrBindings>=0 && mat.iFirstBinding<=(iNrBindings-mat.iNrBindings);
+	}
+
+	int iNrGround = 0;
+	for(int i=0; i<(int) desc.instances.size() && res; i++)
+	{
+		const SSceneInstance &inst = desc.instances[i];
+		res = inst.iMesh>=0 && inst.iMesh<(int) desc.meshes.size() && inst.iMaterial>=0 && inst.iMaterial<(int) desc.materials.size();
+		res = res && inst.iParent>=-1 && inst.iParent<i;
+		if((inst.uFlags&SCENE_INSTANCE_GROUND)!=0) ++iNrGround;
+	}
+
+	return res && iNrGround<=1;
+}
+
+void GetSceneInstanceLocToWorld(Mat44 * pmMat, const SSceneInstance &inst)
+{
+	const float deg2rad = M_PI/180.0f;
+	LoadRotation(pmMat, inst.fRotDeg[0]*deg2rad, inst.fRotDeg[1]*deg2rad, inst.fRotDeg[2]*deg2rad);
+	for(int c=0; c<3; c++) SetColumn(pmMat, c, inst.fScale*GetColumn(*pmMat, c));
+	SetColumn(pmMat, 3, Vec4(inst.fPos[0], inst.fPos[1], inst.fPos[2], 1.0f));
+}
+
+
+/*********************************************************************************************
+********************************************* Text *******************************************
+*********************************************************************************************/
+
+static const char * g_pcTextureKinds[] = { "plain", "detail_color", "detail_normal" };
+
+// splits the line in place at white space, returns the number of tokens
+static int Tokenize(char * ppcTokens[], const int iMaxTokens, char * pcLine)
+{
+	int iNrTokens = 0;
+	char * pc = pcLine;
+	while(*pc!='\0')
+	{
+		while(*pc==' ' || *pc=='\t' || *pc=='\r') ++pc;
+		if(*pc=='\0' || *pc=='#') break;
+
+		if(iNrTokens==iMaxTokens) return iMaxTokens+1;		// too many
+		ppcTokens[iNrTokens++] = pc;
+		while(*pc!='\0' && *pc!=' ' && *pc!='\t' && *pc!='\r' && *pc!='#') ++pc;
+		if(*pc=='#') { *pc='\0'; break; }
+		if(*pc!='\0') *pc++ = '\0';
+	}
+	return iNrTokens;
+}
+
+static bool CopyName(char pcDst[], const int iMaxLen, const char pcSrc[])
+{
+	const bool res = strlen(pcSrc)<(size_t) iMaxLen;
+	if(res) strcpy(pcDst, pcSrc);
+	return res;
+}
+
+static bool ParseFloat(float * pfVal, const char pcToken[])
+{
+	char * pcEnd = NULL;
+	*pfVal = strtof(pcToken, &pcEnd);
+	return pcEnd!=pcToken && *pcEnd=='\0';
+}
+
+static int FindName(const std::map<std::string, int> &names, const char pcName[])
+{
+	std::map<std::string, int>::const_iterator it = names.find(pcName);
+	return it!=names.end() ? it->second : -1;
+}
+
+static bool ParseLine(SSceneDesc * pDesc, char * ppcTok[], const int iNrTok, std::map<std::string, int> nameMaps[3])
+{
+	std::map<std::string, int> &texNames = nameMaps[0], &meshNames = nameMaps[1], &matNames = nameMaps[2];
+	const char * pcKey = ppcTok[0];
+
+	bool res = false;
+	if(strcmp(pcKey, "texture")==0 && iNrTok==6)
+	{
+		SSceneTexture tex;
+		memset(&tex, 0, sizeof(tex));
+		tex.iKind = -1;
+		for(int k=0; k<NUM_SCENE_TEXTURE_KINDS; k++)
+			if(strcmp(ppcTok[2], g_pcTextureKinds[k])==0) tex.iKind = k;
+		tex.bSRGB = strcmp(ppcTok[3], "srgb")==0 ? 1 : 0;
+
+		res = tex.iKind>=0 && (tex.bSRGB!=0 || strcmp(ppcTok[3], "linear")==0);
+		res = res && CopyName(tex.cName, SCENE_DESC_NAME_LEN, ppcTok[1]) && CopyName(tex.cDir, SCENE_DESC_PATH_LEN, ppcTok[4]) &&
+			  CopyName(tex.cFile, SCENE_DESC_PATH_LEN, ppcTok[5]);
+		res = res && FindName(texNames, tex.cName)<0;
+		if(res)
+		{
+			texNames[tex.cName] = (int) pDesc->textures.size();
+			pDesc->textures.push_back(tex);
+		}
+	}
+	else if(strcmp(pcKey, "mesh")==0 && iNrTok>=4 && iNrTok<=6)
+	{
+		SSceneMesh mesh;
+		memset(&mesh, 0, sizeof(mesh));
+		res = CopyName(mesh.cName, SCENE_DESC_NAME_LEN, ppcTok[1]) && CopyName(mesh.cFile, SCENE_DESC_PATH_LEN, ppcTok[2]) &&
+			  ParseFloat(&mesh.fScale, ppcTok[3]);
+		for(int t=4; t<iNrTok && res; t++)
+		{
+			if(strcmp(ppcTok[t], "center")==0) mesh.bCenter = 1;
+			else if(strcmp(ppcTok[t], "zup")==0) mesh.bZtoYup = 1;
+			else res = false;
+		}
+		res = res && FindName(meshNames, mesh.cName)<0;
+		if(res)
+		{
+			meshNames[mesh.cName] = (int) pDesc->meshes.size();
+			pDesc->meshes.push_back(mesh);
+		}
+	}
+	else if(strcmp(pcKey, "material")==0 && iNrTok==7)
+	{
+		SSceneMaterial mat;
+		memset(&mat, 0, sizeof(mat));
+		res = CopyName(mat.cName, SCENE_DESC_NAME_LEN, ppcTok[1]) && CopyName(mat.cPixelShader, SCENE_DESC_NAME_LEN, ppcTok[2]) &&
+			  CopyName(mat.cDefine, SCENE_DESC_NAME_LEN, ppcTok[3]) && CopyName(mat.cParamsCB, SCENE_DESC_NAME_LEN, ppcTok[4]) &&
+			  ParseFloat(&mat.fTileRate, ppcTok[5]) && ParseFloat(&mat.fBumpIntensity, ppcTok[6]);
+		mat.iFirstBinding = (int) pDesc->bindings.size();
+		res = res && FindName(matNames, mat.cName)<0;
+		if(res)
+		{
+			matNames[mat.cName] = (int) pDesc->materials.size();
+			pDesc->materials.push_back(mat);
+		}
+	}
+	else if((strcmp(pcKey, "bind")==0 || strcmp(pcKey, "global")==0) && iNrTok==3)
+	{
+		const bool bGlobal = pcKey[0]=='g';
+		SSceneTexBinding binding;
+		memset(&binding, 0, sizeof(binding));
+		binding.iTexture = FindName(texNames, ppcTok[2]);
+		res = binding.iTexture>=0 && CopyName(binding.cVariable, SCENE_DESC_NAME_LEN, ppcTok[1]);
+		res = res && (bGlobal || pDesc->materials.size()>0);
+		if(res && bGlobal) pDesc->globalBindings.push_back(binding);
+		else if(res)
+		{
+			// the bindings of a material are contiguous
+			SSceneMaterial &mat = pDesc->materials.back();
+			res = (mat.iFirstBinding+mat.iNrBindings)==(int) pDesc->bindings.size();
+			if(res) { pDesc->bindings.push_back(binding); ++mat.iNrBindings; }
+		}
+	}
+	else if(strcmp(pcKey, "instance")==0 && iNrTok>=10 && iNrTok<=14)
+	{
+		SSceneInstance inst;
+		memset(&inst, 0, sizeof(inst));
+		inst.iParent = -1;
+		inst.iMesh = FindName(meshNames, ppcTok[1]);
+		inst.iMaterial = FindName(matNames, ppcTok[2]);
+		res = inst.iMesh>=0 && inst.iMaterial>=0;
+		for(int k=0; k<3 && res; k++) res = ParseFloat(&inst.fPos[k], ppcTok[3+k]);
+		for(int k=0; k<3 && res; k++) res = ParseFloat(&inst.fRotDeg[k], ppcTok[6+k]);
+		res = res && ParseFloat(&inst.fScale, ppcTok[9]);
+		for(int t=10; t<iNrTok && res; t++)
+		{
+			if(strcmp(ppcTok[t], "ground")==0) inst.uFlags |= (SCENE_INSTANCE_GROUND|SCENE_INSTANCE_NO_SHADOW);
+			else if(strcmp(ppcTok[t], "noshadow")==0) inst.uFlags |= SCENE_INSTANCE_NO_SHADOW;
+			else if(strcmp(ppcTok[t], "parent")==0 && (t+1)<iNrTok)
+			{
+				char * pcEnd = NULL;
+				inst.iParent = (int) strtol(ppcTok[++t], &pcEnd, 10);
+				res = *pcEnd=='\0' && inst.iParent>=0 && inst.iParent<(int) pDesc->instances.size();
+			}
+			else res = false;
+		}
+		if(res) pDesc->instances.push_back(inst);
+	}
+
+	return res;
+}
+
+bool ParseSceneDescText(SSceneDesc * pDesc, const char pcText[], int * piErrorLine)
+{
+	ClearSceneDesc(pDesc);
+	std::map<std::string, int> nameMaps[3];
+
+	#define MAX_TOKENS		16
+	std::vector<char> line;
+	int iLine = 0;
+	bool res = true;
+	const char * pc = pcText;
+	while(*pc!='\0' && res)
+	{
+		const char * pcEnd = pc;
+		while(*pcEnd!='\0' && *pcEnd!='\n') ++pcEnd;
+		line.assign(pc, pcEnd); line.push_back('\0');
+		pc = *pcEnd=='\n' ? (pcEnd+1) : pcEnd;
+		++iLine;
+
+		char * ppcTok[MAX_TOKENS];
+		const int iNrTok = Tokenize(ppcTok, MAX_TOKENS, &line[0]);
+		if(iNrTok>0) res = iNrTok<=MAX_TOKENS && ParseLine(pDesc, ppcTok, iNrTok, nameMaps);
+	}
+	#undef MAX_TOKENS
+
+	if(!res && piErrorLine!=NULL) *piErrorLine = iLine;
+	if(res)
+	{
+		res = IsSceneDescValid(*pDesc);
+		if(!res && piErrorLine!=NULL) *piErrorLine = 0;
+	}
+	if(!res) ClearSceneDesc(pDesc);
+
+	return res;
+}
+
+static bool ReadFile(std::vector<unsigned char> &data, const char filename[])
+{
+	FILE * fptr = fopen(filename, "rb");
+	if(fptr==NULL) return false;
+
+	fseek(fptr, 0, SEEK_END);
+	const long iSize = ftell(fptr);
+	fseek(fptr, 0, SEEK_SET);
+
+	bool res = iSize>=0;
+	if(res)
+	{
+		data.resize(iSize+1);
+		res = fread(&data[0], 1, iSize, fptr)==(size_t) iSize;
+		data[iSize] = 0;		// terminated for the text form
+		data.resize(iSize+1);
+	}
+	fclose(fptr);
+
+	return res;
+}
+
+bool ReadSceneDescText(SSceneDesc * pDesc, const char filename[], int * piErrorLine)
+{
+	std::vector<unsigned char> data;
+	if(piErrorLine!=NULL) *piErrorLine = 0;
+	return ReadFile(data, filename) && ParseSceneDescText(pDesc, (const char *) &data[0], piErrorLine);
+}
+
+// %.9g gives the floats back exactly
+void SceneDescToText(std::string &text, const SSceneDesc &desc)
+{
+	text.clear();
+	char buf[1024];
+
+	for(int t=0; t<(int) desc.textures.size(); t++)
+	{
+		const SSceneTexture &tex = desc.textures[t];
+		sprintf(buf, "texture %s %s %s %s %s\n", tex.cName, g_pcTextureKinds[tex.iKind], tex.bSRGB!=0 ? "srgb" : "linear", tex.cDir, tex.cFile);
+		text += buf;
+	}
+	text += "\n";
+
+	for(int m=0; m<(int) desc.meshes.size(); m++)
+	{
+		const SSceneMesh &mesh = desc.meshes[m];
+		sprintf(buf, "mesh %s %s %.9g%s%s\n", mesh.cName, mesh.cFile, mesh.fScale, mesh.bCenter!=0 ? " center" : "", mesh.bZtoYup!=0 ? " zup" : "");
+		text += buf;
+	}
+	text += "\n";
+
+	for(int b=0; b<(int) desc.globalBindings.size(); b++)
+	{
+		sprintf(buf, "global %s %s\n", desc.globalBindings[b].cVariable, desc.textures[desc.globalBindings[b].iTexture].cName);
+		text += buf;
+	}
+	text += "\n";
+
+	for(int m=0; m<(int) desc.materials.size(); m++)
+	{
+		const SSceneMaterial &mat = desc.materials[m];
+		sprintf(buf, "material %s %s %s %s %.9g %.9g\n", mat.cName, mat.cPixelShader, mat.cDefine, mat.cParamsCB, mat.fTileRate, mat.fBumpIntensity);
+		text += buf;
+		for(int b=mat.iFirstBinding; b<(mat.iFirstBinding+mat.iNrBindings); b++)
+		{
+			sprintf(buf, "bind %s %s\n", desc.bindings[b].cVariable, desc.textures[desc.bindings[b].iTexture].cName);
+			text += buf;
+		}
+	}
+	text += "\n";
+
+	for(int i=0; i<(int) desc.instances.size(); i++)
+	{
+		const SSceneInstance &inst = desc.instances[i];
+		const bool bGround = (inst.uFlags&SCENE_INSTANCE_GROUND)!=0;
+		const bool bNoShadow = !bGround && (inst.uFlags&SCENE_INSTANCE_NO_SHADOW)!=0;
+		sprintf(buf, "instance %s %s %.9g %.9g %.9g %.9g %.9g %.9g %.9g%s%s", desc.meshes[inst.iMesh].cName, desc.materials[inst.iMaterial].cName,
+				inst.fPos[0], inst.fPos[1], inst.fPos[2], inst.fRotDeg[0], inst.fRotDeg[1], inst.fRotDeg[2], inst.fScale,
+				bGround ? " ground" : "", bNoShadow ? " noshadow" : "");
+		text += buf;
+		if(inst.iParent>=0)
+		{
+			sprintf(buf, " parent %d", inst.iParent);
+			text += buf;
+		}
+		text += "\n";
+	}
+}
+
+bool WriteSceneDescText(const char filename[], const SSceneDesc &desc)
+{
+	std::string text;
+	SceneDescToText(text, desc);
+
+	FILE * fptr = fopen(filename, "wb");
+	if(fptr==NULL) return false;
+	const bool res = fwrite(text.c_str(), 1, text.size(), fptr)==text.size();
+	fclose(fptr);
+
+	return res;
+}
+
+
+/*********************************************************************************************
+******************************************** Binary ******************************************
+*********************************************************************************************/
+
+#define SCENE_DESC_BINARY_VERSION		2
+
+struct SSceneDescBinaryHeader
+{
+	char cMagic[4];
+	int iVersion;
+	int iNrTextures, iNrMeshes, iNrMaterials, iNrBindings, iNrGlobalBindings, iNrInstances;
+};
+
+template<class T> static void AppendArray(std::vector<unsigned char> &data, const std::vector<T> &arr)
+{
+	if(arr.size()>0)
+	{
+		const unsigned char * pBytes = (const unsigned char *) &arr[0];
+		data.insert(data.end(), pBytes, pBytes + arr.size()*sizeof(T));
+	}
+}
+
+template<class T> static bool ExtractArray(std::vector<T> &arr, const int iCount, const unsigned char pData[], const size_t uSize, size_t * puOffs)
+{
+	const bool res = iCount>=0 && (uSize-*puOffs)/sizeof(T)>=(size_t) iCount;
+	if(res)
+	{
+		arr.resize(iCount);
+		if(iCount>0) memcpy(&arr[0], pData+*puOffs, iCount*sizeof(T));
+		*puOffs += iCount*sizeof(T);
+	}
+	return res;
+}
+
+void SceneDescToBinary(std::vector<unsigned char> &data, const SSceneDesc &desc)
+{
+	SSceneDescBinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.cMagic, "HXSC", 4);
+	header.iVersion = SCENE_DESC_BINARY_VERSION;
+	header.iNrTextures = (int) desc.textures.size();
+	header.iNrMeshes = (int) desc.meshes.size();
+	header.iNrMaterials = (int) desc.materials.size();
+	header.iNrBindings = (int) desc.bindings.size();
+	header.iNrGlobalBindings = (int) desc.globalBindings.size();
+	header.iNrInstances = (int) desc.instances.size();
+
+	data.clear();
+	data.reserve(sizeof(header) + header.iNrTextures*sizeof(SSceneTexture) + header.iNrMeshes*sizeof(SSceneMesh) +
+				 header.iNrMaterials*sizeof(SSceneMaterial) + (header.iNrBindings+header.iNrGlobalBindings)*sizeof(SSceneTexBinding) +
+				 header.iNrInstances*sizeof(SSceneInstance));
+
+	const unsigned char * pHeader = (const unsigned char *) &header;
+	data.insert(data.end(), pHeader, pHeader+sizeof(header));
+	AppendArray(data, desc.textures);
+	AppendArray(data, desc.meshes);
+	AppendArray(data, desc.materials);
+	AppendArray(data, desc.bindings);
+	AppendArray(data, desc.globalBindings);
+	AppendArray(data, desc.instances);
+}
+
+bool ParseSceneDescBinary(SSceneDesc * pDesc, const unsigned char pData[], const size_t uSize)
+{
+	ClearSceneDesc(pDesc);
+
+	SSceneDescBinaryHeader header;
+	bool res = uSize>=sizeof(header);
+	if(res)
+	{
+		memcpy(&header, pData, sizeof(header));
+		res = memcmp(header.cMagic, "HXSC", 4)==0 && header.iVersion==SCENE_DESC_BINARY_VERSION;
+	}
+
+	size_t uOffs = sizeof(header);
+	res = res && ExtractArray(pDesc->textures, header.iNrTextures, pData, uSize, &uOffs);
+	res = res && ExtractArray(pDesc->meshes, header.iNrMeshes, pData, uSize, &uOffs);
+	res = res && ExtractArray(pDesc->materials, header.iNrMaterials, pData, uSize, &uOffs);
+	res = res && ExtractArray(pDesc->bindings, header.iNrBindings, pData, uSize, &uOffs);
+	res = res && ExtractArray(pDesc->globalBindings, header.iNrGlobalBindings, pData, uSize, &uOffs);
+	res = res && ExtractArray(pDesc->instances, header.iNrInstances, pData, uSize, &uOffs);
+	res = res && uOffs==uSize && IsSceneDescValid(*pDesc);
+
+	// names are used as strings later
+	for(int t=0; t<(int) pDesc->textures.size() && res; t++)
+	{
+		const SSceneTexture &tex = pDesc->textures[t];
+		res = memchr(tex.cName, 0, SCENE_DESC_NAME_LEN)!=NULL && memchr(tex.cDir, 0, SCENE_DESC_PATH_LEN)!=NULL && memchr(tex.cFile, 0, SCENE_DESC_PATH_LEN)!=NULL;
+	}
+	for(int m=0; m<(int) pDesc->meshes.size() && res; m++)
+		res = memchr(pDesc->meshes[m].cName, 0, SCENE_DESC_NAME_LEN)!=NULL && memchr(pDesc->meshes[m].cFile, 0, SCENE_DESC_PATH_LEN)!=NULL;
+	for(int m=0; m<(int) pDesc->materials.size() && res; m++)
+	{
+		const SSceneMaterial &mat = pDesc->materials[m];
+		res = memchr(mat.cName, 0, SCENE_DESC_NAME_LEN)!=NULL && memchr(mat.cPixelShader, 0, SCENE_DESC_NAME_LEN)!=NULL &&
+			  memchr(mat.cDefine, 0, SCENE_DESC_NAME_LEN)!=NULL && memchr(mat.cParamsCB, 0, SCENE_DESC_NAME_LEN)!=NULL;
+	}
+	for(int b=0; b<(int) pDesc->bindings.size() && res; b++) res = memchr(pDesc->bindings[b].cVariable, 0, SCENE_DESC_NAME_LEN)!=NULL;
+	for(int b=0; b<(int) pDesc->globalBindings.size() && res; b++) res = memchr(pDesc->globalBindings[b].cVariable, 0, SCENE_DESC_NAME_LEN)!=NULL;
+
+	if(!res) ClearSceneDesc(pDesc);
+
+	return res;
+}
+
+bool ReadSceneDescBinary(SSceneDesc * pDesc, const char filename[])
+{
+	std::vector<unsigned char> data;
+	bool res = ReadFile(data, filename);
+	return res && ParseSceneDescBinary(pDesc, &data[0], data.size()-1);		// minus the terminator
+}
+
+bool WriteSceneDescBinary(const char filename[], const SSceneDesc &desc)
+{
+	std::vector<unsigned char> data;
+	SceneDescToBinary(data, desc);
+
+	FILE * fptr = fopen(filename, "wb");
+	if(fptr==NULL) return false;
+	const bool res = fwrite(&data[0], 1, data.size(), fptr)==data.size();
+	fclose(fptr);
+
+	return res;
+}
@@ -0,0 +1,127 @@
+#ifndef __SCENEDESC_H__
+#define __SCENEDESC_H__
+
+#include <geommath/geommath.h>
+#include <vector>
+#include <string>
+#include <stddef.h>
+
+// Description of a scene, the textures, meshes and materials it loads once
+// and the instances that share them. Everything is held in flat arrays of
+// plain records which reference each other by index, such that the binary
+// form is the arrays themselves and loads with a few copies. Nothing here
+// touches the device, see scenegraph.cpp for that.
+//
+// The text form is line based, # starts a comment and names and paths
+// can't hold white space. Names must be defined before they are referenced.
+//
+//   texture  <name> <plain|detail_color|detail_normal> <srgb|linear> <dir> <file>
+//   mesh     <name> <file> <scale> [center] [zup]
+//   material <name> <pixel shader> <define> <params cbuffer> <tile rate> <bump intensity>
+//   bind     <shader variable> <texture>            texture of the last material
+//   global   <shader variable> <texture>            texture of every material
+//   instance <mesh> <material> <x y z> <rx ry rz> <scale> [ground] [noshadow] [parent <instance>]
+//
+// The rotation of an instance is in degrees, see LoadRotation(). The parent
+// is the 0 based index of an earlier instance and the transform of the
+// instance is then relative to it, see transform_hierarchy.h. Detail
+// textures get the histogram-preserving attachments of hex2colTex_histo()
+// and detail normals a derivative map as well, the ground and the other
+// materials cycle through them. The define names the material's branch in
+// shader_lighting.hlsl and custom_cbuffers.h.
+
+#define SCENE_DESC_NAME_LEN		64
+#define SCENE_DESC_PATH_LEN		128
+
+enum SCENE_TEXTURE_KIND
+{
+	SCENE_TEXTURE_PLAIN=0,
+	SCENE_TEXTURE_DETAIL_COLOR,
+	SCENE_TEXTURE_DETAIL_NORMAL,
+
+	NUM_SCENE_TEXTURE_KINDS
+};
+
+#define SCENE_INSTANCE_GROUND		0x1		// the ground plane, at most one
+#define SCENE_INSTANCE_NO_SHADOW	0x2		// not a shadow caster, implied by ground
+
+struct SSceneTexture
+{
+	char cName[SCENE_DESC_NAME_LEN];
+	char cDir[SCENE_DESC_PATH_LEN];
+	char cFile[SCENE_DESC_PATH_LEN];
+	int iKind;
+	int bSRGB;
+};
+
+struct SSceneMesh
+{
+	char cName[SCENE_DESC_NAME_LEN];
+	char cFile[SCENE_DESC_PATH_LEN];
+	float fScale;
+	int bCenter;
+	int bZtoYup;
+};
+
+struct SSceneTexBinding
+{
+	char cVariable[SCENE_DESC_NAME_LEN];
+	int iTexture;
+};
+
+struct SSceneMaterial
+{
+	char cName[SCENE_DESC_NAME_LEN];
+	char cPixelShader[SCENE_DESC_NAME_LEN];
+	char cDefine[SCENE_DESC_NAME_LEN];
+	char cParamsCB[SCENE_DESC_NAME_LEN];
+	float fTileRate, fBumpIntensity;
+	int iFirstBinding, iNrBindings;			// into SSceneDesc::bindings
+};
+
+struct SSceneInstance
+{
+	float fPos[3];
+	float fRotDeg[3];
+	float fScale;
+	int iMesh, iMaterial;
+	unsigned int uFlags;
+	int iParent;							// an earlier instance or -1
+};
+
+struct SSceneDesc
+{
+	std::vector<SSceneTexture> textures;
+	std::vector<SSceneMesh> meshes;
+	std::vector<SSceneMaterial> materials;
+	std::vector<SSceneTexBinding> bindings;
+	std::vector<SSceneTexBinding> globalBindings;
+	std::vector<SSceneInstance> instances;
+};
+
+void ClearSceneDesc(SSceneDesc * pDesc);
+
+// indices in range, the bindings of the materials inside the array and at
+// most one ground instance
+bool IsSceneDescValid(const SSceneDesc &desc);
+
+// location to parent of the instance, scale then rotation then translation.
+// This is location to world for an instance without a parent.
+void GetSceneInstanceLocToWorld(Mat44 * pmMat, const SSceneInstance &inst);
+
+// text form. On failure *piErrorLine, when not NULL, is the 1 based line at
+// fault or 0 when the scene as a whole is invalid.
+bool ParseSceneDescText(SSceneDesc * pDesc, const char pcText[], int * piErrorLine=NULL);
+bool ReadSceneDescText(SSceneDesc * pDesc, const char filename[], int * piErrorLine=NULL);
+void SceneDescToText(std::string &text, const SSceneDesc &desc);
+bool WriteSceneDescText(const char filename[], const SSceneDesc &desc);
+
+// binary form, a header with the counts followed by the arrays in the order
+// of SSceneDesc and in the byte order of the machine
+bool ParseSceneDescBinary(SSceneDesc * pDesc, const unsigned char pData[], const size_t uSize);
+bool ReadSceneDescBinary(SSceneDesc * pDesc, const char filename[]);
+void SceneDescToBinary(std::vector<unsigned char> &data, const SSceneDesc &desc);
+bool WriteSceneDescBinary(const char filename[], const SSceneDesc &desc);
+
+
+#endif
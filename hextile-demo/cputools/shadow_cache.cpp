@@ -0,0 +1,211 @@
+#include "shadow_cache.h"
+#include "shadow_hull.h"
+#include <math.h>
+#include <string.h>
+
+
+void ResetShadowCache(SShadowCache * pCache)
+{
+	for(int c=0; c<MAX_SHADOW_CASCADES; c++) pCache->bValid[c] = false;
+	memset(pCache->cascades, 0, sizeof(pCache->cascades));
+	pCache->vSunDir = Vec3(0,0,0);
+	pCache->casterHash.clear();
+	pCache->casterFootprint.clear();
+	memset(&pCache->stats, 0, sizeof(SShadowCacheStats));
+}
+
+// FNV-1a over the bounds, the transform and the hull, field by field to skip padding
+static void HashBytes(unsigned long long * puHash, const void * pData, const int iSize)
+{
+	const unsigned char * pBytes = (const unsigned char *) pData;
+	for(int i=0; i<iSize; i++)
+	{
+		*puHash ^= pBytes[i];
+		*puHash *= 1099511628211ull;
+	}
+}
+
+static unsigned long long HashCaster(const SShadowCaster &caster)
+{
+	unsigned long long uHash = 14695981039346656037ull;
+	HashBytes(&uHash, &caster.vMin, sizeof(caster.vMin));
+	HashBytes(&uHash, &caster.vMax, sizeof(caster.vMax));
+	HashBytes(&uHash, &caster.mLocToWorld, sizeof(caster.mLocToWorld));
+	HashBytes(&uHash, &caster.pfHull, sizeof(caster.pfHull));
+	HashBytes(&uHash, &caster.iNrHullVerts, sizeof(caster.iNrHullVerts));
+	return uHash;
+}
+
+// light space x, y bound of the caster
+static void GetCasterFootprint(float pfFootprint[4], const Mat33 &rotToLgt, const SShadowCaster &caster)
+{
+	Vec3 vMin, vMax;
+	GetShadowCasterLightBounds(&vMin, &vMax, rotToLgt, caster);
+	pfFootprint[0] = vMin.x; pfFootprint[1] = vMin.y;
+	pfFootprint[2] = vMax.x; pfFootprint[3] = vMax.y;
+}
+
+static bool SameWindow(const SShadowCascade &cascade0, const SShadowCascade &cascade1)
+{
+	return memcmp(&cascade0.mWorldToLight, &cascade1.mWorldToLight, sizeof(Mat44))==0 && memcmp(&cascade0.mProj, &cascade1.mProj, sizeof(Mat44))==0 &&
+		   memcmp(cascade0.iViewport, cascade1.iViewport, sizeof(cascade0.iViewport))==0;
+}
+
+static inline int GetNrTiles(const int iNrTexels)
+{
+	return (iNrTexels+SHADOW_CACHE_TILE_SIZE-1) / SHADOW_CACHE_TILE_SIZE;
+}
+
+// a texel of margin on every side for the rasterization rules
+static void MarkFootprint(std::vector<unsigned char> &tiles, const SShadowCascade &cascade, const float pfFootprint[4])
+{
+	const int iW = cascade.iViewport[2], iH = cascade.iViewport[3];
+	const float fRecTexel = 1.0f / cascade.fTexelSize;
+
+	int iX0 = ((int) floorf((pfFootprint[0]-cascade.vLightMin.x)*fRecTexel)) - 1;
+	int iX1 = ((int) ceilf((pfFootprint[2]-cascade.vLightMin.x)*fRecTexel)) + 1;
+	int iY0 = ((int) floorf((cascade.vLightMax.y-pfFootprint[3])*fRecTexel)) - 1;
+	int iY1 = ((int) ceilf((cascade.vLightMax.y-pfFootprint[1])*fRecTexel)) + 1;
+	if(iX0<0) iX0=0;
+	if(iX1>iW) iX1=iW;
+	if(iY0<0) iY0=0;
+	if(iY1>iH) iY1=iH;
+	if(iX0>=iX1 || iY0>=iY1) return;
+
+	const int iNrTilesX = GetNrTiles(iW);
+	for(int ty=iY0/SHADOW_CACHE_TILE_SIZE; ty<=(iY1-1)/SHADOW_CACHE_TILE_SIZE; ty++)
+		for(int tx=iX0/SHADOW_CACHE_TILE_SIZE; tx<=(iX1-1)/SHADOW_CACHE_TILE_SIZE; tx++)
+			tiles[ty*iNrTilesX+tx] = 1;
+}
+
+// runs of dirty tiles per row, merged with the rect above when the run is the same
+static void TilesToRects(std::vector<SShadowCacheRect> &rects, const std::vector<unsigned char> &tiles, const int iW, const int iH)
+{
+	const int iNrTilesX = GetNrTiles(iW), iNrTilesY = GetNrTiles(iH);
+	rects.resize(0);
+
+	for(int ty=0; ty<iNrTilesY; ty++)
+	{
+		const int iY = ty*SHADOW_CACHE_TILE_SIZE;
+		const int iY1 = (iY+SHADOW_CACHE_TILE_SIZE)<iH ? (iY+SHADOW_CACHE_TILE_SIZE) : iH;
+
+		int tx=0;
+		while(tx<iNrTilesX)
+		{
+			if(tiles[ty*iNrTilesX+tx]==0) { ++tx; continue; }
+			const int iStart = tx;
+			while(tx<iNrTilesX && tiles[ty*iNrTilesX+tx]!=0) ++tx;
+
+			SShadowCacheRect rect;
+			rect.iX = iStart*SHADOW_CACHE_TILE_SIZE; rect.iY = iY;
+			rect.iWidth = ((tx*SHADOW_CACHE_TILE_SIZE)<iW ? (tx*SHADOW_CACHE_TILE_SIZE) : iW) - rect.iX;
+			rect.iHeight = iY1 - iY;
+
+			bool bMerged = false;
+			for(int r=0; r<(int) rects.size() && !bMerged; r++)
+			{
+				SShadowCacheRect &above = rects[r];
+				if(above.iX==rect.iX && above.iWidth==rect.iWidth && (above.iY+above.iHeight)==rect.iY)
+				{
+					above.iHeight += rect.iHeight;
+					bMerged = true;
+				}
+			}
+			if(!bMerged) rects.push_back(rect);
+		}
+	}
+}
+
+void UpdateShadowCache(SShadowCache * pCache, SShadowCascadeUpdate pUpdates[], const SShadowCascade pCascades[], const int iNrCascades,
+					   const Vec3 &vSunDir, const SShadowCaster pCasters[], const int iNrCasters)
+{
+	Vec3 vX, vY, vZ;
+	BuildShadowBasis(&vX, &vY, &vZ, vSunDir);
+	Mat33 rotToLgt;
+	SetRow(&rotToLgt, 0, vX); SetRow(&rotToLgt, 1, vY); SetRow(&rotToLgt, 2, vZ);
+
+	// footprints are only comparable under the same light and for the same casters
+	const bool bSameCasters = ((int) pCache->casterHash.size())==iNrCasters && pCache->vSunDir==vSunDir;
+
+	bool bKeep[MAX_SHADOW_CASCADES];
+	std::vector<unsigned char> tiles[MAX_SHADOW_CASCADES];
+	for(int c=0; c<iNrCascades; c++)
+	{
+		const SShadowCascade &cascade = pCascades[c];
+		bKeep[c] = bSameCasters && pCache->bValid[c] && !cascade.bEmpty && SameWindow(pCache->cascades[c], cascade);
+		if(bKeep[c]) tiles[c].assign(GetNrTiles(cascade.iViewport[2])*GetNrTiles(cascade.iViewport[3]), 0);
+	}
+
+	pCache->casterHash.resize(iNrCasters);
+	pCache->casterFootprint.resize(4*iNrCasters);
+	for(int i=0; i<iNrCasters; i++)
+	{
+		const unsigned long long uHash = HashCaster(pCasters[i]);
+		if(bSameCasters && uHash==pCache->casterHash[i]) continue;
+
+		float fFootprint[4];
+		GetCasterFootprint(fFootprint, rotToLgt, pCasters[i]);
+		float * pfOld = &pCache->casterFootprint[4*i];
+
+		if(bSameCasters)
+			for(int c=0; c<iNrCascades; c++)
+				if(bKeep[c]) { MarkFootprint(tiles[c], pCascades[c], pfOld); MarkFootprint(tiles[c], pCascades[c], fFootprint); }
+
+		pCache->casterHash[i] = uHash;
+		for(int k=0; k<4; k++) pfOld[k] = fFootprint[k];
+	}
+	pCache->vSunDir = vSunDir;
+
+	// what to render
+	double dNrTexels = 0.0, dNrRendered = 0.0;
+	for(int c=0; c<iNrCascades; c++)
+	{
+		const SShadowCascade &cascade = pCascades[c];
+		SShadowCascadeUpdate &update = pUpdates[c];
+		update.bFull = false;
+		update.rects.resize(0);
+
+		pCache->cascades[c] = cascade;
+		pCache->bValid[c] = !cascade.bEmpty;
+		if(cascade.bEmpty) continue;
+
+		const int iW = cascade.iViewport[2], iH = cascade.iViewport[3];
+		dNrTexels += ((double) iW)*iH;
+
+		if(bKeep[c])
+		{
+			int iNrDirty = 0;
+			for(int t=0; t<(int) tiles[c].size(); t++) iNrDirty += tiles[c][t];
+
+			// when most tiles are dirty one pass is cheaper
+			if((4*iNrDirty)<(3*(int) tiles[c].size()))
+			{
+				TilesToRects(update.rects, tiles[c], iW, iH);
+				for(int r=0; r<(int) update.rects.size(); r++) dNrRendered += ((double) update.rects[r].iWidth)*update.rects[r].iHeight;
+				if(update.rects.size()>0) ++pCache->stats.iNrPartialUpdates;
+				continue;
+			}
+		}
+
+		update.bFull = true;
+		dNrRendered += ((double) iW)*iH;
+		++pCache->stats.iNrFullUpdates;
+	}
+	for(int c=iNrCascades; c<MAX_SHADOW_CASCADES; c++) pCache->bValid[c] = false;
+
+	SShadowCacheStats &stats = pCache->stats;
+	stats.fRenderedFraction = dNrTexels>0.0 ? ((float) (dNrRendered/dNrTexels)) : 0.0f;
+	if(dNrRendered>0.0) ++stats.iNrFramesRendered;
+	stats.fAvgRenderedFraction = (stats.fAvgRenderedFraction*stats.iNrFrames + stats.fRenderedFraction) / (stats.iNrFrames+1);
+	++stats.iNrFrames;
+}
+
+void GetShadowCacheRectCascade(SShadowCascade * pRectCascade, const SShadowCascade &cascade, const SShadowCacheRect &rect)
+{
+	*pRectCascade = cascade;
+	pRectCascade->vLightMin.x = cascade.vLightMin.x + rect.iX*cascade.fTexelSize;
+	pRectCascade->vLightMax.x = cascade.vLightMin.x + (rect.iX+rect.iWidth)*cascade.fTexelSize;
+	pRectCascade->vLightMax.y = cascade.vLightMax.y - rect.iY*cascade.fTexelSize;
+	pRectCascade->vLightMin.y = cascade.vLightMax.y - (rect.iY+rect.iHeight)*cascade.fTexelSize;
+}
+
@@ -0,0 +1,61 @@
+#ifndef __SHADOWCACHE_H__
+#define __SHADOWCACHE_H__
+
+#include "shadow_cascades.h"
+#include <vector>
+
+// Decides which parts of the cascaded shadow map must be rendered again.
+// A cascade is kept as long as its window, which holds the light direction,
+// is the same as when it was last rendered. Each caster is fingerprinted by
+// a hash of its bounds and transform. A caster that changed dirties the
+// tiles under its light space footprint, both the old and the new one.
+// Nothing here touches the device.
+
+#define SHADOW_CACHE_TILE_SIZE		128		// texels
+
+// texels of the cascade's viewport, x to the right and y down
+struct SShadowCacheRect
+{
+	int iX, iY, iWidth, iHeight;
+};
+
+struct SShadowCascadeUpdate
+{
+	bool bFull;									// render the whole viewport
+	std::vector<SShadowCacheRect> rects;		// otherwise these, none when up to date
+};
+
+struct SShadowCacheStats
+{
+	int iNrFrames, iNrFramesRendered;			// frames in which any texel was rendered
+	int iNrFullUpdates, iNrPartialUpdates;		// cascades, since the reset
+	float fRenderedFraction;					// texels rendered over those of the non empty viewports, last frame
+	float fAvgRenderedFraction;					// the same averaged over every frame since the reset
+};
+
+struct SShadowCache
+{
+	bool bValid[MAX_SHADOW_CASCADES];
+	SShadowCascade cascades[MAX_SHADOW_CASCADES];		// as last rendered
+	Vec3 vSunDir;										// of the footprints
+
+	// per caster as last rendered
+	std::vector<unsigned long long> casterHash;
+	std::vector<float> casterFootprint;					// light space x and y min and max
+
+	SShadowCacheStats stats;
+};
+
+void ResetShadowCache(SShadowCache * pCache);
+
+// Compares this frame's cascades and casters to the state the cache holds,
+// fills pUpdates[0..iNrCascades-1] with what to render and then takes this
+// frame as the new state. Empty cascades need no update.
+void UpdateShadowCache(SShadowCache * pCache, SShadowCascadeUpdate pUpdates[], const SShadowCascade pCascades[], const int iNrCascades,
+					   const Vec3 &vSunDir, const SShadowCaster pCasters[], const int iNrCasters);
+
+// the cascade narrowed to the rect, for culling the casters of a partial update
+void GetShadowCacheRectCascade(SShadowCascade * pRectCascade, const SShadowCascade &cascade, const SShadowCacheRect &rect);
+
+
+#endif
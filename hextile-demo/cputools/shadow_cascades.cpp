@@ -0,0 +1,224 @@
+#include "shadow_cascades.h"
+#include "shadow_hull.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+void ComputeCascadeSplits(float pfSplits[], const int iNrCascades, const float fNear, const float fFar, const float fLambda)
+{
+	pfSplits[0] = fNear;
+	for(int i=1; i<iNrCascades; i++)
+	{
+		const float t = ((float) i) / iNrCascades;
+		const float fLog = fNear * powf(fFar/fNear, t);
+		const float fUni = fNear + (fFar-fNear)*t;
+		pfSplits[i] = fLambda*fLog + (1-fLambda)*fUni;
+	}
+	pfSplits[iNrCascades] = fFar;
+}
+
+void BuildShadowBasis(Vec3 * pvX, Vec3 * pvY, Vec3 * pvZ, const Vec3 &vSunDir)
+{
+	const Vec3 vDir = -vSunDir;
+	Vec3 vX, vY;
+
+	const float avx = fabsf(vDir.x);
+	const float avy = fabsf(vDir.y);
+	const float avz = fabsf(vDir.z);
+
+	if(avx<=avy && avx<=avz)
+	{
+		vY.x=0.0f; vY.y=vDir.z; vY.z=-vDir.y;
+	}
+	else if(avy<=avz)
+	{
+		vY.x=vDir.z; vY.y=0.0f; vY.z=-vDir.x;
+	}
+	else
+	{
+		vY.x=vDir.y; vY.y=-vDir.x; vY.z=0.0f;
+	}
+
+	const float fRecLen = 1.0f / sqrtf(vY.x*vY.x+vY.y*vY.y+vY.z*vY.z);
+	vY.x *= fRecLen; vY.y *= fRecLen; vY.z *= fRecLen;
+
+	vX.x = vY.y*vDir.z - vY.z*vDir.y;
+	vX.y = vY.z*vDir.x - vY.x*vDir.z;
+	vX.z = vY.x*vDir.y - vY.y*vDir.x;
+
+	*pvX = vX; *pvY = vY; *pvZ = vDir;
+}
+
+static void GetSliceTangents(float * pfTanX, float * pfTanY, const SShadowCascadeParams &params)
+{
+	*pfTanY = tanf(0.5f*params.fFovY);
+	*pfTanX = params.fAspect * (*pfTanY);
+}
+
+void GetFrustumSliceCorners(Vec3 pvCorners[8], const SShadowCascadeParams &params, const float fZNear, const float fZFar)
+{
+	float fTanX, fTanY;
+	GetSliceTangents(&fTanX, &fTanY, params);
+
+	for(int j=0; j<8; j++)
+	{
+		const float fZ = (j&0x4)!=0 ? fZFar : fZNear;
+		const Vec3 vPview((j&0x1)!=0 ? (fZ*fTanX) : (-fZ*fTanX), (j&0x2)!=0 ? (fZ*fTanY) : (-fZ*fTanY), -fZ);
+		const Vec4 v4Pw = params.mViewToWorld*vPview;
+		pvCorners[j] = Vec3(v4Pw.x, v4Pw.y, v4Pw.z);
+	}
+}
+
+// Bounding sphere of the slice centered on the view axis. It depends on the
+// split depths and the field of view only, so its radius is the same in
+// every frame and does not change as the camera turns.
+static void GetSliceSphere(Vec3 * pvCenter, float * pfRadius, const SShadowCascadeParams &params, const float fZNear, const float fZFar)
+{
+	float fTanX, fTanY;
+	GetSliceTangents(&fTanX, &fTanY, params);
+	const float fK2 = fTanX*fTanX + fTanY*fTanY;
+
+	// depth at which the near and far corners are equally far away
+	float fZc = 0.5f*(1+fK2)*(fZNear+fZFar);
+	if(fZc>fZFar) fZc = fZFar;
+	const float fDn = fZc-fZNear, fDf = fZFar-fZc;
+	const float fRn2 = fDn*fDn + fZNear*fZNear*fK2, fRf2 = fDf*fDf + fZFar*fZFar*fK2;
+
+	const Vec4 v4Cw = params.mViewToWorld*Vec3(0.0f, 0.0f, -fZc);
+	*pvCenter = Vec3(v4Cw.x, v4Cw.y, v4Cw.z);
+	*pfRadius = sqrtf(fRn2>fRf2 ? fRn2 : fRf2);
+}
+
+static inline void GrowBox(Vec3 * pvMin, Vec3 * pvMax, const Vec3 &vP)
+{
+	if(pvMin->x>vP.x) pvMin->x=vP.x;
+	if(pvMax->x<vP.x) pvMax->x=vP.x;
+	if(pvMin->y>vP.y) pvMin->y=vP.y;
+	if(pvMax->y<vP.y) pvMax->y=vP.y;
+	if(pvMin->z>vP.z) pvMin->z=vP.z;
+	if(pvMax->z<vP.z) pvMax->z=vP.z;
+}
+
+static inline bool OverlapsXY(const Vec3 &vMinA, const Vec3 &vMaxA, const Vec3 &vMinB, const Vec3 &vMaxB)
+{
+	return vMinA.x<=vMaxB.x && vMaxA.x>=vMinB.x && vMinA.y<=vMaxB.y && vMaxA.y>=vMinB.y;
+}
+
+static void CasterBoxesInLightSpace(std::vector<Vec3> &boxes, const Mat33 &rotToLgt, const SShadowCaster pCasters[], const int iNrCasters)
+{
+	boxes.resize(2*iNrCasters);
+	for(int i=0; i<iNrCasters; i++)
+		GetShadowCasterLightBounds(&boxes[2*i+0], &boxes[2*i+1], rotToLgt, pCasters[i]);
+}
+
+int FitShadowCascades(SShadowCascade pCascades[], const SShadowCascadeParams &params, const SShadowCaster pCasters[], const int iNrCasters)
+{
+	const int iNrCascades = params.iNrCascades<1 ? 1 : (params.iNrCascades>MAX_SHADOW_CASCADES ? MAX_SHADOW_CASCADES : params.iNrCascades);
+
+	Vec3 vX, vY, vZ;
+	BuildShadowBasis(&vX, &vY, &vZ, params.vSunDir);
+	Mat33 rotToLgt;
+	SetRow(&rotToLgt, 0, vX); SetRow(&rotToLgt, 1, vY); SetRow(&rotToLgt, 2, vZ);
+
+	// the world space origin in absolute light space. The texel grid is
+	// anchored there so it stays put when the origin is rebased.
+	const double dOrgX = Vec3d(vX)*params.vOrigin, dOrgY = Vec3d(vY)*params.vOrigin;
+
+	std::vector<Vec3> casterBoxes;
+	CasterBoxesInLightSpace(casterBoxes, rotToLgt, pCasters, iNrCasters);
+
+	const float fFar = params.fMaxShadowDist<params.fFar ? params.fMaxShadowDist : params.fFar;
+	float fSplits[MAX_SHADOW_CASCADES+1];
+	ComputeCascadeSplits(fSplits, iNrCascades, params.fNear, fFar, params.fSplitLambda);
+
+	int iNrNonEmpty = 0;
+	for(int c=0; c<iNrCascades; c++)
+	{
+		SShadowCascade &cascade = pCascades[c];
+		memset(&cascade, 0, sizeof(SShadowCascade));
+		cascade.fSplitNear = fSplits[c];
+		cascade.fSplitFar = fSplits[c+1];
+
+		Vec3 vSphereCen; float fRadius;
+		GetSliceSphere(&vSphereCen, &fRadius, params, cascade.fSplitNear, cascade.fSplitFar);
+		const double dTexel = (2.0*fRadius) / (params.iResolution-1);
+		cascade.fTexelSize = (float) dTexel;
+
+		// the receivers, the slice's corners in light space
+		Vec3 vCorners[8];
+		GetFrustumSliceCorners(vCorners, params, cascade.fSplitNear, cascade.fSplitFar);
+		Vec3 vSliceMin = rotToLgt * vCorners[0], vSliceMax = vSliceMin;
+		for(int j=1; j<8; j++) GrowBox(&vSliceMin, &vSliceMax, rotToLgt * vCorners[j]);
+		const float fSliceMinZ = vSliceMin.z;
+
+		// the square around the sphere clipped to the receivers
+		const Vec3 vCenL = rotToLgt * vSphereCen;
+		Vec3 vSqMin(vCenL.x-fRadius, vCenL.y-fRadius, 0.0f), vSqMax(vCenL.x+fRadius, vCenL.y+fRadius, 0.0f);
+		if(vSqMin.x<vSliceMin.x) vSqMin.x=vSliceMin.x;
+		if(vSqMin.y<vSliceMin.y) vSqMin.y=vSliceMin.y;
+		if(vSqMax.x>vSliceMax.x) vSqMax.x=vSliceMax.x;
+		if(vSqMax.y>vSliceMax.y) vSqMax.y=vSliceMax.y;
+
+		// union of the casters overlapping the square grown by a texel, which
+		// holds the window after snapping, so every caster the window touches
+		// is inside the depth range
+		const Vec3 vSelMin(vSqMin.x-cascade.fTexelSize, vSqMin.y-cascade.fTexelSize, 0.0f);
+		const Vec3 vSelMax(vSqMax.x+cascade.fTexelSize, vSqMax.y+cascade.fTexelSize, 0.0f);
+		Vec3 vUniMin(0,0,0), vUniMax(0,0,0);
+		bool bAny = false;
+		for(int i=0; i<iNrCasters; i++)
+		{
+			const Vec3 &vMi = casterBoxes[2*i+0], &vMa = casterBoxes[2*i+1];
+			if(!OverlapsXY(vMi, vMa, vSelMin, vSelMax)) continue;
+			if(!bAny) { vUniMin=vMi; vUniMax=vMa; bAny=true; }
+			else { GrowBox(&vUniMin, &vUniMax, vMi); GrowBox(&vUniMin, &vUniMax, vMa); }
+		}
+
+		cascade.bEmpty = !bAny;
+		if(!bAny)
+		{
+			// a valid window still, nothing is rendered into it
+			vUniMin = Vec3(vCenL.x, vCenL.y, fSliceMinZ); vUniMax = vUniMin;
+		}
+		else ++iNrNonEmpty;
+
+		// intersect with the square and snap outward to whole texels in absolute light space
+		const double dMin[] = { (vUniMin.x>vSqMin.x ? vUniMin.x : vSqMin.x) + dOrgX, (vUniMin.y>vSqMin.y ? vUniMin.y : vSqMin.y) + dOrgY };
+		const double dMax[] = { (vUniMax.x<vSqMax.x ? vUniMax.x : vSqMax.x) + dOrgX, (vUniMax.y<vSqMax.y ? vUniMax.y : vSqMax.y) + dOrgY };
+		int iNrTexels[2];
+		for(int k=0; k<2; k++)
+		{
+			const double dTexMin = floor(dMin[k]/dTexel), dTexMax = ceil(dMax[k]/dTexel);
+			iNrTexels[k] = (int) (dTexMax - dTexMin);
+			if(iNrTexels[k]<1) iNrTexels[k] = 1;
+			if(iNrTexels[k]>params.iResolution) iNrTexels[k] = params.iResolution;
+			(k==0 ? cascade.vLightMin.x : cascade.vLightMin.y) = (float) (dTexMin*dTexel - (k==0 ? dOrgX : dOrgY));
+		}
+		cascade.vLightMax.x = cascade.vLightMin.x + iNrTexels[0]*cascade.fTexelSize;
+		cascade.vLightMax.y = cascade.vLightMin.y + iNrTexels[1]*cascade.fTexelSize;
+		cascade.vLightMin.z = vUniMin.z<fSliceMinZ ? vUniMin.z : fSliceMinZ;
+		cascade.vLightMax.z = vUniMax.z>cascade.vLightMin.z ? vUniMax.z : (cascade.vLightMin.z + cascade.fTexelSize);
+
+		// the window starts at the corner of the tile
+		cascade.iViewport[0] = 0; cascade.iViewport[1] = 0;
+		cascade.iViewport[2] = iNrTexels[0]; cascade.iViewport[3] = iNrTexels[1];
+
+		// same construction as the single map before cascades
+		const Vec3 vCen = 0.5f*(cascade.vLightMax+cascade.vLightMin);
+		const Vec3 vHalfSize = 0.5f*(cascade.vLightMax-cascade.vLightMin);
+
+		SetRow(&cascade.mWorldToLight, 0, Vec4(vX.x, vX.y, vX.z, -vCen.x));
+		SetRow(&cascade.mWorldToLight, 1, Vec4(vY.x, vY.y, vY.z, -vCen.y));
+		SetRow(&cascade.mWorldToLight, 2, Vec4(vZ.x, vZ.y, vZ.z, -vCen.z));
+		SetRow(&cascade.mWorldToLight, 3, Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+		SetRow(&cascade.mProj, 0, Vec4(1.0f/vHalfSize.x, 0.0f, 0.0f, 0.0f) );
+		SetRow(&cascade.mProj, 1, Vec4(0.0f, 1.0f/vHalfSize.y, 0.0f, 0.0f) );
+		SetRow(&cascade.mProj, 2, Vec4(0.0f, 0.0f, -0.5f/vHalfSize.z, 0.5f) );
+		SetRow(&cascade.mProj, 3, Vec4(0.0f, 0.0f, 0.0f, 1.0f) );
+	}
+
+	return iNrNonEmpty;
+}
+
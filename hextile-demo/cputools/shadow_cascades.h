@@ -0,0 +1,77 @@
+#ifndef __SHADOWCASCADES_H__
+#define __SHADOWCASCADES_H__
+
+#include <geommath/geommath.h>
+
+// Split and fit math of the cascaded shadow maps in shadows.cpp. Nothing
+// here touches the device. Light space has z pointing toward the sun and
+// x, y from BuildShadowBasis(). Each cascade covers a slice of the view
+// frustum. Its texel size is derived from the bounding sphere of the slice
+// so it does not change as the camera turns, and its window is snapped to
+// whole texels of a grid fixed in absolute world space so static geometry
+// always lands on the same texels while the camera moves.
+
+#ifndef MAX_SHADOW_CASCADES
+#define MAX_SHADOW_CASCADES		4		// also used by shadows_cbuffer.h
+#endif
+
+struct SShadowCaster
+{
+	Vec3 vMin, vMax;		// local space bound
+	Mat44 mLocToWorld;
+
+	// local space hull as in shadow_hull.h, NULL to use the corners of the box
+	const float * pfHull;
+	int iNrHullVerts;
+};
+
+struct SShadowCascadeParams
+{
+	Mat44 mViewToWorld;		// right hand view space looking down -Z
+	float fFovY;			// radians
+	float fAspect;			// width over height
+	float fNear, fFar;
+	float fMaxShadowDist;	// the last split, clamped to fFar
+
+	int iNrCascades;		// 1 to MAX_SHADOW_CASCADES
+	float fSplitLambda;		// practical split scheme, 0 uniform and 1 logarithmic
+	int iResolution;		// texels along a side of a cascade
+
+	Vec3 vSunDir;			// as GetSunDir()
+	Vec3d vOrigin;			// absolute world position of the world space origin, non zero when camera relative
+};
+
+struct SShadowCascade
+{
+	float fSplitNear, fSplitFar;	// view depth covered
+
+	Mat44 mWorldToLight;			// rotation to light space followed by the translation of the window
+	Mat44 mProj;					// orthographic, the window onto the viewport in clip space
+	int iViewport[4];				// x, y, width and height within the cascade's tile in texels
+
+	float fTexelSize;				// world units
+	Vec3 vLightMin, vLightMax;		// window in light space
+
+	bool bEmpty;					// no casters overlap the slice, nothing to render
+};
+
+// fills pfSplits[0..iNrCascades] from fNear to fFar as a blend of the
+// logarithmic and the uniform split by fLambda.
+void ComputeCascadeSplits(float pfSplits[], const int iNrCascades, const float fNear, const float fFar, const float fLambda);
+
+// rows of the rotation from world to light space
+void BuildShadowBasis(Vec3 * pvX, Vec3 * pvY, Vec3 * pvZ, const Vec3 &vSunDir);
+
+// Per cascade the light space box of the slice is intersected in x and y
+// with the box of the casters and with that of the slice's corners, the
+// receivers. The result is snapped outward to the texel
+// grid which is why iResolution-1 texels span the diameter of the sphere.
+// Depth covers the casters overlapping the window and the receivers of the
+// slice behind them. Returns the number of non empty cascades.
+int FitShadowCascades(SShadowCascade pCascades[], const SShadowCascadeParams &params, const SShadowCaster pCasters[], const int iNrCasters);
+
+// the 8 corners of the frustum slice between view depths fZNear and fZFar
+void GetFrustumSliceCorners(Vec3 pvCorners[8], const SShadowCascadeParams &params, const float fZNear, const float fZFar);
+
+
+#endif
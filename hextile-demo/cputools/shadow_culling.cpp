@@ -0,0 +1,163 @@
+#include "shadow_culling.h"
+#include "simd_common.h"
+#include <math.h>
+#include <vector>
+
+
+void GetShadowCasterWorldBounds(float * pfCen[3], float * pfExt[3], const SShadowCaster pCasters[], const int iNrCasters)
+{
+	for(int i=0; i<iNrCasters; i++)
+	{
+		const SShadowCaster &caster = pCasters[i];
+		const Vec3 vCenLoc = 0.5f*(caster.vMax+caster.vMin);
+		const Vec3 vExtLoc = 0.5f*(caster.vMax-caster.vMin);
+
+		const Vec4 v4Cen = caster.mLocToWorld*vCenLoc;
+		pfCen[0][i] = v4Cen.x; pfCen[1][i] = v4Cen.y; pfCen[2][i] = v4Cen.z;
+
+		// column major
+		const float * pfM = caster.mLocToWorld.m_fMat;
+		for(int k=0; k<3; k++)
+			pfExt[k][i] = fabsf(pfM[k+0*4])*vExtLoc.x + fabsf(pfM[k+1*4])*vExtLoc.y + fabsf(pfM[k+2*4])*vExtLoc.z;
+	}
+}
+
+
+// rotation to light space and the windows of the non empty cascades
+struct SCullVolumes
+{
+	float fR[3][3], fAbsR[3][3];
+	int iNrVolumes;
+	unsigned char uBit[MAX_SHADOW_CASCADES];
+	float fMin[MAX_SHADOW_CASCADES][3], fMax[MAX_SHADOW_CASCADES][2];		// no bound toward the light
+};
+
+static void SetupCullVolumes(SCullVolumes * pVol, const SShadowCascade pCascades[], const int iNrCascades, const Vec3 &vSunDir)
+{
+	Vec3 vAxes[3];
+	BuildShadowBasis(&vAxes[0], &vAxes[1], &vAxes[2], vSunDir);
+	for(int r=0; r<3; r++)
+	{
+		pVol->fR[r][0] = vAxes[r].x; pVol->fR[r][1] = vAxes[r].y; pVol->fR[r][2] = vAxes[r].z;
+		for(int c=0; c<3; c++) pVol->fAbsR[r][c] = fabsf(pVol->fR[r][c]);
+	}
+
+	pVol->iNrVolumes = 0;
+	for(int c=0; c<iNrCascades && c<MAX_SHADOW_CASCADES; c++)
+	{
+		if(pCascades[c].bEmpty) continue;
+
+		const int v = pVol->iNrVolumes++;
+		pVol->uBit[v] = (unsigned char) (1<<c);
+		pVol->fMin[v][0] = pCascades[c].vLightMin.x; pVol->fMin[v][1] = pCascades[c].vLightMin.y; pVol->fMin[v][2] = pCascades[c].vLightMin.z;
+		pVol->fMax[v][0] = pCascades[c].vLightMax.x; pVol->fMax[v][1] = pCascades[c].vLightMax.y;
+	}
+}
+
+static void CullShadowCastersScalar(unsigned char puCascadeMask[], const SCullVolumes &vol, const float * const pfCen[3], const float * const pfExt[3],
+									const int iStart, const int iEnd)
+{
+	for(int i=iStart; i<iEnd; i++)
+	{
+		float fL[3], fE[3];
+		for(int r=0; r<3; r++)
+		{
+			fL[r] = vol.fR[r][0]*pfCen[0][i] + vol.fR[r][1]*pfCen[1][i] + vol.fR[r][2]*pfCen[2][i];
+			fE[r] = vol.fAbsR[r][0]*pfExt[0][i] + vol.fAbsR[r][1]*pfExt[1][i] + vol.fAbsR[r][2]*pfExt[2][i];
+		}
+
+		unsigned char uMask = 0;
+		for(int v=0; v<vol.iNrVolumes; v++)
+		{
+			const bool bInside = (fL[0]+fE[0])>=vol.fMin[v][0] && (fL[0]-fE[0])<=vol.fMax[v][0] &&
+								 (fL[1]+fE[1])>=vol.fMin[v][1] && (fL[1]-fE[1])<=vol.fMax[v][1] &&
+								 (fL[2]+fE[2])>=vol.fMin[v][2];
+			if(bInside) uMask |= vol.uBit[v];
+		}
+		puCascadeMask[i] = uMask;
+	}
+}
+
+#ifdef SIMD_HAS_AVX2_PATH
+// same operations in the same order as the scalar path
+SIMD_AVX2_FUNC static int CullShadowCastersAVX2(unsigned char puCascadeMask[], const SCullVolumes &vol, const float * const pfCen[3], const float * const pfExt[3],
+												const int iNrCasters)
+{
+	__m256 vR[3][3], vAbsR[3][3];
+	for(int r=0; r<3; r++)
+		for(int c=0; c<3; c++)
+		{
+			vR[r][c] = _mm256_set1_ps(vol.fR[r][c]);
+			vAbsR[r][c] = _mm256_set1_ps(vol.fAbsR[r][c]);
+		}
+
+	int i=0;
+	for(; (i+8)<=iNrCasters; i+=8)
+	{
+		__m256 vC[3], vX[3];
+		for(int k=0; k<3; k++)
+		{
+			vC[k] = _mm256_loadu_ps(pfCen[k]+i);
+			vX[k] = _mm256_loadu_ps(pfExt[k]+i);
+		}
+
+		__m256 vLo[3], vHi[3];
+		for(int r=0; r<3; r++)
+		{
+			const __m256 vL = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vR[r][0], vC[0]), _mm256_mul_ps(vR[r][1], vC[1])), _mm256_mul_ps(vR[r][2], vC[2]));
+			const __m256 vE = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vAbsR[r][0], vX[0]), _mm256_mul_ps(vAbsR[r][1], vX[1])), _mm256_mul_ps(vAbsR[r][2], vX[2]));
+			vLo[r] = _mm256_sub_ps(vL, vE);
+			vHi[r] = _mm256_add_ps(vL, vE);
+		}
+
+		unsigned int uLanes[MAX_SHADOW_CASCADES];
+		for(int v=0; v<vol.iNrVolumes; v++)
+		{
+			__m256 vIn = _mm256_cmp_ps(vHi[0], _mm256_set1_ps(vol.fMin[v][0]), _CMP_GE_OQ);
+			vIn = _mm256_and_ps(vIn, _mm256_cmp_ps(vLo[0], _mm256_set1_ps(vol.fMax[v][0]), _CMP_LE_OQ));
+			vIn = _mm256_and_ps(vIn, _mm256_cmp_ps(vHi[1], _mm256_set1_ps(vol.fMin[v][1]), _CMP_GE_OQ));
+			vIn = _mm256_and_ps(vIn, _mm256_cmp_ps(vLo[1], _mm256_set1_ps(vol.fMax[v][1]), _CMP_LE_OQ));
+			vIn = _mm256_and_ps(vIn, _mm256_cmp_ps(vHi[2], _mm256_set1_ps(vol.fMin[v][2]), _CMP_GE_OQ));
+			uLanes[v] = (unsigned int) _mm256_movemask_ps(vIn);
+		}
+
+		for(int j=0; j<8; j++)
+		{
+			unsigned char uMask = 0;
+			for(int v=0; v<vol.iNrVolumes; v++)
+				if(((uLanes[v]>>j)&0x1)!=0) uMask |= vol.uBit[v];
+			puCascadeMask[i+j] = uMask;
+		}
+	}
+
+	return i;
+}
+#endif
+
+
+static bool g_bAVX2Enabled = CpuSupportsAVX2();
+
+bool IsShadowCullAVX2Enabled()
+{
+	return g_bAVX2Enabled;
+}
+
+int CullShadowCasters(unsigned char puCascadeMask[], const SShadowCascade pCascades[], const int iNrCascades, const Vec3 &vSunDir,
+					  const float * const pfCen[3], const float * const pfExt[3], const int iNrCasters, const bool bAllowAVX2)
+{
+	SCullVolumes vol;
+	SetupCullVolumes(&vol, pCascades, iNrCascades, vSunDir);
+
+	int iDone = 0;
+#ifdef SIMD_HAS_AVX2_PATH
+	if(g_bAVX2Enabled && bAllowAVX2) iDone = CullShadowCastersAVX2(puCascadeMask, vol, pfCen, pfExt, iNrCasters);
+#endif
+	CullShadowCastersScalar(puCascadeMask, vol, pfCen, pfExt, iDone, iNrCasters);
+
+	int iNrCulled = 0;
+	for(int i=0; i<iNrCasters; i++)
+		if(puCascadeMask[i]==0) ++iNrCulled;
+
+	return iNrCulled;
+}
+
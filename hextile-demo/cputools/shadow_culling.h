@@ -0,0 +1,37 @@
+#ifndef __SHADOWCULLING_H__
+#define __SHADOWCULLING_H__
+
+#include "shadow_cascades.h"
+
+// Culling of the shadow casters against the cascades of shadow_cascades.h
+// before the shadow pass. The volume of a cascade is its window in light
+// space extended toward the light without bound, since anything above the
+// window may still cast a shadow into it, and bounded below by the depth of
+// the furthest receiver. Casters are given as world space boxes in SoA and
+// tested 8 at a time with AVX2 when the CPU supports it. Both paths produce
+// the same masks.
+
+// world space box of each caster as center and half extent, pfCen[k][i] and
+// pfExt[k][i] for axis k of caster i.
+void GetShadowCasterWorldBounds(float * pfCen[3], float * pfExt[3], const SShadowCaster pCasters[], const int iNrCasters);
+
+// Sets bit c of puCascadeMask[i] when caster i may cast a shadow into
+// cascade c. Empty cascades receive no bits. Returns the number of casters
+// culled from every cascade.
+int CullShadowCasters(unsigned char puCascadeMask[], const SShadowCascade pCascades[], const int iNrCascades, const Vec3 &vSunDir,
+					  const float * const pfCen[3], const float * const pfExt[3], const int iNrCasters, const bool bAllowAVX2=true);
+
+bool IsShadowCullAVX2Enabled();
+
+
+// per frame counts of the shadow pass
+struct SShadowCullStats
+{
+	int iNrCasters;
+	int iNrCulled;			// casters culled from every cascade
+	int iNrDraws;			// instanced draws issued over all cascades
+	int iNrDrawsCulled;		// instances skipped over all non empty cascades
+};
+
+
+#endif
@@ -0,0 +1,184 @@
+#include "shadow_hull.h"
+#include "simd_common.h"
+#include <math.h>
+#include <vector>
+
+
+// the axes, the edge diagonals and the corner diagonals
+static const float g_fKDopDirs[SHADOW_KDOP_NR_DIRS][3] = {
+	{1,0,0}, {0,1,0}, {0,0,1},
+	{1,1,0}, {1,-1,0}, {1,0,1}, {1,0,-1}, {0,1,1}, {0,1,-1},
+	{1,1,1}, {1,1,-1}, {1,-1,1}, {1,-1,-1}
+};
+
+int BuildShadowKDopHull(std::vector<float> &pfHull, const float pfPositions[], const int iStride, const int iNrPositions)
+{
+	if(iNrPositions<=0) return 0;
+
+	// slabs, grown by a little so rounding never moves a corner inside the mesh
+	double dMin[SHADOW_KDOP_NR_DIRS], dMax[SHADOW_KDOP_NR_DIRS];
+	for(int d=0; d<SHADOW_KDOP_NR_DIRS; d++)
+	{
+		for(int i=0; i<iNrPositions; i++)
+		{
+			const float * pfP = pfPositions + i*iStride;
+			const double dDot = g_fKDopDirs[d][0]*((double) pfP[0]) + g_fKDopDirs[d][1]*((double) pfP[1]) + g_fKDopDirs[d][2]*((double) pfP[2]);
+			if(i==0 || dMin[d]>dDot) dMin[d] = dDot;
+			if(i==0 || dMax[d]<dDot) dMax[d] = dDot;
+		}
+	}
+	double dScale = 0.0;
+	for(int d=0; d<3; d++) if(dScale<(dMax[d]-dMin[d])) dScale = dMax[d]-dMin[d];
+	const double dMargin = 1e-5*(dScale>0.0 ? dScale : 1.0);
+	for(int d=0; d<SHADOW_KDOP_NR_DIRS; d++) { dMin[d] -= dMargin; dMax[d] += dMargin; }
+
+	// planes n.p<=w, the positive and the negative side of each slab
+	const int iNrPlanes = 2*SHADOW_KDOP_NR_DIRS;
+	double dN[2*SHADOW_KDOP_NR_DIRS][3], dW[2*SHADOW_KDOP_NR_DIRS];
+	for(int d=0; d<SHADOW_KDOP_NR_DIRS; d++)
+	{
+		for(int k=0; k<3; k++) { dN[2*d+0][k] = g_fKDopDirs[d][k]; dN[2*d+1][k] = -g_fKDopDirs[d][k]; }
+		dW[2*d+0] = dMax[d]; dW[2*d+1] = -dMin[d];
+	}
+
+	// corners of the polytope are the points where three planes meet inside all others
+	std::vector<double> corners;
+	const double dEps = 1e-9*(dScale>0.0 ? dScale : 1.0);
+	for(int a=0; a<iNrPlanes; a++)
+		for(int b=a+1; b<iNrPlanes; b++)
+			for(int c=b+1; c<iNrPlanes; c++)
+			{
+				const double * n0 = dN[a], * n1 = dN[b], * n2 = dN[c];
+				const double dC0[] = { n1[1]*n2[2]-n1[2]*n2[1], n1[2]*n2[0]-n1[0]*n2[2], n1[0]*n2[1]-n1[1]*n2[0] };
+				const double dDet = n0[0]*dC0[0] + n0[1]*dC0[1] + n0[2]*dC0[2];
+				if(fabs(dDet)<1e-9) continue;
+
+				const double dC1[] = { n2[1]*n0[2]-n2[2]*n0[1], n2[2]*n0[0]-n2[0]*n0[2], n2[0]*n0[1]-n2[1]*n0[0] };
+				const double dC2[] = { n0[1]*n1[2]-n0[2]*n1[1], n0[2]*n1[0]-n0[0]*n1[2], n0[0]*n1[1]-n0[1]*n1[0] };
+				double dP[3];
+				for(int k=0; k<3; k++) dP[k] = (dW[a]*dC0[k] + dW[b]*dC1[k] + dW[c]*dC2[k]) / dDet;
+
+				bool bInside = true;
+				for(int p=0; p<iNrPlanes && bInside; p++)
+					bInside = (dN[p][0]*dP[0] + dN[p][1]*dP[1] + dN[p][2]*dP[2]) <= (dW[p]+dEps);
+				if(!bInside) continue;
+
+				bool bDuplicate = false;
+				for(int v=0; v<(int) (corners.size()/3) && !bDuplicate; v++)
+					bDuplicate = fabs(corners[3*v+0]-dP[0])<=dEps && fabs(corners[3*v+1]-dP[1])<=dEps && fabs(corners[3*v+2]-dP[2])<=dEps;
+				if(!bDuplicate) for(int k=0; k<3; k++) corners.push_back(dP[k]);
+			}
+
+	const int iNrHullVerts = (int) (corners.size()/3);
+	const int iOffs = (int) pfHull.size();
+	pfHull.resize(iOffs + 3*iNrHullVerts);
+	for(int v=0; v<iNrHullVerts; v++)
+		for(int k=0; k<3; k++) pfHull[iOffs + k*iNrHullVerts + v] = (float) corners[3*v+k];
+
+	return iNrHullVerts;
+}
+
+
+// rotation to light space times the caster's transform, the rows of a 3x4
+static void GetLocToLightRows(float fM[3][4], const Mat33 &rotToLgt, const SShadowCaster &caster)
+{
+	for(int r=0; r<3; r++)
+	{
+		const Vec3 vRow = GetRow(rotToLgt, r);
+		for(int c=0; c<4; c++)
+		{
+			const Vec4 vCol = GetColumn(caster.mLocToWorld, c);
+			fM[r][c] = vRow.x*vCol.x + vRow.y*vCol.y + vRow.z*vCol.z;
+		}
+	}
+}
+
+static void HullBoundsScalar(float fMin[3], float fMax[3], const float fM[3][4], const float * pfHull, const int iNrVerts, const int iStart)
+{
+	const float * pfX = pfHull, * pfY = pfHull+iNrVerts, * pfZ = pfHull+2*iNrVerts;
+	for(int v=iStart; v<iNrVerts; v++)
+		for(int r=0; r<3; r++)
+		{
+			const float fP = fM[r][0]*pfX[v] + fM[r][1]*pfY[v] + fM[r][2]*pfZ[v] + fM[r][3];
+			if(fMin[r]>fP) fMin[r]=fP;
+			if(fMax[r]<fP) fMax[r]=fP;
+		}
+}
+
+#ifdef SIMD_HAS_AVX2_PATH
+// same operations in the same order as the scalar path
+SIMD_AVX2_FUNC static int HullBoundsAVX2(float fMin[3], float fMax[3], const float fM[3][4], const float * pfHull, const int iNrVerts)
+{
+	const float * pfX = pfHull, * pfY = pfHull+iNrVerts, * pfZ = pfHull+2*iNrVerts;
+
+	__m256 vMin[3], vMax[3];
+	for(int r=0; r<3; r++) { vMin[r] = _mm256_set1_ps(fMin[r]); vMax[r] = _mm256_set1_ps(fMax[r]); }
+
+	int v=0;
+	for(; (v+8)<=iNrVerts; v+=8)
+	{
+		const __m256 vX = _mm256_loadu_ps(pfX+v), vY = _mm256_loadu_ps(pfY+v), vZ = _mm256_loadu_ps(pfZ+v);
+		for(int r=0; r<3; r++)
+		{
+			const __m256 vP = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(fM[r][0]), vX), _mm256_mul_ps(_mm256_set1_ps(fM[r][1]), vY)),
+											_mm256_mul_ps(_mm256_set1_ps(fM[r][2]), vZ)), _mm256_set1_ps(fM[r][3]));
+			vMin[r] = _mm256_min_ps(vMin[r], vP);
+			vMax[r] = _mm256_max_ps(vMax[r], vP);
+		}
+	}
+
+	for(int r=0; r<3; r++)
+	{
+		float fLanesMin[8], fLanesMax[8];
+		_mm256_storeu_ps(fLanesMin, vMin[r]); _mm256_storeu_ps(fLanesMax, vMax[r]);
+		for(int j=0; j<8; j++)
+		{
+			if(fMin[r]>fLanesMin[j]) fMin[r]=fLanesMin[j];
+			if(fMax[r]<fLanesMax[j]) fMax[r]=fLanesMax[j];
+		}
+	}
+
+	return v;
+}
+#endif
+
+static bool g_bAVX2Enabled = CpuSupportsAVX2();
+
+void GetShadowCasterLightBounds(Vec3 * pvMin, Vec3 * pvMax, const Mat33 &rotToLgt, const SShadowCaster &caster, const bool bAllowAVX2)
+{
+	float fM[3][4];
+	GetLocToLightRows(fM, rotToLgt, caster);
+
+	// corners of the box when there is no hull
+	float fCorners[3*8];
+	const float * pfHull = caster.pfHull;
+	int iNrVerts = caster.iNrHullVerts;
+	if(pfHull==NULL || iNrVerts<=0)
+	{
+		for(int j=0; j<8; j++)
+		{
+			fCorners[0*8+j] = (j&0x1)!=0 ? caster.vMax.x : caster.vMin.x;
+			fCorners[1*8+j] = (j&0x2)!=0 ? caster.vMax.y : caster.vMin.y;
+			fCorners[2*8+j] = (j&0x4)!=0 ? caster.vMax.z : caster.vMin.z;
+		}
+		pfHull = fCorners; iNrVerts = 8;
+	}
+
+	// start from the first point so both paths agree
+	float fMin[3], fMax[3];
+	for(int r=0; r<3; r++)
+	{
+		fMin[r] = fM[r][0]*pfHull[0] + fM[r][1]*pfHull[iNrVerts] + fM[r][2]*pfHull[2*iNrVerts] + fM[r][3];
+		fMax[r] = fMin[r];
+	}
+
+	int iDone = 0;
+#ifdef SIMD_HAS_AVX2_PATH
+	if(g_bAVX2Enabled && bAllowAVX2) iDone = HullBoundsAVX2(fMin, fMax, fM, pfHull, iNrVerts);
+#endif
+	HullBoundsScalar(fMin, fMax, fM, pfHull, iNrVerts, iDone);
+
+	*pvMin = Vec3(fMin[0], fMin[1], fMin[2]);
+	*pvMax = Vec3(fMax[0], fMax[1], fMax[2]);
+}
+
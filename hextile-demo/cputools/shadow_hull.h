@@ -0,0 +1,27 @@
+#ifndef __SHADOWHULL_H__
+#define __SHADOWHULL_H__
+
+#include "shadow_cascades.h"
+#include <vector>
+
+// Small convex hulls of the shadow casters for fitting the cascades. A mesh
+// is bounded by its 26-DOP, the slabs along the 3 axes, the 6 edge and the
+// 4 corner diagonals, and the hull is the set of corners of that polytope.
+// It contains the mesh, is typically a few dozen points and is much tighter
+// than the corners of the local box once the mesh is rotated relative to
+// the light.
+
+#define SHADOW_KDOP_NR_DIRS		13
+
+// Appends the hull of the iNrPositions points to pfHull as SoA, all x
+// followed by all y and all z. pfPositions[] holds the points with a stride
+// of iStride floats. Returns the number of hull points, 0 on failure.
+int BuildShadowKDopHull(std::vector<float> &pfHull, const float pfPositions[], const int iStride, const int iNrPositions);
+
+// light space bound of the caster, of its hull when it has one and of the
+// corners of its box otherwise. The hull is transformed 8 points at a time
+// with AVX2 when the CPU supports it. Both paths produce the same bits.
+void GetShadowCasterLightBounds(Vec3 * pvMin, Vec3 * pvMax, const Mat33 &rotToLgt, const SShadowCaster &caster, const bool bAllowAVX2=true);
+
+
+#endif
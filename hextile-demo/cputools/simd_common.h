@@ -0,0 +1,44 @@
+#ifndef __SIMDCOMMON_H__
+#define __SIMDCOMMON_H__
+
+// The AVX2 code paths are compiled for every x86 target and selected at
+// runtime, so the executable still runs on CPUs without AVX2. On gcc/clang
+// the individual functions are tagged with the target attribute instead
+// of compiling the whole project with -mavx2.
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#define SIMD_HAS_AVX2_PATH
+	#define SIMD_AVX2_FUNC
+	#include <intrin.h>
+	#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	#define SIMD_HAS_AVX2_PATH
+	#define SIMD_AVX2_FUNC		__attribute__((target("avx2")))
+	#include <immintrin.h>
+#endif
+
+
+static inline bool CpuSupportsAVX2()
+{
+#if defined(SIMD_HAS_AVX2_PATH) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0]<7) return false;
+
+	__cpuid(info, 1);
+	const bool bOSXSave = (info[2] & (1<<27))!=0;
+	const bool bAVX = (info[2] & (1<<28))!=0;
+	if(!bOSXSave || !bAVX) return false;
+	if((_xgetbv(0) & 0x6)!=0x6) return false;		// OS saves xmm and ymm state
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1<<5))!=0;
+#elif defined(SIMD_HAS_AVX2_PATH)
+	return __builtin_cpu_supports("avx2")!=0;
+#else
+	return false;
+#endif
+}
+
+
+#endif
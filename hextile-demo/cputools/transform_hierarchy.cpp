@@ -0,0 +1,316 @@
+#include "transform_hierarchy.h"
+#include "simd_common.h"
+#include <algorithm>
+
+
+static const float g_fIdentity34[12] = { 1,0,0,0, 0,1,0,0, 0,0,1,0 };
+
+bool BuildTransformHierarchy(STransformHierarchy * pHier, const int piParent[], const int iNrNodes)
+{
+	pHier->iNrNodes = 0; pHier->iMaxLevel = 0;
+	pHier->marked.clear(); pHier->work.clear();
+	if(iNrNodes<0) return false;
+	for(int id=0; id<iNrNodes; id++)
+		if(piParent[id]<-1 || piParent[id]>=iNrNodes || piParent[id]==id) return false;
+
+	// children of each id, consecutive in id order
+	std::vector<int> childOffs(iNrNodes+1, 0), children(iNrNodes);
+	for(int id=0; id<iNrNodes; id++)
+		if(piParent[id]>=0) ++childOffs[piParent[id]+1];
+	for(int id=0; id<iNrNodes; id++) childOffs[id+1] += childOffs[id];
+	std::vector<int> fill(childOffs.begin(), childOffs.end()-1);
+	for(int id=0; id<iNrNodes; id++)
+		if(piParent[id]>=0) children[fill[piParent[id]]++] = id;
+
+	// breadth first from the roots, a cycle is never reached
+	std::vector<int> &idOfNode = pHier->idOfNode;
+	std::vector<int> &nodeOfId = pHier->nodeOfId;
+	idOfNode.resize(iNrNodes); nodeOfId.assign(iNrNodes, -1);
+	pHier->parent.resize(iNrNodes); pHier->level.resize(iNrNodes);
+	pHier->firstChild.resize(iNrNodes); pHier->nrChildren.resize(iNrNodes);
+
+	int iNrPlaced = 0;
+	for(int id=0; id<iNrNodes; id++)
+		if(piParent[id]<0)
+		{
+			nodeOfId[id] = iNrPlaced; idOfNode[iNrPlaced] = id;
+			pHier->parent[iNrPlaced] = -1; pHier->level[iNrPlaced] = 0;
+			++iNrPlaced;
+		}
+
+	int iMaxLevel = 0;
+	for(int node=0; node<iNrPlaced; node++)
+	{
+		const int id = idOfNode[node];
+		pHier->firstChild[node] = iNrPlaced;
+		pHier->nrChildren[node] = childOffs[id+1]-childOffs[id];
+		for(int c=childOffs[id]; c<childOffs[id+1]; c++)
+		{
+			const int child = children[c];
+			nodeOfId[child] = iNrPlaced; idOfNode[iNrPlaced] = child;
+			pHier->parent[iNrPlaced] = node; pHier->level[iNrPlaced] = pHier->level[node]+1;
+			iMaxLevel = std::max(iMaxLevel, pHier->level[iNrPlaced]);
+			++iNrPlaced;
+		}
+	}
+	if(iNrPlaced!=iNrNodes) return false;
+
+	pHier->iNrNodes = iNrNodes;
+	pHier->iMaxLevel = iMaxLevel;
+	pHier->local.resize(12*iNrNodes); pHier->world.resize(12*iNrNodes); pHier->worldInv.resize(12*iNrNodes);
+	for(int k=0; k<12; k++)
+	{
+		std::fill(pHier->local.begin()+k*iNrNodes, pHier->local.begin()+(k+1)*iNrNodes, g_fIdentity34[k]);
+		std::fill(pHier->world.begin()+k*iNrNodes, pHier->world.begin()+(k+1)*iNrNodes, g_fIdentity34[k]);
+		std::fill(pHier->worldInv.begin()+k*iNrNodes, pHier->worldInv.begin()+(k+1)*iNrNodes, g_fIdentity34[k]);
+	}
+
+	// the roots take their descendants along
+	pHier->dirty.assign(iNrNodes, 0);
+	for(int node=0; node<iNrNodes && pHier->parent[node]<0; node++)
+	{
+		pHier->dirty[node] = 1;
+		pHier->marked.push_back(node);
+	}
+
+	return true;
+}
+
+void MarkTransformDirty(STransformHierarchy * pHier, const int id)
+{
+	const int node = pHier->nodeOfId[id];
+	if(pHier->dirty[node]==0)
+	{
+		pHier->dirty[node] = 1;
+		pHier->marked.push_back(node);
+	}
+}
+
+void SetTransformLocal(STransformHierarchy * pHier, const int id, const Mat44 &mLocal)
+{
+	const int n = pHier->iNrNodes;
+	const int node = pHier->nodeOfId[id];
+
+	bool bChanged = false;
+	for(int k=0; k<12; k++)
+	{
+		const float fVal = mLocal.m_fMat[(k>>2) + (k&0x3)*4];
+		float &fDst = pHier->local[k*n+node];
+		if(fDst!=fVal) { fDst = fVal; bChanged = true; }
+	}
+
+	if(bChanged) MarkTransformDirty(pHier, id);
+}
+
+static void UnpackTransform(Mat44 * pmMat, const float pfPlanes[], const int n, const int node)
+{
+	for(int k=0; k<12; k++)
+		pmMat->m_fMat[(k>>2) + (k&0x3)*4] = pfPlanes[k*n+node];
+	pmMat->m_fMat[3+0*4] = 0.0f; pmMat->m_fMat[3+1*4] = 0.0f;
+	pmMat->m_fMat[3+2*4] = 0.0f; pmMat->m_fMat[3+3*4] = 1.0f;
+}
+
+void GetTransformLocal(Mat44 * pmLocal, const STransformHierarchy &hier, const int id)
+{
+	UnpackTransform(pmLocal, &hier.local[0], hier.iNrNodes, hier.nodeOfId[id]);
+}
+
+void GetTransformWorld(Mat44 * pmLocToWorld, Mat44 * pmWorldToLocal, const STransformHierarchy &hier, const int id)
+{
+	const int node = hier.nodeOfId[id];
+	UnpackTransform(pmLocToWorld, &hier.world[0], hier.iNrNodes, node);
+	if(pmWorldToLocal!=NULL) UnpackTransform(pmWorldToLocal, &hier.worldInv[0], hier.iNrNodes, node);
+}
+
+
+// W = P*L followed by the inverse of W by the adjugate of its 3x3 block
+static void UpdateNodeScalar(STransformHierarchy * pHier, const int node)
+{
+	const int n = pHier->iNrNodes;
+	const int par = pHier->parent[node];
+
+	float P[12], L[12];
+	for(int k=0; k<12; k++)
+	{
+		L[k] = pHier->local[k*n+node];
+		P[k] = par<0 ? g_fIdentity34[k] : pHier->world[k*n+par];
+	}
+
+	float W[12];
+	for(int r=0; r<3; r++)
+		for(int c=0; c<4; c++)
+		{
+			float fV = (P[r*4+0]*L[0*4+c] + P[r*4+1]*L[1*4+c]) + P[r*4+2]*L[2*4+c];
+			if(c==3) fV = fV + P[r*4+3];
+			W[r*4+c] = fV;
+		}
+
+	float C[9];
+	C[0] = W[1*4+1]*W[2*4+2] - W[1*4+2]*W[2*4+1];
+	C[1] = W[0*4+2]*W[2*4+1] - W[0*4+1]*W[2*4+2];
+	C[2] = W[0*4+1]*W[1*4+2] - W[0*4+2]*W[1*4+1];
+	C[3] = W[1*4+2]*W[2*4+0] - W[1*4+0]*W[2*4+2];
+	C[4] = W[0*4+0]*W[2*4+2] - W[0*4+2]*W[2*4+0];
+	C[5] = W[0*4+2]*W[1*4+0] - W[0*4+0]*W[1*4+2];
+	C[6] = W[1*4+0]*W[2*4+1] - W[1*4+1]*W[2*4+0];
+	C[7] = W[0*4+1]*W[2*4+0] - W[0*4+0]*W[2*4+1];
+	C[8] = W[0*4+0]*W[1*4+1] - W[0*4+1]*W[1*4+0];
+	const float fDet = (W[0*4+0]*C[0] + W[0*4+1]*C[3]) + W[0*4+2]*C[6];
+	const float fRecipDet = 1.0f / fDet;
+
+	float I[12];
+	for(int r=0; r<3; r++)
+	{
+		for(int c=0; c<3; c++) I[r*4+c] = C[r*3+c]*fRecipDet;
+		I[r*4+3] = -((I[r*4+0]*W[0*4+3] + I[r*4+1]*W[1*4+3]) + I[r*4+2]*W[2*4+3]);
+	}
+
+	for(int k=0; k<12; k++)
+	{
+		pHier->world[k*n+node] = W[k];
+		pHier->worldInv[k*n+node] = I[k];
+	}
+}
+
+#ifdef SIMD_HAS_AVX2_PATH
+// same operations in the same order as the scalar path. Unused lanes
+// repeat the first node and are not written.
+SIMD_AVX2_FUNC static void UpdateNodesAVX2(STransformHierarchy * pHier, const int piNodes[], const int iCount)
+{
+	const int n = pHier->iNrNodes;
+
+	int idx[8], par[8];
+	for(int j=0; j<8; j++)
+	{
+		idx[j] = piNodes[j<iCount ? j : 0];
+		par[j] = pHier->parent[idx[j]];
+	}
+	const __m256i vIdx = _mm256_loadu_si256((const __m256i *) idx);
+	const __m256i vPar = _mm256_loadu_si256((const __m256i *) par);
+	const __m256 vRoot = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_setzero_si256(), vPar));
+	const __m256i vParIdx = _mm256_max_epi32(vPar, _mm256_setzero_si256());
+
+	// siblings are often consecutive nodes
+	const bool bContiguous = iCount==8 && (idx[7]-idx[0])==7;
+
+	__m256 P[12], L[12];
+	for(int k=0; k<12; k++)
+	{
+		const float * pfLocal = &pHier->local[k*n];
+		L[k] = bContiguous ? _mm256_loadu_ps(pfLocal+idx[0]) : _mm256_i32gather_ps(pfLocal, vIdx, 4);
+		P[k] = _mm256_blendv_ps(_mm256_i32gather_ps(&pHier->world[k*n], vParIdx, 4), _mm256_set1_ps(g_fIdentity34[k]), vRoot);
+	}
+
+	__m256 W[12];
+	for(int r=0; r<3; r++)
+		for(int c=0; c<4; c++)
+		{
+			__m256 vV = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(P[r*4+0], L[0*4+c]), _mm256_mul_ps(P[r*4+1], L[1*4+c])), _mm256_mul_ps(P[r*4+2], L[2*4+c]));
+			if(c==3) vV = _mm256_add_ps(vV, P[r*4+3]);
+			W[r*4+c] = vV;
+		}
+
+	__m256 C[9];
+	C[0] = _mm256_sub_ps(_mm256_mul_ps(W[1*4+1], W[2*4+2]), _mm256_mul_ps(W[1*4+2], W[2*4+1]));
+	C[1] = _mm256_sub_ps(_mm256_mul_ps(W[0*4+2], W[2*4+1]), _mm256_mul_ps(W[0*4+1], W[2*4+2]));
+	C[2] = _mm256_sub_ps(_mm256_mul_ps(W[0*4+1], W[1*4+2]), _mm256_mul_ps(W[0*4+2], W[1*4+1]));
+	C[3] = _mm256_sub_ps(_mm256_mul_ps(W[1*4+2], W[2*4+0]), _mm256_mul_ps(W[1*4+0], W[2*4+2]));
+	C[4] = _mm256_sub_ps(_mm256_mul_ps(W[0*4+0], W[2*4+2]), _mm256_mul_ps(W[0*4+2], W[2*4+0]));
+	C[5] = _mm256_sub_ps(_mm256_mul_ps(W[0*4+2], W[1*4+0]), _mm256_mul_ps(W[0*4+0], W[1*4+2]));
+	C[6] = _mm256_sub_ps(_mm256_mul_ps(W[1*4+0], W[2*4+1]), _mm256_mul_ps(W[1*4+1], W[2*4+0]));
+	C[7] = _mm256_sub_ps(_mm256_mul_ps(W[0*4+1], W[2*4+0]), _mm256_mul_ps(W[0*4+0], W[2*4+1]));
+	C[8] = _mm256_sub_ps(_mm256_mul_ps(W[0*4+0], W[1*4+1]), _mm256_mul_ps(W[0*4+1], W[1*4+0]));
+	const __m256 vDet = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(W[0*4+0], C[0]), _mm256_mul_ps(W[0*4+1], C[3])), _mm256_mul_ps(W[0*4+2], C[6]));
+	const __m256 vRecipDet = _mm256_div_ps(_mm256_set1_ps(1.0f), vDet);
+	const __m256 vSign = _mm256_set1_ps(-0.0f);
+
+	__m256 I[12];
+	for(int r=0; r<3; r++)
+	{
+		for(int c=0; c<3; c++) I[r*4+c] = _mm256_mul_ps(C[r*3+c], vRecipDet);
+		const __m256 vT = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(I[r*4+0], W[0*4+3]), _mm256_mul_ps(I[r*4+1], W[1*4+3])), _mm256_mul_ps(I[r*4+2], W[2*4+3]));
+		I[r*4+3] = _mm256_xor_ps(vT, vSign);
+	}
+
+	if(bContiguous)
+	{
+		for(int k=0; k<12; k++)
+		{
+			_mm256_storeu_ps(&pHier->world[k*n+idx[0]], W[k]);
+			_mm256_storeu_ps(&pHier->worldInv[k*n+idx[0]], I[k]);
+		}
+	}
+	else
+	{
+		float fW[12][8], fI[12][8];
+		for(int k=0; k<12; k++)
+		{
+			_mm256_storeu_ps(fW[k], W[k]);
+			_mm256_storeu_ps(fI[k], I[k]);
+		}
+		for(int k=0; k<12; k++)
+			for(int j=0; j<iCount; j++)
+			{
+				pHier->world[k*n+idx[j]] = fW[k][j];
+				pHier->worldInv[k*n+idx[j]] = fI[k][j];
+			}
+	}
+}
+#endif
+
+
+static bool g_bAVX2Enabled = CpuSupportsAVX2();
+
+bool IsTransformHierarchyAVX2Enabled()
+{
+	return g_bAVX2Enabled;
+}
+
+int UpdateTransformHierarchy(STransformHierarchy * pHier, const bool bAllowAVX2)
+{
+	// the marked nodes and everything below them, each once
+	std::vector<int> &work = pHier->work;
+	work.swap(pHier->marked);
+	pHier->marked.clear();
+	for(int i=0; i<(int) work.size(); i++)
+	{
+		const int node = work[i];
+		const int iFirst = pHier->firstChild[node];
+		for(int c=iFirst; c<(iFirst+pHier->nrChildren[node]); c++)
+			if(pHier->dirty[c]==0)
+			{
+				pHier->dirty[c] = 1;
+				work.push_back(c);
+			}
+	}
+
+	// in node order every parent is done before its children and nodes
+	// of the same level don't depend on each other
+	std::sort(work.begin(), work.end());
+	const int iNrWork = (int) work.size();
+
+	int i=0;
+	while(i<iNrWork)
+	{
+		const int iLevel = pHier->level[work[i]];
+		int iCount = 1;
+		while(iCount<8 && (i+iCount)<iNrWork && pHier->level[work[i+iCount]]==iLevel) ++iCount;
+
+		bool bDone = false;
+#ifdef SIMD_HAS_AVX2_PATH
+		if(g_bAVX2Enabled && bAllowAVX2 && iCount>=4)
+		{
+			UpdateNodesAVX2(pHier, &work[i], iCount);
+			bDone = true;
+		}
+#endif
+		if(!bDone)
+			for(int j=0; j<iCount; j++) UpdateNodeScalar(pHier, work[i+j]);
+
+		i += iCount;
+	}
+
+	for(int j=0; j<iNrWork; j++) pHier->dirty[work[j]] = 0;
+
+	return iNrWork;
+}
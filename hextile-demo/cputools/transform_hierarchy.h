@@ -0,0 +1,60 @@
+#ifndef __TRANSFORMHIERARCHY_H__
+#define __TRANSFORMHIERARCHY_H__
+
+#include <geommath/geommath.h>
+#include <vector>
+
+// Hierarchy of affine transforms, each node with a local transform relative
+// to its parent. The nodes are stored breadth first which is a topological
+// order, parents before their children and the children of a node next to
+// each other, and the caller refers to them by the id they were built with.
+// The local, world and inverse world transforms are kept as the 12 planes
+// of their upper 3x4 block, plane r*4+c holds row r and column c of every
+// node. Changing a node marks it dirty and the next update recomputes the
+// world transform and its inverse of the dirty nodes and their descendants
+// only, 8 nodes of the same depth at a time with AVX2 when the CPU supports
+// it. Both paths produce the same bits.
+
+struct STransformHierarchy
+{
+	int iNrNodes;
+	int iMaxLevel;
+
+	// by node
+	std::vector<int> parent;					// node index or -1 for a root
+	std::vector<int> firstChild, nrChildren;
+	std::vector<int> level;						// 0 for a root
+	std::vector<int> idOfNode;
+	std::vector<unsigned char> dirty;
+
+	std::vector<int> nodeOfId;
+
+	// 12 planes of iNrNodes floats each
+	std::vector<float> local, world, worldInv;
+
+	std::vector<int> marked;					// since the last update
+	std::vector<int> work;						// the nodes updated by the last update, ascending
+};
+
+// piParent[id] is the id of the parent of node id or -1. Every node starts
+// out with the identity as its local transform and dirty. Fails when
+// a parent is out of range or the parents form a cycle.
+bool BuildTransformHierarchy(STransformHierarchy * pHier, const int piParent[], const int iNrNodes);
+
+// only the upper 3x4 block of mLocal is kept. Marks the node dirty when the
+// transform changes.
+void SetTransformLocal(STransformHierarchy * pHier, const int id, const Mat44 &mLocal);
+void GetTransformLocal(Mat44 * pmLocal, const STransformHierarchy &hier, const int id);
+void MarkTransformDirty(STransformHierarchy * pHier, const int id);
+
+// as of the last update. pmWorldToLocal may be NULL.
+void GetTransformWorld(Mat44 * pmLocToWorld, Mat44 * pmWorldToLocal, const STransformHierarchy &hier, const int id);
+
+// recomputes the dirty nodes and their descendants. Returns the number
+// of nodes updated.
+int UpdateTransformHierarchy(STransformHierarchy * pHier, const bool bAllowAVX2=true);
+
+bool IsTransformHierarchyAVX2Enabled();
+
+
+#endif
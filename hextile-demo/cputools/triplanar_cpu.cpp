@@ -0,0 +1,224 @@
+#include "triplanar_cpu.h"
+#include <meshimport/objreader.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+
+void DetermineTriplanarWeights(float res[], const float nrmBaseNormal[], const float k)
+{
+	for(int i=0; i<3; i++)
+	{
+		const float w = fabsf(nrmBaseNormal[i]) - 0.2f;
+		res[i] = powf(w>0.0f ? w : 0.0f, k);
+	}
+
+	const float fSum = res[0] + res[1] + res[2];
+	for(int i=0; i<3; i++) res[i] /= fSum;
+}
+
+void SkipTriplanarWeights(float res[], const float weights[], const float fThreshold)
+{
+	const float th = fThreshold<0.33f ? fThreshold : 0.33f;
+	for(int i=0; i<3; i++)
+	{
+		const float w = weights[i] - th;
+		res[i] = w>0.0f ? w : 0.0f;
+	}
+
+	const float fSum = res[0] + res[1] + res[2];
+	for(int i=0; i<3; i++) res[i] /= fSum;
+}
+
+int GetNrActiveProjections(const float weights[])
+{
+	return (weights[0]>0.0f ? 1 : 0) + (weights[1]>0.0f ? 1 : 0) + (weights[2]>0.0f ? 1 : 0);
+}
+
+bool TriplanarProjectionsPerThreshold(float pfAvgProjections[], const float pfThresholds[], const int iNrThresholds,
+									  const CObjReader &mesh, const float k, const int iNrSamplesPerTri)
+{
+	if(iNrThresholds<=0 || iNrSamplesPerTri<=0) return false;
+
+	std::vector<double> sums(iNrThresholds, 0.0);
+	double fTotalArea = 0.0;
+
+	for(int f=0; f<mesh.GetNumFaces(); f++)
+	{
+		const int nrVerts = mesh.GetNrFaceVertices(f);
+		for(int t=0; t<(nrVerts-2); t++)
+		{
+			const int idx[] = { 0, t+1, t+2 };
+			const Vec3 vP0 = mesh.GetFacePosition(f, idx[0]);
+			const float fArea = 0.5f*Length(Cross(mesh.GetFacePosition(f, idx[1])-vP0, mesh.GetFacePosition(f, idx[2])-vP0));
+			if(!(fArea>0.0f)) continue;
+
+			const float fSampleArea = fArea / iNrSamplesPerTri;
+			for(int s=0; s<iNrSamplesPerTri; s++)
+			{
+				// R2 low discrepancy sequence folded into the triangle
+				float u = fmodf(0.5f + s*0.7548776662f, 1.0f);
+				float v = fmodf(0.5f + s*0.5698402910f, 1.0f);
+				if((u+v)>1.0f) { u = 1.0f-u; v = 1.0f-v; }
+
+				const Vec3 vN = Normalize((1.0f-u-v)*mesh.GetFaceNormal(f, idx[0]) + u*mesh.GetFaceNormal(f, idx[1]) + v*mesh.GetFaceNormal(f, idx[2]));
+				const float n[] = { vN.x, vN.y, vN.z };
+
+				float weights[3];
+				DetermineTriplanarWeights(weights, n, k);
+				for(int i=0; i<iNrThresholds; i++)
+				{
+					float skipped[3];
+					SkipTriplanarWeights(skipped, weights, pfThresholds[i]);
+					sums[i] += fSampleArea*GetNrActiveProjections(skipped);
+				}
+			}
+
+			fTotalArea += fArea;
+		}
+	}
+
+	for(int i=0; i<iNrThresholds; i++)
+		pfAvgProjections[i] = fTotalArea>0.0 ? ((float) (sums[i] / fTotalArea)) : 0.0f;
+
+	return fTotalArea>0.0;
+}
+
+void DetermineBiplanarWeights(float res[], int axes[], const float nrmBaseNormal[], const float k)
+{
+	const float a[] = { fabsf(nrmBaseNormal[0]), fabsf(nrmBaseNormal[1]), fabsf(nrmBaseNormal[2]) };
+	const int drop = a[0]<=a[1] ? (a[0]<=a[2] ? 0 : 2) : (a[1]<=a[2] ? 1 : 2);
+	axes[0] = drop==0 ? 1 : 0;
+	axes[1] = drop==2 ? 1 : 2;
+
+	for(int i=0; i<2; i++)
+	{
+		const float w = a[axes[i]] - a[drop];
+		res[i] = powf(w>0.0f ? w : 0.0f, k) + 1e-20f;
+	}
+
+	const float fSum = res[0] + res[1];
+	for(int i=0; i<2; i++) res[i] /= fSum;
+}
+
+// biplanar weights scattered to all three axes, zero for the dropped one
+static void BiplanarWeights3(float res[], const float n[], const float k)
+{
+	float w[2]; int axes[2];
+	DetermineBiplanarWeights(w, axes, n, k);
+	res[0] = res[1] = res[2] = 0.0f;
+	res[axes[0]] = w[0]; res[axes[1]] = w[1];
+}
+
+static float RandUnit(unsigned int * puSeed)
+{
+	*puSeed = (*puSeed)*1664525u + 1013904223u;
+	return ((*puSeed)>>8) / 16777216.0f;
+}
+
+static void RandDir(float v[], unsigned int * puSeed)
+{
+	const float z = 2.0f*RandUnit(puSeed) - 1.0f;
+	const float phi = 6.2831853f*RandUnit(puSeed);
+	const float r = sqrtf(1.0f - z*z>0.0f ? 1.0f - z*z : 0.0f);
+	v[0] = r*cosf(phi); v[1] = r*sinf(phi); v[2] = z;
+}
+
+static float ComponentGap(const float n[])
+{
+	const float a[] = { fabsf(n[0]), fabsf(n[1]), fabsf(n[2]) };
+	return fmaxf(a[0], fmaxf(a[1], a[2])) - fminf(a[0], fminf(a[1], a[2]));
+}
+
+bool BiplanarReport(SBiplanarReport * pReport, const int iNrPaths, const float k, const float fCornerGap)
+{
+	memset(pReport, 0, sizeof(SBiplanarReport));
+	if(iNrPaths<=0) return false;
+
+	pReport->fStep[0] = 0.01f;
+	pReport->fStep[1] = 0.5f*pReport->fStep[0];
+	pReport->fCornerGap = fCornerGap;
+
+	// walk great circles through random normals with two step sizes
+	for(int s=0; s<2; s++)
+	{
+		unsigned int uSeed = 0x2545f491u;
+		const float fStep = pReport->fStep[s];
+		const int iNrSteps = (int) (6.2831853f/fStep) + 1;
+		for(int p=0; p<iNrPaths; p++)
+		{
+			float u[3], v[3], t[3];
+			RandDir(u, &uSeed); RandDir(t, &uSeed);
+
+			// v orthonormal to u
+			const float d = u[0]*t[0] + u[1]*t[1] + u[2]*t[2];
+			for(int i=0; i<3; i++) v[i] = t[i] - d*u[i];
+			const float len = sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+			if(!(len>1e-4f)) continue;
+			for(int i=0; i<3; i++) v[i] /= len;
+
+			float prev[3] = { 0.0f, 0.0f, 0.0f };
+			bool bPrevCorner = true;
+			for(int j=0; j<iNrSteps; j++)
+			{
+				const float cs = cosf(j*fStep), si = sinf(j*fStep);
+				const float n[] = { cs*u[0] + si*v[0], cs*u[1] + si*v[1], cs*u[2] + si*v[2] };
+
+				float w[3];
+				BiplanarWeights3(w, n, k);
+				const bool bCorner = ComponentGap(n)<fCornerGap;
+				if(!bCorner && !bPrevCorner)
+				{
+					for(int i=0; i<3; i++)
+					{
+						const float fJump = fabsf(w[i]-prev[i]);
+						if(fJump>pReport->fMaxJump[s]) pReport->fMaxJump[s] = fJump;
+						if(s==1 && w[i]==0.0f && prev[i]>pReport->fMaxWeightAtSwap) pReport->fMaxWeightAtSwap = prev[i];
+					}
+				}
+
+				for(int i=0; i<3; i++) prev[i] = w[i];
+				bPrevCorner = bCorner;
+			}
+		}
+	}
+
+	// cost of both weight functions over the same set of normals
+	const int iNrNormals = 1<<16;
+	std::vector<float> normals(3*iNrNormals);
+	unsigned int uSeed = 0x9e3779b9u;
+	for(int i=0; i<iNrNormals; i++) RandDir(&normals[3*i], &uSeed);
+
+	int nrTriProjections = 0, nrCorner = 0;
+	for(int i=0; i<iNrNormals; i++)
+		if(ComponentGap(&normals[3*i])<fCornerGap) ++nrCorner;
+
+	volatile float fSink = 0.0f;
+	float fAcc = 0.0f;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for(int i=0; i<iNrNormals; i++)
+	{
+		float w[3];
+		DetermineTriplanarWeights(w, &normals[3*i], k);
+		fAcc += w[0];
+		nrTriProjections += GetNrActiveProjections(w);
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for(int i=0; i<iNrNormals; i++)
+	{
+		float w[2]; int axes[2];
+		DetermineBiplanarWeights(w, axes, &normals[3*i], k);
+		fAcc += w[0];
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	fSink = fAcc;
+	(void) fSink;
+
+	pReport->fNsTriplanar = (float) (std::chrono::duration<double, std::nano>(t1-t0).count() / iNrNormals);
+	pReport->fNsBiplanar = (float) (std::chrono::duration<double, std::nano>(t2-t1).count() / iNrNormals);
+	pReport->fAvgTriplanarProjections = ((float) nrTriProjections) / iNrNormals;
+	pReport->fCornerArea = ((float) nrCorner) / iNrNormals;
+
+	return true;
+}
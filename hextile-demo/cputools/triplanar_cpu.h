@@ -0,0 +1,56 @@
+#ifndef __TRIPLANARCPU_H__
+#define __TRIPLANARCPU_H__
+
+class CObjReader;
+
+// C++ reference of the triplanar projection weights used by
+// CommonTriplanarColor() and CommonTriplanarNormal() in shader_lighting.hlsl.
+
+// port of DetermineTriplanarWeights() in surfgrad_framework.h
+void DetermineTriplanarWeights(float res[], const float nrmBaseNormal[], const float k=3.0f);
+
+// port of SkipTriplanarWeights(). Subtracts fThreshold from every weight
+// and renormalizes, so a projection fades out continuously and its weight is
+// exactly zero, and the fetch skipped, once it drops below fThreshold.
+// Thresholds above 1/3 are clamped since at least one weight is >= 1/3.
+void SkipTriplanarWeights(float res[], const float weights[], const float fThreshold);
+
+int GetNrActiveProjections(const float weights[]);
+
+// Expected number of projections fetched per pixel for each threshold, given
+// the normals of a mesh. Pixels are approximated by surface area, sampling
+// every triangle at iNrSamplesPerTri points with interpolated normals. Quads
+// straddling a boundary fetch the union of their projections in the shader
+// so this is a lower bound which gets tight as pixels get small.
+bool TriplanarProjectionsPerThreshold(float pfAvgProjections[], const float pfThresholds[], const int iNrThresholds,
+									  const CObjReader &mesh, const float k=3.0f, const int iNrSamplesPerTri=16);
+
+// port of DetermineBiplanarWeights(). axes[] receives the two kept axes in
+// increasing order and res[] their weights.
+void DetermineBiplanarWeights(float res[], int axes[], const float nrmBaseNormal[], const float k=3.0f);
+
+struct SBiplanarReport
+{
+	// largest change of any plane weight between consecutive normals along
+	// random great circles, for angular step fStep[0] and fStep[1]=fStep[0]/2.
+	// Continuous weights halve the jump along with the step. Where the three
+	// components of the normal are equal no choice of dropped axis can be
+	// continuous so steps where max-min of |n| is below fCornerGap are left
+	// out. fCornerArea is the fraction of the sphere this excludes.
+	float fMaxJump[2], fStep[2];
+	float fCornerGap, fCornerArea;
+
+	// largest weight held by a plane in the step before it gets dropped
+	float fMaxWeightAtSwap;
+
+	// cost in nanoseconds per normal of each weight function
+	float fNsTriplanar, fNsBiplanar;
+
+	// expected number of projections triplanar fetches for uniform normals
+	float fAvgTriplanarProjections;
+};
+
+bool BiplanarReport(SBiplanarReport * pReport, const int iNrPaths=1000, const float k=3.0f, const float fCornerGap=0.1f);
+
+
+#endif
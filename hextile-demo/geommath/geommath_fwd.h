@@ -0,0 +1,25 @@
+#ifndef __GEOMMATH_FWD_H__
+#define __GEOMMATH_FWD_H__
+
+// forward declarations of the geommath types. The library is header-only
+// and templated on the scalar type. Vec3, Vec4, Mat33 and Mat44 remain the
+// single precision instances used throughout the demo.
+
+template<class T> struct TVec3;
+template<class T> struct TVec4;
+template<class T> struct TMat33;
+template<class T> struct TMat44;
+
+typedef TVec3<float>	Vec3;
+typedef TVec4<float>	Vec4;
+typedef TMat33<float>	Mat33;
+typedef TMat44<float>	Mat44;
+
+typedef TVec3<double>	Vec3d;
+typedef TVec4<double>	Vec4d;
+typedef TMat33<double>	Mat33d;
+typedef TMat44<double>	Mat44d;
+
+struct Quat;
+
+#endif
@@ -1,37 +1,170 @@
 #ifndef __MAT33_H__
 #define __MAT33_H__
 
-struct Vec3;
-struct Quat;
+#include "geommath_fwd.h"
+#include "vec3.h"
+#include <cmath>
 
-struct Mat33
+
+// column major, element (row,col) is m_fMat[row+col*3]
+template<class T> struct TMat33
 {
-	Mat33() {}
-	Mat33( const Mat33 &m );
+	typedef T Scalar;
+
+	TMat33() = default;
+	TMat33( const TMat33 &m ) = default;
+
+	TMat33& operator =( const TMat33 &m ) = default;
+
+
+	friend constexpr const TVec3<T>	operator *( const TMat33 &m, const TVec3<T> &v )
+	{
+		return TVec3<T>(m.m_fMat[0+0*3]*v.x + m.m_fMat[0+1*3]*v.y + m.m_fMat[0+2*3]*v.z,
+						m.m_fMat[1+0*3]*v.x + m.m_fMat[1+1*3]*v.y + m.m_fMat[1+2*3]*v.z,
+						m.m_fMat[2+0*3]*v.x + m.m_fMat[2+1*3]*v.y + m.m_fMat[2+2*3]*v.z);
+	}
+
+	friend constexpr const TMat33	operator *( const TMat33 &m1, const TMat33 &m2 )
+	{
+		TMat33 r{};
+
+		for(int iCol = 0; iCol < 3; iCol++)
+		{
+			r.m_fMat[0+iCol*3] = m1.m_fMat[0+0*3]*m2.m_fMat[0+iCol*3] + m1.m_fMat[0+1*3]*m2.m_fMat[1+iCol*3] + m1.m_fMat[0+2*3]*m2.m_fMat[2+iCol*3];
+			r.m_fMat[1+iCol*3] = m1.m_fMat[1+0*3]*m2.m_fMat[0+iCol*3] + m1.m_fMat[1+1*3]*m2.m_fMat[1+iCol*3] + m1.m_fMat[1+2*3]*m2.m_fMat[2+iCol*3];
+			r.m_fMat[2+iCol*3] = m1.m_fMat[2+0*3]*m2.m_fMat[0+iCol*3] + m1.m_fMat[2+1*3]*m2.m_fMat[1+iCol*3] + m1.m_fMat[2+2*3]*m2.m_fMat[2+iCol*3];
+		}
+
+		return r;
+	}
+
+	friend constexpr TMat33&		operator *=( TMat33 &m1, const TMat33 &m2 )
+	{
+		m1 = m2 * m1;		// We add m2 to the heap of transformations
+
+		return m1;
+	}
 
+	friend constexpr const TMat33	operator ~( const TMat33 &m )
+	{
+		TMat33 r{};
 
-	float m_fMat[3*3];
+		const T s = 1 / Determinant( m );
+
+		r.m_fMat[0+0*3] = s * (m.m_fMat[1+1*3]*m.m_fMat[2+2*3] - m.m_fMat[1+2*3]*m.m_fMat[2+1*3]);
+		r.m_fMat[0+1*3] = -s * (m.m_fMat[0+1*3]*m.m_fMat[2+2*3] - m.m_fMat[0+2*3]*m.m_fMat[2+1*3]);
+		r.m_fMat[0+2*3] = s * (m.m_fMat[0+1*3]*m.m_fMat[1+2*3] - m.m_fMat[0+2*3]*m.m_fMat[1+1*3]);
+
+		r.m_fMat[1+0*3] = -s * (m.m_fMat[1+0*3]*m.m_fMat[2+2*3] - m.m_fMat[1+2*3]*m.m_fMat[2+0*3]);
+		r.m_fMat[1+1*3] = s * (m.m_fMat[0+0*3]*m.m_fMat[2+2*3] - m.m_fMat[0+2*3]*m.m_fMat[2+0*3]);
+		r.m_fMat[1+2*3] = -s * (m.m_fMat[0+0*3]*m.m_fMat[1+2*3] - m.m_fMat[0+2*3]*m.m_fMat[1+0*3]);
+
+		r.m_fMat[2+0*3] = s * (m.m_fMat[1+0*3]*m.m_fMat[2+1*3] - m.m_fMat[1+1*3]*m.m_fMat[2+0*3]);
+		r.m_fMat[2+1*3] = -s * (m.m_fMat[0+0*3]*m.m_fMat[2+1*3] - m.m_fMat[0+1*3]*m.m_fMat[2+0*3]);
+		r.m_fMat[2+2*3] = s * (m.m_fMat[0+0*3]*m.m_fMat[1+1*3] - m.m_fMat[0+1*3]*m.m_fMat[1+0*3]);
+
+		return r;
+	}
+
+
+	T m_fMat[3*3];
 };
 
 
-const Vec3	operator *( const Mat33 &m, const Vec3 &v );
-const Mat33	operator *( const Mat33 &m1, const Mat33 &m2 );
-Mat33&		operator *=( Mat33 &m1, const Mat33 &m2 );
+template<class T> constexpr T				Determinant( const TMat33<T> &m )
+{
+	return m.m_fMat[0+0*3]*(m.m_fMat[1+1*3]*m.m_fMat[2+2*3] - m.m_fMat[1+2*3]*m.m_fMat[2+1*3]) -
+		   m.m_fMat[0+1*3]*(m.m_fMat[1+0*3]*m.m_fMat[2+2*3] - m.m_fMat[1+2*3]*m.m_fMat[2+0*3]) +
+		   m.m_fMat[0+2*3]*(m.m_fMat[1+0*3]*m.m_fMat[2+1*3] - m.m_fMat[1+1*3]*m.m_fMat[2+0*3]);
+}
+
+template<class T> constexpr const TMat33<T>	Transpose( const TMat33<T> &m )
+{
+	TMat33<T> r{};
+
+	for(int iCol = 0; iCol < 3; iCol++)
+		for(int iRow = 0; iRow < 3; iRow++)
+			r.m_fMat[iRow+iCol*3] = m.m_fMat[iCol+iRow*3];
+
+	return r;
+}
+
+
+template<class T> constexpr void			LoadIdentity( TMat33<T> * pM )
+{
+	for(int iCol = 0; iCol < 3; iCol++)
+		for(int iRow = 0; iRow < 3; iRow++)
+			pM->m_fMat[iRow+iCol*3] = iRow==iCol ? 1 : 0;
+}
+
+// YXZ * p	(Z first)
+template<class T> inline void				LoadRotation( TMat33<T> * pM, const typename TMat33<T>::Scalar fX, const typename TMat33<T>::Scalar fY, const typename TMat33<T>::Scalar fZ )
+{
+	const T fCx = std::cos(fX), fSx = std::sin(fX);
+	const T fCy = std::cos(fY), fSy = std::sin(fY);
+	const T fCz = std::cos(fZ), fSz = std::sin(fZ);
+
+	pM->m_fMat[0+0*3] = fSz*fSx*fSy + fCz*fCy;
+	pM->m_fMat[1+0*3] = fSz*fCx;
+	pM->m_fMat[2+0*3] = fSz*fSx*fCy - fCz*fSy;
+
+	pM->m_fMat[0+1*3] = fCz*fSx*fSy - fSz*fCy;
+	pM->m_fMat[1+1*3] = fCz*fCx;
+	pM->m_fMat[2+1*3] = fCz*fSx*fCy + fSz*fSy;
+
+	pM->m_fMat[0+2*3] = fCx*fSy;
+	pM->m_fMat[1+2*3] = -fSx;
+	pM->m_fMat[2+2*3] = fCx*fCy;
+}
+
+template<class T> inline void				LoadRotationAxisAngle( TMat33<T> * pM, const TVec3<typename TMat33<T>::Scalar> &v, const typename TMat33<T>::Scalar fAngle )
+{
+	const T C = std::cos(fAngle), S = std::sin(fAngle);
+	const T x2 = v.x*v.x, y2 = v.y*v.y, z2 = v.z*v.z;
+	const T xs = v.x*S, ys = v.y*S, zs = v.z*S;
+	const T xyOneMinusC = v.x*v.y*(1-C);
+	const T zxOneMinusC = v.z*v.x*(1-C);
+	const T yzOneMinusC = v.y*v.z*(1-C);
+
+	pM->m_fMat[0+0*3] = x2 + C*(1-x2);
+	pM->m_fMat[1+0*3] = xyOneMinusC + zs;
+	pM->m_fMat[2+0*3] = zxOneMinusC - ys;
+
+	pM->m_fMat[0+1*3] = xyOneMinusC - zs;
+	pM->m_fMat[1+1*3] = y2 + C*(1-y2);
+	pM->m_fMat[2+1*3] = yzOneMinusC + xs;
+
+	pM->m_fMat[0+2*3] = zxOneMinusC + ys;
+	pM->m_fMat[1+2*3] = yzOneMinusC - xs;
+	pM->m_fMat[2+2*3] = z2 + C*(1-z2);
+}
+
 
-const Mat33	operator ~( const Mat33 &m );
-float		Determinant( const Mat33 &m );
-const Mat33	Transpose( const Mat33 &m );
+template<class T> constexpr void			SetRow( TMat33<T> * pM, int iRow, const TVec3<typename TMat33<T>::Scalar> &v )
+{
+	pM->m_fMat[iRow+0*3] = v.x;
+	pM->m_fMat[iRow+1*3] = v.y;
+	pM->m_fMat[iRow+2*3] = v.z;
+}
 
-void		LoadIdentity(Mat33 * pM);
-void		LoadRotation(Mat33 * pM, const Quat &Q );
-void		LoadRotation(Mat33 * pM, const float fX, const float fY, const float fZ );
-void		LoadRotationAxisAngle(Mat33 * pM, const Vec3 &v, const float fAngle );
+template<class T> constexpr const TVec3<T>	GetRow( const TMat33<T> &m, int iRow )
+{
+	return TVec3<T>(m.m_fMat[iRow+0*3], m.m_fMat[iRow+1*3], m.m_fMat[iRow+2*3]);
+}
 
-void		SetRow(Mat33 * pM, int iRow, const Vec3 &v );
-const Vec3	GetRow(const Mat33 &m, int iRow );
-void		SetColumn(Mat33 * pM, int iColumn, const Vec3 &v );
-const Vec3	GetColumn(const Mat33 &m, int iColumn );
+template<class T> constexpr void			SetColumn( TMat33<T> * pM, int iColumn, const TVec3<typename TMat33<T>::Scalar> &v )
+{
+	pM->m_fMat[0+iColumn*3] = v.x;
+	pM->m_fMat[1+iColumn*3] = v.y;
+	pM->m_fMat[2+iColumn*3] = v.z;
+}
+
+template<class T> constexpr const TVec3<T>	GetColumn( const TMat33<T> &m, int iColumn )
+{
+	return TVec3<T>(m.m_fMat[0+iColumn*3], m.m_fMat[1+iColumn*3], m.m_fMat[2+iColumn*3]);
+}
 
+// LoadRotation(Mat33 *, const Quat &) is declared in quaternion.h
 
 
 #endif
@@ -1,36 +1,236 @@
 #ifndef __MAT44_H__
 #define __MAT44_H__
 
-struct Vec3;
-struct Vec4;
-struct Quat;
+#include "geommath_fwd.h"
+#include "vec3.h"
+#include "vec4.h"
+#include <cmath>
 
-struct Mat44
+
+// column major, element (row,col) is m_fMat[row+col*4]
+template<class T> struct TMat44
 {
-	Mat44() {}
-	Mat44( const Mat44 &m );
+	typedef T Scalar;
+
+	TMat44() = default;
+	TMat44( const TMat44 &m ) = default;
+
+	TMat44& operator =( const TMat44 &m ) = default;
+
+
+	friend constexpr const TVec4<T>	operator *( const TMat44 &m, const TVec4<T> &v )
+	{
+		return TVec4<T>(m.m_fMat[0+0*4]*v.x + m.m_fMat[0+1*4]*v.y + m.m_fMat[0+2*4]*v.z + m.m_fMat[0+3*4]*v.w,
+						m.m_fMat[1+0*4]*v.x + m.m_fMat[1+1*4]*v.y + m.m_fMat[1+2*4]*v.z + m.m_fMat[1+3*4]*v.w,
+						m.m_fMat[2+0*4]*v.x + m.m_fMat[2+1*4]*v.y + m.m_fMat[2+2*4]*v.z + m.m_fMat[2+3*4]*v.w,
+						m.m_fMat[3+0*4]*v.x + m.m_fMat[3+1*4]*v.y + m.m_fMat[3+2*4]*v.z + m.m_fMat[3+3*4]*v.w);
+	}
+
+	friend constexpr const TMat44	operator *( const TMat44 &m1, const TMat44 &m2 )
+	{
+		TMat44 r{};
+
+		for(int iCol = 0; iCol < 4; iCol++)
+		{
+			r.m_fMat[0+iCol*4] = m1.m_fMat[0+0*4]*m2.m_fMat[0+iCol*4] + m1.m_fMat[0+1*4]*m2.m_fMat[1+iCol*4] + m1.m_fMat[0+2*4]*m2.m_fMat[2+iCol*4] + m1.m_fMat[0+3*4]*m2.m_fMat[3+iCol*4];
+			r.m_fMat[1+iCol*4] = m1.m_fMat[1+0*4]*m2.m_fMat[0+iCol*4] + m1.m_fMat[1+1*4]*m2.m_fMat[1+iCol*4] + m1.m_fMat[1+2*4]*m2.m_fMat[2+iCol*4] + m1.m_fMat[1+3*4]*m2.m_fMat[3+iCol*4];
+			r.m_fMat[2+iCol*4] = m1.m_fMat[2+0*4]*m2.m_fMat[0+iCol*4] + m1.m_fMat[2+1*4]*m2.m_fMat[1+iCol*4] + m1.m_fMat[2+2*4]*m2.m_fMat[2+iCol*4] + m1.m_fMat[2+3*4]*m2.m_fMat[3+iCol*4];
+			r.m_fMat[3+iCol*4] = m1.m_fMat[3+0*4]*m2.m_fMat[0+iCol*4] + m1.m_fMat[3+1*4]*m2.m_fMat[1+iCol*4] + m1.m_fMat[3+2*4]*m2.m_fMat[2+iCol*4] + m1.m_fMat[3+3*4]*m2.m_fMat[3+iCol*4];
+		}
+
+		return r;
+	}
+
+	friend constexpr TMat44&		operator *=( TMat44 &m1, const TMat44 &m2 )
+	{
+		m1 = m2 * m1;		// We add m2 to the heap of transformations
+
+		return m1;
+	}
+
+	friend constexpr const TMat44	operator ~( const TMat44 &m )
+	{
+		TMat44 r{};
+
+		const T f22Det1  = m.m_fMat[2+2*4]*m.m_fMat[3+3*4] - m.m_fMat[2+3*4]*m.m_fMat[3+2*4];
+		const T f22Det2  = m.m_fMat[2+1*4]*m.m_fMat[3+3*4] - m.m_fMat[2+3*4]*m.m_fMat[3+1*4];
+		const T f22Det3  = m.m_fMat[2+1*4]*m.m_fMat[3+2*4] - m.m_fMat[2+2*4]*m.m_fMat[3+1*4];
+		const T f22Det4  = m.m_fMat[2+0*4]*m.m_fMat[3+3*4] - m.m_fMat[2+3*4]*m.m_fMat[3+0*4];
+		const T f22Det5  = m.m_fMat[2+0*4]*m.m_fMat[3+2*4] - m.m_fMat[2+2*4]*m.m_fMat[3+0*4];
+		const T f22Det6  = m.m_fMat[2+0*4]*m.m_fMat[3+1*4] - m.m_fMat[2+1*4]*m.m_fMat[3+0*4];
+		const T f22Det7  = m.m_fMat[1+2*4]*m.m_fMat[3+3*4] - m.m_fMat[1+3*4]*m.m_fMat[3+2*4];
+		const T f22Det8  = m.m_fMat[1+1*4]*m.m_fMat[3+3*4] - m.m_fMat[1+3*4]*m.m_fMat[3+1*4];
+		const T f22Det9  = m.m_fMat[1+1*4]*m.m_fMat[3+2*4] - m.m_fMat[1+2*4]*m.m_fMat[3+1*4];
+		const T f22Det10 = m.m_fMat[1+2*4]*m.m_fMat[2+3*4] - m.m_fMat[1+3*4]*m.m_fMat[2+2*4];
+		const T f22Det11 = m.m_fMat[1+1*4]*m.m_fMat[2+3*4] - m.m_fMat[1+3*4]*m.m_fMat[2+1*4];
+		const T f22Det12 = m.m_fMat[1+1*4]*m.m_fMat[2+2*4] - m.m_fMat[1+2*4]*m.m_fMat[2+1*4];
+		const T f22Det13 = m.m_fMat[1+0*4]*m.m_fMat[3+3*4] - m.m_fMat[1+3*4]*m.m_fMat[3+0*4];
+		const T f22Det14 = m.m_fMat[1+0*4]*m.m_fMat[3+2*4] - m.m_fMat[1+2*4]*m.m_fMat[3+0*4];
+		const T f22Det15 = m.m_fMat[1+0*4]*m.m_fMat[2+3*4] - m.m_fMat[1+3*4]*m.m_fMat[2+0*4];
+		const T f22Det16 = m.m_fMat[1+0*4]*m.m_fMat[2+2*4] - m.m_fMat[1+2*4]*m.m_fMat[2+0*4];
+		const T f22Det17 = m.m_fMat[1+0*4]*m.m_fMat[3+1*4] - m.m_fMat[1+1*4]*m.m_fMat[3+0*4];
+		const T f22Det18 = m.m_fMat[1+0*4]*m.m_fMat[2+1*4] - m.m_fMat[1+1*4]*m.m_fMat[2+0*4];
+
+		const T fFirst33Det  = m.m_fMat[1+1*4]*f22Det1 - m.m_fMat[1+2*4]*f22Det2 + m.m_fMat[1+3*4]*f22Det3;
+		const T fSec33Det    = m.m_fMat[1+0*4]*f22Det1 - m.m_fMat[1+2*4]*f22Det4 + m.m_fMat[1+3*4]*f22Det5;
+		const T fThird33Det  = m.m_fMat[1+0*4]*f22Det2 - m.m_fMat[1+1*4]*f22Det4 + m.m_fMat[1+3*4]*f22Det6;
+		const T fFourth33Det = m.m_fMat[1+0*4]*f22Det3 - m.m_fMat[1+1*4]*f22Det5 + m.m_fMat[1+2*4]*f22Det6;
 
+		const T fDet44 = m.m_fMat[0+0*4]*fFirst33Det - m.m_fMat[0+1*4]*fSec33Det + m.m_fMat[0+2*4]*fThird33Det - m.m_fMat[0+3*4]*fFourth33Det;
 
-	float m_fMat[4*4];
+		const T s = 1 / fDet44;
+
+		r.m_fMat[0+0*4] = s * fFirst33Det;
+		r.m_fMat[0+1*4] = -s * ( m.m_fMat[0+1*4]*f22Det1 - m.m_fMat[0+2*4]*f22Det2 + m.m_fMat[0+3*4]*f22Det3 );
+		r.m_fMat[0+2*4] = s * ( m.m_fMat[0+1*4]*f22Det7 - m.m_fMat[0+2*4]*f22Det8 + m.m_fMat[0+3*4]*f22Det9 );
+		r.m_fMat[0+3*4] = -s * ( m.m_fMat[0+1*4]*f22Det10 - m.m_fMat[0+2*4]*f22Det11 + m.m_fMat[0+3*4]*f22Det12 );
+
+		r.m_fMat[1+0*4] = -s * fSec33Det;
+		r.m_fMat[1+1*4] = s * ( m.m_fMat[0+0*4]*f22Det1 - m.m_fMat[0+2*4]*f22Det4 + m.m_fMat[0+3*4]*f22Det5 );
+		r.m_fMat[1+2*4] = -s * ( m.m_fMat[0+0*4]*f22Det7 - m.m_fMat[0+2*4]*f22Det13 + m.m_fMat[0+3*4]*f22Det14 );
+		r.m_fMat[1+3*4] = s * ( m.m_fMat[0+0*4]*f22Det10 - m.m_fMat[0+2*4]*f22Det15 + m.m_fMat[0+3*4]*f22Det16 );
+
+		r.m_fMat[2+0*4] = s * fThird33Det;
+		r.m_fMat[2+1*4] = -s * ( m.m_fMat[0+0*4]*f22Det2 - m.m_fMat[0+1*4]*f22Det4 + m.m_fMat[0+3*4]*f22Det6 );
+		r.m_fMat[2+2*4] = s * ( m.m_fMat[0+0*4]*f22Det8 - m.m_fMat[0+1*4]*f22Det13 + m.m_fMat[0+3*4]*f22Det17 );
+		r.m_fMat[2+3*4] = -s * ( m.m_fMat[0+0*4]*f22Det11 - m.m_fMat[0+1*4]*f22Det15 + m.m_fMat[0+3*4]*f22Det18 );
+
+		r.m_fMat[3+0*4] = -s * fFourth33Det;
+		r.m_fMat[3+1*4] = s * ( m.m_fMat[0+0*4]*f22Det3 - m.m_fMat[0+1*4]*f22Det5 + m.m_fMat[0+2*4]*f22Det6 );
+		r.m_fMat[3+2*4] = -s * ( m.m_fMat[0+0*4]*f22Det9 - m.m_fMat[0+1*4]*f22Det14 + m.m_fMat[0+2*4]*f22Det17 );
+		r.m_fMat[3+3*4] = s * ( m.m_fMat[0+0*4]*f22Det12 - m.m_fMat[0+1*4]*f22Det16 + m.m_fMat[0+2*4]*f22Det18 );
+
+		return r;
+	}
+
+
+	T m_fMat[4*4];
 };
 
 
-const Vec4	operator *( const Mat44 &m, const Vec4 &v );
-const Mat44	operator *( const Mat44 &m1, const Mat44 &m2 );
-Mat44&		operator *=( Mat44 &m1, const Mat44 &m2 );
+template<class T> constexpr T				Determinant( const TMat44<T> &m )
+{
+	const T f22Det1  = m.m_fMat[2+2*4]*m.m_fMat[3+3*4] - m.m_fMat[2+3*4]*m.m_fMat[3+2*4];
+	const T f22Det2  = m.m_fMat[2+1*4]*m.m_fMat[3+3*4] - m.m_fMat[2+3*4]*m.m_fMat[3+1*4];
+	const T f22Det3  = m.m_fMat[2+1*4]*m.m_fMat[3+2*4] - m.m_fMat[2+2*4]*m.m_fMat[3+1*4];
+	const T f22Det4  = m.m_fMat[2+0*4]*m.m_fMat[3+3*4] - m.m_fMat[2+3*4]*m.m_fMat[3+0*4];
+	const T f22Det5  = m.m_fMat[2+0*4]*m.m_fMat[3+2*4] - m.m_fMat[2+2*4]*m.m_fMat[3+0*4];
+	const T f22Det6  = m.m_fMat[2+0*4]*m.m_fMat[3+1*4] - m.m_fMat[2+1*4]*m.m_fMat[3+0*4];
+
+	const T fFirst33Det  = m.m_fMat[1+1*4]*f22Det1 - m.m_fMat[1+2*4]*f22Det2 + m.m_fMat[1+3*4]*f22Det3;
+	const T fSec33Det    = m.m_fMat[1+0*4]*f22Det1 - m.m_fMat[1+2*4]*f22Det4 + m.m_fMat[1+3*4]*f22Det5;
+	const T fThird33Det  = m.m_fMat[1+0*4]*f22Det2 - m.m_fMat[1+1*4]*f22Det4 + m.m_fMat[1+3*4]*f22Det6;
+	const T fFourth33Det = m.m_fMat[1+0*4]*f22Det3 - m.m_fMat[1+1*4]*f22Det5 + m.m_fMat[1+2*4]*f22Det6;
+
+
+	return m.m_fMat[0+0*4]*fFirst33Det - m.m_fMat[0+1*4]*fSec33Det + m.m_fMat[0+2*4]*fThird33Det - m.m_fMat[0+3*4]*fFourth33Det;
+}
+
+template<class T> constexpr const TMat44<T>	Transpose( const TMat44<T> &m )
+{
+	TMat44<T> r{};
 
-const Mat44	operator ~( const Mat44 &m );
-float		Determinant( const Mat44 &m );
-const Mat44	Transpose( const Mat44 &m );
+	for(int iCol = 0; iCol < 4; iCol++)
+		for(int iRow = 0; iRow < 4; iRow++)
+			r.m_fMat[iRow+iCol*4] = m.m_fMat[iCol+iRow*4];
+
+	return r;
+}
+
+
+template<class T> constexpr void			LoadIdentity( TMat44<T> * pM )
+{
+	for(int iCol = 0; iCol < 4; iCol++)
+		for(int iRow = 0; iRow < 4; iRow++)
+			pM->m_fMat[iRow+iCol*4] = iRow==iCol ? 1 : 0;
+}
+
+// YXZ * p	(Z first)
+template<class T> inline void				LoadRotation( TMat44<T> * pM, const typename TMat44<T>::Scalar fX, const typename TMat44<T>::Scalar fY, const typename TMat44<T>::Scalar fZ )
+{
+	const T fCx = std::cos(fX), fSx = std::sin(fX);
+	const T fCy = std::cos(fY), fSy = std::sin(fY);
+	const T fCz = std::cos(fZ), fSz = std::sin(fZ);
+
+	pM->m_fMat[0+0*4] = fSz*fSx*fSy + fCz*fCy;
+	pM->m_fMat[1+0*4] = fSz*fCx;
+	pM->m_fMat[2+0*4] = fSz*fSx*fCy - fCz*fSy;
+	pM->m_fMat[3+0*4] = 0;
+
+	pM->m_fMat[0+1*4] = fCz*fSx*fSy - fSz*fCy;
+	pM->m_fMat[1+1*4] = fCz*fCx;
+	pM->m_fMat[2+1*4] = fCz*fSx*fCy + fSz*fSy;
+	pM->m_fMat[3+1*4] = 0;
+
+	pM->m_fMat[0+2*4] = fCx*fSy;
+	pM->m_fMat[1+2*4] = -fSx;
+	pM->m_fMat[2+2*4] = fCx*fCy;
+	pM->m_fMat[3+2*4] = 0;
+
+	pM->m_fMat[0+3*4] = 0;
+	pM->m_fMat[1+3*4] = 0;
+	pM->m_fMat[2+3*4] = 0;
+	pM->m_fMat[3+3*4] = 1;
+}
+
+template<class T> inline void				LoadRotationAxisAngle( TMat44<T> * pM, const TVec3<typename TMat44<T>::Scalar> &v, const typename TMat44<T>::Scalar fAngle )
+{
+	const T C = std::cos(fAngle), S = std::sin(fAngle);
+	const T x2 = v.x*v.x, y2 = v.y*v.y, z2 = v.z*v.z;
+	const T xs = v.x*S, ys = v.y*S, zs = v.z*S;
+	const T xyOneMinusC = v.x*v.y*(1-C);
+	const T zxOneMinusC = v.z*v.x*(1-C);
+	const T yzOneMinusC = v.y*v.z*(1-C);
+
+	pM->m_fMat[0+0*4] = x2 + C*(1-x2);
+	pM->m_fMat[1+0*4] = xyOneMinusC + zs;
+	pM->m_fMat[2+0*4] = zxOneMinusC - ys;
+	pM->m_fMat[3+0*4] = 0;
+
+	pM->m_fMat[0+1*4] = xyOneMinusC - zs;
+	pM->m_fMat[1+1*4] = y2 + C*(1-y2);
+	pM->m_fMat[2+1*4] = yzOneMinusC + xs;
+	pM->m_fMat[3+1*4] = 0;
+
+	pM->m_fMat[0+2*4] = zxOneMinusC + ys;
+	pM->m_fMat[1+2*4] = yzOneMinusC - xs;
+	pM->m_fMat[2+2*4] = z2 + C*(1-z2);
+	pM->m_fMat[3+2*4] = 0;
+
+	pM->m_fMat[0+3*4] = 0;
+	pM->m_fMat[1+3*4] = 0;
+	pM->m_fMat[2+3*4] = 0;
+	pM->m_fMat[3+3*4] = 1;
+}
+
+
+template<class T> constexpr void			SetRow( TMat44<T> * pM, int iRow, const TVec4<typename TMat44<T>::Scalar> &v )
+{
+	pM->m_fMat[iRow+0*4] = v.x;
+	pM->m_fMat[iRow+1*4] = v.y;
+	pM->m_fMat[iRow+2*4] = v.z;
+	pM->m_fMat[iRow+3*4] = v.w;
+}
+
+template<class T> constexpr const TVec4<T>	GetRow( const TMat44<T> &m, int iRow )
+{
+	return TVec4<T>(m.m_fMat[iRow+0*4], m.m_fMat[iRow+1*4], m.m_fMat[iRow+2*4], m.m_fMat[iRow+3*4]);
+}
+
+template<class T> constexpr void			SetColumn( TMat44<T> * pM, int iColumn, const TVec4<typename TMat44<T>::Scalar> &v )
+{
+	pM->m_fMat[0+iColumn*4] = v.x;
+	pM->m_fMat[1+iColumn*4] = v.y;
+	pM->m_fMat[2+iColumn*4] = v.z;
+	pM->m_fMat[3+iColumn*4] = v.w;
+}
+
+template<class T> constexpr const TVec4<T>	GetColumn( const TMat44<T> &m, int iColumn )
+{
+	return TVec4<T>(m.m_fMat[0+iColumn*4], m.m_fMat[1+iColumn*4], m.m_fMat[2+iColumn*4], m.m_fMat[3+iColumn*4]);
+}
 
-void		LoadIdentity(Mat44 * pM);
-void		LoadRotation(Mat44 * pM, const Quat &Q );
-void		LoadRotation(Mat44 * pM, const float fX, const float fY, const float fZ );
-void		LoadRotationAxisAngle(Mat44 * pM, const Vec3 &v, const float fAngle );
+// LoadRotation(Mat44 *, const Quat &) is declared in quaternion.h
 
-void		SetRow(Mat44 * pM, int iRow, const Vec4 &v );
-const Vec4	GetRow(const Mat44 &m, int iRow );
-void		SetColumn(Mat44 * pM, int iColumn, const Vec4 &v );
-const Vec4	GetColumn(const Mat44 &m, int iColumn );
 
 #endif
@@ -1,5 +1,6 @@
 #include "quaternion.h"
 #include "mat33.h"
+#include "mat44.h"
 #include <math.h>
 
 
@@ -228,6 +229,67 @@ const Quat Slerp(const Quat &Qa, const Quat &Qb, float t)
 }
 
 
+
+void		LoadRotation(Mat33 * pM, const Quat &Q )
+{
+	float tx  = 2*Q.V.x;
+	float ty  = 2*Q.V.y;
+	float tz  = 2*Q.V.z;
+	float twx = tx*Q.s;
+	float twy = ty*Q.s;
+	float twz = tz*Q.s;
+	float txx = tx*Q.V.x;
+	float txy = ty*Q.V.x;
+	float txz = tz*Q.V.x;
+	float tyy = ty*Q.V.y;
+	float tyz = tz*Q.V.y;
+	float tzz = tz*Q.V.z;
+
+	pM->m_fMat[0+0*3] = 1.0f-tyy-tzz;
+	pM->m_fMat[0+1*3] = txy-twz;
+	pM->m_fMat[0+2*3] = txz+twy;
+	pM->m_fMat[1+0*3] = txy+twz;
+	pM->m_fMat[1+1*3] = 1.0f-txx-tzz;
+	pM->m_fMat[1+2*3] = tyz-twx;
+	pM->m_fMat[2+0*3] = txz-twy;
+	pM->m_fMat[2+1*3] = tyz+twx;
+	pM->m_fMat[2+2*3] = 1.0f-txx-tyy;
+}
+
+void		LoadRotation(Mat44 * pM, const Quat &Q )
+{
+	float tx  = 2*Q.V.x;
+	float ty  = 2*Q.V.y;
+	float tz  = 2*Q.V.z;
+	float twx = tx*Q.s;
+	float twy = ty*Q.s;
+	float twz = tz*Q.s;
+	float txx = tx*Q.V.x;
+	float txy = ty*Q.V.x;
+	float txz = tz*Q.V.x;
+	float tyy = ty*Q.V.y;
+	float tyz = tz*Q.V.y;
+	float tzz = tz*Q.V.z;
+
+	pM->m_fMat[0+0*4] = 1.0f-tyy-tzz;
+	pM->m_fMat[0+1*4] = txy-twz;
+	pM->m_fMat[0+2*4] = txz+twy;
+	pM->m_fMat[0+3*4] = 0;
+	pM->m_fMat[1+0*4] = txy+twz;
+	pM->m_fMat[1+1*4] = 1.0f-txx-tzz;
+	pM->m_fMat[1+2*4] = tyz-twx;
+	pM->m_fMat[1+3*4] = 0;
+	pM->m_fMat[2+0*4] = txz-twy;
+	pM->m_fMat[2+1*4] = tyz+twx;
+	pM->m_fMat[2+2*4] = 1.0f-txx-tyy;
+	pM->m_fMat[2+3*4] = 0;
+	pM->m_fMat[3+0*4] = 0;
+	pM->m_fMat[3+1*4] = 0;
+	pM->m_fMat[3+2*4] = 0;
+	pM->m_fMat[3+3*4] = 1.0f;
+}
+
+
 // Very fast slerping, maybe we can use it later
 /*const Quat Slerp2(const float t, const float angle, const float cs, const float invsin, const Quat &Qa, const Quat &Qb)
 {
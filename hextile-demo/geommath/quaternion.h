@@ -1,11 +1,10 @@
 #ifndef __QUATERNION_H__
 #define __QUATERNION_H__
 
+#include "geommath_fwd.h"
 #include "vec3.h"
 
 
-struct Mat33;
-
 struct Quat
 {
 	Quat( const Vec3 &v, const float fS ) : V(v), s(fS) {}
@@ -44,6 +43,9 @@ const Quat		RotationToQuat(const Mat33 &m);
 
 const Quat Slerp(const Quat &Qa, const Quat &Qb, float f);
 
+void		LoadRotation(Mat33 * pM, const Quat &Q );
+void		LoadRotation(Mat44 * pM, const Quat &Q );
+
 
 
 #endif
@@ -1,39 +1,73 @@
 #ifndef __VEC3_H__
 #define __VEC3_H__
 
+#include "geommath_fwd.h"
+#include <cmath>
 
-struct Vec4;
 
-struct Vec3
+template<class T> struct TVec3
 {
-	Vec3( const Vec3 &v ) : x(v.x), y(v.y), z(v.z) {}
-	Vec3( float fX, float fY, float fZ ) : x(fX), y(fY), z(fZ) {}
-	Vec3() {}
+	typedef T Scalar;
 
-	operator Vec4() const;
+	TVec3() = default;
+	TVec3( const TVec3 &v ) = default;
+	constexpr TVec3( T fX, T fY, T fZ ) : x(fX), y(fY), z(fZ) {}
+	template<class U> explicit constexpr TVec3( const TVec3<U> &v ) : x((T) v.x), y((T) v.y), z((T) v.z) {}
 
+	TVec3& operator =( const TVec3 &v ) = default;
 
-	float x, y, z;
+	operator TVec4<T>() const;
+
+
+	// operators are friends such that implicit conversions
+	// (int/double scalars, Vec4 to Vec3) behave as before.
+	friend constexpr const TVec3	operator -( const TVec3 &v1, const TVec3 &v2 ) { return TVec3(v1.x - v2.x, v1.y - v2.y, v1.z - v2.z); }
+	friend constexpr const TVec3	operator -( const TVec3 &v ) { return TVec3(-v.x, -v.y, -v.z); }
+	friend constexpr const TVec3	operator +( const TVec3 &v1, const TVec3 &v2 ) { return TVec3(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z); }
+	friend constexpr TVec3&			operator +=( TVec3 &v1, const TVec3 &v2 ) { v1.x += v2.x; v1.y += v2.y; v1.z += v2.z; return v1; }
+	friend constexpr TVec3&			operator -=( TVec3 &v1, const TVec3 &v2 ) { v1.x -= v2.x; v1.y -= v2.y; v1.z -= v2.z; return v1; }
+	friend constexpr bool			operator ==( const TVec3 &v1, const TVec3 &v2 ) { return (v1.x == v2.x) && (v1.y == v2.y) && (v1.z == v2.z); }
+	friend constexpr bool			operator !=( const TVec3 &v1, const TVec3 &v2 ) { return !(v1==v2); }
+
+	friend constexpr const T		operator *( const TVec3 &v1, const TVec3 &v2 ) { return v1.x*v2.x + v1.y*v2.y + v1.z*v2.z; }
+	friend constexpr const TVec3	operator *( const T fS, const TVec3 &v ) { return TVec3(fS * v.x, fS * v.y, fS * v.z); }
+	friend constexpr const TVec3	operator *( const TVec3 &v, const T fS ) { return fS * v; }
+	friend constexpr TVec3&			operator *=( TVec3 &v, const T fS ) { v.x *= fS; v.y *= fS; v.z *= fS; return v; }
+
+
+	T x, y, z;
 };
 
 
-const Vec3		operator -( const Vec3 &v1, const Vec3 &v2 );
-const Vec3		operator -( const Vec3 &v );
-const Vec3		operator +( const Vec3 &v1, const Vec3 &v2 );
-Vec3&			operator +=(Vec3 &v1, const Vec3 &v2);
-Vec3&			operator -=(Vec3 &v1, const Vec3 &v2);
-bool			operator ==( const Vec3 &v1, const Vec3 &v2 );
-bool			operator !=( const Vec3 &v1, const Vec3 &v2 );
+template<class T> constexpr const TVec3<T>	Cross( const TVec3<T> &v1, const TVec3<T> &v2 )
+{
+	return TVec3<T>(v1.y*v2.z - v2.y*v1.z,
+					v1.z*v2.x - v2.z*v1.x,
+					v1.x*v2.y - v2.x*v1.y);
+}
+
+template<class T> constexpr T				LengthSquared( const TVec3<T> &v )
+{
+	return v.x*v.x + v.y*v.y + v.z*v.z;
+}
+
+template<class T> inline T					Length( const TVec3<T> &v )
+{
+	return (T) std::sqrt(LengthSquared(v));
+}
 
-const float		operator *( const Vec3 &v1, const Vec3 &v2);
-const Vec3		operator *(const float fS, const Vec3 &v);
-const Vec3		operator *(const Vec3 &v, const float fS);
-Vec3&			operator *=(Vec3 &v, const float fS );
+template<class T> inline const TVec3<T>		Normalize( const TVec3<T> &v )
+{
+	return (1 / Length(v)) * v;
+}
 
-const Vec3		Cross(const Vec3 &v1, const Vec3 &v2);
-float			LengthSquared( const Vec3 &v );
-float			Length( const Vec3 &v );
-const Vec3		Normalize( const Vec3 &v );
+
+#include "vec4.h"
+
+template<class T> inline TVec3<T>::operator TVec4<T>() const
+{
+	return TVec4<T>(x, y, z, 1);
+}
 
 
 #endif
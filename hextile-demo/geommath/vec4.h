@@ -1,39 +1,83 @@
 #ifndef __VEC4_H__
 #define __VEC4_H__
 
+#include "geommath_fwd.h"
+#include <cmath>
 
-struct Vec3;
 
-struct Vec4
+template<class T> struct TVec4
 {
-	Vec4( const Vec4 &v ) : x(v.x), y(v.y), z(v.z), w(v.w) {}
-	Vec4( float fX, float fY, float fZ, float fW ) : x(fX), y(fY), z(fZ), w(fW) {}
-	Vec4() {}
+	typedef T Scalar;
 
-	operator Vec3() const;
+	TVec4() = default;
+	TVec4( const TVec4 &v ) = default;
+	constexpr TVec4( T fX, T fY, T fZ, T fW ) : x(fX), y(fY), z(fZ), w(fW) {}
+	template<class U> explicit constexpr TVec4( const TVec4<U> &v ) : x((T) v.x), y((T) v.y), z((T) v.z), w((T) v.w) {}
 
+	TVec4& operator =( const TVec4 &v ) = default;
 
-	float x, y, z, w;
+	operator TVec3<T>() const;
+
+
+	friend constexpr const TVec4	operator -( const TVec4 &v1, const TVec4 &v2 ) { return TVec4(v1.x - v2.x, v1.y - v2.y, v1.z - v2.z, v1.w - v2.w); }
+	friend constexpr const TVec4	operator -( const TVec4 &v ) { return TVec4(-v.x, -v.y, -v.z, -v.w); }
+	friend constexpr const TVec4	operator +( const TVec4 &v1, const TVec4 &v2 ) { return TVec4(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z, v1.w + v2.w); }
+	friend constexpr TVec4&			operator +=( TVec4 &v1, const TVec4 &v2 ) { v1.x += v2.x; v1.y += v2.y; v1.z += v2.z; v1.w += v2.w; return v1; }
+	friend constexpr TVec4&			operator -=( TVec4 &v1, const TVec4 &v2 ) { v1.x -= v2.x; v1.y -= v2.y; v1.z -= v2.z; v1.w -= v2.w; return v1; }
+	friend constexpr bool			operator ==( const TVec4 &v1, const TVec4 &v2 ) { return (v1.x == v2.x) && (v1.y == v2.y) && (v1.z == v2.z) && (v1.w == v2.w); }
+	friend constexpr bool			operator !=( const TVec4 &v1, const TVec4 &v2 ) { return !(v1==v2); }
+
+	friend constexpr const T		operator *( const TVec4 &v1, const TVec4 &v2 ) { return v1.x*v2.x + v1.y*v2.y + v1.z*v2.z + v1.w*v2.w; }
+	friend constexpr const TVec4	operator *( const T fS, const TVec4 &v ) { return TVec4(fS * v.x, fS * v.y, fS * v.z, fS * v.w); }
+	friend constexpr const TVec4	operator *( const TVec4 &v, const T fS ) { return fS * v; }
+	friend constexpr TVec4&			operator *=( TVec4 &v, const T fS ) { v.x *= fS; v.y *= fS; v.z *= fS; v.w *= fS; return v; }
+
+
+	T x, y, z, w;
 };
 
 
-const Vec4		operator -( const Vec4 &v1, const Vec4 &v2 );
-const Vec4		operator -( const Vec4 &v );
-const Vec4		operator +( const Vec4 &v1, const Vec4 &v2 );
-Vec4&			operator +=(Vec4 &v1, const Vec4 &v2);
-Vec4&			operator -=(Vec4 &v1, const Vec4 &v2);
-bool			operator ==( const Vec4 &v1, const Vec4 &v2 );
-bool			operator !=( const Vec4 &v1, const Vec4 &v2 );
+template<class T> constexpr const TVec4<T>	Cross( const TVec4<T> &v1, const TVec4<T> &v2, const TVec4<T> &v3 )
+{
+	// Calculate intermediate values.
+	const T fA = (v2.x * v3.y) - (v2.y * v3.x);
+	const T fB = (v2.x * v3.z) - (v2.z * v3.x);
+	const T fC = (v2.x * v3.w) - (v2.w * v3.x);
+	const T fD = (v2.y * v3.z) - (v2.z * v3.y);
+	const T fE = (v2.y * v3.w) - (v2.w * v3.y);
+	const T fF = (v2.z * v3.w) - (v2.w * v3.z);
+
+	// Calculate the result-vector components.
+	return TVec4<T>(  (v1.y * fF) - (v1.z * fE) + (v1.w * fD),
+					- (v1.x * fF) + (v1.z * fC) - (v1.w * fB),
+					  (v1.x * fE) - (v1.y * fC) + (v1.w * fA),
+					- (v1.x * fD) + (v1.y * fB) - (v1.z * fA) );
+}
+
+template<class T> constexpr T				LengthSquared( const TVec4<T> &v )
+{
+	return v.x*v.x + v.y*v.y + v.z*v.z + v.w*v.w;
+}
+
+template<class T> inline T					Length( const TVec4<T> &v )
+{
+	return (T) std::sqrt(LengthSquared(v));
+}
+
+template<class T> inline const TVec4<T>		Normalize( const TVec4<T> &v )
+{
+	return (1 / Length(v)) * v;
+}
+
 
-const float		operator *( const Vec4 &v1, const Vec4 &v2);
-const Vec4		operator *(const float fS, const Vec4 &v);
-const Vec4		operator *(const Vec4 &v, const float fS);
-Vec4&			operator *=(Vec4 &v, const float fS );
+#include "vec3.h"
+
+template<class T> inline TVec4<T>::operator TVec3<T>() const
+{
+	const T fInvW = 1 / w;
 
-const Vec4		Cross(const Vec4 &v1, const Vec4 &v2, const Vec4 &v3);
-float			LengthSquared( const Vec4 &v );
-float			Length( const Vec4 &v );
-const Vec4		Normalize( const Vec4 &v );
+	return TVec3<T>(fInvW * x, fInvW * y, fInvW * z);
+}
 
 
 #endif
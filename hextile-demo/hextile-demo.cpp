@@ -48,6 +48,14 @@ ID3D11Buffer * g_pGlobalsCB = NULL;
 
 
 #include "meshimport/meshdraw.h"
+#include "cputools/hextile_lut.h"
+#include "cputools/hextile_lod.h"
+#include "cputools/deriv_map.h"
+#include "cputools/large_world.h"
+#include "cputools/noise_volume.h"
+#include "cputools/instance_batch.h"
+#include "cputools/instance_bvh.h"
+#include "cputools/draw_list.h"
 
 
 #ifndef M_PI
@@ -81,6 +89,13 @@ static bool g_bHexColEnabled = true;
 static bool g_bHexNormalEnabled = false;
 static bool g_bHistoPreservEnabled = false;
 static bool g_bRegularTilingEnabled = false;
+static bool g_bHexCellLUTEnabled = false;
+static bool g_bHexLodFallbackEnabled = false;
+static bool g_bHexStochasticEnabled = false;
+static bool g_bTriplanarSkipEnabled = false;
+static float g_fTriplanarSkipThreshold = 0.05f;	// see TriplanarProjectionsPerThreshold()
+static bool g_bBiplanarEnabled = false;
+static bool g_bDerivMapsEnabled = false;
 static int g_showWeightsMode = 0;
 
 const float initialTileRate = 5.0f;
@@ -101,6 +116,38 @@ static float g_RotStrength = 0.0f;
 static float g_ColorFakeContrast = 0.7f;
 static float g_NormalFakeContrast = 0.5f;
 
+// per cell variety of the LUT relative to the analytic rotations and offsets,
+// gathered the first time the LUT is enabled.
+static bool g_bHexCellLUTStatsValid = false;
+static SHexCellLUTStats g_sHexCellLUTStats;
+
+// fade to a single fetch starting this many mip levels from the 1x1 level,
+// see HexLodFindFallbackStart() for choosing it from an error bound.
+static float g_fHexLodFallbackStart = 2.0f;
+static float g_fHexLodFallbackRange = 1.0f;
+static SHexLodCoverage g_sHexLodCoverage;
+
+// the scene is moved this far along x and z when rendering camera relative,
+// precision compared to plain float world space the first time it is enabled.
+static bool g_bCameraRelative = false;
+static const double g_dLargeWorldOffset = 1e7;
+static bool g_bLargeWorldReportValid = false;
+static SLargeWorldReport g_sLargeWorldReport;
+
+// fractal noise bump on the sphere, either procedural or with the low
+// octaves taken from the baked noise volume.
+enum NOISE_BUMP_MODE
+{
+	NOISE_BUMP_OFF=0,
+	NOISE_BUMP_PROCEDURAL,
+	NOISE_BUMP_VOLUME,
+
+	NUM_NOISE_BUMP_MODES
+};
+
+static int g_iNoiseBumpMode = NOISE_BUMP_OFF;
+static const float g_fNoiseBumpFreq = 1.5f;
+
 //static float frnd() { return (float) (((double) (rand() % (RAND_MAX+1))) / RAND_MAX); }
 
 CTextureObject g_tex_depth;
@@ -147,6 +194,9 @@ void RenderText()
 
 	if(g_iMenuVisib!=0)
 	{
+		WCHAR dest_str[256];
+		WCHAR tmp_str[256];
+
 		g_pTxtHelper->DrawTextLine(L"This scene illustrates practical real-time hex-tiling.\n");
 
 		g_pTxtHelper->DrawTextLine(L"Rotate the camera by using the mouse while pressing and holding the left mouse button.\n");
@@ -167,9 +217,54 @@ void RenderText()
 		*/
 		// I
 		if(g_bEnableShadows)
+		{
 			g_pTxtHelper->DrawTextLine(L"Shadows enabled (toggle using i)\n");
+
+			int iNrCascades = 0;
+			const SShadowCascade * pCascades = g_shadowMap.GetCascades(&iNrCascades);
+			swprintf(dest_str, L"\t\tcascades split at");
+			for(int c=0; c<=iNrCascades; c++)
+			{
+				swprintf(tmp_str, L" %1.1f", c<iNrCascades ? pCascades[c].fSplitNear : pCascades[iNrCascades-1].fSplitFar);
+				wcscat(dest_str, tmp_str);
+			}
+			wcscat(dest_str, L", texels");
+			for(int c=0; c<iNrCascades; c++)
+			{
+				if(pCascades[c].bEmpty) swprintf(tmp_str, L" empty");
+				else swprintf(tmp_str, L" %dx%d", pCascades[c].iViewport[2], pCascades[c].iViewport[3]);
+				wcscat(dest_str, tmp_str);
+			}
+			wcscat(dest_str, L"\n");
+			g_pTxtHelper->DrawTextLine(dest_str);
+
+			const SShadowCullStats &cullStats = g_shadowMap.GetCullStats();
+			swprintf(dest_str, L"\t\tcasters culled %d of %d, instanced draws %d with %d instances culled\n",
+				cullStats.iNrCulled, cullStats.iNrCasters, cullStats.iNrDraws, cullStats.iNrDrawsCulled);
+			g_pTxtHelper->DrawTextLine(dest_str);
+
+			const SShadowCacheStats &cacheStats = g_shadowMap.GetCacheStats();
+			swprintf(dest_str, L"\t\tshadow cache: rendered %2.1f%% of the texels, %2.1f%% on average, in %d of %d frames\n",
+				100*cacheStats.fRenderedFraction, 100*cacheStats.fAvgRenderedFraction, cacheStats.iNrFramesRendered, cacheStats.iNrFrames);
+			g_pTxtHelper->DrawTextLine(dest_str);
+		}
 		else g_pTxtHelper->DrawTextLine(L"Shadows disabled (toggle using i)\n");
 
+		const SInstanceBatchStats * pBatchStats = GetSceneInstanceBatchStats();
+		swprintf(dest_str, L"Scene: %d instances in %d instanced draws (%2.1fx fewer), %d transforms updated\n",
+			pBatchStats->iNrInstances, pBatchStats->iNrBatches, pBatchStats->fDrawReduction, GetNrSceneTransformsUpdated());
+		g_pTxtHelper->DrawTextLine(dest_str);
+
+		const SInstanceCullStats * pCullStats = GetSceneCullStats();
+		swprintf(dest_str, L"Frustum culling: %d of %d instances visible, %d BVH nodes tested, %d rebuilds\n",
+			pCullStats->iNrVisible, pCullStats->iNrInstances, pCullStats->iNrNodesTested, pCullStats->iNrRebuilds);
+		g_pTxtHelper->DrawTextLine(dest_str);
+
+		const SDrawSubmitStats * pDrawStats = GetSceneDrawSubmitStats();
+		swprintf(dest_str, L"Draw submission: %d API calls per frame (%d without state diffing) for %d draws, %d command lists\n",
+			pDrawStats->iNrCalls, pDrawStats->iNrCallsWithoutDiffing, pDrawStats->iNrDraws, pDrawStats->iNrCommandLists);
+		g_pTxtHelper->DrawTextLine(dest_str);
+
 		// V
 		if(g_showWeightsMode==0)
 			g_pTxtHelper->DrawTextLine(L"Hex Weights OFF (toggle using v)\n");
@@ -202,9 +297,91 @@ void RenderText()
 			g_pTxtHelper->DrawTextLine(L"Regular tiling enabled (toggle using t)\n");
 		else g_pTxtHelper->DrawTextLine(L"Regular tiling disabled (toggle using t)\n");
 
+		// L
+		if(g_bHexCellLUTEnabled)
+		{
+			g_pTxtHelper->DrawTextLine(L"Hex cell LUT enabled (toggle using l)\n");
+			if(g_bHexCellLUTStatsValid)
+			{
+				swprintf(dest_str, L"\t\tLUT vs analytic: KS angle %1.4f offset %1.4f, neighbor corr %1.4f vs %1.4f, distinct cells %1.3f vs %1.3f\n",
+					g_sHexCellLUTStats.fAngleKS, g_sHexCellLUTStats.fOffsKS,
+					g_sHexCellLUTStats.fNeighborCorrLUT, g_sHexCellLUTStats.fNeighborCorrAnalytic,
+					g_sHexCellLUTStats.fDistinctLUT, g_sHexCellLUTStats.fDistinctAnalytic);
+				g_pTxtHelper->DrawTextLine(dest_str);
+			}
+		}
+		else g_pTxtHelper->DrawTextLine(L"Hex cell LUT disabled (toggle using l)\n");
+
+		// F
+		if(g_bHexLodFallbackEnabled)
+		{
+			g_pTxtHelper->DrawTextLine(L"LOD fallback to a single fetch enabled (toggle using f)\n");
+			swprintf(dest_str, L"\t\tground plane: hex %2.1f%%, fade %2.1f%%, single %2.1f%%, %1.2f fetches per pixel\n",
+				100*g_sHexLodCoverage.fHexFraction, 100*g_sHexLodCoverage.fFadeFraction, 100*g_sHexLodCoverage.fFallbackFraction,
+				g_sHexLodCoverage.fFetchesPerPixel);
+			g_pTxtHelper->DrawTextLine(dest_str);
+		}
+		else g_pTxtHelper->DrawTextLine(L"LOD fallback to a single fetch disabled (toggle using f)\n");
+
+		// K
+		if(g_bHexStochasticEnabled)
+			g_pTxtHelper->DrawTextLine(L"Stochastic single tap hex-tiling enabled (toggle using k)\n");
+		else g_pTxtHelper->DrawTextLine(L"Stochastic single tap hex-tiling disabled (toggle using k)\n");
+
+		// G
+		if(g_bTriplanarSkipEnabled)
+		{
+			swprintf(dest_str, L"Skip triplanar projections below weight %1.2f enabled (toggle using g)\n", g_fTriplanarSkipThreshold);
+			g_pTxtHelper->DrawTextLine(dest_str);
+		}
+		else g_pTxtHelper->DrawTextLine(L"Skip triplanar projections disabled (toggle using g)\n");
+
+		// J
+		if(g_bBiplanarEnabled)
+			g_pTxtHelper->DrawTextLine(L"Biplanar instead of triplanar projection enabled (toggle using j)\n");
+		else g_pTxtHelper->DrawTextLine(L"Biplanar instead of triplanar projection disabled (toggle using j)\n");
+
+		// U
+		const SDerivMapStats * pDerivMapStats = GetGroundDerivMapStats();
+		if(g_bDerivMapsEnabled && pDerivMapStats!=NULL)
+		{
+			g_pTxtHelper->DrawTextLine(L"Derivative maps instead of normal maps enabled (toggle using u)\n");
+			swprintf(dest_str, L"\t\tground: scale %2.2f, clamped %1.3f%%, 8 bit error rms %1.4f max %1.4f, angle rms %1.3f max %1.3f deg\n",
+				pDerivMapStats->fScale, 100*pDerivMapStats->fClampedFraction, pDerivMapStats->fRmsErr, pDerivMapStats->fMaxErr,
+				pDerivMapStats->fRmsAngleErrDeg, pDerivMapStats->fMaxAngleErrDeg);
+			g_pTxtHelper->DrawTextLine(dest_str);
+		}
+		else g_pTxtHelper->DrawTextLine(L"Derivative maps instead of normal maps disabled (toggle using u)\n");
+
+		// Y
+		if(g_bCameraRelative)
+		{
+			swprintf(dest_str, L"Camera relative rendering at %1.0e units enabled (toggle using y)\n", g_dLargeWorldOffset);
+			g_pTxtHelper->DrawTextLine(dest_str);
+			if(g_bLargeWorldReportValid)
+			{
+				swprintf(dest_str, L"\t\tRWS vs float world space: texel error %1.4f vs %1.1f, cell mismatches %d vs %d of %d\n",
+					g_sLargeWorldReport.fMaxTexelErrRWS, g_sLargeWorldReport.fMaxTexelErrAbs,
+					g_sLargeWorldReport.iNrCellMismatchRWS, g_sLargeWorldReport.iNrCellMismatchAbs, g_sLargeWorldReport.iNrSamples);
+				g_pTxtHelper->DrawTextLine(dest_str);
+			}
+		}
+		else g_pTxtHelper->DrawTextLine(L"Camera relative rendering disabled (toggle using y)\n");
+
+		// Z
+		const SNoiseVolumeStats * pNoiseVolStats = GetNoiseVolumeStats();
+		if(g_iNoiseBumpMode==NOISE_BUMP_PROCEDURAL)
+			g_pTxtHelper->DrawTextLine(L"Noise bump on the sphere, procedural (toggle using z)\n");
+		else if(g_iNoiseBumpMode==NOISE_BUMP_VOLUME && pNoiseVolStats!=NULL)
+		{
+			g_pTxtHelper->DrawTextLine(L"Noise bump on the sphere, low octaves from the noise volume (toggle using z)\n");
+			swprintf(dest_str, L"\t\tvolume %d^3 with period %d baked in %1.1f ms, %1.1f Mvoxels/s on %d threads\n",
+				pNoiseVolStats->iRes, pNoiseVolStats->iPeriod, 1000*pNoiseVolStats->fSeconds, pNoiseVolStats->fMVoxelsPerSec, pNoiseVolStats->iNrThreads);
+			g_pTxtHelper->DrawTextLine(dest_str);
+		}
+		else g_pTxtHelper->DrawTextLine(L"Noise bump on the sphere disabled (toggle using z)\n");
+
 		// M
-		WCHAR dest_str[256];
-		WCHAR tmp_str[256];
 		swprintf(dest_str, L"Parameter ");
 	
 		if(g_iToggleParamWeAdjust == ADJUST_TILING_RATE)
@@ -241,6 +418,8 @@ void render_surface(ID3D11DeviceContext* pd3dImmediateContext, bool bSimpleLayou
 
 
 Mat44 g_m44Proj, g_m44InvProj, g_mViewToScr, g_mScrToView;
+static const float g_fFov = 60;
+static float g_fCamNear = 0.1f, g_fCamFar = 1000.0f;
 
 
 Vec3 XMVToVec3(const DirectX::XMVECTOR vec)
@@ -290,21 +469,56 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
 	world_to_view = world_to_view * mZflip;
 #endif
 	
+	// relative world space is centered at the camera which is placed in double
+	const Vec3d vWorldOffset = g_bCameraRelative ? Vec3d(g_dLargeWorldOffset, 0, g_dLargeWorldOffset) : Vec3d(0,0,0);
+	const Vec3d vCamPosAbs = vWorldOffset + Vec3d(cam_pos.x, cam_pos.y, cam_pos.z);
+	SetSceneGraphWorldOffset(vWorldOffset);
+	RebaseSceneGraph(pd3dImmediateContext, g_bCameraRelative ? vCamPosAbs : Vec3d(0,0,0));
+	if(g_bCameraRelative) SetColumn(&world_to_view, 3, Vec4(0,0,0,1));
+
+	SHexRWSOffset hexRWSOffs[3];
+	HexRWSPlanarOffsets(hexRWSOffs, vCamPosAbs, 0.05*g_DetailTileRate);
+
 	Mat44 m44LocalToWorld; LoadIdentity(&m44LocalToWorld);
 	Mat44 m44LocalToView = world_to_view * m44LocalToWorld;
 	Mat44 Trans = g_m44Proj * world_to_view;
 
+	// one visible list for the depth prepass and the forward pass
+	CullSceneGraph(Trans);
+
 	
 	
 
 	// fill constant buffers
 	D3D11_MAPPED_SUBRESOURCE MappedSubResource;
 
+	const Mat44 view_to_world = ~world_to_view;
+
 	// prefill shadow map
-	if(g_bEnableShadows) g_shadowMap.RenderShadowMap(pd3dImmediateContext, g_pGlobalsCB, GetSunDir());
+	if(g_bEnableShadows)
+	{
+		const float fAspect = ((float) DXUTGetDXGIBackBufferSurfaceDesc()->Width) / DXUTGetDXGIBackBufferSurfaceDesc()->Height;
+		g_shadowMap.RenderShadowMap(pd3dImmediateContext, g_pGlobalsCB, GetSunDir(), view_to_world, (g_fFov*((float) M_PI))/180, fAspect,
+									g_fCamNear, g_fCamFar, g_bCameraRelative ? vCamPosAbs : Vec3d(0,0,0));
+	}
+
+	// table holds the rotations for the current rotation strength
+	if(g_bHexCellLUTEnabled) UpdateHexCellLUT(pd3dImmediateContext, g_RotStrength);
 
 	// fill constant buffers
-	const Mat44 view_to_world = ~world_to_view;
+	static int iFrameIndex = 0;
+
+	// expected paths taken on the ground plane, evaluated at quarter resolution
+	if(g_bHexLodFallbackEnabled && g_iMenuVisib!=0)
+	{
+		Vec3 vGroundCen; float fGroundHalfExtent;
+		GetGroundPlaneInfo(&vGroundCen, &fGroundHalfExtent);
+		HexLodCoverageGroundPlane(&g_sHexLodCoverage, view_to_world, (g_fFov*((float) M_PI))/180,
+			DXUTGetDXGIBackBufferSurfaceDesc()->Width, DXUTGetDXGIBackBufferSurfaceDesc()->Height,
+			vGroundCen, fGroundHalfExtent, 0.05f*g_DetailTileRate, GetGroundDetailTexSize(),
+			g_fHexLodFallbackStart, g_fHexLodFallbackRange, 4);
+	}
+
 	V( pd3dImmediateContext->Map( g_pGlobalsCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
 	((cbGlobals *)MappedSubResource.pData)->g_mWorldToView = Transpose(world_to_view);
 	((cbGlobals *)MappedSubResource.pData)->g_mViewToWorld = Transpose(view_to_world);
@@ -329,6 +543,30 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
 	((cbGlobals *)MappedSubResource.pData)->g_FakeContrastNormal = g_NormalFakeContrast;
 	((cbGlobals *)MappedSubResource.pData)->g_rotStrength = g_RotStrength;
 	((cbGlobals *)MappedSubResource.pData)->g_showWeightsMode = g_showWeightsMode;
+	((cbGlobals *)MappedSubResource.pData)->g_bUseHexCellLUT = g_bHexCellLUTEnabled;
+	((cbGlobals *)MappedSubResource.pData)->g_iHexCellLUTSize = GetHexCellLUTSize();
+	((cbGlobals *)MappedSubResource.pData)->g_bHexLodFallback = g_bHexLodFallbackEnabled;
+	((cbGlobals *)MappedSubResource.pData)->g_fHexLodFallbackStart = g_fHexLodFallbackStart;
+	((cbGlobals *)MappedSubResource.pData)->g_fHexLodFallbackRange = g_fHexLodFallbackRange;
+	((cbGlobals *)MappedSubResource.pData)->g_bHexStochastic = g_bHexStochasticEnabled;
+	((cbGlobals *)MappedSubResource.pData)->g_iFrameIndex = iFrameIndex++;
+	((cbGlobals *)MappedSubResource.pData)->g_bTriplanarSkip = g_bTriplanarSkipEnabled;
+	((cbGlobals *)MappedSubResource.pData)->g_fTriplanarSkipThreshold = g_fTriplanarSkipThreshold;
+	((cbGlobals *)MappedSubResource.pData)->g_bBiplanar = g_bBiplanarEnabled;
+	((cbGlobals *)MappedSubResource.pData)->g_bUseDerivMaps = g_bDerivMapsEnabled && GetGroundDerivMapStats()!=NULL;
+	((cbGlobals *)MappedSubResource.pData)->g_bCameraRelative = g_bCameraRelative;
+	const SNoiseVolumeStats * pNoiseVolStats = GetNoiseVolumeStats();
+	((cbGlobals *)MappedSubResource.pData)->g_iNoiseBumpMode = (g_iNoiseBumpMode==NOISE_BUMP_VOLUME && pNoiseVolStats==NULL) ? NOISE_BUMP_PROCEDURAL : g_iNoiseBumpMode;
+	((cbGlobals *)MappedSubResource.pData)->g_fNoiseVolPeriod = pNoiseVolStats!=NULL ? ((float) pNoiseVolStats->iPeriod) : 1.0f;
+	((cbGlobals *)MappedSubResource.pData)->g_fNoiseVolTexelSize = pNoiseVolStats!=NULL ? (((float) pNoiseVolStats->iPeriod) / pNoiseVolStats->iRes) : 0.0f;
+	((cbGlobals *)MappedSubResource.pData)->g_fNoiseBumpFreq = g_fNoiseBumpFreq;
+	for(int i=0; i<3; i++)
+	{
+		const SHexRWSOffset &offs = hexRWSOffs[i];
+		((cbGlobals *)MappedSubResource.pData)->g_vHexRWSOffs[i] = Vec4(offs.fStOffs[0], offs.fStOffs[1], offs.fCenOffs[0], offs.fCenOffs[1]);
+		const Vec4i vCellOffs = { offs.iCellOffs[0], offs.iCellOffs[1], 0, 0 };
+		((cbGlobals *)MappedSubResource.pData)->g_iHexRWSCellOffs[i] = vCellOffs;
+	}
 	
 
     pd3dImmediateContext->Unmap( g_pGlobalsCB, 0 );
@@ -438,7 +676,9 @@ HRESULT CALLBACK OnD3D11ResizedSwapChain( ID3D11Device* pd3dDevice, IDXGISwapCha
 	//const float fHalfWidthAtMinusNear = fNear * tanf((fFov*((float) M_PI))/360);
 	//const float fHalfHeightAtMinusNear = fHalfWidthAtMinusNear * (((float) 3)/4.0);
 
-	const float fFov = 60;
+	g_fCamNear = fNear; g_fCamFar = fFar;
+
+	const float fFov = g_fFov;
 	const float fHalfHeightAtMinusNear = fNear * tanf((fFov*((float) M_PI))/360);
 	const float fHalfWidthAtMinusNear = fHalfHeightAtMinusNear * (((float) w)/h);
 	
@@ -747,6 +987,50 @@ void CALLBACK OnKeyboard( UINT nChar, bool bKeyDown, bool bAltDown, void* pUserC
 			g_bRegularTilingEnabled = !g_bRegularTilingEnabled;
 		}
 
+		if (nChar == 'L')
+		{
+			g_bHexCellLUTEnabled = !g_bHexCellLUTEnabled;
+			if(g_bHexCellLUTEnabled && !g_bHexCellLUTStatsValid)
+				g_bHexCellLUTStatsValid = CompareHexCellLUT(&g_sHexCellLUTStats, GetHexCellLUTSize(), 256);
+		}
+
+		if (nChar == 'F')
+		{
+			g_bHexLodFallbackEnabled = !g_bHexLodFallbackEnabled;
+		}
+
+		if (nChar == 'K')
+		{
+			g_bHexStochasticEnabled = !g_bHexStochasticEnabled;
+		}
+
+		if (nChar == 'G')
+		{
+			g_bTriplanarSkipEnabled = !g_bTriplanarSkipEnabled;
+		}
+
+		if (nChar == 'J')
+		{
+			g_bBiplanarEnabled = !g_bBiplanarEnabled;
+		}
+
+		if (nChar == 'U')
+		{
+			g_bDerivMapsEnabled = !g_bDerivMapsEnabled;
+		}
+
+		if (nChar == 'Y')
+		{
+			g_bCameraRelative = !g_bCameraRelative;
+			if(g_bCameraRelative && !g_bLargeWorldReportValid)
+				g_bLargeWorldReportValid = LargeWorldPrecisionReport(&g_sLargeWorldReport, g_dLargeWorldOffset, 0.05*g_DetailTileRate);
+		}
+
+		if (nChar == 'Z')
+		{
+			g_iNoiseBumpMode = (g_iNoiseBumpMode+1) % NUM_NOISE_BUMP_MODES;
+		}
+
 		if (nChar == 'M')
 		{
 			g_iToggleParamWeAdjust = (g_iToggleParamWeAdjust+1) % NUM_PARAMS_TO_TWEAK;
@@ -6,6 +6,20 @@
 static float g_fallOffContrast = 0.6;
 static float g_exp = 7;
 
+// Optional table of cos, sin and hash() per cell generated on the CPU (see
+// cputools/hextile_lut.h) for a given rotStrength. When enabled the table
+// replaces the transcendentals of LoadRot2x2() and hash() by a single load
+// and the rotations and offsets repeat every g_iCellLUTSize cells.
+Buffer<float4> g_hexCellLUT;
+static bool g_bCellLUTEnabled = false;
+static int g_iCellLUTSize = 64;		// power of two
+
+// Optional two channel derivative maps generated on the CPU (see
+// cputools/deriv_map.h). When enabled nmap passed to the bump functions
+// is such a map and sampleDeriv() decodes it without any divide.
+static bool g_bDerivMapEnabled = false;
+static float g_fDerivMapScale = 1.0;
+
 // Output:\ weights associated with each hex tile and integer centers
 void TriangleGrid(out float w1, out float w2, out float w3, 
 				  out int2 vertex1, out int2 vertex2, out int2 vertex3,
@@ -45,6 +59,7 @@ float2 hash( float2 p)
 
 float2 sampleDeriv(Texture2D nmap, SamplerState samp, float2 st, float2 dSTdx, float2 dSTdy);
 float2x2 LoadRot2x2(int2 idx, float rotStrength);
+void LoadCellRotAndOffset(out float2x2 rot, out float2 offs, int2 vertex, float rotStrength);
 float2 MakeCenST(int2 Vertex);
 float3 Gain3(float3 x, float r);
 float3 ProduceHexWeights(float3 W, int2 vertex1, int2 vertex2, int2 vertex3);
@@ -66,17 +81,19 @@ void bumphex2derivNMap(out float2 deriv, out float3 weights,
 	int2 vertex1, vertex2, vertex3;
 	TriangleGrid(w1, w2, w3, vertex1, vertex2, vertex3, st);
 
-	float2x2 rot1 = LoadRot2x2(vertex1, rotStrength);
-	float2x2 rot2 = LoadRot2x2(vertex2, rotStrength);
-	float2x2 rot3 = LoadRot2x2(vertex3, rotStrength);
+	float2x2 rot1, rot2, rot3;
+	float2 offs1, offs2, offs3;
+	LoadCellRotAndOffset(rot1, offs1, vertex1, rotStrength);
+	LoadCellRotAndOffset(rot2, offs2, vertex2, rotStrength);
+	LoadCellRotAndOffset(rot3, offs3, vertex3, rotStrength);
 
 	float2 cen1 = MakeCenST(vertex1);
 	float2 cen2 = MakeCenST(vertex2);
 	float2 cen3 = MakeCenST(vertex3);
 
-	float2 st1 = mul(st - cen1, rot1) + cen1 + hash(vertex1);
-	float2 st2 = mul(st - cen2, rot2) + cen2 + hash(vertex2);
-	float2 st3 = mul(st - cen3, rot3) + cen3 + hash(vertex3);
+	float2 st1 = mul(st - cen1, rot1) + cen1 + offs1;
+	float2 st2 = mul(st - cen2, rot2) + cen2 + offs2;
+	float2 st3 = mul(st - cen3, rot3) + cen3 + offs3;
 
 	// Fetch input
 	float2 d1 = sampleDeriv(nmap, samp, st1, 
@@ -118,17 +135,19 @@ void hex2colTex(out float4 color, out float3 weights,
 	int2 vertex1, vertex2, vertex3;
 	TriangleGrid(w1, w2, w3, vertex1, vertex2, vertex3, st);
 
-	float2x2 rot1 = LoadRot2x2(vertex1, rotStrength);
-	float2x2 rot2 = LoadRot2x2(vertex2, rotStrength);
-	float2x2 rot3 = LoadRot2x2(vertex3, rotStrength);
+	float2x2 rot1, rot2, rot3;
+	float2 offs1, offs2, offs3;
+	LoadCellRotAndOffset(rot1, offs1, vertex1, rotStrength);
+	LoadCellRotAndOffset(rot2, offs2, vertex2, rotStrength);
+	LoadCellRotAndOffset(rot3, offs3, vertex3, rotStrength);
 
 	float2 cen1 = MakeCenST(vertex1);
 	float2 cen2 = MakeCenST(vertex2);
 	float2 cen3 = MakeCenST(vertex3);
 
-	float2 st1 = mul(st - cen1, rot1) + cen1 + hash(vertex1);
-	float2 st2 = mul(st - cen2, rot2) + cen2 + hash(vertex2);
-	float2 st3 = mul(st - cen3, rot3) + cen3 + hash(vertex3);
+	float2 st1 = mul(st - cen1, rot1) + cen1 + offs1;
+	float2 st2 = mul(st - cen2, rot2) + cen2 + offs2;
+	float2 st3 = mul(st - cen3, rot3) + cen3 + offs3;
 
 	// Fetch input
 	float4 c1 = tex.SampleGrad(samp, st1, 
@@ -152,6 +171,76 @@ void hex2colTex(out float4 color, out float3 weights,
 }
 
 
+// Stochastic variant of hex2colTex() which fetches a single tile chosen
+// with probability given by the blend weight. Meant to be resolved by
+// temporal accumulation. The luminance term of hex2colTex() needs all three
+// fetches so the weights here are those of the barycentrics alone.
+// Input:\ xi is a per pixel threshold in [0;1) which varies from frame to frame
+// Output:\ weights is one for the selected hex tile
+void hex2colTexStochastic(out float4 color, out float3 weights,
+						  Texture2D tex, SamplerState samp, float2 st,
+						  float rotStrength, float xi, float r=0.5)
+{
+	float2 dSTdx = ddx(st), dSTdy = ddy(st);
+
+	// Get triangle info
+	float w1, w2, w3;
+	int2 vertex1, vertex2, vertex3;
+	TriangleGrid(w1, w2, w3, vertex1, vertex2, vertex3, st);
+
+	float3 W = pow(float3(w1, w2, w3), g_exp);	// 7
+	W /= (W.x+W.y+W.z);
+	if(r!=0.5) W = Gain3(W, r);
+
+	// pick one tile
+	float3 sel = float3(xi<W.x, xi>=W.x && xi<(W.x+W.y), xi>=(W.x+W.y));
+	int2 vertex = sel.x!=0 ? vertex1 : (sel.y!=0 ? vertex2 : vertex3);
+
+	float2x2 rot;
+	float2 offs;
+	LoadCellRotAndOffset(rot, offs, vertex, rotStrength);
+
+	float2 cen = MakeCenST(vertex);
+	float2 st1 = mul(st - cen, rot) + cen + offs;
+
+	color = tex.SampleGrad(samp, st1, mul(dSTdx, rot), mul(dSTdy, rot));
+	weights = ProduceHexWeights(sel, vertex1, vertex2, vertex3);
+}
+
+// Stochastic variant of bumphex2derivNMap(), see hex2colTexStochastic()
+void bumphex2derivNMapStochastic(out float2 deriv, out float3 weights,
+								 Texture2D nmap, SamplerState samp, float2 st,
+								 float rotStrength, float xi, float r=0.5)
+{
+	float2 dSTdx = ddx(st), dSTdy = ddy(st);
+
+	// Get triangle info
+	float w1, w2, w3;
+	int2 vertex1, vertex2, vertex3;
+	TriangleGrid(w1, w2, w3, vertex1, vertex2, vertex3, st);
+
+	float3 W = pow(float3(w1, w2, w3), g_exp);	// 7
+	W /= (W.x+W.y+W.z);
+	if(r!=0.5) W = Gain3(W, r);
+
+	// pick one tile
+	float3 sel = float3(xi<W.x, xi>=W.x && xi<(W.x+W.y), xi>=(W.x+W.y));
+	int2 vertex = sel.x!=0 ? vertex1 : (sel.y!=0 ? vertex2 : vertex3);
+
+	float2x2 rot;
+	float2 offs;
+	LoadCellRotAndOffset(rot, offs, vertex, rotStrength);
+
+	float2 cen = MakeCenST(vertex);
+	float2 st1 = mul(st - cen, rot) + cen + offs;
+
+	float2 d = sampleDeriv(nmap, samp, st1, mul(dSTdx, rot), mul(dSTdy, rot));
+
+	deriv = mul(rot, d);
+	weights = ProduceHexWeights(sel, vertex1, vertex2, vertex3);
+}
+
+
 float2 MakeCenST(int2 Vertex)
 {
 	float2x2 invSkewMat = float2x2(1.0, 0.5, 0.0, 1.0/1.15470054);
@@ -175,6 +264,40 @@ float2x2 LoadRot2x2(int2 idx, float rotStrength)
 	return float2x2(cs, -si, si, cs);
 }
 
+// rotStrength is baked into the table when g_bCellLUTEnabled is set
+void LoadCellRotAndOffset(out float2x2 rot, out float2 offs, int2 vertex, float rotStrength)
+{
+	if(g_bCellLUTEnabled)
+	{
+		int2 idx = vertex & (g_iCellLUTSize-1);
+		float4 cell = g_hexCellLUT[idx.y*g_iCellLUTSize + idx.x];
+		rot = float2x2(cell.x, -cell.y, cell.y, cell.x);
+		offs = cell.zw;
+	}
+	else
+	{
+		rot = LoadRot2x2(vertex, rotStrength);
+		offs = hash(vertex);
+	}
+}
+
+// Footprint driven fallback to a single regular tiling fetch. When the lod
+// gets within lodStart levels of the 1x1 mip the three taps converge on the
+// same blurred mip and the result fades to 1 over lodRange levels, at which
+// point a single fetch suffices. Coarse derivatives make the result uniform
+// across the 2x2 quad so branching on it keeps the derivatives of st valid.
+// See cputools/hextile_lod.h for choosing lodStart from an error bound.
+float HexLodFallbackWeight(Texture2D tex, float2 st, float lodStart, float lodRange)
+{
+	uint w, h, nrLevels;
+	tex.GetDimensions(0, w, h, nrLevels);
+
+	float2 dx = ddx_coarse(st)*float2(w,h), dy = ddy_coarse(st)*float2(w,h);
+	float lod = 0.5*log2(max(dot(dx,dx), dot(dy,dy)));
+
+	return saturate((lod - ((nrLevels-1) - lodStart)) / lodRange);
+}
+
 float3 ProduceHexWeights(float3 W, int2 vertex1, int2 vertex2, int2 vertex3)
 {
 	float3 res = 0.0;
@@ -212,7 +335,10 @@ float3 Gain3(float3 x, float r)
 float2 sampleDeriv(Texture2D nmap, SamplerState samp, float2 st, float2 dSTdx, float2 dSTdy)
 {
 	// sample
-	float3 vM = 2.0*nmap.SampleGrad(samp, st, dSTdx, dSTdy)-1.0;
+	float4 texel = nmap.SampleGrad(samp, st, dSTdx, dSTdy);
+	if(g_bDerivMapEnabled) return g_fDerivMapScale*(2.0*texel.xy-1.0);
+
+	float3 vM = 2.0*texel.xyz-1.0;
 	return TspaceNormalToDerivative(vM);
 }
 
@@ -6,6 +6,9 @@
 // this is done by assuming relative world space (RWS) is used to
 // produce the sampling coordinate st but the offset to absolute world
 // space is used to produce the (per frame) constant st_offs (scale by tile rate is applied to both)
+// The offset is split on the CPU in double precision (see cputools/large_world.h)
+// into cell_offs whole cells of the skewed grid, the remainder st_offs, and cen_offs
+// which is frac() of the st of the removed cells. Thus every float involved stays small.
 
 #include "hextiling.h"
 
@@ -14,7 +17,7 @@
 // Output:\ weights associated with each hex tile and integer centers
 void TriangleGridRWS(out float w1, out float w2, out float w3, 
 				  out int2 vertex1, out int2 vertex2, out int2 vertex3,
-				  float2 st, float2 st_offs)
+				  float2 st, float2 st_offs, int2 cell_offs)
 {
 	// Scaling of the input
 	st *= 2 * sqrt(3);
@@ -26,10 +29,9 @@ void TriangleGridRWS(out float w1, out float w2, out float w3,
 	float2 skewedCoord = mul(gridToSkewedGrid, st);
 	float2 skewedCoord_offs = mul(gridToSkewedGrid, st_offs);
 
-	// separate out large 2D integer offset
-	int2 baseId_offs = int2( floor( skewedCoord_offs ));
-	float2 comb_skew = skewedCoord + frac(skewedCoord_offs);
-	int2 baseId = int2( floor( comb_skew )) + baseId_offs;
+	// large 2D integer offset was separated out on the CPU
+	float2 comb_skew = skewedCoord + skewedCoord_offs;
+	int2 baseId = int2( floor( comb_skew )) + cell_offs;
 	float3 temp = float3( frac( comb_skew ), 0);
 	temp.z = 1.0 - temp.x - temp.y;
 
@@ -50,7 +52,7 @@ void TriangleGridRWS(out float w1, out float w2, out float w3,
 // Output:\ deriv is a derivative dHduv wrt units in pixels
 // Output:\ weights shows the weight of each hex tile
 void bumphex2derivNMapRWS(out float2 deriv, out float3 weights,
-					   Texture2D nmap, SamplerState samp, float2 st, float2 st_offs,
+					   Texture2D nmap, SamplerState samp, float2 st, float2 st_offs, float2 cen_offs, int2 cell_offs,
 					   float rotStrength, float r=0.5)
 {
 	float2 dSTdx = ddx(st), dSTdy = ddy(st);
@@ -58,19 +60,22 @@ void bumphex2derivNMapRWS(out float2 deriv, out float3 weights,
 	// Get triangle info
 	float w1, w2, w3;
 	int2 vertex1, vertex2, vertex3;
-	TriangleGridRWS(w1, w2, w3, vertex1, vertex2, vertex3, st, st_offs);
+	TriangleGridRWS(w1, w2, w3, vertex1, vertex2, vertex3, st, st_offs, cell_offs);
 
-	float2x2 rot1 = LoadRot2x2(vertex1, rotStrength);
-	float2x2 rot2 = LoadRot2x2(vertex2, rotStrength);
-	float2x2 rot3 = LoadRot2x2(vertex3, rotStrength);
+	float2x2 rot1, rot2, rot3;
+	float2 offs1, offs2, offs3;
+	LoadCellRotAndOffset(rot1, offs1, vertex1, rotStrength);
+	LoadCellRotAndOffset(rot2, offs2, vertex2, rotStrength);
+	LoadCellRotAndOffset(rot3, offs3, vertex3, rotStrength);
 
-	float2 cen1 = MakeCenST(vertex1);
-	float2 cen2 = MakeCenST(vertex2);
-	float2 cen3 = MakeCenST(vertex3);
+	// centers relative to the removed cells
+	float2 cen1 = MakeCenST(vertex1 - cell_offs);
+	float2 cen2 = MakeCenST(vertex2 - cell_offs);
+	float2 cen3 = MakeCenST(vertex3 - cell_offs);
 
-	float2 st1 = mul(st, rot1) + frac(mul(st_offs - cen1, rot1) + cen1) + hash(vertex1);
-	float2 st2 = mul(st, rot2) + frac(mul(st_offs - cen2, rot2) + cen2) + hash(vertex2);
-	float2 st3 = mul(st, rot3) + frac(mul(st_offs - cen3, rot3) + cen3) + hash(vertex3);
+	float2 st1 = mul(st, rot1) + frac(mul(st_offs - cen1, rot1) + cen1 + cen_offs) + offs1;
+	float2 st2 = mul(st, rot2) + frac(mul(st_offs - cen2, rot2) + cen2 + cen_offs) + offs2;
+	float2 st3 = mul(st, rot3) + frac(mul(st_offs - cen3, rot3) + cen3 + cen_offs) + offs3;
 
 	// Fetch input
 	float2 d1 = sampleDeriv(nmap, samp, st1, 
@@ -102,7 +107,7 @@ void bumphex2derivNMapRWS(out float2 deriv, out float3 weights,
 // Output:\ color is the blended result
 // Output:\ weights shows the weight of each hex tile
 void hex2colTexRWS(out float4 color, out float3 weights,
-				Texture2D tex, SamplerState samp, float2 st, float2 st_offs,
+				Texture2D tex, SamplerState samp, float2 st, float2 st_offs, float2 cen_offs, int2 cell_offs,
 				float rotStrength, float r=0.5)
 {
 	float2 dSTdx = ddx(st), dSTdy = ddy(st);
@@ -110,19 +115,22 @@ void hex2colTexRWS(out float4 color, out float3 weights,
 	// Get triangle info
 	float w1, w2, w3;
 	int2 vertex1, vertex2, vertex3;
-	TriangleGridRWS(w1, w2, w3, vertex1, vertex2, vertex3, st, st_offs);
-
-	float2x2 rot1 = LoadRot2x2(vertex1, rotStrength);
-	float2x2 rot2 = LoadRot2x2(vertex2, rotStrength);
-	float2x2 rot3 = LoadRot2x2(vertex3, rotStrength);
-
-	float2 cen1 = MakeCenST(vertex1);
-	float2 cen2 = MakeCenST(vertex2);
-	float2 cen3 = MakeCenST(vertex3);
-
-	float2 st1 = mul(st, rot1) + frac(mul(st_offs - cen1, rot1) + cen1) + hash(vertex1);
-	float2 st2 = mul(st, rot2) + frac(mul(st_offs - cen2, rot2) + cen2) + hash(vertex2);
-	float2 st3 = mul(st, rot3) + frac(mul(st_offs - cen3, rot3) + cen3) + hash(vertex3);
+	TriangleGridRWS(w1, w2, w3, vertex1, vertex2, vertex3, st, st_offs, cell_offs);
+
+	float2x2 rot1, rot2, rot3;
+	float2 offs1, offs2, offs3;
+	LoadCellRotAndOffset(rot1, offs1, vertex1, rotStrength);
+	LoadCellRotAndOffset(rot2, offs2, vertex2, rotStrength);
+	LoadCellRotAndOffset(rot3, offs3, vertex3, rotStrength);
+
+	// centers relative to the removed cells
+	float2 cen1 = MakeCenST(vertex1 - cell_offs);
+	float2 cen2 = MakeCenST(vertex2 - cell_offs);
+	float2 cen3 = MakeCenST(vertex3 - cell_offs);
+
+	float2 st1 = mul(st, rot1) + frac(mul(st_offs - cen1, rot1) + cen1 + cen_offs) + offs1;
+	float2 st2 = mul(st, rot2) + frac(mul(st_offs - cen2, rot2) + cen2 + cen_offs) + offs2;
+	float2 st3 = mul(st, rot3) + frac(mul(st_offs - cen3, rot3) + cen3 + cen_offs) + offs3;
 
 	// Fetch input
 	float4 c1 = tex.SampleGrad(samp, st1, 
@@ -2,6 +2,7 @@
 #include "objreader.h"
 #include "mikktspace.h"
 #include "weldmesh.h"
+#include "../cputools/shadow_hull.h"
 
 
 
@@ -372,6 +373,16 @@ bool CMeshDraw::ReadObj(ID3D11Device* pd3dDev, const char file_name[], const flo
 				vMin -= vCen; vMax -= vCen;
 			}
 			m_vMin = vMin; m_vMax = vMax;
+
+			// small hull for fitting the shadow cascades
+			std::vector<float> hull;
+			m_iNrHullVerts = BuildShadowKDopHull(hull, &m_vVerts[0].pos.x, sizeof(SFilVert)/sizeof(float), m_iNrVerts);
+			if(m_iNrHullVerts>0)
+			{
+				m_pfHull = new float[3*m_iNrHullVerts];
+				if(m_pfHull!=NULL) memcpy(m_pfHull, &hull[0], 3*m_iNrHullVerts*sizeof(float));
+				else m_iNrHullVerts = 0;
+			}
 		}
 		else res=false;
 	}
@@ -454,6 +465,8 @@ void CMeshDraw::CleanUp()
 
 	if(m_iIndices!=NULL) { delete [] m_iIndices; m_iIndices=NULL; }
 	if(m_vVerts!=NULL) { delete [] m_vVerts; m_vVerts=NULL; }
+	if(m_pfHull!=NULL) { delete [] m_pfHull; m_pfHull=NULL; }
+	m_iNrHullVerts = 0;
 }
 
 
@@ -463,6 +476,8 @@ CMeshDraw::CMeshDraw()
 	m_iNrTriangles = 0;
 	m_vVerts = NULL;
 	m_iIndices = NULL;
+	m_pfHull = NULL;
+	m_iNrHullVerts = 0;
 
 	m_pVertStream = NULL;
 	m_pIndexStream = NULL;
@@ -32,6 +32,8 @@ public:
 	ID3D11Buffer * GetIndexBuffer() { return m_pIndexStream; }
 	const Vec3 GetMin() const { return m_vMin; }
 	const Vec3 GetMax() const { return m_vMax; }
+	const float * GetHull() const { return m_pfHull; }		// SoA, see shadow_hull.h
+	int GetNrHullVerts() const { return m_iNrHullVerts; }
 
 
 	CMeshDraw();
@@ -48,6 +50,9 @@ private:
 
 	Vec3 m_vMin, m_vMax;
 
+	float * m_pfHull;
+	int m_iNrHullVerts;
+
 private:	// d3d specific
 	ID3D11Buffer * m_pVertStream;
 	ID3D11Buffer * m_pIndexStream;
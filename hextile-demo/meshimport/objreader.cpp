@@ -66,7 +66,7 @@ const Vec3 CObjReader::GetFaceNormal(const int iFaceIndex, const int iVertIndex)
 	return m_pNormals[ face_vertex.iNrmIndex ];
 }
 
-const bool CObjReader::HaveSecondaryUVs() const
+bool CObjReader::HaveSecondaryUVs() const
 {
 	return m_iNrTexCoords2>0;
 }
@@ -322,8 +322,7 @@ int CObjReader::ReadSingleFace(const char * pText, const int iCurLocation, const
 {
 	int iCur = iCurLocation;
 
-	const bool bIsFace = strncmp(pText+iCur, "f ", 2)==0 || strncmp(pText+iCur, "f\t", 2)==0;
-	assert(bIsFace);
+	assert(strncmp(pText+iCur, "f ", 2)==0 || strncmp(pText+iCur, "f\t", 2)==0);
 
 	// skip f
 	++iCur;
@@ -18,7 +18,7 @@ public:
 	const Vec3 GetFaceTexCoord(const int iFaceIndex, const int iVertIndex) const;
 	const Vec3 GetFaceTexCoord2(const int iFaceIndex, const int iVertIndex) const;
 	const Vec3 GetFaceNormal(const int iFaceIndex, const int iVertIndex) const;
-	const bool HaveSecondaryUVs() const;
+	bool HaveSecondaryUVs() const;
 
 
 	CObjReader();
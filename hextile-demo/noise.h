@@ -4,6 +4,10 @@
 Buffer<uint> g_uPermTable;
 Buffer<float3> g_v3GradArray;
 
+// tileable (value, gradient) of a periodic mydsnoise(), see cputools/noise_volume.h
+Texture3D g_noiseVolume;
+SamplerState g_samNoiseVolume;		// trilinear wrap
+
 
 
 
@@ -194,6 +198,86 @@ float4 mydnoise(float3 p)
 }
 
 
+// SIMPLEX noise. The 4 corners of the tetrahedron containing p on the
+// skewed lattice instead of the 8 corners of the cube, hashed with the
+// permutation and gradients of mysnoise(). Each corner contributes
+// (0.5 - r^2)^4 * dot(grad, offset), the radius keeps a kernel within
+// the simplices sharing its corner so the sum is C1 and the gradient is
+// analytic. SIMPLEX_SCALE and SIMPLEX_FREQ match the standard deviation
+// and mean frequency of mysnoise() such that the filtering of the octaves
+// holds, see CompareSimplexToPerlin() in cputools/noise_cpu.h.
+#define SIMPLEX_SCALE		52.9
+#define SIMPLEX_FREQ		0.58
+
+void SimplexCorners(out int iHash[4], out float3 vX[4], float3 p_in)
+{
+	float3 p = SIMPLEX_FREQ*p_in;
+
+	const float F3 = 1.0/3.0;
+	const float G3 = 1.0/6.0;
+
+	// skew to the cubic lattice and back
+	float3 i0 = floor(p + dot(p, float3(F3,F3,F3)));
+	float3 x0 = p - i0 + dot(i0, float3(G3,G3,G3));
+
+	// rank order of the components picks one of the 6 simplices of the cube
+	float3 g = step(x0.yzx, x0.xyz);
+	float3 l = 1 - g;
+	float3 i1 = min(g.xyz, l.zxy);
+	float3 i2 = max(g.xyz, l.zxy);
+
+	vX[0] = x0;
+	vX[1] = x0 - i1 + G3;
+	vX[2] = x0 - i2 + 2*G3;
+	vX[3] = x0 - 1 + 3*G3;
+
+	int3 P = (int3) i0;
+	P &= int3(255,255,255);
+	int3 I1 = (int3) i1;
+	int3 I2 = (int3) i2;
+	iHash[0] = perm(perm(perm(P.x) + P.y) + P.z);
+	iHash[1] = perm(perm(perm(P.x + I1.x) + P.y + I1.y) + P.z + I1.z);
+	iHash[2] = perm(perm(perm(P.x + I2.x) + P.y + I2.y) + P.z + I2.z);
+	iHash[3] = perm(perm(perm(P.x + 1) + P.y + 1) + P.z + 1);
+}
+
+float mysimplex(float3 p)
+{
+	int iHash[4]; float3 vX[4];
+	SimplexCorners(iHash, vX, p);
+
+	float noise = 0;
+	for(int c=0; c<4; c++)
+	{
+		float t = max(0, 0.5 - dot(vX[c], vX[c]));
+		float t2 = t*t;
+		noise += (t2*t2) * grad(iHash[c], vX[c]);
+	}
+
+	return SIMPLEX_SCALE*noise;
+}
+
+float4 mydssimplex(float3 p)
+{
+	int iHash[4]; float3 vX[4];
+	SimplexCorners(iHash, vX, p);
+
+	float4 dNoise = 0;
+	for(int c=0; c<4; c++)
+	{
+		float3 vGrad = get_grad(iHash[c]);
+		float t = max(0, 0.5 - dot(vX[c], vX[c]));
+		float t2 = t*t;
+		float t4 = t2*t2;
+		float d = dot(vGrad, vX[c]);
+		dNoise += float4(t4*d, t4*vGrad - (8*t2*t*d)*vX[c]);
+	}
+
+	// (height, gradient)
+	return SIMPLEX_SCALE*float4(1, SIMPLEX_FREQ, SIMPLEX_FREQ, SIMPLEX_FREQ)*dNoise;
+}
+
+
 //dNoise.w = dot(dNoise.xyz, p)
 	//			- u*vB.x - v*vC.y - w*vE.z +
 	//			u*v*(vB.x+vC.y-vD.x-vD.y) + v*w * (vC.y+vE.z-vG.y-vG.z) + u*w * (vB.x+vE.z-vF.x-vF.z) +
@@ -223,10 +307,33 @@ float filteredabs(float x, float dx)
 	return (sign(x1)*x1*x1 - sign(x0)*x0*x0) / (2*dx);
 }
 
+float4 filtereddssimplex(float3 p, float width)
+{
+	return mydssimplex(p) * (1 - smoothstep(0.25,0.75,width));
+}
+
+// filteredabs() of x.x and its gradient given the gradient of x in .yzw
+float4 dfilteredabs(float4 x, float dx)
+{
+	float x0 = x.x-0.5*dx;
+	float x1 = x.x+0.5*dx;
+	float dabs = (abs(x1) - abs(x0)) / dx;
+	return float4((sign(x1)*x1*x1 - sign(x0)*x0*x0) / (2*dx), dabs*x.yzw);
+}
+
 
 // FRACTAL SUM
 #define NEW_METHOD
 
+// With SIMPLEX_DERIVS dfractalsum() and dturbulence() sum mydssimplex()
+// octaves, dturbulence() then differentiates filteredabs() analytically
+// rather than evaluating turbulence() four times. The value only, MAX and
+// VOLUME versions keep using mysnoise(). CompareSimplexToPerlin() in
+// cputools/noise_cpu.h checks the two match in amplitude and spectrum.
+// Comment out to go back to mysnoise(), and build cputools with
+// HEXTILE_SIMPLEX_DERIVS=OFF to match.
+#define SIMPLEX_DERIVS
+
 float fractalsum(float3 P, float fPixSize_in=1)
 {
 	float fracsum = 0;
@@ -270,7 +377,11 @@ float4 dfractalsum(float3 P, float fPixSize_in=1)
 	float fw = fPixSize;	// should clamp this
 	while(fw < 1.0)
 	{
+#ifdef SIMPLEX_DERIVS
+		fracsum += float4((1/freq),1,1,1) * filtereddssimplex(P*freq, fw);
+#else
 		fracsum += float4((1/freq),1,1,1) * filtereddsnoise(P*freq, fw);
+#endif
 		freq*=2; fw *= 2;
 	}
 #else
@@ -324,6 +435,20 @@ float turbulence(float3 P, float fPixSize_in=1)
 
 float4 dturbulence(float3 P, float fPixSize_in=1)
 {
+#ifdef SIMPLEX_DERIVS
+	float4 turbulence = 0;
+	float fPixSize = VerifyPixSize(fPixSize_in);
+
+	float freq = 1;
+	float fw = fPixSize;
+	while(fw < 1.0)
+	{
+		turbulence += float4((1/freq),1,1,1) * dfilteredabs( filtereddssimplex(P*freq, fw), 2*fw);
+		freq*=2; fw *= 2;
+	}
+
+	return turbulence;
+#else
 	float pixSize = VerifyPixSize(fPixSize_in);
 
 	float Ncen = turbulence( P, pixSize );
@@ -334,6 +459,95 @@ float4 dturbulence(float3 P, float fPixSize_in=1)
 	float3 grad = (1.0/pixSize)*float3(Nrgt-Ncen, Nup-Ncen, Ndpth-Ncen);
 
 	return float4(Ncen, grad.xyz);
+#endif
+}
+
+// VOLUME versions. The low octaves, at which the pixel is smaller than a
+// texel of g_noiseVolume (fTexelSize lattice units, well below one cell),
+// are sampled from the volume which spans fPeriod lattice cells. There it
+// is magnified and the trilinear fetch interpolates the smooth noise. The
+// fine octaves, at which the volume would be minified without mips, evaluate
+// the noise procedurally and are faded out by the filter near the pixel
+// size. The volume repeats so the low octaves are not the ones of mysnoise().
+// Between half a texel and a texel per pixel the octave crossfades from the
+// volume to mysnoise() such that no octave pops as the pixel size changes.
+// The two are uncorrelated so the blend is rescaled to keep the variance.
+float4 SampleNoiseVolume(float3 p, float fPeriod)
+{
+	return g_noiseVolume.SampleLevel(g_samNoiseVolume, p / fPeriod, 0);
+}
+
+float4 dsnoisevol(float3 p, float fw, float fPeriod, float fTexelSize)
+{
+	float t = smoothstep(0.5*fTexelSize, fTexelSize, fw);
+
+	float4 dsn = 0;
+	if(t<1) dsn += (1-t) * SampleNoiseVolume(p, fPeriod);
+	if(t>0) dsn += t * mydsnoise(p);
+
+	return dsn * rsqrt((1-t)*(1-t) + t*t);
+}
+
+float snoisevol(float3 p, float fw, float fPeriod, float fTexelSize)
+{
+	float t = smoothstep(0.5*fTexelSize, fTexelSize, fw);
+
+	float sn = 0;
+	if(t<1) sn += (1-t) * SampleNoiseVolume(p, fPeriod).x;
+	if(t>0) sn += t * mysnoise(p);
+
+	return sn * rsqrt((1-t)*(1-t) + t*t);
+}
+
+float fractalsumvol(float3 P, float fPixSize_in, float fPeriod, float fTexelSize)
+{
+	float fracsum = 0;
+	float fPixSize = VerifyPixSize(fPixSize_in);
+
+	float freq = 1;
+	float fw = fPixSize;
+	while(fw < 1.0)
+	{
+		float sn = snoisevol(P*freq, fw, fPeriod, fTexelSize);
+		fracsum += (1/freq) * sn * (1 - smoothstep(0.25,0.75,fw));
+		freq*=2; fw *= 2;
+	}
+
+	return fracsum;
+}
+
+float4 dfractalsumvol(float3 P, float fPixSize_in, float fPeriod, float fTexelSize)
+{
+	float4 fracsum = 0;
+	float fPixSize = VerifyPixSize(fPixSize_in);
+
+	float freq = 1;
+	float fw = fPixSize;
+	while(fw < 1.0)
+	{
+		float4 dsn = dsnoisevol(P*freq, fw, fPeriod, fTexelSize);
+		fracsum += float4((1/freq),1,1,1) * dsn * (1 - smoothstep(0.25,0.75,fw));
+		freq*=2; fw *= 2;
+	}
+
+	return fracsum;
+}
+
+float turbulencevol(float3 P, float fPixSize_in, float fPeriod, float fTexelSize)
+{
+	float turbulence = 0;
+	float fPixSize = VerifyPixSize(fPixSize_in);
+
+	float freq = 1;
+	float fw = fPixSize;
+	while(fw < 1.0)
+	{
+		float sn = snoisevol(P*freq, fw, fPeriod, fTexelSize);
+		turbulence += (1/freq) * filteredabs( sn * (1 - smoothstep(0.25,0.75,fw)), 2*fw);
+		freq*=2; fw *= 2;
+	}
+
+	return turbulence;
 }
 
 // MAX versions. As an optimization only the last (highest) frequencies are accumulated
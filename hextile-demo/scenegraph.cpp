@@ -7,6 +7,25 @@
 #include "std_cbuffer.h"
 #include "custom_cbuffers.h"
 #include "buffer.h"
+#include "cputools/hextile_lut.h"
+#include "cputools/deriv_map.h"
+#include "cputools/large_world.h"
+#include "cputools/histo_preserv.h"
+#include "cputools/noise_cpu.h"
+#include "cputools/noise_volume.h"
+#include "cputools/scene_desc.h"
+#include "cputools/instance_batch.h"
+#include "cputools/transform_hierarchy.h"
+#include "cputools/instance_bvh.h"
+#include "cputools/draw_list.h"
+#include "cputools/command_list.h"
+#include "cputools/parallel_for.h"
+#include "commandlist_d3d11.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <float.h>
 
 
 #include <d3d11_2.h>
@@ -21,61 +40,29 @@
 
 static Vec3 g_vSunDir;
 
+// the scene is data, see cputools/scene_desc.h. The text form is what gets
+// edited, the binary form is written next to it and used while it is newer.
+#define SCENE_FILE			"scenes/default.scene"
+#define SCENE_FILE_BINARY	"scenes/default.sceneb"
 
-enum TEX_ID
-{
-	PIRATE_ALBEDO=0,
-	PIRATE_OCCLUSION,
-	PIRATE_SMOOTHNESS,
-	PIRATE_NORMALS_TS,
-	PIRATE_MASK,
-
-	ROCK_BASE_TS,
-
-	TRX_JAGUAR,
-	TRX_GRASS_SHORT_D=TRX_JAGUAR+4,
-	TRX_MOSSGROUND_D=TRX_GRASS_SHORT_D+4,
-	TRX_NATURE_PEBBLES_D=TRX_MOSSGROUND_D+4,
-		
-	TRX_PEBBLES_BEACH_CROP_N=TRX_NATURE_PEBBLES_D+4,
-	TRX_SEAN_MICRO_N=TRX_PEBBLES_BEACH_CROP_N+4,
-	TRX_SNOW_MELT_02A_N=TRX_SEAN_MICRO_N+4,
-	TRX_SNOW_MELT_04A_N=TRX_SNOW_MELT_02A_N+4,
-	
-	TABLE_FG = TRX_SNOW_MELT_04A_N+4,
+static SSceneDesc g_scene;
 
-	NUM_TEXTURES
-};
-
-static ID3D11ShaderResourceView * g_pTexturesHandler[NUM_TEXTURES];
+// detail textures take 4 slots, the texture and its histogram-preserving
+// attachments, see ImportTextureTRX()
+static std::vector<ID3D11ShaderResourceView *> g_pTexturesHandler;
+static std::vector<int> g_iTextureSlot;				// per scene texture
 
-enum MESH_ID
-{
-	MESH_QUAD,
-	MESH_SPHERE,
-	MESH_PIRATE,
-	MESH_ROCK,
-	
-	NUM_MESHES
-};
+// derivative map versions of the detail normal maps
+static std::vector<int> g_iDerivMapIdx;				// per scene texture, -1 when it has none
+static std::vector<ID3D11ShaderResourceView *> g_pDerivMapsHandler;
+static std::vector<SDerivMapStats> g_DerivMapStats;
 
-static CMeshDraw g_pMeshes[NUM_MESHES];
+// the scene textures the materials cycle through, in the order of the scene
+static std::vector<int> g_detailColorTex, g_detailNormalTex;
 
-#define MODEL_PATH		"meshes/"
+static std::vector<CMeshDraw> g_pMeshes;
 
 
-
-enum DRAWABLE_ID
-{
-	GROUND_EXAMPLE=0,
-	SPHERE_EXAMPLE,
-
-	PIRATE_EXAMPLE,
-	ROCK_EXAMPLE,
-	
-	NUM_DRAWABLES
-};
-
 enum
 {
 	JUST_ONE_VARIANT=0,
@@ -92,16 +79,52 @@ static DWORD g_dwShaderFlags;
 static CShader g_vert_shader;
 static CShader g_vert_shader_basic;
 static CShader g_pix_shader_basic_white;
-static CShader g_pix_shader[NUM_PS_VARIANTS*NUM_DRAWABLES];
 
-static CShaderPipeline g_ShaderPipelines_DepthOnly[NUM_DRAWABLES];
-static CShaderPipeline g_ShaderPipelines[NUM_PS_VARIANTS*NUM_DRAWABLES];
+// per material, variant j of material m at j*nrMaterials+m
+static std::vector<CShader> g_pix_shader;
+static std::vector<CShaderPipeline> g_ShaderPipelines;
+static std::vector<int> g_materialPipeline;		// per material, the first material with the same pixel shader and define
+static std::vector<ID3D11Buffer *> g_pMaterialParamsCB;
+
+// per instance
+static STransformHierarchy g_transforms;		// by instance, the roots relative to the current origin, see RebaseSceneGraph()
+static std::vector<Mat44> g_mLocToWorldSetup;	// location to parent
+static std::vector<Vec3d> g_vInstancePos;		// absolute, in double, of the roots
+static int g_iNrTransformsUpdated = 0;			// by the last RebaseSceneGraph()
+static std::vector<int> g_instanceMesh, g_instanceMaterial;
+static Vec3d g_vWorldOffset;
+
+static std::vector<int> g_shadowCasters;		// instances that cast shadows
+static int g_iGroundInstance = -1;
+
+// instances sharing a mesh and a material are drawn with one
+// DrawIndexedInstanced(), see cputools/instance_batch.h
+static CBufferObject g_InstanceTransformsBuffer;		// SInstanceTransform per instance
+static ID3D11Buffer * g_pInstanceBatchCB = NULL;
+static std::vector<SInstanceTransform> g_instanceTransforms;
+static std::vector<SInstanceBatch> g_instanceBatches;
+static std::vector<int> g_instanceOrder, g_instanceList;
+static SInstanceBatchStats g_instanceBatchStats;		// of the last RenderSceneGraph()
+
+// view frustum culling, see cputools/instance_bvh.h
+static SInstanceBVH g_instanceBVH;
+static std::vector<float> g_instanceBounds;		// world space center and half extent in SoA
+static std::vector<int> g_instanceChanged;
+static std::vector<int> g_visibleInstances;		// of the last CullSceneGraph(), shared by the passes
+static SInstanceCullStats g_instanceCullStats;
+static Vec4 g_vClipW;							// row of the world to clip transform giving w, the view depth
+
+// draws in state order with redundant bindings skipped, see cputools/draw_list.h,
+// recorded into command lists in parallel, see cputools/command_list.h
+#define MAX_SCENE_COMMAND_LISTS		8
+#define DRAWS_PER_COMMAND_LIST		256			// at least, fewer aren't worth a thread
+static std::vector<SDrawItem> g_drawItems, g_drawItemsScratch;
+static SCommandList g_commandLists[MAX_SCENE_COMMAND_LISTS];
+static SDrawStateCache g_drawStateCaches[MAX_SCENE_COMMAND_LISTS];
+static int g_iNrCallsWithoutDiffing[MAX_SCENE_COMMAND_LISTS];
+static SDrawSubmitStats g_drawSubmitStats;		// since the last CullSceneGraph()
 
-static ID3D11Buffer * g_pMaterialParamsCB[NUM_DRAWABLES];
-static ID3D11Buffer * g_pMeshInstanceCB[NUM_DRAWABLES];
 static ID3D11Buffer * g_pMeshInstanceCB_forLabels;
-static Mat44 g_mLocToWorld[NUM_DRAWABLES];
-static int g_meshResourceID[NUM_DRAWABLES];
 
 // labels are special
 static CShaderPipeline g_LabelsShaderPipelines;
@@ -111,149 +134,174 @@ static ID3D11InputLayout * g_pVertexLayout = NULL;
 static ID3D11InputLayout * g_pVertexSimpleLayout = NULL;
 
 
-#define str(x) #x
-
-struct SValueAndStr
+static int GetNrMaterials()
 {
-	SValueAndStr(const int value_in, const char str_name_in[]) : value(value_in), str_name(str_name_in) {}
-
-	const int value;
-	const char * str_name;
-};
-
-
-#define MAKE_STR_PAIR(x)	SValueAndStr(x, str(x) )
-#define MAKE_STR_SIZE_PAIR(x) SValueAndStr(sizeof(x), str(x) )
-
-static bool GenericPipelineSetup(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB, const Mat44 &mat, const SValueAndStr &sIdxAndStr, const char pixShaderEntryFunc[], const SValueAndStr sMatSizeAndStr);
-static bool GenericPipelineSetup(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB, const Mat44 &mat, const SValueAndStr &sIdxAndStr, const char pixShaderEntryFunc[])
-{
-	SValueAndStr defaultMatSizeAndName(0,"");
-	return GenericPipelineSetup(pd3dDevice, pContext, pGlobalsCB, mat, sIdxAndStr, pixShaderEntryFunc, defaultMatSizeAndName);
+	return (int) g_scene.materials.size();
 }
 
+static bool LoadSceneDesc(SSceneDesc * pDesc)
+{
+	// binary when it is at least as new as the text
+	WIN32_FILE_ATTRIBUTE_DATA textAttr, binAttr;
+	const bool bHaveText = GetFileAttributesExA(SCENE_FILE, GetFileExInfoStandard, &textAttr)!=0;
+	const bool bHaveBinary = GetFileAttributesExA(SCENE_FILE_BINARY, GetFileExInfoStandard, &binAttr)!=0;
 
-const float g_O = 2*2.59f;
-const float g_S = -1.0f;		// convert unity scene to right hand frame.
+	bool res = false;
+	if(bHaveBinary && (!bHaveText || CompareFileTime(&binAttr.ftLastWriteTime, &textAttr.ftLastWriteTime)>=0))
+		res = ReadSceneDescBinary(pDesc, SCENE_FILE_BINARY);
 
-static void SetScaleAndPos(Mat44 * matPtr, const float scale, const Vec3 &pos)
-{
-	LoadIdentity(matPtr);
-	for(int c=0; c<3; c++)
+	if(!res && bHaveText)
 	{
-		SetColumn(matPtr, c, Vec4(c==0 ? scale : 0.0f, c==1 ? scale : 0.0f, c==2 ? scale : 0.0f, 0.0f));
+		int iErrorLine = 0;
+		res = ReadSceneDescText(pDesc, SCENE_FILE, &iErrorLine);
+		if(res) WriteSceneDescBinary(SCENE_FILE_BINARY, *pDesc);
+		else
+		{
+			char msg[256];
+			sprintf(msg, "%s: invalid scene at line %d\n", SCENE_FILE, iErrorLine);
+			OutputDebugStringA(msg);
+		}
 	}
-	SetColumn(matPtr, 3, Vec4(pos.x, pos.y, pos.z, 1.0f));
-}
-
-static void SetupGroundPlanePipeline(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB)
-{
-	Mat44 mat; SetScaleAndPos(&mat, 30*6.0f, Vec3(g_S*3.39f+g_O, 1.28f, -0.003f) );
-	GenericPipelineSetup(pd3dDevice, pContext, pGlobalsCB, mat, MAKE_STR_PAIR(GROUND_EXAMPLE), "GroundExamplePS", MAKE_STR_SIZE_PAIR(cbMatGroundShader));
 
-	HRESULT hr;
-	D3D11_MAPPED_SUBRESOURCE MappedSubResource;
-	V( pContext->Map( g_pMaterialParamsCB[GROUND_EXAMPLE], 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
-	((cbMatGroundShader *)MappedSubResource.pData)->g_fBumpIntensity = 1.0f;
-	((cbMatGroundShader *)MappedSubResource.pData)->g_fTileRate = 1.0f;
-    pContext->Unmap( g_pMaterialParamsCB[GROUND_EXAMPLE], 0 );
-	
-	g_meshResourceID[GROUND_EXAMPLE] = MESH_QUAD;
+	return res;
 }
 
-static void SetupSpherePrimPipeline(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB)
+// scene names are plain ascii
+static void ToWideStr(WCHAR dst[], const char src[])
 {
-	Mat44 mat; SetScaleAndPos(&mat, 8.0f, Vec3(g_S*3.39f+g_O - 3.5 + 6.0f, 1.28f+8.0f, -0.003f + 4.5) );
-	GenericPipelineSetup(pd3dDevice, pContext, pGlobalsCB, mat, MAKE_STR_PAIR(SPHERE_EXAMPLE), "SphereExamplePS", MAKE_STR_SIZE_PAIR(cbMatSphereShader));
-
-	HRESULT hr;
-	D3D11_MAPPED_SUBRESOURCE MappedSubResource;
-	V( pContext->Map( g_pMaterialParamsCB[SPHERE_EXAMPLE], 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
-	((cbMatSphereShader *)MappedSubResource.pData)->g_fBumpIntensity = 1.0f;
-	((cbMatSphereShader *)MappedSubResource.pData)->g_fTileRate = 1.0f;
-    pContext->Unmap( g_pMaterialParamsCB[SPHERE_EXAMPLE], 0 );
-	
-	g_meshResourceID[SPHERE_EXAMPLE] = MESH_SPHERE;
+	int i=0;
+	do { dst[i] = (WCHAR) src[i]; } while(src[i++]!='\0');
 }
 
 
-static void SetupPirateExamplePipeline(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB)
-{
-	Mat44 mat; SetScaleAndPos(&mat, 1.0f, Vec3(0.0f, 0.0f, 0.0f) );
-	Mat44 rotY; LoadIdentity(&rotY);
-	LoadRotation(&rotY, 0.0f, -M_PI/2.0f, 0.0f);
-	mat = rotY * mat;
-	SetColumn(&mat, 3, Vec4(g_S*-0.007558346f+g_O - 8, 2.237f, -2.74f+2, 1.0f));
-
-	GenericPipelineSetup(pd3dDevice, pContext, pGlobalsCB, mat, MAKE_STR_PAIR(PIRATE_EXAMPLE), "PirateExamplePS", MAKE_STR_SIZE_PAIR(cbMatPirateShader));
 
-	for(int i=0; i<NUM_PS_VARIANTS; i++)
-	{
-		g_ShaderPipelines[i*NUM_DRAWABLES+PIRATE_EXAMPLE].RegisterResourceView("g_norm_tex", g_pTexturesHandler[PIRATE_NORMALS_TS]);
-		g_ShaderPipelines[i*NUM_DRAWABLES+PIRATE_EXAMPLE].RegisterResourceView("g_albedo_tex", g_pTexturesHandler[PIRATE_ALBEDO]);
-		g_ShaderPipelines[i*NUM_DRAWABLES+PIRATE_EXAMPLE].RegisterResourceView("g_smoothness_tex", g_pTexturesHandler[PIRATE_SMOOTHNESS]);
-		g_ShaderPipelines[i*NUM_DRAWABLES+PIRATE_EXAMPLE].RegisterResourceView("g_ao_tex", g_pTexturesHandler[PIRATE_OCCLUSION]);
-		g_ShaderPipelines[i*NUM_DRAWABLES+PIRATE_EXAMPLE].RegisterResourceView("g_mask_tex", g_pTexturesHandler[PIRATE_MASK]);
-	}
+static bool ImportTexture(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, const int resourceIdx, const WCHAR path[], const WCHAR name[], const bool sRGB=false)
+{
+	WCHAR dest_str[256];
+	wcscpy(dest_str, path);
+	wcscat(dest_str, name);
 
 	HRESULT hr;
-	D3D11_MAPPED_SUBRESOURCE MappedSubResource;
-	V( pContext->Map( g_pMaterialParamsCB[PIRATE_EXAMPLE], 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
-	((cbMatPirateShader *)MappedSubResource.pData)->g_fBumpIntensity = 1.0f;
-	((cbMatPirateShader *)MappedSubResource.pData)->g_fTileRate = 1.0f;
-    pContext->Unmap( g_pMaterialParamsCB[PIRATE_EXAMPLE], 0 );
 
+	CDXUTResourceCache &cache = DXUTGetGlobalResourceCache();
+	V( cache.CreateTextureFromFile(pd3dDevice, pContext, dest_str, &g_pTexturesHandler[resourceIdx], sRGB) );
 
-	g_meshResourceID[PIRATE_EXAMPLE] = MESH_PIRATE;
+	//V_RETURN(DXUTCreateShaderResourceViewFromFile(pd3dDevice, dest_str, &g_pTexturesHandler[resourceIdx]));
+
+	return hr==S_OK;
 }
 
-static void SetupRockPipeline(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB)
+static bool FileExists(const WCHAR path[], const WCHAR name[], const WCHAR suffix[])
 {
-	Mat44 mat; SetScaleAndPos(&mat, 0.01*0.15f, Vec3(g_S*3.957f+g_O - 3.3 - 0.5, 0.119f + 2, 3.133f + 0.1f - 2) );
-	const float deg2rad = M_PI/180.0f;
-	Mat44 rot; LoadIdentity(&rot);
-
-	// not identical rotation to the unity scene but doesn't matter
-	LoadRotation(&rot, 0.0f*deg2rad, -90.0f*deg2rad, 0.0f*deg2rad);
-	mat = mat * rot;
-
+	WCHAR dest_str[256];
+	wcscpy(dest_str, path);
+	wcscat(dest_str, name);
+	wcscat(dest_str, suffix);
 
-	GenericPipelineSetup(pd3dDevice, pContext, pGlobalsCB, mat, MAKE_STR_PAIR(ROCK_EXAMPLE), "RockExamplePS", MAKE_STR_SIZE_PAIR(cbMatRockShader));
+	return GetFileAttributesW(dest_str)!=INVALID_FILE_ATTRIBUTES;
+}
 
-	for(int i=0; i<NUM_PS_VARIANTS; i++)
+// R8G8B8A8_UNORM with the full mip chain generated on the GPU, as the WIC
+// texture loader does for the _transfer.png files.
+static bool CreateTransferTexture(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11ShaderResourceView ** ppSRV,
+								  const std::vector<unsigned char> &rgba, const int width, const int height)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = 0;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	ID3D11Texture2D * pTex = NULL;
+	bool res = pd3dDevice->CreateTexture2D(&desc, NULL, &pTex)==S_OK;
+	if(res) res = pd3dDevice->CreateShaderResourceView(pTex, NULL, ppSRV)==S_OK;
+	if(res)
 	{
-		g_ShaderPipelines[i*NUM_DRAWABLES+ROCK_EXAMPLE].RegisterResourceView("g_norm_tex", g_pTexturesHandler[ROCK_BASE_TS]);
+		pContext->UpdateSubresource(pTex, 0, NULL, &rgba[0], 4*width, 0);
+		pContext->GenerateMips(*ppSRV);
 	}
+	SAFE_RELEASE( pTex );
 
-	HRESULT hr;
-	D3D11_MAPPED_SUBRESOURCE MappedSubResource;
-	V( pContext->Map( g_pMaterialParamsCB[ROCK_EXAMPLE], 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
-	((cbMatRockShader *)MappedSubResource.pData)->g_fBumpIntensity = 1.0f;
-	((cbMatRockShader *)MappedSubResource.pData)->g_fTileRate = 1.0f;
-    pContext->Unmap( g_pMaterialParamsCB[ROCK_EXAMPLE], 0 );
-
-
-	g_meshResourceID[ROCK_EXAMPLE] = MESH_ROCK;
+	return res;
 }
 
+// R32G32B32A32_FLOAT without mips, as the _invtransfer.dds and _basis.dds files
+static bool CreateFloatTexture(ID3D11Device* pd3dDevice, ID3D11ShaderResourceView ** ppSRV, const SCpuImage &img)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.Width = img.iWidth;
+	desc.Height = img.iHeight;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initData;
+	initData.pSysMem = img.pfPixels;
+	initData.SysMemPitch = 4*sizeof(float)*img.iWidth;
+	initData.SysMemSlicePitch = 0;
+
+	ID3D11Texture2D * pTex = NULL;
+	bool res = pd3dDevice->CreateTexture2D(&desc, &initData, &pTex)==S_OK;
+	if(res) res = pd3dDevice->CreateShaderResourceView(pTex, NULL, ppSRV)==S_OK;
+	SAFE_RELEASE( pTex );
 
+	return res;
+}
 
-static bool ImportTexture(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, const int resourceIdx, const WCHAR path[], const WCHAR name[], const bool sRGB=false)
+// Textures of hex2colTex_histo() missing next to the source are generated in
+// memory, see cputools/histo_preserv.h, and nothing is written into textures/.
+// When _invtransfer.dds and _basis.dds are there, as for the detail textures
+// which ship without _transfer.png, they are loaded and only the transfer is
+// built from them. Otherwise all three are built from the source.
+static bool CreateHistoTextures(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, const int resourceIdx, const WCHAR srcName[],
+								const WCHAR baseName[], const bool sRGB, const bool bHaveLUT)
 {
-	WCHAR dest_str[256];
-	wcscpy(dest_str, path);
-	wcscat(dest_str, name);
-
-	HRESULT hr;
+	std::vector<unsigned char> rgba;
+	int width = 0, height = 0;
+	bool res = false;
 
-	CDXUTResourceCache &cache = DXUTGetGlobalResourceCache();
-	V( cache.CreateTextureFromFile(pd3dDevice, pContext, dest_str, &g_pTexturesHandler[resourceIdx], sRGB) );
+	if(bHaveLUT)
+	{
+		WCHAR dest_str[256];
+		SCpuImage invTransfer, basis;
+		wcscpy(dest_str, baseName); wcscat(dest_str, L"_invtransfer.dds");
+		const bool bHaveInv = LoadCpuImage(&invTransfer, dest_str, false);
+		wcscpy(dest_str, baseName); wcscat(dest_str, L"_basis.dds");
+		const bool bHaveBasis = LoadCpuImage(&basis, dest_str, false);
+
+		res = bHaveInv && bHaveBasis && HistoTransferFromFile(rgba, &width, &height, srcName, sRGB, invTransfer, basis);
+		if(bHaveInv) FreeCpuImage(&invTransfer);
+		if(bHaveBasis) FreeCpuImage(&basis);
+
+		if(res) res = ImportTexture(pd3dDevice, pContext, resourceIdx+2, baseName, L"_invtransfer.dds");
+		if(res) res = ImportTexture(pd3dDevice, pContext, resourceIdx+3, baseName, L"_basis.dds");
+	}
+	else
+	{
+		SHistoPreservAssets assets;
+		res = HistoPreservAssetsFromFile(&assets, rgba, &width, &height, srcName, sRGB);
+		if(res) res = CreateFloatTexture(pd3dDevice, &g_pTexturesHandler[resourceIdx+2], assets.invTransfer);
+		if(res) res = CreateFloatTexture(pd3dDevice, &g_pTexturesHandler[resourceIdx+3], assets.basis);
+		FreeHistoPreservAssets(&assets);
+	}
 
-	//V_RETURN(DXUTCreateShaderResourceViewFromFile(pd3dDevice, dest_str, &g_pTexturesHandler[resourceIdx]));
+	if(res) res = CreateTransferTexture(pd3dDevice, pContext, &g_pTexturesHandler[resourceIdx+1], rgba, width, height);
 
-	return hr==S_OK;
+	return res;
 }
 
+// the _transfer, _invtransfer and _basis textures of hex2colTex_histo() are
+// loaded from next to the source, see CreateHistoTextures() when any is missing.
 static bool ImportTextureTRX(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, const int resourceIdx, const WCHAR path[], const WCHAR name[], const bool sRGB)
 {
 	bool res = false;
@@ -279,21 +327,33 @@ static bool ImportTextureTRX(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pCon
 			wcsncpy(str_tmp, name, nrToCopy);
 			wcscpy(str_tmp+nrToCopy, L"");
 
-			wcscpy(dest_str, str_tmp);
-			wcscat(dest_str, L"_transfer.png");
-			res &= ImportTexture(pd3dDevice, pContext, resourceIdx+1, path, dest_str);
-
-			if(res)
+			const bool bHaveTransfer = FileExists(path, str_tmp, L"_transfer.png");
+			const bool bHaveLUT = FileExists(path, str_tmp, L"_invtransfer.dds") && FileExists(path, str_tmp, L"_basis.dds");
+			if(!bHaveTransfer || !bHaveLUT)
+			{
+				WCHAR src_str[256];
+				wcscpy(src_str, path); wcscat(src_str, name);
+				wcscpy(dest_str, path); wcscat(dest_str, str_tmp);
+				res &= CreateHistoTextures(pd3dDevice, pContext, resourceIdx, src_str, dest_str, sRGB, bHaveLUT);
+			}
+			else
 			{
 				wcscpy(dest_str, str_tmp);
-				wcscat(dest_str, L"_invtransfer.dds");
-				res &= ImportTexture(pd3dDevice, pContext, resourceIdx+2, path, dest_str);
+				wcscat(dest_str, L"_transfer.png");
+				res &= ImportTexture(pd3dDevice, pContext, resourceIdx+1, path, dest_str);
 
 				if(res)
 				{
 					wcscpy(dest_str, str_tmp);
-					wcscat(dest_str, L"_basis.dds");
-					res &= ImportTexture(pd3dDevice, pContext, resourceIdx+3, path, dest_str);
+					wcscat(dest_str, L"_invtransfer.dds");
+					res &= ImportTexture(pd3dDevice, pContext, resourceIdx+2, path, dest_str);
+
+					if(res)
+					{
+						wcscpy(dest_str, str_tmp);
+						wcscat(dest_str, L"_basis.dds");
+						res &= ImportTexture(pd3dDevice, pContext, resourceIdx+3, path, dest_str);
+					}
 				}
 			}
 		}
@@ -302,40 +362,134 @@ static bool ImportTextureTRX(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pCon
 	return res;
 }
 
+static std::vector<CBufferObject> g_DerivMapScaleBuffer;
+
+// converts the normal map on the CPU, see cputools/deriv_map.h, and creates
+// an R8G8_UNORM texture from it with the full mip chain. BC5 would need an
+// offline compressor so the uncompressed format with the same precision is used.
+static bool ImportDerivMap(ID3D11Device* pd3dDevice, const int derivIdx, const WCHAR path[], const WCHAR name[])
+{
+	g_pDerivMapsHandler[derivIdx] = NULL;
+
+	WCHAR dest_str[256];
+	wcscpy(dest_str, path);
+	wcscat(dest_str, name);
+
+	SCpuImage src;
+	bool res = LoadCpuImage(&src, dest_str, false);
+
+	const int iNrMips = res ? GetNrMipLevels(src.iWidth, src.iHeight) : 0;
+	std::vector<SCpuImage> mips(iNrMips);
+	if(res) res = NormalMapToDerivMap(&mips[0], iNrMips, &g_DerivMapStats[derivIdx], src);
+
+	std::vector< std::vector<unsigned char> > texels(iNrMips);
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(iNrMips);
+	for(int m=0; m<iNrMips && res; m++)
+	{
+		const int nrTexels = mips[m].iWidth*mips[m].iHeight;
+		texels[m].resize(2*nrTexels);
+		for(int i=0; i<nrTexels; i++)
+			for(int c=0; c<2; c++)
+				texels[m][2*i+c] = (unsigned char) (255.0f*mips[m].pfPixels[4*i+c] + 0.5f);
+
+		initData[m].pSysMem = &texels[m][0];
+		initData[m].SysMemPitch = 2*mips[m].iWidth;
+		initData[m].SysMemSlicePitch = 0;
+	}
+
+	if(res)
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.Width = src.iWidth;
+		desc.Height = src.iHeight;
+		desc.MipLevels = iNrMips;
+		desc.ArraySize = 1;
+		desc.Format = DXGI_FORMAT_R8G8_UNORM;
+		desc.SampleDesc.Count = 1;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		ID3D11Texture2D * pTex = NULL;
+		res = pd3dDevice->CreateTexture2D(&desc, &initData[0], &pTex)==S_OK;
+		if(res) res = pd3dDevice->CreateShaderResourceView(pTex, NULL, &g_pDerivMapsHandler[derivIdx])==S_OK;
+		SAFE_RELEASE( pTex );
+	}
+
+	// the scale to decode with, as a buffer such that it follows the texture
+	const float fScale = g_DerivMapStats[derivIdx].fScale;
+	if(res) res = g_DerivMapScaleBuffer[derivIdx].CreateBuffer(pd3dDevice, sizeof(float), 0, &fScale, CBufferObject::DefaultBuf, true, false);
+	if(res) res = g_DerivMapScaleBuffer[derivIdx].AddTypedSRV(pd3dDevice, DXGI_FORMAT_R32_FLOAT);
+
+	for(int m=0; m<iNrMips; m++) FreeCpuImage(&mips[m]);
+	if(iNrMips>0) FreeCpuImage(&src);
+
+	return res;
+}
+
 static bool CreateNoiseData(ID3D11Device* pd3dDevice);
+static bool SetupMaterialPipelines(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB, const int materialIdx);
+static bool SetupInstance(const int instanceIdx);
+static void GetInstanceBoundsPointers(float * pfCen[3], float * pfExt[3]);
+static void UpdateInstanceBounds(const int instanceIdx);
 
-bool InitResources(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB)
+static bool ImportSceneTextures(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext)
 {
-	// import raw textures
-	ImportTexture(pd3dDevice, pContext, PIRATE_ALBEDO, L"textures/Pirate/", L"Pirate_Albedo.png", true);
-	ImportTexture(pd3dDevice, pContext, PIRATE_OCCLUSION, L"textures/Pirate/", L"Pirate_occlusion.png");
-	ImportTexture(pd3dDevice, pContext, PIRATE_SMOOTHNESS, L"textures/Pirate/", L"Pirate_Smoothness.png");
-	ImportTexture(pd3dDevice, pContext, PIRATE_NORMALS_TS, L"textures/Pirate/", L"Pirate_ts_normals.png");
-	ImportTexture(pd3dDevice, pContext, PIRATE_MASK, L"textures/Pirate/", L"Pirate_Mask_rgb.png");
-	
-	ImportTexture(pd3dDevice, pContext, ROCK_BASE_TS, L"textures/Rock/", L"Rock_Overgrown_A_Normal.tif");
-	
-	ImportTexture(pd3dDevice, pContext, TABLE_FG, L"textures/sky/", L"tableFG.dds");
-
-	// import tileables with histogram-preserving attachments
-	ImportTextureTRX(pd3dDevice, pContext, TRX_JAGUAR, L"textures/details/", L"JaguarTile.jpg", true);
-	ImportTextureTRX(pd3dDevice, pContext, TRX_GRASS_SHORT_D, L"textures/details/", L"grass_short_01a_d.png", true);
-	ImportTextureTRX(pd3dDevice, pContext, TRX_MOSSGROUND_D, L"textures/details/", L"moss_ground_1k_tile.png", true);
-	ImportTextureTRX(pd3dDevice, pContext, TRX_NATURE_PEBBLES_D, L"textures/details/", L"Nature_Pebbles_4K_d.png", true);
-
-	ImportTextureTRX(pd3dDevice, pContext, TRX_PEBBLES_BEACH_CROP_N, L"textures/details/", L"pebbles_beach_crop_01a_n.png", false);
-	ImportTextureTRX(pd3dDevice, pContext, TRX_SEAN_MICRO_N, L"textures/details/", L"Sean_Micro_Normal.png", false);
-	ImportTextureTRX(pd3dDevice, pContext, TRX_SNOW_MELT_02A_N, L"textures/details/", L"snow_melt_02a_n.png", false);
-	ImportTextureTRX(pd3dDevice, pContext, TRX_SNOW_MELT_04A_N, L"textures/details/", L"snow_melt_04a_n.png", false);
-	
+	const int nrTextures = (int) g_scene.textures.size();
+	g_iTextureSlot.resize(nrTextures);
+	g_iDerivMapIdx.resize(nrTextures);
+	g_detailColorTex.clear(); g_detailNormalTex.clear();
 
+	int nrSlots = 0;
+	for(int t=0; t<nrTextures; t++)
+	{
+		const int kind = g_scene.textures[t].iKind;
+		g_iTextureSlot[t] = nrSlots;
+		nrSlots += kind==SCENE_TEXTURE_PLAIN ? 1 : 4;
+		g_iDerivMapIdx[t] = kind==SCENE_TEXTURE_DETAIL_NORMAL ? ((int) g_detailNormalTex.size()) : -1;
+		if(kind==SCENE_TEXTURE_DETAIL_COLOR) g_detailColorTex.push_back(t);
+		if(kind==SCENE_TEXTURE_DETAIL_NORMAL) g_detailNormalTex.push_back(t);
+	}
+
+	g_pTexturesHandler.assign(nrSlots, NULL);
+	const int nrDerivMaps = (int) g_detailNormalTex.size();
+	g_pDerivMapsHandler.assign(nrDerivMaps, NULL);
+	g_DerivMapStats.resize(nrDerivMaps);
+	if(nrDerivMaps>0) memset(&g_DerivMapStats[0], 0, nrDerivMaps*sizeof(SDerivMapStats));
+	g_DerivMapScaleBuffer.resize(nrDerivMaps);
 
-	// import raw mesh data
 	bool res = true;
-	res &= g_pMeshes[MESH_QUAD].ReadObj(pd3dDevice, MODEL_PATH "quad.obj", 1.0f, true);
-	res &= g_pMeshes[MESH_SPHERE].ReadObj(pd3dDevice, MODEL_PATH "sphere.obj", 1.0f, true);
-	res &= g_pMeshes[MESH_PIRATE].ReadObj(pd3dDevice, MODEL_PATH "LP_Pirate.obj", 1.0f, false);
-	res &= g_pMeshes[MESH_ROCK].ReadObj(pd3dDevice, MODEL_PATH "Rock_Overgrown_A.obj", 1.0f, true);
+	for(int t=0; t<nrTextures; t++)
+	{
+		const SSceneTexture &tex = g_scene.textures[t];
+		WCHAR path[SCENE_DESC_PATH_LEN], name[SCENE_DESC_PATH_LEN];
+		ToWideStr(path, tex.cDir); ToWideStr(name, tex.cFile);
+
+		// import raw textures, tileables with histogram-preserving attachments
+		if(tex.iKind==SCENE_TEXTURE_PLAIN) res &= ImportTexture(pd3dDevice, pContext, g_iTextureSlot[t], path, name, tex.bSRGB!=0);
+		else res &= ImportTextureTRX(pd3dDevice, pContext, g_iTextureSlot[t], path, name, tex.bSRGB!=0);
+
+		if(tex.iKind==SCENE_TEXTURE_DETAIL_NORMAL) res &= ImportDerivMap(pd3dDevice, g_iDerivMapIdx[t], path, name);
+	}
+
+	return res;
+}
+
+bool InitResources(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB)
+{
+	bool res = LoadSceneDesc(&g_scene);
+	if(!res) ClearSceneDesc(&g_scene);
+
+	ImportSceneTextures(pd3dDevice, pContext);
+
+	// import raw mesh data, shared by the instances
+	const int nrMeshes = (int) g_scene.meshes.size();
+	g_pMeshes.resize(nrMeshes);
+	for(int m=0; m<nrMeshes; m++)
+	{
+		const SSceneMesh &mesh = g_scene.meshes[m];
+		res &= g_pMeshes[m].ReadObj(pd3dDevice, mesh.cFile, mesh.fScale, mesh.bCenter!=0, mesh.bZtoYup!=0);
+	}
 
 
 	DWORD g_dwShaderFlags = D3D10_SHADER_OPTIMIZATION_LEVEL1;//D3D10_SHADER_ENABLE_STRICTNESS;
@@ -358,28 +512,9 @@ bool InitResources(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D
 
 	// noise data
 	CreateNoiseData(pd3dDevice);
-	
-	HRESULT hr;
-	for(int i=0; i<NUM_DRAWABLES; i++)
-	{
-		g_pMaterialParamsCB[i]=NULL;
-		g_pMeshInstanceCB[i]=NULL;
-		g_meshResourceID[i]=-1;;
-		LoadIdentity(&g_mLocToWorld[i]);
-
-		// create constant buffers
-		D3D11_BUFFER_DESC bd;
-
-		memset(&bd, 0, sizeof(bd));
-		bd.Usage = D3D11_USAGE_DYNAMIC;
-		bd.ByteWidth = (sizeof( cbMeshInstance )+0xf)&(~0xf);
-		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-		bd.MiscFlags = 0;
-		V_RETURN( pd3dDevice->CreateBuffer( &bd, NULL, &g_pMeshInstanceCB[i] ) );
-	}
 
 	// create labels cb
+	HRESULT hr;
 	{
 		g_pMeshInstanceCB_forLabels = NULL;
 		
@@ -420,19 +555,75 @@ bool InitResources(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D
                                              &g_pVertexSimpleLayout ) );
 
 
-	SetupGroundPlanePipeline(pd3dDevice, pContext, pGlobalsCB);
-	SetupSpherePrimPipeline(pd3dDevice, pContext, pGlobalsCB);
-	SetupPirateExamplePipeline(pd3dDevice, pContext, pGlobalsCB);
-	SetupRockPipeline(pd3dDevice, pContext, pGlobalsCB);
-	
-	for(int i=0; i<NUM_DRAWABLES; i++)
+	// instance data, written per draw call in the order of the batches
+	const int nrInstances = (int) g_scene.instances.size();
+	g_instanceTransforms.resize(nrInstances>0 ? nrInstances : 1);
+	memset(&g_instanceTransforms[0], 0, g_instanceTransforms.size()*sizeof(SInstanceTransform));
+	memset(&g_instanceBatchStats, 0, sizeof(g_instanceBatchStats));
+	res &= g_InstanceTransformsBuffer.CreateBuffer(pd3dDevice, (int) (g_instanceTransforms.size()*sizeof(SInstanceTransform)), sizeof(SInstanceTransform),
+												   &g_instanceTransforms[0], CBufferObject::StructuredBuf, true, false);
+	res &= g_InstanceTransformsBuffer.AddStructuredSRV(pd3dDevice);
 	{
-		for(int j=0; j<NUM_PS_VARIANTS; j++)
-		{
-			g_ShaderPipelines[j*NUM_DRAWABLES+i].RegisterResourceView("g_table_FG", g_pTexturesHandler[TABLE_FG]);
-		}
+		D3D11_BUFFER_DESC bd;
+
+		memset(&bd, 0, sizeof(bd));
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.ByteWidth = (sizeof( cbInstanceBatch )+0xf)&(~0xf);
+		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bd.MiscFlags = 0;
+		V_RETURN( pd3dDevice->CreateBuffer( &bd, NULL, &g_pInstanceBatchCB ) );
 	}
 
+	// one pipeline per material, shared by its instances
+	const int nrMaterials = GetNrMaterials();
+	g_pix_shader.resize(NUM_PS_VARIANTS*nrMaterials);
+	g_ShaderPipelines.resize(NUM_PS_VARIANTS*nrMaterials);
+	g_pMaterialParamsCB.assign(nrMaterials, NULL);
+	g_materialPipeline.resize(nrMaterials);
+	for(int m=0; m<nrMaterials; m++)
+	{
+		int first = 0;
+		while(first<m && (strcmp(g_scene.materials[first].cPixelShader, g_scene.materials[m].cPixelShader)!=0 ||
+						  strcmp(g_scene.materials[first].cDefine, g_scene.materials[m].cDefine)!=0)) ++first;
+		g_materialPipeline[m] = first;
+	}
+	for(int m=0; m<nrMaterials; m++)
+		res &= SetupMaterialPipelines(pd3dDevice, pContext, pGlobalsCB, m);
+
+	// per instance transforms, children relative to their parent
+	std::vector<int> parents(nrInstances>0 ? nrInstances : 1);
+	for(int i=0; i<nrInstances; i++) parents[i] = g_scene.instances[i].iParent;
+	res &= BuildTransformHierarchy(&g_transforms, &parents[0], nrInstances);
+	g_instanceMesh.resize(nrInstances>0 ? nrInstances : 1);
+	g_instanceMaterial.resize(nrInstances>0 ? nrInstances : 1);
+	g_mLocToWorldSetup.resize(nrInstances);
+	g_vInstancePos.resize(nrInstances);
+	g_shadowCasters.clear();
+	g_iGroundInstance = -1;
+	for(int i=0; i<nrInstances; i++)
+	{
+		res &= SetupInstance(i);
+		g_instanceMesh[i] = g_scene.instances[i].iMesh;
+		g_instanceMaterial[i] = g_scene.instances[i].iMaterial;
+
+		const unsigned int uFlags = g_scene.instances[i].uFlags;
+		if((uFlags&SCENE_INSTANCE_GROUND)!=0) g_iGroundInstance = i;
+		if((uFlags&SCENE_INSTANCE_NO_SHADOW)==0) g_shadowCasters.push_back(i);
+	}
+	g_iNrTransformsUpdated = UpdateTransformHierarchy(&g_transforms);
+
+	// every instance is visible until the first CullSceneGraph()
+	float * pfCen[3], * pfExt[3];
+	g_instanceBounds.resize(6*(nrInstances>0 ? nrInstances : 1));
+	GetInstanceBoundsPointers(pfCen, pfExt);
+	for(int i=0; i<nrInstances; i++) UpdateInstanceBounds(i);
+	res &= BuildInstanceBVH(&g_instanceBVH, pfCen, pfExt, nrInstances);
+	g_visibleInstances.resize(nrInstances);
+	for(int i=0; i<nrInstances; i++) g_visibleInstances[i] = i;
+	memset(&g_instanceCullStats, 0, sizeof(g_instanceCullStats));
+	g_instanceCullStats.iNrInstances = nrInstances; g_instanceCullStats.iNrVisible = nrInstances;
+
 	ToggleDetailTex(true);
 	ToggleDetailTex(false);
 
@@ -440,6 +631,9 @@ bool InitResources(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D
 	return res;
 }
 
+static int g_iGroundDetailTexD = -1;		// scene texture
+static int g_iGroundDetailTexN = -1;
+
 void ToggleDetailTex(bool toggleIsForColor)
 {
 	static int offs_d = 0;
@@ -448,59 +642,51 @@ void ToggleDetailTex(bool toggleIsForColor)
 	if(toggleIsForColor) ++offs_d;
 	else ++offs_n;
 
-	const int indices_d[] =
-	{
-		TRX_GRASS_SHORT_D,
-		TRX_NATURE_PEBBLES_D,
-		TRX_MOSSGROUND_D,
-		TRX_JAGUAR
-	};
-
-	const int indices_n[] =
-	{
-		TRX_PEBBLES_BEACH_CROP_N,
-		TRX_SEAN_MICRO_N,
-		TRX_SNOW_MELT_02A_N,
-		TRX_SNOW_MELT_04A_N
-	};
-
-	const int nrColorTex = sizeof(indices_d) / sizeof(int);
-	const int nrNormalTex = sizeof(indices_n) / sizeof(int);
-
+	const std::vector<int> &indices = toggleIsForColor ? g_detailColorTex : g_detailNormalTex;
+	const int nrTex = (int) indices.size();
+	if(nrTex==0) return;
 
-	for(int i=0; i<NUM_DRAWABLES; i++)
+	const int nrMaterials = GetNrMaterials();
+	const int groundMaterial = g_iGroundInstance>=0 ? g_scene.instances[g_iGroundInstance].iMaterial : -1;
+	for(int m=0; m<nrMaterials; m++)
 	{
-		const int idxD = (offs_d+i)%nrColorTex;
-		const int idxN = (offs_n+i)%nrNormalTex;
-		const int idx = toggleIsForColor ? indices_d[idxD] : indices_n[idxN];
+		const int tex = indices[((toggleIsForColor ? offs_d : offs_n)+m)%nrTex];
+		const int idx = g_iTextureSlot[tex];
+		if(toggleIsForColor && m==groundMaterial) g_iGroundDetailTexD = tex;
+		if(!toggleIsForColor && m==groundMaterial) g_iGroundDetailTexN = tex;
 
 		for(int j=0; j<NUM_PS_VARIANTS; j++)
 		{
-			g_ShaderPipelines[j*NUM_DRAWABLES+i].RegisterResourceView(toggleIsForColor ? "g_trx_d" : "g_trx_n", g_pTexturesHandler[idx+0]);
-			g_ShaderPipelines[j*NUM_DRAWABLES+i].RegisterResourceView(toggleIsForColor ? "g_trx_transfer_d" : "g_trx_transfer_n", g_pTexturesHandler[idx+1]);
-			g_ShaderPipelines[j*NUM_DRAWABLES+i].RegisterResourceView(toggleIsForColor ? "g_trx_invtransfer_d" : "g_trx_invtransfer_n", g_pTexturesHandler[idx+2]);
-			g_ShaderPipelines[j*NUM_DRAWABLES+i].RegisterResourceView(toggleIsForColor ? "g_trx_basis_d" : "g_trx_basis_n", g_pTexturesHandler[idx+3]);
+			CShaderPipeline &pipe = g_ShaderPipelines[j*nrMaterials+m];
+			pipe.RegisterResourceView(toggleIsForColor ? "g_trx_d" : "g_trx_n", g_pTexturesHandler[idx+0]);
+			pipe.RegisterResourceView(toggleIsForColor ? "g_trx_transfer_d" : "g_trx_transfer_n", g_pTexturesHandler[idx+1]);
+			pipe.RegisterResourceView(toggleIsForColor ? "g_trx_invtransfer_d" : "g_trx_invtransfer_n", g_pTexturesHandler[idx+2]);
+			pipe.RegisterResourceView(toggleIsForColor ? "g_trx_basis_d" : "g_trx_basis_n", g_pTexturesHandler[idx+3]);
+
+			if(!toggleIsForColor)
+			{
+				pipe.RegisterResourceView("g_trx_dm", g_pDerivMapsHandler[g_iDerivMapIdx[tex]]);
+				pipe.RegisterResourceView("g_trx_dm_scale", g_DerivMapScaleBuffer[g_iDerivMapIdx[tex]].GetSRV());
+			}
 		}
 	}
 }
 
 void PassShadowResolve(ID3D11ShaderResourceView * pShadowResolveSRV)
 {
-	for(int i=0; i<NUM_DRAWABLES; i++)
+	for(int i=0; i<(int) g_ShaderPipelines.size(); i++)
 	{
-		for(int j=0; j<NUM_PS_VARIANTS; j++)
-		{
-			if(pShadowResolveSRV!=NULL) 
-				g_ShaderPipelines[j*NUM_DRAWABLES+i].RegisterResourceView("g_shadowResolve", pShadowResolveSRV);
-		}
+		if(pShadowResolveSRV!=NULL) 
+			g_ShaderPipelines[i].RegisterResourceView("g_shadowResolve", pShadowResolveSRV);
 	}
 }
 
 static void RegisterGenericNoiseBuffers(CShaderPipeline &pipe);
 
-static bool GenericPipelineSetup(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB, const Mat44 &mat, const SValueAndStr &sIdxAndStr, const char pixShaderEntryFunc[], const SValueAndStr sMatSizeAndStr)
+static bool SetupMaterialPipelines(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB, const int materialIdx)
 {
-	const int drawableIdx = sIdxAndStr.value; 
+	const SSceneMaterial &mat = g_scene.materials[materialIdx];
+	const int nrMaterials = GetNrMaterials();
 
 	for(int i=0; i<NUM_PS_VARIANTS; i++)
 	{
@@ -508,20 +694,24 @@ static bool GenericPipelineSetup(ID3D11Device* pd3dDevice, ID3D11DeviceContext *
 		//const char decals_mip_mapped[] = "DECALS_MIP_MAPPED";
 
 		//const bool haveDecals = i==DECALS_ENABLED_MIPMAPPED_ON || i==DECALS_ENABLED_MIPMAPPED_OFF;
-		//CONST D3D10_SHADER_MACRO sDefines[] = {{sIdxAndStr.str_name, NULL}, {haveDecals ? decals_enabled : NULL, NULL}, {i==DECALS_ENABLED_MIPMAPPED_ON ? decals_mip_mapped : NULL, NULL}, {NULL, NULL}};
-		CONST D3D10_SHADER_MACRO sDefines[] = {{sIdxAndStr.str_name, NULL}, {NULL, NULL}};
+		//CONST D3D10_SHADER_MACRO sDefines[] = {{mat.cDefine, NULL}, {haveDecals ? decals_enabled : NULL, NULL}, {i==DECALS_ENABLED_MIPMAPPED_ON ? decals_mip_mapped : NULL, NULL}, {NULL, NULL}};
+		CONST D3D10_SHADER_MACRO sDefines[] = {{mat.cDefine, NULL}, {NULL, NULL}};
 
-		g_pix_shader[i*NUM_DRAWABLES+drawableIdx].CompileShaderFunction(pd3dDevice, L"shader_lighting.hlsl", sDefines, pixShaderEntryFunc, "ps_5_0", g_dwShaderFlags );
+		// materials with the same shader and define share the compiled shader
+		const int shaderIdx = i*nrMaterials+g_materialPipeline[materialIdx];
+		if(shaderIdx==(i*nrMaterials+materialIdx))
+			g_pix_shader[shaderIdx].CompileShaderFunction(pd3dDevice, L"shader_lighting.hlsl", sDefines, mat.cPixelShader, "ps_5_0", g_dwShaderFlags );
 
-		CShaderPipeline &pipe = g_ShaderPipelines[i*NUM_DRAWABLES+drawableIdx];
+		CShaderPipeline &pipe = g_ShaderPipelines[i*nrMaterials+materialIdx];
 
 		// prepare shader pipeline
 		pipe.SetVertexShader(&g_vert_shader);
-		pipe.SetPixelShader(&g_pix_shader[i*NUM_DRAWABLES+drawableIdx]);
+		pipe.SetPixelShader(&g_pix_shader[shaderIdx]);
 
 		// register constant buffers
-		pipe.RegisterConstBuffer("cbMeshInstance", g_pMeshInstanceCB[drawableIdx]);
+		pipe.RegisterConstBuffer("cbInstanceBatch", g_pInstanceBatchCB);
 		pipe.RegisterConstBuffer("cbGlobals", pGlobalsCB);
+		pipe.RegisterResourceView("g_instanceTransforms", g_InstanceTransformsBuffer.GetSRV());
 		RegisterGenericNoiseBuffers(pipe);
 	
 		// register samplers
@@ -530,80 +720,298 @@ static bool GenericPipelineSetup(ID3D11Device* pd3dDevice, ID3D11DeviceContext *
 		pipe.RegisterSampler("g_samClamp", GetDefaultSamplerClamp() );
 		pipe.RegisterSampler("g_samShadow", GetDefaultShadowSampler() );
 
+		// textures of the material and of every material
+		for(int b=mat.iFirstBinding; b<(mat.iFirstBinding+mat.iNrBindings); b++)
+			pipe.RegisterResourceView(g_scene.bindings[b].cVariable, g_pTexturesHandler[g_iTextureSlot[g_scene.bindings[b].iTexture]]);
+		for(int b=0; b<(int) g_scene.globalBindings.size(); b++)
+			pipe.RegisterResourceView(g_scene.globalBindings[b].cVariable, g_pTexturesHandler[g_iTextureSlot[g_scene.globalBindings[b].iTexture]]);
 	}
-	   
-
-	CShaderPipeline &pipeDepth = g_ShaderPipelines_DepthOnly[drawableIdx];
-
-	
-
-	// depth only pipeline
-	pipeDepth.SetVertexShader(&g_vert_shader_basic);
-	pipeDepth.RegisterConstBuffer("cbMeshInstance", g_pMeshInstanceCB[drawableIdx]);
-	pipeDepth.RegisterConstBuffer("cbGlobals", pGlobalsCB);
 
 	HRESULT hr;
 
-	// create constant buffers
-	const int byteSizeMatCB = sMatSizeAndStr.value;
-	if(byteSizeMatCB>0)
+	// create constant buffers. Every material cbuffer of custom_cbuffers.h
+	// holds the tile rate and the bump intensity, the layout of cbMatGroundShader.
+	const bool bHasParamsCB = strcmp(mat.cParamsCB, "none")!=0;
+	if(bHasParamsCB)
 	{
 		D3D11_BUFFER_DESC bd;
 
 		memset(&bd, 0, sizeof(bd));
 		bd.Usage = D3D11_USAGE_DYNAMIC;
-		bd.ByteWidth = (byteSizeMatCB+0xf)&(~0xf);
+		bd.ByteWidth = (sizeof(cbMatGroundShader)+0xf)&(~0xf);
 		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 		bd.MiscFlags = 0;
-		V_RETURN( pd3dDevice->CreateBuffer( &bd, NULL, &g_pMaterialParamsCB[drawableIdx] ) );
+		V_RETURN( pd3dDevice->CreateBuffer( &bd, NULL, &g_pMaterialParamsCB[materialIdx] ) );
 
 		for(int i=0; i<NUM_PS_VARIANTS; i++)
 		{
-			CShaderPipeline &pipe = g_ShaderPipelines[i*NUM_DRAWABLES+drawableIdx];
-			pipe.RegisterConstBuffer(sMatSizeAndStr.str_name, g_pMaterialParamsCB[drawableIdx]);
+			CShaderPipeline &pipe = g_ShaderPipelines[i*nrMaterials+materialIdx];
+			pipe.RegisterConstBuffer(mat.cParamsCB, g_pMaterialParamsCB[materialIdx]);
 		}
-		pipeDepth.RegisterConstBuffer(sMatSizeAndStr.str_name, g_pMaterialParamsCB[drawableIdx]);
+
+		D3D11_MAPPED_SUBRESOURCE MappedSubResource;
+		V( pContext->Map( g_pMaterialParamsCB[materialIdx], 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
+		((cbMatGroundShader *)MappedSubResource.pData)->g_fBumpIntensity = mat.fBumpIntensity;
+		((cbMatGroundShader *)MappedSubResource.pData)->g_fTileRate = mat.fTileRate;
+		pContext->Unmap( g_pMaterialParamsCB[materialIdx], 0 );
 	}
 
-	// update transformation cb
-	D3D11_MAPPED_SUBRESOURCE MappedSubResource;
-	V( pContext->Map( g_pMeshInstanceCB[drawableIdx], 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
-	((cbMeshInstance *)MappedSubResource.pData)->g_mLocToWorld = Transpose(mat); 
-	((cbMeshInstance *)MappedSubResource.pData)->g_mWorldToLocal = Transpose(~mat); 
-    pContext->Unmap( g_pMeshInstanceCB[drawableIdx], 0 );
+	return true;
+}
 
-	// make a record
-	g_mLocToWorld[drawableIdx] = mat;
+static bool SetupInstance(const int instanceIdx)
+{
+	Mat44 mat;
+	GetSceneInstanceLocToWorld(&mat, g_scene.instances[instanceIdx]);
+
+	// make a record, the world transform and its inverse follow on the next update
+	SetTransformLocal(&g_transforms, instanceIdx, mat);
+	g_mLocToWorldSetup[instanceIdx] = mat;
+	const Vec4 vPos = GetColumn(mat, 3);
+	g_vInstancePos[instanceIdx] = g_vWorldOffset + Vec3d(vPos.x, vPos.y, vPos.z);
 
 	return true;
 }
 
+void SetSceneGraphWorldOffset(const Vec3d &vWorldOffset)
+{
+	for(int i=0; i<(int) g_mLocToWorldSetup.size(); i++)
+	{
+		const Vec4 vPos = GetColumn(g_mLocToWorldSetup[i], 3);
+		g_vInstancePos[i] = vWorldOffset + Vec3d(vPos.x, vPos.y, vPos.z);
+	}
+	g_vWorldOffset = vWorldOffset;
+}
+
+void RebaseSceneGraph(ID3D11DeviceContext *pContext, const Vec3d &vOrigin)
+{
+	// only the roots move, their descendants follow when the origin changes
+	for(int i=0; i<(int) g_mLocToWorldSetup.size(); i++)
+		if(g_scene.instances[i].iParent<0)
+		{
+			Mat44 mat;
+			RebaseLocToWorld(&mat, g_mLocToWorldSetup[i], g_vInstancePos[i], vOrigin);
+			SetTransformLocal(&g_transforms, i, mat);
+		}
+
+	g_iNrTransformsUpdated = UpdateTransformHierarchy(&g_transforms);
 
-void RenderSceneGraph(ID3D11DeviceContext *pContext, bool bSimpleLayout, bool bSkipGroundPlane)
+	// refit the culling tree to the instances that moved
+	g_instanceChanged.resize(g_iNrTransformsUpdated);
+	for(int i=0; i<g_iNrTransformsUpdated; i++)
+	{
+		g_instanceChanged[i] = g_transforms.idOfNode[g_transforms.work[i]];
+		UpdateInstanceBounds(g_instanceChanged[i]);
+	}
+
+	float * pfCen[3], * pfExt[3];
+	GetInstanceBoundsPointers(pfCen, pfExt);
+	if(g_iNrTransformsUpdated>0 && RefitInstanceBVH(&g_instanceBVH, pfCen, pfExt, &g_instanceChanged[0], g_iNrTransformsUpdated))
+		++g_instanceCullStats.iNrRebuilds;
+}
+
+static void GetInstanceBoundsPointers(float * pfCen[3], float * pfExt[3])
 {
-	for(int i=0; i<NUM_DRAWABLES; i++)
+	const int nrInstances = (int) g_scene.instances.size();
+	for(int k=0; k<3; k++)
 	{
-		if((!bSkipGroundPlane) || i!=GROUND_EXAMPLE)
+		pfCen[k] = &g_instanceBounds[k*nrInstances];
+		pfExt[k] = &g_instanceBounds[(3+k)*nrInstances];
+	}
+}
+
+// world space box of the mesh bound
+static void UpdateInstanceBounds(const int instanceIdx)
+{
+	Mat44 mat;
+	GetTransformWorld(&mat, NULL, g_transforms, instanceIdx);
+	const CMeshDraw &mesh = g_pMeshes[g_scene.instances[instanceIdx].iMesh];
+	const Vec3 vCenLoc = 0.5f*(mesh.GetMax()+mesh.GetMin());
+	const Vec3 vExtLoc = 0.5f*(mesh.GetMax()-mesh.GetMin());
+
+	float * pfCen[3], * pfExt[3];
+	GetInstanceBoundsPointers(pfCen, pfExt);
+	const Vec4 v4Cen = mat*vCenLoc;
+	pfCen[0][instanceIdx] = v4Cen.x; pfCen[1][instanceIdx] = v4Cen.y; pfCen[2][instanceIdx] = v4Cen.z;
+
+	// column major
+	const float * pfM = mat.m_fMat;
+	for(int k=0; k<3; k++)
+		pfExt[k][instanceIdx] = fabsf(pfM[k+0*4])*vExtLoc.x + fabsf(pfM[k+1*4])*vExtLoc.y + fabsf(pfM[k+2*4])*vExtLoc.z;
+}
+
+void CullSceneGraph(const Mat44 &mWorldToClip)
+{
+	SFrustumPlanes frustum;
+	GetFrustumPlanes(&frustum, mWorldToClip);
+	g_instanceCullStats.iNrInstances = (int) g_scene.instances.size();
+	g_instanceCullStats.iNrVisible = QueryInstanceBVH(g_visibleInstances, g_instanceBVH, frustum, true, &g_instanceCullStats.iNrNodesTested);
+
+	// depth for the draw order and a new frame of draw stats
+	g_vClipW = GetRow(mWorldToClip, 3);
+	memset(&g_drawSubmitStats, 0, sizeof(g_drawSubmitStats));
+}
+
+
+// batches the instances, uploads their transforms and draws each batch
+// with one DrawIndexedInstanced(). The depth of the draw order is the dot
+// product of vDepthRow with a world space position, the row of the pass's
+// world to clip transform giving w for the camera or z for a light.
+// Returns the number of batches.
+static int RenderInstances(ID3D11DeviceContext *pContext, const std::vector<int> &instances, bool bSimpleLayout, const Vec4 &vDepthRow,
+						   SInstanceBatchStats * pStats)
+{
+	const int nrInstances = (int) instances.size();
+	const int nrBatches = BuildInstanceBatches(g_instanceBatches, g_instanceOrder, nrInstances>0 ? &instances[0] : NULL, nrInstances,
+											   &g_instanceMesh[0], &g_instanceMaterial[0], (int) g_pMeshes.size(), GetNrMaterials(), pStats);
+	if(nrBatches==0) return 0;
+
+	for(int i=0; i<nrInstances; i++)
+	{
+		Mat44 mLocToWorld, mWorldToLocal;
+		GetTransformWorld(&mLocToWorld, &mWorldToLocal, g_transforms, g_instanceOrder[i]);
+		g_instanceTransforms[i].mLocToWorld = Transpose(mLocToWorld);
+		g_instanceTransforms[i].mWorldToLocal = Transpose(mWorldToLocal);
+	}
+
+	// sort the batches by pipeline, material, mesh and nearest instance
+	float * pfCen[3], * pfExt[3];
+	GetInstanceBoundsPointers(pfCen, pfExt);
+	g_drawItems.resize(nrBatches);
+	for(int b=0; b<nrBatches; b++)
+	{
+		const SInstanceBatch &batch = g_instanceBatches[b];
+		float fDepth = FLT_MAX;
+		for(int i=batch.iFirstInstance; i<(batch.iFirstInstance+batch.iNrInstances); i++)
+		{
+			const int idx = g_instanceOrder[i];
+			const float fD = vDepthRow.x*pfCen[0][idx] + vDepthRow.y*pfCen[1][idx] + vDepthRow.z*pfCen[2][idx] + vDepthRow.w;
+			fDepth = std::min(fDepth, fD);
+		}
+		g_drawItems[b].uKey = MakeDrawKey(g_materialPipeline[batch.iMaterial], batch.iMaterial, batch.iMesh, fDepth);
+		g_drawItems[b].iIndex = b; g_drawItems[b].iPad = 0;
+	}
+	SortDrawItems(g_drawItems, g_drawItemsScratch);
+
+	// a range of the sorted draws per command list, recorded on a thread
+	// each and replayed in order. State is left bound between draws, only
+	// what differs is recorded and each list unbinds at its end.
+	const int nrLists = std::min(std::min(GetDefaultNrThreads(), MAX_SCENE_COMMAND_LISTS), (nrBatches+DRAWS_PER_COMMAND_LIST-1)/DRAWS_PER_COMMAND_LIST);
+	ParallelFor(nrLists, nrLists, [&](const int l, const int threadIdx)
+	{
+		SCommandList * pList = &g_commandLists[l];
+		SDrawStateCache * pCache = &g_drawStateCaches[l];
+		ResetCommandList(pList);
+		ResetDrawStateCache(pCache);
+
+		int iNrCallsWithoutDiffing = 0;
+		if(l==0)
+		{
+			RecordUpdateBuffer(pList, g_InstanceTransformsBuffer.GetBuffer(), 0, &g_instanceTransforms[0], nrInstances*sizeof(SInstanceTransform));
+			++iNrCallsWithoutDiffing;
+		}
+
+		const int iFirst = (l*nrBatches)/nrLists, iLast = ((l+1)*nrBatches)/nrLists;
+		for(int d=iFirst; d<iLast; d++)
 		{
-			CShaderPipeline &pipe = g_ShaderPipelines[0*NUM_DRAWABLES+i];
+			const SInstanceBatch &batch = g_instanceBatches[g_drawItems[d].iIndex];
 
-			pipe.PrepPipelineForRendering(pContext);
+			cbInstanceBatch cbBatch;
+			memset(&cbBatch, 0, sizeof(cbBatch));
+			cbBatch.g_iFirstInstance = batch.iFirstInstance;
+			RecordUpdateConstBuffer(pList, g_pInstanceBatchCB, &cbBatch, sizeof(cbBatch));
+
+			const CShaderPipeline &pipe = g_ShaderPipelines[0*GetNrMaterials()+batch.iMaterial];
+			pipe.RecordPipelineForRendering(pList, pCache);
 	
-			CMeshDraw &mesh = g_pMeshes[ g_meshResourceID[i] ];
+			CMeshDraw &mesh = g_pMeshes[batch.iMesh];
 
 			// set streams and layout
-			UINT stride = sizeof(SFilVert), offset = 0;
-			pContext->IASetVertexBuffers( 0, 1, mesh.GetVertexBuffer(), &stride, &offset );
-			pContext->IASetIndexBuffer( mesh.GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0 );
-			pContext->IASetInputLayout( bSimpleLayout ? g_pVertexSimpleLayout : g_pVertexLayout );
+			ID3D11Buffer * pVertStream = *mesh.GetVertexBuffer();
+			if(UpdateDrawStateInput(pCache, DRAW_STATE_VERTEX_BUFFER, pVertStream))
+				RecordSetVertexBuffer(pList, pVertStream, sizeof(SFilVert), 0);
+			if(UpdateDrawStateInput(pCache, DRAW_STATE_INDEX_BUFFER, mesh.GetIndexBuffer()))
+				RecordSetIndexBuffer(pList, mesh.GetIndexBuffer(), DXGI_FORMAT_R32_UINT);
+			ID3D11InputLayout * pLayout = bSimpleLayout ? g_pVertexSimpleLayout : g_pVertexLayout;
+			if(UpdateDrawStateInput(pCache, DRAW_STATE_INPUT_LAYOUT, pLayout))
+				RecordSetInputLayout(pList, pLayout);
 
 			// Set primitive topology
-			pContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
-			pContext->DrawIndexed( 3*mesh.GetNrTriangles(), 0, 0 );
-			pipe.FlushResources(pContext);
+			if(UpdateDrawStateInput(pCache, DRAW_STATE_TOPOLOGY, (const void *) (size_t) D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST))
+				RecordSetTopology(pList, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			RecordDrawIndexedInstanced(pList, 3*mesh.GetNrTriangles(), batch.iNrInstances, 0, 0, 0);
+
+			// map, unmap, the input state and the draw
+			iNrCallsWithoutDiffing += 2 + pipe.CountPrepCalls() + NUM_DRAW_STATE_INPUTS + 1 + pipe.CountFlushCalls();
 		}
+		RecordFlushDrawStateCache(pList, pCache);
+		g_iNrCallsWithoutDiffing[l] = iNrCallsWithoutDiffing;
+	});
+
+	const SCommandList * pLists[MAX_SCENE_COMMAND_LISTS];
+	for(int l=0; l<nrLists; l++) pLists[l] = &g_commandLists[l];
+	CD3D11CommandBackend backend(pContext);
+	ReplayCommandLists(&backend, pLists, nrLists);
+
+	g_drawSubmitStats.iNrDraws += nrBatches;
+	g_drawSubmitStats.iNrCalls += 1 + 3*nrBatches;		// the transforms, per draw map, unmap and the draw
+	for(int l=0; l<nrLists; l++)
+	{
+		g_drawSubmitStats.iNrCalls += g_drawStateCaches[l].iNrCalls;
+		g_drawSubmitStats.iNrCallsWithoutDiffing += g_iNrCallsWithoutDiffing[l];
+		g_drawSubmitStats.iNrCommandLists += 1;
 	}
+
+	return nrBatches;
+}
+
+void RenderSceneGraph(ID3D11DeviceContext *pContext, bool bSimpleLayout, bool bSkipGroundPlane)
+{
+	g_instanceList.clear();
+	for(int i=0; i<(int) g_visibleInstances.size(); i++)
+	{
+		const int idx = g_visibleInstances[i];
+		if((!bSkipGroundPlane) || idx!=g_iGroundInstance)
+			g_instanceList.push_back(idx);
+	}
+
+	RenderInstances(pContext, g_instanceList, bSimpleLayout, g_vClipW, &g_instanceBatchStats);
+}
+
+int RenderShadowCastingMeshInstances(ID3D11DeviceContext *pContext, const unsigned char puMask[], const unsigned char uBit, const Vec4 &vLightDepthRow,
+									 int * piNrBatches)
+{
+	g_instanceList.clear();
+	for(int i=0; i<GetNumberOfShadowCastingMeshInstances(); i++)
+	{
+		if((puMask[i]&uBit)!=0) g_instanceList.push_back(g_shadowCasters[i]);
+	}
+
+	const int iNrBatches = RenderInstances(pContext, g_instanceList, true, vLightDepthRow, NULL);
+	if(piNrBatches!=NULL) *piNrBatches = iNrBatches;
+
+	return (int) g_instanceList.size();
+}
+
+const SInstanceBatchStats * GetSceneInstanceBatchStats()
+{
+	return &g_instanceBatchStats;
+}
+
+int GetNrSceneTransformsUpdated()
+{
+	return g_iNrTransformsUpdated;
+}
+
+const SInstanceCullStats * GetSceneCullStats()
+{
+	return &g_instanceCullStats;
+}
+
+const SDrawSubmitStats * GetSceneDrawSubmitStats()
+{
+	return &g_drawSubmitStats;
 }
 
 
@@ -637,15 +1045,65 @@ Vec3 GetSunDir()
 	return g_vSunDir;
 }
 
+void GetGroundPlaneInfo(Vec3 * pvCenter, float * pfHalfExtent)
+{
+	// the ground plane is a uniformly scaled [-1;1]^2 quad in the XZ plane
+	if(g_iGroundInstance<0) { *pvCenter = Vec3(0,0,0); *pfHalfExtent = 0.0f; return; }
+	Mat44 mat;
+	GetTransformWorld(&mat, NULL, g_transforms, g_iGroundInstance);
+	const Vec4 vCen = GetColumn(mat, 3);
+	*pvCenter = Vec3(vCen.x, vCen.y, vCen.z);
+	*pfHalfExtent = GetColumn(mat, 0).x;
+}
+
+int GetGroundDetailTexSize()
+{
+	int size = 0;
+	if(g_iGroundDetailTexD>=0 && g_pTexturesHandler[g_iTextureSlot[g_iGroundDetailTexD]]!=NULL)
+	{
+		ID3D11Resource * pResource = NULL;
+		g_pTexturesHandler[g_iTextureSlot[g_iGroundDetailTexD]]->GetResource(&pResource);
+
+		D3D11_TEXTURE2D_DESC desc;
+		((ID3D11Texture2D *) pResource)->GetDesc(&desc);
+		size = desc.Width>desc.Height ? desc.Width : desc.Height;
+		SAFE_RELEASE( pResource );
+	}
+
+	return size;
+}
+
+const SDerivMapStats * GetGroundDerivMapStats()
+{
+	const bool bValid = g_iGroundDetailTexN>=0 && g_pDerivMapsHandler[g_iDerivMapIdx[g_iGroundDetailTexN]]!=NULL;
+	return bValid ? &g_DerivMapStats[g_iDerivMapIdx[g_iGroundDetailTexN]] : NULL;
+}
+
 static CBufferObject g_PermTableBuffer;
 static CBufferObject g_GradBuffer;
 
+// tileable noise volume for dfractalsumvol() in noise.h, baked at startup.
+// hextile-tool noisevol writes the same volume to a dds file.
+#define NOISE_VOLUME_RES		64
+#define NOISE_VOLUME_PERIOD		8
+
+static ID3D11ShaderResourceView * g_pNoiseVolumeSRV = NULL;
+static SNoiseVolumeStats g_NoiseVolumeStats;
+static CBufferObject g_HexCellLUTBuffer;
+static float g_fHexCellLUTRotStrength = 0.0f;
+
 void ReleaseSceneGraph()
 {
-	for(int t=0; t<NUM_TEXTURES; t++)
+	for(int t=0; t<(int) g_pTexturesHandler.size(); t++)
 		SAFE_RELEASE( g_pTexturesHandler[t] );
 
-	for(int m=0; m<NUM_MESHES; m++)
+	for(int t=0; t<(int) g_pDerivMapsHandler.size(); t++)
+	{
+		SAFE_RELEASE( g_pDerivMapsHandler[t] );
+		g_DerivMapScaleBuffer[t].CleanUp();
+	}
+
+	for(int m=0; m<(int) g_pMeshes.size(); m++)
 		g_pMeshes[m].CleanUp();
 
 	CDXUTResourceCache &cache = DXUTGetGlobalResourceCache();
@@ -655,13 +1113,12 @@ void ReleaseSceneGraph()
 	g_vert_shader_basic.CleanUp();
 	g_pix_shader_basic_white.CleanUp();
 
-	for(int i=0; i<NUM_DRAWABLES; i++)
-	{
-		SAFE_RELEASE( g_pMeshInstanceCB[i] );
-		if(g_pMaterialParamsCB[i]!=NULL) SAFE_RELEASE( g_pMaterialParamsCB[i] );
-		for(int j=0; j<NUM_PS_VARIANTS; j++)
-			g_pix_shader[j*NUM_DRAWABLES+i].CleanUp();
-	}
+	g_InstanceTransformsBuffer.CleanUp();
+	SAFE_RELEASE( g_pInstanceBatchCB );
+	for(int m=0; m<(int) g_pMaterialParamsCB.size(); m++)
+		if(g_pMaterialParamsCB[m]!=NULL) SAFE_RELEASE( g_pMaterialParamsCB[m] );
+	for(int i=0; i<(int) g_pix_shader.size(); i++)
+		g_pix_shader[i].CleanUp();
 	SAFE_RELEASE( g_pMeshInstanceCB_forLabels );
 
 	SAFE_RELEASE( g_pVertexLayout );
@@ -669,6 +1126,8 @@ void ReleaseSceneGraph()
 
 	g_GradBuffer.CleanUp();
 	g_PermTableBuffer.CleanUp();
+	SAFE_RELEASE( g_pNoiseVolumeSRV );
+	g_HexCellLUTBuffer.CleanUp();
 }
 
 
@@ -676,67 +1135,114 @@ void ReleaseSceneGraph()
 
 static bool CreateNoiseData(ID3D11Device* pd3dDevice)
 {
-	// 3D version
-	static const unsigned char uPermTable[256] =
-	{
-		151,160,137,91,90,15,
-		131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
-		190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
-		88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
-		77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
-		102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,187,208, 89,18,169,200,196,
-		135,130,116,188,159,86,164,100,109,198,173,186, 3,64,52,217,226,250,124,123,
-		5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,
-		223,183,170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167, 43,172,9,
-		129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,104,218,246,97,228,
-		251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,107,
-		49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
-		138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
-	};
-
-	static const Vec3 grads_array[] =
-	{
-		Vec3(1,1,0), Vec3(-1,1,0), Vec3(1,-1,0), Vec3(-1,-1,0),
-		Vec3(1,0,1), Vec3(-1,0,1), Vec3(1,0,-1), Vec3(-1,0,-1),
-		Vec3(0,1,1), Vec3(0,-1,1), Vec3(0,1,-1), Vec3(0,-1,-1),
-		Vec3(1,1,0), Vec3(0,-1,1), Vec3(-1,1,0), Vec3(0,-1,-1)
-	};
-
+	// 3D version, the tables are shared with cputools/noise_cpu.h
 	bool res = true;
-	res &= g_PermTableBuffer.CreateBuffer(pd3dDevice, 256, 0, uPermTable, CBufferObject::DefaultBuf, true, false);
+	res &= g_PermTableBuffer.CreateBuffer(pd3dDevice, sizeof(g_uNoisePermTable), 0, g_uNoisePermTable, CBufferObject::DefaultBuf, true, false);
 	res &= g_PermTableBuffer.AddTypedSRV(pd3dDevice, DXGI_FORMAT_R8_UINT);
 
-	res &= g_GradBuffer.CreateBuffer(pd3dDevice, 16*sizeof(Vec3), 0, grads_array, CBufferObject::DefaultBuf, true, false);
+	res &= g_GradBuffer.CreateBuffer(pd3dDevice, sizeof(g_fNoiseGradArray), 0, g_fNoiseGradArray, CBufferObject::DefaultBuf, true, false);
 	res &= g_GradBuffer.AddTypedSRV(pd3dDevice, DXGI_FORMAT_R32G32B32_FLOAT);
 
+	// noise volume, optional since without it the procedural noise is used,
+	// see GetNoiseVolumeStats()
+	SCpuImage vol;
+	bool bVolRes = BakeNoiseVolume(&vol, NOISE_VOLUME_RES, NOISE_VOLUME_PERIOD, 0, &g_NoiseVolumeStats);
+	if(bVolRes)
+	{
+		D3D11_TEXTURE3D_DESC desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.Width = vol.iWidth;
+		desc.Height = vol.iHeight;
+		desc.Depth = vol.iDepth;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		D3D11_SUBRESOURCE_DATA initData;
+		initData.pSysMem = vol.pfPixels;
+		initData.SysMemPitch = 4*sizeof(float)*vol.iWidth;
+		initData.SysMemSlicePitch = 4*sizeof(float)*vol.iWidth*vol.iHeight;
+
+		ID3D11Texture3D * pTex = NULL;
+		bVolRes = pd3dDevice->CreateTexture3D(&desc, &initData, &pTex)==S_OK;
+		if(bVolRes) bVolRes = pd3dDevice->CreateShaderResourceView(pTex, NULL, &g_pNoiseVolumeSRV)==S_OK;
+		SAFE_RELEASE( pTex );
+		FreeCpuImage(&vol);
+	}
+	if(!bVolRes) memset(&g_NoiseVolumeStats, 0, sizeof(g_NoiseVolumeStats));
+
+	// per cell rotation and offset for hex-tiling, see cputools/hextile_lut.h
+	static float fHexCellLUT[4*HEXCELL_LUT_DEFAULT_SIZE*HEXCELL_LUT_DEFAULT_SIZE];
+	GenerateHexCellLUT(fHexCellLUT, HEXCELL_LUT_DEFAULT_SIZE, g_fHexCellLUTRotStrength);
+	res &= g_HexCellLUTBuffer.CreateBuffer(pd3dDevice, sizeof(fHexCellLUT), 0, fHexCellLUT, CBufferObject::DefaultBuf, true, false);
+	res &= g_HexCellLUTBuffer.AddTypedSRV(pd3dDevice, DXGI_FORMAT_R32G32B32A32_FLOAT);
+
 	return res;
 }
 
+void UpdateHexCellLUT(ID3D11DeviceContext *pContext, const float rotStrength)
+{
+	// the table holds cos and sin of the scaled angle
+	if(rotStrength!=g_fHexCellLUTRotStrength)
+	{
+		static float fHexCellLUT[4*HEXCELL_LUT_DEFAULT_SIZE*HEXCELL_LUT_DEFAULT_SIZE];
+		GenerateHexCellLUT(fHexCellLUT, HEXCELL_LUT_DEFAULT_SIZE, rotStrength);
+		pContext->UpdateSubresource(g_HexCellLUTBuffer.GetBuffer(), 0, NULL, fHexCellLUT, 0, 0);
+
+		g_fHexCellLUTRotStrength = rotStrength;
+	}
+}
+
+int GetHexCellLUTSize()
+{
+	return HEXCELL_LUT_DEFAULT_SIZE;
+}
+
 
 static void RegisterGenericNoiseBuffers(CShaderPipeline &pipe)
 {
 	pipe.RegisterResourceView("g_uPermTable", g_PermTableBuffer.GetSRV());
 	pipe.RegisterResourceView("g_v3GradArray", g_GradBuffer.GetSRV());
+	pipe.RegisterResourceView("g_hexCellLUT", g_HexCellLUTBuffer.GetSRV());
+	if(g_pNoiseVolumeSRV!=NULL) pipe.RegisterResourceView("g_noiseVolume", g_pNoiseVolumeSRV);
+	pipe.RegisterSampler("g_samNoiseVolume", GetDefaultSamplerWrap() );
+}
+
+const SNoiseVolumeStats * GetNoiseVolumeStats()
+{
+	return g_pNoiseVolumeSRV!=NULL ? &g_NoiseVolumeStats : NULL;
 }
 
 
 // shadow support functions
 int GetNumberOfShadowCastingMeshInstances()
 {
-	return NUM_DRAWABLES-1;		// minus one to exclude the groundplane
+	return (int) g_shadowCasters.size();		// excludes the groundplane
 }
 
 void GetAABBoxAndTransformOfShadowCastingMeshInstance(Vec3 * pvMin, Vec3 * pvMax, Mat44 * pmMat, const int idx_in)
 {
-	const int idx = idx_in+1;		// skip groundplane
-	assert(idx>=0 && idx<NUM_DRAWABLES);
+	assert(idx_in>=0 && idx_in<GetNumberOfShadowCastingMeshInstances());
+	const int idx = g_shadowCasters[idx_in];
 
-	const int mesh_idx = g_meshResourceID[idx];
+	const int mesh_idx = g_scene.instances[idx].iMesh;
 
 
 	CMeshDraw &mesh = g_pMeshes[mesh_idx];
 
 	*pvMin = mesh.GetMin();
 	*pvMax = mesh.GetMax();
-	*pmMat = g_mLocToWorld[idx];
+	GetTransformWorld(pmMat, NULL, g_transforms, idx);
+}
+
+void GetHullOfShadowCastingMeshInstance(const float ** ppfHull, int * piNrHullVerts, const int idx_in)
+{
+	assert(idx_in>=0 && idx_in<GetNumberOfShadowCastingMeshInstances());
+	const int idx = g_shadowCasters[idx_in];
+
+	const CMeshDraw &mesh = g_pMeshes[g_scene.instances[idx].iMesh];
+
+	*ppfHull = mesh.GetHull();
+	*piNrHullVerts = mesh.GetNrHullVerts();
 }
\ No newline at end of file
@@ -5,21 +5,65 @@ class ID3D11Device;
 class ID3D11DeviceContext;
 class ID3D11Buffer;
 class ID3D11ShaderResourceView;
-struct Vec3;
+struct SDerivMapStats;
+struct SNoiseVolumeStats;
+struct SInstanceBatchStats;
+struct SInstanceCullStats;
+struct SDrawSubmitStats;
+
+#include <geommath/geommath_fwd.h>
 
 bool InitializeSceneGraph(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pContext, ID3D11Buffer * pGlobalsCB);
 void PassShadowResolve(ID3D11ShaderResourceView * pShadowResolveSRV);
 void ReleaseSceneGraph();
 void RenderSceneGraph(ID3D11DeviceContext *pContext, bool bSimpleLayout, bool bSkipGroundPlane=false);
+const SInstanceBatchStats * GetSceneInstanceBatchStats();		// of the last RenderSceneGraph()
+int GetNrSceneTransformsUpdated();								// by the last RebaseSceneGraph()
+
+// finds the instances inside the view frustum, RenderSceneGraph() draws
+// only those until the next call. mWorldToClip is projection times world
+// to view in the space of RebaseSceneGraph().
+void CullSceneGraph(const Mat44 &mWorldToClip);
+const SInstanceCullStats * GetSceneCullStats();					// of the last CullSceneGraph()
+const SDrawSubmitStats * GetSceneDrawSubmitStats();				// every pass since the last CullSceneGraph()
 Vec3 GetSunDir();
 
+// regenerates the hex-tiling per cell table when rotStrength changes
+void UpdateHexCellLUT(ID3D11DeviceContext *pContext, const float rotStrength);
+int GetHexCellLUTSize();
 
-// shadow support functions
-struct Vec3;
-struct Mat44;
+// ground plane and the size of its current color detail texture, for analysis
+void GetGroundPlaneInfo(Vec3 * pvCenter, float * pfHalfExtent);
+int GetGroundDetailTexSize();
+
+// conversion stats of the derivative map version of the ground's current
+// detail normal map. NULL if the conversion failed.
+const SDerivMapStats * GetGroundDerivMapStats();
+
+// the tileable noise volume sampled by dfractalsumvol() in noise.h and the
+// throughput of baking it. NULL if baking or creating the texture failed.
+const SNoiseVolumeStats * GetNoiseVolumeStats();
 
+// large worlds. Instances are placed at vWorldOffset plus their position at
+// setup and kept in double. RebaseSceneGraph() moves the world origin seen by
+// the GPU and by the shadow fitting to vOrigin, typically the camera. Only
+// instances without a parent are placed, the others follow their parent.
+void SetSceneGraphWorldOffset(const Vec3d &vWorldOffset);
+void RebaseSceneGraph(ID3D11DeviceContext *pContext, const Vec3d &vOrigin);
+
+
+// shadow support functions
 int GetNumberOfShadowCastingMeshInstances();
 void GetAABBoxAndTransformOfShadowCastingMeshInstance(Vec3 * pvMin, Vec3 * pvMax, Mat44 * pmMat, const int idx_in);
+void GetHullOfShadowCastingMeshInstance(const float ** ppfHull, int * piNrHullVerts, const int idx_in);		// local space, see shadow_hull.h
+
+// draws the shadow casting instances i for which (puMask[i]&uBit)!=0 with the
+// simple layout. Indices are those of the functions above. vLightDepthRow is
+// the row of the cascade's world to clip transform giving z, the draws go
+// front to back from the light. Returns the number of instances drawn and
+// *piNrBatches the number of instanced draws.
+int RenderShadowCastingMeshInstances(ID3D11DeviceContext *pContext, const unsigned char puMask[], const unsigned char uBit, const Vec4 &vLightDepthRow,
+									 int * piNrBatches=NULL);
 void ToggleDetailTex(bool toggleIsForColor);
 
 #endif
\ No newline at end of file
@@ -7,6 +7,7 @@
 #define Vec3		float3
 #define Vec4		float4
 #define Mat44		float4x4
+#define Vec4i		int4
 #define unistruct	cbuffer
 #define hbool		bool
 
@@ -32,6 +33,11 @@ struct Vec2
 	float x, y;
 };
 
+struct Vec4i
+{
+	int x, y, z, w;
+};
+
 
 #endif
 
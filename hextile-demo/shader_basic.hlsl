@@ -18,11 +18,11 @@ struct VS_OUTPUT
     float4 Position     : SV_POSITION;
 };
 
-VS_OUTPUT RenderSceneVS( VS_INPUT input)
+VS_OUTPUT RenderSceneVS( VS_INPUT input, uint instanceID : SV_InstanceID )
 {
 	VS_OUTPUT Output;
 
-	float3 vP = mul( float4(input.Position.xyz,1.0), g_mLocToWorld ).xyz;
+	float3 vP = mul( float4(input.Position.xyz,1.0), g_instanceTransforms[g_iFirstInstance + instanceID].mLocToWorld ).xyz;
 	
 	// Transform the position from object space to homogeneous projection space
 	Output.Position = mul( float4(vP,1.0), g_mViewProjection );
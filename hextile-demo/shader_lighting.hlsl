@@ -3,6 +3,7 @@
 #include "illum.h"
 #include "surfgrad_framework.h"
 #include "hextiling.h"
+#include "hextiling_rws.h"
 #include "noise.h"
 #include "canvas_common.h"
 
@@ -27,6 +28,9 @@ Texture2D g_trx_transfer_n;
 Texture2D g_trx_invtransfer_n;
 Texture2D g_trx_basis_n;
 
+Texture2D g_trx_dm;					// g_trx_n as a derivative map
+Buffer<float> g_trx_dm_scale;
+
 
 Texture2D g_shadowResolve;
 Texture2D g_table_FG;
@@ -60,12 +64,13 @@ struct VS_OUTPUT
 };
 
 
-VS_OUTPUT RenderSceneVS( VS_INPUT input)
+VS_OUTPUT RenderSceneVS( VS_INPUT input, uint instanceID : SV_InstanceID )
 {
 	VS_OUTPUT Output;
 	float3 vNormalWorldSpace;
 
-	float3 vP = mul( float4(input.Position.xyz,1.0), g_mLocToWorld ).xyz;
+	const SInstanceTransform inst = g_instanceTransforms[g_iFirstInstance + instanceID];
+	float3 vP = mul( float4(input.Position.xyz,1.0), inst.mLocToWorld ).xyz;
 	
 	// Transform the position from object space to homogeneous projection space
 	Output.Position = mul( float4(vP,1.0), g_mViewProjection );
@@ -73,8 +78,8 @@ VS_OUTPUT RenderSceneVS( VS_INPUT input)
 
 
 	// position & normal
-	Output.normal = normalize(mul((float3x3) g_mWorldToLocal, input.Normal.xyz));	// inverse transposed for normal
-	Output.tangent = float4( normalize(mul(input.Tangent.xyz, (float3x3) g_mLocToWorld)), input.Tangent.w );
+	Output.normal = normalize(mul((float3x3) inst.mWorldToLocal, input.Normal.xyz));	// inverse transposed for normal
+	Output.tangent = float4( normalize(mul(input.Tangent.xyz, (float3x3) inst.mLocToWorld)), input.Tangent.w );
 
 	Output.TextureUV = input.TextureUV.xy;
 	Output.TextureUV2 = input.TextureUV2.xy;
@@ -103,6 +108,16 @@ float GetTileRate()
 static bool g_bFlipVertDeriv = true;
 static float3 surfPosInWorld;
 static float3 surfPosInView;
+static float stochasticXi;
+static float2 pixCoord;
+
+// per pixel threshold for the stochastic hex-tiling mode. Interleaved gradient
+// noise, offset per frame, which temporal accumulation turns into the blend.
+float StochasticThreshold(float2 pixCoord)
+{
+	pixCoord += 5.588238*(g_iFrameIndex & 63);
+	return frac(52.9829189*frac(dot(pixCoord, float2(0.06711056, 0.00583715))));
+}
 
 void Prologue(VS_OUTPUT In)
 {
@@ -114,6 +129,16 @@ void Prologue(VS_OUTPUT In)
 	// actual world space position
 	surfPosInWorld = mul(float4(surfPosInView.xyz,1.0), g_mViewToWorld).xyz;
 
+	// per cell table used by hex-tiling
+	g_bCellLUTEnabled = g_bUseHexCellLUT!=0;
+	g_iCellLUTSize = g_iHexCellLUTSize;
+	pixCoord = In.Position.xy;
+	stochasticXi = StochasticThreshold(pixCoord);
+
+	// derivative maps used by hex-tiling
+	g_bDerivMapEnabled = g_bUseDerivMaps!=0;
+	g_fDerivMapScale = g_trx_dm_scale[0];
+
 	// relative world space
 	float3 relSurfPos = mul(surfPosInView, (float3x3) g_mViewToWorld);
 
@@ -238,17 +263,19 @@ void hex2colTex_histo(out float4 color, out float3 weights,
 	int2 vertex1, vertex2, vertex3;
 	TriangleGrid(w1, w2, w3, vertex1, vertex2, vertex3, st);
 
-	float2x2 rot1 = LoadRot2x2(vertex1, rotStrength);
-	float2x2 rot2 = LoadRot2x2(vertex2, rotStrength);
-	float2x2 rot3 = LoadRot2x2(vertex3, rotStrength);
+	float2x2 rot1, rot2, rot3;
+	float2 offs1, offs2, offs3;
+	LoadCellRotAndOffset(rot1, offs1, vertex1, rotStrength);
+	LoadCellRotAndOffset(rot2, offs2, vertex2, rotStrength);
+	LoadCellRotAndOffset(rot3, offs3, vertex3, rotStrength);
 
 	float2 cen1 = MakeCenST(vertex1);
 	float2 cen2 = MakeCenST(vertex2);
 	float2 cen3 = MakeCenST(vertex3);
 
-	float2 st1 = mul(st - cen1, rot1) + cen1 + hash(vertex1);
-	float2 st2 = mul(st - cen2, rot2) + cen2 + hash(vertex2);
-	float2 st3 = mul(st - cen3, rot3) + cen3 + hash(vertex3);
+	float2 st1 = mul(st - cen1, rot1) + cen1 + offs1;
+	float2 st2 = mul(st - cen2, rot2) + cen2 + offs2;
+	float2 st3 = mul(st - cen3, rot3) + cen3 + offs3;
 
 
 	// Fetch input
@@ -293,33 +320,82 @@ void hex2colTex_histo(out float4 color, out float3 weights,
 	weights = ProduceHexWeights(W, vertex1, vertex2, vertex3);
 }
 
-void FetchColorAndWeight(out float3 color, out float3 weights, float2 st)
+float GetLodFallbackWeight(Texture2D tex, float2 st)
+{
+	return (g_bHexLodFallback && !g_useRegularTiling) ?
+		HexLodFallbackWeight(tex, st, g_fHexLodFallbackStart, g_fHexLodFallbackRange) : 0.0;
+}
+
+// When camera relative st is in relative world space and the offsets of
+// plane axis (0, 1 or 2 as in GetPlanarST()) are needed. The single fetch
+// only needs the fractional part which is st_offs + cen_offs, mod 1.
+float2 GetSingleFetchST(float2 st, int axis)
+{
+	return g_bCameraRelative ? (st + g_vHexRWSOffs[axis].xy + g_vHexRWSOffs[axis].zw) : st;
+}
+
+// The histogram-preserving and stochastic variants have no RWS version
+// so when camera relative the regular hex-tiling RWS path is used.
+void FetchColorAndWeight(out float3 color, out float3 weights, float2 st, int axis)
 {
 	float4 col4;
-	if(g_useRegularTiling)
+	float fallback = GetLodFallbackWeight(g_trx_d, st);
+	if(g_useRegularTiling || fallback>=1.0)
 	{
-		col4 = g_trx_d.Sample(g_samWrap, st);
+		col4 = g_trx_d.Sample(g_samWrap, GetSingleFetchST(st, axis));
 		weights = 1.0;
 	}
+	else if(g_bCameraRelative)
+	{
+		hex2colTexRWS(col4, weights, g_trx_d, g_samWrap, st, g_vHexRWSOffs[axis].xy, g_vHexRWSOffs[axis].zw,
+					  g_iHexRWSCellOffs[axis].xy, g_rotStrength, g_FakeContrastColor);
+	}
 	else if(g_bUseHistoPreserv)
 	{
 		hex2colTex_histo(col4, weights, 
 					g_trx_transfer_d, g_trx_invtransfer_d, g_trx_basis_d, g_samWrap, 
 					st, g_rotStrength);
 	}
+	else if(g_bHexStochastic)
+	{
+		hex2colTexStochastic(col4, weights, g_trx_d, g_samWrap, st, g_rotStrength, stochasticXi, g_FakeContrastColor);
+	}
 	else
 	{
 		hex2colTex(col4, weights, g_trx_d, g_samWrap, st, g_rotStrength, g_FakeContrastColor);
 	}
+
+	if(fallback>0.0 && fallback<1.0)
+		col4 = lerp(col4, g_trx_d.Sample(g_samWrap, GetSingleFetchST(st, axis)), fallback);
+
 	color = col4.xyz;
 }
 
-void FetchDerivAndWeight(out float2 dHduv, out float3 weights, float2 st)
+// single fetch of the detail derivative, see sampleDeriv()
+float2 FetchDetailDeriv(float2 st)
 {
-	if(g_useRegularTiling)
+	if(g_bDerivMapEnabled)
+		return g_fDerivMapScale*(2*g_trx_dm.Sample(g_samWrap, st).xy-1.0);
+
+	float4 color = g_trx_n.Sample(g_samWrap, st);
+	return TspaceNormalToDerivative(2*color.xyz-1.0);
+}
+
+void FetchDerivAndWeight(out float2 dHduv, out float3 weights, float2 st, int axis)
+{
+	float fallback = GetLodFallbackWeight(g_trx_n, st);
+	if(g_useRegularTiling || fallback>=1.0)
 	{
-		float4 color = g_trx_n.Sample(g_samWrap, st);
-		dHduv = TspaceNormalToDerivative(2*color.xyz-1.0);
+		dHduv = FetchDetailDeriv(GetSingleFetchST(st, axis));
+		weights = 1.0;
+	}
+	else if(g_bCameraRelative)
+	{
+		float2 st_offs = g_vHexRWSOffs[axis].xy, cen_offs = g_vHexRWSOffs[axis].zw;
+		int2 cell_offs = g_iHexRWSCellOffs[axis].xy;
+		if(g_bDerivMapEnabled)
+			bumphex2derivNMapRWS(dHduv, weights, g_trx_dm, g_samWrap, st, st_offs, cen_offs, cell_offs, g_rotStrength, g_FakeContrastNormal);
+		else bumphex2derivNMapRWS(dHduv, weights, g_trx_n, g_samWrap, st, st_offs, cen_offs, cell_offs, g_rotStrength, g_FakeContrastNormal);
 	}
 	else if(g_bUseHistoPreserv)
 	{
@@ -329,10 +405,21 @@ void FetchDerivAndWeight(out float2 dHduv, out float3 weights, float2 st)
 					st, g_rotStrength);
 		dHduv = TspaceNormalToDerivative(2*color.xyz-1.0);
 	}
+	else if(g_bHexStochastic)
+	{
+		if(g_bDerivMapEnabled)
+			bumphex2derivNMapStochastic(dHduv, weights, g_trx_dm, g_samWrap, st, g_rotStrength, stochasticXi, g_FakeContrastNormal);
+		else bumphex2derivNMapStochastic(dHduv, weights, g_trx_n, g_samWrap, st, g_rotStrength, stochasticXi, g_FakeContrastNormal);
+	}
 	else
 	{
-		bumphex2derivNMap(dHduv, weights, g_trx_n, g_samWrap, st, g_rotStrength, g_FakeContrastNormal);
+		if(g_bDerivMapEnabled)
+			bumphex2derivNMap(dHduv, weights, g_trx_dm, g_samWrap, st, g_rotStrength, g_FakeContrastNormal);
+		else bumphex2derivNMap(dHduv, weights, g_trx_n, g_samWrap, st, g_rotStrength, g_FakeContrastNormal);
 	}
+
+	if(fallback>0.0 && fallback<1.0)
+		dHduv = lerp(dHduv, FetchDetailDeriv(GetSingleFetchST(st, axis)), fallback);
 }
 
 
@@ -358,7 +445,7 @@ float4 GroundExamplePS( VS_OUTPUT In ) : SV_TARGET0
 	if(g_bHexColorEnabled)
 	{
 		float3 color, weights;
-		FetchColorAndWeight(color, weights, st0);
+		FetchColorAndWeight(color, weights, st0, 1);
 
 		albedo = color;
 
@@ -375,7 +462,7 @@ float4 GroundExamplePS( VS_OUTPUT In ) : SV_TARGET0
 
 		float2 dHduv=0.0;
 		float3 weights=0.0;
-		FetchDerivAndWeight(dHduv, weights, st0);
+		FetchDerivAndWeight(dHduv, weights, st0, 1);
 
 		if(!g_bHexColorEnabled)
 		{
@@ -405,6 +492,40 @@ float4 GroundExamplePS( VS_OUTPUT In ) : SV_TARGET0
 }
 #endif
 
+// maximum of v over the 2x2 quad, exact since fine derivatives give the
+// difference to the horizontal and then to the vertical neighbor.
+float3 QuadMax(float3 v)
+{
+	bool2 isFirst = (uint2(pixCoord) & 1) == 0;
+	float3 dx = ddx_fine(v);
+	float3 rowMax = v + max(isFirst.x ? dx : -dx, 0.0);
+	float3 dy = ddy_fine(rowMax);
+	return rowMax + max(isFirst.y ? dy : -dy, 0.0);
+}
+
+// Subtracting the threshold and renormalizing fades a projection out
+// continuously, and its weight is exactly zero once below the threshold.
+float3 SkipTriplanarWeights(float3 weights, float threshold)
+{
+	weights = max(0, weights - min(threshold, 0.33));
+	return weights / (weights.x + weights.y + weights.z);
+}
+
+// projections to fetch in CommonTriplanarColor() and CommonTriplanarNormal().
+// The decision is made per 2x2 quad so derivatives inside the fetches stay valid.
+float3 DetermineTriplanarWeightsAndFetches(out bool3 doFetch)
+{
+	float3 weights = DetermineTriplanarWeights(3.0);
+	doFetch = true;
+	if(g_bTriplanarSkip)
+	{
+		weights = SkipTriplanarWeights(weights, g_fTriplanarSkipThreshold);
+		doFetch = QuadMax(weights) > 0.0;
+	}
+
+	return weights;
+}
+
 void CommonTriplanarNormal(out float3 normO, out float3 weightsO, float3 position, float3 Nbase, float bumpScale)
 {
 	// backup base normal and patch it
@@ -422,9 +543,12 @@ void CommonTriplanarNormal(out float3 normO, out float3 weightsO, float3 positio
 	float2 dHduv_x=0.0, dHduv_y=0.0, dHduv_z=0.0;
 	float3 weights_x=0.0, weights_y=0.0, weights_z=0.0;
 
-	FetchDerivAndWeight(dHduv_x, weights_x, float2(sp_x.x, 1.0-sp_x.y));
-	FetchDerivAndWeight(dHduv_y, weights_y, float2(sp_y.x, 1.0-sp_y.y));
-	FetchDerivAndWeight(dHduv_z, weights_z, float2(sp_z.x, 1.0-sp_z.y));
+	bool3 doFetch;
+	float3 weights = DetermineTriplanarWeightsAndFetches(doFetch);
+
+	if(doFetch.x) FetchDerivAndWeight(dHduv_x, weights_x, float2(sp_x.x, 1.0-sp_x.y), 0);
+	if(doFetch.y) FetchDerivAndWeight(dHduv_y, weights_y, float2(sp_y.x, 1.0-sp_y.y), 1);
+	if(doFetch.z) FetchDerivAndWeight(dHduv_z, weights_z, float2(sp_z.x, 1.0-sp_z.y), 2);
 
 	// switch to lower-left origin
 	dHduv_x.y *= -1.0; dHduv_y.y *= -1.0; dHduv_z.y *= -1.0;
@@ -433,7 +557,6 @@ void CommonTriplanarNormal(out float3 normO, out float3 weightsO, float3 positio
 	dHduv_x.x *= -1.0; dHduv_y.y *= -1.0;
 
 
-	float3 weights = DetermineTriplanarWeights(3.0);
 	float3 surfGrad = bumpScale * SurfgradFromTriplanarProjection(weights, dHduv_x, dHduv_y, dHduv_z);
 
 
@@ -461,11 +584,13 @@ void CommonTriplanarColor(out float3 colorO, out float3 weightsO, float3 positio
 	float3 col_x=0.0, col_y=0.0, col_z=0.0;
 	float3 weights_x=0.0, weights_y=0.0, weights_z=0.0;
 
-	FetchColorAndWeight(col_x, weights_x, float2(sp_x.x, 1.0-sp_x.y));
-	FetchColorAndWeight(col_y, weights_y, float2(sp_y.x, 1.0-sp_y.y));
-	FetchColorAndWeight(col_z, weights_z, float2(sp_z.x, 1.0-sp_z.y));
+	bool3 doFetch;
+	float3 weights = DetermineTriplanarWeightsAndFetches(doFetch);
+
+	if(doFetch.x) FetchColorAndWeight(col_x, weights_x, float2(sp_x.x, 1.0-sp_x.y), 0);
+	if(doFetch.y) FetchColorAndWeight(col_y, weights_y, float2(sp_y.x, 1.0-sp_y.y), 1);
+	if(doFetch.z) FetchColorAndWeight(col_z, weights_z, float2(sp_z.x, 1.0-sp_z.y), 2);
 	
-	float3 weights = DetermineTriplanarWeights(3.0);
 
 	colorO = weights.x*col_x + weights.y*col_y + weights.z*col_z;
 	weightsO = weights.x*weights_x + weights.y*weights_y + weights.z*weights_z;
@@ -474,12 +599,86 @@ void CommonTriplanarColor(out float3 colorO, out float3 weightsO, float3 positio
 	nrmBaseNormal = recordBaseNorm;
 }
 
+// lookup coordinate of the plane for axis 0, 1 or 2, same as the triplanar path
+float2 GetPlanarST(float3 pos, int axis)
+{
+	float2 sp = axis==0 ? float2(-pos.z, pos.y) : (axis==1 ? float2(pos.x, -pos.z) : float2(pos.x, pos.y));
+
+	// need to negate .y of derivative due to upper-left corner being the texture origin
+	return float2(sp.x, 1.0-sp.y);
+}
+
+float2 FixPlanarDeriv(float2 dHduv, int axis)
+{
+	// switch to lower-left origin
+	dHduv.y *= -1.0;
+
+	// need to negate these back since we used (-z,y) and (x,-z) for sampling
+	if(axis==0) dHduv.x *= -1.0;
+	else if(axis==1) dHduv.y *= -1.0;
+
+	return dHduv;
+}
+
+// two planes rather than three, see DetermineBiplanarWeights()
+void CommonBiplanarNormal(out float3 normO, out float3 weightsO, float3 position, float3 Nbase, float bumpScale)
+{
+	// backup base normal and patch it
+	const float3 recordBaseNorm = nrmBaseNormal;
+	nrmBaseNormal = Nbase;
+
+	float3 pos = GetTileRate() * position;
+
+	int2 axes;
+	float2 weights = DetermineBiplanarWeights(axes, 3.0);
+
+	float2 dHduv_0=0.0, dHduv_1=0.0;
+	float3 weights_0=0.0, weights_1=0.0;
+	FetchDerivAndWeight(dHduv_0, weights_0, GetPlanarST(pos, axes.x), axes.x);
+	FetchDerivAndWeight(dHduv_1, weights_1, GetPlanarST(pos, axes.y), axes.y);
+
+	dHduv_0 = FixPlanarDeriv(dHduv_0, axes.x);
+	dHduv_1 = FixPlanarDeriv(dHduv_1, axes.y);
+
+	float3 surfGrad = bumpScale * SurfgradFromBiplanarProjection(weights, axes, dHduv_0, dHduv_1);
+
+	normO = ResolveNormalFromSurfaceGradient(surfGrad);
+	weightsO = weights.x*weights_0 + weights.y*weights_1;
+
+	// restore base normal 
+	nrmBaseNormal = recordBaseNorm;
+}
+
+void CommonBiplanarColor(out float3 colorO, out float3 weightsO, float3 position, float3 Nbase)
+{
+	// backup base normal and patch it
+	const float3 recordBaseNorm = nrmBaseNormal;
+	nrmBaseNormal = Nbase;
+
+	float3 pos = GetTileRate() * position;
+
+	int2 axes;
+	float2 weights = DetermineBiplanarWeights(axes, 3.0);
+
+	float3 col_0=0.0, col_1=0.0;
+	float3 weights_0=0.0, weights_1=0.0;
+	FetchColorAndWeight(col_0, weights_0, GetPlanarST(pos, axes.x), axes.x);
+	FetchColorAndWeight(col_1, weights_1, GetPlanarST(pos, axes.y), axes.y);
+
+	colorO = weights.x*col_0 + weights.y*col_1;
+	weightsO = weights.x*weights_0 + weights.y*weights_1;
+
+	// restore base normal 
+	nrmBaseNormal = recordBaseNorm;
+}
+
 void FetchColorNormalTriPlanar(inout float3 albedo, inout float3 vN, float3 position, float3 Nbase, float bumpScale=1.0)
 {
 	if(g_bHexColorEnabled)
 	{
 		float3 color, weights;
-		CommonTriplanarColor(color, weights, position, Nbase);
+		if(g_bBiplanar) CommonBiplanarColor(color, weights, position, Nbase);
+		else CommonTriplanarColor(color, weights, position, Nbase);
 
 		albedo = color;
 
@@ -494,7 +693,8 @@ void FetchColorNormalTriPlanar(inout float3 albedo, inout float3 vN, float3 posi
 		//float bs = (g_showWeightsMode!=2 || g_bHexColorEnabled) ? bumpScale : 0.0;
 		float bs = g_showWeightsMode==2 ? 0.0 : bumpScale;
 		float3 weights=0.0;
-		CommonTriplanarNormal(vN, weights, position, Nbase, bs);
+		if(g_bBiplanar) CommonBiplanarNormal(vN, weights, position, Nbase, bs);
+		else CommonTriplanarNormal(vN, weights, position, Nbase, bs);
 
 		if(!g_bHexColorEnabled)
 		{
@@ -516,6 +716,18 @@ float4 SphereExamplePS( VS_OUTPUT In ) : SV_TARGET0
 
 	//float3 albedo = pow(float3(70.0,101.0,125.0)/255.0, 2.2);
 	FetchColorNormalTriPlanar(albedo, vN, surfPosInWorld, nrmBaseNormal);
+
+	// volume bump map from fractal noise on top
+	if(g_iNoiseBumpMode!=0)
+	{
+		float3 P = g_fNoiseBumpFreq*surfPosInWorld;
+		float pixSize = GetPixelSize(P);
+		float4 dN = g_iNoiseBumpMode==2 ? dfractalsumvol(P, pixSize, g_fNoiseVolPeriod, g_fNoiseVolTexelSize) : dfractalsum(P, pixSize);
+
+		const float noiseBumpScale = 0.15;
+		float3 surfGrad = SurfgradFromPerturbedNormal(vN) + noiseBumpScale*SurfgradFromVolumeGradient(dN.yzw);
+		vN = ResolveNormalFromSurfaceGradient(surfGrad);
+	}
 	
 
 	return float4(Epilogue(In, vN, albedo),1);
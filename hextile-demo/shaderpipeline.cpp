@@ -1,5 +1,6 @@
 #include "shaderpipeline.h"
 #include "shader.h"
+#include "cputools/command_list.h"
 #include <assert.h>
 
 // prepare pipeline for drawing
@@ -135,6 +136,78 @@ void CShaderPipeline::FlushResources(ID3D11DeviceContext* pd3dImmCntxt)
 	}
 }
 
+// stage as in SDrawStateCache, vertex, hull, domain, geometry and pixel
+const CShaderPipeline::SShaderHeader * CShaderPipeline::GetShaderHeader(const int iStage) const
+{
+	switch(iStage)
+	{
+		case 0: return &m_sVertShader;
+		case 1: return &m_sHullShader;
+		case 2: return &m_sDomainShader;
+		case 3: return &m_sGeometryShader;
+		default: return &m_sPixelShader;
+	}
+}
+
+// same bindings as above recorded into pList, diffed against the state
+// recorded before. Unlike the uncached path the slots of stages without a
+// shader are left as they are.
+void CShaderPipeline::RecordPipelineForRendering(SCommandList * pList, SDrawStateCache * pCache) const
+{
+	for(int st=0; st<DRAW_STATE_NUM_STAGES; st++)
+	{
+		const SShaderHeader * pHeader = GetShaderHeader(st);
+		const void * pShader = pHeader->pShader!=NULL ? pHeader->pShader->GetDeviceChild() : NULL;
+
+		if(pHeader->pShader!=NULL)
+		{
+			const SResourceList * pLists[] = {&pHeader->sCnstBufferList, &pHeader->sSamplerList, &pHeader->sResourceViewList};
+			for(int k=0; k<NUM_DRAW_STATE_SLOT_KINDS; k++)
+			{
+				const void * const * ppList = (const void * const *) pLists[k]->m_pList;
+				int iFirst = 0;
+				const int iNr = UpdateDrawStateSlots(&iFirst, pCache, st, (DRAW_STATE_SLOT_KIND) k, ppList, pLists[k]->iAllocatedArraySize);
+				if(iNr>0) RecordSetSlots(pList, st, (DRAW_STATE_SLOT_KIND) k, iFirst, iNr, ppList+iFirst);
+			}
+		}
+
+		if(UpdateDrawStateShader(pCache, st, pShader))
+			RecordSetShader(pList, st, pShader);
+	}
+}
+
+int CShaderPipeline::CountPrepCalls() const
+{
+	int iNrCalls = DRAW_STATE_NUM_STAGES;		// the shaders
+	for(int st=0; st<DRAW_STATE_NUM_STAGES; st++)
+	{
+		const SShaderHeader * pHeader = GetShaderHeader(st);
+		if(pHeader->pShader!=NULL)
+		{
+			if(pHeader->sCnstBufferList.iAllocatedArraySize>0) ++iNrCalls;
+			if(pHeader->sSamplerList.iAllocatedArraySize>0) ++iNrCalls;
+			if(pHeader->sResourceViewList.iAllocatedArraySize>0) ++iNrCalls;
+		}
+	}
+	return iNrCalls;
+}
+
+int CShaderPipeline::CountFlushCalls() const
+{
+	int iNrCalls = 0;
+	for(int st=0; st<DRAW_STATE_NUM_STAGES; st++)
+	{
+		const SShaderHeader * pHeader = GetShaderHeader(st);
+		if(pHeader->pShader!=NULL)
+		{
+			iNrCalls += (pHeader->sCnstBufferList.iAllocatedArraySize+MAX_CLEAR-1)/MAX_CLEAR;
+			iNrCalls += (pHeader->sSamplerList.iAllocatedArraySize+MAX_CLEAR-1)/MAX_CLEAR;
+			iNrCalls += (pHeader->sResourceViewList.iAllocatedArraySize+MAX_CLEAR-1)/MAX_CLEAR;
+		}
+	}
+	return iNrCalls;
+}
+
 // register shaders before resources
 void CShaderPipeline::SetVertexShader(CShader * pShader)
 {
@@ -5,6 +5,8 @@
 #include <d3d11_2.h> 
 
 class CShader;
+struct SDrawStateCache;
+struct SCommandList;
 
 class CShaderPipeline
 {
@@ -13,6 +15,16 @@ public:
 	void PrepPipelineForRendering(ID3D11DeviceContext* pd3dImmCntxt);
 	void FlushResources(ID3D11DeviceContext* pd3dImmCntxt);
 
+	// records only the bindings which differ from those recorded in pCache
+	// and leaves them bound, RecordFlushDrawStateCache() unbinds at the end
+	// of the pass. See cputools/command_list.h.
+	void RecordPipelineForRendering(SCommandList * pList, SDrawStateCache * pCache) const;
+
+	// number of calls made by PrepPipelineForRendering() and FlushResources()
+	// without a cache
+	int CountPrepCalls() const;
+	int CountFlushCalls() const;
+
 	// register shaders before command buffers
 	void SetVertexShader(CShader * pShader);
 	void SetHullShader(CShader * pShader);
@@ -69,6 +81,7 @@ private:
 	SShaderHeader m_sPixelShader;
 
 	void RegResourceWithShader(CShader * pShader, SResourceList * pResourceList, const char cbName[], ResourcePointer sResourceHandler);
+	const SShaderHeader * GetShaderHeader(const int iStage) const;
 };
 
 #endif
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "shadows_cbuffer.h"
 #include "scenegraph.h"
 #include <math.h>
+#include <string.h>
+#include <vector>
 #include "DXUT.h"
 
 #include "shaderpipeline.h"
@@ -10,160 +12,172 @@
 #include "shaderutils.h"
 
 
-static void BuildBasis(Vec3 * vXout, Vec3 * vYout, const Vec3 vDir)
+void CShadowMap::RenderShadowMap(ID3D11DeviceContext* pd3dImmediateContext, ID3D11Buffer * pGlobalsCB, const Vec3 &sunDir,
+								 const Mat44 &mViewToWorld, const float fFovY, const float fAspect, const float fNear, const float fFar, const Vec3d &vOrigin)
 {
-	Vec3 vX, vY;
-
-	const float avx = fabsf(vDir.x);
-	const float avy = fabsf(vDir.y);
-	const float avz = fabsf(vDir.z);
-
-    if(avx<=avy && avx<=avz)
-    {
-		vY.x=0.0f; vY.y=vDir.z; vY.z=-vDir.y;
-    }
-    else if(avy<=avz)
-    {	
-		vY.x=vDir.z; vY.y=0.0f; vY.z=-vDir.x;  
-    }
-    else
-    {
-		vY.x=vDir.y; vY.y=-vDir.x; vY.z=0.0f;  
-    }
-
-    const float fRecLen = 1.0f / sqrtf(vY.x*vY.x+vY.y*vY.y+vY.z*vY.z);
-	vY.x *= fRecLen; vY.y *= fRecLen; vY.z *= fRecLen;
-
-	vX.x = vY.y*vDir.z - vY.z*vDir.y;
-	vX.y = vY.z*vDir.x - vY.x*vDir.z;
-	vX.z = vY.x*vDir.y - vY.y*vDir.x;
-
-	// return result
-	*vXout = vX; *vYout = vY;
-}
-
-
-
-void CShadowMap::RenderShadowMap(ID3D11DeviceContext* pd3dImmediateContext, ID3D11Buffer * pGlobalsCB, const Vec3 &sunDir)
-{
-	// build frame of reference for the sun
-	const Vec3 vZ = -sunDir;
-	Vec3 vX, vY;
-	BuildBasis(&vX, &vY, vZ);
-	Mat33 rotToLgt;
-	SetRow(&rotToLgt, 0, vX); SetRow(&rotToLgt, 1, vY); SetRow(&rotToLgt, 2, vZ);
-
-
-	// build up a bound around casters in light space
+	// one tile of the atlas per cascade
+	const int iTileWidth = m_iWidth/2, iTileHeight = m_iHeight/2;
+
+	SShadowCascadeParams params;
+	params.mViewToWorld = mViewToWorld;
+	params.fFovY = fFovY;
+	params.fAspect = fAspect;
+	params.fNear = fNear;
+	params.fFar = fFar;
+	params.fMaxShadowDist = m_fMaxShadowDist;
+	params.iNrCascades = m_iNrCascades;
+	params.fSplitLambda = m_fSplitLambda;
+	params.iResolution = iTileWidth<iTileHeight ? iTileWidth : iTileHeight;
+	params.vSunDir = sunDir;
+	params.vOrigin = vOrigin;
+
+	// casters in world space
 	const int nrShadowCasters = GetNumberOfShadowCastingMeshInstances();
-
-	Vec3 vGlbMi, vGlbMa;
-
+	std::vector<SShadowCaster> casters(nrShadowCasters);
 	for(int i=0; i<nrShadowCasters; i++)
 	{
-		Vec3 vMi, vMa;
-		Mat44 mat;
-		GetAABBoxAndTransformOfShadowCastingMeshInstance(&vMi, &vMa, &mat, i);
-
-		for(int j=0; j<8; j++)
-		{
-			const Vec3 vPloc = Vec3((j&0x1)!=0 ? vMa.x : vMi.x, (j&0x2)!=0 ? vMa.y : vMi.y, (j&0x4)!=0 ? vMa.z : vMi.z);
-
-			const Vec4 v4Pw = mat*vPloc;
-			const Vec3 vP = rotToLgt * Vec3(v4Pw.x, v4Pw.y, v4Pw.z);
-
-			if(i==0 && j==0) { vGlbMi=vP; vGlbMa=vP; }
-			else
-			{
-				if(vGlbMi.x>vP.x) vGlbMi.x=vP.x;
-				else if(vGlbMa.x<vP.x) vGlbMa.x=vP.x;
-				if(vGlbMi.y>vP.y) vGlbMi.y=vP.y;
-				else if(vGlbMa.y<vP.y) vGlbMa.y=vP.y;
-				if(vGlbMi.z>vP.z) vGlbMi.z=vP.z;
-				else if(vGlbMa.z<vP.z) vGlbMa.z=vP.z;
-			}
-		}
+		GetAABBoxAndTransformOfShadowCastingMeshInstance(&casters[i].vMin, &casters[i].vMax, &casters[i].mLocToWorld, i);
+		GetHullOfShadowCastingMeshInstance(&casters[i].pfHull, &casters[i].iNrHullVerts, i);
 	}
 
-	const Vec3 vCen = 0.5f*(vGlbMa+vGlbMi);
+	FitShadowCascades(m_cascades, params, nrShadowCasters>0 ? &casters[0] : NULL, nrShadowCasters);
 
-	Mat44 toLgt;
-	SetRow(&toLgt, 0, Vec4(vX.x, vX.y, vX.z, -vCen.x));
-	SetRow(&toLgt, 1, Vec4(vY.x, vY.y, vY.z, -vCen.y));
-	SetRow(&toLgt, 2, Vec4(vZ.x, vZ.y, vZ.z, -vCen.z));
-	SetRow(&toLgt, 3, Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	// casters that cannot shadow the receivers of a cascade are skipped for it.
+	// One extra element keeps the pointers valid when there are no casters.
+	std::vector<float> bounds(6*nrShadowCasters+1);
+	std::vector<unsigned char> cascadeMask(nrShadowCasters+1);
+	float * pfCen[] = { &bounds[0], &bounds[nrShadowCasters], &bounds[2*nrShadowCasters] };
+	float * pfExt[] = { &bounds[3*nrShadowCasters], &bounds[4*nrShadowCasters], &bounds[5*nrShadowCasters] };
+	GetShadowCasterWorldBounds(pfCen, pfExt, nrShadowCasters>0 ? &casters[0] : NULL, nrShadowCasters);
+	const float * const pfCenC[] = { pfCen[0], pfCen[1], pfCen[2] };
+	const float * const pfExtC[] = { pfExt[0], pfExt[1], pfExt[2] };
 
-	Vec3 vHalfSize = 0.5f*(vGlbMa-vGlbMi);
+	memset(&m_cullStats, 0, sizeof(m_cullStats));
+	m_cullStats.iNrCasters = nrShadowCasters;
+	m_cullStats.iNrCulled = CullShadowCasters(&cascadeMask[0], m_cascades, m_iNrCascades, sunDir, pfCenC, pfExtC, nrShadowCasters);
 
-	// build ortho matrix
-	Mat44 proj;
-	SetRow(&proj, 0, Vec4(1.0f/vHalfSize.x, 0.0f, 0.0f, 0.0f) );
-	SetRow(&proj, 1, Vec4(0.0f, 1.0f/vHalfSize.y, 0.0f, 0.0f) );
-	SetRow(&proj, 2, Vec4(0.0f, 0.0f, -0.5f/vHalfSize.z, 0.5f) );
-	SetRow(&proj, 3, Vec4(0.0f, 0.0f, 0.0f, 1.0f) );
-			 
+	// only what changed since the last frame is rendered
+	SShadowCascadeUpdate updates[MAX_SHADOW_CASCADES];
+	UpdateShadowCache(&m_cache, updates, m_cascades, m_iNrCascades, sunDir, nrShadowCasters>0 ? &casters[0] : NULL, nrShadowCasters);
+	std::vector<unsigned char> rectMask(nrShadowCasters+1);
 
-	Mat44 viewProj = proj * toLgt;
 
 	HRESULT hr;
 	D3D11_MAPPED_SUBRESOURCE MappedSubResource;
-	V( pd3dImmediateContext->Map( pGlobalsCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
-	((cbGlobals *)MappedSubResource.pData)->g_mWorldToView = Transpose(toLgt);
-	((cbGlobals *)MappedSubResource.pData)->g_mViewToWorld = Transpose(~toLgt);
-	//((cbGlobals *)MappedSubResource.pData)->g_mScrToView = Transpose(g_mScrToView);
-	((cbGlobals *)MappedSubResource.pData)->g_mProj = Transpose(proj);
-	((cbGlobals *)MappedSubResource.pData)->g_mViewProjection = Transpose(viewProj);
-	((cbGlobals *)MappedSubResource.pData)->g_vCamPos = (~toLgt) * Vec3(0,0,0);
-	((cbGlobals *)MappedSubResource.pData)->g_iWidth = 4096;
-	((cbGlobals *)MappedSubResource.pData)->g_iHeight = 4096;
-	((cbGlobals *)MappedSubResource.pData)->g_bShowNormalsWS = false;
-	((cbGlobals *)MappedSubResource.pData)->g_vSunDir = sunDir;
-    pd3dImmediateContext->Unmap( pGlobalsCB, 0 );
-
-
-
-	// prefill depth
-	const bool bRenderFront = true;
-	float ClearColor[4] = { 0.03f, 0.05f, 0.1f, 0.0f };
-
-	// Setup the viewport to match the backbuffer
-    D3D11_VIEWPORT vp;
-    vp.Width = (FLOAT)4096;
-    vp.Height = (FLOAT)4096;
-    vp.MinDepth = 0;
-    vp.MaxDepth = 1;
-    vp.TopLeftX = 0;
-    vp.TopLeftY = 0;
-    pd3dImmediateContext->RSSetViewports( 1, &vp );
-
 
 	ID3D11DepthStencilView* pDSV = m_tex_shadowmap.GetDSV();
 	pd3dImmediateContext->OMSetRenderTargets( 0, NULL, pDSV );
-    pd3dImmediateContext->ClearDepthStencilView( pDSV, D3D11_CLEAR_DEPTH, 1.0f, 0 );
 
+	pd3dImmediateContext->RSSetState( m_pRasterStateSolidCullBack_Scissor );
 
-	pd3dImmediateContext->RSSetState( GetDefaultRasterSolidCullBack()  );
-	pd3dImmediateContext->OMSetDepthStencilState( GetDefaultDepthStencilState(), 0 );
+	Mat44 mWorldToSmap[MAX_SHADOW_CASCADES];
+	Vec4 vRect[MAX_SHADOW_CASCADES], vBias[MAX_SHADOW_CASCADES];
 
-	RenderSceneGraph(pd3dImmediateContext, true, true);
+	for(int c=0; c<m_iNrCascades; c++)
+	{
+		const SShadowCascade &cascade = m_cascades[c];
+		const Mat44 viewProj = cascade.mProj * cascade.mWorldToLight;
+
+		const int iX0 = (c&0x1)*iTileWidth + cascade.iViewport[0];
+		const int iY0 = (c>>1)*iTileHeight + cascade.iViewport[1];
+		const int iW = cascade.iViewport[2], iH = cascade.iViewport[3];
+
+		// clip space of the window to the uv of the atlas
+		Mat44 mToScr;
+		SetRow(&mToScr, 0, Vec4((0.5f*iW)/m_iWidth, 0,     0,  (iX0+0.5f*iW)/m_iWidth));
+		SetRow(&mToScr, 1, Vec4(0,     (-0.5f*iH)/m_iHeight, 0,  (iY0+0.5f*iH)/m_iHeight));
+		SetRow(&mToScr, 2, Vec4(0,     0,     1,  0));
+		SetRow(&mToScr, 3, Vec4(0,     0,     0,  1));
+		mWorldToSmap[c] = mToScr * viewProj;
+
+		// a texel inside the window so the filter never reads a neighboring tile
+		vRect[c] = cascade.bEmpty ? Vec4(1,1,0,0) : Vec4(((float) (iX0+1))/m_iWidth, ((float) (iY0+1))/m_iHeight, ((float) (iX0+iW-1))/m_iWidth, ((float) (iY0+iH-1))/m_iHeight);
+
+		// a couple of texels worth of depth, the depth range differs per cascade
+		const float fDepthRange = cascade.vLightMax.z - cascade.vLightMin.z;
+		vBias[c] = Vec4((2.5f*cascade.fTexelSize)/fDepthRange, 0, 0, 0);
+
+		const SShadowCascadeUpdate &update = updates[c];
+		if(cascade.bEmpty || (!update.bFull && update.rects.size()==0)) continue;
+
+		V( pd3dImmediateContext->Map( pGlobalsCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
+		((cbGlobals *)MappedSubResource.pData)->g_mWorldToView = Transpose(cascade.mWorldToLight);
+		((cbGlobals *)MappedSubResource.pData)->g_mViewToWorld = Transpose(~cascade.mWorldToLight);
+		//((cbGlobals *)MappedSubResource.pData)->g_mScrToView = Transpose(g_mScrToView);
+		((cbGlobals *)MappedSubResource.pData)->g_mProj = Transpose(cascade.mProj);
+		((cbGlobals *)MappedSubResource.pData)->g_mViewProjection = Transpose(viewProj);
+		((cbGlobals *)MappedSubResource.pData)->g_vCamPos = (~cascade.mWorldToLight) * Vec3(0,0,0);
+		((cbGlobals *)MappedSubResource.pData)->g_iWidth = iW;
+		((cbGlobals *)MappedSubResource.pData)->g_iHeight = iH;
+		((cbGlobals *)MappedSubResource.pData)->g_bShowNormalsWS = false;
+		((cbGlobals *)MappedSubResource.pData)->g_vSunDir = sunDir;
+		pd3dImmediateContext->Unmap( pGlobalsCB, 0 );
+
+		D3D11_VIEWPORT vp;
+		vp.Width = (FLOAT)iW;
+		vp.Height = (FLOAT)iH;
+		vp.MinDepth = 0;
+		vp.MaxDepth = 1;
+		vp.TopLeftX = (FLOAT)iX0;
+		vp.TopLeftY = (FLOAT)iY0;
+		pd3dImmediateContext->RSSetViewports( 1, &vp );
+
+		// the whole viewport or the dirty rects of it
+		const int iNrPasses = update.bFull ? 1 : ((int) update.rects.size());
+		for(int r=0; r<iNrPasses; r++)
+		{
+			SShadowCacheRect rect;
+			if(update.bFull) { rect.iX = 0; rect.iY = 0; rect.iWidth = iW; rect.iHeight = iH; }
+			else rect = update.rects[r];
+
+			D3D11_RECT scissor;
+			scissor.left = iX0 + rect.iX; scissor.right = scissor.left + rect.iWidth;
+			scissor.top = iY0 + rect.iY; scissor.bottom = scissor.top + rect.iHeight;
+			pd3dImmediateContext->RSSetScissorRects( 1, &scissor );
+
+			// clear to the far plane with a full screen triangle
+			pd3dImmediateContext->OMSetDepthStencilState( m_pDepthStencilStateAlways, 0 );
+			m_ClearPipeline.PrepPipelineForRendering(pd3dImmediateContext);
+			pd3dImmediateContext->IASetVertexBuffers( 0, 0, NULL, NULL, NULL );
+			pd3dImmediateContext->IASetIndexBuffer( NULL, DXGI_FORMAT_UNKNOWN, 0 );
+			pd3dImmediateContext->IASetInputLayout( NULL );
+			pd3dImmediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+			pd3dImmediateContext->Draw( 3, 1);
+			m_ClearPipeline.FlushResources(pd3dImmediateContext);
+			pd3dImmediateContext->OMSetDepthStencilState( GetDefaultDepthStencilState(), 0 );
+
+			// a rect only needs the casters above it
+			const unsigned char * puMask = &cascadeMask[0];
+			unsigned char uBit = (unsigned char) (1<<c);
+			if(!update.bFull)
+			{
+				SShadowCascade rectCascade;
+				GetShadowCacheRectCascade(&rectCascade, cascade, rect);
+				CullShadowCasters(&rectMask[0], &rectCascade, 1, sunDir, pfCenC, pfExtC, nrShadowCasters);
+				puMask = &rectMask[0]; uBit = 1;
+			}
 
-	pd3dImmediateContext->OMSetDepthStencilState( GetDefaultDepthStencilState_NoDepthWrite(), 0 );
+			int iNrBatches = 0;
+			const int iNrDrawn = RenderShadowCastingMeshInstances(pd3dImmediateContext, puMask, uBit, GetRow(viewProj, 2), &iNrBatches);
+			m_cullStats.iNrDraws += iNrBatches;
+			m_cullStats.iNrDrawsCulled += nrShadowCasters-iNrDrawn;
+		}
+	}
 
+	pd3dImmediateContext->RSSetState( GetDefaultRasterSolidCullBack() );
 
-	
-	Mat44 mToScr;
-	SetRow(&mToScr, 0, Vec4(0.5, 0,     0,  0.5));
-	SetRow(&mToScr, 1, Vec4(0,     -0.5, 0,  0.5));
-	SetRow(&mToScr, 2, Vec4(0,     0,     1,  0));
-	SetRow(&mToScr, 3, Vec4(0,     0,     0,  1));
+	pd3dImmediateContext->OMSetDepthStencilState( GetDefaultDepthStencilState_NoDepthWrite(), 0 );
 
-	Mat44 mWorldToSmap = mToScr * viewProj;
 
 	V( pd3dImmediateContext->Map( m_pSMapCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource ) );
-	((cbShadowMap *)MappedSubResource.pData)->g_mWorldToShadowMap = Transpose(mWorldToSmap);
+	for(int c=0; c<m_iNrCascades; c++)
+	{
+		((cbShadowMap *)MappedSubResource.pData)->g_mWorldToShadowMap[c] = Transpose(mWorldToSmap[c]);
+		((cbShadowMap *)MappedSubResource.pData)->g_vCascadeRect[c] = vRect[c];
+		((cbShadowMap *)MappedSubResource.pData)->g_vCascadeBias[c] = vBias[c];
+	}
+	((cbShadowMap *)MappedSubResource.pData)->g_iNrCascades = m_iNrCascades;
     pd3dImmediateContext->Unmap( m_pSMapCB, 0 );
-
-
 }
 
 void CShadowMap::ResolveToScreen(ID3D11DeviceContext* pd3dImmediateContext, ID3D11DepthStencilView * pDSV_readonly, ID3D11Buffer * pGlobalsCB)
@@ -213,6 +227,8 @@ void CShadowMap::OnResize(ID3D11Device* pd3dDevice, ID3D11ShaderResourceView * t
 
 void CShadowMap::InitShadowMap(ID3D11Device* pd3dDevice, ID3D11Buffer * pGlobalsCB, int width, int height, bool isHalfPrecision_in)
 {
+	m_iWidth = width; m_iHeight = height;
+
 	bool isHalfPrecision = false;
 	const bool bEnableReadBySampling = true;
 	const bool bEnableWriteTo = true;
@@ -272,6 +288,25 @@ void CShadowMap::InitShadowMap(ID3D11Device* pd3dDevice, ID3D11Buffer * pGlobals
 	DSDesc.DepthWriteMask =     D3D11_DEPTH_WRITE_MASK_ZERO;
 	hr = pd3dDevice->CreateDepthStencilState( &DSDesc, &m_pDepthStencilStateNotEqual_NoDepthWrite );
 
+	// clears parts of the shadow map
+	DSDesc.DepthFunc =          D3D11_COMPARISON_ALWAYS;
+	DSDesc.DepthWriteMask =     D3D11_DEPTH_WRITE_MASK_ALL;
+	hr = pd3dDevice->CreateDepthStencilState( &DSDesc, &m_pDepthStencilStateAlways );
+
+	m_ClearPipeline.SetVertexShader(&m_vert_shader);
+
+	// as the default solid cull back with the scissor test
+	D3D11_RASTERIZER_DESC RasterDesc;
+	ZeroMemory( &RasterDesc, sizeof( D3D11_RASTERIZER_DESC ) );
+	RasterDesc.FillMode = D3D11_FILL_SOLID;
+	RasterDesc.CullMode = D3D11_CULL_BACK;
+	RasterDesc.DepthClipEnable = TRUE;
+	RasterDesc.ScissorEnable = TRUE;
+	hr = pd3dDevice->CreateRasterizerState( &RasterDesc, &m_pRasterStateSolidCullBack_Scissor );
+
+	// the atlas holds nothing yet
+	ResetShadowCache(&m_cache);
+
 }
 
 ID3D11ShaderResourceView * CShadowMap::GetShadowResolveSRV()
@@ -279,6 +314,22 @@ ID3D11ShaderResourceView * CShadowMap::GetShadowResolveSRV()
 	return m_ScreenResolveRT.GetSRV();
 }
 
+const SShadowCascade * CShadowMap::GetCascades(int * piNrCascades) const
+{
+	*piNrCascades = m_iNrCascades;
+	return m_cascades;
+}
+
+const SShadowCullStats & CShadowMap::GetCullStats() const
+{
+	return m_cullStats;
+}
+
+const SShadowCacheStats & CShadowMap::GetCacheStats() const
+{
+	return m_cache.stats;
+}
+
 void CShadowMap::CleanUp()
 {
 	m_tex_shadowmap.CleanUp();
@@ -291,11 +342,21 @@ void CShadowMap::CleanUp()
 	SAFE_RELEASE( m_pSMapCB );
 					 
 	SAFE_RELEASE( m_pDepthStencilStateNotEqual_NoDepthWrite );
+	SAFE_RELEASE( m_pDepthStencilStateAlways );
+	SAFE_RELEASE( m_pRasterStateSolidCullBack_Scissor );
 }
 	
 CShadowMap::CShadowMap()
 {
-	
+	m_iWidth = 0; m_iHeight = 0;
+	m_iNrCascades = MAX_SHADOW_CASCADES;
+	m_fSplitLambda = 0.75f;
+	m_fMaxShadowDist = 150.0f;
+	memset(m_cascades, 0, sizeof(m_cascades));
+	memset(&m_cullStats, 0, sizeof(m_cullStats));
+	ResetShadowCache(&m_cache);
+	m_pDepthStencilStateAlways = NULL;
+	m_pRasterStateSolidCullBack_Scissor = NULL;
 }
 
 CShadowMap::~CShadowMap()
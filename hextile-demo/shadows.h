@@ -4,17 +4,31 @@
 #include "texture_rt.h"
 #include "shader.h"
 #include "shaderpipeline.h"
-
-struct Vec3;
+#include <geommath/geommath_fwd.h>
+#include "cputools/shadow_cascades.h"
+#include "cputools/shadow_culling.h"
+#include "cputools/shadow_cache.h"
 
 class CShadowMap
 {
 public:
 	void InitShadowMap(ID3D11Device* pd3dDevice, ID3D11Buffer * pGlobalsCB, int width, int height, bool isHalfPrecision=false);
-	void RenderShadowMap(ID3D11DeviceContext* pd3dImmediateContext, ID3D11Buffer * pGlobalsCB, const Vec3 &sunDir);
+	// the camera is given by its view to world and projection parameters.
+	// vOrigin is the absolute position of the world space origin, non zero when camera relative.
+	void RenderShadowMap(ID3D11DeviceContext* pd3dImmediateContext, ID3D11Buffer * pGlobalsCB, const Vec3 &sunDir,
+						 const Mat44 &mViewToWorld, const float fFovY, const float fAspect, const float fNear, const float fFar, const Vec3d &vOrigin);
 	void ResolveToScreen(ID3D11DeviceContext* pd3dImmediateContext, ID3D11DepthStencilView * pDSV_readonly, ID3D11Buffer * pGlobalsCB);
 	void OnResize(ID3D11Device* pd3dDevice, ID3D11ShaderResourceView * texDepthSRV);
 	ID3D11ShaderResourceView * GetShadowResolveSRV();
+
+	// cascades fitted by the last RenderShadowMap()
+	const SShadowCascade * GetCascades(int * piNrCascades) const;
+
+	// casters culled by the last RenderShadowMap()
+	const SShadowCullStats & GetCullStats() const;
+
+	// how much of the shadow map the last RenderShadowMap() rendered again
+	const SShadowCacheStats & GetCacheStats() const;
 	void CleanUp();
 	
 	CShadowMap();
@@ -29,10 +43,21 @@ private:
 	CShader m_vert_shader;
 	CShader m_pix_shader;
 	CShaderPipeline m_ShaderPipeline;
+	CShaderPipeline m_ClearPipeline;
 
 	ID3D11Buffer * m_pSMapCB;
 
 	ID3D11DepthStencilState * m_pDepthStencilStateNotEqual_NoDepthWrite;
+	ID3D11DepthStencilState * m_pDepthStencilStateAlways;
+	ID3D11RasterizerState * m_pRasterStateSolidCullBack_Scissor;
+
+	// the atlas holds 2x2 tiles, one per cascade
+	int m_iWidth, m_iHeight;
+	int m_iNrCascades;
+	float m_fSplitLambda, m_fMaxShadowDist;
+	SShadowCascade m_cascades[MAX_SHADOW_CASCADES];
+	SShadowCullStats m_cullStats;
+	SShadowCache m_cache;
 
 };
 
@@ -3,11 +3,19 @@
 
 #include "shader_base.h"
 
+#ifndef MAX_SHADOW_CASCADES
+#define MAX_SHADOW_CASCADES		4		// as in cputools/shadow_cascades.h
+#endif
+
 
 unistruct cbShadowMap
 {
-	Mat44 g_mWorldToShadowMap;
+	Mat44 g_mWorldToShadowMap[MAX_SHADOW_CASCADES];		// to the uv of the cascade's window in the atlas
+	Vec4 g_vCascadeRect[MAX_SHADOW_CASCADES];			// valid uv of the window, min in xy and max in zw. Empty when min>max
+	Vec4 g_vCascadeBias[MAX_SHADOW_CASCADES];			// x holds the depth bias
+	int g_iNrCascades;
+	int g_iPad0, g_iPad1, g_iPad2;
 };
 
 
-#endif
\ No newline at end of file
+#endif
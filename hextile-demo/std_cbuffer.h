@@ -10,6 +10,24 @@ unistruct cbMeshInstance
 	Mat44 g_mWorldToLocal;
 };
 
+// instanced draws read their transforms from g_instanceTransforms at
+// g_iFirstInstance plus SV_InstanceID, see cputools/instance_batch.h
+unistruct cbInstanceBatch
+{
+	int g_iFirstInstance;
+	int g_iInstancePad0, g_iInstancePad1, g_iInstancePad2;
+};
+
+struct SInstanceTransform
+{
+	Mat44 mLocToWorld;
+	Mat44 mWorldToLocal;
+};
+
+#ifndef __cplusplus
+StructuredBuffer<SInstanceTransform> g_instanceTransforms;
+#endif
+
 unistruct cbGlobals
 {
 	Vec3	g_vCamPos;
@@ -39,6 +57,29 @@ unistruct cbGlobals
 	float	g_FakeContrastNormal;
 	float	g_rotStrength;
 
+	int		g_bUseHexCellLUT;
+	int		g_iHexCellLUTSize;
+	int		g_bHexLodFallback;
+	float	g_fHexLodFallbackStart;
+
+	float	g_fHexLodFallbackRange;
+	int		g_bHexStochastic;
+	int		g_iFrameIndex;
+	int		g_bTriplanarSkip;
+
+	float	g_fTriplanarSkipThreshold;
+	int		g_bBiplanar;
+	int		g_bUseDerivMaps;
+	int		g_bCameraRelative;
+
+	// per plane of GetPlanarST() when camera relative, see hextiling_rws.h
+	Vec4	g_vHexRWSOffs[3];			// st_offs in xy and cen_offs in zw
+	Vec4i	g_iHexRWSCellOffs[3];		// cell_offs in xy
+
+	int		g_iNoiseBumpMode;			// 0 off, 1 procedural, 2 assisted by g_noiseVolume
+	float	g_fNoiseVolPeriod;
+	float	g_fNoiseVolTexelSize;
+	float	g_fNoiseBumpFreq;
 };
 
 #endif
\ No newline at end of file
@@ -134,6 +134,25 @@ float3 SurfgradFromTriplanarProjection(float3 triplanarWeights, float2 deriv_xpl
 	return SurfgradFromVolumeGradient(grad);
 }
 
+// Volume gradient of a single planar projection with the same lookup
+// coordinates as SurfgradFromTriplanarProjection(). axis is 0, 1 or 2
+// for the planes sampled using (z,y), (x,z), and (x,y), respectively.
+float3 VolumeGradFromPlanarDeriv(int axis, float2 deriv)
+{
+	return axis==0 ? float3(0.0, deriv.y, deriv.x) :
+		  (axis==1 ? float3(deriv.x, 0.0, deriv.y) : float3(deriv.x, deriv.y, 0.0));
+}
+
+// Biplanar projection is triplanar projection where one plane has
+// zero weight. Weights and axes are obtained using DetermineBiplanarWeights().
+float3 SurfgradFromBiplanarProjection(float2 biplanarWeights, int2 axes, float2 deriv_plane0, float2 deriv_plane1)
+{
+	float3 grad = biplanarWeights.x*VolumeGradFromPlanarDeriv(axes.x, deriv_plane0) +
+				  biplanarWeights.y*VolumeGradFromPlanarDeriv(axes.y, deriv_plane1);
+
+	return SurfgradFromVolumeGradient(grad);
+}
+
 // Adapted from
 // http://www.slideshare.net/icastano/cascades-demo-secrets.
 float3 DetermineTriplanarWeights(float k = 3.0)
@@ -145,6 +164,25 @@ float3 DetermineTriplanarWeights(float k = 3.0)
 	return weights;
 }
 
+// Drops the axis with the smallest component of the normal and weights the
+// other two by how much they exceed it. A plane's weight is zero at the point
+// it gets dropped so the weights are continuous, except at the diagonals where
+// all three components are equal and no choice can be. The two axes are returned in
+// increasing order rather than by significance such that each plane only
+// changes where its weight is near zero, which keeps derivatives of lookup
+// coordinates well-behaved across the 2x2 quad.
+float2 DetermineBiplanarWeights(out int2 axes, float k = 3.0)
+{
+	float3 a = abs(nrmBaseNormal);
+	int drop = a.x<=a.y ? (a.x<=a.z ? 0 : 2) : (a.y<=a.z ? 1 : 2);
+	axes = drop==0 ? int2(1,2) : (drop==1 ? int2(0,2) : int2(0,1));
+
+	float2 weights = float2(a[axes.x], a[axes.y]) - a[drop];
+	weights = pow(max(0, weights), k) + 1e-20;		// epsilon for the corner where all three are equal
+	weights /= (weights.x + weights.y);
+	return weights;
+}
+
 
 // Returns dHduv where (u,v) is in pixel units at the top MIP level.
 float2 DerivFromHeightMap(Texture2D hmap, SamplerState samp, float2 texST, bool isUpscaleHQ = false)
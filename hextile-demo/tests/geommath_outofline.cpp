@@ -0,0 +1,10 @@
+#include "geommath_outofline.h"
+#include <geommath/geommath.h>
+
+// compiled on its own so the calls are not inlined, as the operators were
+// when geommath had its vec3.cpp, vec4.cpp and mat44.cpp
+
+const Vec4 OutOfLineMul(const Mat44 &m, const Vec4 &v) { return m*v; }
+const Vec3 OutOfLineSub(const Vec3 &v1, const Vec3 &v2) { return v1-v2; }
+const Vec3 OutOfLineCross(const Vec3 &v1, const Vec3 &v2) { return Cross(v1, v2); }
+const Vec3 OutOfLineNormalize(const Vec3 &v) { return Normalize(v); }
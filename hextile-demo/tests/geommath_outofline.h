@@ -0,0 +1,11 @@
+#ifndef __GEOMMATH_OUTOFLINE_H__
+#define __GEOMMATH_OUTOFLINE_H__
+
+#include <geommath/geommath_fwd.h>
+
+const Vec4 OutOfLineMul(const Mat44 &m, const Vec4 &v);
+const Vec3 OutOfLineSub(const Vec3 &v1, const Vec3 &v2);
+const Vec3 OutOfLineCross(const Vec3 &v1, const Vec3 &v2);
+const Vec3 OutOfLineNormalize(const Vec3 &v);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef __SHADOWTESTPARAMS_H__
+#define __SHADOWTESTPARAMS_H__
+
+#include <cputools/shadow_cascades.h>
+
+// the cascade setup of CShadowMap with a camera standing 2 units above the
+// ground looking along -Z, shared by the shadow tests. A non zero origin
+// makes world space camera relative.
+static inline void InitShadowTestParams(SShadowCascadeParams * pParams, const Vec3d &vOrigin)
+{
+	LoadIdentity(&pParams->mViewToWorld);
+	SetColumn(&pParams->mViewToWorld, 3, Vec4(0.0f, 2.0f, 0.0f, 1.0f));
+	pParams->fFovY = 60.0f*(3.1415926f/180);
+	pParams->fAspect = 16.0f/9.0f;
+	pParams->fNear = 0.5f;
+	pParams->fFar = 5000.0f;
+	pParams->fMaxShadowDist = 150.0f;
+	pParams->iNrCascades = MAX_SHADOW_CASCADES;
+	pParams->fSplitLambda = 0.75f;
+	pParams->iResolution = 2048;
+	pParams->vSunDir = Normalize(Vec3(0.3f, 0.8f, 0.4f));
+	pParams->vOrigin = vOrigin;
+}
+
+#endif
@@ -0,0 +1,319 @@
+#include "test_common.h"
+#include "cputools/command_list.h"
+#include "cputools/parallel_for.h"
+#include <string.h>
+#include <algorithm>
+
+// A headless frame, draws of a set of materials and meshes as scenegraph.cpp
+// submits them: the targets are cleared, then per draw the constants are
+// updated, the state is bound through a cache and the mesh drawn. The draws
+// are recorded on one thread into one list and spread over several lists
+// recorded in parallel. Replaying either through the null backend must issue
+// every draw once, in order and with the state it asks for, without
+// validation errors. Broken draws and a truncated list must be caught.
+
+#define NR_DRAWS				20000
+#define NR_MATERIALS			64
+#define NR_MESHES				256
+#define NR_LISTS				8
+
+#define CHECK_TOPOLOGY			4
+#define CHECK_INDEX_FORMAT		42
+#define CHECK_VERTEX_STRIDE		32
+
+// stand-ins for the device objects, never dereferenced
+static inline const void * FakeObject(const int iId)
+{
+	return (const void *) (size_t) (0x1000 + 16*iId);
+}
+
+struct SCheckFrameMaterial
+{
+	const void * pShaders[DRAW_STATE_NUM_STAGES];
+	const void * pSlots[DRAW_STATE_NUM_STAGES][NUM_DRAW_STATE_SLOT_KINDS][8];
+	int iNrSlots[DRAW_STATE_NUM_STAGES][NUM_DRAW_STATE_SLOT_KINDS];
+};
+
+struct SCheckFrame
+{
+	std::vector<SCheckFrameMaterial> materials;
+	std::vector<const void *> meshBuffers;		// vertex and index buffer per mesh
+	std::vector<int> drawMaterial, drawMesh;	// in draw order
+	const void * pLayout, * pBatchCB, * pRenderTarget, * pDepthStencil;
+};
+
+// draws iFirst to iLast-1 of the frame as RenderInstances() in scenegraph.cpp
+static void RecordCheckDraws(SCommandList * pList, SDrawStateCache * pCache, const SCheckFrame &frame, const int iFirst, const int iLast)
+{
+	ResetDrawStateCache(pCache);
+	for(int d=iFirst; d<iLast; d++)
+	{
+		const int iFirstInstance = d;
+		RecordUpdateConstBuffer(pList, frame.pBatchCB, &iFirstInstance, sizeof(iFirstInstance));
+
+		const SCheckFrameMaterial &mat = frame.materials[frame.drawMaterial[d]];
+		for(int st=0; st<DRAW_STATE_NUM_STAGES; st++)
+		{
+			for(int k=0; k<NUM_DRAW_STATE_SLOT_KINDS; k++)
+			{
+				int iFirstSlot = 0;
+				const int iNr = UpdateDrawStateSlots(&iFirstSlot, pCache, st, (DRAW_STATE_SLOT_KIND) k, mat.pSlots[st][k], mat.iNrSlots[st][k]);
+				if(iNr>0) RecordSetSlots(pList, st, (DRAW_STATE_SLOT_KIND) k, iFirstSlot, iNr, mat.pSlots[st][k]+iFirstSlot);
+			}
+			if(UpdateDrawStateShader(pCache, st, mat.pShaders[st])) RecordSetShader(pList, st, mat.pShaders[st]);
+		}
+
+		const int iMesh = frame.drawMesh[d];
+		if(UpdateDrawStateInput(pCache, DRAW_STATE_VERTEX_BUFFER, frame.meshBuffers[2*iMesh+0]))
+			RecordSetVertexBuffer(pList, frame.meshBuffers[2*iMesh+0], CHECK_VERTEX_STRIDE, 0);
+		if(UpdateDrawStateInput(pCache, DRAW_STATE_INDEX_BUFFER, frame.meshBuffers[2*iMesh+1]))
+			RecordSetIndexBuffer(pList, frame.meshBuffers[2*iMesh+1], CHECK_INDEX_FORMAT);
+		if(UpdateDrawStateInput(pCache, DRAW_STATE_INPUT_LAYOUT, frame.pLayout))
+			RecordSetInputLayout(pList, frame.pLayout);
+		if(UpdateDrawStateInput(pCache, DRAW_STATE_TOPOLOGY, (const void *) (size_t) CHECK_TOPOLOGY))
+			RecordSetTopology(pList, CHECK_TOPOLOGY);
+		RecordDrawIndexedInstanced(pList, 3*(1+iMesh), 1+(d&7), 0, 0, iFirstInstance);
+	}
+	RecordFlushDrawStateCache(pList, pCache);
+}
+
+static void RecordCheckClears(SCommandList * pList, const SCheckFrame &frame)
+{
+	const float fColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
+	RecordClearRenderTarget(pList, frame.pRenderTarget, fColor);
+	RecordClearDepthStencil(pList, frame.pDepthStencil, 3, 1.0f, 0);
+}
+
+// compares the bound state and the draw arguments to those each draw asks
+// for, the draw is found by its first instance
+class CCheckFrameBackend : public CNullCommandBackend
+{
+public:
+	void DrawIndexedInstanced(const int iNrIndices, const int iNrInstances, const int iFirstIndex, const int iBaseVertex, const int iFirstInstance)
+	{
+		CNullCommandBackend::DrawIndexedInstanced(iNrIndices, iNrInstances, iFirstIndex, iBaseVertex, iFirstInstance);
+
+		const int d = iFirstInstance;
+		if(d!=m_iNextDraw++ || d<0 || d>=((int) m_pFrame->drawMaterial.size())) { ++m_iNrMismatches; return; }
+
+		const SDrawStateCache * pState = GetBoundState();
+		const SCheckFrameMaterial &mat = m_pFrame->materials[m_pFrame->drawMaterial[d]];
+		for(int st=0; st<DRAW_STATE_NUM_STAGES; st++)
+		{
+			if(pState->pShaders[st]!=mat.pShaders[st]) ++m_iNrMismatches;
+			for(int k=0; k<NUM_DRAW_STATE_SLOT_KINDS; k++)
+				for(int s=0; s<mat.iNrSlots[st][k]; s++)
+					if(pState->pSlots[st][k][s]!=mat.pSlots[st][k][s]) ++m_iNrMismatches;
+		}
+		const int iMesh = m_pFrame->drawMesh[d];
+		if(pState->pInputs[DRAW_STATE_VERTEX_BUFFER]!=m_pFrame->meshBuffers[2*iMesh+0] ||
+		   pState->pInputs[DRAW_STATE_INDEX_BUFFER]!=m_pFrame->meshBuffers[2*iMesh+1] ||
+		   pState->pInputs[DRAW_STATE_INPUT_LAYOUT]!=m_pFrame->pLayout ||
+		   pState->pInputs[DRAW_STATE_TOPOLOGY]!=((const void *) (size_t) CHECK_TOPOLOGY)) ++m_iNrMismatches;
+		if(GetVertexStride()!=CHECK_VERTEX_STRIDE || GetVertexOffset()!=0 || GetIndexFormat()!=CHECK_INDEX_FORMAT) ++m_iNrMismatches;
+		if(iNrIndices!=(3*(1+iMesh)) || iNrInstances!=(1+(d&7)) || iFirstIndex!=0 || iBaseVertex!=0) ++m_iNrMismatches;
+	}
+
+	void ClearRenderTarget(const void * pView, const float fColor[4])
+	{
+		CNullCommandBackend::ClearRenderTarget(pView, fColor);
+		if(pView!=m_pFrame->pRenderTarget || fColor[0]!=0.0f || fColor[1]!=0.0f || fColor[2]!=0.0f || fColor[3]!=1.0f) ++m_iNrMismatches;
+	}
+
+	void ClearDepthStencil(const void * pView, const unsigned int uFlags, const float fDepth, const unsigned int uStencil)
+	{
+		CNullCommandBackend::ClearDepthStencil(pView, uFlags, fDepth, uStencil);
+		if(pView!=m_pFrame->pDepthStencil || uFlags!=3 || fDepth!=1.0f || uStencil!=0) ++m_iNrMismatches;
+	}
+
+	int GetNrMismatches() const { return m_iNrMismatches + (m_iNextDraw!=((int) m_pFrame->drawMaterial.size()) ? 1 : 0); }
+
+	CCheckFrameBackend(const SCheckFrame * pFrame) : m_pFrame(pFrame), m_iNextDraw(0), m_iNrMismatches(0) {}
+
+private:
+	const SCheckFrame * m_pFrame;
+	int m_iNextDraw, m_iNrMismatches;
+};
+
+// slots left bound after the frame
+static int CountBoundSlots(const SDrawStateCache &state)
+{
+	int iNrBound = 0;
+	for(int st=0; st<DRAW_STATE_NUM_STAGES; st++)
+		for(int k=0; k<NUM_DRAW_STATE_SLOT_KINDS; k++)
+			for(int s=0; s<DRAW_STATE_MAX_SLOTS; s++)
+				if(state.pSlots[st][k][s]!=NULL) ++iNrBound;
+	return iNrBound;
+}
+
+// materials as in scenegraph.cpp, a shared vertex shader, a pixel shader
+// per 4 materials and their own textures. The draws in state order as after
+// SortDrawItems().
+static void BuildCheckFrame(SCheckFrame * pFrame)
+{
+	SCheckFrame &frame = *pFrame;
+	int iNextId = 0;
+	const void * pVertShader = FakeObject(iNextId++);
+	const void * pShared[6];
+	for(int i=0; i<6; i++) pShared[i] = FakeObject(iNextId++);
+	frame.materials.resize(NR_MATERIALS);
+	for(int m=0; m<NR_MATERIALS; m++)
+	{
+		SCheckFrameMaterial &mat = frame.materials[m];
+		memset(&mat, 0, sizeof(mat));
+		mat.pShaders[0] = pVertShader;
+		mat.pShaders[4] = (m&3)==0 ? FakeObject(iNextId++) : frame.materials[m&~3].pShaders[4];
+
+		mat.iNrSlots[0][DRAW_STATE_CBUFFERS] = 2; mat.pSlots[0][DRAW_STATE_CBUFFERS][0] = pShared[0]; mat.pSlots[0][DRAW_STATE_CBUFFERS][1] = pShared[1];
+		mat.iNrSlots[0][DRAW_STATE_SRVS] = 1; mat.pSlots[0][DRAW_STATE_SRVS][0] = pShared[2];
+		mat.iNrSlots[4][DRAW_STATE_CBUFFERS] = 3; mat.pSlots[4][DRAW_STATE_CBUFFERS][0] = pShared[0];
+		mat.pSlots[4][DRAW_STATE_CBUFFERS][1] = pShared[1]; mat.pSlots[4][DRAW_STATE_CBUFFERS][2] = FakeObject(iNextId++);
+		mat.iNrSlots[4][DRAW_STATE_SAMPLERS] = 2; mat.pSlots[4][DRAW_STATE_SAMPLERS][0] = pShared[3]; mat.pSlots[4][DRAW_STATE_SAMPLERS][1] = pShared[4];
+		mat.iNrSlots[4][DRAW_STATE_SRVS] = 6; mat.pSlots[4][DRAW_STATE_SRVS][0] = pShared[2]; mat.pSlots[4][DRAW_STATE_SRVS][1] = pShared[5];
+		for(int i=2; i<6; i++) mat.pSlots[4][DRAW_STATE_SRVS][i] = FakeObject(iNextId++);
+	}
+	frame.meshBuffers.resize(2*NR_MESHES);
+	for(int i=0; i<(2*NR_MESHES); i++) frame.meshBuffers[i] = FakeObject(iNextId++);
+	frame.pLayout = FakeObject(iNextId++); frame.pBatchCB = FakeObject(iNextId++);
+	frame.pRenderTarget = FakeObject(iNextId++); frame.pDepthStencil = FakeObject(iNextId++);
+
+	unsigned int uSeed = 4321;
+	std::vector<SDrawItem> items(NR_DRAWS), scratch;
+	for(int d=0; d<NR_DRAWS; d++)
+	{
+		const int iMaterial = std::min(NR_MATERIALS-1, (int) (Rand01(&uSeed)*NR_MATERIALS));
+		const int iMesh = std::min(NR_MESHES-1, (int) (Rand01(&uSeed)*NR_MESHES));
+		items[d].uKey = MakeDrawKey(iMaterial>>2, iMaterial, iMesh, 0.0f);
+		items[d].iIndex = d; items[d].iPad = 0;
+	}
+	SortDrawItems(items, scratch);
+	frame.drawMaterial.resize(NR_DRAWS); frame.drawMesh.resize(NR_DRAWS);
+	for(int d=0; d<NR_DRAWS; d++)
+	{
+		frame.drawMaterial[d] = (int) ((items[d].uKey>>(DRAW_KEY_MESH_BITS+DRAW_KEY_DEPTH_BITS))&((1ull<<DRAW_KEY_MATERIAL_BITS)-1));
+		frame.drawMesh[d] = (int) ((items[d].uKey>>DRAW_KEY_DEPTH_BITS)&((1ull<<DRAW_KEY_MESH_BITS)-1));
+	}
+}
+
+// the number of validation errors replaying one command list
+static int CountErrors(const SCommandList &list)
+{
+	CNullCommandBackend backend;
+	const SCommandList * pList = &list;
+	const bool bReplayed = ReplayCommandLists(&backend, &pList, 1);
+	return bReplayed ? backend.GetStats()->iNrErrors : -1;
+}
+
+static void TestInvalidCommands(const SCommandList &single)
+{
+	const void * pObj = FakeObject(1);
+	SCommandList list;
+
+	// a draw before any state
+	ResetCommandList(&list);
+	RecordDrawIndexedInstanced(&list, 3, 1, 0, 0, 0);
+	TEST_EXPECT(CountErrors(list)==1, "draw without state");
+
+	// an indexed draw with an index buffer of unknown format
+	ResetCommandList(&list);
+	RecordSetShader(&list, 0, pObj);
+	RecordSetInputLayout(&list, pObj);
+	RecordSetTopology(&list, CHECK_TOPOLOGY);
+	RecordSetVertexBuffer(&list, pObj, CHECK_VERTEX_STRIDE, 0);
+	RecordSetIndexBuffer(&list, pObj, 0);
+	RecordDrawIndexedInstanced(&list, 3, 1, 0, 0, 0);
+	RecordSetIndexBuffer(&list, pObj, CHECK_INDEX_FORMAT);
+	RecordDrawIndexedInstanced(&list, 3, 1, 0, -1, 0);
+	TEST_EXPECT(CountErrors(list)==1, "index buffer without a format");
+
+	// a vertex buffer without a stride, a stencil past 8 bits and a clear
+	// color that is not finite
+	const float fInf = 1e30f*1e30f;
+	const float fColor[] = {0.0f, fInf, 0.0f, 1.0f};
+	ResetCommandList(&list);
+	RecordSetVertexBuffer(&list, pObj, 0, 0);
+	RecordClearDepthStencil(&list, pObj, 3, 1.0f, 256);
+	RecordClearRenderTarget(&list, pObj, fColor);
+	TEST_EXPECT(CountErrors(list)==3, "stride, stencil and clear color");
+
+	// a list cut short
+	list = single;
+	list.words.resize(list.words.size()-1);
+	TEST_EXPECT(CountErrors(list)==-1, "truncated list replayed");
+}
+
+int main()
+{
+	SCheckFrame frame;
+	BuildCheckFrame(&frame);
+
+	const int iNrRuns = 8;
+
+	// one list on one thread
+	SCommandList single;
+	SDrawStateCache cache;
+	TestClock::time_point t0 = TestClock::now();
+	for(int r=0; r<iNrRuns; r++)
+	{
+		ResetCommandList(&single);
+		RecordCheckClears(&single, frame);
+		RecordCheckDraws(&single, &cache, frame, 0, NR_DRAWS);
+	}
+	const double fRecordMs = MsSince(t0)/iNrRuns;
+
+	// a range of the draws per list, each list on its own thread
+	const int iNrThreads = std::min(NR_LISTS, GetDefaultNrThreads());
+	std::vector<SCommandList> lists(NR_LISTS);
+	std::vector<SDrawStateCache> caches(NR_LISTS);
+	t0 = TestClock::now();
+	for(int r=0; r<iNrRuns; r++)
+	{
+		ParallelFor(NR_LISTS, iNrThreads, [&](const int l, const int)
+		{
+			ResetCommandList(&lists[l]);
+			if(l==0) RecordCheckClears(&lists[l], frame);
+			RecordCheckDraws(&lists[l], &caches[l], frame, (NR_DRAWS*l)/NR_LISTS, (NR_DRAWS*(l+1))/NR_LISTS);
+		});
+	}
+	const double fRecordParallelMs = MsSince(t0)/iNrRuns;
+
+	// replay both, every draw must see its state
+	const SCommandList * pSingle = &single;
+	CCheckFrameBackend singleBackend(&frame);
+	TEST_EXPECT(ReplayCommandLists(&singleBackend, &pSingle, 1), "single list malformed");
+	const SNullBackendStats * pSingleStats = singleBackend.GetStats();
+	TEST_EXPECT(singleBackend.GetNrMismatches()==0, "%d mismatches in the single list", singleBackend.GetNrMismatches());
+	TEST_EXPECT(pSingleStats->iNrErrors==0, "%d validation errors in the single list", pSingleStats->iNrErrors);
+	TEST_EXPECT(CountBoundSlots(*singleBackend.GetBoundState())==0, "slots left bound");
+	TEST_EXPECT(pSingleStats->iNrCommands[RCMD_CLEAR_RENDER_TARGET]==1 && pSingleStats->iNrCommands[RCMD_CLEAR_DEPTH_STENCIL]==1, "clears");
+	TEST_EXPECT(pSingleStats->iNrCommands[RCMD_UPDATE_CBUFFER]==NR_DRAWS, "%d constant updates", pSingleStats->iNrCommands[RCMD_UPDATE_CBUFFER]);
+	TEST_EXPECT(pSingleStats->iNrCommands[RCMD_DRAW_INDEXED_INSTANCED]==NR_DRAWS, "%d draws", pSingleStats->iNrCommands[RCMD_DRAW_INDEXED_INSTANCED]);
+
+	std::vector<const SCommandList *> pLists(NR_LISTS);
+	for(int l=0; l<NR_LISTS; l++) pLists[l] = &lists[l];
+	CCheckFrameBackend parallelBackend(&frame);
+	TEST_EXPECT(ReplayCommandLists(&parallelBackend, &pLists[0], NR_LISTS), "parallel lists malformed");
+	const SNullBackendStats * pParallelStats = parallelBackend.GetStats();
+	TEST_EXPECT(parallelBackend.GetNrMismatches()==0, "%d mismatches in the parallel lists", parallelBackend.GetNrMismatches());
+	TEST_EXPECT(pParallelStats->iNrErrors==0, "%d validation errors in the parallel lists", pParallelStats->iNrErrors);
+	TEST_EXPECT(CountBoundSlots(*parallelBackend.GetBoundState())==0, "slots left bound");
+	TEST_EXPECT(pParallelStats->iNrVertsDrawn==pSingleStats->iNrVertsDrawn && pParallelStats->iNrBytesUpdated==pSingleStats->iNrBytesUpdated,
+				"parallel lists draw or update differently");
+
+	// replay cost of the null backend alone
+	CNullCommandBackend nullBackend;
+	t0 = TestClock::now();
+	for(int r=0; r<iNrRuns; r++)
+	{
+		nullBackend.Reset();
+		ReplayCommandLists(&nullBackend, &pSingle, 1);
+	}
+	const double fReplayMs = MsSince(t0)/iNrRuns;
+
+	TestInvalidCommands(single);
+
+	printf("%d draws, %d commands, %.1f bytes per command\n", NR_DRAWS, single.iNrCommands, (float) (sizeof(unsigned int)*single.words.size()) / single.iNrCommands);
+	printf("record %.2f ms, %d lists on %d threads %.2f ms, null replay %.2f ms\n", fRecordMs, NR_LISTS, iNrThreads, fRecordParallelMs, fReplayMs);
+
+	return TestResult("command_list");
+}
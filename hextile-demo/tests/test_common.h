@@ -0,0 +1,43 @@
+#ifndef __TEST_COMMON_H__
+#define __TEST_COMMON_H__
+
+#include <stdio.h>
+#include <chrono>
+
+// shared by the test executables. A failed TEST_EXPECT() prints where and
+// why and makes TestResult() return 1, the tests carry on so one run shows
+// every failure. Timings are printed, never tested.
+
+static int g_iNrTestFailures = 0;
+
+#define TEST_EXPECT(cond, ...)																\
+	do {																					\
+		if(!(cond))																			\
+		{																					\
+			++g_iNrTestFailures;															\
+			printf("%s(%d): failed %s: ", __FILE__, __LINE__, #cond);						\
+			printf(__VA_ARGS__);															\
+			printf("\n");																	\
+		}																					\
+	} while(0)
+
+static inline int TestResult(const char * pszName)
+{
+	printf("%s: %s\n", pszName, g_iNrTestFailures==0 ? "passed" : "FAILED");
+	return g_iNrTestFailures==0 ? 0 : 1;
+}
+
+static inline float Rand01(unsigned int * puSeed)
+{
+	*puSeed = (*puSeed)*1664525u + 1013904223u;
+	return ((*puSeed)>>8) / 16777216.0f;
+}
+
+typedef std::chrono::high_resolution_clock TestClock;
+
+static inline double MsSince(const TestClock::time_point t0)
+{
+	return 1000.0*std::chrono::duration<double>(TestClock::now() - t0).count();
+}
+
+#endif
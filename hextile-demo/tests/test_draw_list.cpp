@@ -0,0 +1,178 @@
+#include "test_common.h"
+#include <cputools/draw_list.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+// Random draws of a few pipelines, materials each binding their own slots,
+// and meshes. The key must order by pipeline, material, mesh and depth in
+// that priority. The sorted list must be a stable permutation in key order
+// and submitting it through the cache must leave every draw with the state
+// it asks for. The calls of binding everything for each draw followed by an
+// unbind, as the unsorted list was drawn before, are compared to those of
+// the sorted list through the cache.
+
+#define NR_DRAWS				100000
+#define NR_PIPELINES			8
+#define NR_MATERIALS			64
+#define NR_MESHES				256
+#define MIN_CALL_REDUCTION		4.0f
+
+// stand-ins for the device objects, never dereferenced
+static inline const void * FakeObject(const int iId)
+{
+	return (const void *) (size_t) (0x1000 + 16*iId);
+}
+
+// the lists of a material as CShaderPipeline keeps them, the vertex and
+// the pixel stage in use
+struct STestMaterial
+{
+	const void * pShaders[DRAW_STATE_NUM_STAGES];
+	const void * pSlots[DRAW_STATE_NUM_STAGES][NUM_DRAW_STATE_SLOT_KINDS][16];
+	int iNrSlots[DRAW_STATE_NUM_STAGES][NUM_DRAW_STATE_SLOT_KINDS];
+};
+
+// the calls of PrepPipelineForRendering(), the input state, the draw and
+// FlushResources() in chunks of 8
+static int CountImmediateCalls(const STestMaterial &mat)
+{
+	int iNrCalls = DRAW_STATE_NUM_STAGES + NUM_DRAW_STATE_INPUTS + 1;
+	for(int s=0; s<DRAW_STATE_NUM_STAGES; s++)
+		if(mat.pShaders[s]!=NULL)
+			for(int k=0; k<NUM_DRAW_STATE_SLOT_KINDS; k++)
+				if(mat.iNrSlots[s][k]>0) iNrCalls += 1 + (mat.iNrSlots[s][k]+7)/8;
+	return iNrCalls;
+}
+
+static void TestDrawKeys()
+{
+	const int iMaxMaterial = (1<<DRAW_KEY_MATERIAL_BITS)-1, iMaxMesh = (1<<DRAW_KEY_MESH_BITS)-1;
+	TEST_EXPECT(MakeDrawKey(1, 0, 0, 0.0f)>MakeDrawKey(0, iMaxMaterial, iMaxMesh, 1e30f), "the pipeline doesn't dominate the key");
+	TEST_EXPECT(MakeDrawKey(0, 1, 0, 0.0f)>MakeDrawKey(0, 0, iMaxMesh, 1e30f), "the material doesn't dominate mesh and depth");
+	TEST_EXPECT(MakeDrawKey(0, 0, 1, 0.0f)>MakeDrawKey(0, 0, 0, 1e30f), "the mesh doesn't dominate the depth");
+	TEST_EXPECT(MakeDrawKey(0, 0, 0, 1.0f)<MakeDrawKey(0, 0, 0, 2.0f), "nearer draws don't sort first");
+	TEST_EXPECT(MakeDrawKey(0, 0, 0, -5.0f)==MakeDrawKey(0, 0, 0, 0.0f), "negative depth isn't clamped to 0");
+}
+
+int main()
+{
+	TestDrawKeys();
+
+	// one vertex shader, a pixel shader per pipeline. The constant buffers,
+	// samplers and the first resources are shared, the rest is per material.
+	int iNextId = 0;
+	const void * pVertShader = FakeObject(iNextId++);
+	const void * pPixShaders[NR_PIPELINES];
+	for(int p=0; p<NR_PIPELINES; p++) pPixShaders[p] = FakeObject(iNextId++);
+	const void * pShared[8];
+	for(int i=0; i<8; i++) pShared[i] = FakeObject(iNextId++);
+
+	std::vector<STestMaterial> materials(NR_MATERIALS);
+	for(int m=0; m<NR_MATERIALS; m++)
+	{
+		STestMaterial &mat = materials[m];
+		memset(&mat, 0, sizeof(STestMaterial));
+		mat.pShaders[0] = pVertShader; mat.pShaders[4] = pPixShaders[m%NR_PIPELINES];
+
+		mat.iNrSlots[0][DRAW_STATE_CBUFFERS] = 2; mat.pSlots[0][DRAW_STATE_CBUFFERS][0] = pShared[0]; mat.pSlots[0][DRAW_STATE_CBUFFERS][1] = pShared[1];
+		mat.iNrSlots[0][DRAW_STATE_SRVS] = 1; mat.pSlots[0][DRAW_STATE_SRVS][0] = pShared[2];
+
+		mat.iNrSlots[4][DRAW_STATE_CBUFFERS] = 3; mat.pSlots[4][DRAW_STATE_CBUFFERS][0] = pShared[0];
+		mat.pSlots[4][DRAW_STATE_CBUFFERS][1] = pShared[1]; mat.pSlots[4][DRAW_STATE_CBUFFERS][2] = FakeObject(iNextId++);
+		mat.iNrSlots[4][DRAW_STATE_SAMPLERS] = 4;
+		for(int i=0; i<4; i++) mat.pSlots[4][DRAW_STATE_SAMPLERS][i] = pShared[4+i];
+		mat.iNrSlots[4][DRAW_STATE_SRVS] = 10;
+		mat.pSlots[4][DRAW_STATE_SRVS][0] = pShared[2]; mat.pSlots[4][DRAW_STATE_SRVS][1] = pShared[3];
+		for(int i=2; i<10; i++) mat.pSlots[4][DRAW_STATE_SRVS][i] = (i&1)!=0 ? NULL : FakeObject(iNextId++);
+	}
+	std::vector<const void *> meshBuffers(2*NR_MESHES);
+	for(int i=0; i<(2*NR_MESHES); i++) meshBuffers[i] = FakeObject(iNextId++);
+	const void * pLayout = FakeObject(iNextId++), * pTopology = FakeObject(iNextId++);
+
+	// few distinct depths so equal keys occur and stability is tested
+	unsigned int uSeed = 1234;
+	std::vector<int> drawMaterial(NR_DRAWS), drawMesh(NR_DRAWS);
+	std::vector<SDrawItem> items(NR_DRAWS), scratch;
+	for(int d=0; d<NR_DRAWS; d++)
+	{
+		drawMaterial[d] = std::min(NR_MATERIALS-1, (int) (Rand01(&uSeed)*NR_MATERIALS));
+		drawMesh[d] = std::min(NR_MESHES-1, (int) (Rand01(&uSeed)*NR_MESHES));
+		items[d].uKey = MakeDrawKey(drawMaterial[d]%NR_PIPELINES, drawMaterial[d], drawMesh[d], (float) (int) (8*Rand01(&uSeed)));
+		items[d].iIndex = d; items[d].iPad = 0;
+	}
+
+	int iNrCallsBefore = 0;
+	for(int d=0; d<NR_DRAWS; d++) iNrCallsBefore += CountImmediateCalls(materials[drawMaterial[d]]);
+
+	const std::vector<SDrawItem> unsorted = items;
+	const int iNrRuns = 8;
+	const TestClock::time_point t0 = TestClock::now();
+	for(int r=0; r<iNrRuns; r++)
+	{
+		items = unsorted;
+		SortDrawItems(items, scratch);
+	}
+	const double fSortMs = MsSince(t0)/iNrRuns;
+
+	// a permutation in key order, stable
+	int iNrNotPermutation = 0, iNrUnordered = 0, iNrUnstable = 0;
+	std::vector<int> seen(NR_DRAWS, 0);
+	for(int i=0; i<NR_DRAWS; i++)
+	{
+		if(items[i].iIndex<0 || items[i].iIndex>=NR_DRAWS || seen[items[i].iIndex]++>0) ++iNrNotPermutation;
+		if(i>0 && items[i].uKey<items[i-1].uKey) ++iNrUnordered;
+		if(i>0 && items[i].uKey==items[i-1].uKey && items[i].iIndex<items[i-1].iIndex) ++iNrUnstable;
+	}
+	TEST_EXPECT(iNrNotPermutation==0, "%d sorted items aren't a permutation of the draws", iNrNotPermutation);
+	TEST_EXPECT(iNrUnordered==0, "%d items out of key order", iNrUnordered);
+	TEST_EXPECT(iNrUnstable==0, "%d items with equal keys swapped", iNrUnstable);
+	if(iNrNotPermutation>0) return TestResult("draw_list");
+
+	// submit through the cache, every draw must see its own state
+	int iNrWrongState = 0;
+	SDrawStateCache cache;
+	ResetDrawStateCache(&cache);
+	for(int i=0; i<NR_DRAWS; i++)
+	{
+		const int d = items[i].iIndex;
+		const STestMaterial &mat = materials[drawMaterial[d]];
+		for(int s=0; s<DRAW_STATE_NUM_STAGES; s++)
+		{
+			UpdateDrawStateShader(&cache, s, mat.pShaders[s]);
+			for(int k=0; k<NUM_DRAW_STATE_SLOT_KINDS; k++)
+			{
+				int iFirst;
+				UpdateDrawStateSlots(&iFirst, &cache, s, (DRAW_STATE_SLOT_KIND) k, mat.pSlots[s][k], mat.iNrSlots[s][k]);
+			}
+		}
+		UpdateDrawStateInput(&cache, DRAW_STATE_VERTEX_BUFFER, meshBuffers[2*drawMesh[d]+0]);
+		UpdateDrawStateInput(&cache, DRAW_STATE_INDEX_BUFFER, meshBuffers[2*drawMesh[d]+1]);
+		UpdateDrawStateInput(&cache, DRAW_STATE_INPUT_LAYOUT, pLayout);
+		UpdateDrawStateInput(&cache, DRAW_STATE_TOPOLOGY, pTopology);
+		++cache.iNrCalls;		// the draw
+
+		for(int s=0; s<DRAW_STATE_NUM_STAGES; s++)
+		{
+			if(cache.pShaders[s]!=mat.pShaders[s]) ++iNrWrongState;
+			for(int k=0; k<NUM_DRAW_STATE_SLOT_KINDS; k++)
+				for(int j=0; j<mat.iNrSlots[s][k]; j++)
+					if(cache.pSlots[s][k][j]!=mat.pSlots[s][k][j]) ++iNrWrongState;
+		}
+		if(cache.pInputs[DRAW_STATE_VERTEX_BUFFER]!=meshBuffers[2*drawMesh[d]+0] || cache.pInputs[DRAW_STATE_INDEX_BUFFER]!=meshBuffers[2*drawMesh[d]+1]) ++iNrWrongState;
+	}
+	TEST_EXPECT(iNrWrongState==0, "%d bindings differ from what their draw asks for", iNrWrongState);
+
+	// one unbind at the end of the list
+	int iNrCallsAfter = cache.iNrCalls;
+	for(int s=0; s<DRAW_STATE_NUM_STAGES; s++)
+		for(int k=0; k<NUM_DRAW_STATE_SLOT_KINDS; k++)
+			iNrCallsAfter += (cache.iNrSlotsUsed[s][k]+7)/8;
+	const float fReduction = ((float) iNrCallsBefore) / iNrCallsAfter;
+	TEST_EXPECT(fReduction>=MIN_CALL_REDUCTION, "%d calls binding everything per draw, %d sorted and diffed", iNrCallsBefore, iNrCallsAfter);
+
+	printf("%d draws, %d calls binding everything, %d sorted and diffed (%.1fx), sort %.2f ms\n", NR_DRAWS, iNrCallsBefore, iNrCallsAfter,
+		   fReduction, fSortMs);
+
+	return TestResult("draw_list");
+}
@@ -0,0 +1,83 @@
+#include "test_common.h"
+#include "geommath_outofline.h"
+#include <geommath/geommath.h>
+#include <math.h>
+#include <vector>
+
+// Transforms the vertices of a triangle list and computes the normalized
+// face normals once with the header-only geommath and once through calls
+// compiled in their own translation unit, as when vec3.cpp, vec4.cpp and
+// mat44.cpp existed. Both must give the same normals, the timings are
+// printed.
+
+#define NR_VERTS		(1<<20)
+#define NR_RUNS			8
+
+static void FaceNormalsInline(std::vector<Vec3> &normals, const std::vector<Vec3> &verts, const Mat44 &mat)
+{
+	const int iNrFaces = (int) (verts.size()/3);
+	for(int f=0; f<iNrFaces; f++)
+	{
+		Vec3 vP[3];
+		for(int i=0; i<3; i++)
+		{
+			const Vec3 &v = verts[3*f+i];
+			vP[i] = mat*Vec4(v.x, v.y, v.z, 1.0f);
+		}
+		normals[f] = Normalize(Cross(vP[1]-vP[0], vP[2]-vP[0]));
+	}
+}
+
+static void FaceNormalsOutOfLine(std::vector<Vec3> &normals, const std::vector<Vec3> &verts, const Mat44 &mat)
+{
+	const int iNrFaces = (int) (verts.size()/3);
+	for(int f=0; f<iNrFaces; f++)
+	{
+		Vec3 vP[3];
+		for(int i=0; i<3; i++)
+		{
+			const Vec3 &v = verts[3*f+i];
+			vP[i] = OutOfLineMul(mat, Vec4(v.x, v.y, v.z, 1.0f));
+		}
+		normals[f] = OutOfLineNormalize(OutOfLineCross(OutOfLineSub(vP[1], vP[0]), OutOfLineSub(vP[2], vP[0])));
+	}
+}
+
+int main()
+{
+	unsigned int uSeed = 1234;
+	const int iNrFaces = NR_VERTS/3;
+	std::vector<Vec3> verts(3*iNrFaces), normals0(iNrFaces), normals1(iNrFaces);
+	for(size_t i=0; i<verts.size(); i++)
+		verts[i] = Vec3(2*Rand01(&uSeed)-1, 2*Rand01(&uSeed)-1, 2*Rand01(&uSeed)-1);
+
+	Mat44 mat;
+	LoadRotation(&mat, 0.3f, 1.1f, -0.7f);
+	SetColumn(&mat, 3, Vec4(1.0f, -2.0f, 3.0f, 1.0f));
+
+	// warm up both before timing
+	FaceNormalsInline(normals0, verts, mat);
+	FaceNormalsOutOfLine(normals1, verts, mat);
+
+	TestClock::time_point t0 = TestClock::now();
+	for(int r=0; r<NR_RUNS; r++) FaceNormalsInline(normals0, verts, mat);
+	const double fInlineMs = MsSince(t0)/NR_RUNS;
+
+	t0 = TestClock::now();
+	for(int r=0; r<NR_RUNS; r++) FaceNormalsOutOfLine(normals1, verts, mat);
+	const double fOutOfLineMs = MsSince(t0)/NR_RUNS;
+
+	int iNrDiffer = 0, iNrNotUnit = 0;
+	for(int f=0; f<iNrFaces; f++)
+	{
+		const Vec3 &n0 = normals0[f], &n1 = normals1[f];
+		if(LengthSquared(n0-n1)>1e-10f) ++iNrDiffer;
+		if(fabsf(LengthSquared(n0)-1.0f)>1e-4f) ++iNrNotUnit;
+	}
+	TEST_EXPECT(iNrDiffer==0, "%d of %d normals differ", iNrDiffer, iNrFaces);
+	TEST_EXPECT(iNrNotUnit==0, "%d of %d normals not unit length", iNrNotUnit, iNrFaces);
+
+	printf("%d vertices, header-only %.2f ms, out-of-line %.2f ms\n", 3*iNrFaces, fInlineMs, fOutOfLineMs);
+
+	return TestResult("geommath");
+}
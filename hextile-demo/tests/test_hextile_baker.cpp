@@ -0,0 +1,136 @@
+#include "test_common.h"
+#include <cputools/hextile_baker.h>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+// Bakes a mesh of two quads, side by side in both uv sets, through
+// HexBakeMeshAtlasFile() as hextile-tool bake -atlas does. The chart
+// occupies the center of the atlas at one texel per texel of a plane bake
+// with the same tile rate, so inside the chart, across the seam between the
+// quads included, the atlas must match HexBakePlane(). The gutter must be
+// filled by dilation and everything beyond it left at zero.
+
+#define SRC_SIZE		64
+#define CHART_SIZE		64
+#define ATLAS_SIZE		128
+#define CHART_OFFS		((ATLAS_SIZE-CHART_SIZE)/2)
+#define GUTTER			4
+#define MAX_DIFF		1e-3f
+
+static const char g_szSrcName[] = "test_hextile_baker_src.dds";
+static const char g_szMeshName[] = "test_hextile_baker_quads.obj";
+static const char g_szAtlasName[] = "test_hextile_baker_atlas.dds";
+
+// atlas uv = 0.25 + 0.5*uv places uv [0;1]^2 on the center CHART_SIZE texels
+static bool WriteQuadsObj(const char name[])
+{
+	FILE * fptr = fopen(name, "w");
+	if(fptr==NULL) return false;
+
+	for(int x=0; x<3; x++)
+		for(int y=0; y<2; y++)
+		{
+			const float u = 0.5f*x, v = (float) y;
+			fprintf(fptr, "v %f %f 0\nvt %f %f\n#vt2 %f %f\n", u, v, u, v, 0.25f+0.5f*u, 0.25f+0.5f*v);
+		}
+	fprintf(fptr, "vn 0 0 1\n");
+	fprintf(fptr, "f 1/1/1 3/3/1 4/4/1 2/2/1\nf 3/3/1 5/5/1 6/6/1 4/4/1\n");
+	fclose(fptr);
+
+	return true;
+}
+
+static bool WriteSource(const char name[])
+{
+	SCpuImage src;
+	if(!AllocCpuImage(&src, SRC_SIZE, SRC_SIZE)) return false;
+
+	unsigned int uSeed = 0x1b873593u;
+	for(int y=0; y<SRC_SIZE; y++)
+		for(int x=0; x<SRC_SIZE; x++)
+		{
+			float * pCol = GetCpuImagePixel(src, x, y);
+			for(int c=0; c<3; c++) pCol[c] = 0.25f + 0.5f*Rand01(&uSeed);
+			pCol[3] = 1.0f;
+		}
+
+	const bool res = SaveCpuImageDDS(name, &src, 1);
+	FreeCpuImage(&src);
+
+	return res;
+}
+
+int main()
+{
+	SHexBakeParams params;
+	InitHexBakeParams(&params, HEXBAKE_COLOR);
+	params.fTileRate = 2.0f;
+	params.iGutter = GUTTER;
+
+	const bool bInputs = WriteSource(g_szSrcName) && WriteQuadsObj(g_szMeshName);
+	TEST_EXPECT(bInputs, "failed to write the test inputs");
+
+	const wchar_t szSrcNameW[] = L"test_hextile_baker_src.dds";
+	const TestClock::time_point t0 = TestClock::now();
+	const bool bAtlas = bInputs && HexBakeMeshAtlasFile(g_szAtlasName, szSrcNameW, false, g_szMeshName, ATLAS_SIZE, ATLAS_SIZE, params);
+	const float fMs = MsSince(t0);
+	TEST_EXPECT(bAtlas, "HexBakeMeshAtlasFile() failed");
+
+	SCpuImage src, atlas, plane;
+	src.pfPixels = atlas.pfPixels = plane.pfPixels = NULL;
+	std::vector<SCpuImage> srcMips;
+	bool res = bAtlas && LoadCpuImageDDS(&atlas, g_szAtlasName) && LoadCpuImageDDS(&src, g_szSrcName);
+	TEST_EXPECT(res, "failed to load the baked atlas");
+	if(res)
+	{
+		srcMips.resize(GetNrMipLevels(src.iWidth, src.iHeight));
+		res = BuildMipChainWrap(&srcMips[0], src, (int) srcMips.size()) &&
+			  HexBakePlane(&plane, 1, CHART_SIZE, CHART_SIZE, &srcMips[0], (int) srcMips.size(), params);
+		TEST_EXPECT(res, "HexBakePlane() failed");
+	}
+
+	if(res)
+	{
+		TEST_EXPECT(atlas.iWidth==ATLAS_SIZE && atlas.iHeight==ATLAS_SIZE, "atlas is %dx%d", atlas.iWidth, atlas.iHeight);
+
+		float fMaxDiff = 0.0f, fMaxSeamDiff = 0.0f;
+		int iNrUnfilled = 0, iNrLeaked = 0;
+		for(int y=0; y<ATLAS_SIZE; y++)
+			for(int x=0; x<ATLAS_SIZE; x++)
+			{
+				const float * pCol = GetCpuImagePixel(atlas, x, y);
+				const int px = x-CHART_OFFS, py = y-CHART_OFFS;
+				const int dx = px<0 ? -px : (px>=CHART_SIZE ? (px-CHART_SIZE+1) : 0);
+				const int dy = py<0 ? -py : (py>=CHART_SIZE ? (py-CHART_SIZE+1) : 0);
+				const int iDist = dx>dy ? dx : dy;		// texels outside the chart
+
+				if(iDist==0)
+				{
+					const float * pRef = GetCpuImagePixel(plane, px, py);
+					for(int c=0; c<4; c++)
+					{
+						const float fDiff = fabsf(pCol[c]-pRef[c]);
+						if(fDiff>fMaxDiff) fMaxDiff = fDiff;
+						if((px==(CHART_SIZE/2-1) || px==(CHART_SIZE/2)) && fDiff>fMaxSeamDiff) fMaxSeamDiff = fDiff;
+					}
+				}
+				else if(iDist<=GUTTER) { if(!(pCol[3]>0.0f)) ++iNrUnfilled; }
+				else if(pCol[0]!=0.0f || pCol[1]!=0.0f || pCol[2]!=0.0f || pCol[3]!=0.0f) ++iNrLeaked;
+			}
+
+		TEST_EXPECT(fMaxDiff<MAX_DIFF, "chart differs from the plane bake by %f", fMaxDiff);
+		TEST_EXPECT(fMaxSeamDiff<MAX_DIFF, "seam between the quads differs from the plane bake by %f", fMaxSeamDiff);
+		TEST_EXPECT(iNrUnfilled==0, "%d gutter texels are not filled", iNrUnfilled);
+		TEST_EXPECT(iNrLeaked==0, "%d texels beyond the gutter are not zero", iNrLeaked);
+		printf("atlas %dx%d in %.1f ms, max difference %.6f, %.6f at the seam\n", ATLAS_SIZE, ATLAS_SIZE, fMs, fMaxDiff, fMaxSeamDiff);
+	}
+
+	for(size_t m=0; m<srcMips.size(); m++) if(srcMips[m].pfPixels!=NULL) FreeCpuImage(&srcMips[m]);
+	if(src.pfPixels!=NULL) FreeCpuImage(&src);
+	if(atlas.pfPixels!=NULL) FreeCpuImage(&atlas);
+	if(plane.pfPixels!=NULL) FreeCpuImage(&plane);
+	remove(g_szSrcName); remove(g_szMeshName); remove(g_szAtlasName);
+
+	return TestResult("hextile_baker");
+}
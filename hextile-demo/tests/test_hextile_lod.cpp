@@ -0,0 +1,67 @@
+#include "test_common.h"
+#include <cputools/hextile_lod.h>
+#include <geommath/geommath.h>
+#include <math.h>
+#include <string.h>
+
+// Sweeps fallbackStart for a camera looking over the ground plane. Raising
+// it moves the fallback to finer mip levels so the single fetch, faded in
+// or alone, may only gain pixels and hex-tiling only lose them, while the
+// pixels covered by the plane stay the same.
+
+#define WIDTH			640
+#define HEIGHT			360
+#define PIXEL_STEP		2
+#define TILE_RATE		0.25f
+#define TEX_SIZE		1024
+#define FALLBACK_RANGE	1.0f
+#define NR_STARTS		24
+#define START_STEP		0.5f
+
+int main()
+{
+	// 2 units above the ground, pitched down by 15 degrees
+	const float fPitch = 15.0f*(3.1415926f/180);
+	Mat44 mViewToWorld;
+	LoadIdentity(&mViewToWorld);
+	SetColumn(&mViewToWorld, 1, Vec4(0.0f, cosf(fPitch), -sinf(fPitch), 0.0f));
+	SetColumn(&mViewToWorld, 2, Vec4(0.0f, sinf(fPitch), cosf(fPitch), 0.0f));
+	SetColumn(&mViewToWorld, 3, Vec4(0.0f, 2.0f, 0.0f, 1.0f));
+	const float fFovY = 60.0f*(3.1415926f/180);
+
+	SHexLodCoverage prev;
+	memset(&prev, 0, sizeof(prev));
+	SHexLodCoverage first = prev;
+	for(int i=0; i<NR_STARTS; i++)
+	{
+		const float fStart = i*START_STEP;
+		SHexLodCoverage cov;
+		const bool bRes = HexLodCoverageGroundPlane(&cov, mViewToWorld, fFovY, WIDTH, HEIGHT, Vec3(0.0f, 0.0f, 0.0f), 1000.0f,
+													TILE_RATE, TEX_SIZE, fStart, FALLBACK_RANGE, PIXEL_STEP);
+		TEST_EXPECT(bRes && cov.iNrPixels>0, "HexLodCoverageGroundPlane() failed at fallbackStart %g", fStart);
+		if(!bRes || cov.iNrPixels<=0) continue;
+
+		const float fSum = cov.fHexFraction + cov.fFadeFraction + cov.fFallbackFraction;
+		TEST_EXPECT(fabsf(fSum-1.0f)<1e-5f, "fractions sum to %f at fallbackStart %g", fSum, fStart);
+		if(i>0)
+		{
+			TEST_EXPECT(cov.iNrPixels==prev.iNrPixels, "plane covers %d pixels, %d before", cov.iNrPixels, prev.iNrPixels);
+			TEST_EXPECT(cov.fHexFraction<=prev.fHexFraction, "hex fraction grows from %f to %f at fallbackStart %g",
+						prev.fHexFraction, cov.fHexFraction, fStart);
+			TEST_EXPECT(cov.fFallbackFraction>=prev.fFallbackFraction, "fallback fraction shrinks from %f to %f at fallbackStart %g",
+						prev.fFallbackFraction, cov.fFallbackFraction, fStart);
+		}
+		else first = cov;
+
+		if((i%4)==0)
+			printf("fallbackStart %4.1f: hex %.3f, fade %.3f, fallback %.3f, %.2f fetches per pixel\n", fStart, cov.fHexFraction,
+				   cov.fFadeFraction, cov.fFallbackFraction, cov.fFetchesPerPixel);
+		prev = cov;
+	}
+
+	// the sweep must actually move pixels from one path to the other
+	TEST_EXPECT(first.fHexFraction>0.5f && prev.fFallbackFraction>0.5f, "hex %f at the first start, fallback %f at the last",
+				first.fHexFraction, prev.fFallbackFraction);
+
+	return TestResult("hextile_lod");
+}
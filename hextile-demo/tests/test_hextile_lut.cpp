@@ -0,0 +1,48 @@
+#include "test_common.h"
+#include <cputools/hextile_lut.h>
+#include <math.h>
+#include <vector>
+
+// The shipped table, HEXCELL_LUT_DEFAULT_SIZE cells as returned by
+// GetHexCellLUTSize() in scenegraph.cpp, must reproduce the distribution of
+// the analytic rotations and offsets with no correlation between neighbor
+// cells. The shader wraps cell ids with & (N-1) so sizes other than powers
+// of two must be rejected.
+
+#define CELL_RANGE			256
+#define MAX_ANGLE_KS		0.03f
+#define MAX_OFFS_KS			0.02f
+#define MAX_NEIGHBOR_CORR	0.05f
+
+static bool IsPow2(const int N) { return N>0 && (N&(N-1))==0; }
+
+int main()
+{
+	const int N = HEXCELL_LUT_DEFAULT_SIZE;
+	TEST_EXPECT(IsPow2(N), "the shipped table has %d cells per row", N);
+
+	SHexCellLUTStats stats;
+	const bool bRes = CompareHexCellLUT(&stats, N, CELL_RANGE);
+	TEST_EXPECT(bRes, "CompareHexCellLUT() failed for N=%d", N);
+	if(bRes)
+	{
+		TEST_EXPECT(stats.fAngleKS<MAX_ANGLE_KS, "angle KS distance %f", stats.fAngleKS);
+		TEST_EXPECT(stats.fOffsKS<MAX_OFFS_KS, "offset KS distance %f", stats.fOffsKS);
+		TEST_EXPECT(fabsf(stats.fNeighborCorrLUT)<MAX_NEIGHBOR_CORR, "neighbor correlation %f", stats.fNeighborCorrLUT);
+
+		printf("N=%d over %d cells: KS angle %.4f offsets %.4f\n", N, stats.iNrCells, stats.fAngleKS, stats.fOffsKS);
+		printf("neighbor correlation %.4f analytic %.4f, distinct %.3f analytic %.3f\n", stats.fNeighborCorrLUT,
+			   stats.fNeighborCorrAnalytic, stats.fDistinctLUT, stats.fDistinctAnalytic);
+	}
+
+	const int badSizes[] = { 0, 48, 63, 65 };
+	for(int i=0; i<(int) (sizeof(badSizes)/sizeof(badSizes[0])); i++)
+	{
+		const int M = badSizes[i];
+		std::vector<float> lut(4*M*M + 4);
+		TEST_EXPECT(!GenerateHexCellLUT(&lut[0], M, 1.0f), "GenerateHexCellLUT() accepts N=%d", M);
+		TEST_EXPECT(!CompareHexCellLUT(&stats, M, CELL_RANGE), "CompareHexCellLUT() accepts N=%d", M);
+	}
+
+	return TestResult("hextile_lut");
+}
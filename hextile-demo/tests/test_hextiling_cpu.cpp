@@ -0,0 +1,131 @@
+#include "test_common.h"
+#include <cputools/hextiling_cpu.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+// HexTileCoordsBatch() over pseudo random st, with AVX2 when the CPU has it,
+// must give the bits of the scalar path, which the batch takes one sample
+// at a time. The scalar port is checked against values worked out by hand
+// from TriangleGrid(), MakeCenST(), LoadRot2x2() and hash() in hextiling.h.
+
+#define NR_SAMPLES		100003		// not a multiple of 8, the tail is scalar
+#define ST_RANGE		256.0f
+#define EPS				1e-5f
+#define HASH_EPS		(1.0f/64)	// float ulp of sin()*43758.5453
+
+static bool CoordsEqual(const SHexTileCoordsSoA &a, const int i, const SHexTileCoordsSoA &b, const int j)
+{
+	bool bEqual = true;
+	for(int k=0; k<3; k++)
+	{
+		bEqual &= a.piVertX[k][i]==b.piVertX[k][j] && a.piVertY[k][i]==b.piVertY[k][j];
+		bEqual &= memcmp(&a.pfBary[k][i], &b.pfBary[k][j], sizeof(float))==0;
+		bEqual &= memcmp(&a.pfRotCs[k][i], &b.pfRotCs[k][j], sizeof(float))==0;
+		bEqual &= memcmp(&a.pfRotSi[k][i], &b.pfRotSi[k][j], sizeof(float))==0;
+		bEqual &= memcmp(&a.pfS[k][i], &b.pfS[k][j], sizeof(float))==0;
+		bEqual &= memcmp(&a.pfT[k][i], &b.pfT[k][j], sizeof(float))==0;
+	}
+	return bEqual;
+}
+
+static void CheckBatch(const std::vector<float> &S, const std::vector<float> &T, const float rotStrength)
+{
+	const int N = (int) S.size();
+	SHexTileCoordsSoA batch, single;
+	if(!AllocHexTileCoords(&batch, N) || !AllocHexTileCoords(&single, 1))
+	{
+		TEST_EXPECT(false, "AllocHexTileCoords() failed");
+		return;
+	}
+
+	const TestClock::time_point t0 = TestClock::now();
+	HexTileCoordsBatch(&batch, &S[0], &T[0], N, rotStrength);
+	const float fMs = MsSince(t0);
+
+	int iNrMismatches = 0;
+	for(int i=0; i<N; i++)
+	{
+		HexTileCoordsBatch(&single, &S[i], &T[i], 1, rotStrength);
+		if(!CoordsEqual(batch, i, single, 0)) ++iNrMismatches;
+	}
+	TEST_EXPECT(iNrMismatches==0, "rotStrength %g: %d of %d batch results differ from the scalar path", rotStrength, iNrMismatches, N);
+	printf("rotStrength %.2f: %d samples in %.2f ms\n", rotStrength, N, fMs);
+
+	FreeHexTileCoords(&batch);
+	FreeHexTileCoords(&single);
+}
+
+static void CheckByHand()
+{
+	// st=0 lies on vertex (0,0) of the lower triangle
+	float w[3];
+	int v[3][2];
+	const float st0[] = { 0.0f, 0.0f };
+	TriangleGrid(&w[0], &w[1], &w[2], v[0], v[1], v[2], st0);
+	TEST_EXPECT(w[0]==1.0f && w[1]==0.0f && w[2]==0.0f, "TriangleGrid(0) weights %f %f %f", w[0], w[1], w[2]);
+	TEST_EXPECT(v[0][0]==0 && v[0][1]==0 && v[1][0]==0 && v[1][1]==1 && v[2][0]==1 && v[2][1]==0, "TriangleGrid(0) vertices");
+
+	// skewed coordinate (0.75, 0.75) is in the upper triangle of cell (0,0)
+	const float st1[] = { 0.3247595f, 0.1875f };
+	TriangleGrid(&w[0], &w[1], &w[2], v[0], v[1], v[2], st1);
+	TEST_EXPECT(fabsf(w[0]-0.5f)<EPS && fabsf(w[1]-0.25f)<EPS && fabsf(w[2]-0.25f)<EPS, "TriangleGrid() weights %f %f %f", w[0], w[1], w[2]);
+	TEST_EXPECT(v[0][0]==1 && v[0][1]==1 && v[1][0]==1 && v[1][1]==0 && v[2][0]==0 && v[2][1]==1, "TriangleGrid() upper triangle vertices");
+
+	// (vx + vy/2, vy/skewYY) / (2 sqrt(3))
+	float cen[2];
+	const int v10[] = { 1, 0 }, v01[] = { 0, 1 };
+	MakeCenST(cen, v10);
+	TEST_EXPECT(fabsf(cen[0]-0.2886751f)<EPS && fabsf(cen[1])<EPS, "MakeCenST(1,0) %f %f", cen[0], cen[1]);
+	MakeCenST(cen, v01);
+	TEST_EXPECT(fabsf(cen[0]-0.1443376f)<EPS && fabsf(cen[1]-0.25f)<EPS, "MakeCenST(0,1) %f %f", cen[0], cen[1]);
+
+	// angle |x*y| + |x+y| + pi wrapped to +/-pi, 5+pi for cell (1,2)
+	float cs, si;
+	const int v00[] = { 0, 0 }, v12[] = { 1, 2 };
+	LoadRot2x2(&cs, &si, v00, 1.0f);
+	TEST_EXPECT(fabsf(cs+1.0f)<EPS && fabsf(si)<EPS, "LoadRot2x2(0,0) %f %f", cs, si);
+	LoadRot2x2(&cs, &si, v12, 1.0f);
+	TEST_EXPECT(fabsf(cs+0.2836622f)<EPS && fabsf(si-0.9589243f)<EPS, "LoadRot2x2(1,2) %f %f", cs, si);
+	LoadRot2x2(&cs, &si, v12, 0.0f);
+	TEST_EXPECT(cs==1.0f && si==0.0f, "LoadRot2x2() with rotStrength 0 gives %f %f", cs, si);
+
+	// frac(sin(127.1*x + 311.7*y)*43758.5453), frac(sin(269.5*x + 183.3*y)*43758.5453)
+	float ofs[2];
+	hash(ofs, v00);
+	TEST_EXPECT(ofs[0]==0.0f && ofs[1]==0.0f, "hash(0,0) %f %f", ofs[0], ofs[1]);
+	hash(ofs, v10);
+	TEST_EXPECT(fabsf(ofs[0]-0.3166577f)<HASH_EPS && fabsf(ofs[1]-0.2163376f)<HASH_EPS, "hash(1,0) %f %f", ofs[0], ofs[1]);
+
+	// at st=0 the first tap is unrotated and unshifted whatever the strength
+	SHexTileCoordsSoA coords;
+	if(AllocHexTileCoords(&coords, 1))
+	{
+		HexTileCoordsBatch(&coords, &st0[0], &st0[1], 1, 1.0f);
+		TEST_EXPECT(coords.pfS[0][0]==0.0f && coords.pfT[0][0]==0.0f, "st1 at 0 is %f %f", coords.pfS[0][0], coords.pfT[0][0]);
+		FreeHexTileCoords(&coords);
+	}
+	else TEST_EXPECT(false, "AllocHexTileCoords() failed");
+}
+
+int main()
+{
+	std::vector<float> S(NR_SAMPLES), T(NR_SAMPLES);
+	unsigned int uSeed = 0x3c6ef372u;
+	for(int i=0; i<NR_SAMPLES; i++)
+	{
+		S[i] = ST_RANGE*(2*Rand01(&uSeed)-1);
+		T[i] = ST_RANGE*(2*Rand01(&uSeed)-1);
+	}
+
+	printf("AVX2 %s\n", IsHexTilingAVX2Enabled() ? "enabled" : "disabled");
+	const float rotStrengths[] = { 0.0f, 0.5f, 1.0f, 2.0f };
+	for(int r=0; r<4; r++) CheckBatch(S, T, rotStrengths[r]);
+
+	CheckByHand();
+
+	SHexTileCoordsSoA empty;
+	TEST_EXPECT(!AllocHexTileCoords(&empty, 0), "AllocHexTileCoords() accepts N=0");
+
+	return TestResult("hextiling_cpu");
+}
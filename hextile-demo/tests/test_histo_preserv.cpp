@@ -0,0 +1,135 @@
+#include "test_common.h"
+#include <cputools/histo_preserv.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Builds the textures of hex2colTex_histo() for a synthetic source with three
+// independent components of different spread. vari must be the ratio of the
+// extents as in the shipped _basis.dds files, the streaming version must
+// agree with the sorting one, the transfer rebuilt from invTransfer and basis
+// alone must match the generated one and the dds must round trip with the
+// DX10 header of the shipped files.
+
+#define SRC_SIZE		256
+
+struct SRowSource
+{
+	const SCpuImage * pSrc;
+	std::vector<float> transfer;
+};
+
+static bool ReadRows(float pfDst[], const int y0, const int nrRows, void * pUserData)
+{
+	const SRowSource * pRows = (const SRowSource *) pUserData;
+	memcpy(pfDst, GetCpuImagePixel(*pRows->pSrc, 0, y0), 4*sizeof(float)*pRows->pSrc->iWidth*nrRows);
+	return true;
+}
+
+static bool WriteRows(const float pfSrc[], const int y0, const int nrRows, void * pUserData)
+{
+	SRowSource * pRows = (SRowSource *) pUserData;
+	memcpy(&pRows->transfer[((size_t) 4)*pRows->pSrc->iWidth*y0], pfSrc, 4*sizeof(float)*pRows->pSrc->iWidth*nrRows);
+	return true;
+}
+
+static void BuildSource(SCpuImage * pSrc)
+{
+	unsigned int uSeed = 4321;
+	const float fSpread[] = { 0.02f, 0.12f, 0.05f };
+	const float fDir[3][3] = { { 0.8f, -0.6f, 0.0f }, { 0.6f, 0.8f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+	for(int i=0; i<SRC_SIZE*SRC_SIZE; i++)
+	{
+		float * pfCol = pSrc->pfPixels + 4*i;
+		pfCol[0] = 0.4f; pfCol[1] = 0.35f; pfCol[2] = 0.3f; pfCol[3] = 1.0f;
+		for(int k=0; k<3; k++)
+		{
+			const float g = Rand01(&uSeed) + Rand01(&uSeed) + Rand01(&uSeed) - 1.5f;
+			for(int c=0; c<3; c++) pfCol[c] += fSpread[k]*g*fDir[k][c];
+		}
+	}
+}
+
+int main()
+{
+	SCpuImage src;
+	if(!AllocCpuImage(&src, SRC_SIZE, SRC_SIZE)) return 1;
+	BuildSource(&src);
+	const int nrTexels = SRC_SIZE*SRC_SIZE;
+
+	SHistoPreservAssets assets;
+	const bool bBuilt = BuildHistoPreservAssets(&assets, src);
+	TEST_EXPECT(bBuilt, "BuildHistoPreservAssets() failed");
+	if(!bBuilt) return TestResult("histo_preserv");
+
+	// the extents of the components are in the ratio of their spreads
+	TEST_EXPECT(fabsf(assets.fVari[0]-0.12f/0.05f)<0.1f && fabsf(assets.fVari[1]-0.12f/0.02f)<0.3f,
+				"vari %f %f, expected about %f %f", assets.fVari[0], assets.fVari[1], 0.12f/0.05f, 0.12f/0.02f);
+	TEST_EXPECT(assets.fRoundTripRmsErr<0.002f && assets.fRoundTripMaxErr<0.02f, "round trip rms %f max %f",
+				assets.fRoundTripRmsErr, assets.fRoundTripMaxErr);
+
+	// streaming in strips of a few rows
+	SRowSource rows;
+	rows.pSrc = &src;
+	rows.transfer.resize(4*nrTexels);
+
+	SHistoStreamParams params;
+	params.iWidth = SRC_SIZE; params.iHeight = SRC_SIZE;
+	params.pReadRows = ReadRows; params.pWriteRows = WriteRows;
+	params.pUserData = &rows;
+	params.uMemoryBudget = 16<<20;
+	params.iNrThreads = 0;
+
+	SHistoPreservAssets streamed;
+	const bool bStreamed = BuildHistoPreservAssetsStreaming(&streamed, params);
+	TEST_EXPECT(bStreamed, "BuildHistoPreservAssetsStreaming() failed");
+	if(bStreamed)
+	{
+		TEST_EXPECT(fabsf(streamed.fVari[0]-assets.fVari[0])<1e-3f && fabsf(streamed.fVari[1]-assets.fVari[1])<1e-3f,
+					"streamed vari %f %f against %f %f", streamed.fVari[0], streamed.fVari[1], assets.fVari[0], assets.fVari[1]);
+
+		int iNrFar = 0;
+		for(int i=0; i<4*nrTexels; i++)
+			if(fabsf(rows.transfer[i]-assets.transfer.pfPixels[i])>(1.5f/255)) ++iNrFar;
+		TEST_EXPECT(iNrFar<(nrTexels/100), "%d streamed transfer values off by more than one level", iNrFar);
+		FreeHistoPreservAssets(&streamed);
+	}
+
+	// the transfer from invTransfer and basis alone
+	std::vector<float> transfer(4*nrTexels);
+	const bool bRebuilt = HistoTransferFromAssets(&transfer[0], src.pfPixels, nrTexels, assets.invTransfer, assets.basis);
+	TEST_EXPECT(bRebuilt, "HistoTransferFromAssets() failed");
+	if(bRebuilt)
+	{
+		int iNrFar = 0;
+		for(int i=0; i<4*nrTexels; i++)
+			if(fabsf(transfer[i]-assets.transfer.pfPixels[i])>(1.5f/255)) ++iNrFar;
+		TEST_EXPECT(iNrFar<(nrTexels/100), "%d rebuilt transfer values off by more than one level", iNrFar);
+	}
+
+	// dds round trip, DX10 header with DXGI_FORMAT_R32G32B32A32_FLOAT
+	const char ddsName[] = "test_histo_preserv_basis.dds";
+	SCpuImage basis;
+	bool bLoaded = SaveCpuImageDDS(ddsName, &assets.basis, 1) && LoadCpuImageDDS(&basis, ddsName);
+	TEST_EXPECT(bLoaded, "dds round trip of the basis failed");
+	if(bLoaded)
+	{
+		TEST_EXPECT(basis.iWidth==8 && basis.iHeight==2 && memcmp(basis.pfPixels, assets.basis.pfPixels, 8*2*4*sizeof(float))==0,
+					"basis differs after the dds round trip");
+		FreeCpuImage(&basis);
+
+		unsigned int header[37];
+		FILE * fptr = fopen(ddsName, "rb");
+		bLoaded = fptr!=NULL && fread(header, sizeof(header), 1, fptr)==1;
+		if(fptr!=NULL) fclose(fptr);
+		TEST_EXPECT(bLoaded && header[21]==0x30315844 && header[32]==2 && header[33]==3, "no DX10 header");
+	}
+	remove(ddsName);
+
+	printf("vari %.3f %.3f, round trip rms %.5f max %.5f\n", assets.fVari[0], assets.fVari[1], assets.fRoundTripRmsErr, assets.fRoundTripMaxErr);
+	FreeHistoPreservAssets(&assets);
+	FreeCpuImage(&src);
+
+	return TestResult("histo_preserv");
+}
@@ -0,0 +1,80 @@
+#include "test_common.h"
+#include <cputools/instance_batch.h>
+#include <algorithm>
+#include <vector>
+
+// Batches a random subset of instances of a few meshes and materials. Every
+// visible instance must appear exactly once in the order, every batch must
+// hold one mesh and material and no two batches the same pair, batches must
+// be consecutive and instances keep their order within a batch. There must
+// be one batch per distinct pair.
+
+#define NR_INSTANCES		100000
+#define NR_MESHES			16
+#define NR_MATERIALS		8
+#define NR_RUNS				16
+
+int main()
+{
+	// a skewed distribution, some pairs are common and some absent
+	unsigned int uSeed = 4321;
+	std::vector<int> mesh(NR_INSTANCES), material(NR_INSTANCES), visible;
+	std::vector<int> pairCount(NR_MESHES*NR_MATERIALS, 0);
+	for(int i=0; i<NR_INSTANCES; i++)
+	{
+		const float fR = Rand01(&uSeed);
+		mesh[i] = std::min(NR_MESHES-1, (int) (fR*fR*NR_MESHES));
+		material[i] = std::min(NR_MATERIALS-1, (int) (Rand01(&uSeed)*NR_MATERIALS));
+		if(Rand01(&uSeed)<0.6f) { visible.push_back(i); ++pairCount[material[i]*NR_MESHES+mesh[i]]; }
+	}
+	const int iNrVisible = (int) visible.size();
+	int iNrPairs = 0;
+	for(int k=0; k<(int) pairCount.size(); k++) if(pairCount[k]>0) ++iNrPairs;
+
+	std::vector<SInstanceBatch> batches;
+	std::vector<int> order;
+	SInstanceBatchStats stats;
+	const TestClock::time_point t0 = TestClock::now();
+	for(int r=0; r<NR_RUNS; r++)
+		BuildInstanceBatches(batches, order, &visible[0], iNrVisible, &mesh[0], &material[0], NR_MESHES, NR_MATERIALS, &stats);
+	const double fMs = MsSince(t0)/NR_RUNS;
+
+	TEST_EXPECT((int) batches.size()==iNrPairs, "%d batches for %d distinct pairs", (int) batches.size(), iNrPairs);
+	TEST_EXPECT(stats.iNrInstances==iNrVisible && stats.iNrBatches==(int) batches.size(), "stats count %d instances in %d batches", stats.iNrInstances, stats.iNrBatches);
+	TEST_EXPECT((int) order.size()==iNrVisible, "order holds %d of %d instances", (int) order.size(), iNrVisible);
+
+	// each visible instance once, in a batch of its own pair
+	std::vector<int> seen(NR_INSTANCES, 0);
+	std::vector<int> pairSeen(NR_MESHES*NR_MATERIALS, 0);
+	int iNrGaps = 0, iNrSharedPairs = 0, iNrMixed = 0, iNrUnordered = 0, iCovered = 0;
+	for(int b=0; b<(int) batches.size(); b++)
+	{
+		const SInstanceBatch &batch = batches[b];
+		if(batch.iFirstInstance!=iCovered || batch.iNrInstances<1) ++iNrGaps;
+		if(pairSeen[batch.iMaterial*NR_MESHES+batch.iMesh]++ > 0) ++iNrSharedPairs;
+
+		int iPrev = -1;
+		for(int i=batch.iFirstInstance; i<(batch.iFirstInstance+batch.iNrInstances) && i<(int) order.size(); i++)
+		{
+			const int idx = order[i];
+			if(mesh[idx]!=batch.iMesh || material[idx]!=batch.iMaterial) ++iNrMixed;
+			if(idx<=iPrev) ++iNrUnordered;		// the visible list is ascending
+			++seen[idx]; iPrev = idx;
+		}
+		iCovered += batch.iNrInstances;
+	}
+	int iNrNotOnce = 0;
+	for(int i=0; i<iNrVisible; i++)
+		if(seen[visible[i]]!=1) ++iNrNotOnce;
+
+	TEST_EXPECT(iNrGaps==0, "%d batches don't follow the previous one", iNrGaps);
+	TEST_EXPECT(iNrSharedPairs==0, "%d batches repeat a mesh and material", iNrSharedPairs);
+	TEST_EXPECT(iNrMixed==0, "%d instances in a batch of another mesh or material", iNrMixed);
+	TEST_EXPECT(iNrUnordered==0, "%d instances out of order within their batch", iNrUnordered);
+	TEST_EXPECT(iCovered==iNrVisible, "batches cover %d of %d instances", iCovered, iNrVisible);
+	TEST_EXPECT(iNrNotOnce==0, "%d visible instances not in the order exactly once", iNrNotOnce);
+
+	printf("%d visible instances in %d draws (%.0fx fewer), %.3f ms\n", iNrVisible, (int) batches.size(), stats.fDrawReduction, fMs);
+
+	return TestResult("instance_batch");
+}
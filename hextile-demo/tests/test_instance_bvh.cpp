@@ -0,0 +1,144 @@
+#include "test_common.h"
+#include <cputools/instance_bvh.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <vector>
+
+// A field of random boxes and a camera circling it. Every frame a fraction
+// of the instances move a little and the tree is refit. The query must
+// find exactly the instances which testing every box against the planes
+// finds, with either path. Refitting everything must leave a tree that
+// still finds them.
+
+#define NR_INSTANCES		100000
+#define MOVED_FRACTION		0.05f
+#define NR_FRAMES			64
+
+// right hand view looking down -Z, see myFrustum() in hextile-demo.cpp
+static void GetTestWorldToClip(Mat44 * pmWorldToClip, const Vec3 &vPos, const float fYaw, const float fPitch)
+{
+	const float fFovY = 60.0f*(3.1415926535897932384626433832795f/180.0f), fAspect = 4.0f/3.0f;
+	const float fNear = 0.1f, fFar = 1000.0f;
+	const float fCotY = 1.0f/tanf(0.5f*fFovY);
+
+	Mat44 mProj;
+	SetRow(&mProj, 0, Vec4(fCotY/fAspect, 0, 0, 0));
+	SetRow(&mProj, 1, Vec4(0, fCotY, 0, 0));
+	SetRow(&mProj, 2, Vec4(0, 0, -fFar/(fFar-fNear), -(fFar*fNear)/(fFar-fNear)));
+	SetRow(&mProj, 3, Vec4(0, 0, -1, 0));
+
+	Mat44 mViewToWorld;
+	LoadRotation(&mViewToWorld, fPitch, fYaw, 0.0f);
+	SetColumn(&mViewToWorld, 3, Vec4(vPos.x, vPos.y, vPos.z, 1.0f));
+	*pmWorldToClip = mProj * ~mViewToWorld;
+}
+
+// the corner of each box furthest along the plane's normal, summed in the
+// order of the query so both round alike
+static void BruteForceCull(std::vector<int> &visible, const SFrustumPlanes &frustum, const float * const pfCen[3], const float * const pfExt[3])
+{
+	visible.clear();
+	for(int i=0; i<NR_INSTANCES; i++)
+	{
+		bool bVisible = true;
+		for(int p=0; p<6 && bVisible; p++)
+		{
+			const float * pfPlane = frustum.fPlanes[p];
+			float fPos[3];
+			for(int k=0; k<3; k++) fPos[k] = pfPlane[k]>=0.0f ? (pfCen[k][i]+pfExt[k][i]) : (pfCen[k][i]-pfExt[k][i]);
+			bVisible = (((pfPlane[0]*fPos[0] + pfPlane[1]*fPos[1]) + pfPlane[2]*fPos[2]) + pfPlane[3])>=0.0f;
+		}
+		if(bVisible) visible.push_back(i);
+	}
+}
+
+int main()
+{
+	// boxes of a few units scattered over a 2km square, most of them low
+	unsigned int uSeed = 8191;
+	const float fWorldSize = 2000.0f;
+	std::vector<float> bounds(6*NR_INSTANCES);
+	float * pfCen[3], * pfExt[3];
+	for(int k=0; k<3; k++) { pfCen[k] = &bounds[k*NR_INSTANCES]; pfExt[k] = &bounds[(3+k)*NR_INSTANCES]; }
+	for(int i=0; i<NR_INSTANCES; i++)
+	{
+		const float fY = Rand01(&uSeed);
+		pfCen[0][i] = fWorldSize*(Rand01(&uSeed)-0.5f); pfCen[1][i] = 40.0f*fY*fY*fY; pfCen[2][i] = fWorldSize*(Rand01(&uSeed)-0.5f);
+		for(int k=0; k<3; k++) pfExt[k][i] = 0.25f + 2.5f*Rand01(&uSeed);
+	}
+
+	SInstanceBVH bvh;
+	TestClock::time_point t0 = TestClock::now();
+	const bool bBuilt = BuildInstanceBVH(&bvh, pfCen, pfExt, NR_INSTANCES);
+	const double fBuildMs = MsSince(t0);
+	TEST_EXPECT(bBuilt, "failed to build the tree");
+	if(!bBuilt) return TestResult("instance_bvh");
+
+	const int iNrMoved = std::max(1, (int) (MOVED_FRACTION*NR_INSTANCES));
+	std::vector<int> moved(iNrMoved);
+	std::vector<int> visible, visibleScalar, visibleRef;
+	double fRefitMs = 0.0, fQueryMs = 0.0, fQueryScalarMs = 0.0, fBruteMs = 0.0;
+	long long iTotVisible = 0;
+	int iNrMismatches = 0, iNrScalarMismatches = 0, iNrRebuilds = 0;
+	SFrustumPlanes frustum;
+	for(int f=0; f<NR_FRAMES; f++)
+	{
+		// a random walk of a fraction of the instances
+		for(int m=0; m<iNrMoved; m++)
+		{
+			const int i = std::min(NR_INSTANCES-1, (int) (Rand01(&uSeed)*NR_INSTANCES));
+			for(int k=0; k<3; k++) pfCen[k][i] += 4.0f*(Rand01(&uSeed)-0.5f);
+			moved[m] = i;
+		}
+		t0 = TestClock::now();
+		if(RefitInstanceBVH(&bvh, pfCen, pfExt, &moved[0], iNrMoved)) ++iNrRebuilds;
+		fRefitMs += MsSince(t0);
+
+		// the camera circles the field looking across it
+		const float fT = ((float) f) / NR_FRAMES;
+		const float fAngle = 2*3.1415926535897932384626433832795f*fT;
+		const Vec3 vCamPos(0.35f*fWorldSize*cosf(fAngle), 2.0f+20.0f*fT, 0.35f*fWorldSize*sinf(fAngle));
+		Mat44 mWorldToClip;
+		GetTestWorldToClip(&mWorldToClip, vCamPos, fAngle + 2*(Rand01(&uSeed)-0.5f), -0.2f*Rand01(&uSeed));
+		GetFrustumPlanes(&frustum, mWorldToClip);
+
+		t0 = TestClock::now();
+		QueryInstanceBVH(visible, bvh, frustum);
+		fQueryMs += MsSince(t0);
+		t0 = TestClock::now();
+		QueryInstanceBVH(visibleScalar, bvh, frustum, false);
+		fQueryScalarMs += MsSince(t0);
+		t0 = TestClock::now();
+		BruteForceCull(visibleRef, frustum, pfCen, pfExt);
+		fBruteMs += MsSince(t0);
+
+		std::sort(visible.begin(), visible.end());
+		std::sort(visibleScalar.begin(), visibleScalar.end());
+		if(visible!=visibleRef) ++iNrMismatches;
+		if(visibleScalar!=visibleRef) ++iNrScalarMismatches;
+		iTotVisible += (long long) visible.size();
+	}
+	TEST_EXPECT(iTotVisible>0, "nothing visible in any frame");
+	TEST_EXPECT(iNrMismatches==0, "the query differs from testing every box in %d of %d frames", iNrMismatches, NR_FRAMES);
+	TEST_EXPECT(iNrScalarMismatches==0, "the scalar query differs from testing every box in %d of %d frames", iNrScalarMismatches, NR_FRAMES);
+
+	// everything moved, as when the origin is rebased
+	for(int i=0; i<NR_INSTANCES; i++) pfCen[0][i] += 100.0f;
+	std::vector<int> all(NR_INSTANCES);
+	for(int i=0; i<NR_INSTANCES; i++) all[i] = i;
+	t0 = TestClock::now();
+	RefitInstanceBVH(&bvh, pfCen, pfExt, &all[0], NR_INSTANCES, FLT_MAX);
+	const double fFullRefitMs = MsSince(t0);
+	QueryInstanceBVH(visible, bvh, frustum);
+	BruteForceCull(visibleRef, frustum, pfCen, pfExt);
+	std::sort(visible.begin(), visible.end());
+	TEST_EXPECT(visible==visibleRef, "the query differs from testing every box after refitting all");
+
+	printf("%d instances, %d nodes, %.0f visible per frame, %d rebuilds\n", NR_INSTANCES, (int) bvh.nodes.size(), ((double) iTotVisible)/NR_FRAMES, iNrRebuilds);
+	printf("build %.1f ms, refit of the moved %.2f ms, of all %.1f ms\n", fBuildMs, fRefitMs/NR_FRAMES, fFullRefitMs);
+	printf("query %.3f ms %s, %.3f ms scalar, %.2f ms testing every box\n", fQueryMs/NR_FRAMES, IsInstanceBVHAVX2Enabled() ? "AVX2" : "(no AVX2)",
+		   fQueryScalarMs/NR_FRAMES, fBruteMs/NR_FRAMES);
+
+	return TestResult("instance_bvh");
+}
@@ -0,0 +1,97 @@
+#include "test_common.h"
+#include <cputools/large_world.h>
+#include <geommath/geommath.h>
+#include <math.h>
+
+// The camera relative hex-tiling of the ground plane must pick the cells of
+// the double precision reference and stay well within a texel of it out to
+// 1e7 units, where the float world space path is expected to break down.
+// HexRWSPlanarOffsets() must split the st offset of every plane such that
+// the relative st plus the split reconstructs the absolute st of GetPlanarST().
+
+#define TILE_RATE				0.25	// 0.05*g_DetailTileRate as in the demo
+#define TEX_SIZE				1024
+#define MAX_TEXEL_ERR			0.05f
+#define NR_SPLIT_SAMPLES		10000
+#define MAX_SPLIT_ERR			1e-5
+
+static const double g_dGridScale = 2*sqrt(3.0);
+static const double g_dSkewYY = 1.15470054;
+
+// GetPlanarST() in shader_lighting.hlsl in double
+static void PlanarST(double st[2], const Vec3d &vP, const int axis)
+{
+	const double sp[] = { axis==0 ? -vP.z : vP.x, axis==0 ? vP.y : (axis==1 ? -vP.z : vP.y) };
+	st[0] = sp[0]; st[1] = 1.0-sp[1];
+}
+
+static double WrappedDiff(const double a, const double b)
+{
+	const double d = a - b;
+	return fabs(d - floor(d + 0.5));
+}
+
+static void CheckSplit(const Vec3d &vOrigin, unsigned int * puSeed)
+{
+	SHexRWSOffset offs[3];
+	HexRWSPlanarOffsets(offs, vOrigin, TILE_RATE);
+
+	double fMaxErr = 0.0, fMaxCenErr = 0.0;
+	for(int k=0; k<3; k++)
+	{
+		// st of the removed cells as in MakeCenST()
+		const double cen[] = { (offs[k].iCellOffs[0] + 0.5*offs[k].iCellOffs[1]) / g_dGridScale,
+							   (offs[k].iCellOffs[1] / g_dSkewYY) / g_dGridScale };
+		for(int c=0; c<2; c++)
+		{
+			const double fCenErr = WrappedDiff(offs[k].fCenOffs[c], cen[c]);
+			if(fCenErr>fMaxCenErr) fMaxCenErr = fCenErr;
+		}
+
+		for(int i=0; i<NR_SPLIT_SAMPLES; i++)
+		{
+			const Vec3d vRel(64*(2*Rand01(puSeed)-1), 64*(2*Rand01(puSeed)-1), 64*(2*Rand01(puSeed)-1));
+			double stAbs[2], stRel[2];
+			PlanarST(stAbs, TILE_RATE*(vOrigin + vRel), k);
+			PlanarST(stRel, TILE_RATE*vRel, k);
+
+			for(int c=0; c<2; c++)
+			{
+				const double fErr = fabs((stRel[c] + offs[k].fStOffs[c] + cen[c]) - stAbs[c]);
+				if(fErr>fMaxErr) fMaxErr = fErr;
+			}
+		}
+	}
+
+	TEST_EXPECT(fMaxErr<MAX_SPLIT_ERR, "split offset at %.0f is off by %g in st", vOrigin.x, fMaxErr);
+	TEST_EXPECT(fMaxCenErr<MAX_SPLIT_ERR, "cen_offs at %.0f is off by %g", vOrigin.x, fMaxCenErr);
+}
+
+int main()
+{
+	const double distances[] = { 1e5, 1e6, 1e7 };
+	unsigned int uSeed = 0x5bd1e995u;
+	for(int d=0; d<3; d++)
+	{
+		SLargeWorldReport rep;
+		const bool bRes = LargeWorldPrecisionReport(&rep, distances[d], TILE_RATE, TEX_SIZE);
+		TEST_EXPECT(bRes, "LargeWorldPrecisionReport() failed at %.0f", distances[d]);
+		if(!bRes) continue;
+
+		TEST_EXPECT(rep.iNrCellMismatchRWS==0, "%d of %d RWS samples pick other cells at %.0f", rep.iNrCellMismatchRWS,
+					rep.iNrSamples, distances[d]);
+		TEST_EXPECT(rep.fMaxTexelErrRWS<MAX_TEXEL_ERR, "RWS is off by %f texels at %.0f", rep.fMaxTexelErrRWS, distances[d]);
+		if(d==2)
+		{
+			TEST_EXPECT(rep.iNrCellMismatchAbs>0, "float world space picks the right cells at %.0f", distances[d]);
+			TEST_EXPECT(rep.fMaxTexelErrAbs>1.0f, "float world space is off by only %f texels at %.0f", rep.fMaxTexelErrAbs, distances[d]);
+		}
+
+		printf("%.0e: RWS %d mismatches %.4f texels, absolute %d mismatches %.2f texels\n", distances[d],
+			   rep.iNrCellMismatchRWS, rep.fMaxTexelErrRWS, rep.iNrCellMismatchAbs, rep.fMaxTexelErrAbs);
+
+		CheckSplit(Vec3d(distances[d] + 0.3711, -distances[d] + 1.7, distances[d] + 0.6173), &uSeed);
+	}
+
+	return TestResult("large_world");
+}
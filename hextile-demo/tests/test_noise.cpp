@@ -0,0 +1,165 @@
+#include "test_common.h"
+#include <cputools/noise_cpu.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+// Evaluates every noise function at pseudo random points within +/- 64 with
+// pixel sizes log-uniform in [1/1024; 2]. NoiseBatch() and DNoiseBatch(),
+// with AVX2 when the CPU has it, must give the bits of the scalar functions
+// and the analytic gradients must match central differences of the value.
+// CompareSimplexToPerlin() must find the simplex octaves of the derivative
+// fractals a drop-in for mysnoise(): same amplitude, value histogram and
+// power per octave band.
+
+#define NR_SAMPLES		100000
+#define NR_FD_SAMPLES	10000
+#define SAMPLE_RANGE	64.0f
+#define MIN_PIX_SIZE	(1.0f/1024)
+#define MAX_OCTAVES		8
+#define GRAD_TOLERANCE	1e-2f
+#define NR_COMPARE_SAMPLES	250000
+#define MAX_STDDEV_RATIO	1.05f
+#define MIN_HISTO_OVERLAP	0.9f
+#define MAX_BAND_POWER_DIFF	0.03f
+
+static const char * const g_pszFuncNames[] = { "snoise", "fractalsum", "turbulence", "fractalsummax", "turbulencemax", "simplex" };
+
+static void EvalScalar(float res[], const bool bDeriv, const eNoiseFunc func, const float P[], const float fPixSize)
+{
+	switch(func)
+	{
+	case NOISE_SNOISE:
+		if(bDeriv) mydsnoise(res, P); else res[0] = mysnoise(P);
+		break;
+	case NOISE_FRACTALSUM:
+		if(bDeriv) dfractalsum(res, P, fPixSize); else res[0] = fractalsum(P, fPixSize);
+		break;
+	case NOISE_TURBULENCE:
+		if(bDeriv) dturbulence(res, P, fPixSize); else res[0] = turbulence(P, fPixSize);
+		break;
+	case NOISE_FRACTALSUM_MAX:
+		if(bDeriv) dfractalsummax(res, P, fPixSize, MAX_OCTAVES); else res[0] = fractalsummax(P, fPixSize, MAX_OCTAVES);
+		break;
+	case NOISE_TURBULENCE_MAX:
+		if(bDeriv) dturbulencemax(res, P, fPixSize, MAX_OCTAVES); else res[0] = turbulencemax(P, fPixSize, MAX_OCTAVES);
+		break;
+	default:
+		if(bDeriv) mydssimplex(res, P); else res[0] = mysimplex(P);
+		break;
+	}
+}
+
+static void CheckBatch(const eNoiseFunc func, const std::vector<float> &X, const std::vector<float> &Y, const std::vector<float> &Z,
+					   const std::vector<float> &pix)
+{
+	const int N = (int) X.size();
+	std::vector<float> val(N), grad(4*N);
+	float * pfGrad[] = { &grad[0], &grad[N], &grad[2*N], &grad[3*N] };
+	NoiseBatch(&val[0], func, &X[0], &Y[0], &Z[0], N, &pix[0], 1.0f, MAX_OCTAVES);
+	DNoiseBatch(pfGrad, func, &X[0], &Y[0], &Z[0], N, &pix[0], 1.0f, MAX_OCTAVES);
+
+	int iNrMismatches = 0;
+	for(int i=0; i<N; i++)
+	{
+		const float P[] = { X[i], Y[i], Z[i] };
+		float fRef, fRefD[4];
+		EvalScalar(&fRef, false, func, P, pix[i]);
+		EvalScalar(fRefD, true, func, P, pix[i]);
+
+		bool bMismatch = memcmp(&fRef, &val[i], sizeof(float))!=0;
+		for(int k=0; k<4; k++) bMismatch |= memcmp(&fRefD[k], &pfGrad[k][i], sizeof(float))!=0;
+		if(bMismatch) ++iNrMismatches;
+	}
+	TEST_EXPECT(iNrMismatches==0, "%s: %d of %d batch results differ from the scalar functions", g_pszFuncNames[func], iNrMismatches, N);
+}
+
+// |analytic - central difference| relative to max(1, |analytic|). The step
+// scales with max(1, |p|) to stay well above the float resolution at P and
+// the pixel size is raised to 64 steps such that the finest octave is
+// resolved by the step.
+static float MaxAnalyticGradErr(const eNoiseFunc func, const std::vector<float> &X, const std::vector<float> &Y, const std::vector<float> &Z,
+								const std::vector<float> &pix)
+{
+	float fMaxErr = 0.0f;
+	for(int i=0; i<NR_FD_SAMPLES; i++)
+	{
+		const float P[] = { X[i], Y[i], Z[i] };
+		float fMaxAbs = 1.0f;
+		for(int k=0; k<3; k++) fMaxAbs = fabsf(P[k])>fMaxAbs ? fabsf(P[k]) : fMaxAbs;
+		const float fStep = fMaxAbs/(1<<14);
+		const float fPixSize = pix[i]>(64*fStep) ? pix[i] : (64*fStep);
+
+		float D[4];
+		EvalScalar(D, true, func, P, fPixSize);
+		for(int k=0; k<3; k++)
+		{
+			float P0[] = { P[0], P[1], P[2] }, P1[] = { P[0], P[1], P[2] };
+			P0[k] -= fStep; P1[k] += fStep;
+			float N0[4], N1[4];
+			EvalScalar(N0, true, func, P0, fPixSize);
+			EvalScalar(N1, true, func, P1, fPixSize);
+
+			const float fScale = fabsf(D[k+1])>1.0f ? fabsf(D[k+1]) : 1.0f;
+			const float fErr = fabsf((N1[0]-N0[0])/(P1[k]-P0[k]) - D[k+1]) / fScale;
+			if(fErr>fMaxErr) fMaxErr = fErr;
+		}
+	}
+
+	return fMaxErr;
+}
+
+int main()
+{
+	std::vector<float> X(NR_SAMPLES), Y(NR_SAMPLES), Z(NR_SAMPLES), pix(NR_SAMPLES);
+	unsigned int uSeed = 0x2545f491u;
+	const float fLogRange = log2f(2.0f/MIN_PIX_SIZE);
+	for(int i=0; i<NR_SAMPLES; i++)
+	{
+		X[i] = SAMPLE_RANGE*(2*Rand01(&uSeed)-1);
+		Y[i] = SAMPLE_RANGE*(2*Rand01(&uSeed)-1);
+		Z[i] = SAMPLE_RANGE*(2*Rand01(&uSeed)-1);
+		pix[i] = MIN_PIX_SIZE*exp2f(fLogRange*Rand01(&uSeed));
+	}
+
+	printf("AVX2 %s\n", IsNoiseAVX2Enabled() ? "enabled" : "disabled");
+	for(int f=0; f<NUM_NOISE_FUNCS; f++)
+	{
+		const eNoiseFunc func = (eNoiseFunc) f;
+		CheckBatch(func, X, Y, Z, pix);
+
+		// dturbulencemax(), and dturbulence() without SIMPLEX_DERIVS, are differences already
+#ifdef SIMPLEX_DERIVS
+		if(func!=NOISE_TURBULENCE_MAX)
+#else
+		if(func!=NOISE_TURBULENCE_MAX && func!=NOISE_TURBULENCE)
+#endif
+		{
+			const float fErr = MaxAnalyticGradErr(func, X, Y, Z, pix);
+			TEST_EXPECT(fErr<GRAD_TOLERANCE, "%s: analytic gradient off by %f", g_pszFuncNames[f], fErr);
+			printf("%-14s analytic gradient error %.5f\n", g_pszFuncNames[f], fErr);
+		}
+	}
+
+	SSimplexVsPerlinReport cmp;
+	const bool bCmp = CompareSimplexToPerlin(&cmp, NR_COMPARE_SAMPLES);
+	TEST_EXPECT(bCmp, "CompareSimplexToPerlin() failed");
+	if(bCmp)
+	{
+		const float fRatio = cmp.simplex.fStdDev / cmp.perlin.fStdDev;
+		TEST_EXPECT(fRatio<MAX_STDDEV_RATIO && fRatio>(1/MAX_STDDEV_RATIO), "simplex std dev %f against perlin %f",
+					cmp.simplex.fStdDev, cmp.perlin.fStdDev);
+		TEST_EXPECT(cmp.fHistoOverlap>=MIN_HISTO_OVERLAP, "histogram overlap %f", cmp.fHistoOverlap);
+		for(int b=0; b<NOISE_SPECTRUM_BANDS; b++)
+		{
+			const float fDiff = fabsf(cmp.simplex.fBandPower[b] - cmp.perlin.fBandPower[b]);
+			TEST_EXPECT(fDiff<=MAX_BAND_POWER_DIFF, "band %d power %f simplex against %f perlin", b,
+						cmp.simplex.fBandPower[b], cmp.perlin.fBandPower[b]);
+		}
+		printf("std dev %.4f simplex %.4f perlin, histogram overlap %.3f\n", cmp.simplex.fStdDev, cmp.perlin.fStdDev, cmp.fHistoOverlap);
+		printf("%.1f ns simplex %.1f ns perlin, dturbulence %.1f ns against %.1f ns\n", cmp.simplex.fNsPerCall, cmp.perlin.fNsPerCall,
+			   cmp.fNsDTurbulence, cmp.fNsDTurbulenceFD);
+	}
+
+	return TestResult("noise");
+}
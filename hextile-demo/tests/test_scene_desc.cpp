@@ -0,0 +1,138 @@
+#include "test_common.h"
+#include <cputools/scene_desc.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Generates a scene of random instances sharing a handful of meshes and
+// materials and takes it through the text and the binary form. Each must
+// give back the exact same arrays. Bad references, duplicate names, a
+// parent that isn't an earlier instance and truncated binaries must fail
+// to load. The times are for parsing from memory.
+
+#define NR_INSTANCES		50000
+#define NR_TEXTURES			6
+#define NR_MESHES			4
+#define NR_MATERIALS		3
+
+template<class T> static bool IsSameArray(const std::vector<T> &a, const std::vector<T> &b)
+{
+	return a.size()==b.size() && (a.size()==0 || memcmp(&a[0], &b[0], a.size()*sizeof(T))==0);
+}
+
+static bool IsSameSceneDesc(const SSceneDesc &a, const SSceneDesc &b)
+{
+	return IsSameArray(a.textures, b.textures) && IsSameArray(a.meshes, b.meshes) && IsSameArray(a.materials, b.materials) &&
+		   IsSameArray(a.bindings, b.bindings) && IsSameArray(a.globalBindings, b.globalBindings) && IsSameArray(a.instances, b.instances);
+}
+
+// records are zeroed so they compare with memcmp
+static void BuildRandomScene(SSceneDesc * pDesc)
+{
+	SSceneDesc &desc = *pDesc;
+	desc.textures.resize(NR_TEXTURES); desc.meshes.resize(NR_MESHES); desc.materials.resize(NR_MATERIALS);
+	memset(&desc.textures[0], 0, NR_TEXTURES*sizeof(SSceneTexture));
+	memset(&desc.meshes[0], 0, NR_MESHES*sizeof(SSceneMesh));
+	memset(&desc.materials[0], 0, NR_MATERIALS*sizeof(SSceneMaterial));
+
+	for(int t=0; t<NR_TEXTURES; t++)
+	{
+		SSceneTexture &tex = desc.textures[t];
+		sprintf(tex.cName, "tex%d", t);
+		strcpy(tex.cDir, "textures/details/");
+		sprintf(tex.cFile, "detail_%d.png", t);
+		tex.iKind = t%NUM_SCENE_TEXTURE_KINDS;
+		tex.bSRGB = t&1;
+	}
+
+	for(int m=0; m<NR_MESHES; m++)
+	{
+		SSceneMesh &mesh = desc.meshes[m];
+		sprintf(mesh.cName, "mesh%d", m);
+		sprintf(mesh.cFile, "meshes/mesh%d.obj", m);
+		mesh.fScale = 0.5f + m;
+		mesh.bCenter = m&1; mesh.bZtoYup = (m>>1)&1;
+	}
+
+	unsigned int uSeed = 12345;
+	for(int m=0; m<NR_MATERIALS; m++)
+	{
+		SSceneMaterial &mat = desc.materials[m];
+		sprintf(mat.cName, "mat%d", m);
+		sprintf(mat.cPixelShader, "Mat%dPS", m);
+		sprintf(mat.cDefine, "MAT%d_EXAMPLE", m);
+		sprintf(mat.cParamsCB, "cbMat%dShader", m);
+		mat.fTileRate = 0.25f + 4*Rand01(&uSeed);
+		mat.fBumpIntensity = Rand01(&uSeed);
+		mat.iFirstBinding = (int) desc.bindings.size();
+		mat.iNrBindings = m+1;
+		for(int b=0; b<mat.iNrBindings; b++)
+		{
+			SSceneTexBinding binding;
+			memset(&binding, 0, sizeof(binding));
+			sprintf(binding.cVariable, "g_tex%d", b);
+			binding.iTexture = (m+b)%NR_TEXTURES;
+			desc.bindings.push_back(binding);
+		}
+	}
+	SSceneTexBinding global;
+	memset(&global, 0, sizeof(global));
+	strcpy(global.cVariable, "g_table_FG");
+	global.iTexture = NR_TEXTURES-1;
+	desc.globalBindings.push_back(global);
+
+	desc.instances.resize(NR_INSTANCES);
+	for(int i=0; i<NR_INSTANCES; i++)
+	{
+		SSceneInstance &inst = desc.instances[i];
+		for(int k=0; k<3; k++) inst.fPos[k] = 1000.0f*(2*Rand01(&uSeed)-1);
+		for(int k=0; k<3; k++) inst.fRotDeg[k] = 360.0f*Rand01(&uSeed);
+		inst.fScale = 0.01f + 2*Rand01(&uSeed);
+		inst.iMesh = i%NR_MESHES;
+		inst.iMaterial = (i/NR_MESHES)%NR_MATERIALS;
+		inst.uFlags = i==0 ? (SCENE_INSTANCE_GROUND|SCENE_INSTANCE_NO_SHADOW) : ((i%7)==0 ? SCENE_INSTANCE_NO_SHADOW : 0);
+		inst.iParent = (i>1 && (i%3)==0) ? (1 + (int) (Rand01(&uSeed)*(i-1))) : -1;
+	}
+}
+
+int main()
+{
+	SSceneDesc desc;
+	BuildRandomScene(&desc);
+	TEST_EXPECT(IsSceneDescValid(desc), "the generated scene is invalid");
+
+	// text
+	std::string text;
+	SceneDescToText(text, desc);
+	SSceneDesc fromText;
+	TestClock::time_point t0 = TestClock::now();
+	const bool bTextParsed = ParseSceneDescText(&fromText, text.c_str());
+	const double fTextMs = MsSince(t0);
+	TEST_EXPECT(bTextParsed && IsSameSceneDesc(desc, fromText), "text round trip %s", bTextParsed ? "differs" : "failed to parse");
+
+	// binary
+	std::vector<unsigned char> data;
+	SceneDescToBinary(data, desc);
+	SSceneDesc fromBinary;
+	t0 = TestClock::now();
+	const bool bBinaryParsed = ParseSceneDescBinary(&fromBinary, &data[0], data.size());
+	const double fBinaryMs = MsSince(t0);
+	TEST_EXPECT(bBinaryParsed && IsSameSceneDesc(desc, fromBinary), "binary round trip %s", bBinaryParsed ? "differs" : "failed to parse");
+
+	// broken input must not load
+	SSceneDesc rejected;
+	TEST_EXPECT(!ParseSceneDescBinary(&rejected, &data[0], data.size()-1), "truncated binary loaded");
+	TEST_EXPECT(!ParseSceneDescText(&rejected, "mesh m meshes/m.obj 1\ninstance m no_such_material 0 0 0 0 0 0 1\n"), "unknown material loaded");
+	TEST_EXPECT(!ParseSceneDescText(&rejected, "texture t plain srgb dir/ a.png\ntexture t plain srgb dir/ b.png\n"), "duplicate texture name loaded");
+	TEST_EXPECT(!ParseSceneDescText(&rejected, "mesh m meshes/m.obj 1\nmaterial a PS NONE none 1 1\ninstance m a 0 0 0 0 0 0 1 parent 0\n"),
+				"instance parented to itself loaded");
+	desc.instances[NR_INSTANCES/2].iMesh = NR_MESHES;
+	SceneDescToBinary(data, desc);
+	TEST_EXPECT(!ParseSceneDescBinary(&rejected, &data[0], data.size()), "binary with a mesh out of range loaded");
+
+	printf("%d instances, text %d bytes parsed in %.1f ms, binary %d bytes in %.2f ms\n", NR_INSTANCES, (int) text.size(), fTextMs,
+		   (int) data.size(), fBinaryMs);
+
+	return TestResult("scene_desc");
+}
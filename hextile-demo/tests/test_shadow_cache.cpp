@@ -0,0 +1,138 @@
+#include "test_common.h"
+#include "shadow_test_params.h"
+#include <cputools/shadow_cache.h>
+#include <cputools/shadow_hull.h>
+#include <math.h>
+#include <vector>
+
+// Runs a static scene of random casters, then moves one caster per frame
+// and finally turns the sun. In the static frames nothing may be rendered.
+// For the moving casters every texel of the viewport whose center lies in
+// the old or the new light space footprint of the caster must be inside a
+// rect of the update, and only a small part of the map may be rendered.
+// After the sun turned every non empty cascade must be rendered in full.
+
+#define NR_FRAMES					32
+#define NR_CASTERS					256
+#define MAX_MOVING_RENDERED			0.05f
+
+// light space x, y bound of the caster
+static void GetCasterFootprint(float pfFootprint[4], const Mat33 &rotToLgt, const SShadowCaster &caster)
+{
+	Vec3 vMin, vMax;
+	GetShadowCasterLightBounds(&vMin, &vMax, rotToLgt, caster);
+	pfFootprint[0] = vMin.x; pfFootprint[1] = vMin.y;
+	pfFootprint[2] = vMax.x; pfFootprint[3] = vMax.y;
+}
+
+static bool InsideRects(const std::vector<SShadowCacheRect> &rects, const int iX, const int iY)
+{
+	for(int r=0; r<(int) rects.size(); r++)
+		if(iX>=rects[r].iX && iX<(rects[r].iX+rects[r].iWidth) && iY>=rects[r].iY && iY<(rects[r].iY+rects[r].iHeight)) return true;
+	return false;
+}
+
+// texels whose center lies in the footprint and which no rect of the update covers
+static int CountMissedTexels(const SShadowCascade &cascade, const SShadowCascadeUpdate &update, const float pfFootprint[4])
+{
+	if(update.bFull) return 0;
+
+	int iNrMissed = 0;
+	const int iX0 = (int) floorf((pfFootprint[0]-cascade.vLightMin.x)/cascade.fTexelSize), iX1 = (int) ceilf((pfFootprint[2]-cascade.vLightMin.x)/cascade.fTexelSize);
+	const int iY0 = (int) floorf((cascade.vLightMax.y-pfFootprint[3])/cascade.fTexelSize), iY1 = (int) ceilf((cascade.vLightMax.y-pfFootprint[1])/cascade.fTexelSize);
+	for(int y=(iY0<0 ? 0 : iY0); y<iY1 && y<cascade.iViewport[3]; y++)
+		for(int x=(iX0<0 ? 0 : iX0); x<iX1 && x<cascade.iViewport[2]; x++)
+		{
+			const float fLx = cascade.vLightMin.x + (x+0.5f)*cascade.fTexelSize;
+			const float fLy = cascade.vLightMax.y - (y+0.5f)*cascade.fTexelSize;
+			const bool bInFootprint = fLx>=pfFootprint[0] && fLx<=pfFootprint[2] && fLy>=pfFootprint[1] && fLy<=pfFootprint[3];
+			if(bInFootprint && !InsideRects(update.rects, x, y)) ++iNrMissed;
+		}
+
+	return iNrMissed;
+}
+
+int main()
+{
+	SShadowCascadeParams params;
+	InitShadowTestParams(&params, Vec3d(0.0, 0.0, 0.0));
+	const Vec4 vCamPos0 = GetColumn(params.mViewToWorld, 3);
+	const float fRange = params.fMaxShadowDist;
+
+	// boxes scattered on the ground around the camera
+	unsigned int uSeed = 0x2468aceu;
+	std::vector<SShadowCaster> casters(NR_CASTERS);
+	for(int i=0; i<NR_CASTERS; i++)
+	{
+		const float fSize = 0.25f + 2.0f*Rand01(&uSeed);
+		casters[i].vMin = Vec3(-fSize, 0.0f, -fSize);
+		casters[i].vMax = Vec3(fSize, 3*fSize*Rand01(&uSeed), fSize);
+		LoadRotation(&casters[i].mLocToWorld, 0.0f, 6.2831853f*Rand01(&uSeed), 0.0f);
+		casters[i].pfHull = NULL; casters[i].iNrHullVerts = 0;
+		SetColumn(&casters[i].mLocToWorld, 3, Vec4(vCamPos0.x + fRange*(2*Rand01(&uSeed)-1), vCamPos0.y - 2.0f - 2.0f*Rand01(&uSeed),
+												   vCamPos0.z + fRange*(2*Rand01(&uSeed)-1), 1.0f));
+	}
+
+	SShadowCache cache;
+	ResetShadowCache(&cache);
+	SShadowCascade cascades[MAX_SHADOW_CASCADES];
+	SShadowCascadeUpdate updates[MAX_SHADOW_CASCADES];
+	const int iNrCascades = params.iNrCascades;
+
+	// the first frame fills the cache
+	int iNrStaticFramesRendered = 0;
+	for(int f=0; f<=NR_FRAMES; f++)
+	{
+		FitShadowCascades(cascades, params, &casters[0], NR_CASTERS);
+		UpdateShadowCache(&cache, updates, cascades, iNrCascades, params.vSunDir, &casters[0], NR_CASTERS);
+		if(f==0) TEST_EXPECT(cache.stats.fRenderedFraction==1.0f, "first frame rendered %.3f of the map", cache.stats.fRenderedFraction);
+		else if(cache.stats.fRenderedFraction>0.0f) ++iNrStaticFramesRendered;
+	}
+	TEST_EXPECT(iNrStaticFramesRendered==0, "%d of %d static frames rendered", iNrStaticFramesRendered, NR_FRAMES);
+
+	// one caster moves per frame. The window depends on the union of the
+	// casters so it may move too, then the cascade is fully rendered.
+	Vec3 vX, vY, vZ;
+	BuildShadowBasis(&vX, &vY, &vZ, params.vSunDir);
+	Mat33 rotToLgt;
+	SetRow(&rotToLgt, 0, vX); SetRow(&rotToLgt, 1, vY); SetRow(&rotToLgt, 2, vZ);
+
+	int iNrMissedTexels = 0;
+	double dSumFraction = 0.0;
+	const TestClock::time_point t0 = TestClock::now();
+	for(int f=0; f<NR_FRAMES; f++)
+	{
+		SShadowCaster &caster = casters[(f*7919)%NR_CASTERS];
+		float fOld[4], fNew[4];
+		GetCasterFootprint(fOld, rotToLgt, caster);
+		const Vec4 vPos = GetColumn(caster.mLocToWorld, 3);
+		SetColumn(&caster.mLocToWorld, 3, Vec4(vPos.x + 0.5f + Rand01(&uSeed), vPos.y, vPos.z - 0.5f*Rand01(&uSeed), 1.0f));
+		GetCasterFootprint(fNew, rotToLgt, caster);
+
+		FitShadowCascades(cascades, params, &casters[0], NR_CASTERS);
+		UpdateShadowCache(&cache, updates, cascades, iNrCascades, params.vSunDir, &casters[0], NR_CASTERS);
+		dSumFraction += cache.stats.fRenderedFraction;
+
+		for(int c=0; c<iNrCascades; c++)
+		{
+			if(cascades[c].bEmpty) continue;
+			iNrMissedTexels += CountMissedTexels(cascades[c], updates[c], fOld);
+			iNrMissedTexels += CountMissedTexels(cascades[c], updates[c], fNew);
+		}
+	}
+	const double fMsPerFrame = MsSince(t0)/NR_FRAMES;
+	const float fMovingRendered = (float) (dSumFraction/NR_FRAMES);
+	TEST_EXPECT(iNrMissedTexels==0, "%d texels under a moved caster not rendered", iNrMissedTexels);
+	TEST_EXPECT(fMovingRendered>0.0f && fMovingRendered<MAX_MOVING_RENDERED, "moving one caster rendered %.3f of the map", fMovingRendered);
+
+	// a new light direction invalidates everything
+	params.vSunDir = Normalize(params.vSunDir + Vec3(0.01f, 0.0f, 0.0f));
+	FitShadowCascades(cascades, params, &casters[0], NR_CASTERS);
+	UpdateShadowCache(&cache, updates, cascades, iNrCascades, params.vSunDir, &casters[0], NR_CASTERS);
+	for(int c=0; c<iNrCascades; c++)
+		TEST_EXPECT(cascades[c].bEmpty || updates[c].bFull, "cascade %d not fully rendered after the sun turned", c);
+
+	printf("moving one caster per frame renders %.2f%% of the texels, %.2f ms per frame\n", 100*fMovingRendered, fMsPerFrame);
+
+	return TestResult("shadow_cache");
+}
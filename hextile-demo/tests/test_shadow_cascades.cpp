@@ -0,0 +1,194 @@
+#include "test_common.h"
+#include "shadow_test_params.h"
+#include <cputools/shadow_cascades.h>
+#include <cputools/shadow_hull.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+// Flies a camera through a field of random casters and fits the cascades
+// every frame, once in absolute world space and once camera relative far
+// from the origin. Coverage: random points of each slice below a caster
+// must project inside their cascade's window and within [0;1] in depth, as
+// must the corners of the casters overlapping the window. Stability: the
+// texel size of a cascade must not change and its window origin must move
+// by whole texels of the grid in absolute light space.
+
+#define NR_FRAMES				256
+#define NR_CASTERS				64
+#define NR_SAMPLES_PER_SLICE	256
+#define MAX_SUB_TEXEL_DRIFT		0.005f
+
+struct SCascadeStats
+{
+	int iNrCoverageSamples, iNrCoverageFailures;
+	int iNrTexelSizeChanges;
+	float fMaxSubTexelDrift;
+	float fMaxDepthRange;
+};
+
+static inline bool OverlapsXY(const Vec3 &vMinA, const Vec3 &vMaxA, const Vec3 &vMinB, const Vec3 &vMaxB)
+{
+	return vMinA.x<=vMaxB.x && vMaxA.x>=vMinB.x && vMinA.y<=vMaxB.y && vMaxA.y>=vMinB.y;
+}
+
+static void FlyThroughCasters(SCascadeStats * pStats, const SShadowCascadeParams &params_in)
+{
+	memset(pStats, 0, sizeof(SCascadeStats));
+
+	const bool bCameraRelative = params_in.vOrigin!=Vec3d(0,0,0);
+	const Vec4 vCamPos0 = GetColumn(params_in.mViewToWorld, 3);
+	const Vec3d vCamAbs0 = params_in.vOrigin + Vec3d(vCamPos0.x, vCamPos0.y, vCamPos0.z);
+	const float fRange = params_in.fMaxShadowDist<params_in.fFar ? params_in.fMaxShadowDist : params_in.fFar;
+
+	// boxes scattered around the start of the path, absolute world space
+	unsigned int uSeed = 0x1234567u;
+	std::vector<SShadowCaster> casters(NR_CASTERS);
+	std::vector<Vec3d> casterPos(NR_CASTERS);
+	for(int i=0; i<NR_CASTERS; i++)
+	{
+		const float fSize = 0.25f + 4.0f*Rand01(&uSeed);
+		casters[i].vMin = Vec3(-fSize, 0.0f, -fSize);
+		casters[i].vMax = Vec3(fSize, 3*fSize*Rand01(&uSeed), fSize);
+		LoadRotation(&casters[i].mLocToWorld, 0.0f, 6.2831853f*Rand01(&uSeed), 0.0f);
+		casters[i].pfHull = NULL; casters[i].iNrHullVerts = 0;
+		casterPos[i] = vCamAbs0 + Vec3d(fRange*(2*Rand01(&uSeed)-1), -2.0f*Rand01(&uSeed), fRange*(2*Rand01(&uSeed)-1));
+	}
+
+	Vec3 vX, vY, vZ;
+	BuildShadowBasis(&vX, &vY, &vZ, params_in.vSunDir);
+	Mat33 rotToLgt;
+	SetRow(&rotToLgt, 0, vX); SetRow(&rotToLgt, 1, vY); SetRow(&rotToLgt, 2, vZ);
+
+	SShadowCascade prev[MAX_SHADOW_CASCADES], cur[MAX_SHADOW_CASCADES];
+	SShadowCascadeParams params = params_in;
+	Mat44 mRot = params_in.mViewToWorld;
+	SetColumn(&mRot, 3, Vec4(0,0,0,1));
+	Vec3d vCamAbs = vCamAbs0;
+	double dPrevOrgX = 0, dPrevOrgY = 0;
+	std::vector<Vec3> casterBoxes(2*NR_CASTERS);
+
+	for(int f=0; f<NR_FRAMES; f++)
+	{
+		// walk and turn a little every frame
+		if(f>0)
+		{
+			Mat44 mYaw;
+			LoadRotation(&mYaw, 0.0f, 0.05f*(2*Rand01(&uSeed)-1), 0.0f);
+			mRot = mYaw * mRot;
+			const Vec4 vFwd = mRot*Vec4(0.0f, 0.0f, -1.0f, 0.0f);
+			const double dStep = 0.01 + 2.0*Rand01(&uSeed);
+			vCamAbs = vCamAbs + dStep*Vec3d(vFwd.x, 0.0f, vFwd.z);
+		}
+
+		params.vOrigin = bCameraRelative ? vCamAbs : Vec3d(0,0,0);
+		const Vec3 vCamRel(vCamAbs - params.vOrigin);
+		params.mViewToWorld = mRot;
+		SetColumn(&params.mViewToWorld, 3, Vec4(vCamRel.x, vCamRel.y, vCamRel.z, 1.0f));
+		for(int i=0; i<NR_CASTERS; i++)
+		{
+			const Vec3 vRel(casterPos[i] - params.vOrigin);
+			SetColumn(&casters[i].mLocToWorld, 3, Vec4(vRel.x, vRel.y, vRel.z, 1.0f));
+			GetShadowCasterLightBounds(&casterBoxes[2*i+0], &casterBoxes[2*i+1], rotToLgt, casters[i]);
+		}
+
+		FitShadowCascades(cur, params, &casters[0], NR_CASTERS);
+		const double dOrgX = Vec3d(vX)*params.vOrigin, dOrgY = Vec3d(vY)*params.vOrigin;
+
+		for(int c=0; c<params.iNrCascades; c++)
+		{
+			const SShadowCascade &cascade = cur[c];
+			const Mat44 mWorldToClip = cascade.mProj * cascade.mWorldToLight;
+			const float fDepthRange = cascade.vLightMax.z - cascade.vLightMin.z;
+			if(pStats->fMaxDepthRange<fDepthRange) pStats->fMaxDepthRange = fDepthRange;
+
+			// receivers below a caster
+			Vec3 vCorners[8];
+			GetFrustumSliceCorners(vCorners, params, cascade.fSplitNear, cascade.fSplitFar);
+			for(int s=0; s<NR_SAMPLES_PER_SLICE; s++)
+			{
+				const float u = Rand01(&uSeed), v = Rand01(&uSeed), w = Rand01(&uSeed);
+				Vec3 vP(0,0,0);
+				for(int j=0; j<8; j++)
+				{
+					const float fW = ((j&0x1)!=0 ? u : (1-u)) * ((j&0x2)!=0 ? v : (1-v)) * ((j&0x4)!=0 ? w : (1-w));
+					vP += fW*vCorners[j];
+				}
+
+				const Vec3 vPL = rotToLgt * vP;
+				bool bBelowCaster = false;
+				for(int i=0; i<NR_CASTERS && !bBelowCaster; i++)
+					bBelowCaster = OverlapsXY(vPL, vPL, casterBoxes[2*i+0], casterBoxes[2*i+1]);
+				if(!bBelowCaster) continue;
+
+				const Vec4 vClip = mWorldToClip*vP;
+				++pStats->iNrCoverageSamples;
+				if(fabsf(vClip.x)>1.0001f || fabsf(vClip.y)>1.0001f || vClip.z>1.0001f) ++pStats->iNrCoverageFailures;
+			}
+
+			// depth of the casters overlapping the window
+			for(int i=0; i<NR_CASTERS; i++)
+			{
+				if(!OverlapsXY(casterBoxes[2*i+0], casterBoxes[2*i+1], cascade.vLightMin, cascade.vLightMax)) continue;
+				const SShadowCaster &caster = casters[i];
+				for(int j=0; j<8; j++)
+				{
+					const Vec3 vPloc((j&0x1)!=0 ? caster.vMax.x : caster.vMin.x, (j&0x2)!=0 ? caster.vMax.y : caster.vMin.y, (j&0x4)!=0 ? caster.vMax.z : caster.vMin.z);
+					const Vec4 vClip = mWorldToClip*Vec3(caster.mLocToWorld*vPloc);
+					++pStats->iNrCoverageSamples;
+					if(vClip.z<-0.0001f || vClip.z>1.0001f) ++pStats->iNrCoverageFailures;
+				}
+			}
+
+			// texel grid of the window in absolute light space
+			if(f>0)
+			{
+				if(cascade.fTexelSize!=prev[c].fTexelSize) ++pStats->iNrTexelSizeChanges;
+
+				const double dTexel = cascade.fTexelSize;
+				const double dMove[] = { ((cascade.vLightMin.x + dOrgX) - (prev[c].vLightMin.x + dPrevOrgX)) / dTexel,
+										 ((cascade.vLightMin.y + dOrgY) - (prev[c].vLightMin.y + dPrevOrgY)) / dTexel };
+				for(int k=0; k<2; k++)
+				{
+					const float fDrift = (float) fabs(dMove[k] - floor(dMove[k]+0.5));
+					if(pStats->fMaxSubTexelDrift<fDrift) pStats->fMaxSubTexelDrift = fDrift;
+				}
+			}
+			prev[c] = cascade;
+		}
+		dPrevOrgX = dOrgX; dPrevOrgY = dOrgY;
+	}
+}
+
+int main()
+{
+	const Vec3d vOrigins[] = { Vec3d(0.0, 0.0, 0.0), Vec3d(1e6, 0.0, -3e6) };
+	for(int o=0; o<2; o++)
+	{
+		SShadowCascadeParams params;
+		InitShadowTestParams(&params, vOrigins[o]);
+
+		// the splits run from the near plane to the max shadow distance
+		float fSplits[MAX_SHADOW_CASCADES+1];
+		ComputeCascadeSplits(fSplits, params.iNrCascades, params.fNear, params.fMaxShadowDist, params.fSplitLambda);
+		bool bIncreasing = fSplits[0]==params.fNear && fSplits[params.iNrCascades]==params.fMaxShadowDist;
+		for(int c=0; c<params.iNrCascades; c++) bIncreasing &= fSplits[c]<fSplits[c+1];
+		TEST_EXPECT(bIncreasing, "splits not increasing from %g to %g", params.fNear, params.fMaxShadowDist);
+
+		SCascadeStats stats;
+		const TestClock::time_point t0 = TestClock::now();
+		FlyThroughCasters(&stats, params);
+		const double fMs = MsSince(t0);
+
+		const char * pszOrigin = o==0 ? "absolute" : "camera relative";
+		TEST_EXPECT(stats.iNrCoverageSamples>0, "%s: no coverage samples", pszOrigin);
+		TEST_EXPECT(stats.iNrCoverageFailures==0, "%s: %d of %d coverage samples outside their cascade", pszOrigin, stats.iNrCoverageFailures, stats.iNrCoverageSamples);
+		TEST_EXPECT(stats.iNrTexelSizeChanges==0, "%s: texel size changed %d times", pszOrigin, stats.iNrTexelSizeChanges);
+		TEST_EXPECT(stats.fMaxSubTexelDrift<MAX_SUB_TEXEL_DRIFT, "%s: window moved by %.4f of a texel", pszOrigin, stats.fMaxSubTexelDrift);
+
+		printf("%s: %d coverage samples, sub-texel drift %.4f, depth range %.1f, %.2f ms per frame\n", pszOrigin, stats.iNrCoverageSamples,
+			   stats.fMaxSubTexelDrift, stats.fMaxDepthRange, fMs/NR_FRAMES);
+	}
+
+	return TestResult("shadow_cascades");
+}
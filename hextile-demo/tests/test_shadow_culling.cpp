@@ -0,0 +1,141 @@
+#include "test_common.h"
+#include "shadow_test_params.h"
+#include <cputools/shadow_culling.h>
+#include <vector>
+
+// Fits the cascades for a camera turning in place above a field of random
+// casters and culls them through both paths. The masks must match in bits
+// and a culled caster must have no point of its oriented box, sampled on a
+// 5^3 grid, inside the volume of the cascade. The culled fraction must come
+// close to culling the light space box of the exact box corners.
+
+#define NR_FRAMES				64
+#define NR_CASTERS				4096
+#define MIN_CULLED_VS_TIGHT		0.95f
+
+static inline bool InsideVolume(const Vec3 &vP, const SShadowCascade &cascade)
+{
+	return vP.x>=cascade.vLightMin.x && vP.x<=cascade.vLightMax.x && vP.y>=cascade.vLightMin.y && vP.y<=cascade.vLightMax.y && vP.z>=cascade.vLightMin.z;
+}
+
+int main()
+{
+	SShadowCascadeParams params;
+	InitShadowTestParams(&params, Vec3d(0.0, 0.0, 0.0));
+	const Vec4 vCamPos0 = GetColumn(params.mViewToWorld, 3);
+	const float fRange = 2*params.fMaxShadowDist;
+
+	// boxes scattered on the ground around the camera
+	unsigned int uSeed = 0x7654321u;
+	std::vector<SShadowCaster> casters(NR_CASTERS);
+	for(int i=0; i<NR_CASTERS; i++)
+	{
+		const float fSize = 0.25f + 2.0f*Rand01(&uSeed);
+		casters[i].vMin = Vec3(-fSize, 0.0f, -fSize);
+		casters[i].vMax = Vec3(fSize, 3*fSize*Rand01(&uSeed), fSize);
+		LoadRotation(&casters[i].mLocToWorld, 0.0f, 6.2831853f*Rand01(&uSeed), 0.0f);
+		casters[i].pfHull = NULL; casters[i].iNrHullVerts = 0;
+		SetColumn(&casters[i].mLocToWorld, 3, Vec4(vCamPos0.x + fRange*(2*Rand01(&uSeed)-1), vCamPos0.y - 2.0f - 2.0f*Rand01(&uSeed),
+												   vCamPos0.z + fRange*(2*Rand01(&uSeed)-1), 1.0f));
+	}
+
+	std::vector<float> bounds(6*NR_CASTERS);
+	float * pfCen[] = { &bounds[0], &bounds[NR_CASTERS], &bounds[2*NR_CASTERS] };
+	float * pfExt[] = { &bounds[3*NR_CASTERS], &bounds[4*NR_CASTERS], &bounds[5*NR_CASTERS] };
+	GetShadowCasterWorldBounds(pfCen, pfExt, &casters[0], NR_CASTERS);
+	const float * const pfCenC[] = { pfCen[0], pfCen[1], pfCen[2] };
+	const float * const pfExtC[] = { pfExt[0], pfExt[1], pfExt[2] };
+
+	Vec3 vAxes[3];
+	BuildShadowBasis(&vAxes[0], &vAxes[1], &vAxes[2], params.vSunDir);
+	Mat33 rotToLgt;
+	for(int r=0; r<3; r++) SetRow(&rotToLgt, r, vAxes[r]);
+
+	std::vector<unsigned char> maskScalar(NR_CASTERS), maskAVX2(NR_CASTERS);
+	SShadowCascade cascades[MAX_SHADOW_CASCADES];
+	int iNrTests = 0, iNrMismatches = 0, iNrFalseCulls = 0, iNrCulled = 0, iNrTightCulled = 0;
+	double fMsScalar = 0.0, fMsAVX2 = 0.0;
+
+	for(int f=0; f<NR_FRAMES; f++)
+	{
+		// turn in place
+		Mat44 mRot;
+		LoadRotation(&mRot, -0.3f, (6.2831853f*f)/NR_FRAMES, 0.0f);
+		SetColumn(&mRot, 3, vCamPos0);
+		params.mViewToWorld = mRot;
+		FitShadowCascades(cascades, params, &casters[0], NR_CASTERS);
+
+		TestClock::time_point t0 = TestClock::now();
+		CullShadowCasters(&maskScalar[0], cascades, params.iNrCascades, params.vSunDir, pfCenC, pfExtC, NR_CASTERS, false);
+		fMsScalar += MsSince(t0);
+		t0 = TestClock::now();
+		CullShadowCasters(&maskAVX2[0], cascades, params.iNrCascades, params.vSunDir, pfCenC, pfExtC, NR_CASTERS, true);
+		fMsAVX2 += MsSince(t0);
+
+		for(int i=0; i<NR_CASTERS; i++)
+		{
+			if(maskScalar[i]!=maskAVX2[i]) ++iNrMismatches;
+
+			// light space box of the exact corners
+			Vec3 vCorners[8];
+			for(int j=0; j<8; j++)
+			{
+				const Vec3 vPloc((j&0x1)!=0 ? casters[i].vMax.x : casters[i].vMin.x, (j&0x2)!=0 ? casters[i].vMax.y : casters[i].vMin.y,
+								 (j&0x4)!=0 ? casters[i].vMax.z : casters[i].vMin.z);
+				const Vec4 v4Pw = casters[i].mLocToWorld*vPloc;
+				vCorners[j] = rotToLgt * Vec3(v4Pw.x, v4Pw.y, v4Pw.z);
+			}
+			Vec3 vMi = vCorners[0], vMa = vCorners[0];
+			for(int j=1; j<8; j++)
+			{
+				const Vec3 &vP = vCorners[j];
+				if(vMi.x>vP.x) vMi.x=vP.x;
+				if(vMa.x<vP.x) vMa.x=vP.x;
+				if(vMi.y>vP.y) vMi.y=vP.y;
+				if(vMa.y<vP.y) vMa.y=vP.y;
+				if(vMi.z>vP.z) vMi.z=vP.z;
+				if(vMa.z<vP.z) vMa.z=vP.z;
+			}
+
+			for(int c=0; c<params.iNrCascades; c++)
+			{
+				const SShadowCascade &cascade = cascades[c];
+				if(cascade.bEmpty) continue;
+				++iNrTests;
+
+				const bool bTight = vMa.x>=cascade.vLightMin.x && vMi.x<=cascade.vLightMax.x && vMa.y>=cascade.vLightMin.y &&
+									vMi.y<=cascade.vLightMax.y && vMa.z>=cascade.vLightMin.z;
+				if(!bTight) ++iNrTightCulled;
+
+				if((maskScalar[i]&(1<<c))!=0) continue;
+				++iNrCulled;
+
+				// trilinear samples of the box, corners included
+				bool bFalseCull = false;
+				for(int s=0; s<125 && !bFalseCull; s++)
+				{
+					const float u = (s%5)*0.25f, v = ((s/5)%5)*0.25f, w = (s/25)*0.25f;
+					const Vec3 vA = (1-u)*vCorners[0] + u*vCorners[1], vB = (1-u)*vCorners[2] + u*vCorners[3];
+					const Vec3 vC = (1-u)*vCorners[4] + u*vCorners[5], vD = (1-u)*vCorners[6] + u*vCorners[7];
+					const Vec3 vP = (1-w)*((1-v)*vA + v*vB) + w*((1-v)*vC + v*vD);
+					bFalseCull = InsideVolume(vP, cascade);
+				}
+				if(bFalseCull) ++iNrFalseCulls;
+			}
+		}
+	}
+
+	const float fCulled = iNrTests>0 ? ((float) iNrCulled)/iNrTests : 0.0f;
+	const float fTightCulled = iNrTests>0 ? ((float) iNrTightCulled)/iNrTests : 0.0f;
+	TEST_EXPECT(iNrTests>0, "no caster and cascade pairs tested");
+	TEST_EXPECT(iNrMismatches==0, "%d masks differ between the scalar and the AVX2 path", iNrMismatches);
+	TEST_EXPECT(iNrFalseCulls==0, "%d of %d culled pairs have a point inside the volume", iNrFalseCulls, iNrCulled);
+	TEST_EXPECT(fCulled>=MIN_CULLED_VS_TIGHT*fTightCulled, "culled %.1f%% of the pairs, %.1f%% by the exact corners", 100*fCulled, 100*fTightCulled);
+
+	const double dNrCasterTests = ((double) NR_FRAMES)*NR_CASTERS;
+	printf("culled %.1f%% of %d pairs, %.1f%% by the exact corners\n", 100*fCulled, iNrTests, 100*fTightCulled);
+	printf("%.1f ns per caster scalar, %.1f ns %s\n", (1e6*fMsScalar)/dNrCasterTests, (1e6*fMsAVX2)/dNrCasterTests,
+		   IsShadowCullAVX2Enabled() ? "AVX2" : "scalar, no AVX2");
+
+	return TestResult("shadow_culling");
+}
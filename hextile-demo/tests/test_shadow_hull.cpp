@@ -0,0 +1,128 @@
+#include "test_common.h"
+#include "shadow_test_params.h"
+#include <cputools/shadow_hull.h>
+#include <math.h>
+#include <vector>
+
+// Fits the cascades for random rotated meshes once by the corners of their
+// boxes and once by their hulls. The hull bound must contain every vertex
+// and match between the scalar and the AVX2 path. The casters' light space
+// area must shrink with the hulls and the fitted windows must not grow.
+
+#define NR_MESHES				64
+#define NR_POINTS				500
+#define NR_FRAMES				16
+#define MAX_NR_HULL_VERTS		96
+
+int main()
+{
+	SShadowCascadeParams params;
+	InitShadowTestParams(&params, Vec3d(0.0, 0.0, 0.0));
+	const Vec4 vCamPos0 = GetColumn(params.mViewToWorld, 3);
+	const float fRange = 0.5f*params.fMaxShadowDist;
+
+	// rounded, elongated point clouds turned about every axis
+	unsigned int uSeed = 0x13579bdu;
+	std::vector<float> positions(3*NR_POINTS*NR_MESHES);
+	std::vector<float> hulls;
+	std::vector<int> hullOffs(NR_MESHES);
+	std::vector<SShadowCaster> boxCasters(NR_MESHES), hullCasters(NR_MESHES);
+	int iMaxNrHullVerts = 0, iSumNrHullVerts = 0;
+	for(int m=0; m<NR_MESHES; m++)
+	{
+		const Vec3 vRadii(0.5f + 2*Rand01(&uSeed), 0.5f + 4*Rand01(&uSeed), 0.5f + 1*Rand01(&uSeed));
+		float * pfPos = &positions[3*NR_POINTS*m];
+		for(int i=0; i<NR_POINTS; i++)
+		{
+			Vec3 vDir;
+			do { vDir = Vec3(2*Rand01(&uSeed)-1, 2*Rand01(&uSeed)-1, 2*Rand01(&uSeed)-1); } while(LengthSquared(vDir)>1.0f || LengthSquared(vDir)<1e-4f);
+			vDir = Normalize(vDir);
+			pfPos[3*i+0] = vRadii.x*vDir.x; pfPos[3*i+1] = vRadii.y*vDir.y; pfPos[3*i+2] = vRadii.z*vDir.z;
+		}
+		Vec3 vMin(pfPos[0], pfPos[1], pfPos[2]), vMax = vMin;
+		for(int i=1; i<NR_POINTS; i++)
+		{
+			const Vec3 vP(pfPos[3*i+0], pfPos[3*i+1], pfPos[3*i+2]);
+			if(vMin.x>vP.x) vMin.x=vP.x;
+			if(vMax.x<vP.x) vMax.x=vP.x;
+			if(vMin.y>vP.y) vMin.y=vP.y;
+			if(vMax.y<vP.y) vMax.y=vP.y;
+			if(vMin.z>vP.z) vMin.z=vP.z;
+			if(vMax.z<vP.z) vMax.z=vP.z;
+		}
+		hullOffs[m] = (int) hulls.size();
+		const int iNrHullVerts = BuildShadowKDopHull(hulls, pfPos, 3, NR_POINTS);
+		TEST_EXPECT(iNrHullVerts>=4, "mesh %d has a hull of %d points", m, iNrHullVerts);
+		if(iMaxNrHullVerts<iNrHullVerts) iMaxNrHullVerts = iNrHullVerts;
+		iSumNrHullVerts += iNrHullVerts;
+
+		SShadowCaster &caster = boxCasters[m];
+		caster.vMin = vMin; caster.vMax = vMax;
+		LoadRotation(&caster.mLocToWorld, 6.2831853f*Rand01(&uSeed), 6.2831853f*Rand01(&uSeed), 6.2831853f*Rand01(&uSeed));
+		SetColumn(&caster.mLocToWorld, 3, Vec4(vCamPos0.x + fRange*(2*Rand01(&uSeed)-1), vCamPos0.y - 2.0f*Rand01(&uSeed),
+											   vCamPos0.z + fRange*(2*Rand01(&uSeed)-1), 1.0f));
+		caster.pfHull = NULL; caster.iNrHullVerts = 0;
+
+		hullCasters[m] = caster;
+		hullCasters[m].iNrHullVerts = iNrHullVerts;
+	}
+	for(int m=0; m<NR_MESHES; m++) hullCasters[m].pfHull = &hulls[hullOffs[m]];
+	TEST_EXPECT(iMaxNrHullVerts<=MAX_NR_HULL_VERTS, "a hull has %d points", iMaxNrHullVerts);
+
+	Vec3 vX, vY, vZ;
+	BuildShadowBasis(&vX, &vY, &vZ, params.vSunDir);
+	Mat33 rotToLgt;
+	SetRow(&rotToLgt, 0, vX); SetRow(&rotToLgt, 1, vY); SetRow(&rotToLgt, 2, vZ);
+
+	int iNrMismatches = 0, iNrOutside = 0;
+	double dAreaBox = 0.0, dAreaHull = 0.0;
+	for(int m=0; m<NR_MESHES; m++)
+	{
+		Vec3 vBoxMin, vBoxMax, vHullMin, vHullMax, vScalarMin, vScalarMax;
+		GetShadowCasterLightBounds(&vBoxMin, &vBoxMax, rotToLgt, boxCasters[m]);
+		GetShadowCasterLightBounds(&vHullMin, &vHullMax, rotToLgt, hullCasters[m]);
+		GetShadowCasterLightBounds(&vScalarMin, &vScalarMax, rotToLgt, hullCasters[m], false);
+		if(vScalarMin!=vHullMin || vScalarMax!=vHullMax) ++iNrMismatches;
+
+		dAreaBox += (vBoxMax.x-vBoxMin.x)*(vBoxMax.y-vBoxMin.y);
+		dAreaHull += (vHullMax.x-vHullMin.x)*(vHullMax.y-vHullMin.y);
+
+		// a relative tolerance for the rounding of the transform
+		const float * pfPos = &positions[3*NR_POINTS*m];
+		const float fTol = 1e-5f*(1.0f + fRange + Length(vHullMax-vHullMin));
+		for(int i=0; i<NR_POINTS; i++)
+		{
+			const Vec4 v4Pw = hullCasters[m].mLocToWorld*Vec3(pfPos[3*i+0], pfPos[3*i+1], pfPos[3*i+2]);
+			const Vec3 vP = rotToLgt * Vec3(v4Pw.x, v4Pw.y, v4Pw.z);
+			if(vP.x<(vHullMin.x-fTol) || vP.x>(vHullMax.x+fTol) || vP.y<(vHullMin.y-fTol) || vP.y>(vHullMax.y+fTol) ||
+			   vP.z<(vHullMin.z-fTol) || vP.z>(vHullMax.z+fTol)) ++iNrOutside;
+		}
+	}
+	TEST_EXPECT(iNrMismatches==0, "%d casters' bounds differ between the scalar and the AVX2 path", iNrMismatches);
+	TEST_EXPECT(iNrOutside==0, "%d vertices outside the bound of their hull", iNrOutside);
+	TEST_EXPECT(dAreaHull<dAreaBox, "hull area %.1f not below box area %.1f", dAreaHull, dAreaBox);
+
+	// texels of the fitted windows for a camera turning in place
+	SShadowCascade cascades[MAX_SHADOW_CASCADES];
+	double dTexelsBox = 0.0, dTexelsHull = 0.0;
+	for(int f=0; f<NR_FRAMES; f++)
+	{
+		Mat44 mRot;
+		LoadRotation(&mRot, -0.3f, (6.2831853f*f)/NR_FRAMES, 0.0f);
+		SetColumn(&mRot, 3, vCamPos0);
+		params.mViewToWorld = mRot;
+
+		for(int k=0; k<2; k++)
+		{
+			FitShadowCascades(cascades, params, k==0 ? &boxCasters[0] : &hullCasters[0], NR_MESHES);
+			for(int c=0; c<params.iNrCascades; c++)
+				if(!cascades[c].bEmpty) (k==0 ? dTexelsBox : dTexelsHull) += ((double) cascades[c].iViewport[2])*cascades[c].iViewport[3];
+		}
+	}
+	TEST_EXPECT(dTexelsHull<=dTexelsBox, "hull fit renders %.0f texels per frame, box fit %.0f", dTexelsHull/NR_FRAMES, dTexelsBox/NR_FRAMES);
+
+	printf("%.1f hull points per mesh, light space area %.2fx smaller, %.1f%% fewer texels per frame\n", ((float) iSumNrHullVerts)/NR_MESHES,
+		   dAreaBox/dAreaHull, dTexelsBox>0.0 ? 100*(1 - dTexelsHull/dTexelsBox) : 0.0);
+
+	return TestResult("shadow_hull");
+}
@@ -0,0 +1,144 @@
+#include "test_common.h"
+#include <cputools/transform_hierarchy.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+// Builds a random forest and changes a fraction of the local transforms
+// every frame. The world transforms and inverses must match those found by
+// multiplying the Mat44 chain to the root and taking ~mat, and the AVX2 and
+// the scalar update must agree to the bit. Only the changed nodes and their
+// descendants may be updated, nothing when no node changed. Cycles and out
+// of range parents must fail to build.
+
+#define NR_NODES			100000
+#define DIRTY_FRACTION		0.01f
+#define NR_FRAMES			64
+#define MAX_REL_ERROR		1e-3f
+
+static void RandomLocal(Mat44 * pmMat, unsigned int * puSeed)
+{
+	const float fPi = 3.1415926535897932384626433832795f;
+	LoadRotation(pmMat, 2*fPi*Rand01(puSeed), 2*fPi*Rand01(puSeed), 2*fPi*Rand01(puSeed));
+	for(int c=0; c<3; c++)
+	{
+		const float fScale = 0.9f + 0.2f*Rand01(puSeed);
+		SetColumn(pmMat, c, fScale*GetColumn(*pmMat, c));
+	}
+	SetColumn(pmMat, 3, Vec4(4*Rand01(puSeed)-2, 4*Rand01(puSeed)-2, 4*Rand01(puSeed)-2, 1.0f));
+}
+
+static float MaxRelativeError(const Mat44 &m, const Mat44 &ref)
+{
+	float fMaxErr = 0.0f;
+	for(int k=0; k<16; k++)
+	{
+		const float fRef = ref.m_fMat[k];
+		fMaxErr = std::max(fMaxErr, fabsf(m.m_fMat[k]-fRef) / std::max(1.0f, fabsf(fRef)));
+	}
+	return fMaxErr;
+}
+
+int main()
+{
+	// a random recursive forest, parents drawn among the earlier nodes in
+	// generation order and the ids shuffled such that the input isn't sorted
+	unsigned int uSeed = 2718;
+	std::vector<int> genParent(NR_NODES), perm(NR_NODES);
+	for(int i=0; i<NR_NODES; i++)
+	{
+		genParent[i] = (i==0 || Rand01(&uSeed)<0.02f) ? -1 : std::min(i-1, (int) (Rand01(&uSeed)*i));
+		perm[i] = i;
+	}
+	for(int i=NR_NODES-1; i>0; i--)
+		std::swap(perm[i], perm[std::min(i, (int) (Rand01(&uSeed)*(i+1)))]);
+
+	std::vector<int> parentById(NR_NODES);
+	for(int i=0; i<NR_NODES; i++)
+		parentById[perm[i]] = genParent[i]<0 ? -1 : perm[genParent[i]];
+
+	STransformHierarchy hier, hierScalar;
+	const bool bBuilt = BuildTransformHierarchy(&hier, &parentById[0], NR_NODES) && BuildTransformHierarchy(&hierScalar, &parentById[0], NR_NODES);
+	TEST_EXPECT(bBuilt, "failed to build the forest");
+	if(!bBuilt) return TestResult("transform_hierarchy");
+
+	std::vector<Mat44> locals(NR_NODES);
+	for(int id=0; id<NR_NODES; id++)
+	{
+		RandomLocal(&locals[id], &uSeed);
+		SetTransformLocal(&hier, id, locals[id]);
+		SetTransformLocal(&hierScalar, id, locals[id]);
+	}
+	TEST_EXPECT(UpdateTransformHierarchy(&hier)==NR_NODES, "the first update skipped nodes");
+	UpdateTransformHierarchy(&hierScalar, false);
+	TEST_EXPECT(UpdateTransformHierarchy(&hier)==0, "an update without changes recomputed nodes");
+
+	// change a fraction of the nodes each frame
+	const int iNrDirty = std::max(1, (int) (DIRTY_FRACTION*NR_NODES));
+	double fMs = 0.0, fMsScalar = 0.0;
+	long long iTotUpdated = 0;
+	for(int f=0; f<NR_FRAMES; f++)
+	{
+		for(int d=0; d<iNrDirty; d++)
+		{
+			const int id = std::min(NR_NODES-1, (int) (Rand01(&uSeed)*NR_NODES));
+			RandomLocal(&locals[id], &uSeed);
+			SetTransformLocal(&hier, id, locals[id]);
+			SetTransformLocal(&hierScalar, id, locals[id]);
+		}
+
+		TestClock::time_point t0 = TestClock::now();
+		iTotUpdated += UpdateTransformHierarchy(&hier);
+		fMs += MsSince(t0);
+		t0 = TestClock::now();
+		UpdateTransformHierarchy(&hierScalar, false);
+		fMsScalar += MsSince(t0);
+	}
+	const double fAvgUpdated = ((double) iTotUpdated) / NR_FRAMES;
+	TEST_EXPECT(fAvgUpdated>=iNrDirty && fAvgUpdated<NR_NODES, "%.0f of %d nodes updated per frame for %d changed", fAvgUpdated, NR_NODES, iNrDirty);
+
+	int iNrMismatches = 0;
+	for(int k=0; k<12*NR_NODES; k++)
+		if(memcmp(&hier.world[k], &hierScalar.world[k], sizeof(float))!=0 || memcmp(&hier.worldInv[k], &hierScalar.worldInv[k], sizeof(float))!=0) ++iNrMismatches;
+	TEST_EXPECT(iNrMismatches==0, "%d floats differ between the AVX2 and the scalar update", iNrMismatches);
+
+	// the reference multiplies the chain in generation order, parents first
+	std::vector<Mat44> refWorld(NR_NODES);
+	float fMaxWorldErr = 0.0f, fMaxInvErr = 0.0f;
+	for(int i=0; i<NR_NODES; i++)
+	{
+		const int id = perm[i];
+		refWorld[i] = genParent[i]<0 ? locals[id] : (refWorld[genParent[i]] * locals[id]);
+
+		Mat44 mWorld, mInv;
+		GetTransformWorld(&mWorld, &mInv, hier, id);
+		fMaxWorldErr = std::max(fMaxWorldErr, MaxRelativeError(mWorld, refWorld[i]));
+		fMaxInvErr = std::max(fMaxInvErr, MaxRelativeError(mInv, ~refWorld[i]));
+	}
+	TEST_EXPECT(fMaxWorldErr<MAX_REL_ERROR, "world transform off by %g", fMaxWorldErr);
+	TEST_EXPECT(fMaxInvErr<MAX_REL_ERROR, "inverse off by %g", fMaxInvErr);
+
+	// every node, as after a load
+	const int iNrFullRuns = 4;
+	const TestClock::time_point t0 = TestClock::now();
+	for(int r=0; r<iNrFullRuns; r++)
+	{
+		for(int node=0; node<NR_NODES && hier.parent[node]<0; node++)
+			MarkTransformDirty(&hier, hier.idOfNode[node]);
+		UpdateTransformHierarchy(&hier);
+	}
+	const double fFullMs = MsSince(t0)/iNrFullRuns;
+
+	// a cycle and an out of range parent
+	STransformHierarchy bad;
+	const int iCycle[3] = { 1, 2, 0 }, iOutOfRange[3] = { -1, 0, 3 };
+	TEST_EXPECT(!BuildTransformHierarchy(&bad, iCycle, 3), "a cycle was accepted");
+	TEST_EXPECT(!BuildTransformHierarchy(&bad, iOutOfRange, 3), "an out of range parent was accepted");
+
+	printf("%d nodes, depth %d, %.0f updated per frame in %.2f ms %s, %.2f ms scalar, %.2f ms for all\n", NR_NODES, hier.iMaxLevel, fAvgUpdated,
+		   fMs/NR_FRAMES, IsTransformHierarchyAVX2Enabled() ? "AVX2" : "(no AVX2)", fMsScalar/NR_FRAMES, fFullMs);
+	printf("max relative error world %g, inverse %g\n", fMaxWorldErr, fMaxInvErr);
+
+	return TestResult("transform_hierarchy");
+}
@@ -0,0 +1,122 @@
+#include "test_common.h"
+#include <cputools/triplanar_cpu.h>
+#include <meshimport/objreader.h>
+#include <math.h>
+#include <stdio.h>
+
+// Walks the biplanar weights along random great circles. A plane must be
+// dropped, and the third one picked up, at a weight of about zero so the
+// jump at an axis swap is no larger than anywhere else, and halving the
+// step must halve the largest jump as it does for continuous weights.
+// TriplanarProjectionsPerThreshold() must give between 1 and 3 projections
+// per pixel, fewer as the threshold grows, and skip nothing at a threshold
+// of 0 for an octahedron whose normals all keep three projections.
+
+#define NR_PATHS				1000
+#define MAX_WEIGHT_AT_SWAP		1e-3f
+#define MAX_JUMP_PER_RADIAN		12.0f
+#define MAX_JUMP_RATIO			0.6f
+#define NR_THRESHOLDS			8
+#define SPHERE_RINGS			16
+#define SPHERE_SEGMENTS			32
+
+static const char g_szSphereName[] = "test_triplanar_sphere.obj";
+static const char g_szOctaName[] = "test_triplanar_octahedron.obj";
+
+static bool WriteSphereObj(const char name[])
+{
+	FILE * fptr = fopen(name, "w");
+	if(fptr==NULL) return false;
+
+	for(int r=0; r<=SPHERE_RINGS; r++)
+		for(int s=0; s<=SPHERE_SEGMENTS; s++)
+		{
+			const float fTheta = 3.1415926f*r/SPHERE_RINGS, fPhi = 2*3.1415926f*s/SPHERE_SEGMENTS;
+			const float x = sinf(fTheta)*cosf(fPhi), y = cosf(fTheta), z = sinf(fTheta)*sinf(fPhi);
+			fprintf(fptr, "v %f %f %f\nvn %f %f %f\n", x, y, z, x, y, z);
+		}
+	for(int r=0; r<SPHERE_RINGS; r++)
+		for(int s=0; s<SPHERE_SEGMENTS; s++)
+		{
+			const int i0 = r*(SPHERE_SEGMENTS+1) + s + 1, i1 = i0 + SPHERE_SEGMENTS+1;
+			fprintf(fptr, "f %d//%d %d//%d %d//%d %d//%d\n", i0, i0, i0+1, i0+1, i1+1, i1+1, i1, i1);
+		}
+	fclose(fptr);
+
+	return true;
+}
+
+// flat shaded, every normal is (+/-1, +/-1, +/-1)/sqrt(3)
+static bool WriteOctahedronObj(const char name[])
+{
+	FILE * fptr = fopen(name, "w");
+	if(fptr==NULL) return false;
+
+	fprintf(fptr, "v 1 0 0\nv -1 0 0\nv 0 1 0\nv 0 -1 0\nv 0 0 1\nv 0 0 -1\n");
+	int n = 0;
+	for(int sz=-1; sz<=1; sz+=2)
+		for(int sy=-1; sy<=1; sy+=2)
+			for(int sx=-1; sx<=1; sx+=2)
+			{
+				fprintf(fptr, "vn %d %d %d\n", sx, sy, sz);
+				++n;
+				const int ix = sx>0 ? 1 : 2, iy = sy>0 ? 3 : 4, iz = sz>0 ? 5 : 6;
+				fprintf(fptr, "f %d//%d %d//%d %d//%d\n", ix, n, iy, n, iz, n);
+			}
+	fclose(fptr);
+
+	return true;
+}
+
+static void CheckProjectionsPerThreshold()
+{
+	float thresholds[NR_THRESHOLDS], avg[NR_THRESHOLDS];
+	for(int i=0; i<NR_THRESHOLDS; i++) thresholds[i] = 0.05f*i;
+
+	CObjReader sphere, octa;
+	const bool bMeshes = WriteSphereObj(g_szSphereName) && WriteOctahedronObj(g_szOctaName) &&
+						 sphere.ReadFile(g_szSphereName) && octa.ReadFile(g_szOctaName);
+	remove(g_szSphereName); remove(g_szOctaName);
+	TEST_EXPECT(bMeshes, "failed to write and read the test meshes");
+	if(!bMeshes) return;
+
+	bool bRes = TriplanarProjectionsPerThreshold(avg, thresholds, NR_THRESHOLDS, sphere);
+	TEST_EXPECT(bRes, "TriplanarProjectionsPerThreshold() failed for the sphere");
+	if(bRes)
+	{
+		for(int i=0; i<NR_THRESHOLDS; i++)
+		{
+			TEST_EXPECT(avg[i]>=1.0f && avg[i]<=3.0f, "%f projections at threshold %g", avg[i], thresholds[i]);
+			if(i>0) TEST_EXPECT(avg[i]<=avg[i-1], "projections grow from %f to %f at threshold %g", avg[i-1], avg[i], thresholds[i]);
+		}
+		printf("sphere: %.3f projections at threshold 0, %.3f at %.2f\n", avg[0], avg[NR_THRESHOLDS-1], thresholds[NR_THRESHOLDS-1]);
+	}
+
+	bRes = TriplanarProjectionsPerThreshold(avg, thresholds, 1, octa);
+	TEST_EXPECT(bRes, "TriplanarProjectionsPerThreshold() failed for the octahedron");
+	if(bRes) TEST_EXPECT(avg[0]==3.0f, "octahedron has %f projections at threshold 0", avg[0]);
+}
+
+int main()
+{
+	SBiplanarReport rep;
+	const bool bRes = BiplanarReport(&rep, NR_PATHS);
+	TEST_EXPECT(bRes, "BiplanarReport() failed");
+	if(bRes)
+	{
+		TEST_EXPECT(rep.fMaxWeightAtSwap<MAX_WEIGHT_AT_SWAP, "a plane is dropped at weight %f", rep.fMaxWeightAtSwap);
+		TEST_EXPECT(rep.fMaxJump[0]<(MAX_JUMP_PER_RADIAN*rep.fStep[0]), "weight jumps by %f for a step of %f", rep.fMaxJump[0], rep.fStep[0]);
+		TEST_EXPECT(rep.fMaxJump[1]<(MAX_JUMP_RATIO*rep.fMaxJump[0]), "halving the step takes the jump from %f to %f",
+					rep.fMaxJump[0], rep.fMaxJump[1]);
+
+		printf("max jump %.4f at step %.3f, %.4f at step %.4f, weight at swap %.6f\n", rep.fMaxJump[0], rep.fStep[0],
+			   rep.fMaxJump[1], rep.fStep[1], rep.fMaxWeightAtSwap);
+		printf("%.1f%% of normals left out near the corners\n", 100*rep.fCornerArea);
+		printf("%.1f ns triplanar at %.2f projections, %.1f ns biplanar at 2 projections\n", rep.fNsTriplanar,
+			   rep.fAvgTriplanarProjections, rep.fNsBiplanar);
+	}
+
+	CheckProjectionsPerThreshold();
+
+	return TestResult("triplanar");
+}
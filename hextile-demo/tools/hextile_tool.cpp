@@ -0,0 +1,276 @@
+#include "cputools/deriv_map.h"
+#include "cputools/hextile_baker.h"
+#include "cputools/hextile_lod.h"
+#include "cputools/hextile_stochastic.h"
+#include "cputools/histo_preserv.h"
+#include "cputools/noise_volume.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Command line front end of the offline tools in cputools/, see Usage().
+// Sources are read by LoadCpuImage(), which without WIC means float dds
+// only, and results are written as float dds.
+
+struct SToolArgs
+{
+	int iNrArgs;
+	char ** ppArgs;
+};
+
+// options are listed as -name, --name is accepted too
+static bool IsOption(const char arg[], const char option[])
+{
+	return strcmp(arg, option)==0 || (arg[0]=='-' && strcmp(arg+1, option)==0);
+}
+
+// value following the option, NULL when the option is absent
+static const char * FindOption(const SToolArgs &args, const char option[])
+{
+	for(int i=0; i<(args.iNrArgs-1); i++)
+		if(IsOption(args.ppArgs[i], option)) return args.ppArgs[i+1];
+	return NULL;
+}
+
+static bool HasFlag(const SToolArgs &args, const char flag[])
+{
+	for(int i=0; i<args.iNrArgs; i++)
+		if(IsOption(args.ppArgs[i], flag)) return true;
+	return false;
+}
+
+static float GetOption(const SToolArgs &args, const char option[], const float fDefault)
+{
+	const char * pszValue = FindOption(args, option);
+	return pszValue!=NULL ? (float) atof(pszValue) : fDefault;
+}
+
+static int GetOption(const SToolArgs &args, const char option[], const int iDefault)
+{
+	const char * pszValue = FindOption(args, option);
+	return pszValue!=NULL ? atoi(pszValue) : iDefault;
+}
+
+static bool ToWide(wchar_t dst[], const size_t uDstSize, const char src[])
+{
+	return mbstowcs(dst, src, uDstSize)<uDstSize;
+}
+
+// hextile-tool bake <src> <dst.dds>, -atlas <mesh.obj> bakes into its #vt2 uvs
+static int CommandBake(const SToolArgs &args, const char srcName[], const char dstName[])
+{
+	SHexBakeParams params;
+	InitHexBakeParams(&params, HasFlag(args, "-deriv") ? HEXBAKE_DERIV_FROM_NMAP : HEXBAKE_COLOR);
+	params.fTileRate = GetOption(args, "-rate", params.fTileRate);
+	params.fRotStrength = GetOption(args, "-rot", params.fRotStrength);
+	params.fFallOffContrast = GetOption(args, "-falloff", params.fFallOffContrast);
+	params.fExp = GetOption(args, "-exp", params.fExp);
+	params.fFakeContrast = GetOption(args, "-contrast", params.fFakeContrast);
+	params.iNrThreads = GetOption(args, "-threads", params.iNrThreads);
+	params.iGutter = GetOption(args, "-gutter", params.iGutter);
+	const int size = GetOption(args, "-size", 2048);
+
+	const char * pszMeshName = FindOption(args, "-atlas");
+	wchar_t srcNameW[512];
+	bool res = ToWide(srcNameW, 512, srcName);
+	if(res && pszMeshName!=NULL) res = HexBakeMeshAtlasFile(dstName, srcNameW, HasFlag(args, "-srgb"), pszMeshName, size, size, params);
+	else if(res) res = HexBakeTextureFile(dstName, srcNameW, HasFlag(args, "-srgb"), size, size, params);
+	if(!res) fprintf(stderr, "failed to bake %s into %s\n", srcName, dstName);
+
+	return res ? 0 : 1;
+}
+
+// the source and its mip chain, see BuildMipChainWrap()
+static bool LoadSourceMips(std::vector<SCpuImage> &mips, const char srcName[], const bool sRGB)
+{
+	wchar_t srcNameW[512];
+	SCpuImage src;
+	bool res = ToWide(srcNameW, 512, srcName) && LoadCpuImage(&src, srcNameW, sRGB);
+	if(res)
+	{
+		mips.resize(GetNrMipLevels(src.iWidth, src.iHeight));
+		res = BuildMipChainWrap(&mips[0], src, (int) mips.size());
+		FreeCpuImage(&src);
+	}
+	if(!res) fprintf(stderr, "failed to load %s\n", srcName);
+
+	return res;
+}
+
+static void FreeMips(std::vector<SCpuImage> &mips)
+{
+	for(size_t m=0; m<mips.size(); m++)
+		if(mips[m].pfPixels!=NULL) FreeCpuImage(&mips[m]);
+	mips.clear();
+}
+
+// hextile-tool lod <src>
+static int CommandLod(const SToolArgs &args, const char srcName[])
+{
+	std::vector<SCpuImage> mips;
+	if(!LoadSourceMips(mips, srcName, HasFlag(args, "-srgb"))) return 1;
+
+	const int iNrMips = (int) mips.size();
+	const float fErrBound = GetOption(args, "-bound", 0.02f);
+	std::vector<SHexLodError> err(iNrMips);
+	const bool res = HexLodErrorPerLevel(&err[0], &mips[0], iNrMips, GetOption(args, "-rot", 1.0f), GetOption(args, "-samples", 16384),
+										 GetOption(args, "-falloff", 0.6f), GetOption(args, "-exp", 7.0f));
+	if(res)
+	{
+		printf("level  size        max err  rms err\n");
+		for(int m=0; m<iNrMips; m++)
+			printf("%5d  %4dx%-4d   %.4f   %.4f\n", m, mips[m].iWidth, mips[m].iHeight, err[m].fMaxErr, err[m].fRmsErr);
+
+		const int iStart = HexLodFindFallbackStart(&err[0], iNrMips, fErrBound);
+		if(iStart<0) printf("no fallback start keeps the error below %g, disable the fallback\n", fErrBound);
+		else printf("fallback start %d keeps the error below %g\n", iStart, fErrBound);
+	}
+	FreeMips(mips);
+
+	return res ? 0 : 1;
+}
+
+// hextile-tool stochastic <src>
+static int CommandStochastic(const SToolArgs &args, const char srcName[])
+{
+	std::vector<SCpuImage> mips;
+	if(!LoadSourceMips(mips, srcName, HasFlag(args, "-srgb"))) return 1;
+
+	const int size = GetOption(args, "-size", 1024);
+	SHexStochasticStats stats;
+	const bool res = HexStochasticAnalyze(&stats, &mips[0], (int) mips.size(), size, size, GetOption(args, "-rate", 8.0f), GetOption(args, "-rot", 1.0f),
+										  GetOption(args, "-contrast", 0.5f), GetOption(args, "-falloff", 0.6f), GetOption(args, "-exp", 7.0f),
+										  GetOption(args, "-threads", 0));
+	if(res)
+	{
+		printf("%d pixels\n", stats.iNrPixels);
+		printf("bias            mean %.5f %.5f %.5f, mean abs %.5f, max abs %.5f\n", stats.fMeanBias[0], stats.fMeanBias[1], stats.fMeanBias[2],
+			   stats.fMeanAbsBias, stats.fMaxAbsBias);
+		printf("variance        mean %.5f, max %.5f\n", stats.fMeanVariance, stats.fMaxVariance);
+		printf("rms error       %.5f single frame\n", stats.fRmsErrSingleFrame);
+		printf("dominant tile   %.1f%% of pixels, %.2f fetches per pixel hybrid\n", 100.0f*stats.fDominantFraction, stats.fFetchesPerPixelHybrid);
+	}
+	FreeMips(mips);
+
+	return res ? 0 : 1;
+}
+
+// hextile-tool derivmap <src> <dst.dds>
+static int CommandDerivMap(const SToolArgs &args, const char srcName[], const char dstName[])
+{
+	wchar_t srcNameW[512];
+	SDerivMapStats stats;
+	const bool res = ToWide(srcNameW, 512, srcName) &&
+					 DerivMapTextureFile(dstName, srcNameW, &stats, GetOption(args, "-scale", 0.0f), GetOption(args, "-threads", 0));
+	if(res)
+	{
+		printf("scale           %.4f, decode with scale*(2*rg-1)\n", stats.fScale);
+		printf("clamped         %.3f%% of the texels\n", 100.0f*stats.fClampedFraction);
+		printf("deriv error     max %.5f, rms %.5f\n", stats.fMaxErr, stats.fRmsErr);
+		printf("angle error     max %.3f, rms %.3f degrees\n", stats.fMaxAngleErrDeg, stats.fRmsAngleErrDeg);
+		printf("mip difference  rms %.5f against converting filtered normals\n", stats.fMipRmsDiff);
+	}
+	else fprintf(stderr, "failed to convert %s into %s\n", srcName, dstName);
+
+	return res ? 0 : 1;
+}
+
+// hextile-tool noisevol <dst.dds>, the volume the demo bakes at startup by default
+static int CommandNoiseVol(const SToolArgs &args, const char dstName[])
+{
+	SCpuImage vol;
+	SNoiseVolumeStats stats;
+	bool res = BakeNoiseVolume(&vol, GetOption(args, "-res", 64), GetOption(args, "-period", 8), GetOption(args, "-threads", 0), &stats);
+	if(res)
+	{
+		res = SaveCpuImageDDS(dstName, &vol, 1);
+		FreeCpuImage(&vol);
+	}
+	if(res)
+	{
+		printf("volume          %d^3 texels over %d^3 lattice cells\n", stats.iRes, stats.iPeriod);
+		printf("bake            %.3f s, %.1f Mvoxels/s on %d threads\n", stats.fSeconds, stats.fMVoxelsPerSec, stats.iNrThreads);
+	}
+	else fprintf(stderr, "failed to write the noise volume to %s\n", dstName);
+
+	return res ? 0 : 1;
+}
+
+#ifdef _WIN32
+// hextile-tool histo <src> <dstbase>, the png of the transfer needs WIC
+static int CommandHisto(const SToolArgs &args, const char srcName[], const char dstBaseName[])
+{
+	wchar_t srcNameW[512], dstBaseNameW[512];
+	SHistoPreservAssets assets;
+	const bool res = ToWide(srcNameW, 512, srcName) && ToWide(dstBaseNameW, 512, dstBaseName) &&
+					 HistoPreservTextureFiles(dstBaseNameW, srcNameW, HasFlag(args, "-srgb"), &assets, GetOption(args, "-threads", 0));
+	if(res)
+	{
+		printf("vari            %.4f %.4f\n", assets.fVari[0], assets.fVari[1]);
+		printf("round trip      max %.5f, rms %.5f\n", assets.fRoundTripMaxErr, assets.fRoundTripRmsErr);
+		FreeHistoPreservAssets(&assets);
+	}
+	else fprintf(stderr, "failed to generate %s_transfer.png, _invtransfer.dds and _basis.dds from %s\n", dstBaseName, srcName);
+
+	return res ? 0 : 1;
+}
+#endif
+
+static void Usage()
+{
+	printf("usage: hextile-tool <command> <arguments> [options]\n\n");
+	printf("  bake <src> <dst.dds>     bake hex-tiling of the tileable src into a single texture\n");
+	printf("                           -size n (2048), -rate r (8), -rot s (1), -falloff c (0.6), -exp e (7),\n");
+	printf("                           -contrast r (0.5), -deriv (src is a normal map), -srgb,\n");
+	printf("                           -atlas mesh.obj (bake into its #vt2 uvs, r per uv unit), -gutter n (4)\n");
+	printf("  lod <src>                error of the single fetch fallback per mip level and the fallback start\n");
+	printf("                           -bound e (0.02), -rot s (1), -samples n (16384), -falloff c (0.6), -exp e (7), -srgb\n");
+	printf("  stochastic <src>         bias and variance of the single tap stochastic blend against the 3-tap blend\n");
+	printf("                           -size n (1024), -rate r (8), -rot s (1), -contrast r (0.5), -falloff c (0.6), -exp e (7), -srgb\n");
+	printf("  derivmap <src> <dst.dds> convert the tangent space normal map src into a derivative map\n");
+	printf("                           -scale s (0 picks it from the map)\n");
+	printf("  noisevol <dst.dds>       bake the tileable noise volume of dfractalsumvol() in noise.h\n");
+	printf("                           -res n (64), -period p (8)\n");
+#ifdef _WIN32
+	printf("  histo <src> <dstbase>    write dstbase_transfer.png, _invtransfer.dds and _basis.dds for hex2colTex_histo()\n");
+	printf("                           -srgb\n");
+#endif
+	printf("\n  -threads n uses n threads, all by default. Options may be given as --name too.\n");
+}
+
+int main(int argc, char * argv[])
+{
+	if(argc<2) { Usage(); return 1; }
+
+#ifdef _WIN32
+	if(FAILED( CoInitializeEx(NULL, COINIT_MULTITHREADED) )) return 1;
+#endif
+
+	SToolArgs args;
+	args.iNrArgs = argc-2;
+	args.ppArgs = argv+2;
+
+	int iRes = -1;
+	if(strcmp(argv[1], "bake")==0 && args.iNrArgs>=2) iRes = CommandBake(args, args.ppArgs[0], args.ppArgs[1]);
+	else if(strcmp(argv[1], "lod")==0 && args.iNrArgs>=1) iRes = CommandLod(args, args.ppArgs[0]);
+	else if(strcmp(argv[1], "stochastic")==0 && args.iNrArgs>=1) iRes = CommandStochastic(args, args.ppArgs[0]);
+	else if(strcmp(argv[1], "derivmap")==0 && args.iNrArgs>=2) iRes = CommandDerivMap(args, args.ppArgs[0], args.ppArgs[1]);
+	else if(strcmp(argv[1], "noisevol")==0 && args.iNrArgs>=1) iRes = CommandNoiseVol(args, args.ppArgs[0]);
+#ifdef _WIN32
+	else if(strcmp(argv[1], "histo")==0 && args.iNrArgs>=2) iRes = CommandHisto(args, args.ppArgs[0], args.ppArgs[1]);
+#endif
+
+	if(iRes<0) Usage();
+
+#ifdef _WIN32
+	CoUninitialize();
+#endif
+
+	return iRes<0 ? 1 : iRes;
+}